@@ -1,4 +1,3 @@
-
 //////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // file: Particles_selfcollisions.cs
@@ -20,6 +19,24 @@ layout (local_size_x = 256, local_size_y = 1) in;
 uniform int		gNumParticles;
 uniform float	DeltaTimeSecs;
 
+// broadphase - particles are binned into a hashed grid, contacts are searched in 27 adjacent cells
+//  passes are dispatched one by one with a storage barrier, see SelfCollisionsGrid for the CPU version
+uniform int		gPass;
+uniform int		gNumCells;		// a power of two
+
+#define		PASS_CLEAR			0
+#define		PASS_BOUNDS			1
+#define		PASS_COUNT			2
+#define		PASS_SCAN_BLOCKS	3
+#define		PASS_SCAN_SUMS		4
+#define		PASS_ADD_SUMS		5
+#define		PASS_SCATTER		6
+#define		PASS_COLLIDE		7
+
+#define		SCAN_BLOCK_SIZE		1024		// 4 cells per invocation
+#define		INVALID_CELL		0xffffffffu
+#define		CELL_SCALE			2.02
+
 #define		ACCELERATION_LIMIT		15.0
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -27,13 +44,13 @@ uniform float	DeltaTimeSecs;
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 struct TParticle
-{ 
+{
 	vec4				Pos;				// in w hold lifetime from 0.0 to 1.0 (normalized)
 	vec4				Vel;				// in w - individual birth randomF
 	// color packed in x. inherit color from the emitter surface, custom color simulation
 	vec4				Color;				// in y - total lifetime, z - AgeMillis, w - Index
-	vec4				Rot;				// 
-	vec4 				RotVel;				// 
+	vec4				Rot;				//
+	vec4 				RotVel;				//
 };
 
 layout (std430, binding = 0) buffer ParticleBuffer
@@ -41,6 +58,48 @@ layout (std430, binding = 0) buffer ParticleBuffer
 	TParticle particles[];
 } particleBuffer;
 
+struct TCell
+{
+	uint		count;
+	uint		start;
+};
+
+layout (std430, binding = 4) buffer CellBuffer
+{
+	TCell	cells[];
+} cellBuffer;
+
+layout (std430, binding = 5) buffer GridBuffer
+{
+	uint	maxRadiusBits;		// positive floats keep the order when compared as uint
+	uint	temp1;
+	uint	temp2;
+	uint	temp3;
+	uint	blockSums[];
+} gridBuffer;
+
+struct TKey
+{
+	uint		cell;
+	uint		rank;				// order inside the cell
+};
+
+layout (std430, binding = 6) buffer KeyBuffer
+{
+	TKey	keys[];
+} keyBuffer;
+
+struct TSorted
+{
+	vec4		pos;
+	vec4		vel;				// in w - age
+};
+
+layout (std430, binding = 7) buffer SortedBuffer
+{
+	TSorted	sorted[];
+} sortedBuffer;
+
 uint get_invocation()
 {
    //uint work_group = gl_WorkGroupID.x * gl_NumWorkGroups.y * gl_NumWorkGroups.z + gl_WorkGroupID.y * gl_NumWorkGroups.z + gl_WorkGroupID.z;
@@ -51,125 +110,223 @@ uint get_invocation()
    return work_group;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GRID
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float GetCellSize()
+{
+	return max(CELL_SCALE * uintBitsToFloat(gridBuffer.maxRadiusBits), 0.0001);
+}
+
+ivec3 CellCoord(vec3 pos, float cellSize)
+{
+	return ivec3(floor(pos / cellSize));
+}
+
+uint CellHash(ivec3 coord)
+{
+	uvec3 u = uvec3(coord);
+	return ((u.x * 73856093u) ^ (u.y * 19349663u) ^ (u.z * 83492791u)) & uint(gNumCells - 1);
+}
+
+shared uint scanData[gl_WorkGroupSize.x];
+
+// exclusive prefix of the value over the work group
+uint ScanWorkGroup(uint value)
+{
+	uint local = gl_LocalInvocationID.x;
+
+	scanData[local] = value;
+	barrier();
+
+	for (uint offset=1u; offset<gl_WorkGroupSize.x; offset *= 2u)
+	{
+		uint t = (local >= offset) ? scanData[local - offset] : 0u;
+		barrier();
+		scanData[local] += t;
+		barrier();
+	}
+
+	return scanData[local] - value;
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // MAIN
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-shared vec4 tmp[gl_WorkGroupSize.x];
-shared vec4 tmpVel[gl_WorkGroupSize.x];
 
 void main()
 {
 	// particle id in the array
 	uint flattened_id = get_invocation();
-	
-	// ?! skip unused part of the array
-	if (flattened_id >= gNumParticles)
-		return;
-	
-	vec3 acceleration = vec3(0.0);
-
-	// Read position and velocity
-	vec4 pos = particleBuffer.particles[flattened_id].Pos;
-	vec4 vel = particleBuffer.particles[flattened_id].Vel;
-	vec4 packedColor = particleBuffer.particles[flattened_id].Color;
-	float Age = packedColor.z;
-
-	float mass = 1.0;
-	float radius1 = pos.w;
-
-	if (Age > 0.0)
+
+	if (gPass == PASS_CLEAR)
+	{
+		if (flattened_id == 0)
+			gridBuffer.maxRadiusBits = 0u;
+
+		if (flattened_id < gNumCells)
+		{
+			cellBuffer.cells[flattened_id].count = 0u;
+			cellBuffer.cells[flattened_id].start = 0u;
+		}
+	}
+	else if (gPass == PASS_BOUNDS)
 	{
-		//int N = int(gl_NumWorkGroups.x*gl_WorkGroupSize.x);
-	
-		//
-		// linear calculation
-		
-		for (int i=0; i<gNumParticles; ++i)
+		if (flattened_id < gNumParticles && particleBuffer.particles[flattened_id].Color.z > 0.0)
 		{
-			
-			if ( i == flattened_id )
-				continue;
-			
-			vec4 other = particleBuffer.particles[i].Pos;
-			vec4 othervel = particleBuffer.particles[i].Vel;
-			vec4 otherColor = particleBuffer.particles[i].Color;
-
-			vec3 n = pos.xyz - other.xyz;
-			float udiff = length(n);
-			float radsum = radius1 + other.w;
-
-			if ( otherColor.z > 0.0 && udiff < radsum )
+			float radius = max(particleBuffer.particles[flattened_id].Pos.w, 0.0);
+			atomicMax(gridBuffer.maxRadiusBits, floatBitsToUint(radius) );
+		}
+	}
+	else if (gPass == PASS_COUNT)
+	{
+		if (flattened_id < gNumParticles)
+		{
+			TKey key = TKey(INVALID_CELL, 0u);
+
+			if (particleBuffer.particles[flattened_id].Color.z > 0.0)
 			{
-				n = normalize(n);
+				vec3 pos = particleBuffer.particles[flattened_id].Pos.xyz;
+				key.cell = CellHash(CellCoord(pos, GetCellSize()));
+				key.rank = atomicAdd(cellBuffer.cells[key.cell].count, 1u);
+			}
 
-				float a1 = dot(vel.xyz, n);
-				float a2 = dot(othervel.xyz, n);
+			keyBuffer.keys[flattened_id] = key;
+		}
+	}
+	else if (gPass == PASS_SCAN_BLOCKS || gPass == PASS_SCAN_SUMS)
+	{
+		// one work group per 1024 cells, then one work group over sums of the blocks
+		uint base = gl_WorkGroupID.x * SCAN_BLOCK_SIZE + gl_LocalInvocationID.x * 4u;
+		uint size = (gPass == PASS_SCAN_BLOCKS) ? uint(gNumCells) : uint(gNumCells) / SCAN_BLOCK_SIZE;
 
-				float optimizedP = (2.0 * (a1 - a2)) / (mass + mass); 
+		uint values[4];
+		uint sum = 0u;
 
-				// calculate v1', the new movement vector of circle1
-				//vel.xyz = vel.xyz - optimizedP * mass * n;
-				acceleration = acceleration - optimizedP * mass * n;
-			}
+		for (int i=0; i<4; ++i)
+		{
+			values[i] = 0u;
+			if (base + uint(i) < size)
+				values[i] = (gPass == PASS_SCAN_BLOCKS) ? cellBuffer.cells[base + uint(i)].count : gridBuffer.blockSums[base + uint(i)];
+			sum += values[i];
 		}
-		
-		/*
-		int N = int(gl_NumWorkGroups.x*gl_WorkGroupSize.x);
-		int groupSize = int(gl_WorkGroupSize.x);
-	
-		for(int tile = 0; tile<N; tile+=groupSize) 
+
+		uint prefix = ScanWorkGroup(sum);
+
+		for (int i=0; i<4; ++i)
 		{
-			int id = tile + int(gl_LocalInvocationIndex);
-			//tmpIndex[gl_LocalInvocationIndex] = tile + int(gl_LocalInvocationIndex);
-			if (id < gNumParticles)
+			if (base + uint(i) < size)
 			{
-				tmp[gl_LocalInvocationIndex] = particleBuffer.particles[id].Pos;
-				tmpVel[gl_LocalInvocationIndex] = particleBuffer.particles[id].Vel;
-				tmpVel[gl_LocalInvocationIndex].w = particleBuffer.particles[id].Color.z; // Age is stored in packedColor.z
+				if (gPass == PASS_SCAN_BLOCKS)
+					cellBuffer.cells[base + uint(i)].start = prefix;
+				else
+					gridBuffer.blockSums[base + uint(i)] = prefix;
 			}
-			else
+			prefix += values[i];
+		}
+
+		if (gPass == PASS_SCAN_BLOCKS && gl_LocalInvocationID.x == gl_WorkGroupSize.x - 1u)
+			gridBuffer.blockSums[gl_WorkGroupID.x] = prefix;
+	}
+	else if (gPass == PASS_ADD_SUMS)
+	{
+		if (flattened_id < gNumCells)
+			cellBuffer.cells[flattened_id].start += gridBuffer.blockSums[flattened_id / SCAN_BLOCK_SIZE];
+	}
+	else if (gPass == PASS_SCATTER)
+	{
+		if (flattened_id < gNumParticles)
+		{
+			TKey key = keyBuffer.keys[flattened_id];
+
+			if (key.cell != INVALID_CELL)
 			{
-				tmp[gl_LocalInvocationIndex] = vec4(0.0);
-				tmpVel[gl_LocalInvocationIndex] = vec4(0.0);
+				uint slot = cellBuffer.cells[key.cell].start + key.rank;
+
+				sortedBuffer.sorted[slot].pos = particleBuffer.particles[flattened_id].Pos;
+				sortedBuffer.sorted[slot].vel = vec4(particleBuffer.particles[flattened_id].Vel.xyz, particleBuffer.particles[flattened_id].Color.z);
 			}
-			
-			groupMemoryBarrier();
-			barrier();
-			for(int i=0; i<groupSize; ++i) 
-			{
-				vec4 other = tmp[i];
-				vec4 othervel = tmpVel[i];
-
-				vec3 n = pos.xyz - other.xyz;
-				float udiff = length(n);
-				float radsum = radius1 + other.w;
-				
-				if ( othervel.w > 0.0 && udiff < radsum && udiff > 0.0 )
+		}
+	}
+	else
+	{
+		// ?! skip unused part of the array
+		if (flattened_id >= gNumParticles)
+			return;
+
+		TKey key = keyBuffer.keys[flattened_id];
+
+		// dead particles keep a velocity
+		if (key.cell == INVALID_CELL)
+			return;
+
+		vec3 acceleration = vec3(0.0);
+
+		// Read position and velocity
+		vec4 pos = particleBuffer.particles[flattened_id].Pos;
+		vec4 vel = particleBuffer.particles[flattened_id].Vel;
+
+		float mass = 1.0;
+		float radius1 = pos.w;
+
+		uint ownSlot = cellBuffer.cells[key.cell].start + key.rank;
+		ivec3 coord = CellCoord(pos.xyz, GetCellSize());
+
+		uint visited[27];
+		int numVisited = 0;
+
+		for (int dz=-1; dz<=1; ++dz)
+			for (int dy=-1; dy<=1; ++dy)
+				for (int dx=-1; dx<=1; ++dx)
 				{
-					n = normalize(n);
+					uint hash = CellHash(coord + ivec3(dx, dy, dz));
+
+					// different cells could share a hash entry
+					bool seen = false;
+					for (int k=0; k<numVisited; ++k)
+						seen = seen || (visited[k] == hash);
+
+					if (seen)
+						continue;
 
-					float a1 = dot(vel.xyz, n);
-					float a2 = dot(othervel.xyz, n);
+					visited[numVisited] = hash;
+					numVisited += 1;
 
-					float optimizedP = (2.0 * (a1 - a2)) / (mass + mass); 
+					TCell cell = cellBuffer.cells[hash];
 
-					// calculate v1', the new movement vector of circle1
-					//vel.xyz = vel.xyz - optimizedP * mass * n;
-					acceleration = acceleration - optimizedP * mass * n;
+					for (uint i=cell.start; i<cell.start + cell.count; ++i)
+					{
+						if ( i == ownSlot )
+							continue;
+
+						// neighbours are read from the sorted copy, velocities of this step are not changed there
+						vec4 other = sortedBuffer.sorted[i].pos;
+						vec4 othervel = sortedBuffer.sorted[i].vel;
+
+						vec3 n = pos.xyz - other.xyz;
+						float udiff = length(n);
+						float radsum = radius1 + other.w;
+
+						if ( othervel.w > 0.0 && udiff < radsum && udiff > 0.0 )
+						{
+							n = n / udiff;
+
+							float a1 = dot(vel.xyz, n);
+							float a2 = dot(othervel.xyz, n);
+
+							float optimizedP = (2.0 * (a1 - a2)) / (mass + mass);
+
+							// calculate v1', the new movement vector of circle1
+							acceleration = acceleration - optimizedP * mass * n;
+						}
+					}
 				}
-			}
-			groupMemoryBarrier();
-			barrier();
-		}
-		*/
-	}
 
-	float accLen = length(acceleration);
-	if (accLen > ACCELERATION_LIMIT)
-		acceleration = ACCELERATION_LIMIT * normalize(acceleration);
-	
+		float accLen = length(acceleration);
+		if (accLen > ACCELERATION_LIMIT)
+			acceleration = ACCELERATION_LIMIT * normalize(acceleration);
 
-	particleBuffer.particles[flattened_id].Vel = vec4(vel.xyz + acceleration, vel.w);	// in w we individual birth randomF
-	//particleBuffer.particles[flattened_id].RotVel = vec4(acceleration.xyz, rotVel.w);
-}
\ No newline at end of file
+		particleBuffer.particles[flattened_id].Vel = vec4(vel.xyz + acceleration, vel.w);	// in w we individual birth randomF
+	}
+}
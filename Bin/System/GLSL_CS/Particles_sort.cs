@@ -0,0 +1,367 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: Particles_sort.cs
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+// GPU Particles back to front order for the alpha blending
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#version 430
+
+layout (local_size_x = 256, local_size_y = 1) in;
+
+uniform int		gNumParticles;
+uniform int		gPrevCount;		// order of the previous frame is used for [0; gPrevCount)
+uniform vec4	gViewRow;		// view space z is a dot with (position, 1)
+
+// LSD radix sort of depth keys, 4 passes of 8 bits, see DepthSort for the CPU version
+//  passes are dispatched one by one with a storage barrier, skipped passes have 0 groups in the indirect arguments
+uniform int		gPass;
+uniform int		gShift;
+
+#define		PASS_KEYS			0
+#define		PASS_GATHER			1
+#define		PASS_DECIDE			2
+#define		PASS_HISTOGRAM		3
+#define		PASS_CHECK			4
+#define		PASS_SCAN_BLOCKS	5
+#define		PASS_SCAN_SUMS		6
+#define		PASS_ADD_SUMS		7
+#define		PASS_SCATTER		8
+#define		PASS_FLIP			9
+#define		PASS_OUTPUT			10
+
+#define		GROUP_SIZE			256u
+#define		BUCKETS				256u
+#define		SCAN_BLOCK_SIZE		1024u		// 4 entries per invocation
+#define		DEAD_KEY			0xffffffffu
+#define		INVALID_VALUE		0xffffffffu
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TYPES AND DATA BUFFERS
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct TParticle
+{
+	vec4				Pos;				// in w hold lifetime from 0.0 to 1.0 (normalized)
+	vec4				Vel;				// in w - individual birth randomF
+	// color packed in x. inherit color from the emitter surface, custom color simulation
+	vec4				Color;				// in y - total lifetime, z - AgeMillis, w - Index
+	vec4				Rot;				//
+	vec4 				RotVel;				//
+};
+
+layout (std430, binding = 0) buffer ParticleBuffer
+{
+	TParticle particles[];
+} particleBuffer;
+
+// draw order, an element array buffer for rendering
+layout (std430, binding = 1) buffer OrderBuffer
+{
+	uint	indices[];
+} orderBuffer;
+
+// keys in the buffer order and two halves for passes
+layout (std430, binding = 4) buffer KeyBuffer
+{
+	uint	keys[];
+} keyBuffer;
+
+layout (std430, binding = 5) buffer ValueBuffer
+{
+	uint	values[];
+} valueBuffer;
+
+// bucket major, bucket * number of groups + group
+layout (std430, binding = 6) buffer HistogramBuffer
+{
+	uint	entries[];
+} histogramBuffer;
+
+// x of every dispatch arguments is written by the decide and the check passes
+layout (std430, binding = 7) buffer ControlBuffer
+{
+	uint	src;				// half of keys and values with the current order
+	uint	descents;			// neighbours in a wrong order in the previous order
+	uint	skip;				// the current radix pass does nothing
+	uint	sorted;
+
+	uint	histogramArgs[3];
+	uint	scanArgs[3];
+	uint	addArgs[3];
+	uint	scatterArgs[3];
+
+	uint	blockSums[];
+} controlBuffer;
+
+uint get_invocation()
+{
+   //uint work_group = gl_WorkGroupID.x * gl_NumWorkGroups.y * gl_NumWorkGroups.z + gl_WorkGroupID.y * gl_NumWorkGroups.z + gl_WorkGroupID.z;
+   //return work_group * gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z + gl_LocalInvocationIndex;
+
+   // uint work_group = gl_WorkGroupID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x + gl_WorkGroupID.x * gl_WorkGroupSize.x + gl_LocalInvocationIndex;
+   uint work_group = gl_GlobalInvocationID.y * (gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+   return work_group;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// KEYS
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint NumGroups()
+{
+	return (uint(gNumParticles) + GROUP_SIZE - 1u) / GROUP_SIZE;
+}
+
+uint NumEntries()
+{
+	return BUCKETS * NumGroups();
+}
+
+// smaller key is farther from the camera, particles without a size are not drawn
+uint DepthKey(TParticle particle)
+{
+	if (particle.Pos.w <= 0.0)
+		return DEAD_KEY;
+
+	uint u = floatBitsToUint( dot(gViewRow, vec4(particle.Pos.xyz, 1.0)) );
+	uint mask = ((u & 0x80000000u) != 0u) ? 0xffffffffu : 0x80000000u;
+	return u ^ mask;
+}
+
+shared uint scanData[gl_WorkGroupSize.x];
+shared uint sortKeys[gl_WorkGroupSize.x];
+shared uint sortValues[gl_WorkGroupSize.x];
+shared uint bucketData[BUCKETS];
+shared uint sharedValue;
+
+// exclusive prefix of the value over the work group
+uint ScanWorkGroup(uint value)
+{
+	uint local = gl_LocalInvocationID.x;
+
+	scanData[local] = value;
+	barrier();
+
+	for (uint offset=1u; offset<gl_WorkGroupSize.x; offset *= 2u)
+	{
+		uint t = (local >= offset) ? scanData[local - offset] : 0u;
+		barrier();
+		scanData[local] += t;
+		barrier();
+	}
+
+	return scanData[local] - value;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// MAIN
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void main()
+{
+	// particle id in the array
+	uint flattened_id = get_invocation();
+	uint local = gl_LocalInvocationID.x;
+	uint count = uint(gNumParticles);
+
+	uint srcOffset = count * (1u + controlBuffer.src);
+	uint dstOffset = count * (2u - controlBuffer.src);
+
+	if (gPass == PASS_KEYS)
+	{
+		if (flattened_id == 0)
+		{
+			controlBuffer.src = 0u;
+			controlBuffer.descents = 0u;
+			controlBuffer.skip = 0u;
+			controlBuffer.sorted = 0u;
+
+			for (int i=1; i<3; ++i)
+			{
+				controlBuffer.histogramArgs[i] = 1u;
+				controlBuffer.scanArgs[i] = 1u;
+				controlBuffer.addArgs[i] = 1u;
+				controlBuffer.scatterArgs[i] = 1u;
+			}
+		}
+
+		if (flattened_id < count)
+			keyBuffer.keys[flattened_id] = DepthKey(particleBuffer.particles[flattened_id]);
+	}
+	else if (gPass == PASS_GATHER)
+	{
+		// half 0 in the previous order, new particles are added after it
+		if (flattened_id < count)
+		{
+			uint index = (flattened_id < uint(gPrevCount)) ? orderBuffer.indices[flattened_id] : flattened_id;
+			uint key = keyBuffer.keys[index];
+
+			keyBuffer.keys[count + flattened_id] = key;
+			valueBuffer.values[flattened_id] = index;
+
+			if (flattened_id > 0u)
+			{
+				uint prevIndex = (flattened_id - 1u < uint(gPrevCount)) ? orderBuffer.indices[flattened_id - 1u] : (flattened_id - 1u);
+				if (keyBuffer.keys[prevIndex] > key)
+					atomicAdd(controlBuffer.descents, 1u);
+			}
+		}
+	}
+	else if (gPass == PASS_DECIDE)
+	{
+		if (flattened_id == 0)
+		{
+			controlBuffer.sorted = (controlBuffer.descents == 0u) ? 1u : 0u;
+			controlBuffer.histogramArgs[0] = (controlBuffer.sorted != 0u) ? 0u : NumGroups();
+		}
+	}
+	else if (gPass == PASS_HISTOGRAM)
+	{
+		bucketData[local] = 0u;
+		barrier();
+
+		if (flattened_id < count)
+			atomicAdd(bucketData[(keyBuffer.keys[srcOffset + flattened_id] >> uint(gShift)) & (BUCKETS - 1u)], 1u);
+		barrier();
+
+		histogramBuffer.entries[local * NumGroups() + gl_WorkGroupID.x] = bucketData[local];
+	}
+	else if (gPass == PASS_CHECK)
+	{
+		// one work group, invocation per bucket, the same digit for all keys does not change the order
+		if (local == 0u)
+			sharedValue = controlBuffer.sorted;
+		barrier();
+
+		uint numGroups = NumGroups();
+		uint total = 0u;
+
+		if (controlBuffer.sorted == 0u)
+		{
+			for (uint g=0u; g<numGroups; ++g)
+				total += histogramBuffer.entries[local * numGroups + g];
+
+			if (total == count)
+				sharedValue = 1u;
+		}
+		barrier();
+
+		if (local == 0u)
+		{
+			uint skip = sharedValue;
+
+			controlBuffer.skip = skip;
+			controlBuffer.scanArgs[0] = (skip != 0u) ? 0u : (NumEntries() + SCAN_BLOCK_SIZE - 1u) / SCAN_BLOCK_SIZE;
+			controlBuffer.addArgs[0] = (skip != 0u) ? 0u : numGroups;
+			controlBuffer.scatterArgs[0] = (skip != 0u) ? 0u : numGroups;
+		}
+	}
+	else if (gPass == PASS_SCAN_BLOCKS || gPass == PASS_SCAN_SUMS)
+	{
+		// one work group per 1024 entries, then one work group over sums of the blocks
+		uint base = gl_WorkGroupID.x * SCAN_BLOCK_SIZE + local * 4u;
+		uint size = NumEntries();
+
+		if (gPass == PASS_SCAN_SUMS)
+			size = (size + SCAN_BLOCK_SIZE - 1u) / SCAN_BLOCK_SIZE;
+
+		uint values[4];
+		uint sum = 0u;
+
+		for (int i=0; i<4; ++i)
+		{
+			values[i] = 0u;
+			if (base + uint(i) < size)
+				values[i] = (gPass == PASS_SCAN_BLOCKS) ? histogramBuffer.entries[base + uint(i)] : controlBuffer.blockSums[base + uint(i)];
+			sum += values[i];
+		}
+
+		uint prefix = ScanWorkGroup(sum);
+
+		for (int i=0; i<4; ++i)
+		{
+			if (base + uint(i) < size)
+			{
+				if (gPass == PASS_SCAN_BLOCKS)
+					histogramBuffer.entries[base + uint(i)] = prefix;
+				else
+					controlBuffer.blockSums[base + uint(i)] = prefix;
+			}
+			prefix += values[i];
+		}
+
+		if (gPass == PASS_SCAN_BLOCKS && local == gl_WorkGroupSize.x - 1u)
+			controlBuffer.blockSums[gl_WorkGroupID.x] = prefix;
+	}
+	else if (gPass == PASS_ADD_SUMS)
+	{
+		if (flattened_id < NumEntries())
+			histogramBuffer.entries[flattened_id] += controlBuffer.blockSums[flattened_id / SCAN_BLOCK_SIZE];
+	}
+	else if (gPass == PASS_SCATTER)
+	{
+		// stable order of the work group by the digit, 8 splits by one bit,
+		//  then a rank in the run of the digit is added to the offset of the group
+		uint key = DEAD_KEY;
+		uint value = INVALID_VALUE;
+
+		if (flattened_id < count)
+		{
+			key = keyBuffer.keys[srcOffset + flattened_id];
+			value = valueBuffer.values[srcOffset - count + flattened_id];
+		}
+
+		uint digit = (key >> uint(gShift)) & (BUCKETS - 1u);
+
+		for (uint bit=0u; bit<8u; ++bit)
+		{
+			uint b = (digit >> bit) & 1u;
+			uint zerosBefore = ScanWorkGroup(1u - b);
+
+			if (local == gl_WorkGroupSize.x - 1u)
+				sharedValue = zerosBefore + (1u - b);
+			barrier();
+
+			uint pos = (b == 0u) ? zerosBefore : sharedValue + (local - zerosBefore);
+			sortKeys[pos] = key;
+			sortValues[pos] = value;
+			barrier();
+
+			key = sortKeys[local];
+			value = sortValues[local];
+			digit = (key >> uint(gShift)) & (BUCKETS - 1u);
+			barrier();
+		}
+
+		// the tail of the last group is after all keys of its digit
+		if (local == 0u || digit != ((sortKeys[local - 1u] >> uint(gShift)) & (BUCKETS - 1u)) )
+			bucketData[digit] = local;
+		barrier();
+
+		if (value != INVALID_VALUE)
+		{
+			uint slot = histogramBuffer.entries[digit * NumGroups() + gl_WorkGroupID.x] + (local - bucketData[digit]);
+
+			keyBuffer.keys[dstOffset + slot] = key;
+			valueBuffer.values[dstOffset - count + slot] = value;
+		}
+	}
+	else if (gPass == PASS_FLIP)
+	{
+		if (flattened_id == 0 && controlBuffer.skip == 0u)
+			controlBuffer.src = 1u - controlBuffer.src;
+	}
+	else
+	{
+		if (flattened_id < count)
+			orderBuffer.indices[flattened_id] = valueBuffer.values[srcOffset - count + flattened_id];
+	}
+}
@@ -17,6 +17,11 @@ uniform vec2	renderSize;
 uniform vec2	renderBorder;
 uniform float	previewScaleFactor; // 1.0 for full image, 0.5 for half size
 
+uniform float 		cameraNearPlane;	// camera near plane
+uniform float 		cameraFarPlane;	// camera far plane
+
+uniform mat4		cameraViewProj;
+
 layout(binding=0, rgba8) uniform writeonly image2D resultImage;
 //layout(binding=5)		uniform sampler2D	positionSampler;
 
@@ -44,7 +49,7 @@ struct LayerData
 	float		near;
 	float		far;
 	
-	vec4		zoneInfo;		// x - number of volume models
+	vec4		zoneInfo;		// x - number of volume models, yzw - froxel grid size
 };
 
 struct ZoneData
@@ -70,6 +75,8 @@ layout (std430, binding = 1) buffer ZoneBuffer
 	ZoneData	zones[];
 } zoneBuffer;
 
+#include "misc_froxels.cs"
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 
@@ -221,7 +228,8 @@ float ComputeShadows(in int nsample, in vec2 texCoord, in ivec2 pixelPosition)
 #endif	
 	float shadow = 0.0;
 	
-	if (p.w > 0.0)
+	// froxel buffers are bound only when there are zones
+	if (p.w > 0.0 && layerBuffer.data.zoneInfo.x > 0.0)
 	{
 #ifdef ENABLE_MS
 		ivec3 iShadowSize = textureSize(shadowsSampler);
@@ -230,10 +238,13 @@ float ComputeShadows(in int nsample, in vec2 texCoord, in ivec2 pixelPosition)
 #endif
 		float shadowSize = float(iShadowSize.x);
 		
-		int count = int(layerBuffer.data.zoneInfo.x);
-		for (int i=0; i<count; ++i)
+		// only zones which overlap the pixel froxel
+		vec4 clipPos = cameraViewProj * vec4(p.xyz, 1.0);
+		uvec2 froxel = FindFroxelRange(clipPos, layerBuffer.data.zoneInfo.yzw, cameraNearPlane, cameraFarPlane);
+		
+		for (uint i=0; i<froxel.y; ++i)
 		{
-			ComputeVolumeShadow(shadow, shadowSize, i, p.xyz, texCoord);
+			ComputeVolumeShadow(shadow, shadowSize, int(froxelIndexBuffer.indices[froxel.x + i]), p.xyz, texCoord);
 		}
 	}
 	
@@ -35,5 +35,10 @@ void InvertNormals(FBModel *pModel);
 FBModel *MakeSnapshot( FBModel *pModel, const bool ResetXForm );
 // more corrent snapshot using FBX SDK
 FBModel *MakeSnapshot2(FBModel *pModel, const bool ResetXForm, const bool CopyShaders );
+// snapshots of several models in one batch, jobs are queued to the persistent cmdFBX worker together
+//	returns number of created snapshots, names of new models are added into newNames
+int MakeSnapshots2(FBModelList &modelList, const int numberOfCopies, const bool ResetXForm, const bool CopyShaders, FBStringList *newNames=nullptr );
 
-FBModel *CombineModels(FBModelList &modelList);
\ No newline at end of file
+// UseTextureAtlas - pack diffuse textures of all materials into one atlas texture and remap uvs,
+//	so combined model needs one material for all textured parts
+FBModel *CombineModels(FBModelList &modelList, const bool UseTextureAtlas=false);
\ No newline at end of file
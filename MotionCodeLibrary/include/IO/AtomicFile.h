@@ -0,0 +1,60 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: AtomicFile.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+
+//
+// file is written into a temp file next to it and renamed on commit, a reader never sees
+//  a half written file. Temp name is unique for the process and the call, no SDK dependency
+//
+
+class AtomicFileWriter
+{
+public:
+
+	//! a constructor
+	AtomicFileWriter();
+	//! a destructor, not committed data is removed
+	~AtomicFileWriter();
+
+	bool Open(const char *filename);
+	bool Write(const void *data, const size_t size);
+
+	//! close and replace the destination, false when any write has failed
+	bool Commit();
+	//! close and remove the temp file
+	void Abort();
+
+	bool IsOpen() const {
+		return mFile != nullptr;
+	}
+
+protected:
+
+	FILE			*mFile;
+	bool			mFailed;
+
+	std::string		mFilename;
+	std::string		mTempFilename;
+
+private:
+	// no copy
+	AtomicFileWriter(const AtomicFileWriter &);
+	void operator = (const AtomicFileWriter &);
+};
+
+//! whole buffer in one call
+bool WriteFileAtomic(const char *filename, const void *data, const size_t size);
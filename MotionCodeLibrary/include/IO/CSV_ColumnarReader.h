@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: CSV_ColumnarReader.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+//////////////////////////////////////////////
+//! naturalpoint tracking tools format reader, columnar storage
+/*!
+	file is memory mapped and split into row chunks that are parsed in parallel.
+	Each marker is stored as 3 contiguous float columns (x, y, z) with one row per frame line,
+	missing samples are kept in a per marker bitmask. Frame to row is a dense index, so
+	GetFramePos is O(1) for any frame order.
+
+	Binary sidecar (<filename>.colcache) is opt-in, it keeps the parsed columns next to the
+	source file and second load of an unchanged file just copies them back. Writing and
+	loading of a sidecar is reported in the console.
+*/
+class csv_columnar_data
+{
+public:
+
+	//! a constructor
+	csv_columnar_data();
+
+	//! free all reader allocated data
+	void FreeData();
+
+	//! read information from *.csv text file
+	/*!
+		\param pFileName - source csv file
+		\param useSidecar - try to load binary sidecar first and write it next to the file after parsing
+		\param numberOfThreads - 0 for hardware concurrency
+	*/
+	bool Read(const char *pFileName, const bool useSidecar=false, const int numberOfThreads=0);
+
+	bool WriteSidecar(const char *pFileName) const;
+	bool ReadSidecar(const char *pFileName);
+
+	//! number of frames declared in the file info
+	int GetDeclaredFrameCount() const { return mDeclaredFrameCount; }
+	int GetRigidBodyCount() const { return mRigidBodyCount; }
+	//! last timestamp in the file
+	double GetLength() const { return mLength; }
+
+	int GetMarkerCount() const { return mMarkerCount; }
+	int GetRowCount() const { return mRowCount; }
+	int GetFirstFrame() const { return mFirstFrame; }
+	int GetLastFrame() const { return mFirstFrame + (int) mFrameToRow.size() - 1; }
+
+	//! row index for the frame, -1 if there is no such frame in the file
+	int GetFrameRow(const int frame) const
+	{
+		const int index = frame - mFirstFrame;
+		if (index < 0 || index >= (int) mFrameToRow.size())
+			return -1;
+		return mFrameToRow[index];
+	}
+
+	int GetRowFrame(const int row) const { return mFrames[row]; }
+	double GetRowTimestamp(const int row) const { return mTimestamps[row]; }
+
+	//! is marker visible in the row
+	bool IsPresent(const int marker, const int row) const
+	{
+		const uint32_t word = mPresent[marker * mPresentWords + (row >> 5)];
+		return 0 != (word & (1u << (row & 31)));
+	}
+
+	//! contiguous column of marker values, axis 0 - x, 1 - y, 2 - z
+	const float *GetColumn(const int marker, const int axis) const
+	{
+		return mColumns.data() + ((size_t) marker * 3 + axis) * mRowCount;
+	}
+
+	//! GetFramePos
+	/*!
+		\param marker - marker index
+		\param frame - frame index
+		\param pos - 3 floats to fill
+		\return - false if frame is not in the file or marker is occluded in this frame
+	*/
+	bool GetFramePos(const int marker, const int frame, float *pos) const
+	{
+		const int row = GetFrameRow(frame);
+		if (row < 0 || marker < 0 || marker >= mMarkerCount || false == IsPresent(marker, row))
+			return false;
+
+		pos[0] = GetColumn(marker, 0)[row];
+		pos[1] = GetColumn(marker, 1)[row];
+		pos[2] = GetColumn(marker, 2)[row];
+		return true;
+	}
+
+	static std::string GetSidecarName(const char *pFileName);
+
+protected:
+
+	int				mDeclaredFrameCount;
+	int				mRigidBodyCount;
+	double			mLength;
+
+	int				mMarkerCount;
+	int				mRowCount;
+	int				mFirstFrame;
+	int				mPresentWords;		// bitmask words per marker
+
+	std::vector<int>		mFrames;		// frame id per row
+	std::vector<double>		mTimestamps;	// timestamp per row
+	std::vector<int>		mFrameToRow;	// dense, frame - mFirstFrame -> row or -1
+	std::vector<float>		mColumns;		// [marker][axis][row]
+	std::vector<uint32_t>	mPresent;		// [marker][row / 32]
+
+	// returns offset of the first frame line, header info lines are parsed on the way
+	size_t ParseHeader(const char *data, const size_t size);
+};
+
+//////////////////////////////////////////////////////////////////
+// checks on a synthetic file, no SDK involved
+
+//! csv text and sidecar round trip in the folder, a stale or truncated sidecar is rejected, false on a mismatch
+bool CSVColumnarReaderSelfTest(const char *folder);
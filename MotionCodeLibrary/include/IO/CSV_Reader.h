@@ -274,9 +274,7 @@ public:
 		markercount = 0;
 	}
 	//! free all reader allocated data
-	void FreeData()
-	{
-	}
+	void FreeData();
 
 	//! a destructor
 	~csv_data() {
@@ -284,15 +282,14 @@ public:
 	}
 
 	//! read information from *.csv text file
-	bool Read(const char *pFileName)
-	{
-		return false;
-	}
+	/*!
+		frame lines are read with csv_columnar_data
+		\param pFileName - source csv file
+		\param useSidecar - keep parsed frames in a binary sidecar next to the source file
+	*/
+	bool Read(const char *pFileName, const bool useSidecar=false);
 
 private:
-	//! import frame data from text line
-	// TODO:
-	//void ImportFrameData( CEUtils::StringTokens	&tokens );
 	//! filter frame data (markers numerations)
 	void FilterFrameData();
 	//! create new optical rigid body form text line parsing
@@ -19,4 +19,24 @@
 bool CmdMakeSnapshotFBX_Send(const char *filename, const char *uniqueName, InputModelData &data, const bool ResetXForm);
 //#endif
 
-bool CmdMakeSnapshotFBX_Receive(InputModelData *data);
\ No newline at end of file
+//! unpack the sent block into an editable structure (allocates polygons and clusters)
+bool CmdMakeSnapshotFBX_Receive(InputModelData *data);
+//! save a snapshot straight from the sent block, the geometry is read in place from the shared memory
+bool CmdMakeSnapshotFBX_ReceiveSnapshot(const char *filename, const char *uniqueName, const bool ResetXForm);
+
+//
+// persistent cmdFBX worker
+//	one cmdFBX process stays alive and takes snapshot jobs from a ring of shared memory slots,
+//	CmdMakeSnapshotFBX_Send uses the worker when it's running and falls back to a process per snapshot otherwise
+
+//#ifdef CMD_SEND_CODE
+bool CmdFBXWorker_Start();
+void CmdFBXWorker_Stop();
+bool CmdFBXWorker_IsRunning();
+
+//! queue all snapshots first and then wait for them, results is an optional array of count elements
+bool CmdMakeSnapshotFBX_SendBatch(const int count, const char **filenames, const char **uniqueNames, InputModelData **data, const bool ResetXForm, bool *results=nullptr);
+//#endif
+
+//! worker side loop, cmdFBX.exe -worker <queueName>
+int CmdMakeSnapshotFBX_RunWorker(const char *queueName);
\ No newline at end of file
@@ -21,6 +21,8 @@
 
 #define STRING_MAX_LENGTH		128
 
+class InputModelBlobView;
+
 struct Float4 { float x[4]; };
 struct Float2 { float x[2]; };
 
@@ -55,10 +57,6 @@ struct InputModelData
 				indices = nullptr;
 			}
 		}
-
-		size_t		ComputeTotalSize();
-		size_t		CopyToMemory(void *memory);
-		size_t		InitFromMemory(void *memory);
 	};
 
 	std::vector<PolyInfo>	polyInfo;
@@ -108,10 +106,6 @@ struct InputModelData
 			, weight(_weight)
 		{}
 
-		size_t		ComputeTotalSize();
-		size_t		CopyToMemory(void *memory);
-		size_t		InitFromMemory(void *memory);
-
 	};
 
 	struct Cluster
@@ -158,10 +152,6 @@ struct InputModelData
 		{
 			return (strcmp(name, other.name) == 0);
 		}
-
-		size_t		ComputeTotalSize();
-		size_t		CopyToMemory(void *memory);
-		size_t		InitFromMemory(void *memory);
 	};
 
 	// rlbond's magic comparator
@@ -208,6 +198,7 @@ struct InputModelData
 		sprintf_s( baseModelName, sizeof(char)*128, "%s", name );
 	}
 
+	// serialization into the flat relocatable blob (InputModelBlob.h)
 	size_t	ComputeTotalSize();
 
 	void	CopyToMemory(void *memory);
@@ -229,6 +220,12 @@ struct InputModelData
 	\return operation status (success or not)
 */
 bool MakeSnapshotFBX(const char *filename, const char *uniqueName, InputModelData &data, const bool ResetXForm);
+//! same snapshot from a flat blob read in place (shared memory job)
+bool MakeSnapshotFBX(const char *filename, const char *uniqueName, const InputModelBlobView &data, const bool ResetXForm);
+
+//! keep FBX SDK manager alive between MakeSnapshotFBX calls (persistent cmdFBX worker)
+bool InitSnapshotFBX();
+void FreeSnapshotFBX();
 
 
 /*
@@ -0,0 +1,228 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: FaceTrackingReader.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+	2d facial tracking data reader, no SDK dependency
+
+	supported exports
+	 - CLM / OpenFace points text, "frame success x_0 .. x_n y_0 .. y_n" space separated
+	 - OpenFace landmarks_2d csv with a header line, decimal comma exports are detected
+	 - Mocha shape data, every vertex is a point and two tangents
+	 - Faceware Analyzer xml, landmarks are matched by name between frames
+
+	file is memory mapped and split into chunks (lines or <frame> elements) that are parsed in parallel
+	 with a fast number parser. Every landmark is stored as 2 contiguous float columns (u, v) with
+	 one row per frame, NaN is a missing sample. Values are kept as they are in the file, units
+	 (pixels or texture coords) are converted by the importer.
+*/
+
+enum EFaceTrackingFormat
+{
+	eFaceTrackingUnknown,
+	eFaceTrackingPoints,		// CLM / OpenFace points text
+	eFaceTrackingOpenFace2d,	// OpenFace csv
+	eFaceTrackingMochaShape,	// Mocha shape data
+	eFaceTrackingFaceware		// Faceware Analyzer xml
+};
+
+//////////////////////////////////////////////
+//! parsed tracking data, columnar storage
+class FaceTrackingData
+{
+public:
+
+	//! a constructor
+	FaceTrackingData();
+
+	//! free all reader allocated data
+	void FreeData();
+
+	//! format by the file extension, then by the first bytes of the file
+	static EFaceTrackingFormat DetectFormat(const char *pFileName);
+
+	//! read information from a tracking export
+	/*!
+		\param pFileName - source file
+		\param format - eFaceTrackingUnknown to detect
+		\param numberOfPoints - points format only, 0 to compute from the first line
+		\param numberOfThreads - 0 for hardware concurrency
+	*/
+	bool Read(const char *pFileName, EFaceTrackingFormat format=eFaceTrackingUnknown, const int numberOfPoints=0, const int numberOfThreads=0);
+
+	//! the same as Read on a text in memory, data doesn't need a null terminator
+	bool Parse(const char *data, const size_t size, const EFaceTrackingFormat format, const int numberOfPoints=0, const int numberOfThreads=0);
+
+	EFaceTrackingFormat GetFormat() const { return mFormat; }
+	const char *GetLastError() const { return mLastError.c_str(); }
+
+	int GetNumberOfLandmarks() const { return (int) mNames.size(); }
+	int GetNumberOfRows() const { return mRowCount; }
+
+	//! landmark name, "" for points and csv formats
+	const char *GetLandmarkName(const int landmark) const { return mNames[landmark].c_str(); }
+	//! Mocha shape name or Faceware markup group
+	const char *GetLandmarkGroup(const int landmark) const { return mGroups[landmark].c_str(); }
+
+	//! frame number of the row
+	int GetRowFrame(const int row) const { return mFrames[row]; }
+	int GetFirstFrame() const { return (mRowCount > 0) ? mFrames[0] : 0; }
+
+	//! contiguous column of landmark values, axis 0 - u, 1 - v
+	const float *GetColumn(const int landmark, const int axis) const
+	{
+		return mColumns.data() + ((size_t) landmark * 2 + axis) * mRowCount;
+	}
+
+	bool IsPresent(const int landmark, const int row) const
+	{
+		const float value = GetColumn(landmark, 0)[row];
+		return value == value;
+	}
+
+	// Faceware meta data, 0 when the file has no meta
+	int GetSourceWidth() const { return mSourceWidth; }
+	int GetSourceHeight() const { return mSourceHeight; }
+	double GetFrameRate() const { return mFrameRate; }
+
+protected:
+
+	EFaceTrackingFormat		mFormat;
+	std::string				mLastError;
+
+	int						mRowCount;
+	std::vector<int>		mFrames;		// frame number per row
+	std::vector<float>		mColumns;		// [landmark][axis][row]
+
+	std::vector<std::string>	mNames;
+	std::vector<std::string>	mGroups;
+
+	int						mSourceWidth;
+	int						mSourceHeight;
+	double					mFrameRate;
+
+	bool ParsePoints(const char *data, const size_t size, const int numberOfPoints, const int numberOfThreads);
+	bool ParseOpenFace2d(const char *data, const size_t size, const int numberOfThreads);
+	bool ParseMochaShape(const char *data, const size_t size, const int numberOfThreads);
+	bool ParseFaceware(const char *data, const size_t size, const int numberOfThreads);
+
+	// allocate columns, all samples are missing
+	void AllocColumns(const int numberOfLandmarks, const int numberOfRows);
+};
+
+//////////////////////////////////////////////
+//! parse files ahead on worker threads, results are handed out in the input order
+/*!
+	scene import and save have to stay on the main thread, so the caller takes items one by one
+	 with Next while workers parse the files after it. Look ahead limits the number of parsed files
+	 in memory, an item is freed on the next call of Next.
+*/
+class FaceTrackingBatchQueue
+{
+public:
+
+	struct Item
+	{
+		std::string			srcPath;
+		FaceTrackingData	data;
+		bool				done;		// worker has finished with the file
+		bool				result;
+		double				parseMs;
+	};
+
+	//! a constructor
+	FaceTrackingBatchQueue();
+	//! a destructor
+	~FaceTrackingBatchQueue();
+
+	/*!
+		\param files - source files in the processing order
+		\param lookAhead - number of parsed files waiting for the main thread
+	*/
+	void Start(const std::vector<std::string> &files, const EFaceTrackingFormat format, const int numberOfPoints,
+		const int numberOfThreads=0, const int lookAhead=4);
+	// wait for the workers, not taken items are dropped
+	void Stop();
+
+	//! blocks until the next file is parsed, nullptr when all files are taken
+	Item *Next();
+
+	//! source files which don't have an output with the same name (without extension, case insensitive)
+	static void CollectPending(const std::vector<std::string> &srcFiles, const std::vector<std::string> &dstFiles,
+		std::vector<std::string> &pending, std::vector<std::string> &skipped);
+
+	//! file name without a folder and extension
+	static std::string GetBaseName(const char *path);
+
+protected:
+
+	std::vector<Item>			mItems;
+	std::vector<std::thread>	mThreads;
+
+	std::mutex					mMutex;
+	std::condition_variable		mCondition;
+
+	int							mNextToParse;
+	int							mNextToTake;
+	int							mLookAhead;
+	bool						mStop;
+
+	EFaceTrackingFormat			mFormat;
+	int							mNumberOfPoints;
+	int							mInnerThreads;		// threads of one file parser
+
+	void WorkerFunc();
+};
+
+//////////////////////////////////////////////
+//! per file result of a batch conversion
+struct FaceTrackingReportEntry
+{
+	std::string		srcPath;
+	std::string		dstPath;
+	std::string		status;			// done, skipped, failed
+	std::string		error;
+
+	int				numberOfRows;
+	int				numberOfLandmarks;
+
+	double			parseMs;
+	double			importMs;		// scene import and save on the main thread
+
+	//! a constructor
+	FaceTrackingReportEntry()
+		: numberOfRows(0)
+		, numberOfLandmarks(0)
+		, parseMs(0.0)
+		, importMs(0.0)
+	{}
+};
+
+bool FaceTrackingWriteReport(const char *filename, const std::vector<FaceTrackingReportEntry> &entries);
+void FaceTrackingPrintReport(const std::vector<FaceTrackingReportEntry> &entries, const double totalMs);
+
+//! synthetic exports of the given length in every format, line by line atof reader against the parallel parser
+/*!
+	\param hours - length of the tracking take
+	\param frameRate - frames per second
+	\param numberOfLandmarks - landmarks per frame, 68 for CLM / OpenFace
+*/
+void FaceTrackingBenchmark(const double hours, const double frameRate, const int numberOfLandmarks, const int numberOfThreads=0);
@@ -0,0 +1,146 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: FastNumberParser.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <math.h>
+
+//
+// locale independent number parsing for big text exports (csv, tracking data)
+//	works on a [p; end) range without null terminator, returns pointer after the parsed number
+//	or nullptr when there is no number in the current position (empty field)
+//
+
+inline const char *SkipSpaces(const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		++p;
+	return p;
+}
+
+inline const char *ParseInt(const char *p, const char *end, int &value)
+{
+	p = SkipSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	const char *start = p;
+	int result = 0;
+	while (p < end && *p >= '0' && *p <= '9')
+	{
+		result = result * 10 + (*p - '0');
+		++p;
+	}
+
+	if (p == start)
+		return nullptr;
+
+	value = (negative) ? -result : result;
+	return p;
+}
+
+inline const char *ParseDouble(const char *p, const char *end, double &value)
+{
+	static const double powersOf10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	p = SkipSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	bool hasDigits = false;
+
+	// integer part, digits after 19 are only counted in the exponent
+	while (p < end && *p >= '0' && *p <= '9')
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa > 0) ++digits;
+		}
+		else
+		{
+			++exponent;
+		}
+		hasDigits = true;
+		++p;
+	}
+
+	if (p < end && *p == '.')
+	{
+		++p;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				--exponent;
+				if (mantissa > 0) ++digits;
+			}
+			hasDigits = true;
+			++p;
+		}
+	}
+
+	if (false == hasDigits)
+		return nullptr;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		int expValue = 0;
+		const char *expEnd = ParseInt(p+1, end, expValue);
+		if (expEnd)
+		{
+			exponent += expValue;
+			p = expEnd;
+		}
+	}
+
+	double result = (double) mantissa;
+	if (exponent < 0)
+	{
+		result = (exponent >= -22) ? result / powersOf10[-exponent] : result * pow(10.0, exponent);
+	}
+	else if (exponent > 0)
+	{
+		result = (exponent <= 22) ? result * powersOf10[exponent] : result * pow(10.0, exponent);
+	}
+
+	value = (negative) ? -result : result;
+	return p;
+}
+
+// move to the next field after the separator, or to the end of line
+inline const char *SkipField(const char *p, const char *end, const char separator=',')
+{
+	while (p < end && *p != separator && *p != '\n')
+		++p;
+	if (p < end && *p == separator)
+		++p;
+	return p;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: InputModelBlob.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FBXUtils.h"
+
+/*
+	Flat transfer format for InputModelData
+
+	one relocatable block - header, array table and flat arrays. Every array is stored as
+	 an offset from the beginning of the block, so the block can be mapped at any address
+	 and read in place (shared memory, file) without per polygon or per cluster allocation.
+
+	polygons are stored as a prefix array of offsets (polyCount + 1 values) into a flat index array,
+	clusters as fixed size records plus a prefix array into flat vertex index and weight arrays.
+*/
+
+#define INPUT_MODEL_BLOB_MAGIC		0x424D4E49	// "INMB"
+#define INPUT_MODEL_BLOB_VERSION	1
+#define INPUT_MODEL_BLOB_ALIGN		16
+
+enum EInputModelBlobArray
+{
+	eBlobPositions,				// Float4
+	eBlobMaterialIndices,		// int
+	eBlobPolyMaterials,			// int, material id per polygon
+	eBlobPolyOffsets,			// int, polyCount + 1 prefix offsets into eBlobPolyIndices
+	eBlobPolyIndices,			// int
+	eBlobNormalsDirect,			// Float4
+	eBlobNormalIndices,			// int
+	eBlobUVs,					// Float2
+	eBlobUVIndices,				// int
+	eBlobClusters,				// InputModelBlobCluster
+	eBlobClusterOffsets,		// int, clusterCount + 1 prefix offsets into cluster vertices
+	eBlobClusterVertIndices,	// int
+	eBlobClusterVertWeights,	// float
+	eBlobArrayCount
+};
+
+struct InputModelBlobArray
+{
+	uint64_t		offset;		// from the beginning of the block
+	uint64_t		count;		// number of elements
+};
+
+struct InputModelBlobHeader
+{
+	uint32_t		magic;
+	uint32_t		version;
+	uint64_t		totalSize;
+
+	int32_t			materialMapping;
+	int32_t			normalMapping;
+	int32_t			normalReferenceMode;
+	int32_t			uvSetMapping;
+	int32_t			uvSetReferenceMode;
+	int32_t			reserved;
+
+	double			LclPosition[3];
+	double			LclRotation[3];
+	double			LclScaling[3];
+	double			snapshotTime;
+
+	char			uvSetName[STRING_MAX_LENGTH];
+	char			baseModelName[STRING_MAX_LENGTH];
+
+	InputModelBlobArray	arrays[eBlobArrayCount];
+};
+
+struct InputModelBlobCluster
+{
+	char			name[STRING_MAX_LENGTH];
+	char			modelname[STRING_MAX_LENGTH];
+
+	int32_t			parent;
+	int32_t			mode;
+
+	double			LclPosition[3];
+	double			LclRotation[3];
+	double			LclScaling[3];
+
+	double			LinkPosition[3];
+	double			LinkRotation[3];
+	double			LinkScaling[3];
+};
+
+//////////////////////////////////////////////////////////////////
+//! read-only access to a blob in place
+
+class InputModelBlobView
+{
+public:
+
+	//! a constructor
+	InputModelBlobView();
+
+	//! check header, array bounds and prefix arrays, size 0 means trust header totalSize
+	bool Attach(const void *memory, const size_t size=0);
+	void Detach();
+
+	bool IsValid() const { return mHeader != nullptr; }
+	const InputModelBlobHeader *GetHeader() const { return mHeader; }
+
+	int GetCount(const EInputModelBlobArray index) const {
+		return (int) mHeader->arrays[index].count;
+	}
+
+	template<typename T>
+	const T *GetArray(const EInputModelBlobArray index) const {
+		return (const T*) (mData + mHeader->arrays[index].offset);
+	}
+
+	int GetPositionCount() const { return GetCount(eBlobPositions); }
+	const Float4 *GetPositions() const { return GetArray<Float4>(eBlobPositions); }
+
+	// polygons
+
+	int GetPolyCount() const { return GetCount(eBlobPolyMaterials); }
+	int GetPolyMaterial(const int poly) const { return GetArray<int>(eBlobPolyMaterials)[poly]; }
+	int GetPolyVertexCount(const int poly) const {
+		const int *offsets = GetArray<int>(eBlobPolyOffsets);
+		return offsets[poly+1] - offsets[poly];
+	}
+	const int *GetPolyIndices(const int poly) const {
+		return GetArray<int>(eBlobPolyIndices) + GetArray<int>(eBlobPolyOffsets)[poly];
+	}
+
+	// clusters
+
+	int GetClusterCount() const { return GetCount(eBlobClusters); }
+	const InputModelBlobCluster &GetCluster(const int cluster) const {
+		return GetArray<InputModelBlobCluster>(eBlobClusters)[cluster];
+	}
+	int GetClusterVertexCount(const int cluster) const {
+		const int *offsets = GetArray<int>(eBlobClusterOffsets);
+		return offsets[cluster+1] - offsets[cluster];
+	}
+	const int *GetClusterVertexIndices(const int cluster) const {
+		return GetArray<int>(eBlobClusterVertIndices) + GetArray<int>(eBlobClusterOffsets)[cluster];
+	}
+	const float *GetClusterVertexWeights(const int cluster) const {
+		return GetArray<float>(eBlobClusterVertWeights) + GetArray<int>(eBlobClusterOffsets)[cluster];
+	}
+
+protected:
+
+	const unsigned char				*mData;
+	const InputModelBlobHeader		*mHeader;
+};
+
+//////////////////////////////////////////////////////////////////
+// conversion from/to InputModelData
+
+size_t ComputeInputModelBlobSize(const InputModelData &data);
+
+//! write the blob, returns number of written bytes or 0 if capacity is not enough
+size_t WriteInputModelBlob(const InputModelData &data, void *memory, const size_t capacity);
+
+//! unpack a blob into the editable structure (allocates polygons and clusters)
+bool ReadInputModelBlob(const InputModelBlobView &view, InputModelData &data);
+
+//////////////////////////////////////////////////////////////////
+// checks on synthetic models, no SDK involved
+
+//! round trip through a moved block, unpack and repack, broken blocks are rejected, false on a mismatch
+bool InputModelBlobSelfTest();
+
+//! legacy receive (unpack into InputModelData and repack) against an in place view, prints results into the log
+void InputModelBlobBenchmark(const int gridSize, const int numberOfRepeats);
@@ -0,0 +1,64 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: MappedFile.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// read-only memory mapped file (win32 file mapping or posix mmap), no SDK dependency
+//
+
+class MappedFile
+{
+public:
+
+	//! a constructor
+	MappedFile();
+	//! a destructor
+	~MappedFile();
+
+	bool Open(const char *filename);
+	void Close();
+
+	bool IsOpen() const {
+		return mData != nullptr;
+	}
+
+	const char *GetData() const {
+		return mData;
+	}
+	size_t GetSize() const {
+		return mSize;
+	}
+
+	// file size and last write time, used to validate cache files against the source
+	static bool GetFileStamp(const char *filename, uint64_t &size, int64_t &writeTime);
+
+protected:
+
+	const char		*mData;
+	size_t			mSize;
+
+#ifdef _WIN32
+	void			*mFile;
+	void			*mMapping;
+#else
+	int				mFile;
+#endif
+
+private:
+	// no copy
+	MappedFile(const MappedFile &);
+	void operator = (const MappedFile &);
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: SharedJobQueue.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <functional>
+
+/*
+	Job queue between a host process and a long-lived worker process
+
+	shared memory block is a header and a ring of fixed size slots. Each slot carries a small
+	job header (two strings, flags, result) and a payload. Slot state moves
+	free -> pending -> processing -> done/failed -> free, pending jobs and completions are
+	signalled with two named semaphores.
+
+	Win32 backend uses named file mapping and semaphores, posix backend uses shm_open and sem_open,
+	so the protocol can be run on linux with a stand-in worker.
+
+	Host never attaches to objects which already exist and never unlinks a name it has not created,
+	a queue name is unique per host (process id and a counter) and goes to the worker command line.
+*/
+
+#define SHARED_JOB_STRING_LENGTH		260
+
+enum ESharedJobState
+{
+	eSharedJobFree = 0,
+	eSharedJobWriting,		// host fills the payload
+	eSharedJobPending,
+	eSharedJobProcessing,
+	eSharedJobDone,
+	eSharedJobFailed
+};
+
+enum ESharedJobResult
+{
+	eSharedJobResultDone = 0,
+	eSharedJobResultFailed,
+	eSharedJobResultTimeout,
+	eSharedJobResultLost		// wrong job id or queue is not running
+};
+
+struct SharedJobQueueHeader
+{
+	uint32_t				magic;
+	uint32_t				version;
+	uint32_t				slotCount;
+	uint32_t				hostPid;		// worker quits when the host process is gone
+	uint64_t				slotSize;		// payload capacity of one slot
+
+	std::atomic<uint32_t>	shutdown;		// host asks worker to quit
+	std::atomic<uint32_t>	workerReady;	// worker has finished its initialization
+	std::atomic<uint64_t>	heartbeat;		// worker loop counter
+};
+
+struct SharedJobSlot
+{
+	std::atomic<uint32_t>	state;
+	uint32_t				jobId;
+	uint32_t				flags;
+	int32_t					resultCode;
+	uint32_t				attempts;		// how many times worker took this job
+	uint32_t				reserved;
+	uint64_t				payloadSize;
+
+	char					name0[SHARED_JOB_STRING_LENGTH];
+	char					name1[SHARED_JOB_STRING_LENGTH];
+};
+
+//////////////////////////////////////////////////////////////////
+// platform primitives
+
+class SharedMemoryBlock
+{
+public:
+	//! a constructor
+	SharedMemoryBlock();
+	//! a destructor
+	~SharedMemoryBlock();
+
+	// false when a block with that name already exists
+	bool Create(const char *name, const size_t size);
+	bool Open(const char *name);
+	void Close();
+
+	void *GetData() const { return mData; }
+	size_t GetSize() const { return mSize; }
+
+protected:
+	void			*mData;
+	size_t			mSize;
+	bool			mOwner;
+	std::string		mName;
+#ifdef _WIN32
+	void			*mHandle;
+#endif
+};
+
+class NamedSemaphore
+{
+public:
+	//! a constructor
+	NamedSemaphore();
+	//! a destructor
+	~NamedSemaphore();
+
+	// false when a semaphore with that name already exists
+	bool Create(const char *name);
+	bool Open(const char *name);
+	void Close();
+
+	void Post();
+	// false on timeout
+	bool Wait(const int timeoutMs);
+
+protected:
+	void			*mHandle;
+	bool			mOwner;
+	std::string		mName;
+};
+
+class WorkerProcess
+{
+public:
+	//! a constructor
+	WorkerProcess();
+	//! a destructor
+	~WorkerProcess();
+
+	// arguments[0] is an executable path
+	bool Launch(const std::vector<std::string> &arguments);
+	bool IsAlive();
+	void Terminate();
+	// wait for a process exit, false on timeout
+	bool WaitForExit(const int timeoutMs);
+
+	static uint32_t GetCurrentId();
+	static bool IsAlive(const uint32_t pid);
+
+protected:
+#ifdef _WIN32
+	void			*mProcess;
+#else
+	int				mPid;
+#endif
+};
+
+//////////////////////////////////////////////////////////////////
+// SharedJobQueue - memory layout and slot protocol, used by both sides
+
+class SharedJobQueue
+{
+public:
+
+	//! a constructor
+	SharedJobQueue();
+
+	// host side, creates memory and semaphores
+	bool Create(const char *name, const int slotCount, const size_t slotSize);
+	// worker side
+	bool Open(const char *name);
+	void Close();
+
+	bool IsOpen() const { return mHeader != nullptr; }
+
+	SharedJobQueueHeader *GetHeader() const { return mHeader; }
+	int GetSlotCount() const { return (mHeader) ? (int) mHeader->slotCount : 0; }
+	size_t GetSlotSize() const { return (mHeader) ? (size_t) mHeader->slotSize : 0; }
+
+	SharedJobSlot *GetSlot(const int index) const;
+	void *GetPayload(const int index) const;
+
+	//
+	// host
+
+	// take a free slot for writing, -1 if all slots are busy
+	int AcquireSlot();
+	// slot is filled, let worker know about it
+	void Submit(const int index);
+	// wait for any completion signal
+	bool WaitCompletion(const int timeoutMs);
+	void ReleaseSlot(const int index);
+	// put back jobs interrupted by a worker crash, returns number of requeued jobs
+	int RequeueInterrupted(const uint32_t maxAttempts);
+
+	//
+	// worker
+
+	// wait for pending job and take it, -1 on timeout or shutdown
+	int TakeJob(const int timeoutMs);
+	void CompleteJob(const int index, const bool success, const int resultCode);
+
+	static std::string MakeObjectName(const char *name, const char *suffix);
+	// prefix_<process id>_<counter>, a different name for every call in a process
+	static std::string MakeUniqueName(const char *prefix);
+
+protected:
+
+	SharedMemoryBlock		mMemory;
+	NamedSemaphore			mJobsSemaphore;
+	NamedSemaphore			mDoneSemaphore;
+
+	SharedJobQueueHeader	*mHeader;
+	unsigned char			*mSlots;
+	size_t					mSlotStride;
+};
+
+//////////////////////////////////////////////////////////////////
+// PersistentWorkerQueue - host side, keeps a worker process alive and restarts it after a crash
+
+class PersistentWorkerQueue
+{
+public:
+
+	// fill payload, return number of written bytes or 0 if data doesn't fit into capacity
+	typedef std::function<size_t (void *payload, const size_t capacity)>	PayloadWriter;
+
+	struct Stats
+	{
+		int		submitted;
+		int		completed;
+		int		failed;
+		int		timeouts;
+		int		restarts;
+	};
+
+	//! a constructor
+	PersistentWorkerQueue();
+	//! a destructor
+	~PersistentWorkerQueue();
+
+	// worker is launched with "arguments... -worker <name>", a taken name is retried with a suffix
+	bool Start(const char *name, const std::vector<std::string> &arguments, const int slotCount, const size_t slotSize, const int startTimeoutMs);
+	void Stop();
+
+	bool IsRunning() const { return mRunning; }
+	// name of the created queue, the one passed to the worker
+	const char *GetName() const { return mName.c_str(); }
+	size_t GetSlotSize() const { return mQueue.GetSlotSize(); }
+
+	// returns job id or 0 if the job can't be queued (no free slot in time or payload too big)
+	uint32_t Submit(const char *name0, const char *name1, const uint32_t flags, const PayloadWriter &writer, const int timeoutMs);
+	// wait for a job, the job slot is released after this call
+	ESharedJobResult Wait(const uint32_t jobId, const int timeoutMs, int *resultCode=nullptr);
+
+	const Stats &GetStats() const { return mStats; }
+
+protected:
+
+	std::string					mName;
+	std::vector<std::string>	mArguments;
+
+	SharedJobQueue				mQueue;
+	WorkerProcess				mProcess;
+
+	bool						mRunning;
+	uint32_t					mNextJobId;
+	int							mStartTimeoutMs;
+
+	Stats						mStats;
+
+	bool LaunchWorker();
+	// check worker process, restart it and requeue interrupted jobs
+	bool CheckWorker();
+	bool RestartWorker();
+	int FindJobSlot(const uint32_t jobId) const;
+};
+
+//////////////////////////////////////////////////////////////////
+// worker side loop
+
+// handler returns true on success, resultCode is passed back to the host
+typedef std::function<bool (const SharedJobSlot &slot, const void *payload, int &resultCode)>	SharedJobHandler;
+
+// process jobs until the host asks for shutdown or the host is gone
+int RunSharedJobWorker(const char *name, const SharedJobHandler &handler);
+
+//////////////////////////////////////////////////////////////////
+// stand-in worker, checks the protocol without cmdFBX and FBX SDK
+
+// stand-in job flags, first 4 bytes of a payload are a sleep time in ms
+#define SHARED_JOB_STANDIN_SLEEP		1		// sleep before the job is done
+#define SHARED_JOB_STANDIN_CRASH_ONCE	2		// exit the worker process on the first attempt of the job
+#define SHARED_JOB_STANDIN_CRASH		4		// exit the worker process on every attempt
+#define SHARED_JOB_STANDIN_FAIL			8		// report a failed job
+
+// result code of a stand-in job, the host compares it with its own payload
+int SharedJobPayloadChecksum(const void *payload, const size_t size);
+
+// worker loop with a stand-in handler
+int RunSharedJobStandInWorker(const char *name);
+
+//! completion, failure, hung job timeout and restart after a crash with a stand-in worker, false on a mismatch
+//!	\param arguments - command line which runs RunSharedJobStandInWorker, "-worker <name>" is added to it
+bool SharedJobQueueSelfTest(const std::vector<std::string> &arguments);
+
+//! a worker process per job against one persistent worker, prints results into the log
+void SharedJobQueueBenchmark(const std::vector<std::string> &arguments, const int numberOfJobs, const size_t payloadSize);
@@ -0,0 +1,105 @@
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: CurveProximity.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//--- SDK include
+#include <fbsdk/fbsdk.h>
+#include <vector>
+
+/*!
+ * CurveProximityIndex
+ *
+ * closest point on a 3d path queries without evaluating the path for every query.
+ *	The path is sampled once into hermite spans (position + derivative at each sample),
+ *	spans are grouped into bounded segments and segments are stored in a BVH.
+ *	Query goes coarse-to-fine: BVH traversal with distance pruning, then Newton iterations
+ *	on the hermite span that is closest to the point.
+*/
+
+struct CurveProximityResult
+{
+	double		percent;		// path percent [0; 100], the same units as FindClosestPointOnCurve
+	double		distance;		// distance from the query point to the curve
+	FBVector3d	point;			// closest point on a curve (global space)
+	FBVector3d	tangent;		// normalized curve tangent in the closest point
+};
+
+class CurveProximityIndex
+{
+public:
+
+	//! a constructor
+	CurveProximityIndex();
+
+	void Clear();
+
+	// sample path in global space, numberOfSegments * spansPerSegment hermite spans in total
+	bool Build( FBModelPath3D *pCurve, const int numberOfSegments, const int spansPerSegment );
+	// build from already sampled global positions (count * 3 doubles, uniform step in path percent),
+	//	span derivatives are taken from neighbour samples (catmull-rom)
+	bool Build( const int numberOfSamples, const double *positions, const int spansPerSegment );
+
+	bool IsEmpty() const {
+		return mNodes.size() == 0;
+	}
+
+	// single point query
+	bool Query( const double *pos, CurveProximityResult &result ) const;
+
+	// batch query, positions array is count * stride doubles (stride 3 for FBVector3d, 4 for FBVector4d)
+	//	queries are split between worker threads
+	void QueryBatch( const int count, const double *positions, const int stride, CurveProximityResult *results, const int numberOfThreads=0 ) const;
+
+protected:
+
+	struct Span
+	{
+		double		p0[3];
+		double		m0[3];		// tangents in span parameter space
+		double		p1[3];
+		double		m1[3];
+		double		percent0;
+		double		percent1;
+	};
+
+	struct Segment
+	{
+		double		bbMin[3];
+		double		bbMax[3];
+		int			firstSpan;
+		int			spanCount;
+	};
+
+	struct Node
+	{
+		double		bbMin[3];
+		double		bbMax[3];
+		int			left;		// child node index, -1 for a leaf
+		int			right;
+		int			firstSegment;
+		int			segmentCount;
+	};
+
+	std::vector<Span>		mSpans;
+	std::vector<Segment>	mSegments;
+	std::vector<int>		mSegmentOrder;	// segments indices sorted by BVH leaves
+	std::vector<Node>		mNodes;
+	int						mMaxDepth;		// deepest level of the tree, root is 0
+
+	int BuildNode( const int first, const int count, const int depth );
+	void SpanClosestPoint( const Span &span, const double *pos, double &t, double &distSq ) const;
+};
+
+// compare brute force FindClosestPointOnCurve with CurveProximityIndex, print timings and max error into the log
+void CurveProximityBenchmark( FBModelPath3D *pCurve, const int numberOfQueries, const int numberOfSubdivisions, const int segmentSubdivisions );
@@ -0,0 +1,127 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: GroundProjection.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+/*
+	Ground projection of objects onto ground meshes
+
+	triangles of all ground meshes are put into one world space BVH (binned SAH) once per operation.
+	 Every object casts a grid of vertical rays (footprint) over its bounding box, from the box top
+	 down to the ground. Object rests on the highest hit, so it doesn't sink into a slope, or on a
+	 best-fit contact plane of all hits when alignment is requested.
+
+	Objects are processed in batch on ParallelFor, no SDK dependency so it can be run on a synthetic terrain.
+*/
+
+struct GroundRayHit
+{
+	double		t;				// distance along the ray
+	double		pos[3];
+	double		normal[3];		// geometric normal, faces the ray origin
+	int			triangle;
+};
+
+struct GroundProjectionOptions
+{
+	int			footprintX;			// rays along x and z of an object bounding box
+	int			footprintZ;
+	double		maxDistance;		// from the box top down
+	bool		fitPlane;			// least squares contact plane for an alignment
+	int			numberOfThreads;	// 0 for hardware concurrency
+
+	//! a constructor
+	GroundProjectionOptions()
+		: footprintX(3)
+		, footprintZ(3)
+		, maxDistance(100000.0)
+		, fitPlane(false)
+		, numberOfThreads(0)
+	{}
+};
+
+struct GroundProjectionResult
+{
+	bool		hit;
+	int			numberOfHits;
+	double		offset;			// move an object by this value along y to put the box bottom onto the ground, unrotated box
+	double		contact[3];		// contact point under the box bottom center
+	double		normal[3];		// contact plane normal, (0, 1, 0) without a plane fit
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class GroundProjectionBVH
+{
+public:
+
+	//! a constructor
+	GroundProjectionBVH();
+
+	void Clear();
+
+	//! add triangles in a world space
+	/*!
+		\param positions - numberOfVertices * stride floats, xyz go first
+		\param indices - numberOfTriangles * 3
+		\param matrix - local to world, column major, nullptr for identity
+	*/
+	void AddMesh(const float *positions, const int numberOfVertices, const int stride,
+		const int *indices, const int numberOfTriangles, const double *matrix);
+
+	void Build();
+
+	bool IsEmpty() const { return mNodes.size() == 0; }
+	int GetNumberOfTriangles() const { return (int) mTriangles.size(); }
+	int GetNumberOfNodes() const { return (int) mNodes.size(); }
+
+	void GetBounds(double *bmin, double *bmax) const;
+
+	//! closest hit along the ray in [0; maxT], dir doesn't need to be normalized, t is in dir units
+	bool RayCast(const double *origin, const double *dir, const double maxT, GroundRayHit &hit) const;
+
+protected:
+
+	struct Triangle
+	{
+		float		v0[3];
+		float		e1[3];		// v1 - v0
+		float		e2[3];		// v2 - v0
+	};
+
+	struct Node
+	{
+		float		bbMin[3];
+		float		bbMax[3];
+		int			first;		// first triangle for a leaf, right child for an inner node
+		int			count;		// 0 for an inner node, left child goes next to the node
+	};
+
+	std::vector<Triangle>	mTriangles;
+	std::vector<Node>		mNodes;
+
+	// triangle order is sorted by leaves, centroids and bounds are per triangle
+	int BuildNode(const int first, const int count, std::vector<int> &order, const std::vector<float> &centroids, const std::vector<float> &bounds);
+};
+
+//! project objects onto the ground, one result per object bounding box (world space, min and max xyz)
+void GroundProjectBatch(const GroundProjectionBVH &bvh, const int numberOfObjects, const double *boxes,
+	const GroundProjectionOptions &options, GroundProjectionResult *results);
+
+//! synthetic terrain, objects are projected and compared with the terrain height function, false on a mismatch
+bool GroundProjectionSelfTest();
+
+//! synthetic terrain of a given resolution, print BVH build time and rays per second into the log
+void GroundProjectionBenchmark(const int terrainResolution, const int numberOfObjects, const int numberOfThreads=0);
@@ -0,0 +1,77 @@
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParallelFor.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+//
+// split [0; count) range into chunks of grainSize elements and process them on worker threads
+//	func signature - void (const int first, const int last), last is exclusive
+//	the calling thread takes part in the work, so numberOfThreads == 1 runs in place
+//
+
+inline int ParallelForThreadCount(const int numberOfThreads=0)
+{
+	if (numberOfThreads > 0)
+		return numberOfThreads;
+
+	int hw = (int) std::thread::hardware_concurrency();
+	return (hw > 0) ? hw : 1;
+}
+
+template<typename Func>
+void ParallelFor(const int count, const int grainSize, Func func, const int numberOfThreads=0)
+{
+	if (count <= 0)
+		return;
+
+	const int grain = (grainSize > 0) ? grainSize : 1;
+	const int numberOfChunks = (count + grain - 1) / grain;
+	const int numberOfWorkers = std::min( ParallelForThreadCount(numberOfThreads), numberOfChunks );
+
+	if (numberOfWorkers <= 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	std::atomic<int>	nextChunk(0);
+
+	auto worker = [&] () {
+		for (;;)
+		{
+			const int chunk = nextChunk.fetch_add(1);
+			if (chunk >= numberOfChunks)
+				break;
+
+			const int first = chunk * grain;
+			const int last = std::min(first + grain, count);
+			func(first, last);
+		}
+	};
+
+	std::vector<std::thread>	threads;
+	threads.reserve(numberOfWorkers-1);
+
+	for (int i=1; i<numberOfWorkers; ++i)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto iter=begin(threads); iter!=end(threads); ++iter)
+		iter->join();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: RBFSolver.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+/*
+	Radial basis function solver for pose space retargeting
+
+	a pose is a pair of an input vector (source marker positions) and an output vector (bone translations).
+	 The first pose is a rest pose, output is the rest output plus a weighted sum of kernels of the distances
+	 from the input to every pose input. Kernel is positive definite, so the kernel matrix is factorized with
+	 Cholesky once when poses or options change.
+
+	Weights are stored output major, a frame is numberOfPoses kernels and one dense matrix-vector
+	 product for all the outputs. Frames of a take are evaluated in batch on ParallelFor.
+*/
+
+#define RBF_SOLVER_MAX_POSES		256
+
+// inverse multiquadric is less sensitive to the radius, gaussian gives more local poses
+enum ERBFKernel
+{
+	eRBFKernelGaussian,
+	eRBFKernelInverseMultiquadric
+};
+
+struct RBFSolverOptions
+{
+	ERBFKernel		kernel;
+	double			radiusScale;		// kernel radius is the scale of a mean distance to the nearest pose
+	double			regularization;		// added to the kernel matrix diagonal, smooths noisy poses
+
+	//! a constructor
+	RBFSolverOptions()
+		: kernel(eRBFKernelInverseMultiquadric)
+		, radiusScale(2.0)
+		, regularization(0.0)
+	{}
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class RBFSolver
+{
+public:
+
+	//! a constructor
+	RBFSolver();
+
+	void Clear();
+
+	//! remove poses when dimensions are changed
+	void SetDimensions(const int inputDim, const int outputDim);
+
+	int GetInputDim() const { return mInputDim; }
+	int GetOutputDim() const { return mOutputDim; }
+
+	//! a pose with the same input replaces the output of an existing one, returns the pose index or -1
+	int AddPose(const double *input, const double *output);
+
+	int GetNumberOfPoses() const { return mNumberOfPoses; }
+	const double *GetPoseInput(const int index) const { return &mInputs[index * mInputDim]; }
+	const double *GetPoseOutput(const int index) const { return &mOutputs[index * mOutputDim]; }
+
+	//! factorize the kernel matrix and compute weights
+	bool Train(const RBFSolverOptions &options);
+	bool IsTrained() const { return mTrained; }
+
+	double GetRadius() const { return mRadius; }
+
+	//! kernels is a scratch buffer of numberOfPoses values
+	void Evaluate(const double *input, double *output, double *kernels) const;
+	//! inputs and outputs are numberOfSamples vectors one after another
+	void EvaluateBatch(const int numberOfSamples, const double *inputs, double *outputs, const int numberOfThreads=0) const;
+
+protected:
+
+	int						mInputDim;
+	int						mOutputDim;
+	int						mNumberOfPoses;
+
+	std::vector<double>		mInputs;		// pose major
+	std::vector<double>		mOutputs;
+
+	bool					mTrained;
+	ERBFKernel				mKernel;
+	double					mRadius;
+	double					mInvRadiusSq;
+
+	std::vector<double>		mWeights;		// outputDim x numberOfPoses, row major
+
+	double Kernel(const double distSq) const;
+};
+
+//! in place Cholesky factorization of a symmetric n x n matrix (lower part), false when it's not positive definite
+bool RBFCholeskyFactorize(double *a, const int n);
+//! solve L * Lt * x = b in place of b, a is the factorized matrix
+void RBFCholeskySolve(const double *a, const int n, double *b);
+
+//! synthetic mouth rig, checks exact poses, interpolation error and batch results, prints frames per second
+bool RBFSolverSelfTest(const int numberOfThreads=0);
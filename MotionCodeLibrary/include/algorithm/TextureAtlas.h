@@ -0,0 +1,181 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: TextureAtlas.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+
+/*
+	Texture atlas for combined meshes
+
+	source images (RGBA8) are packed with a MaxRects packer (best short side fit). Every rect
+	 gets a gutter of padding pixels filled with its edge texels, rect size and position are
+	 aligned to a mip block, so a few mip levels don't bleed between neighbours.
+	If sources don't fit into max atlas size, they are downscaled by 2 until they do.
+
+	Resampling runs on ParallelFor, no SDK dependency so it can be tested on synthetic images.
+*/
+
+struct AtlasImage
+{
+	int							width;
+	int							height;
+	std::vector<unsigned char>	pixels;		// RGBA8, row 0 is a bottom row (v == 0), like in OpenGL
+
+	//! a constructor
+	AtlasImage()
+		: width(0)
+		, height(0)
+	{}
+
+	void Init(const int w, const int h)
+	{
+		width = w;
+		height = h;
+		pixels.assign( (size_t) w * h * 4, 0 );
+	}
+};
+
+struct AtlasRect
+{
+	int		x;
+	int		y;
+	int		w;
+	int		h;
+};
+
+//////////////////////////////////////////////////////////////////
+//! MaxRects bin packer, best short side fit
+
+class MaxRectsPacker
+{
+public:
+
+	//! a constructor
+	MaxRectsPacker();
+
+	void Init(const int width, const int height);
+
+	// false if there is no space for the rect
+	bool Insert(const int width, const int height, AtlasRect &rect);
+
+	// used area / bin area
+	double GetOccupancy() const;
+
+protected:
+
+	int						mWidth;
+	int						mHeight;
+
+	std::vector<AtlasRect>	mFreeRects;
+	std::vector<AtlasRect>	mUsedRects;
+
+	void PlaceRect(const AtlasRect &node);
+	bool SplitFreeNode(const AtlasRect &freeNode, const AtlasRect &usedNode);
+	void PruneFreeList();
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+struct TextureAtlasOptions
+{
+	int		maxSize;			// max atlas width and height
+	int		padding;			// gutter around each rect, filled with edge texels
+	int		alignment;			// rect position and size alignment, 4 keeps 2 mip levels separated
+	bool	powerOfTwo;			// power of two atlas size
+	int		numberOfThreads;	// 0 for hardware concurrency
+
+	//! a constructor
+	TextureAtlasOptions()
+		: maxSize(4096)
+		, padding(4)
+		, alignment(4)
+		, powerOfTwo(true)
+		, numberOfThreads(0)
+	{}
+};
+
+struct TextureAtlasEntry
+{
+	int			sourceWidth;
+	int			sourceHeight;
+
+	AtlasRect	rect;			// image content in the atlas, gutter is around it
+
+	// atlas uv = uv * scale + offset
+	float		uvScale[2];
+	float		uvOffset[2];
+};
+
+class TextureAtlas
+{
+public:
+
+	//! a constructor
+	TextureAtlas();
+
+	void Clear();
+
+	//! pack and resample sources into one image, sources could be nullptr (entry is skipped)
+	bool Build(const std::vector<const AtlasImage*> &sources, const TextureAtlasOptions &options);
+
+	const AtlasImage &GetImage() const { return mImage; }
+
+	int GetEntryCount() const { return (int) mEntries.size(); }
+	const TextureAtlasEntry &GetEntry(const int index) const { return mEntries[index]; }
+	bool IsEntryPacked(const int index) const { return mEntries[index].rect.w > 0; }
+
+	// scale factor applied to all sources to fit into max size
+	float GetSourceScale() const { return mSourceScale; }
+
+	// uv in source texture space [0; 1] to atlas space
+	void RemapUV(const int entry, const float u, const float v, float &outU, float &outV) const
+	{
+		const TextureAtlasEntry &e = mEntries[entry];
+		outU = u * e.uvScale[0] + e.uvOffset[0];
+		outV = v * e.uvScale[1] + e.uvOffset[1];
+	}
+
+	//! uncompressed 32 bit tga
+	bool WriteTGA(const char *filename) const;
+	//! text table, one line per entry - name, rect and uv transform
+	bool WriteRemapTable(const char *filename, const std::vector<std::string> &names) const;
+
+protected:
+
+	AtlasImage						mImage;
+	std::vector<TextureAtlasEntry>	mEntries;
+	float							mSourceScale;
+
+	bool Pack(const std::vector<const AtlasImage*> &sources, const TextureAtlasOptions &options, const float scale);
+	void Compose(const std::vector<const AtlasImage*> &sources, const TextureAtlasOptions &options);
+};
+
+//////////////////////////////////////////////////////////////////
+// geometry
+
+struct InputModelData;
+
+//! move uvs of polygons into atlas rects
+/*!
+	uvs are expected in polygon vertex / index to direct layout (as FillInputModelData makes it),
+	every polygon vertex gets its own direct uv after remap. Tiled uvs are shifted per polygon
+	into [0; 1] and clamped, so wrap is not preserved.
+
+	\param materialToEntry - atlas entry for each material id, -1 keeps polygon uvs as they are
+*/
+bool RemapInputModelUVs(InputModelData &data, const TextureAtlas &atlas, const std::vector<int> &materialToEntry);
+
+//! synthetic images and a mesh, checks packing, gutters, downscale and uv remap, false on a mismatch
+bool TextureAtlasSelfTest();
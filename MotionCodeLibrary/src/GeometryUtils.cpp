@@ -15,6 +15,8 @@
 #include "algorithm\math3d_mobu.h"
 #include "ClusterAdvance.h"
 #include "IO\CmdFBX.h"
+#include "algorithm\TextureAtlas.h"
+#include "StringUtils.h"
 
 const char *g_szDefaultUVSet = "DefaultUVSet";
 
@@ -667,38 +669,28 @@ bool DoNeedUniqueName()
 	return ( strstr(szDefault, "true") != nullptr );
 }
 
-FBModel *MakeSnapshot2( FBModel *pModel, const bool ResetXForm, const bool CopyShaders )
+// snapshot geometry of a model at the current time
+static void FillSnapshotData( FBModel *pModel, const FBTime &localTime, InputModelData &data )
 {
-	//
-	//
-
 	FBArrayTemplate<FBMaterial*>	materialList;
 	materialList.SetCount( pModel->Materials.GetCount() );
 	
 	for (int i=0; i<pModel->Materials.GetCount(); ++i)
 		materialList[i] = pModel->Materials[i];
 			
-	//
-	InputModelData data;
-
 	FBModelList modelList;
 	modelList.Add(pModel);
 
 	FillInputModelData( modelList, data, materialList, true, false );
 
-	//
-	//
-	//
-	FBTime localTime = FBSystem::TheOne().LocalTime;
-
-	FBString configPath = FBSystem().TempPath;
-	FBString filename(configPath, "\\model.fbx");
-	
 	//data.baseModelName = pModel->LongName;
 	data.SetBaseModelName( pModel->LongName );
 	data.snapshotTime = localTime.GetSecondDouble();
+}
 
-	// DONE: prepare unique name
+// unique names skip scene models and names which are already taken by a batch (not merged yet)
+static FBString MakeSnapshotName( FBModel *pModel, FBStringList *reservedNames )
+{
 	FBString snapshotName (pModel->LongName, "_Snapshot");
 
 	if (DoNeedUniqueName() )
@@ -715,78 +707,334 @@ FBModel *MakeSnapshot2( FBModel *pModel, const bool ResetXForm, const bool CopyS
 			sprintf_s( text, size_text, "_%.4d", idx );
 			snapshotName = strBase + text;
 
-			if (FBFindModelByLabelName( snapshotName ) == nullptr)
+			if (FBFindModelByLabelName( snapshotName ) == nullptr
+				&& (reservedNames == nullptr || reservedNames->Find( snapshotName ) < 0) )
 				break;
 
 			idx++;
 		}
 	}
 
+	return snapshotName;
+}
+
+// merged snapshot model gets materials, shaders and snapshot properties of the source model
+static FBModel *SetupSnapshotModel( FBModel *pModel, const char *snapshotName, const FBTime &localTime, const bool ResetXForm, const bool CopyShaders )
+{
+	FBModel *pNewModel = FBFindModelByLabelName( snapshotName );
+	if (pNewModel == nullptr)
+		return nullptr;
+
+	for (int i=0; i<pModel->Materials.GetCount(); ++i)
+		pNewModel->Materials.Add( pModel->Materials[i] );
+
+	// copy shader settings
+	if (CopyShaders)
+	{
+		for (int i=0; i<pModel->Shaders.GetCount(); ++i)
+			pNewModel->Shaders.Add( pModel->Shaders[i] );
+	}
+
+	FBProperty *lProp = pNewModel->PropertyCreate( "SnapshotTime", kFBPT_double, ANIMATIONNODE_TYPE_NUMBER, false, true );
+
+	double value = localTime.GetSecondDouble();
+
+	lProp->SetData(&value);
+
+	lProp = pNewModel->PropertyCreate( "BaseModel", kFBPT_charptr, ANIMATIONNODE_TYPE_STRING, false, true );
+	lProp->SetString( pModel->LongName );
+
+	FBMatrix m;
+	pModel->GetMatrix(m);
+
+	//
+	// save TRS in snapshot properties
+	if (ResetXForm == false)
+	{
+		FBTVector	pos;
+		FBRVector	rot;
+		FBSVector	scale;
+
+		FBMatrixToTRS( pos, rot, scale, m );
+
+		lProp = pNewModel->PropertyCreate( "SnapshotPosition", kFBPT_Vector4D, ANIMATIONNODE_TYPE_VECTOR_4, false, true );
+		if (lProp) lProp->SetData( pos );
+
+		lProp = pNewModel->PropertyCreate( "SnapshotRotation", kFBPT_Vector3D, ANIMATIONNODE_TYPE_VECTOR, false, true );
+		if (lProp) lProp->SetData( rot );
+
+		lProp = pNewModel->PropertyCreate( "SnapshotScale", kFBPT_Vector3D, ANIMATIONNODE_TYPE_VECTOR, false, true );
+		if (lProp) lProp->SetData( scale );
+	}
+
+	pNewModel->Selected = true;
+	return pNewModel;
+}
+
+FBModel *MakeSnapshot2( FBModel *pModel, const bool ResetXForm, const bool CopyShaders )
+{
+	FBTime localTime = FBSystem::TheOne().LocalTime;
+
+	//
+	InputModelData data;
+	FillSnapshotData( pModel, localTime, data );
+
+	//
+	//
+	//
+	FBString configPath = FBSystem().TempPath;
+	FBString filename(configPath, "\\model.fbx");
+	
+	// DONE: prepare unique name
+	FBString snapshotName( MakeSnapshotName(pModel, nullptr) );
+
 	if (CmdMakeSnapshotFBX_Send(filename, snapshotName, data, ResetXForm) )
 	{
 		FBApplication::TheOne().FileMerge( filename );
+		SetupSnapshotModel( pModel, snapshotName, localTime, ResetXForm, CopyShaders );
+	}
 
-		FBModel *pNewModel = FBFindModelByLabelName( snapshotName );
-		if (pNewModel)
-		{
-			for (int i=0; i<pModel->Materials.GetCount(); ++i)
-				pNewModel->Materials.Add( pModel->Materials[i] );
+	//
+	// finalyze, import back to mobu a snapshot model
+	//
+	FBPlayerControl::TheOne().Goto( localTime );
 
-			// copy shader settings
-			if (CopyShaders)
-			{
-				for (int i=0; i<pModel->Shaders.GetCount(); ++i)
-					pNewModel->Shaders.Add( pModel->Shaders[i] );
-			}
+	return nullptr;
+}
+
+int MakeSnapshots2( FBModelList &modelList, const int numberOfCopies, const bool ResetXForm, const bool CopyShaders, FBStringList *newNames )
+{
+	const int numberOfModels = modelList.GetCount();
+	const int count = numberOfModels * numberOfCopies;
+
+	if (count <= 0)
+		return 0;
 
-			FBProperty *lProp = pNewModel->PropertyCreate( "SnapshotTime", kFBPT_double, ANIMATIONNODE_TYPE_NUMBER, false, true );
+	FBTime localTime = FBSystem::TheOne().LocalTime;
+	FBString configPath = FBSystem().TempPath;
 
-			double value = localTime.GetSecondDouble();
+	// copies of a model share the same geometry
+	std::vector<InputModelData*>	modelData(numberOfModels, nullptr);
+	for (int i=0; i<numberOfModels; ++i)
+	{
+		modelData[i] = new InputModelData();
+		FillSnapshotData( modelList[i], localTime, *modelData[i] );
+	}
 
-			lProp->SetData(&value);
+	// every job writes its own fbx file, jobs of the batch are in the worker queue at the same time
+	FBStringList	filenames;
+	FBStringList	snapshotNames;
 
-			lProp = pNewModel->PropertyCreate( "BaseModel", kFBPT_charptr, ANIMATIONNODE_TYPE_STRING, false, true );
-			lProp->SetString( pModel->LongName );
+	const int size_text=128;
+	char text[size_text] = "";
 
-			FBMatrix m;
-			pModel->GetMatrix(m);
+	for (int i=0; i<count; ++i)
+	{
+		sprintf_s( text, size_text, "\\model_%.4d.fbx", i );
+		filenames.Add( FBString(configPath, text) );
+		snapshotNames.Add( MakeSnapshotName(modelList[i / numberOfCopies], &snapshotNames) );
+	}
 
-			//
-			// save TRS in snapshot properties
-			if (ResetXForm == false)
-			{
-				FBTVector	pos;
-				FBRVector	rot;
-				FBSVector	scale;
+	std::vector<const char*>		jobFilenames(count);
+	std::vector<const char*>		jobNames(count);
+	std::vector<InputModelData*>	jobData(count);
 
-				FBMatrixToTRS( pos, rot, scale, m );
+	for (int i=0; i<count; ++i)
+	{
+		jobFilenames[i] = filenames[i];
+		jobNames[i] = snapshotNames[i];
+		jobData[i] = modelData[i / numberOfCopies];
+	}
 
-				lProp = pNewModel->PropertyCreate( "SnapshotPosition", kFBPT_Vector4D, ANIMATIONNODE_TYPE_VECTOR_4, false, true );
-				if (lProp) lProp->SetData( pos );
+	bool *results = new bool[count];
+	CmdMakeSnapshotFBX_SendBatch( count, jobFilenames.data(), jobNames.data(), jobData.data(), ResetXForm, results );
 
-				lProp = pNewModel->PropertyCreate( "SnapshotRotation", kFBPT_Vector3D, ANIMATIONNODE_TYPE_VECTOR, false, true );
-				if (lProp) lProp->SetData( rot );
+	int numberOfSnapshots = 0;
 
-				lProp = pNewModel->PropertyCreate( "SnapshotScale", kFBPT_Vector3D, ANIMATIONNODE_TYPE_VECTOR, false, true );
-				if (lProp) lProp->SetData( scale );
-			}
+	for (int i=0; i<count; ++i)
+	{
+		if (false == results[i])
+		{
+			printf( "[Snapshot] failed to make %s\n", jobNames[i] );
+			continue;
+		}
 
-			pNewModel->Selected = true;
+		FBApplication::TheOne().FileMerge( jobFilenames[i] );
+
+		FBModel *pNewModel = SetupSnapshotModel( modelList[i / numberOfCopies], jobNames[i], localTime, ResetXForm, CopyShaders );
+		if (pNewModel)
+		{
+			if (newNames)
+				newNames->Add( pNewModel->LongName );
+			numberOfSnapshots += 1;
 		}
 	}
 
+	delete [] results;
+	for (auto iter=begin(modelData); iter!=end(modelData); ++iter)
+		delete *iter;
+
 	//
-	// finalyze, import back to mobu a snapshot model
+	// finalyze, import back to mobu a snapshot models
 	//
 	FBPlayerControl::TheOne().Goto( localTime );
 
-	return nullptr;
+	return numberOfSnapshots;
+}
+
+
+
+
+// read texture file into RGBA8 atlas source
+static bool LoadAtlasImage(const char *filename, AtlasImage &image)
+{
+	FBImage	fbImage(filename);
+
+	const int width = fbImage.Width;
+	const int height = fbImage.Height;
+	const unsigned char *src = fbImage.GetBufferAddress();
+
+	if (width <= 0 || height <= 0 || src == nullptr)
+		return false;
+
+	const FBImageFormat format = fbImage.Format;
+
+	int channels = 4;
+	bool swapRB = false;
+
+	switch (format)
+	{
+	case kFBImageFormatRGBA32:	channels = 4;	swapRB = false;	break;
+	case kFBImageFormatBGRA32:	channels = 4;	swapRB = true;	break;
+	case kFBImageFormatRGB24:	channels = 3;	swapRB = false;	break;
+	case kFBImageFormatBGR24:	channels = 3;	swapRB = true;	break;
+	default:
+		printf( "[CombineModels] unsupported image format - %s\n", filename );
+		return false;
+	}
+
+	image.Init(width, height);
+	unsigned char *dst = image.pixels.data();
+
+	for (int i=0, count=width*height; i<count; ++i, src += channels, dst += 4)
+	{
+		dst[0] = (swapRB) ? src[2] : src[0];
+		dst[1] = src[1];
+		dst[2] = (swapRB) ? src[0] : src[2];
+		dst[3] = (channels == 4) ? src[3] : 255;
+	}
+
+	return true;
+}
+
+// atlas files are named after the combined model and go next to the scene, temp folder for an unsaved scene
+//	an index is added when files of that name already exist, so a new combine doesn't overwrite a texture in use
+static FBString MakeCombinedAtlasName(const char *combinedName)
+{
+	FBString sceneFilename( FBApplication::TheOne().FBXFileName );
+	FBString folder( ExtractFilePath(sceneFilename) );
+
+	if (folder.IsEmpty() )
+		folder = FBSystem::TheOne().TempPath;
+
+	FBString baseName( folder, "\\" );
+	baseName = baseName + combinedName + "_atlas";
+
+	FBString atlasName( baseName );
+
+	const int size_text=128;
+	char text[size_text] = "";
+
+	for (int idx=1; ; ++idx)
+	{
+		FILE *fp = fopen( FBString(atlasName, ".tga"), "rb" );
+		if (nullptr == fp)
+			break;
+		fclose(fp);
+
+		sprintf_s( text, size_text, "_%.4d", idx );
+		atlasName = baseName + text;
+	}
+
+	return atlasName;
 }
 
+// build atlas from material diffuse textures, remap uvs and polygon materials
+//	atlas material goes first in the out material list, materials without textures follow it
+static bool BuildCombinedAtlas(InputModelData &data, FBArrayTemplate<FBMaterial*> &materialList, FBArrayTemplate<FBMaterial*> &outMaterialList,
+	const char *combinedName, FBString &atlasFilename)
+{
+	const int numberOfMaterials = materialList.GetCount();
+
+	std::vector<AtlasImage>			images(numberOfMaterials);
+	std::vector<const AtlasImage*>	sources(numberOfMaterials, nullptr);
+	std::vector<std::string>		names(numberOfMaterials);
+
+	for (int i=0; i<numberOfMaterials; ++i)
+	{
+		FBTexture *pTexture = materialList[i]->GetTexture(kFBMaterialTextureDiffuse);
+		if (pTexture == nullptr)
+			continue;
+
+		FBVideo *pVideo = pTexture->Video;
+		if (pVideo == nullptr || false == FBIS(pVideo, FBVideoClip) )
+			continue;
+
+		FBString filename( ((FBVideoClip*) pVideo)->Filename );
+		if (LoadAtlasImage(filename, images[i]) )
+		{
+			sources[i] = &images[i];
+			names[i] = (const char*) filename;
+		}
+	}
+
+	TextureAtlasOptions	options;
+	TextureAtlas		atlas;
+
+	if (false == atlas.Build(sources, options) )
+		return false;
+
+	std::vector<int>	materialToEntry(numberOfMaterials, -1);
+	for (int i=0; i<numberOfMaterials; ++i)
+		if (atlas.IsEntryPacked(i) )
+			materialToEntry[i] = i;
+
+	if (false == RemapInputModelUVs(data, atlas, materialToEntry) )
+		return false;
+
+	FBString atlasName( MakeCombinedAtlasName(combinedName) );
+	atlasFilename = FBString(atlasName, ".tga");
 
+	if (false == atlas.WriteTGA(atlasFilename) )
+		return false;
+	atlas.WriteRemapTable( FBString(atlasName, ".txt"), names );
 
+	// new material ids, 0 is an atlas material
+	std::vector<int>	materialRemap(numberOfMaterials, 0);
 
-FBModel *CombineModels(FBModelList &inList)
+	outMaterialList.Clear();
+	outMaterialList.Add(nullptr);
+
+	for (int i=0; i<numberOfMaterials; ++i)
+	{
+		if (materialToEntry[i] < 0)
+			materialRemap[i] = outMaterialList.Add( materialList[i] );
+	}
+
+	for (auto iter=data.polyInfo.begin(); iter!=data.polyInfo.end(); ++iter)
+	{
+		if (iter->materialId >= 0 && iter->materialId < numberOfMaterials)
+			iter->materialId = materialRemap[iter->materialId];
+	}
+
+	data.materialIndices.resize( outMaterialList.GetCount() );
+	for (int i=0; i<outMaterialList.GetCount(); ++i)
+		data.materialIndices[i] = i;
+
+	return true;
+}
+
+FBModel *CombineModels(FBModelList &inList, const bool UseTextureAtlas)
 {
 
 	// keep only models with geometry
@@ -848,7 +1096,7 @@ FBModel *CombineModels(FBModelList &inList)
 	InputModelData data;
 
 	FillInputModelData( combineList, data, materialList, false, true );
-	
+
 	//
 	//
 	//
@@ -880,6 +1128,11 @@ FBModel *CombineModels(FBModelList &inList)
 		}
 	}
 
+	FBArrayTemplate<FBMaterial*>	atlasMaterialList;
+	FBString						atlasFilename;
+
+	const bool useAtlas = UseTextureAtlas && BuildCombinedAtlas( data, materialList, atlasMaterialList, CombinedName, atlasFilename );
+
 	if (CmdMakeSnapshotFBX_Send(filename, CombinedName, data, false) )
 	{
 		FBApplication::TheOne().FileMerge( filename );
@@ -888,9 +1141,24 @@ FBModel *CombineModels(FBModelList &inList)
 		if (pNewModel)
 		{
 			
-			for (int i=0; i<materialList.GetCount(); ++i)
+			if (useAtlas)
 			{
-				pNewModel->Materials.Add( materialList.GetAt(i) );
+				FBTexture *pTexture = new FBTexture(atlasFilename);
+				FBMaterial *pMaterial = new FBMaterial( FBString(CombinedName, "_Atlas") );
+				pMaterial->SetTexture(pTexture, kFBMaterialTextureDiffuse);
+
+				pNewModel->Materials.Add( pMaterial );
+				for (int i=1; i<atlasMaterialList.GetCount(); ++i)
+				{
+					pNewModel->Materials.Add( atlasMaterialList.GetAt(i) );
+				}
+			}
+			else
+			{
+				for (int i=0; i<materialList.GetCount(); ++i)
+				{
+					pNewModel->Materials.Add( materialList.GetAt(i) );
+				}
 			}
 
 			SkinCopy( combineList, pNewModel );
@@ -0,0 +1,116 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: AtomicFile.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "IO\AtomicFile.h"
+
+#include <atomic>
+
+/////////////////////////////////////////////////////////////
+// AtomicFileWriter
+
+AtomicFileWriter::AtomicFileWriter()
+	: mFile(nullptr)
+	, mFailed(false)
+{
+}
+
+AtomicFileWriter::~AtomicFileWriter()
+{
+	Abort();
+}
+
+bool AtomicFileWriter::Open(const char *filename)
+{
+	static std::atomic<unsigned int>	gTempCounter(0);
+
+	Abort();
+
+#ifdef _WIN32
+	const unsigned int processId = (unsigned int) GetCurrentProcessId();
+#else
+	const unsigned int processId = (unsigned int) getpid();
+#endif
+
+	// another process could write the same file at the same time
+	char suffix[64];
+	sprintf(suffix, ".tmp%u_%u", processId, gTempCounter.fetch_add(1) );
+
+	mFilename = filename;
+	mTempFilename = mFilename + suffix;
+	mFailed = false;
+
+	mFile = fopen(mTempFilename.c_str(), "wb");
+	return mFile != nullptr;
+}
+
+bool AtomicFileWriter::Write(const void *data, const size_t size)
+{
+	if (nullptr == mFile)
+		return false;
+
+	if (size > 0 && fwrite(data, 1, size, mFile) != size)
+		mFailed = true;
+
+	return false == mFailed;
+}
+
+bool AtomicFileWriter::Commit()
+{
+	if (nullptr == mFile)
+		return false;
+
+	const bool isClosed = (0 == fclose(mFile) );
+	mFile = nullptr;
+
+	if (isClosed && false == mFailed)
+	{
+#ifdef _WIN32
+		if (FALSE != MoveFileExA(mTempFilename.c_str(), mFilename.c_str(), MOVEFILE_REPLACE_EXISTING) )
+			return true;
+#else
+		if (0 == rename(mTempFilename.c_str(), mFilename.c_str() ) )
+			return true;
+#endif
+	}
+
+	remove(mTempFilename.c_str() );
+	return false;
+}
+
+void AtomicFileWriter::Abort()
+{
+	if (nullptr != mFile)
+	{
+		fclose(mFile);
+		mFile = nullptr;
+
+		remove(mTempFilename.c_str() );
+	}
+}
+
+bool WriteFileAtomic(const char *filename, const void *data, const size_t size)
+{
+	AtomicFileWriter writer;
+
+	if (false == writer.Open(filename) )
+		return false;
+
+	writer.Write(data, size);
+	return writer.Commit();
+}
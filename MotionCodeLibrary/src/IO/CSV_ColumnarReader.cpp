@@ -0,0 +1,673 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: CSV_ColumnarReader.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "IO\CSV_ColumnarReader.h"
+#include "IO\MappedFile.h"
+#include "IO\FastNumberParser.h"
+#include "algorithm\ParallelFor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits>
+#include <algorithm>
+
+#define		CSV_MIN_CHUNK_SIZE			(1 << 20)
+#define		CSV_RIGIDBODY_FIELDS		11		// id, pos[3], quat[4], euler[3]
+#define		CSV_MARKER_FIELDS			4		// pos[3], id
+#define		CSV_POSITION_SCALE			100.0	// meters to centimeters
+
+#define		CSV_SIDECAR_MAGIC			0x56534343	// "CCSV"
+#define		CSV_SIDECAR_VERSION			1
+
+namespace
+{
+	// rows of one text chunk, merged into columns after all chunks are parsed
+	struct ChunkRows
+	{
+		std::vector<int>		frames;
+		std::vector<double>		timestamps;
+		std::vector<int>		offsets;		// first value of the row in values, size is rows + 1
+		std::vector<float>		values;			// xyz per marker, NaN for a missing sample
+		int						maxMarkers;
+		int						firstRow;
+
+		ChunkRows()
+			: maxMarkers(0)
+			, firstRow(0)
+		{}
+	};
+
+	struct SidecarHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint64_t	sourceSize;
+		int64_t		sourceTime;
+
+		int32_t		declaredFrameCount;
+		int32_t		rigidBodyCount;
+		double		length;
+
+		int32_t		markerCount;
+		int32_t		rowCount;
+		int32_t		firstFrame;
+		int32_t		frameRange;
+		int32_t		presentWords;
+		int32_t		reserved;
+	};
+
+	inline bool LineStartsWith(const char *p, const char *end, const char *token)
+	{
+		const size_t len = strlen(token);
+		return (size_t)(end - p) >= len && 0 == strncmp(p, token, len);
+	}
+
+	inline const char *NextLine(const char *p, const char *end)
+	{
+		const char *eol = (const char*) memchr(p, '\n', end - p);
+		return (eol) ? eol + 1 : end;
+	}
+
+	void ParseFrameLine(const char *p, const char *end, ChunkRows &rows)
+	{
+		const float missing = std::numeric_limits<float>::quiet_NaN();
+
+		// skip "frame" token
+		p = SkipField(p, end);
+
+		int frame = 0;
+		double timestamp = 0.0;
+		int rigidBodies = 0;
+		int markers = 0;
+
+		if (nullptr == ParseInt(p, end, frame))
+			return;
+		p = SkipField(p, end);
+
+		ParseDouble(p, end, timestamp);
+		p = SkipField(p, end);
+
+		ParseInt(p, end, rigidBodies);
+		p = SkipField(p, end);
+
+		for (int i=0, count=rigidBodies * CSV_RIGIDBODY_FIELDS; i<count; ++i)
+			p = SkipField(p, end);
+
+		ParseInt(p, end, markers);
+		p = SkipField(p, end);
+
+		rows.frames.push_back(frame);
+		rows.timestamps.push_back(timestamp);
+
+		for (int i=0; i<markers; ++i)
+		{
+			for (int j=0; j<3; ++j)
+			{
+				double value = 0.0;
+				const char *next = ParseDouble(p, end, value);
+				rows.values.push_back( (next) ? (float) (value * CSV_POSITION_SCALE) : missing );
+				p = SkipField(p, end);
+			}
+			// marker id
+			p = SkipField(p, end);
+		}
+
+		if (markers > rows.maxMarkers)
+			rows.maxMarkers = markers;
+
+		rows.offsets.push_back( (int) rows.values.size() );
+	}
+
+	void ParseChunk(const char *p, const char *end, ChunkRows &rows)
+	{
+		rows.offsets.push_back(0);
+
+		while (p < end)
+		{
+			const char *eol = NextLine(p, end);
+
+			if (LineStartsWith(p, eol, "frame"))
+				ParseFrameLine(p, eol, rows);
+
+			p = eol;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// csv_columnar_data
+
+csv_columnar_data::csv_columnar_data()
+{
+	FreeData();
+}
+
+void csv_columnar_data::FreeData()
+{
+	mDeclaredFrameCount = 0;
+	mRigidBodyCount = 0;
+	mLength = 0.0;
+
+	mMarkerCount = 0;
+	mRowCount = 0;
+	mFirstFrame = 0;
+	mPresentWords = 0;
+
+	mFrames.clear();
+	mTimestamps.clear();
+	mFrameToRow.clear();
+	mColumns.clear();
+	mPresent.clear();
+}
+
+std::string csv_columnar_data::GetSidecarName(const char *pFileName)
+{
+	std::string name(pFileName);
+	name += ".colcache";
+	return name;
+}
+
+size_t csv_columnar_data::ParseHeader(const char *data, const size_t size)
+{
+	const char *p = data;
+	const char *end = data + size;
+
+	while (p < end)
+	{
+		const char *eol = NextLine(p, end);
+
+		if (LineStartsWith(p, eol, "frame"))
+			break;
+
+		if (LineStartsWith(p, eol, "info"))
+		{
+			// info,framecount,N or info,trackablecount,N
+			const char *field = SkipField(p, eol);
+			const bool isFrameCount = LineStartsWith(field, eol, "framecount");
+			const bool isTrackableCount = LineStartsWith(field, eol, "trackablecount");
+			field = SkipField(field, eol);
+
+			if (isFrameCount)
+				ParseInt(field, eol, mDeclaredFrameCount);
+			else if (isTrackableCount)
+				ParseInt(field, eol, mRigidBodyCount);
+		}
+
+		p = eol;
+	}
+
+	return p - data;
+}
+
+bool csv_columnar_data::Read(const char *pFileName, const bool useSidecar, const int numberOfThreads)
+{
+	FreeData();
+
+	if (useSidecar && ReadSidecar(pFileName))
+	{
+		printf( "[CSV_ColumnarReader] columns are loaded from the sidecar %s\n", GetSidecarName(pFileName).c_str() );
+		return true;
+	}
+
+	MappedFile	file;
+	if (false == file.Open(pFileName))
+		return false;
+
+	const char *data = file.GetData();
+	const size_t size = file.GetSize();
+	const size_t bodyStart = ParseHeader(data, size);
+
+	// split the body into chunks on line boundaries
+	const int numberOfWorkers = ParallelForThreadCount(numberOfThreads);
+	size_t chunkSize = (size - bodyStart) / (numberOfWorkers * 4) + 1;
+	if (chunkSize < CSV_MIN_CHUNK_SIZE)
+		chunkSize = CSV_MIN_CHUNK_SIZE;
+
+	std::vector<size_t>	chunkStarts;
+	size_t offset = bodyStart;
+	while (offset < size)
+	{
+		chunkStarts.push_back(offset);
+
+		size_t next = offset + chunkSize;
+		if (next >= size)
+			break;
+		offset = NextLine(data + next, data + size) - data;
+	}
+	chunkStarts.push_back(size);
+
+	const int numberOfChunks = (int) chunkStarts.size() - 1;
+	std::vector<ChunkRows>	chunks(numberOfChunks);
+
+	ParallelFor( numberOfChunks, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+			ParseChunk(data + chunkStarts[i], data + chunkStarts[i+1], chunks[i]);
+	}, numberOfThreads );
+
+	// frame range, rows and marker count
+	int minFrame = std::numeric_limits<int>::max();
+	int maxFrame = std::numeric_limits<int>::min();
+
+	for (auto iter=begin(chunks); iter!=end(chunks); ++iter)
+	{
+		iter->firstRow = mRowCount;
+		mRowCount += (int) iter->frames.size();
+		mMarkerCount = std::max(mMarkerCount, iter->maxMarkers);
+
+		for (auto frameIter=begin(iter->frames); frameIter!=end(iter->frames); ++frameIter)
+		{
+			minFrame = std::min(minFrame, *frameIter);
+			maxFrame = std::max(maxFrame, *frameIter);
+		}
+		if (iter->timestamps.size() > 0)
+			mLength = std::max(mLength, *std::max_element(begin(iter->timestamps), end(iter->timestamps)));
+	}
+
+	if (mRowCount == 0)
+		return false;
+
+	mFirstFrame = minFrame;
+	mPresentWords = (mRowCount + 31) / 32;
+
+	mFrames.resize(mRowCount);
+	mTimestamps.resize(mRowCount);
+	mFrameToRow.assign(maxFrame - minFrame + 1, -1);
+	mColumns.assign( (size_t) mMarkerCount * 3 * mRowCount, std::numeric_limits<float>::quiet_NaN() );
+	mPresent.assign( (size_t) mMarkerCount * mPresentWords, 0 );
+
+	// scatter chunk rows into columns, every chunk owns its own range of rows
+	ParallelFor( numberOfChunks, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			const ChunkRows &rows = chunks[i];
+			for (int r=0, count=(int) rows.frames.size(); r<count; ++r)
+			{
+				const int row = rows.firstRow + r;
+				mFrames[row] = rows.frames[r];
+				mTimestamps[row] = rows.timestamps[r];
+
+				const float *values = rows.values.data() + rows.offsets[r];
+				const int markers = (rows.offsets[r+1] - rows.offsets[r]) / 3;
+
+				for (int m=0; m<markers; ++m)
+				{
+					float *column = mColumns.data() + (size_t) m * 3 * mRowCount;
+					column[row] = values[m*3];
+					column[mRowCount + row] = values[m*3+1];
+					column[2 * mRowCount + row] = values[m*3+2];
+				}
+			}
+		}
+	}, numberOfThreads );
+
+	// frame index, duplicated frame keeps the last row like the line by line reader
+	for (int row=0; row<mRowCount; ++row)
+		mFrameToRow[mFrames[row] - mFirstFrame] = row;
+
+	// presence bits, a missing sample stays NaN in the column
+	ParallelFor( mMarkerCount, 8, [&] (const int first, const int last) {
+		for (int m=first; m<last; ++m)
+		{
+			const float *x = GetColumn(m, 0);
+			uint32_t *bits = mPresent.data() + (size_t) m * mPresentWords;
+
+			for (int row=0; row<mRowCount; ++row)
+			{
+				if (x[row] == x[row])
+					bits[row >> 5] |= (1u << (row & 31));
+			}
+		}
+	}, numberOfThreads );
+
+	if (useSidecar)
+	{
+		if (WriteSidecar(pFileName))
+			printf( "[CSV_ColumnarReader] sidecar is written - %s\n", GetSidecarName(pFileName).c_str() );
+		else
+			printf( "[CSV_ColumnarReader] failed to write a sidecar - %s\n", GetSidecarName(pFileName).c_str() );
+	}
+
+	return true;
+}
+
+bool csv_columnar_data::WriteSidecar(const char *pFileName) const
+{
+	SidecarHeader header;
+	memset(&header, 0, sizeof(SidecarHeader));
+
+	if (false == MappedFile::GetFileStamp(pFileName, header.sourceSize, header.sourceTime))
+		return false;
+
+	header.magic = CSV_SIDECAR_MAGIC;
+	header.version = CSV_SIDECAR_VERSION;
+	header.declaredFrameCount = mDeclaredFrameCount;
+	header.rigidBodyCount = mRigidBodyCount;
+	header.length = mLength;
+	header.markerCount = mMarkerCount;
+	header.rowCount = mRowCount;
+	header.firstFrame = mFirstFrame;
+	header.frameRange = (int32_t) mFrameToRow.size();
+	header.presentWords = mPresentWords;
+
+	const std::string sidecarName = GetSidecarName(pFileName);
+
+	FILE *f = fopen(sidecarName.c_str(), "wb");
+	if (f == nullptr)
+		return false;
+
+	bool result = true;
+	result &= (1 == fwrite(&header, sizeof(SidecarHeader), 1, f));
+	result &= (mFrames.size() == fwrite(mFrames.data(), sizeof(int), mFrames.size(), f));
+	result &= (mTimestamps.size() == fwrite(mTimestamps.data(), sizeof(double), mTimestamps.size(), f));
+	result &= (mFrameToRow.size() == fwrite(mFrameToRow.data(), sizeof(int), mFrameToRow.size(), f));
+	result &= (mColumns.size() == fwrite(mColumns.data(), sizeof(float), mColumns.size(), f));
+	result &= (mPresent.size() == fwrite(mPresent.data(), sizeof(uint32_t), mPresent.size(), f));
+
+	fclose(f);
+
+	if (false == result)
+		remove(sidecarName.c_str());
+
+	return result;
+}
+
+bool csv_columnar_data::ReadSidecar(const char *pFileName)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+
+	if (false == MappedFile::GetFileStamp(pFileName, sourceSize, sourceTime))
+		return false;
+
+	MappedFile	file;
+	if (false == file.Open(GetSidecarName(pFileName).c_str()))
+		return false;
+
+	if (file.GetSize() < sizeof(SidecarHeader))
+		return false;
+
+	SidecarHeader header;
+	memcpy(&header, file.GetData(), sizeof(SidecarHeader));
+
+	if (header.magic != CSV_SIDECAR_MAGIC || header.version != CSV_SIDECAR_VERSION
+		|| header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+	{
+		return false;
+	}
+
+	const size_t columnsCount = (size_t) header.markerCount * 3 * header.rowCount;
+	const size_t presentCount = (size_t) header.markerCount * header.presentWords;
+	const size_t expectedSize = sizeof(SidecarHeader)
+		+ sizeof(int) * header.rowCount
+		+ sizeof(double) * header.rowCount
+		+ sizeof(int) * header.frameRange
+		+ sizeof(float) * columnsCount
+		+ sizeof(uint32_t) * presentCount;
+
+	if (file.GetSize() != expectedSize)
+		return false;
+
+	FreeData();
+
+	mDeclaredFrameCount = header.declaredFrameCount;
+	mRigidBodyCount = header.rigidBodyCount;
+	mLength = header.length;
+	mMarkerCount = header.markerCount;
+	mRowCount = header.rowCount;
+	mFirstFrame = header.firstFrame;
+	mPresentWords = header.presentWords;
+
+	const char *p = file.GetData() + sizeof(SidecarHeader);
+
+	mFrames.resize(mRowCount);
+	memcpy(mFrames.data(), p, sizeof(int) * mRowCount);
+	p += sizeof(int) * mRowCount;
+
+	mTimestamps.resize(mRowCount);
+	memcpy(mTimestamps.data(), p, sizeof(double) * mRowCount);
+	p += sizeof(double) * mRowCount;
+
+	mFrameToRow.resize(header.frameRange);
+	memcpy(mFrameToRow.data(), p, sizeof(int) * header.frameRange);
+	p += sizeof(int) * header.frameRange;
+
+	mColumns.resize(columnsCount);
+	memcpy(mColumns.data(), p, sizeof(float) * columnsCount);
+	p += sizeof(float) * columnsCount;
+
+	mPresent.resize(presentCount);
+	memcpy(mPresent.data(), p, sizeof(uint32_t) * presentCount);
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////
+// self test
+
+namespace
+{
+	const int	TEST_FIRST_FRAME = 5;
+	const int	TEST_SKIPPED_FRAME = 100;
+
+	// marker value in meters, some samples are missing and some rows have less markers
+	bool TestSampleExists(const int frame, const int marker, const int numberOfMarkers)
+	{
+		if (0 == frame % 50 && marker >= numberOfMarkers - 2)
+			return false;
+		return 0 != (frame + marker) % 11;
+	}
+
+	double TestSampleValue(const int frame, const int marker, const int axis)
+	{
+		return (frame % 200) * 0.0125 + marker * 0.25 - axis * 0.0625;
+	}
+
+	bool WriteTestFile(const char *pFileName, const int numberOfFrames, const int numberOfMarkers)
+	{
+		FILE *f = fopen(pFileName, "w");
+		if (nullptr == f)
+			return false;
+
+		fprintf( f, "comment,columnar reader self test\n" );
+		fprintf( f, "info,framecount,%d\n", numberOfFrames );
+		fprintf( f, "info,trackablecount,1\n" );
+		fprintf( f, "rigidbody,\"body\",1,3,0.1,0.0,0.0,0.0,0.1,0.0,0.0,0.0,0.1\n" );
+
+		for (int i=0; i<numberOfFrames; ++i)
+		{
+			const int frame = TEST_FIRST_FRAME + i;
+			if (frame == TEST_SKIPPED_FRAME)
+				continue;
+
+			const int markers = (0 == frame % 50) ? numberOfMarkers - 2 : numberOfMarkers;
+
+			fprintf( f, "frame,%d,%.4f,1,1,0.1,0.2,0.3,0,0,0,1,0,0,0,%d", frame, frame / 120.0, markers );
+
+			for (int m=0; m<markers; ++m)
+			{
+				if (TestSampleExists(frame, m, numberOfMarkers))
+					fprintf( f, ",%.4f,%.4f,%.4f,%d", TestSampleValue(frame, m, 0), TestSampleValue(frame, m, 1), TestSampleValue(frame, m, 2), m );
+				else
+					fprintf( f, ",,,,%d", m );
+			}
+			fprintf( f, "\n" );
+		}
+
+		fclose(f);
+		return true;
+	}
+
+	// number of rows and markers that differ, columns are compared bitwise to keep NaN samples
+	int CompareColumnarData(const csv_columnar_data &a, const csv_columnar_data &b)
+	{
+		if (a.GetMarkerCount() != b.GetMarkerCount() || a.GetRowCount() != b.GetRowCount()
+			|| a.GetFirstFrame() != b.GetFirstFrame() || a.GetLastFrame() != b.GetLastFrame()
+			|| a.GetDeclaredFrameCount() != b.GetDeclaredFrameCount() || a.GetRigidBodyCount() != b.GetRigidBodyCount()
+			|| a.GetLength() != b.GetLength() )
+		{
+			return 1;
+		}
+
+		int differences = 0;
+
+		for (int row=0; row<a.GetRowCount(); ++row)
+		{
+			if (a.GetRowFrame(row) != b.GetRowFrame(row) || a.GetRowTimestamp(row) != b.GetRowTimestamp(row)
+				|| a.GetFrameRow(a.GetRowFrame(row)) != b.GetFrameRow(a.GetRowFrame(row)) )
+			{
+				differences += 1;
+			}
+		}
+
+		for (int m=0; m<a.GetMarkerCount(); ++m)
+		{
+			for (int axis=0; axis<3; ++axis)
+				if (0 != memcmp(a.GetColumn(m, axis), b.GetColumn(m, axis), sizeof(float) * a.GetRowCount()) )
+					differences += 1;
+
+			for (int row=0; row<a.GetRowCount(); ++row)
+				if (a.IsPresent(m, row) != b.IsPresent(m, row))
+					differences += 1;
+		}
+
+		return differences;
+	}
+
+	bool IsTestFileExists(const char *pFileName)
+	{
+		FILE *f = fopen(pFileName, "rb");
+		if (nullptr == f)
+			return false;
+		fclose(f);
+		return true;
+	}
+}
+
+bool CSVColumnarReaderSelfTest(const char *folder)
+{
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf( "[CSV_ColumnarReader] %s\n", text );
+			numberOfErrors += 1;
+		}
+	};
+
+	// a few chunks of the minimum size to parse in parallel
+	const int numberOfFrames = 3000;
+	const int numberOfMarkers = 40;
+
+	const std::string fileName = std::string(folder) + "/csv_columnar_selftest.csv";
+	const std::string sidecarName = csv_columnar_data::GetSidecarName(fileName.c_str());
+
+	remove( sidecarName.c_str() );
+
+	if (false == WriteTestFile(fileName.c_str(), numberOfFrames, numberOfMarkers))
+	{
+		printf( "[CSV_ColumnarReader] failed to write a test file %s\n", fileName.c_str() );
+		return false;
+	}
+
+	// 1 - text is parsed into columns, sidecar is not written by default
+
+	csv_columnar_data	parsed;
+	fnCheck( parsed.Read(fileName.c_str(), false, 4), "failed to read a test file" );
+	fnCheck( false == IsTestFileExists(sidecarName.c_str()), "sidecar is written without a request" );
+
+	const int lastFrame = TEST_FIRST_FRAME + numberOfFrames - 1;
+
+	fnCheck( parsed.GetDeclaredFrameCount() == numberOfFrames && parsed.GetRigidBodyCount() == 1, "wrong file info" );
+	fnCheck( parsed.GetMarkerCount() == numberOfMarkers, "wrong number of markers" );
+	fnCheck( parsed.GetRowCount() == numberOfFrames - 1, "wrong number of rows" );
+	fnCheck( parsed.GetFirstFrame() == TEST_FIRST_FRAME && parsed.GetLastFrame() == lastFrame, "wrong frame range" );
+	fnCheck( parsed.GetFrameRow(TEST_SKIPPED_FRAME) < 0, "skipped frame has a row" );
+	fnCheck( fabs(parsed.GetLength() - lastFrame / 120.0) < 1.0e-4, "wrong length" );
+
+	int wrongSamples = 0;
+	for (int frame=TEST_FIRST_FRAME; frame<=lastFrame; ++frame)
+	{
+		if (frame == TEST_SKIPPED_FRAME)
+			continue;
+
+		for (int m=0; m<numberOfMarkers; ++m)
+		{
+			float pos[3];
+			const bool exists = TestSampleExists(frame, m, numberOfMarkers);
+
+			if (exists != parsed.GetFramePos(m, frame, pos))
+			{
+				wrongSamples += 1;
+				continue;
+			}
+
+			for (int axis=0; exists && axis<3; ++axis)
+				if (fabs(pos[axis] - TestSampleValue(frame, m, axis) * CSV_POSITION_SCALE) > 1.0e-3)
+					wrongSamples += 1;
+		}
+	}
+	fnCheck( 0 == wrongSamples, "samples differ from the written ones" );
+
+	// 2 - one thread gives the same columns
+
+	csv_columnar_data	serial;
+	fnCheck( serial.Read(fileName.c_str(), false, 1), "failed to read a test file in one thread" );
+	fnCheck( 0 == CompareColumnarData(parsed, serial), "one thread columns differ" );
+
+	// 3 - sidecar round trip
+
+	csv_columnar_data	cached;
+	fnCheck( cached.Read(fileName.c_str(), true, 4), "failed to read a test file with a sidecar" );
+	fnCheck( IsTestFileExists(sidecarName.c_str()), "sidecar is not written" );
+	fnCheck( cached.ReadSidecar(fileName.c_str()), "sidecar is rejected" );
+	fnCheck( 0 == CompareColumnarData(parsed, cached), "sidecar columns differ" );
+
+	// 4 - truncated sidecar is rejected
+
+	{
+		std::vector<char>	sidecar;
+		{
+			MappedFile	file;
+			if (file.Open(sidecarName.c_str()))
+				sidecar.assign(file.GetData(), file.GetData() + file.GetSize());
+		}
+
+		FILE *f = fopen(sidecarName.c_str(), "wb");
+		if (f && sidecar.size() > 1)
+			fwrite(sidecar.data(), 1, sidecar.size() - 1, f);
+		if (f)
+			fclose(f);
+
+		fnCheck( false == cached.ReadSidecar(fileName.c_str()), "truncated sidecar is accepted" );
+	}
+
+	// 5 - changed source makes the sidecar stale
+
+	fnCheck( cached.WriteSidecar(fileName.c_str()), "failed to write a sidecar again" );
+	{
+		FILE *f = fopen(fileName.c_str(), "a");
+		if (f)
+		{
+			fprintf( f, "comment,changed\n" );
+			fclose(f);
+		}
+	}
+	fnCheck( false == cached.ReadSidecar(fileName.c_str()), "stale sidecar is accepted" );
+
+	remove( sidecarName.c_str() );
+	remove( fileName.c_str() );
+
+	printf( "[CSV_ColumnarReader] self test %s, %d errors\n", (numberOfErrors == 0) ? "passed" : "FAILED", numberOfErrors );
+	return numberOfErrors == 0;
+}
@@ -12,25 +12,20 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "IO\CSV_Reader.h"
+#include "IO\CSV_ColumnarReader.h"
 
 #define		CSV_BUFFER_SIZE		4096
-#define		CSV_TOKEN_SIZE		256
-
-using namespace CEUtils;
 
 void csv_data::FreeData() {
-	for(int i=0; i<rigidbodycount; i++) {
+	for(int i=0; i<rigidbodies.GetCount(); i++) {
 		if (rigidbodies[i]) {
 			delete rigidbodies[i];
 			rigidbodies[i] = NULL;
 		}
 	}
 	rigidbodies.Clear();
-	rigidbodycount = 0;
-	framecount = 0;
-	markercount = 0;
 
-	for (int i=0; i<markercount; i++)
+	for (int i=0; i<markers.GetCount(); i++)
 	{
 		if (markers[i])
 		{
@@ -41,240 +36,79 @@ void csv_data::FreeData() {
 	}
 	markers.Clear();
 	markers_filtered.Clear();
+
+	rigidbodycount = 0;
+	framecount = 0;
+	markercount = 0;
+	length = 0.0;
 }
 
-bool	csv_data::Read(const char *pFileName)
+bool	csv_data::Read(const char *pFileName, const bool useSidecar)
 {
-	//printf("importing file... %s\n", pFileName );
-
 	FreeData();
 
-	// if successful, return true
-	FILE *f;
-	if ( (f = fopen(pFileName, "r")) == NULL )
+	// frame lines are parsed by the columnar reader
+	csv_columnar_data	columns;
+	if (false == columns.Read(pFileName, useSidecar) )
 		return false;
 
-	char buffer[CSV_BUFFER_SIZE];
-	char ptr[CSV_TOKEN_SIZE];
-
-	{while(!feof(f) ) {
-		memset(buffer,0,sizeof(char)*CSV_BUFFER_SIZE);
-		fgets(buffer, CSV_BUFFER_SIZE, f);
-
-		// parsing each line
-		StringTokens		tokens(buffer, ",");
-
-		if (strstr(buffer, "info") == buffer) {
-			// whole optical model info
+	framecount = columns.GetDeclaredFrameCount();
+	length = columns.GetLength();
+	rigidbodycount = columns.GetRigidBodyCount();
+	markercount = columns.GetMarkerCount();
 
-			if (strstr(buffer, "framecount") != NULL) {
-				// read framecount
-				if (tokens.GetCount() > 1) {
-					tokens.GetToken(2, ptr, CSV_TOKEN_SIZE);
-					sscanf( ptr, "%d", &framecount );
+	rigidbodies.SetCount(rigidbodycount);
+	for (int i=0; i<rigidbodycount; i++)
+		rigidbodies[i] = NULL;
 
-					//: create optical model
-					/*
-					modelRoot = CreateOpticalModel(frameCount);
-					if (modelRoot->ImportSetup() == false ) {
-						printf("optical model is not ready...\n");
-					}
-					*/
-				}
-			}
-			else {
-				if (strstr(buffer, "trackablecount") != NULL) {
-					//read rigidbodycount
-					if (tokens.GetCount() > 1) {
-						tokens.GetToken(2, ptr, CSV_TOKEN_SIZE);
-						sscanf( ptr, "%d", &rigidbodycount );
-						rigidbodies.SetCount(rigidbodycount);
-						//printf("rigidbodies count %d", rigidbodycount);
-					}
-				}
+	// rigid body setup lines are in the header, before the first frame line
+	if (rigidbodycount > 0)
+	{
+		FILE *f = fopen(pFileName, "r");
+		if (f != NULL)
+		{
+			char buffer[CSV_BUFFER_SIZE];
+			while (fgets(buffer, CSV_BUFFER_SIZE, f) && strstr(buffer, "frame") != buffer)
+			{
+				if (strstr(buffer, "rigidbody") == buffer)
+					CreateOpticalRigidBody(buffer);
 			}
-
-		}
-		else
-		if (strstr(buffer, "rigidbody") == buffer ) {
-			//rigid body stats
-			CreateOpticalRigidBody(buffer);
+			fclose(f);
 		}
-		else
-		if (strstr(buffer, "frame") == buffer ) {
-			//reading each frame data
-			ImportFrameData(tokens);
-			//FilterFrameData();
-		}
-	}}
-
-	fclose(f);
-
-	/*
-	// end parsing markers data
-	printf("markers count %d\n", modelRoot->Markers.GetCount() );
-	for (int i=0; i<modelRoot->Markers.GetCount(); i++)
-		modelRoot->Markers[i]->ImportEnd();
-		*/
-	
-	//CreateOpticalModel(framecount);
-	//FreeData();
-
-	return true;
-}
-
+	}
 
-void csv_data::ImportFrameData( StringTokens	&tokens )
-{
-	FBVector3d	lPos;
-	FBVector4d	lQuat;
-	FBVector3d	lRot;  // euler angles
-	
-	int frame=0;
-	double timestamp=0.0;
-	int rigidbodiescount=0;
-	int markerscount=0;
-	//int n=0;
-
-	char p[CSV_TOKEN_SIZE];
-	//char *p;
-	//p = strtok( (char*)line, "," );
-	//printf( "%s\n", p );
-	for (int n=1; n<tokens.GetCount(); n++)
+	// marker keeps visible samples only, an occluded frame is not found by GetFramePos
+	for (int i=0; i<markercount; i++)
 	{
-		//p = strtok(NULL, "," );
-		//n++;
-		tokens.GetToken(n, p, CSV_TOKEN_SIZE);
-		//if() {
-
-			switch(n) {
-			// frame ID (integer)
-			case 1:
-				sscanf(p, "%d", &frame);
-				/*
-				if (frame > 19)
-				{
-					printf( "local frame |%d|\n", frame );
-					OutputDebugString(p);
-				}
-				*/
-				break;
-			// time stamp (double) in seconds
-			case 2:
-				sscanf(p, "%lf", &timestamp);
-				if (timestamp > length) length = timestamp;		// increase global system time range
-				//printf( "frame timestamp %lf\n", timestamp );
-				break;
-			case 3:
-				// number of rigid bodies tracked in current frame
-				sscanf(p, "%d", &rigidbodiescount);
-				//printf( "number of frame rigid bodies |%d|\n", rigidbodiescount );
-				n++;
-
-				// rigid bodies information
-				int i,j;
-				for(i=0; i<rigidbodiescount; i++){
-					int rigidbodyNdx = 0;
-					// rigidbody ID
-					//p = strtok(NULL, ",");
-					tokens.GetToken(n, p, CSV_TOKEN_SIZE);
-					n++;
-					if (!p) break;
-					sscanf(p, "%d", &rigidbodyNdx);
-					//printf("rigidbody index %d\n", rigidbodyNdx);
-					// pos
-					for (j=0; j<3; j++) {
-						//p = strtok(NULL, ",");
-						tokens.GetToken(n, p, CSV_TOKEN_SIZE);
-						n++;
-						if (!p) break;
-
-						float value;
-						sscanf(p, "%f", &value);
-						lPos[j] = value*100;
-					}
-					// quat
-					for (j=0; j<4; j++) {
-						//p = strtok(NULL, ",");
-						tokens.GetToken(n, p, CSV_TOKEN_SIZE);
-						n++;
-						if (!p) break;
-
-						float value;
-						sscanf(p, "%f", &value);
-						lQuat[j] = value;
-					}
-					// euler angles (heading, attitude, bank)
-					
-					for (j=0; j<3; j++) {
-						//p = strtok(NULL, ",");
-						tokens.GetToken(n, p, CSV_TOKEN_SIZE);
-						n++;
-						if (!p) break;
-
-						float value;
-						sscanf(p, "%f", &value);
-						lRot[j] = value;
-					}
-					
+		csv_data::marker	*marker = new csv_data::marker;
 
-					//csv_data::rigidbody_data	rigidbody_data(frame, lPos, lQuat, lRot);
-					//rigidbodies[rigidbodyNdx-1]->data.Add(rigidbody_data);
-				}
-
-				//p = strtok(NULL, ",");
-				tokens.GetToken(n, p, CSV_TOKEN_SIZE);
-				//n++;
-				//if (!p) break;
+		const float *x = columns.GetColumn(i, 0);
+		const float *y = columns.GetColumn(i, 1);
+		const float *z = columns.GetColumn(i, 2);
 
-				sscanf(p, "%d", &markerscount);
-				//printf( "number of frame markers |%d|\n", markerscount );
+		for (int row=0; row<columns.GetRowCount(); row++)
+		{
+			if (false == columns.IsPresent(i, row) )
+				continue;
 
-				if (markerscount > markercount) {
+			int frame = columns.GetRowFrame(row);
+			double timestamp = columns.GetRowTimestamp(row);
+			FBVector3d pos(x[row], y[row], z[row]);
 
-					for(int i=markercount; i<markerscount; i++){
-						csv_data::marker		*marker = new csv_data::marker(frame, timestamp);
-						markers.Add(marker);
-					}
+			if (0 == marker->data.GetCount() )
+			{
+				marker->firstframe = frame;
+				marker->firsttime = timestamp;
+			}
 
-					markercount = markerscount;
-				}
+			csv_data::marker_data	framedata(frame, timestamp, pos);
+			marker->data.Add(framedata);
+		}
 
-				break;
-			default:
-				if (markerscount>0) {
-					int i;
-					for (i=0; i<markerscount; i++)
-					{
-						for (int j=0; j<3; j++, n++) {
-							// get value token
-							tokens.GetToken(n, p, CSV_TOKEN_SIZE);
-
-							float value;
-							sscanf(p, "%f", &value);
-							lPos[j] = value*100;
-						}
-
-						// read marker id
-						int id;
-						tokens.GetToken(n, p, CSV_TOKEN_SIZE);
-						n++;
-						sscanf(p, "%d", &id);
-
-						csv_data::marker_data	framedata(frame, timestamp, lPos);
-
-						//if ( (i > 27) && (frame == 20) )
-						//	printf( "import marker key - [%f, %f, %f]\n", lPos[0], lPos[1], lPos[2] );
-						markers[i]->data.Add(framedata);
-					}
-				}
-				break;
-			}
-			//printf( "%s\n", p );
-		//}
+		markers.Add(marker);
+	}
 
-	} //while(p);
-	
+	return true;
 }
 
 void csv_data::FilterFrameData()
@@ -380,8 +214,15 @@ void csv_data::CreateOpticalRigidBody( char* line )
 
 	} while(p);
 
-	rigidbodies[count-1]=rigidbody;
-	rigidbodies[0]->print_marker_setup();
+	if (count > 0 && count <= rigidbodies.GetCount() && rigidbodies[count-1] == NULL)
+	{
+		rigidbodies[count-1]=rigidbody;
+		rigidbody->print_marker_setup();
+	}
+	else
+	{
+		delete rigidbody;
+	}
 
 /*
 	model->RigidBodies.Add( lList, name );
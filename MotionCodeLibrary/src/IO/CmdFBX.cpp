@@ -15,13 +15,24 @@
 #include <tchar.h>
 
 #include "IO\CmdFBX.h"
+#include "IO\SharedJobQueue.h"
+#include "IO\InputModelBlob.h"
+
+#define CMDFBX_QUEUE_PREFIX			"cmdfbxqueue"	// process id and a counter are added, see MakeUniqueName
+#define CMDFBX_QUEUE_SLOTS			4
+#define CMDFBX_QUEUE_SLOT_SIZE		(32 * 1024 * 1024)
+#define CMDFBX_WORKER_START_TIMEOUT	10000
+#define CMDFBX_JOB_TIMEOUT			120000
+
+#define CMDFBX_FLAG_RESETXFORM		1
 
 // DONE: run cmdFBX application and fill data into the shared memory block
 
 //#ifdef CMD_SEND_CODE
 #include "IO\FileUtils.h"
 
-bool CmdMakeSnapshotFBX_Send(const char *filename, const char *uniqueName, InputModelData &data, const bool ResetXForm)
+// one process per snapshot, used when persistent worker is not available
+static bool CmdMakeSnapshotFBX_SendProcess(const char *filename, const char *uniqueName, InputModelData &data, const bool ResetXForm)
 {
 	LPTSTR	szMemoryName = _T("Local\\cmdfbxmem");
 	LPTSTR	szEventName = _T("Local\\cmdfbxevent");
@@ -121,30 +132,217 @@ bool CmdMakeSnapshotFBX_Send(const char *filename, const char *uniqueName, Input
 	return result;
 }
 
-//#endif
+/////////////////////////////////////////////////////////////////////////////////////////
+// persistent worker
 
-bool CmdMakeSnapshotFBX_Receive(InputModelData *data)
+static PersistentWorkerQueue	gWorkerQueue;
+static bool						gWorkerFailed = false;	// don't try to launch broken worker on every snapshot
+
+bool CmdFBXWorker_Start()
+{
+	if (gWorkerQueue.IsRunning() )
+		return true;
+
+	FBString out_path, out_fullpath;
+	if ( FindEffectLocation( "\\cmdFBX.exe", out_path, out_fullpath ) == false)
+	{
+		printf( "[CmdFBX] failed to find cmdFBX\n" );
+		return false;
+	}
+
+	std::vector<std::string> arguments;
+	arguments.push_back( std::string(out_fullpath) );
+
+	const std::string queueName = SharedJobQueue::MakeUniqueName(CMDFBX_QUEUE_PREFIX);
+
+	if (false == gWorkerQueue.Start( queueName.c_str(), arguments, CMDFBX_QUEUE_SLOTS, CMDFBX_QUEUE_SLOT_SIZE, CMDFBX_WORKER_START_TIMEOUT ) )
+	{
+		printf( "[CmdFBX] failed to start a persistent worker\n" );
+		gWorkerFailed = true;
+		return false;
+	}
+
+	gWorkerFailed = false;
+	return true;
+}
+
+void CmdFBXWorker_Stop()
+{
+	gWorkerQueue.Stop();
+}
+
+bool CmdFBXWorker_IsRunning()
+{
+	return gWorkerQueue.IsRunning();
+}
+
+static uint32_t CmdFBXWorker_Submit(const char *filename, const char *uniqueName, InputModelData &data, const bool ResetXForm)
 {
+	if (strlen(filename) >= SHARED_JOB_STRING_LENGTH || strlen(uniqueName) >= SHARED_JOB_STRING_LENGTH)
+		return 0;
 
+	const size_t size = data.ComputeTotalSize();
+	if (size > gWorkerQueue.GetSlotSize() )
+		return 0;
+
+	const uint32_t flags = (ResetXForm) ? CMDFBX_FLAG_RESETXFORM : 0;
+
+	return gWorkerQueue.Submit( filename, uniqueName, flags, [&data, size] (void *payload, const size_t capacity) -> size_t {
+		data.CopyToMemory(payload);
+		return size;
+	}, CMDFBX_WORKER_START_TIMEOUT );
+}
+
+bool CmdMakeSnapshotFBX_Send(const char *filename, const char *uniqueName, InputModelData &data, const bool ResetXForm)
+{
+	if (false == gWorkerFailed && CmdFBXWorker_Start() )
+	{
+		const uint32_t jobId = CmdFBXWorker_Submit(filename, uniqueName, data, ResetXForm);
+		if (jobId > 0)
+		{
+			const ESharedJobResult result = gWorkerQueue.Wait(jobId, CMDFBX_JOB_TIMEOUT);
+			if (eSharedJobResultDone == result)
+				return true;
+			else if (eSharedJobResultFailed == result)
+				return false;
+			// timeout or lost worker, try with a separate process
+		}
+	}
+
+	return CmdMakeSnapshotFBX_SendProcess(filename, uniqueName, data, ResetXForm);
+}
+
+bool CmdMakeSnapshotFBX_SendBatch(const int count, const char **filenames, const char **uniqueNames, InputModelData **data, const bool ResetXForm, bool *results)
+{
+	bool status = true;
+
+	if (false == gWorkerFailed)
+		CmdFBXWorker_Start();
+
+	std::vector<uint32_t>	jobs(count, 0);
+
+	int next = 0;
+
+	for (int waitIndex=0; waitIndex<count; ++waitIndex)
+	{
+		// keep the ring filled, a slot is released when we wait for its job
+		while (gWorkerQueue.IsRunning() && next < count && next - waitIndex < CMDFBX_QUEUE_SLOTS)
+		{
+			jobs[next] = CmdFBXWorker_Submit(filenames[next], uniqueNames[next], *data[next], ResetXForm);
+			next += 1;
+		}
+
+		bool done = false;
+		const uint32_t jobId = jobs[waitIndex];
+
+		if (jobId > 0)
+		{
+			const ESharedJobResult result = gWorkerQueue.Wait(jobId, CMDFBX_JOB_TIMEOUT);
+			
+			if (eSharedJobResultDone == result)
+				done = true;
+			else if (eSharedJobResultFailed != result)
+				done = CmdMakeSnapshotFBX_SendProcess(filenames[waitIndex], uniqueNames[waitIndex], *data[waitIndex], ResetXForm);
+		}
+		else
+		{
+			// too big for a slot or worker is not available
+			done = CmdMakeSnapshotFBX_SendProcess(filenames[waitIndex], uniqueNames[waitIndex], *data[waitIndex], ResetXForm);
+		}
+
+		if (results)
+			results[waitIndex] = done;
+		status = status && done;
+	}
+
+	return status;
+}
+
+//#endif
+
+// map the block of CmdMakeSnapshotFBX_SendProcess and wait until it's written, nullptr on a failure
+static const void *CmdMakeSnapshotFBX_OpenBlock(HANDLE &hMem, HANDLE &hEvent)
+{
 	LPTSTR	szMemoryName = _T("Local\\cmdfbxmem");
 	LPTSTR	szEventName = _T("Local\\cmdfbxevent");
 
-	HANDLE hMem, hEvent;
-	void *memory = nullptr;
+	const void *memory = nullptr;
 
 	hEvent = CreateEvent(NULL, FALSE, FALSE, szEventName);
 
-	if ((hMem = OpenFileMapping(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, szMemoryName)) != NULL) {
+	if ((hMem = OpenFileMapping(FILE_MAP_READ, FALSE, szMemoryName)) != NULL) {
 	
-		memory = MapViewOfFile(hMem, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+		memory = MapViewOfFile(hMem, FILE_MAP_READ, 0, 0, 0);
 
-		if(WaitForSingleObject(hEvent, 5000) == WAIT_OBJECT_0 ) {
-			
-			data->InitFromMemory( memory );
-			
-			return true;
-		}
+		if (memory && WaitForSingleObject(hEvent, 5000) == WAIT_OBJECT_0 )
+			return memory;
 	}
 
-	return false;
-}
\ No newline at end of file
+	return nullptr;
+}
+
+static void CmdMakeSnapshotFBX_CloseBlock(const void *memory, HANDLE hMem, HANDLE hEvent)
+{
+	if (memory)
+		UnmapViewOfFile(memory);
+	if (hMem)
+		CloseHandle(hMem);
+	if (hEvent)
+		CloseHandle(hEvent);
+}
+
+bool CmdMakeSnapshotFBX_Receive(InputModelData *data)
+{
+	HANDLE hMem = NULL;
+	HANDLE hEvent = NULL;
+
+	const void *memory = CmdMakeSnapshotFBX_OpenBlock(hMem, hEvent);
+	
+	InputModelBlobView view;
+	const bool result = (memory != nullptr) && view.Attach(memory) && ReadInputModelBlob(view, *data);
+
+	CmdMakeSnapshotFBX_CloseBlock(memory, hMem, hEvent);
+	return result;
+}
+
+bool CmdMakeSnapshotFBX_ReceiveSnapshot(const char *filename, const char *uniqueName, const bool ResetXForm)
+{
+	HANDLE hMem = NULL;
+	HANDLE hEvent = NULL;
+
+	const void *memory = CmdMakeSnapshotFBX_OpenBlock(hMem, hEvent);
+
+	// no unpack into InputModelData and no repack for the snapshot, the scene is built from the mapped block
+	InputModelBlobView view;
+	const bool result = (memory != nullptr) && view.Attach(memory) && MakeSnapshotFBX(filename, uniqueName, view, ResetXForm);
+
+	CmdMakeSnapshotFBX_CloseBlock(memory, hMem, hEvent);
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// worker side
+
+int CmdMakeSnapshotFBX_RunWorker(const char *queueName)
+{
+	if (false == InitSnapshotFBX() )
+		return 1;
+
+	const int result = RunSharedJobWorker( queueName, [] (const SharedJobSlot &slot, const void *payload, int &resultCode) -> bool {
+		
+		// geometry is read in place from the slot
+		InputModelBlobView data;
+		if (false == data.Attach( payload, (size_t) slot.payloadSize ) )
+		{
+			resultCode = 2;
+			return false;
+		}
+
+		const bool status = MakeSnapshotFBX( slot.name0, slot.name1, data, 0 != (slot.flags & CMDFBX_FLAG_RESETXFORM) );
+		resultCode = (status) ? 0 : 1;
+		return status;
+	} );
+
+	FreeSnapshotFBX();
+	return result;
+}
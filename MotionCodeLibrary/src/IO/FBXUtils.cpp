@@ -12,6 +12,7 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "IO\FBXUtils.h"
+#include "IO\InputModelBlob.h"
 #include "fbxsdk.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -65,20 +66,23 @@ FbxGeometryElement::EReferenceMode	ConvertORReferenceModeToFBX(const FBGeometryR
 
 // DONE: support clusters !
 // Snapshot of a pModel
-FbxNode* CreateSnapshot(FbxScene* pScene, const char* pName, const InputModelData &data, const bool clusters)
+FbxNode* CreateSnapshot(FbxScene* pScene, const char* pName, const InputModelBlobView &data, const bool clusters)
 {
+	const InputModelBlobHeader *header = data.GetHeader();
+
 	
 	// create the main structure.
     FbxMesh* lMesh = FbxMesh::Create(pScene,"");
 	
     // Create control points.
-	int vertCountInMesh = data.positions.size();
+	int vertCountInMesh = data.GetPositionCount();
     lMesh->InitControlPoints(vertCountInMesh);
     FbxVector4* vertex = lMesh->GetControlPoints();
+	const Float4 *positions = data.GetPositions();
 	
 	for (int i=0; i<vertCountInMesh; ++i)
 	{
-		vertex[i].Set( data.positions[i].x[0], data.positions[i].x[1], data.positions[i].x[2] );
+		vertex[i].Set( positions[i].x[0], positions[i].x[1], positions[i].x[2] );
 	}
     //memcpy((void*)vertex, (void*)positions, vertCountInMesh*sizeof(FbxVector4));
 
@@ -86,7 +90,7 @@ FbxNode* CreateSnapshot(FbxScene* pScene, const char* pName, const InputModelDat
     /* Each polygon face will be assigned a unique material.
     */
    
-	const int materialIndexCount = data.materialIndices.size();
+	const int materialIndexCount = data.GetCount(eBlobMaterialIndices);
 	if (materialIndexCount > 0)
 	{
 		FbxGeometryElementMaterial* lMaterialElement = lMesh->CreateElementMaterial();
@@ -107,16 +111,17 @@ FbxNode* CreateSnapshot(FbxScene* pScene, const char* pName, const InputModelDat
     // Create polygons later after FbxGeometryElementMaterial is created. Assign material indices.
 
 	// Step 2: copy polygons
-	int polyCount = data.polyInfo.size();
+	int polyCount = data.GetPolyCount();
 	for (int i=0; i<polyCount; ++i)
 	{
-		int vertCount = data.polyInfo[i].vertexCount;
+		int vertCount = data.GetPolyVertexCount(i);
+		const int *indices = data.GetPolyIndices(i);
 		int matId = -1;
 			
 		
 		//if (data.materialMapping == FbxGeometryElement::eByPolygon)
 		//{
-		matId = data.polyInfo[i].materialId;
+		matId = data.GetPolyMaterial(i);
 		//}
 	
 		if (matId < 0)
@@ -128,7 +133,7 @@ FbxNode* CreateSnapshot(FbxScene* pScene, const char* pName, const InputModelDat
 		lMesh->BeginPolygon( matId );
 		for (int j=0; j<vertCount; ++j)
 		{
-			lMesh->AddPolygon( data.polyInfo[i].indices[j] );
+			lMesh->AddPolygon( indices[j] );
 		}
 		lMesh->EndPolygon();
 	}
@@ -136,52 +141,56 @@ FbxNode* CreateSnapshot(FbxScene* pScene, const char* pName, const InputModelDat
 
     // specify normals per control point.
     FbxGeometryElementNormal* lNormalElement = lMesh->CreateElementNormal();
-	lNormalElement->SetMappingMode( FbxGeometryElement::EMappingMode(data.normalMapping) );
-	lNormalElement->SetReferenceMode( FbxGeometryElement::EReferenceMode(data.normalReferenceMode) );
+	lNormalElement->SetMappingMode( FbxGeometryElement::EMappingMode(header->normalMapping) );
+	lNormalElement->SetReferenceMode( FbxGeometryElement::EReferenceMode(header->normalReferenceMode) );
 
-	int normalDirectCount = data.normalsDirect.size();
+	int normalDirectCount = data.GetCount(eBlobNormalsDirect);
+	const Float4 *normalsDirect = data.GetArray<Float4>(eBlobNormalsDirect);
 	for (int i=0; i<normalDirectCount; ++i)
-		lNormalElement->GetDirectArray().Add( FbxVector4(data.normalsDirect[i].x[0], data.normalsDirect[i].x[1], data.normalsDirect[i].x[2]) );
+		lNormalElement->GetDirectArray().Add( FbxVector4(normalsDirect[i].x[0], normalsDirect[i].x[1], normalsDirect[i].x[2]) );
 
-	int normalIndicesCount = data.normalIndices.size();
+	int normalIndicesCount = data.GetCount(eBlobNormalIndices);
+	const int *normalIndices = data.GetArray<int>(eBlobNormalIndices);
 	for (int i=0; i<normalIndicesCount; ++i)
-		lNormalElement->GetIndexArray().Add( data.normalIndices[i] );
+		lNormalElement->GetIndexArray().Add( normalIndices[i] );
 
 
     // Create the node containing the mesh
     FbxNode* lNode = FbxNode::Create(pScene,pName);
 
 	
-	lNode->LclTranslation.Set( FbxDouble3(data.LclPosition[0], data.LclPosition[1], data.LclPosition[2]) );
-	lNode->LclRotation.Set( FbxDouble3(data.LclRotation[0], data.LclRotation[1], data.LclRotation[2]) );
-	lNode->LclScaling.Set( FbxDouble3(data.LclScaling[0], data.LclScaling[1], data.LclScaling[2]) );
+	lNode->LclTranslation.Set( FbxDouble3(header->LclPosition[0], header->LclPosition[1], header->LclPosition[2]) );
+	lNode->LclRotation.Set( FbxDouble3(header->LclRotation[0], header->LclRotation[1], header->LclRotation[2]) );
+	lNode->LclScaling.Set( FbxDouble3(header->LclScaling[0], header->LclScaling[1], header->LclScaling[2]) );
 
     lNode->SetNodeAttribute(lMesh);
     lNode->SetShadingMode(FbxNode::eTextureShading);   
     
     // create UVset
 
-	if (data.uvSetName != nullptr)
+	if (header->uvSetName[0] != 0 || data.GetCount(eBlobUVs) > 0)
 	{
-		FbxGeometryElementUV* lUVElement1 = lMesh->CreateElementUV( data.uvSetName );
+		FbxGeometryElementUV* lUVElement1 = lMesh->CreateElementUV( header->uvSetName );
 		FBX_ASSERT( lUVElement1 != NULL);
 
-		lUVElement1->SetMappingMode( FbxGeometryElement::EMappingMode(data.uvSetMapping) );
-		lUVElement1->SetReferenceMode( FbxGeometryElement::EReferenceMode(data.uvSetReferenceMode) );
+		lUVElement1->SetMappingMode( FbxGeometryElement::EMappingMode(header->uvSetMapping) );
+		lUVElement1->SetReferenceMode( FbxGeometryElement::EReferenceMode(header->uvSetReferenceMode) );
 		
-		int uvDirectCount = data.uvs.size();
+		int uvDirectCount = data.GetCount(eBlobUVs);
+		const Float2 *uvs = data.GetArray<Float2>(eBlobUVs);
 		for (int j=0; j<uvDirectCount; ++j)
-			lUVElement1->GetDirectArray().Add( FbxVector2(data.uvs[j].x[0], data.uvs[j].x[1]) );
+			lUVElement1->GetDirectArray().Add( FbxVector2(uvs[j].x[0], uvs[j].x[1]) );
 
-		int uvIndicesCount = data.uvIndices.size();
+		int uvIndicesCount = data.GetCount(eBlobUVIndices);
+		const int *uvIndices = data.GetArray<int>(eBlobUVIndices);
 		for (int j=0; j<uvIndicesCount; ++j)
-			lUVElement1->GetIndexArray().Add(data.uvIndices[j]);
+			lUVElement1->GetIndexArray().Add(uvIndices[j]);
 	}
 
     return lNode;
 }
 
-bool CreateScene(FbxManager *pSdkManager, FbxScene* pScene, const char *snapshotName, InputModelData &data)
+bool CreateScene(FbxManager *pSdkManager, FbxScene* pScene, const char *snapshotName, const InputModelBlobView &data)
 {
     // create scene info
     FbxDocumentInfo* sceneInfo = FbxDocumentInfo::Create(pSdkManager,"SceneInfo");
@@ -276,7 +285,47 @@ bool CreateScene(FbxManager *pSdkManager, FbxScene* pScene, const char *snapshot
     return true;
 }
 
+// manager is kept between snapshots when running as a persistent worker
+static FbxManager	*gSnapshotManager = nullptr;
+
+bool InitSnapshotFBX()
+{
+	if (gSnapshotManager)
+		return true;
+
+	FbxScene *lScene = nullptr;
+	InitializeSdkObjects(gSnapshotManager, lScene);
+	
+	// scene is created per snapshot
+	if (lScene)
+		lScene->Destroy(true);
+
+	return (gSnapshotManager != nullptr);
+}
+
+void FreeSnapshotFBX()
+{
+	if (gSnapshotManager)
+	{
+		DestroySdkObjects(gSnapshotManager, false);
+		gSnapshotManager = nullptr;
+	}
+}
+
 bool MakeSnapshotFBX(const char *filename, const char *snapshotName, InputModelData &data, const bool ResetXForm)
+{
+	// pack into the flat layout, snapshot scene is built from it
+	std::vector<unsigned char>	blob( ComputeInputModelBlobSize(data) );
+	WriteInputModelBlob( data, blob.data(), blob.size() );
+
+	InputModelBlobView view;
+	if (false == view.Attach(blob.data(), blob.size()) )
+		return false;
+
+	return MakeSnapshotFBX(filename, snapshotName, view, ResetXForm);
+}
+
+bool MakeSnapshotFBX(const char *filename, const char *snapshotName, const InputModelBlobView &data, const bool ResetXForm)
 {
 	//
 	// Create a new FBX file
@@ -286,6 +335,24 @@ bool MakeSnapshotFBX(const char *filename, const char *snapshotName, InputModelD
     FbxScene* lScene = NULL;
     bool lResult;
 
+	if (gSnapshotManager)
+	{
+		// reuse persistent sdk objects, only the scene is temporary
+		lSdkManager = gSnapshotManager;
+		lScene = FbxScene::Create(lSdkManager, "My Scene");
+
+		lResult = (lScene != nullptr) && CreateScene(lSdkManager, lScene, snapshotName, data);
+		if (lResult)
+			lResult = SaveScene(lSdkManager, lScene, filename);
+
+		if(lResult == false)
+			FBXSDK_printf("\n\nAn error occurred while making the snapshot...\n");
+
+		if (lScene)
+			lScene->Destroy(true);
+		return lResult;
+	}
+
     // Prepare the FBX SDK.
     InitializeSdkObjects(lSdkManager, lScene);
 
@@ -429,490 +496,21 @@ bool SaveScene(FbxManager* pManager, FbxDocument* pScene, const char* pFilename,
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 
-size_t InputModelData::PolyInfo::ComputeTotalSize()
-{
-	size_t size = 0;
-	
-	size += 4;	// materialId
-	size += 4;	// vertexCount
-	size += 4;	// number of indices
-	size += sizeof(int) * vertexCount;
-
-	return size;
-}
-
-size_t	InputModelData::DeformedVertex::ComputeTotalSize()
-{
-	return (sizeof(int) + sizeof(float));
-}
-
-size_t	InputModelData::Cluster::ComputeTotalSize()
-{
-	size_t size = 0;
-
-	size += sizeof(char) * STRING_MAX_LENGTH;
-	size += sizeof(int);
-	size += sizeof(char) * STRING_MAX_LENGTH;
-	
-	size += sizeof(double) * 9;
-	size += sizeof(double) * 9;
-
-	size += sizeof(int);
-
-	size += sizeof(int);
-	for (auto iter=vertices.begin(); iter!=vertices.end(); ++iter)
-		size += iter->ComputeTotalSize();
-
-	return size;
-}
+// transfer format is a flat blob, see InputModelBlob.h
 
 size_t	InputModelData::ComputeTotalSize()
 {
-	size_t size = 0;
-
-	// positions
-	size += 4; // number of positions
-	size += (sizeof(Float4) * positions.size() );
-
-	// material mapping
-	size += 4;	// int
-	size += 4;	// number of material indices
-	size += (sizeof(int) * materialIndices.size() );
-
-	// number of polyInfo
-	size += 4;
-
-	for (auto iter=polyInfo.begin(); iter!=polyInfo.end(); ++iter)
-		size += iter->ComputeTotalSize();
-
-	// normals
-
-	size += 4;	// normal mapping
-	size += 4;	// normal reference mode
-
-	size += 4; // number of normals direct
-	size += sizeof(Float4) * normalsDirect.size();
-	size += 4; // number of normals indices
-	size += sizeof(int) * normalIndices.size();
-
-	// transformation 
-
-	// Lcl position, rotation, scaling
-	size += sizeof(double) * 9;
-
-	//
-	// uvset
-
-	size += sizeof(char) * STRING_MAX_LENGTH;
-	size += 4; // uvsetmapping
-	size += 4; // uvset reference mode
-
-	size += 4; //number of uvs
-	size += sizeof(Float2) * uvs.size();
-	size += 4; // number of uv indices
-	size += sizeof(int) * uvIndices.size();
-
-	// properties
-
-	//
-	size += sizeof(char) * STRING_MAX_LENGTH;	// baseModelname
-	size += sizeof(double);	// snapshot time
-
-	// clusters
-
-	size += sizeof(int);
-	for (auto iter=clusters.begin(); iter!=clusters.end(); ++iter)
-		size += (*iter)->ComputeTotalSize();
-
-	//
-
-	return size;
-}
-
-size_t InputModelData::PolyInfo::CopyToMemory(void *memory)
-{
-	int *intPtr = (int*) memory;
-	*intPtr = materialId;
-	intPtr++;
-	*intPtr = vertexCount;
-	intPtr++;
-	if (vertexCount > 0)
-		memcpy( intPtr, indices, sizeof(int) * vertexCount );
-
-	return (sizeof(int) + sizeof(int) + sizeof(int) * vertexCount);
-}
-
-size_t InputModelData::DeformedVertex::CopyToMemory(void *memory)
-{
-	int *intPtr = (int*) memory;
-	*intPtr = index;
-	intPtr++;
-	float *floatptr = (float*) intPtr;
-	*floatptr = weight;
-
-	return (sizeof(int) + sizeof(float));
-}
-
-size_t InputModelData::Cluster::CopyToMemory(void *memory)
-{
-	unsigned char *szptr = (unsigned char*) memory;
-
-	memcpy( szptr, name, sizeof(char) * STRING_MAX_LENGTH );
-	szptr += sizeof(char) * STRING_MAX_LENGTH;
-
-	*( (int*) szptr ) = parent;
-	szptr += sizeof(int);
-
-	memcpy( szptr, modelname, sizeof(char) * STRING_MAX_LENGTH );
-	szptr += sizeof(char) * STRING_MAX_LENGTH;
-
-	memcpy( szptr, LclPosition, sizeof(double) * 3 );
-	szptr += sizeof(double) * 3;
-	memcpy( szptr, LclRotation, sizeof(double) * 3 );
-	szptr += sizeof(double) * 3;
-	memcpy( szptr, LclScaling, sizeof(double) * 3 );
-	szptr += sizeof(double) * 3;
-
-	memcpy( szptr, LinkPosition, sizeof(double) * 3 );
-	szptr += sizeof(double) * 3;
-	memcpy( szptr, LinkRotation, sizeof(double) * 3 );
-	szptr += sizeof(double) * 3;
-	memcpy( szptr, LinkScaling, sizeof(double) * 3 );
-	szptr += sizeof(double) * 3;
-
-	*( (int*) szptr ) = mode;
-	szptr += sizeof(int);
-
-	*( (int*) szptr ) = (int) vertices.size();
-	szptr += sizeof(int);
-
-	for (auto iter=vertices.begin(); iter!=vertices.end(); ++iter)
-	{
-		size_t localsize = iter->CopyToMemory(szptr);
-		szptr += localsize;
-	}
-
-	return ComputeTotalSize();
+	return ComputeInputModelBlobSize(*this);
 }
 
 void	InputModelData::CopyToMemory(void *memory)
 {
-	size_t size = 0;
-
-	unsigned char *szPtr = (unsigned char*) memory;
-	int *intPtr = (int*) memory;
-
-	auto fn_putInt = [&] (const int value) {
-		intPtr = (int*) szPtr;
-		*intPtr = value;
-		szPtr += sizeof(int);
-	};
-
-	fn_putInt( (int) positions.size() );
-
-	size = sizeof(Float4) * positions.size();
-	if (size > 0)
-	{
-		memcpy( szPtr, positions.data(), size );
-		szPtr += size;
-	}
-
-
-	// material
-	fn_putInt(materialMapping);
-	fn_putInt( (int) materialIndices.size() );
-
-	size = sizeof(int) * materialIndices.size();
-	if (size > 0)
-	{
-		memcpy( szPtr, materialIndices.data(), size );
-		szPtr += size;
-	}
-
-	// poly info
-	fn_putInt( (int) polyInfo.size() );
-
-	for (auto iter=polyInfo.begin(); iter!=polyInfo.end(); ++iter)
-	{
-		size_t localSize = iter->CopyToMemory(szPtr);
-		szPtr += localSize; // offset ptr
-	}
-
-	// normals
-
-	fn_putInt( normalMapping );
-	fn_putInt( normalReferenceMode );
-
-	fn_putInt( (int) normalsDirect.size() );
-	size = sizeof(Float4) * normalsDirect.size();
-	if (size > 0)
-	{
-		memcpy( szPtr, normalsDirect.data(), size );
-		szPtr += size;
-	}
-
-	fn_putInt( (int) normalIndices.size() );
-	size = sizeof(int) * normalIndices.size();
-	if (size > 0)
-	{
-		memcpy( szPtr, normalIndices.data(), size );
-		szPtr += size;
-	}
-
-	// transformation
-
-	memcpy( szPtr, LclPosition, sizeof(double) * 3 );
-	szPtr += sizeof(double) * 3;
-	memcpy( szPtr, LclRotation, sizeof(double) * 3 );
-	szPtr += sizeof(double) * 3;
-	memcpy( szPtr, LclScaling, sizeof(double) * 3 );
-	szPtr += sizeof(double) * 3;
-
-	// uvset
-
-	memcpy( szPtr, uvSetName, sizeof(char) * STRING_MAX_LENGTH );
-	szPtr += sizeof(char) * STRING_MAX_LENGTH;
-
-	fn_putInt( uvSetMapping );
-	fn_putInt( uvSetReferenceMode );
-
-	fn_putInt( (int) uvs.size() );
-	size = sizeof(Float2) * uvs.size();
-	if (size > 0)
-	{
-		memcpy( szPtr, uvs.data(), size );
-		szPtr += size;
-	}
-	fn_putInt( (int) uvIndices.size() );
-	size = sizeof(int) * uvIndices.size();
-	if (size > 0)
-	{
-		memcpy( szPtr, uvIndices.data(), size );
-		szPtr += size;
-	}
-
-	// properties
-
-	memcpy( szPtr, baseModelName, sizeof(char) * STRING_MAX_LENGTH );
-	szPtr += sizeof(char) * STRING_MAX_LENGTH;
-
-	memcpy( szPtr, &snapshotTime, sizeof(double) );
-	szPtr += sizeof(double);
-
-	// clusters
-
-	fn_putInt( (int) clusters.size() );
-	for (auto iter=clusters.begin(); iter!=clusters.end(); ++iter)
-	{
-		size_t localsize = (*iter)->CopyToMemory(szPtr);
-		szPtr += localsize;
-	}
-}
-
-size_t InputModelData::PolyInfo::InitFromMemory(void *memory)
-{
-	Free();
-
-	int *intPtr = (int *) memory;
-	materialId = *intPtr;
-	intPtr++;
-	vertexCount = *intPtr;
-	intPtr++;
-
-	if (vertexCount > 0)
-	{
-		indices = new int[vertexCount];
-		memcpy( indices, intPtr, sizeof(int) * vertexCount );
-	}
-
-	return (sizeof(int) + sizeof(int) + sizeof(int) * vertexCount);
-}
-
-size_t InputModelData::DeformedVertex::InitFromMemory(void *memory)
-{
-	unsigned char *szptr = (unsigned char*) memory;
-	index = *( (int*) szptr );
-	szptr += sizeof(int);
-	weight = *( (float*) szptr );
-	
-	return (sizeof(int) + sizeof(float) );
-}
-
-size_t InputModelData::Cluster::InitFromMemory(void *memory)
-{
-	unsigned char *szptr = (unsigned char*) memory;
-
-	memcpy( name, szptr, sizeof(char)*STRING_MAX_LENGTH );
-	szptr += sizeof(char) * STRING_MAX_LENGTH;
-
-	parent = *( (int*) szptr );
-	szptr += sizeof(int);
-
-	memcpy( modelname, szptr, sizeof(char)*STRING_MAX_LENGTH );
-	szptr += sizeof(char) * STRING_MAX_LENGTH;
-
-	memcpy( LclPosition, szptr, sizeof(double)*3 );
-	szptr += sizeof(double) * 3;
-	memcpy( LclRotation, szptr, sizeof(double)*3 );
-	szptr += sizeof(double) * 3;
-	memcpy( LclScaling, szptr, sizeof(double)*3 );
-	szptr += sizeof(double) * 3;
-
-	memcpy( LinkPosition, szptr, sizeof(double)*3 );
-	szptr += sizeof(double) * 3;
-	memcpy( LinkRotation, szptr, sizeof(double)*3 );
-	szptr += sizeof(double) * 3;
-	memcpy( LinkScaling, szptr, sizeof(double)*3 );
-	szptr += sizeof(double) * 3;
-
-	mode = *( (int*) szptr );
-	szptr += sizeof(int);
-
-	int value = *( (int*) szptr );
-	szptr += sizeof(int);
-
-	vertices.resize(value);
-	for (auto iter=vertices.begin(); iter!=vertices.end(); ++iter)
-	{
-		size_t localsize = iter->InitFromMemory(szptr);
-		szptr += localsize;
-	}
-
-	return ComputeTotalSize();
+	WriteInputModelBlob(*this, memory, ComputeInputModelBlobSize(*this) );
 }
 
 void	InputModelData::InitFromMemory(void *memory)
 {
-	unsigned char *szPtr = (unsigned char *) memory;
-	int *intPtr = (int*) szPtr;
-	int value;
-	size_t size = 0;
-
-	auto fn_getInt = [&] () -> int {
-		intPtr = (int*) szPtr;
-		value = *intPtr;
-		szPtr += sizeof(int);
-		return value;
-	};
-
-	// positions
-
-	fn_getInt();
-	positions.resize( value );
-	if (value > 0)
-	{
-		size = sizeof(Float4) * value;
-		memcpy( positions.data(), szPtr, size );
-		szPtr += size;
-	}
-
-	// material
-
-	fn_getInt();
-	materialMapping = value;
-	
-	fn_getInt();
-	materialIndices.resize(value);
-	if (value > 0) {
-		size = sizeof(int) * value;
-		memcpy( materialIndices.data(), szPtr, size );
-		szPtr += size;
-	}
-
-	// poly info
-
-	fn_getInt();
-	polyInfo.resize( value );
-	if (value > 0)
-	{
-		for (auto iter=polyInfo.begin(); iter!=polyInfo.end(); ++iter)
-		{
-			size_t localsize = iter->InitFromMemory(szPtr);
-			szPtr += localsize;
-		}
-	}
-
-	// normals
-
-	fn_getInt();
-	normalMapping = value;
-	fn_getInt();
-	normalReferenceMode = value;
-
-	fn_getInt();
-	normalsDirect.resize( value );
-	if (value > 0)
-	{
-		size = sizeof(Float4) * value;
-		memcpy( normalsDirect.data(), szPtr, size );
-		szPtr += size;
-	}
-
-	fn_getInt();
-	normalIndices.resize( value );
-	if (value > 0)
-	{
-		size = sizeof(int) * value;
-		memcpy( normalIndices.data(), szPtr, size );
-		szPtr += size;
-	}
-
-	// transformation
-
-	memcpy( LclPosition, szPtr, sizeof(double) * 3 );
-	szPtr += sizeof(double) * 3;
-	memcpy( LclRotation, szPtr, sizeof(double) * 3 );
-	szPtr += sizeof(double) * 3;
-	memcpy( LclScaling, szPtr, sizeof(double) * 3 );
-	szPtr += sizeof(double) * 3;
-
-	// uvset
-
-	memcpy( uvSetName, szPtr, sizeof(char) * STRING_MAX_LENGTH );
-	szPtr += sizeof(char) * STRING_MAX_LENGTH;
-
-	fn_getInt();
-	uvSetMapping = value;
-	fn_getInt();
-	uvSetReferenceMode = value;
-
-	fn_getInt();
-	uvs.resize(value);
-	if (value > 0)
-	{
-		size = sizeof(Float2) * value;
-		memcpy( uvs.data(), szPtr, size );
-		szPtr += size;
-	}
-
-	fn_getInt();
-	uvIndices.resize(value);
-	if (value > 0)
-	{
-		size = sizeof(int) * value;
-		memcpy( uvIndices.data(), szPtr, size );
-		szPtr += size;
-	}
-
-	// properties
-
-	memcpy( baseModelName, szPtr, sizeof(char) * STRING_MAX_LENGTH );
-	szPtr += sizeof(char) * STRING_MAX_LENGTH;
-
-	memcpy( &snapshotTime, szPtr, sizeof(double) );
-	szPtr += sizeof(double);
-
-	// clusters
-
-	fn_getInt();
-	
-	for (int i=0; i<value; ++i)
-	{
-		Cluster *pCluster = new Cluster();
-		size_t localsize = pCluster->InitFromMemory(szPtr);
-		szPtr += localsize;
-
-		clusters.insert(pCluster);
-	}
-
-}
\ No newline at end of file
+	InputModelBlobView view;
+	if (view.Attach(memory) )
+		ReadInputModelBlob(view, *this);
+}
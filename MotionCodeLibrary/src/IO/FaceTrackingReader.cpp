@@ -0,0 +1,1594 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: FaceTrackingReader.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "IO\FaceTrackingReader.h"
+#include "IO\MappedFile.h"
+#include "IO\FastNumberParser.h"
+#include "algorithm\ParallelFor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+
+#define		FACE_MIN_CHUNK_SIZE			(256 * 1024)
+#define		FACE_CHUNKS_PER_THREAD		4
+#define		FACE_DETECT_SIZE			4096
+#define		FACE_MAX_POINTS				4096
+
+typedef std::chrono::steady_clock	face_clock;
+
+static double ElapsedMs(const face_clock::time_point &start)
+{
+	return std::chrono::duration<double, std::milli>(face_clock::now() - start).count();
+}
+
+namespace
+{
+	const float kMissing = std::numeric_limits<float>::quiet_NaN();
+
+	// rows of one text chunk, scattered into columns after all chunks are parsed
+	struct ChunkRows
+	{
+		std::vector<int>		frames;
+		std::vector<float>		values;		// u,v per landmark, NaN for a missing sample
+		int						firstRow;
+
+		ChunkRows()
+			: firstRow(0)
+		{}
+	};
+
+	inline bool LineStartsWith(const char *p, const char *end, const char *token)
+	{
+		const size_t len = strlen(token);
+		return (size_t)(end - p) >= len && 0 == strncmp(p, token, len);
+	}
+
+	inline const char *NextLine(const char *p, const char *end)
+	{
+		const char *eol = (const char*) memchr(p, '\n', end - p);
+		return (eol) ? eol + 1 : end;
+	}
+
+	inline bool IsBlankLine(const char *p, const char *end)
+	{
+		p = SkipSpaces(p, end);
+		return p >= end || *p == '\n';
+	}
+
+	// next space separated token, returns the token end
+	inline const char *NextToken(const char *p, const char *end, const char *&tokenBegin)
+	{
+		p = SkipSpaces(p, end);
+		tokenBegin = p;
+		while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+			++p;
+		return p;
+	}
+
+	// chunk starts on line boundaries, the last value is the end of data
+	void SplitLines(const char *data, const size_t bodyStart, const size_t size, const int numberOfThreads, std::vector<size_t> &chunkStarts)
+	{
+		const int numberOfWorkers = ParallelForThreadCount(numberOfThreads);
+		size_t chunkSize = (size - bodyStart) / (numberOfWorkers * FACE_CHUNKS_PER_THREAD) + 1;
+		if (chunkSize < FACE_MIN_CHUNK_SIZE)
+			chunkSize = FACE_MIN_CHUNK_SIZE;
+
+		chunkStarts.clear();
+
+		size_t offset = bodyStart;
+		while (offset < size)
+		{
+			chunkStarts.push_back(offset);
+
+			const size_t next = offset + chunkSize;
+			if (next >= size)
+				break;
+			offset = NextLine(data + next, data + size) - data;
+		}
+		chunkStarts.push_back(size);
+	}
+
+	// integer and fraction of a decimal comma value go into two csv fields, "-0,05" keeps the sign and leading zeros
+	const char *ParseCommaPair(const char *p, const char *end, double &value)
+	{
+		p = SkipSpaces(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			++p;
+		}
+
+		const char *start = p;
+		double integer = 0.0;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			integer = integer * 10.0 + (*p - '0');
+			++p;
+		}
+
+		if (p == start)
+			return nullptr;
+
+		p = SkipField(p, end);
+
+		double fraction = 0.0;
+		double scale = 1.0;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			fraction = fraction * 10.0 + (*p - '0');
+			scale *= 10.0;
+			++p;
+		}
+
+		value = integer + fraction / scale;
+		if (negative)
+			value = -value;
+
+		return SkipField(p, end);
+	}
+
+	//
+	// xml helpers, just enough for the Analyzer export
+
+	// find "<tag" followed by a space or a tag end
+	const char *FindTag(const char *p, const char *end, const char *tag, const size_t tagLen)
+	{
+		while (p < end)
+		{
+			p = (const char*) memchr(p, '<', end - p);
+			if (nullptr == p)
+				return end;
+
+			if ((size_t)(end - p) > tagLen + 1 && 0 == strncmp(p+1, tag, tagLen))
+			{
+				const char c = p[tagLen + 1];
+				if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '>' || c == '/')
+					return p;
+			}
+			++p;
+		}
+		return end;
+	}
+
+	inline const char *FindTagEnd(const char *p, const char *end)
+	{
+		const char *close = (const char*) memchr(p, '>', end - p);
+		return (close) ? close : end;
+	}
+
+	// value of an attribute inside [tagBegin; tagEnd)
+	bool GetAttribute(const char *p, const char *end, const char *name, const char *&valueBegin, const char *&valueEnd)
+	{
+		const size_t nameLen = strlen(name);
+
+		// skip tag name
+		while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+			++p;
+
+		while (p < end)
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+				++p;
+
+			const char *attrBegin = p;
+			while (p < end && *p != '=' && *p != ' ' && *p != '>' && *p != '/')
+				++p;
+			const char *attrEnd = p;
+
+			while (p < end && *p == ' ')
+				++p;
+			if (p >= end || *p != '=')
+				return false;
+			++p;
+			while (p < end && *p == ' ')
+				++p;
+			if (p >= end || (*p != '"' && *p != '\''))
+				return false;
+
+			const char quote = *p;
+			const char *vb = ++p;
+			const char *ve = (const char*) memchr(p, quote, end - p);
+			if (nullptr == ve)
+				return false;
+
+			if ((size_t)(attrEnd - attrBegin) == nameLen && 0 == strncmp(attrBegin, name, nameLen))
+			{
+				valueBegin = vb;
+				valueEnd = ve;
+				return true;
+			}
+			p = ve + 1;
+		}
+		return false;
+	}
+
+	void DecodeXmlText(const char *p, const char *end, std::string &text)
+	{
+		text.clear();
+		while (p < end)
+		{
+			if (*p == '&')
+			{
+				struct Entity { const char *code; char c; };
+				static const Entity entities[] = { {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''} };
+
+				bool found = false;
+				for (int i=0; i<5; ++i)
+				{
+					if (LineStartsWith(p, end, entities[i].code))
+					{
+						text.push_back(entities[i].c);
+						p += strlen(entities[i].code);
+						found = true;
+						break;
+					}
+				}
+				if (found)
+					continue;
+			}
+			text.push_back(*p);
+			++p;
+		}
+	}
+
+	// attribute number, Analyzer writes the system decimal separator
+	bool ParseAttributeNumber(const char *p, const char *end, double &value)
+	{
+		char buffer[64];
+		const size_t len = std::min((size_t)(end - p), sizeof(buffer));
+
+		for (size_t i=0; i<len; ++i)
+			buffer[i] = (p[i] == ',') ? '.' : p[i];
+
+		return nullptr != ParseDouble(buffer, buffer + len, value);
+	}
+
+	bool GetAttributeNumber(const char *tagBegin, const char *tagEnd, const char *name, double &value)
+	{
+		const char *vb, *ve;
+		return GetAttribute(tagBegin, tagEnd, name, vb, ve) && ParseAttributeNumber(vb, ve, value);
+	}
+
+	// landmarks of a range of <frame> elements, names are local to the block and merged later
+	struct FacewareBlock
+	{
+		struct Sample
+		{
+			int		landmark;
+			int		frame;		// index in the block
+			float	u;
+			float	v;
+		};
+
+		std::vector<int>			frames;
+		std::vector<Sample>			samples;
+
+		std::vector<std::string>	names;
+		std::vector<std::string>	groups;
+		std::unordered_map<std::string, int>	lookup;
+
+		std::vector<int>			remap;		// local landmark -> global landmark
+		int							firstRow;
+	};
+
+	void ParseFacewareFrame(const char *p, const char *end, const int defaultFrame, FacewareBlock &block)
+	{
+		const int frameIndex = (int) block.frames.size();
+		const char *tagEnd = FindTagEnd(p, end);
+
+		double value = 0.0;
+		block.frames.push_back( (GetAttributeNumber(p, tagEnd, "value", value)) ? (int) value : defaultFrame );
+
+		std::string group;
+		std::string name;
+		int landmark = -1;
+
+		p = tagEnd;
+
+		while (p < end)
+		{
+			p = (const char*) memchr(p, '<', end - p);
+			if (nullptr == p)
+				break;
+
+			const char *tagBegin = p;
+			tagEnd = FindTagEnd(p, end);
+			p = tagEnd;
+
+			const char *vb, *ve;
+
+			if (LineStartsWith(tagBegin, tagEnd, "<markup_group ") || LineStartsWith(tagBegin, tagEnd, "<markup_group\t"))
+			{
+				if (GetAttribute(tagBegin, tagEnd, "name", vb, ve))
+					DecodeXmlText(vb, ve, group);
+				else
+					group.clear();
+			}
+			else if (LineStartsWith(tagBegin, tagEnd, "<landmark ") || LineStartsWith(tagBegin, tagEnd, "<landmark\t"))
+			{
+				landmark = -1;
+				if (false == GetAttribute(tagBegin, tagEnd, "name", vb, ve))
+					continue;
+
+				DecodeXmlText(vb, ve, name);
+
+				auto iter = block.lookup.find(name);
+				if (iter == block.lookup.end())
+				{
+					landmark = (int) block.names.size();
+					block.lookup[name] = landmark;
+					block.names.push_back(name);
+					block.groups.push_back(group);
+				}
+				else
+				{
+					landmark = iter->second;
+				}
+			}
+			else if (landmark >= 0 && LineStartsWith(tagBegin, tagEnd, "<texCoord"))
+			{
+				double u = 0.0, v = 0.0;
+				if (GetAttributeNumber(tagBegin, tagEnd, "u", u) && GetAttributeNumber(tagBegin, tagEnd, "v", v))
+				{
+					FacewareBlock::Sample sample;
+					sample.landmark = landmark;
+					sample.frame = frameIndex;
+					sample.u = (float) u;
+					sample.v = (float) v;
+					block.samples.push_back(sample);
+				}
+				landmark = -1;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// FaceTrackingData
+
+FaceTrackingData::FaceTrackingData()
+{
+	FreeData();
+}
+
+void FaceTrackingData::FreeData()
+{
+	mFormat = eFaceTrackingUnknown;
+	mLastError.clear();
+
+	mRowCount = 0;
+	mFrames.clear();
+	mColumns.clear();
+	mNames.clear();
+	mGroups.clear();
+
+	mSourceWidth = 0;
+	mSourceHeight = 0;
+	mFrameRate = 0.0;
+}
+
+void FaceTrackingData::AllocColumns(const int numberOfLandmarks, const int numberOfRows)
+{
+	mRowCount = numberOfRows;
+	mFrames.resize(numberOfRows);
+	mColumns.assign( (size_t) numberOfLandmarks * 2 * numberOfRows, kMissing );
+
+	mNames.resize(numberOfLandmarks);
+	mGroups.resize(numberOfLandmarks);
+}
+
+EFaceTrackingFormat FaceTrackingData::DetectFormat(const char *pFileName)
+{
+	const char *ext = strrchr(pFileName, '.');
+	if (ext && 0 == _stricmp(ext, ".xml"))
+		return eFaceTrackingFaceware;
+
+	MappedFile	file;
+	if (false == file.Open(pFileName))
+		return eFaceTrackingUnknown;
+
+	const char *data = file.GetData();
+	const size_t size = std::min(file.GetSize(), (size_t) FACE_DETECT_SIZE);
+	const char *end = data + size;
+
+	const char *p = SkipSpaces(data, end);
+	while (p < end && *p == '\n')
+		p = SkipSpaces(p+1, end);
+
+	if (p < end && *p == '<')
+		return eFaceTrackingFaceware;
+
+	for (const char *line=data; line<end; line=NextLine(line, end))
+	{
+		const char *token;
+		const char *tokenEnd = NextToken(line, end, token);
+		if (LineStartsWith(token, tokenEnd, "shape_name"))
+			return eFaceTrackingMochaShape;
+	}
+
+	// csv header starts with a column name
+	const char *eol = NextLine(p, end);
+	if (p < end && isalpha((unsigned char) *p) && memchr(p, ',', eol - p))
+		return eFaceTrackingOpenFace2d;
+
+	return eFaceTrackingPoints;
+}
+
+bool FaceTrackingData::Read(const char *pFileName, EFaceTrackingFormat format, const int numberOfPoints, const int numberOfThreads)
+{
+	FreeData();
+
+	if (eFaceTrackingUnknown == format)
+		format = DetectFormat(pFileName);
+
+	MappedFile	file;
+	if (false == file.Open(pFileName))
+	{
+		mLastError = "failed to open a file";
+		return false;
+	}
+
+	return Parse(file.GetData(), file.GetSize(), format, numberOfPoints, numberOfThreads);
+}
+
+bool FaceTrackingData::Parse(const char *data, const size_t size, const EFaceTrackingFormat format, const int numberOfPoints, const int numberOfThreads)
+{
+	FreeData();
+	mFormat = format;
+
+	if (nullptr == data || 0 == size)
+	{
+		mLastError = "file is empty";
+		return false;
+	}
+
+	bool result = false;
+
+	switch(format)
+	{
+	case eFaceTrackingPoints:
+		result = ParsePoints(data, size, numberOfPoints, numberOfThreads);
+		break;
+	case eFaceTrackingOpenFace2d:
+		result = ParseOpenFace2d(data, size, numberOfThreads);
+		break;
+	case eFaceTrackingMochaShape:
+		result = ParseMochaShape(data, size, numberOfThreads);
+		break;
+	case eFaceTrackingFaceware:
+		result = ParseFaceware(data, size, numberOfThreads);
+		break;
+	default:
+		mLastError = "unknown file format";
+		return false;
+	}
+
+	if (result && 0 == mRowCount)
+	{
+		mLastError = "no frames in the file";
+		result = false;
+	}
+
+	return result;
+}
+
+bool FaceTrackingData::ParsePoints(const char *data, const size_t size, const int numberOfPoints, const int numberOfThreads)
+{
+	const char *end = data + size;
+
+	// number of points from the first line, frame and success go before coords
+	int points = numberOfPoints;
+	if (points <= 0)
+	{
+		const char *p = data;
+		while (p < end && IsBlankLine(p, end))
+			p = NextLine(p, end);
+
+		const char *eol = NextLine(p, end);
+		int tokens = 0;
+		while (p < eol)
+		{
+			const char *token;
+			p = NextToken(p, eol, token);
+			if (p > token)
+				++tokens;
+			else
+				break;
+		}
+		points = (tokens - 2) / 2;
+	}
+
+	if (points <= 0 || points > FACE_MAX_POINTS)
+	{
+		mLastError = "wrong number of points";
+		return false;
+	}
+
+	std::vector<size_t>	chunkStarts;
+	SplitLines(data, 0, size, numberOfThreads, chunkStarts);
+
+	const int numberOfChunks = (int) chunkStarts.size() - 1;
+	std::vector<ChunkRows>	chunks(numberOfChunks);
+
+	ParallelFor( numberOfChunks, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			const char *p = data + chunkStarts[i];
+			const char *chunkEnd = data + chunkStarts[i+1];
+			ChunkRows &rows = chunks[i];
+
+			while (p < chunkEnd)
+			{
+				const char *eol = NextLine(p, chunkEnd);
+
+				int frame = 0;
+				const char *field = ParseInt(p, eol, frame);
+
+				if (field)
+				{
+					double value = 0.0;
+					const size_t offset = rows.values.size();
+					rows.frames.push_back(frame);
+					rows.values.resize(offset + points * 2, kMissing);
+
+					float *values = rows.values.data() + offset;
+
+					// success flag
+					field = ParseDouble(field, eol, value);
+
+					// all x values, then all y values
+					for (int j=0; field && j<points*2; ++j)
+					{
+						field = ParseDouble(field, eol, value);
+						if (field)
+							values[(j % points) * 2 + j / points] = (float) value;
+					}
+				}
+				p = eol;
+			}
+		}
+	}, numberOfThreads );
+
+	int numberOfRows = 0;
+	for (auto iter=chunks.begin(); iter!=chunks.end(); ++iter)
+	{
+		iter->firstRow = numberOfRows;
+		numberOfRows += (int) iter->frames.size();
+	}
+
+	AllocColumns(points, numberOfRows);
+
+	ParallelFor( numberOfChunks, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			const ChunkRows &rows = chunks[i];
+			for (int r=0, count=(int) rows.frames.size(); r<count; ++r)
+			{
+				const int row = rows.firstRow + r;
+				mFrames[row] = rows.frames[r];
+
+				const float *values = rows.values.data() + (size_t) r * points * 2;
+				for (int m=0; m<points; ++m)
+				{
+					float *column = mColumns.data() + (size_t) m * 2 * mRowCount;
+					column[row] = values[m*2];
+					column[mRowCount + row] = values[m*2+1];
+				}
+			}
+		}
+	}, numberOfThreads );
+
+	return true;
+}
+
+bool FaceTrackingData::ParseOpenFace2d(const char *data, const size_t size, const int numberOfThreads)
+{
+	const char *end = data + size;
+	const char *headerEnd = NextLine(data, end);
+
+	const char *headerLineEnd = headerEnd;
+	while (headerLineEnd > data && (headerLineEnd[-1] == '\n' || headerLineEnd[-1] == '\r'))
+		--headerLineEnd;
+
+	// column roles from the header - frame,timestamp,confidence,success,x_0,..,x_n,y_0,..,y_n
+
+	const int kSkip = -1;
+	const int kFrame = -2;
+
+	std::vector<int>	columns;
+	int frameColumn = -1;
+	int firstX = -1;
+	int points = 0;
+
+	for (const char *p=data; p<headerLineEnd; )
+	{
+		const char *fieldBegin = SkipSpaces(p, headerLineEnd);
+		const char *fieldEnd = fieldBegin;
+		while (fieldEnd < headerLineEnd && *fieldEnd != ',' && *fieldEnd != ' ')
+			++fieldEnd;
+
+		const size_t len = fieldEnd - fieldBegin;
+		int role = kSkip;
+
+		if (len == 5 && 0 == strncmp(fieldBegin, "frame", 5))
+		{
+			role = kFrame;
+			frameColumn = (int) columns.size();
+		}
+		else if (len >= 2 && (*fieldBegin == 'x' || *fieldBegin == 'y'))
+		{
+			const char *digits = fieldBegin + 1;
+			if (*digits == '_')
+				++digits;
+
+			int index = 0;
+			if (ParseInt(digits, fieldEnd, index) == fieldEnd && index >= 0 && index < FACE_MAX_POINTS)
+			{
+				const int axis = (*fieldBegin == 'x') ? 0 : 1;
+				role = index * 2 + axis;
+				points = std::max(points, index + 1);
+
+				if (0 == axis && firstX < 0)
+					firstX = (int) columns.size();
+			}
+		}
+
+		columns.push_back(role);
+
+		p = SkipField(fieldEnd, headerLineEnd);
+		if (p == fieldEnd)
+			break;
+	}
+
+	if (frameColumn < 0 || firstX < 0 || points <= 0)
+	{
+		mLastError = "wrong csv header";
+		return false;
+	}
+
+	// decimal comma export has more fields in a data line than in the header,
+	//  every coord takes two fields and coords are the last columns
+
+	const char *firstLine = headerEnd;
+	while (firstLine < end && IsBlankLine(firstLine, end))
+		firstLine = NextLine(firstLine, end);
+
+	const char *firstLineEnd = NextLine(firstLine, end);
+	const int numberOfFields = 1 + (int) std::count(firstLine, firstLineEnd, ',');
+	const int numberOfHeaderFields = (int) columns.size();
+	const bool decimalComma = numberOfFields > numberOfHeaderFields;
+
+	const int extraBefore = std::max(0, numberOfFields - numberOfHeaderFields - 2 * points);
+	const int firstCoordField = firstX + extraBefore;
+
+	std::vector<size_t>	chunkStarts;
+	SplitLines(data, headerEnd - data, size, numberOfThreads, chunkStarts);
+
+	const int numberOfChunks = (int) chunkStarts.size() - 1;
+	std::vector<ChunkRows>	chunks(numberOfChunks);
+
+	ParallelFor( numberOfChunks, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			const char *p = data + chunkStarts[i];
+			const char *chunkEnd = data + chunkStarts[i+1];
+			ChunkRows &rows = chunks[i];
+
+			while (p < chunkEnd)
+			{
+				const char *eol = NextLine(p, chunkEnd);
+
+				if (IsBlankLine(p, eol))
+				{
+					p = eol;
+					continue;
+				}
+
+				const size_t offset = rows.values.size();
+				rows.values.resize(offset + points * 2, kMissing);
+				float *values = rows.values.data() + offset;
+
+				int frame = 0;
+				double value = 0.0;
+				const char *field = p;
+
+				if (decimalComma)
+				{
+					for (int f=0; f<firstCoordField && field<eol; ++f)
+					{
+						if (f == frameColumn)
+							ParseInt(field, eol, frame);
+						field = SkipField(field, eol);
+					}
+
+					for (int j=0; field && j<points*2; ++j)
+					{
+						field = ParseCommaPair(field, eol, value);
+						if (field)
+							values[(j % points) * 2 + j / points] = (float) value;
+					}
+				}
+				else
+				{
+					for (int f=0; f<numberOfHeaderFields && field<eol; ++f)
+					{
+						const int role = columns[f];
+
+						if (role == kFrame)
+						{
+							if (nullptr == ParseInt(field, eol, frame) && ParseDouble(field, eol, value))
+								frame = (int) value;
+						}
+						else if (role >= 0 && ParseDouble(field, eol, value))
+						{
+							values[role] = (float) value;
+						}
+
+						field = SkipField(field, eol);
+					}
+				}
+
+				rows.frames.push_back(frame);
+				p = eol;
+			}
+		}
+	}, numberOfThreads );
+
+	int numberOfRows = 0;
+	for (auto iter=chunks.begin(); iter!=chunks.end(); ++iter)
+	{
+		iter->firstRow = numberOfRows;
+		numberOfRows += (int) iter->frames.size();
+	}
+
+	AllocColumns(points, numberOfRows);
+
+	ParallelFor( numberOfChunks, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			const ChunkRows &rows = chunks[i];
+			for (int r=0, count=(int) rows.frames.size(); r<count; ++r)
+			{
+				const int row = rows.firstRow + r;
+				mFrames[row] = rows.frames[r];
+
+				const float *values = rows.values.data() + (size_t) r * points * 2;
+				for (int m=0; m<points; ++m)
+				{
+					float *column = mColumns.data() + (size_t) m * 2 * mRowCount;
+					column[row] = values[m*2];
+					column[mRowCount + row] = values[m*2+1];
+				}
+			}
+		}
+	}, numberOfThreads );
+
+	return true;
+}
+
+bool FaceTrackingData::ParseMochaShape(const char *data, const size_t size, const int numberOfThreads)
+{
+	// shape_name, num_vertices, num_key_times, then key_time and vertex_data per key.
+	//	Keywords are found on a sequential pass, vertex data lines are parsed in parallel
+
+	struct ShapeInfo
+	{
+		std::string		name;
+		int				numberOfVertices;
+		int				firstLandmark;
+	};
+
+	struct KeyLine
+	{
+		int				shape;
+		int				frame;
+		const char		*begin;
+		const char		*end;
+	};
+
+	std::vector<ShapeInfo>	shapes;
+	std::vector<KeyLine>	keys;
+
+	const char *end = data + size;
+	int keyFrame = 0;
+	int numberOfLandmarks = 0;
+
+	for (const char *p=data; p<end; )
+	{
+		const char *eol = NextLine(p, end);
+
+		const char *token;
+		const char *tokenEnd = NextToken(p, eol, token);
+
+		if (LineStartsWith(token, tokenEnd, "shape_name"))
+		{
+			const char *nameBegin;
+			const char *nameEnd = NextToken(tokenEnd, eol, nameBegin);
+
+			ShapeInfo info;
+			info.name.assign(nameBegin, nameEnd);
+			info.numberOfVertices = 0;
+			info.firstLandmark = numberOfLandmarks;
+			shapes.push_back(info);
+		}
+		else if (shapes.size() > 0)
+		{
+			ShapeInfo &shape = shapes.back();
+
+			if (LineStartsWith(token, tokenEnd, "num_vertices") && 0 == shape.numberOfVertices)
+			{
+				int count = 0;
+				if (ParseInt(tokenEnd, eol, count) && count > 0 && count <= FACE_MAX_POINTS)
+				{
+					shape.numberOfVertices = count;
+					numberOfLandmarks += count * 3;
+				}
+			}
+			else if (LineStartsWith(token, tokenEnd, "num_key_times"))
+			{
+				// key lines are counted by the parser
+			}
+			else if (LineStartsWith(token, tokenEnd, "key_time"))
+			{
+				double value = 0.0;
+				if (ParseDouble(tokenEnd, eol, value))
+					keyFrame = (int) floor(value + 0.5);
+			}
+			else if (LineStartsWith(token, tokenEnd, "vertex_data") && shape.numberOfVertices > 0)
+			{
+				KeyLine key;
+				key.shape = (int) shapes.size() - 1;
+				key.frame = keyFrame;
+				key.begin = tokenEnd;
+				key.end = eol;
+				keys.push_back(key);
+			}
+		}
+
+		p = eol;
+	}
+
+	if (0 == numberOfLandmarks || 0 == keys.size())
+	{
+		mLastError = "no shape data in the file";
+		return false;
+	}
+
+	// one row per key time of any shape
+
+	int minFrame = std::numeric_limits<int>::max();
+	int maxFrame = std::numeric_limits<int>::min();
+	for (auto iter=keys.begin(); iter!=keys.end(); ++iter)
+	{
+		minFrame = std::min(minFrame, iter->frame);
+		maxFrame = std::max(maxFrame, iter->frame);
+	}
+
+	std::vector<int>	frameToRow(maxFrame - minFrame + 1, -1);
+	for (auto iter=keys.begin(); iter!=keys.end(); ++iter)
+		frameToRow[iter->frame - minFrame] = 0;
+
+	int numberOfRows = 0;
+	for (auto iter=frameToRow.begin(); iter!=frameToRow.end(); ++iter)
+		if (*iter == 0)
+			*iter = numberOfRows++;
+
+	AllocColumns(numberOfLandmarks, numberOfRows);
+
+	for (int i=0, count=(int) frameToRow.size(); i<count; ++i)
+		if (frameToRow[i] >= 0)
+			mFrames[frameToRow[i]] = minFrame + i;
+
+	// point and two tangents per vertex, names follow the file order
+
+	char buffer[64];
+	for (auto iter=shapes.begin(); iter!=shapes.end(); ++iter)
+	{
+		for (int i=0; i<iter->numberOfVertices; ++i)
+		{
+			static const char *suffix[3] = { "point", "tangentIn", "tangentOut" };
+
+			for (int k=0; k<3; ++k)
+			{
+				const int landmark = iter->firstLandmark + i * 3 + k;
+				sprintf_s(buffer, sizeof(buffer), "%s_%d", suffix[k], i);
+				mNames[landmark] = buffer;
+				mGroups[landmark] = iter->name;
+			}
+		}
+	}
+
+	// a repeated key time of the same shape keeps the last key
+	std::vector<bool>	skipKey(keys.size(), false);
+	{
+		std::unordered_map<int64_t, int>	lastKey;
+		for (int i=0, count=(int) keys.size(); i<count; ++i)
+		{
+			const int64_t id = (int64_t) keys[i].shape * numberOfRows + frameToRow[keys[i].frame - minFrame];
+			auto iter = lastKey.find(id);
+			if (iter != lastKey.end())
+				skipKey[iter->second] = true;
+			lastKey[id] = i;
+		}
+	}
+
+	ParallelFor( (int) keys.size(), 64, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			if (skipKey[i])
+				continue;
+
+			const KeyLine &key = keys[i];
+			const ShapeInfo &shape = shapes[key.shape];
+			const int row = frameToRow[key.frame - minFrame];
+
+			const char *p = key.begin;
+			double value = 0.0;
+
+			// 12 values per vertex - point, tangents and 3 border points which are not used
+			for (int v=0; p && v<shape.numberOfVertices; ++v)
+			{
+				for (int j=0; p && j<12; ++j)
+				{
+					p = ParseDouble(p, key.end, value);
+					if (p && j < 6)
+					{
+						const int landmark = shape.firstLandmark + v * 3 + j / 2;
+						mColumns[((size_t) landmark * 2 + (j & 1)) * mRowCount + row] = (float) value;
+					}
+				}
+			}
+		}
+	}, numberOfThreads );
+
+	return true;
+}
+
+bool FaceTrackingData::ParseFaceware(const char *data, const size_t size, const int numberOfThreads)
+{
+	const char *end = data + size;
+
+	const char *framesBegin = FindTag(data, end, "frame", 5);
+
+	// meta before the frames
+	const char *video = FindTag(data, framesBegin, "video", 5);
+	if (video < framesBegin)
+	{
+		const char *tagEnd = FindTagEnd(video, framesBegin);
+		double value = 0.0;
+
+		if (GetAttributeNumber(video, tagEnd, "width", value))
+			mSourceWidth = (int) value;
+		if (GetAttributeNumber(video, tagEnd, "height", value))
+			mSourceHeight = (int) value;
+		if (GetAttributeNumber(video, tagEnd, "frameRate", value))
+			mFrameRate = value;
+	}
+
+	if (framesBegin >= end)
+	{
+		mLastError = "no frames in the file";
+		return false;
+	}
+
+	// <frame> positions, every thread searches its own byte range
+
+	const int numberOfWorkers = ParallelForThreadCount(numberOfThreads);
+	const size_t rangeSize = std::max( (size_t) FACE_MIN_CHUNK_SIZE, (size_t)(end - framesBegin) / (numberOfWorkers * FACE_CHUNKS_PER_THREAD) + 1 );
+	const int numberOfRanges = (int) (((size_t)(end - framesBegin) + rangeSize - 1) / rangeSize);
+
+	std::vector<std::vector<const char*>>	rangeFrames(numberOfRanges);
+
+	ParallelFor( numberOfRanges, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			const char *rangeBegin = framesBegin + (size_t) i * rangeSize;
+			const char *rangeEnd = std::min(end, rangeBegin + rangeSize);
+
+			// tag could start in this range and end in the next one
+			for (const char *p=rangeBegin; ; ++p)
+			{
+				p = FindTag(p, end, "frame", 5);
+				if (p >= rangeEnd)
+					break;
+				rangeFrames[i].push_back(p);
+			}
+		}
+	}, numberOfThreads );
+
+	std::vector<const char*>	frameStarts;
+	for (auto iter=rangeFrames.begin(); iter!=rangeFrames.end(); ++iter)
+		frameStarts.insert(frameStarts.end(), iter->begin(), iter->end());
+
+	const int numberOfFrames = (int) frameStarts.size();
+	frameStarts.push_back(end);
+
+	// parse blocks of frames
+
+	const int framesPerBlock = std::max(1, numberOfFrames / (numberOfWorkers * FACE_CHUNKS_PER_THREAD) + 1);
+	const int numberOfBlocks = (numberOfFrames + framesPerBlock - 1) / framesPerBlock;
+
+	std::vector<FacewareBlock>	blocks(numberOfBlocks);
+
+	ParallelFor( numberOfBlocks, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			const int firstFrame = i * framesPerBlock;
+			const int lastFrame = std::min(numberOfFrames, firstFrame + framesPerBlock);
+
+			for (int f=firstFrame; f<lastFrame; ++f)
+				ParseFacewareFrame(frameStarts[f], frameStarts[f+1], f, blocks[i]);
+		}
+	}, numberOfThreads );
+
+	// global landmarks in the order of first appearance
+
+	std::unordered_map<std::string, int>	lookup;
+	std::vector<std::string>	names;
+	std::vector<std::string>	groups;
+	int numberOfRows = 0;
+
+	for (auto iter=blocks.begin(); iter!=blocks.end(); ++iter)
+	{
+		iter->firstRow = numberOfRows;
+		numberOfRows += (int) iter->frames.size();
+
+		iter->remap.resize(iter->names.size());
+
+		for (size_t i=0; i<iter->names.size(); ++i)
+		{
+			auto found = lookup.find(iter->names[i]);
+			if (found == lookup.end())
+			{
+				const int index = (int) names.size();
+				lookup[iter->names[i]] = index;
+				names.push_back(iter->names[i]);
+				groups.push_back(iter->groups[i]);
+				iter->remap[i] = index;
+			}
+			else
+			{
+				iter->remap[i] = found->second;
+			}
+		}
+	}
+
+	if (names.size() == 0)
+	{
+		mLastError = "no landmarks in the file";
+		return false;
+	}
+
+	AllocColumns( (int) names.size(), numberOfRows );
+	mNames.swap(names);
+	mGroups.swap(groups);
+
+	ParallelFor( numberOfBlocks, 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+		{
+			const FacewareBlock &block = blocks[i];
+
+			for (size_t f=0; f<block.frames.size(); ++f)
+				mFrames[block.firstRow + f] = block.frames[f];
+
+			for (auto iter=block.samples.begin(); iter!=block.samples.end(); ++iter)
+			{
+				const int row = block.firstRow + iter->frame;
+				float *column = mColumns.data() + (size_t) block.remap[iter->landmark] * 2 * mRowCount;
+				column[row] = iter->u;
+				column[mRowCount + row] = iter->v;
+			}
+		}
+	}, numberOfThreads );
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////
+// FaceTrackingBatchQueue
+
+FaceTrackingBatchQueue::FaceTrackingBatchQueue()
+	: mNextToParse(0)
+	, mNextToTake(0)
+	, mLookAhead(4)
+	, mStop(false)
+	, mFormat(eFaceTrackingUnknown)
+	, mNumberOfPoints(0)
+	, mInnerThreads(1)
+{}
+
+FaceTrackingBatchQueue::~FaceTrackingBatchQueue()
+{
+	Stop();
+}
+
+void FaceTrackingBatchQueue::Start(const std::vector<std::string> &files, const EFaceTrackingFormat format, const int numberOfPoints,
+	const int numberOfThreads, const int lookAhead)
+{
+	Stop();
+
+	mItems.clear();
+	mItems.resize(files.size());
+
+	for (size_t i=0; i<files.size(); ++i)
+	{
+		mItems[i].srcPath = files[i];
+		mItems[i].done = false;
+		mItems[i].result = false;
+		mItems[i].parseMs = 0.0;
+	}
+
+	mNextToParse = 0;
+	mNextToTake = 0;
+	mLookAhead = std::max(1, lookAhead);
+	mStop = false;
+	mFormat = format;
+	mNumberOfPoints = numberOfPoints;
+
+	const int numberOfWorkers = std::min( ParallelForThreadCount(numberOfThreads), std::min(mLookAhead, (int) files.size()) );
+
+	// files are parsed one per worker, split the rest of the hardware between them
+	mInnerThreads = std::max(1, ParallelForThreadCount(numberOfThreads) / std::max(1, numberOfWorkers) );
+
+	for (int i=0; i<numberOfWorkers; ++i)
+		mThreads.push_back( std::thread(&FaceTrackingBatchQueue::WorkerFunc, this) );
+}
+
+void FaceTrackingBatchQueue::Stop()
+{
+	{
+		std::lock_guard<std::mutex>	lock(mMutex);
+		mStop = true;
+	}
+	mCondition.notify_all();
+
+	for (auto iter=mThreads.begin(); iter!=mThreads.end(); ++iter)
+		iter->join();
+	mThreads.clear();
+}
+
+void FaceTrackingBatchQueue::WorkerFunc()
+{
+	for (;;)
+	{
+		int index = -1;
+		{
+			std::unique_lock<std::mutex>	lock(mMutex);
+			mCondition.wait(lock, [this] () {
+				return mStop || mNextToParse >= (int) mItems.size() || mNextToParse < mNextToTake + mLookAhead;
+			});
+
+			if (mStop || mNextToParse >= (int) mItems.size())
+				return;
+
+			index = mNextToParse++;
+		}
+
+		Item &item = mItems[index];
+
+		const face_clock::time_point startTime = face_clock::now();
+		const bool result = item.data.Read(item.srcPath.c_str(), mFormat, mNumberOfPoints, mInnerThreads);
+		const double parseMs = ElapsedMs(startTime);
+
+		{
+			std::lock_guard<std::mutex>	lock(mMutex);
+			item.result = result;
+			item.parseMs = parseMs;
+			item.done = true;
+		}
+		mCondition.notify_all();
+	}
+}
+
+FaceTrackingBatchQueue::Item *FaceTrackingBatchQueue::Next()
+{
+	std::unique_lock<std::mutex>	lock(mMutex);
+
+	// the main thread is done with the previous item
+	if (mNextToTake > 0)
+		mItems[mNextToTake-1].data.FreeData();
+
+	if (mNextToTake >= (int) mItems.size() || mThreads.size() == 0)
+		return nullptr;
+
+	const int index = mNextToTake;
+	mCondition.wait(lock, [this, index] () { return mStop || mItems[index].done; });
+
+	if (false == mItems[index].done)
+		return nullptr;
+
+	mNextToTake += 1;
+	lock.unlock();
+	mCondition.notify_all();
+
+	return &mItems[index];
+}
+
+std::string FaceTrackingBatchQueue::GetBaseName(const char *path)
+{
+	const char *name = path;
+	for (const char *p=path; *p; ++p)
+		if (*p == '\\' || *p == '/')
+			name = p + 1;
+
+	std::string result(name);
+	const size_t dot = result.rfind('.');
+	if (dot != std::string::npos)
+		result.resize(dot);
+
+	return result;
+}
+
+void FaceTrackingBatchQueue::CollectPending(const std::vector<std::string> &srcFiles, const std::vector<std::string> &dstFiles,
+	std::vector<std::string> &pending, std::vector<std::string> &skipped)
+{
+	auto fnLowerName = [] (const std::string &path) -> std::string {
+		std::string name = GetBaseName(path.c_str());
+		std::transform(name.begin(), name.end(), name.begin(), [] (const char c) { return (char) tolower((unsigned char) c); });
+		return name;
+	};
+
+	std::unordered_set<std::string>	outputs;
+	outputs.reserve(dstFiles.size() + srcFiles.size());
+
+	for (auto iter=dstFiles.begin(); iter!=dstFiles.end(); ++iter)
+		outputs.insert( fnLowerName(*iter) );
+
+	pending.clear();
+	skipped.clear();
+
+	// the second source with the same name would overwrite the first output
+	for (auto iter=srcFiles.begin(); iter!=srcFiles.end(); ++iter)
+	{
+		if (outputs.insert( fnLowerName(*iter) ).second)
+			pending.push_back(*iter);
+		else
+			skipped.push_back(*iter);
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// report
+
+bool FaceTrackingWriteReport(const char *filename, const std::vector<FaceTrackingReportEntry> &entries)
+{
+	FILE *f = fopen(filename, "w");
+	if (nullptr == f)
+		return false;
+
+	fprintf(f, "source,output,status,frames,landmarks,parse_ms,import_ms,error\n");
+
+	for (auto iter=entries.begin(); iter!=entries.end(); ++iter)
+	{
+		fprintf(f, "\"%s\",\"%s\",%s,%d,%d,%.2f,%.2f,\"%s\"\n", iter->srcPath.c_str(), iter->dstPath.c_str(), iter->status.c_str(),
+			iter->numberOfRows, iter->numberOfLandmarks, iter->parseMs, iter->importMs, iter->error.c_str() );
+	}
+
+	fclose(f);
+	return true;
+}
+
+void FaceTrackingPrintReport(const std::vector<FaceTrackingReportEntry> &entries, const double totalMs)
+{
+	int done = 0;
+	int skipped = 0;
+	int failed = 0;
+	double parseMs = 0.0;
+	double importMs = 0.0;
+
+	for (auto iter=entries.begin(); iter!=entries.end(); ++iter)
+	{
+		if (iter->status == "done")
+			done += 1;
+		else if (iter->status == "skipped")
+			skipped += 1;
+		else
+		{
+			failed += 1;
+			printf("[FaceTracking] failed %s - %s\n", iter->srcPath.c_str(), iter->error.c_str() );
+		}
+
+		parseMs += iter->parseMs;
+		importMs += iter->importMs;
+	}
+
+	printf("[FaceTracking] batch - %d done, %d skipped, %d failed; parse %.1f ms (on workers), import %.1f ms, total %.1f ms\n",
+		done, skipped, failed, parseMs, importMs, totalMs );
+}
+
+/////////////////////////////////////////////////////////////
+// benchmark
+
+namespace
+{
+	// fixed 3 digits, sprintf is too slow for a multi-hour synthetic take
+	void AppendFixed(std::string &text, const double value, const char decimalSeparator='.')
+	{
+		int64_t scaled = (int64_t) floor(fabs(value) * 1000.0 + 0.5);
+		if (value < 0.0 && scaled > 0)
+			text.push_back('-');
+
+		char digits[24];
+		int count = 0;
+		int64_t integer = scaled / 1000;
+		do
+		{
+			digits[count++] = '0' + (char) (integer % 10);
+			integer /= 10;
+		} while (integer > 0);
+
+		while (count > 0)
+			text.push_back(digits[--count]);
+
+		const int fraction = (int) (scaled % 1000);
+		text.push_back(decimalSeparator);
+		text.push_back('0' + (char) (fraction / 100));
+		text.push_back('0' + (char) ((fraction / 10) % 10));
+		text.push_back('0' + (char) (fraction % 10));
+	}
+
+	void AppendInt(std::string &text, const int value)
+	{
+		char buffer[16];
+		sprintf_s(buffer, sizeof(buffer), "%d", value);
+		text += buffer;
+	}
+
+	inline double SyntheticCoord(const int frame, const int landmark, const int axis)
+	{
+		return 320.0 + 100.0 * sin(0.013 * frame + 0.7 * landmark + 1.3 * axis) + 0.25 * landmark;
+	}
+
+	// line by line reader with a token copy and atof, the way the tool used to read exports
+	size_t ReferenceLineReader(const char *data, const size_t size, const char separator, const int skipLines, std::vector<float> &values)
+	{
+		values.clear();
+
+		std::string line;
+		char token[64];
+
+		const char *dataEnd = data + size;
+		int lineIndex = 0;
+
+		for (const char *p=data; p<dataEnd; ++lineIndex)
+		{
+			const char *eol = NextLine(p, dataEnd);
+			line.assign(p, eol);
+			p = eol;
+
+			if (lineIndex < skipLines)
+				continue;
+
+			const char *s = line.c_str();
+			while (*s)
+			{
+				int len = 0;
+				while (*s && *s != separator && *s != '\n' && len < 63)
+					token[len++] = *s++;
+				token[len] = 0;
+
+				if (len > 0 && (isdigit((unsigned char) token[0]) || token[0] == '-' || token[0] == ' '))
+					values.push_back( (float) atof(token) );
+
+				if (*s)
+					++s;
+			}
+		}
+
+		return values.size();
+	}
+
+	// biggest difference between parsed and generated coords, NaN if a sample is missing
+	double SyntheticError(const FaceTrackingData &data, const double scale)
+	{
+		double maxError = 0.0;
+		for (int i=0; i<data.GetNumberOfLandmarks(); ++i)
+			for (int axis=0; axis<2; ++axis)
+			{
+				const float *column = data.GetColumn(i, axis);
+				for (int row=0; row<data.GetNumberOfRows(); ++row)
+				{
+					const double error = fabs(column[row] - scale * SyntheticCoord(row, i, axis));
+					if (false == (error <= maxError))
+						maxError = error;
+				}
+			}
+		return maxError;
+	}
+}
+
+void FaceTrackingBenchmark(const double hours, const double frameRate, const int numberOfLandmarks, const int numberOfThreads)
+{
+	if (hours <= 0.0 || frameRate <= 0.0 || numberOfLandmarks < 3)
+		return;
+
+	const int requestedFrames = (int) (hours * 3600.0 * frameRate);
+	const int numberOfWorkers = ParallelForThreadCount(numberOfThreads);
+
+	// keep one synthetic export in memory under the limit
+	const size_t maxBytes = (size_t) 1024 * 1024 * 1024;
+
+	printf("[FaceTracking] benchmark - %.2f hours at %.2f fps (%d frames), %d landmarks, %d threads\n",
+		hours, frameRate, requestedFrames, numberOfLandmarks, numberOfWorkers );
+
+	for (int format=eFaceTrackingPoints; format<=eFaceTrackingFaceware; ++format)
+	{
+		size_t bytesPerFrame = 0;
+		switch(format)
+		{
+		case eFaceTrackingPoints:
+		case eFaceTrackingOpenFace2d: bytesPerFrame = 32 + numberOfLandmarks * 2 * 10; break;
+		case eFaceTrackingMochaShape: bytesPerFrame = 64 + (numberOfLandmarks / 3 + 1) * 12 * 10; break;
+		default: bytesPerFrame = 128 + numberOfLandmarks * 128;
+		}
+
+		const int numberOfFrames = (int) std::min( (size_t) requestedFrames, maxBytes / bytesPerFrame );
+
+		// synthesize
+
+		std::string text;
+		text.reserve( (size_t) numberOfFrames * bytesPerFrame );
+
+		const char *formatName = "";
+		char separator = ' ';
+		int skipLines = 0;
+
+		switch(format)
+		{
+		case eFaceTrackingPoints:
+			formatName = "points";
+			for (int f=0; f<numberOfFrames; ++f)
+			{
+				AppendInt(text, f+1);
+				text += " 1";
+				for (int axis=0; axis<2; ++axis)
+					for (int i=0; i<numberOfLandmarks; ++i)
+					{
+						text.push_back(' ');
+						AppendFixed(text, SyntheticCoord(f, i, axis));
+					}
+				text.push_back('\n');
+			}
+			break;
+
+		case eFaceTrackingOpenFace2d:
+			formatName = "openface csv";
+			separator = ',';
+			skipLines = 1;
+			text += "frame, timestamp, confidence, success";
+			for (int axis=0; axis<2; ++axis)
+				for (int i=0; i<numberOfLandmarks; ++i)
+				{
+					text += (axis == 0) ? ", x_" : ", y_";
+					AppendInt(text, i);
+				}
+			text.push_back('\n');
+
+			for (int f=0; f<numberOfFrames; ++f)
+			{
+				AppendInt(text, f+1);
+				text += ", ";
+				AppendFixed(text, f / frameRate);
+				text += ", 0.980, 1";
+				for (int axis=0; axis<2; ++axis)
+					for (int i=0; i<numberOfLandmarks; ++i)
+					{
+						text += ", ";
+						AppendFixed(text, SyntheticCoord(f, i, axis));
+					}
+				text.push_back('\n');
+			}
+			break;
+
+		case eFaceTrackingMochaShape:
+			{
+				formatName = "mocha shape";
+				const int numberOfVertices = numberOfLandmarks / 3;
+
+				text += "shape_name face\nnum_vertices ";
+				AppendInt(text, numberOfVertices);
+				text += "\nnum_key_times ";
+				AppendInt(text, numberOfFrames);
+				text.push_back('\n');
+
+				for (int f=0; f<numberOfFrames; ++f)
+				{
+					text += "key_time ";
+					AppendInt(text, f);
+					text += "\nvertex_data";
+					for (int v=0; v<numberOfVertices; ++v)
+						for (int j=0; j<12; ++j)
+						{
+							text.push_back(' ');
+							AppendFixed(text, SyntheticCoord(f, v * 3 + (j % 6) / 2, j & 1));
+						}
+					text.push_back('\n');
+				}
+			}
+			break;
+
+		default:
+			formatName = "faceware xml";
+			text += "<?xml version=\"1.0\" ?>\n<Analyzer_Feature_File>\n<meta>\n<video filePath=\"take.mov\" width=\"1280\" height=\"720\" frameRate=\"";
+			AppendFixed(text, frameRate, ',');
+			text += "\" />\n</meta>\n<frames>\n";
+
+			for (int f=0; f<numberOfFrames; ++f)
+			{
+				text += "<frame filePath=\"\" value=\"";
+				AppendInt(text, f);
+				text += "\" valid=\"true\">\n<markup_groups>\n<markup_group name=\"face\">\n<landmarks>\n";
+				for (int i=0; i<numberOfLandmarks; ++i)
+				{
+					text += "<landmark name=\"landmark_";
+					AppendInt(text, i);
+					text += "\" label=\"l";
+					AppendInt(text, i);
+					text += "\">\n<texCoord u=\"";
+					AppendFixed(text, SyntheticCoord(f, i, 0) / 1000.0, ',');
+					text += "\" v=\"";
+					AppendFixed(text, SyntheticCoord(f, i, 1) / 1000.0, ',');
+					text += "\" />\n</landmark>\n";
+				}
+				text += "</landmarks>\n</markup_group>\n</markup_groups>\n</frame>\n";
+			}
+			text += "</frames>\n</Analyzer_Feature_File>\n";
+		}
+
+		const double megabytes = (double) text.size() / (1024.0 * 1024.0);
+
+		// line by line atof, there is no such reader for the xml
+		double referenceMs = 0.0;
+
+		if (format != eFaceTrackingFaceware)
+		{
+			std::vector<float>	values;
+			const face_clock::time_point startTime = face_clock::now();
+			ReferenceLineReader(text.c_str(), text.size(), separator, skipLines, values);
+			referenceMs = ElapsedMs(startTime);
+		}
+
+		FaceTrackingData	data;
+
+		face_clock::time_point startTime = face_clock::now();
+		const bool result = data.Parse(text.c_str(), text.size(), (EFaceTrackingFormat) format, numberOfLandmarks, 1);
+		const double singleMs = ElapsedMs(startTime);
+
+		startTime = face_clock::now();
+		data.Parse(text.c_str(), text.size(), (EFaceTrackingFormat) format, numberOfLandmarks, numberOfThreads);
+		const double parallelMs = ElapsedMs(startTime);
+
+		if (false == result)
+		{
+			printf("[FaceTracking] %s - failed to parse, %s\n", formatName, data.GetLastError() );
+			continue;
+		}
+
+		printf("[FaceTracking] %s - %d frames, %.1f MB; ", formatName, data.GetNumberOfRows(), megabytes );
+		if (format != eFaceTrackingFaceware)
+			printf("line by line %.1f ms; ", referenceMs );
+		printf("parser 1 thread %.1f ms, %d threads %.1f ms (%.1f MB/s)\n", singleMs, numberOfWorkers, parallelMs,
+			megabytes / std::max(0.001, parallelMs * 0.001) );
+
+		printf("[FaceTracking] %s - max error %g\n", formatName, SyntheticError(data, (format == eFaceTrackingFaceware) ? 0.001 : 1.0) );
+	}
+}
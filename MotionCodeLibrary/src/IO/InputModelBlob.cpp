@@ -0,0 +1,712 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: InputModelBlob.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "IO\InputModelBlob.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+static size_t AlignBlobOffset(const size_t offset)
+{
+	return (offset + INPUT_MODEL_BLOB_ALIGN - 1) & ~((size_t) INPUT_MODEL_BLOB_ALIGN - 1);
+}
+
+static const size_t	gBlobElementSize[eBlobArrayCount] = {
+	sizeof(Float4),		// positions
+	sizeof(int),		// material indices
+	sizeof(int),		// poly materials
+	sizeof(int),		// poly offsets
+	sizeof(int),		// poly indices
+	sizeof(Float4),		// normals direct
+	sizeof(int),		// normal indices
+	sizeof(Float2),		// uvs
+	sizeof(int),		// uv indices
+	sizeof(InputModelBlobCluster),
+	sizeof(int),		// cluster offsets
+	sizeof(int),		// cluster vertex indices
+	sizeof(float)		// cluster vertex weights
+};
+
+// element count for each array of the data
+static void ComputeBlobCounts(const InputModelData &data, uint64_t counts[eBlobArrayCount])
+{
+	uint64_t polyIndexCount = 0;
+	for (auto iter=data.polyInfo.begin(); iter!=data.polyInfo.end(); ++iter)
+		polyIndexCount += iter->vertexCount;
+
+	uint64_t clusterVertexCount = 0;
+	for (auto iter=data.clusters.begin(); iter!=data.clusters.end(); ++iter)
+		clusterVertexCount += (*iter)->vertices.size();
+
+	counts[eBlobPositions] = data.positions.size();
+	counts[eBlobMaterialIndices] = data.materialIndices.size();
+	counts[eBlobPolyMaterials] = data.polyInfo.size();
+	counts[eBlobPolyOffsets] = data.polyInfo.size() + 1;
+	counts[eBlobPolyIndices] = polyIndexCount;
+	counts[eBlobNormalsDirect] = data.normalsDirect.size();
+	counts[eBlobNormalIndices] = data.normalIndices.size();
+	counts[eBlobUVs] = data.uvs.size();
+	counts[eBlobUVIndices] = data.uvIndices.size();
+	counts[eBlobClusters] = data.clusters.size();
+	counts[eBlobClusterOffsets] = data.clusters.size() + 1;
+	counts[eBlobClusterVertIndices] = clusterVertexCount;
+	counts[eBlobClusterVertWeights] = clusterVertexCount;
+}
+
+// fill array table, returns total size of the block
+static size_t LayoutBlob(const uint64_t counts[eBlobArrayCount], InputModelBlobArray arrays[eBlobArrayCount])
+{
+	size_t offset = AlignBlobOffset(sizeof(InputModelBlobHeader));
+
+	for (int i=0; i<eBlobArrayCount; ++i)
+	{
+		arrays[i].offset = offset;
+		arrays[i].count = counts[i];
+		offset = AlignBlobOffset(offset + gBlobElementSize[i] * (size_t) counts[i]);
+	}
+	return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// InputModelBlobView
+
+InputModelBlobView::InputModelBlobView()
+	: mData(nullptr)
+	, mHeader(nullptr)
+{}
+
+void InputModelBlobView::Detach()
+{
+	mData = nullptr;
+	mHeader = nullptr;
+}
+
+bool InputModelBlobView::Attach(const void *memory, const size_t size)
+{
+	Detach();
+
+	if (nullptr == memory || (size > 0 && size < sizeof(InputModelBlobHeader)) )
+		return false;
+
+	const InputModelBlobHeader *header = (const InputModelBlobHeader*) memory;
+
+	if (header->magic != INPUT_MODEL_BLOB_MAGIC || header->version != INPUT_MODEL_BLOB_VERSION)
+	{
+		printf( "[InputModelBlob] wrong header\n" );
+		return false;
+	}
+
+	if (size > 0 && header->totalSize > size)
+	{
+		printf( "[InputModelBlob] block is truncated\n" );
+		return false;
+	}
+
+	for (int i=0; i<eBlobArrayCount; ++i)
+	{
+		const InputModelBlobArray &arr = header->arrays[i];
+		if (arr.count > 0x7FFFFFFF || arr.offset < sizeof(InputModelBlobHeader)
+			|| arr.offset + arr.count * gBlobElementSize[i] > header->totalSize)
+		{
+			printf( "[InputModelBlob] array %d is out of the block\n", i );
+			return false;
+		}
+	}
+
+	// prefix arrays have to be monotonic and point inside the flat arrays
+
+	auto fn_checkPrefix = [header, memory] (const EInputModelBlobArray offsetsArray, const uint64_t itemCount, const uint64_t dataCount) -> bool {
+
+		const InputModelBlobArray &arr = header->arrays[offsetsArray];
+		if (arr.count != itemCount + 1)
+			return false;
+
+		const int *offsets = (const int*) ((const unsigned char*) memory + arr.offset);
+		if (offsets[0] != 0 || (uint64_t) offsets[itemCount] != dataCount)
+			return false;
+
+		for (uint64_t i=0; i<itemCount; ++i)
+			if (offsets[i+1] < offsets[i])
+				return false;
+		return true;
+	};
+
+	if (false == fn_checkPrefix(eBlobPolyOffsets, header->arrays[eBlobPolyMaterials].count, header->arrays[eBlobPolyIndices].count)
+		|| false == fn_checkPrefix(eBlobClusterOffsets, header->arrays[eBlobClusters].count, header->arrays[eBlobClusterVertIndices].count)
+		|| header->arrays[eBlobClusterVertIndices].count != header->arrays[eBlobClusterVertWeights].count)
+	{
+		printf( "[InputModelBlob] wrong offset tables\n" );
+		return false;
+	}
+
+	mData = (const unsigned char*) memory;
+	mHeader = header;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// conversion
+
+size_t ComputeInputModelBlobSize(const InputModelData &data)
+{
+	uint64_t counts[eBlobArrayCount];
+	InputModelBlobArray arrays[eBlobArrayCount];
+
+	ComputeBlobCounts(data, counts);
+	return LayoutBlob(counts, arrays);
+}
+
+size_t WriteInputModelBlob(const InputModelData &data, void *memory, const size_t capacity)
+{
+	uint64_t counts[eBlobArrayCount];
+
+	InputModelBlobHeader header;
+	memset( &header, 0, sizeof(InputModelBlobHeader) );
+
+	ComputeBlobCounts(data, counts);
+	const size_t totalSize = LayoutBlob(counts, header.arrays);
+
+	if (totalSize > capacity)
+		return 0;
+
+	header.magic = INPUT_MODEL_BLOB_MAGIC;
+	header.version = INPUT_MODEL_BLOB_VERSION;
+	header.totalSize = totalSize;
+
+	header.materialMapping = data.materialMapping;
+	header.normalMapping = data.normalMapping;
+	header.normalReferenceMode = data.normalReferenceMode;
+	header.uvSetMapping = data.uvSetMapping;
+	header.uvSetReferenceMode = data.uvSetReferenceMode;
+
+	memcpy( header.LclPosition, data.LclPosition, sizeof(double) * 3 );
+	memcpy( header.LclRotation, data.LclRotation, sizeof(double) * 3 );
+	memcpy( header.LclScaling, data.LclScaling, sizeof(double) * 3 );
+	header.snapshotTime = data.snapshotTime;
+
+	memcpy( header.uvSetName, data.uvSetName, sizeof(char) * STRING_MAX_LENGTH );
+	memcpy( header.baseModelName, data.baseModelName, sizeof(char) * STRING_MAX_LENGTH );
+
+	unsigned char *szPtr = (unsigned char*) memory;
+	memcpy( szPtr, &header, sizeof(InputModelBlobHeader) );
+
+	auto fn_array = [szPtr, &header] (const EInputModelBlobArray index) -> void* {
+		return szPtr + header.arrays[index].offset;
+	};
+	auto fn_copy = [&fn_array] (const EInputModelBlobArray index, const void *src, const size_t size) {
+		if (size > 0)
+			memcpy( fn_array(index), src, size );
+	};
+
+	fn_copy( eBlobPositions, data.positions.data(), sizeof(Float4) * data.positions.size() );
+	fn_copy( eBlobMaterialIndices, data.materialIndices.data(), sizeof(int) * data.materialIndices.size() );
+	fn_copy( eBlobNormalsDirect, data.normalsDirect.data(), sizeof(Float4) * data.normalsDirect.size() );
+	fn_copy( eBlobNormalIndices, data.normalIndices.data(), sizeof(int) * data.normalIndices.size() );
+	fn_copy( eBlobUVs, data.uvs.data(), sizeof(Float2) * data.uvs.size() );
+	fn_copy( eBlobUVIndices, data.uvIndices.data(), sizeof(int) * data.uvIndices.size() );
+
+	// polygons
+
+	int *polyMaterials = (int*) fn_array(eBlobPolyMaterials);
+	int *polyOffsets = (int*) fn_array(eBlobPolyOffsets);
+	int *polyIndices = (int*) fn_array(eBlobPolyIndices);
+
+	int offset = 0;
+	polyOffsets[0] = 0;
+	for (size_t i=0, count=data.polyInfo.size(); i<count; ++i)
+	{
+		const InputModelData::PolyInfo &info = data.polyInfo[i];
+		polyMaterials[i] = info.materialId;
+
+		if (info.vertexCount > 0)
+			memcpy( polyIndices + offset, info.indices, sizeof(int) * info.vertexCount );
+		offset += info.vertexCount;
+		polyOffsets[i+1] = offset;
+	}
+
+	// clusters
+
+	InputModelBlobCluster *clusters = (InputModelBlobCluster*) fn_array(eBlobClusters);
+	int *clusterOffsets = (int*) fn_array(eBlobClusterOffsets);
+	int *vertIndices = (int*) fn_array(eBlobClusterVertIndices);
+	float *vertWeights = (float*) fn_array(eBlobClusterVertWeights);
+
+	offset = 0;
+	clusterOffsets[0] = 0;
+	int clusterIndex = 0;
+	for (auto iter=data.clusters.begin(); iter!=data.clusters.end(); ++iter, ++clusterIndex)
+	{
+		const InputModelData::Cluster *src = *iter;
+		InputModelBlobCluster &dst = clusters[clusterIndex];
+
+		memset( &dst, 0, sizeof(InputModelBlobCluster) );
+		memcpy( dst.name, src->name, sizeof(char) * STRING_MAX_LENGTH );
+		memcpy( dst.modelname, src->modelname, sizeof(char) * STRING_MAX_LENGTH );
+		dst.parent = src->parent;
+		dst.mode = src->mode;
+
+		memcpy( dst.LclPosition, src->LclPosition, sizeof(double) * 3 );
+		memcpy( dst.LclRotation, src->LclRotation, sizeof(double) * 3 );
+		memcpy( dst.LclScaling, src->LclScaling, sizeof(double) * 3 );
+		memcpy( dst.LinkPosition, src->LinkPosition, sizeof(double) * 3 );
+		memcpy( dst.LinkRotation, src->LinkRotation, sizeof(double) * 3 );
+		memcpy( dst.LinkScaling, src->LinkScaling, sizeof(double) * 3 );
+
+		for (auto vertIter=src->vertices.begin(); vertIter!=src->vertices.end(); ++vertIter)
+		{
+			vertIndices[offset] = vertIter->index;
+			vertWeights[offset] = vertIter->weight;
+			offset += 1;
+		}
+		clusterOffsets[clusterIndex+1] = offset;
+	}
+
+	return totalSize;
+}
+
+template<typename T>
+static void AssignBlobArray(const InputModelBlobView &view, const EInputModelBlobArray index, std::vector<T> &dst)
+{
+	const T *src = view.GetArray<T>(index);
+	dst.assign( src, src + view.GetCount(index) );
+}
+
+bool ReadInputModelBlob(const InputModelBlobView &view, InputModelData &data)
+{
+	if (false == view.IsValid() )
+		return false;
+
+	const InputModelBlobHeader *header = view.GetHeader();
+
+	AssignBlobArray( view, eBlobPositions, data.positions );
+	AssignBlobArray( view, eBlobMaterialIndices, data.materialIndices );
+	AssignBlobArray( view, eBlobNormalsDirect, data.normalsDirect );
+	AssignBlobArray( view, eBlobNormalIndices, data.normalIndices );
+	AssignBlobArray( view, eBlobUVs, data.uvs );
+	AssignBlobArray( view, eBlobUVIndices, data.uvIndices );
+
+	data.materialMapping = header->materialMapping;
+	data.normalMapping = header->normalMapping;
+	data.normalReferenceMode = header->normalReferenceMode;
+	data.uvSetMapping = header->uvSetMapping;
+	data.uvSetReferenceMode = header->uvSetReferenceMode;
+
+	memcpy( data.LclPosition, header->LclPosition, sizeof(double) * 3 );
+	memcpy( data.LclRotation, header->LclRotation, sizeof(double) * 3 );
+	memcpy( data.LclScaling, header->LclScaling, sizeof(double) * 3 );
+	data.snapshotTime = header->snapshotTime;
+
+	memcpy( data.uvSetName, header->uvSetName, sizeof(char) * STRING_MAX_LENGTH );
+	memcpy( data.baseModelName, header->baseModelName, sizeof(char) * STRING_MAX_LENGTH );
+
+	// polygons
+
+	for (auto iter=data.polyInfo.begin(); iter!=data.polyInfo.end(); ++iter)
+		iter->Free();
+
+	const int polyCount = view.GetPolyCount();
+	data.polyInfo.resize(polyCount);
+
+	for (int i=0; i<polyCount; ++i)
+	{
+		InputModelData::PolyInfo &info = data.polyInfo[i];
+		info.materialId = view.GetPolyMaterial(i);
+		info.vertexCount = view.GetPolyVertexCount(i);
+		if (info.vertexCount > 0)
+		{
+			info.indices = new int[info.vertexCount];
+			memcpy( info.indices, view.GetPolyIndices(i), sizeof(int) * info.vertexCount );
+		}
+	}
+
+	// clusters
+
+	for (auto iter=data.clusters.begin(); iter!=data.clusters.end(); ++iter)
+		delete *iter;
+	data.clusters.clear();
+
+	for (int i=0, count=view.GetClusterCount(); i<count; ++i)
+	{
+		const InputModelBlobCluster &src = view.GetCluster(i);
+		InputModelData::Cluster *pCluster = new InputModelData::Cluster();
+
+		memcpy( pCluster->name, src.name, sizeof(char) * STRING_MAX_LENGTH );
+		memcpy( pCluster->modelname, src.modelname, sizeof(char) * STRING_MAX_LENGTH );
+		pCluster->parent = src.parent;
+		pCluster->mode = src.mode;
+
+		memcpy( pCluster->LclPosition, src.LclPosition, sizeof(double) * 3 );
+		memcpy( pCluster->LclRotation, src.LclRotation, sizeof(double) * 3 );
+		memcpy( pCluster->LclScaling, src.LclScaling, sizeof(double) * 3 );
+		memcpy( pCluster->LinkPosition, src.LinkPosition, sizeof(double) * 3 );
+		memcpy( pCluster->LinkRotation, src.LinkRotation, sizeof(double) * 3 );
+		memcpy( pCluster->LinkScaling, src.LinkScaling, sizeof(double) * 3 );
+
+		const int vertCount = view.GetClusterVertexCount(i);
+		const int *indices = view.GetClusterVertexIndices(i);
+		const float *weights = view.GetClusterVertexWeights(i);
+
+		pCluster->vertices.resize(vertCount);
+		for (int j=0; j<vertCount; ++j)
+			pCluster->vertices[j] = InputModelData::DeformedVertex(indices[j], weights[j]);
+
+		data.clusters.insert(pCluster);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// self test and benchmark
+
+// grid of quads and triangle pairs, per corner normals and uvs, clusters along the grid rows
+static void MakeBlobTestModel(const int gridSize, const int clusterCount, InputModelData &data)
+{
+	const int vertexCount = gridSize * gridSize;
+
+	data.materialMapping = 1;
+	data.normalMapping = 2;
+	data.normalReferenceMode = 2;
+	data.uvSetMapping = 2;
+	data.uvSetReferenceMode = 2;
+
+	for (int k=0; k<3; ++k)
+	{
+		data.LclPosition[k] = 1.0 + k;
+		data.LclRotation[k] = 10.0 * k;
+		data.LclScaling[k] = 1.0 + 0.5 * k;
+	}
+	data.snapshotTime = 2.5;
+	data.SetUVSetName( "map1" );
+	data.SetBaseModelName( "BlobTestModel" );
+
+	data.positions.resize(vertexCount);
+	data.uvs.resize(vertexCount);
+	for (int i=0; i<vertexCount; ++i)
+	{
+		Float4 &pos = data.positions[i];
+		pos.x[0] = (float) (i % gridSize);
+		pos.x[1] = (float) ((i * 7) % 13) * 0.1f;
+		pos.x[2] = (float) (i / gridSize);
+		pos.x[3] = 1.0f;
+
+		data.uvs[i].x[0] = pos.x[0] / gridSize;
+		data.uvs[i].x[1] = pos.x[2] / gridSize;
+	}
+
+	data.materialIndices.clear();
+	for (int i=0; i<3; ++i)
+		data.materialIndices.push_back(i);
+
+	for (int y=0; y<gridSize-1; ++y)
+	{
+		for (int x=0; x<gridSize-1; ++x)
+		{
+			const int corners[4] = { y*gridSize + x, y*gridSize + x + 1, (y+1)*gridSize + x + 1, (y+1)*gridSize + x };
+			const int cell = y * (gridSize-1) + x;
+
+			// even cells are quads, odd cells are two triangles
+			const int polyCount = (cell % 2 == 0) ? 1 : 2;
+			const int polyVerts = (cell % 2 == 0) ? 4 : 3;
+
+			for (int p=0; p<polyCount; ++p)
+			{
+				InputModelData::PolyInfo info;
+				info.materialId = cell % 3;
+				info.vertexCount = polyVerts;
+				info.indices = new int[polyVerts];
+
+				for (int j=0; j<polyVerts; ++j)
+				{
+					const int index = corners[(p * 2 + j) % 4];
+					info.indices[j] = index;
+
+					Float4 normal;
+					normal.x[0] = 0.0f;
+					normal.x[1] = 1.0f;
+					normal.x[2] = (float) j * 0.01f;
+					normal.x[3] = 0.0f;
+
+					data.normalIndices.push_back( (int) data.normalsDirect.size() );
+					data.normalsDirect.push_back(normal);
+					data.uvIndices.push_back(index);
+				}
+				data.polyInfo.push_back(info);
+			}
+		}
+	}
+
+	for (int i=0; i<clusterCount; ++i)
+	{
+		InputModelData::Cluster *pCluster = new InputModelData::Cluster();
+		memset( pCluster->name, 0, sizeof(char) * STRING_MAX_LENGTH );
+		memset( pCluster->modelname, 0, sizeof(char) * STRING_MAX_LENGTH );
+
+		// clusters are sorted and compared by the model name
+		sprintf_s( pCluster->name, STRING_MAX_LENGTH, "cluster%.4d", i );
+		sprintf_s( pCluster->modelname, STRING_MAX_LENGTH, "joint%.4d", i );
+		pCluster->parent = i - 1;
+		pCluster->mode = i % 3;
+
+		for (int k=0; k<3; ++k)
+		{
+			pCluster->LclPosition[k] = i + k;
+			pCluster->LclRotation[k] = i * 2.0 + k;
+			pCluster->LclScaling[k] = 1.0;
+			pCluster->LinkPosition[k] = -i - k;
+			pCluster->LinkRotation[k] = 0.5 * k;
+			pCluster->LinkScaling[k] = 1.0;
+		}
+
+		// one row of the grid, an empty cluster at the end
+		if (i < clusterCount - 1)
+		{
+			const int firstRow = (i * gridSize) / std::max(1, clusterCount - 1);
+			for (int j=0; j<gridSize; ++j)
+				pCluster->vertices.push_back( InputModelData::DeformedVertex(firstRow * gridSize + j, 1.0f / (1 + j % 4)) );
+		}
+		data.clusters.insert(pCluster);
+	}
+}
+
+template<typename T>
+static bool IsBlobArrayEqual(const InputModelBlobView &view, const EInputModelBlobArray index, const std::vector<T> &src)
+{
+	if (view.GetCount(index) != (int) src.size() )
+		return false;
+	return src.size() == 0 || 0 == memcmp( view.GetArray<T>(index), src.data(), sizeof(T) * src.size() );
+}
+
+// every field of the view against the source structure
+static int CompareBlobWithModel(const InputModelBlobView &view, const InputModelData &data)
+{
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf( "[InputModelBlob] %s\n", text );
+			numberOfErrors += 1;
+		}
+	};
+
+	const InputModelBlobHeader *header = view.GetHeader();
+
+	fnCheck( header->materialMapping == data.materialMapping && header->normalMapping == data.normalMapping
+		&& header->normalReferenceMode == data.normalReferenceMode && header->uvSetMapping == data.uvSetMapping
+		&& header->uvSetReferenceMode == data.uvSetReferenceMode, "mapping modes differ" );
+	fnCheck( 0 == memcmp(header->LclPosition, data.LclPosition, sizeof(double) * 3)
+		&& 0 == memcmp(header->LclRotation, data.LclRotation, sizeof(double) * 3)
+		&& 0 == memcmp(header->LclScaling, data.LclScaling, sizeof(double) * 3)
+		&& header->snapshotTime == data.snapshotTime, "transform or time differ" );
+	fnCheck( 0 == strcmp(header->uvSetName, data.uvSetName) && 0 == strcmp(header->baseModelName, data.baseModelName), "names differ" );
+
+	fnCheck( IsBlobArrayEqual(view, eBlobPositions, data.positions), "positions differ" );
+	fnCheck( IsBlobArrayEqual(view, eBlobMaterialIndices, data.materialIndices), "material indices differ" );
+	fnCheck( IsBlobArrayEqual(view, eBlobNormalsDirect, data.normalsDirect), "normals differ" );
+	fnCheck( IsBlobArrayEqual(view, eBlobNormalIndices, data.normalIndices), "normal indices differ" );
+	fnCheck( IsBlobArrayEqual(view, eBlobUVs, data.uvs), "uvs differ" );
+	fnCheck( IsBlobArrayEqual(view, eBlobUVIndices, data.uvIndices), "uv indices differ" );
+
+	int wrongPolys = (view.GetPolyCount() == (int) data.polyInfo.size()) ? 0 : 1;
+	for (int i=0; i<view.GetPolyCount() && 0 == wrongPolys; ++i)
+	{
+		const InputModelData::PolyInfo &info = data.polyInfo[i];
+		if (view.GetPolyMaterial(i) != info.materialId || view.GetPolyVertexCount(i) != info.vertexCount
+			|| 0 != memcmp(view.GetPolyIndices(i), info.indices, sizeof(int) * info.vertexCount) )
+			wrongPolys += 1;
+	}
+	fnCheck( 0 == wrongPolys, "polygons differ" );
+
+	int wrongClusters = (view.GetClusterCount() == (int) data.clusters.size()) ? 0 : 1;
+	int clusterIndex = 0;
+	for (auto iter=data.clusters.begin(); iter!=data.clusters.end() && 0 == wrongClusters; ++iter, ++clusterIndex)
+	{
+		const InputModelData::Cluster *src = *iter;
+		const InputModelBlobCluster &dst = view.GetCluster(clusterIndex);
+
+		if (0 != strcmp(dst.name, src->name) || 0 != strcmp(dst.modelname, src->modelname) || dst.parent != src->parent || dst.mode != src->mode
+			|| 0 != memcmp(dst.LclPosition, src->LclPosition, sizeof(double) * 3) || 0 != memcmp(dst.LinkScaling, src->LinkScaling, sizeof(double) * 3)
+			|| view.GetClusterVertexCount(clusterIndex) != (int) src->vertices.size() )
+		{
+			wrongClusters += 1;
+			continue;
+		}
+
+		const int *indices = view.GetClusterVertexIndices(clusterIndex);
+		const float *weights = view.GetClusterVertexWeights(clusterIndex);
+
+		for (size_t j=0; j<src->vertices.size(); ++j)
+			if (indices[j] != src->vertices[j].index || weights[j] != src->vertices[j].weight)
+				wrongClusters += 1;
+	}
+	fnCheck( 0 == wrongClusters, "clusters differ" );
+
+	return numberOfErrors;
+}
+
+bool InputModelBlobSelfTest()
+{
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf( "[InputModelBlob] %s\n", text );
+			numberOfErrors += 1;
+		}
+	};
+
+	// 1 - empty model
+
+	{
+		InputModelData	empty;
+		memset( empty.LclPosition, 0, sizeof(double) * 3 );
+		memset( empty.LclRotation, 0, sizeof(double) * 3 );
+		memset( empty.LclScaling, 0, sizeof(double) * 3 );
+		empty.materialMapping = empty.normalMapping = empty.normalReferenceMode = 0;
+		empty.uvSetMapping = empty.uvSetReferenceMode = 0;
+		empty.snapshotTime = 0.0;
+
+		std::vector<unsigned char>	blob( ComputeInputModelBlobSize(empty) );
+		fnCheck( WriteInputModelBlob(empty, blob.data(), blob.size()) == blob.size(), "failed to write an empty model" );
+
+		InputModelBlobView view;
+		fnCheck( view.Attach(blob.data(), blob.size()), "empty model is rejected" );
+		if (view.IsValid() )
+			numberOfErrors += CompareBlobWithModel(view, empty);
+	}
+
+	// 2 - round trip of a model, block is moved to another address before it's read
+
+	InputModelData	data;
+	MakeBlobTestModel(64, 9, data);
+
+	const size_t size = ComputeInputModelBlobSize(data);
+	std::vector<unsigned char>	blob(size + INPUT_MODEL_BLOB_ALIGN);
+
+	fnCheck( 0 == WriteInputModelBlob(data, blob.data(), size - 1), "blob is written into a smaller capacity" );
+	fnCheck( WriteInputModelBlob(data, blob.data(), blob.size()) == size, "written size differs from a computed one" );
+
+	std::vector<unsigned char>	moved(size + INPUT_MODEL_BLOB_ALIGN, 0);
+	unsigned char *movedBlock = moved.data() + INPUT_MODEL_BLOB_ALIGN;
+	memcpy( movedBlock, blob.data(), size );
+
+	InputModelBlobView view;
+	fnCheck( view.Attach(movedBlock, size), "moved block is rejected" );
+
+	if (view.IsValid() )
+	{
+		numberOfErrors += CompareBlobWithModel(view, data);
+
+		// unpacked editable structure gives the same blob again
+		InputModelData	unpacked;
+		fnCheck( ReadInputModelBlob(view, unpacked), "failed to unpack a blob" );
+
+		std::vector<unsigned char>	repacked( ComputeInputModelBlobSize(unpacked) );
+		fnCheck( repacked.size() == size && WriteInputModelBlob(unpacked, repacked.data(), repacked.size()) == size
+			&& 0 == memcmp(repacked.data(), blob.data(), size), "repacked blob differs from the original" );
+	}
+
+	// 3 - broken blocks are rejected
+
+	{
+		std::vector<unsigned char>	broken(blob.begin(), blob.begin() + size);
+		InputModelBlobHeader *header = (InputModelBlobHeader*) broken.data();
+
+		fnCheck( false == view.Attach(broken.data(), size - 1), "truncated block is accepted" );
+		fnCheck( false == view.Attach(broken.data(), sizeof(InputModelBlobHeader) - 1), "block smaller than a header is accepted" );
+
+		header->magic += 1;
+		fnCheck( false == view.Attach(broken.data(), size), "wrong magic is accepted" );
+		header->magic -= 1;
+
+		header->arrays[eBlobPositions].count += 1000000;
+		fnCheck( false == view.Attach(broken.data(), size), "array out of the block is accepted" );
+		header->arrays[eBlobPositions].count -= 1000000;
+
+		int *polyOffsets = (int*) (broken.data() + header->arrays[eBlobPolyOffsets].offset);
+		std::swap( polyOffsets[1], polyOffsets[2] );
+		fnCheck( false == view.Attach(broken.data(), size), "non monotonic polygon offsets are accepted" );
+		std::swap( polyOffsets[1], polyOffsets[2] );
+
+		int *clusterOffsets = (int*) (broken.data() + header->arrays[eBlobClusterOffsets].offset);
+		clusterOffsets[header->arrays[eBlobClusters].count] += 1;
+		fnCheck( false == view.Attach(broken.data(), size), "cluster offsets out of vertices are accepted" );
+		clusterOffsets[header->arrays[eBlobClusters].count] -= 1;
+
+		fnCheck( view.Attach(broken.data(), size), "restored block is rejected" );
+	}
+
+	printf( "[InputModelBlob] self test %s, %d errors\n", (numberOfErrors == 0) ? "passed" : "FAILED", numberOfErrors );
+	return numberOfErrors == 0;
+}
+
+void InputModelBlobBenchmark(const int gridSize, const int numberOfRepeats)
+{
+	InputModelData	data;
+	MakeBlobTestModel(gridSize, 40, data);
+
+	std::vector<unsigned char>	blob( ComputeInputModelBlobSize(data) );
+	WriteInputModelBlob(data, blob.data(), blob.size() );
+
+	typedef std::chrono::high_resolution_clock	clock;
+
+	// both receivers walk all polygon indices, as the snapshot scene does
+	auto fn_touch = [] (const InputModelBlobView &view) -> int64_t {
+		int64_t sum = 0;
+		for (int i=0, count=view.GetPolyCount(); i<count; ++i)
+		{
+			const int *indices = view.GetPolyIndices(i);
+			for (int j=0, vertCount=view.GetPolyVertexCount(i); j<vertCount; ++j)
+				sum += indices[j];
+		}
+		return sum;
+	};
+
+	int64_t checkSum[2] = {0, 0};
+
+	// legacy receive - unpack into InputModelData (allocation per polygon and cluster) and pack again for the snapshot
+
+	auto startTime = clock::now();
+	for (int i=0; i<numberOfRepeats; ++i)
+	{
+		InputModelData	received;
+		received.InitFromMemory(blob.data() );
+
+		std::vector<unsigned char>	repacked( ComputeInputModelBlobSize(received) );
+		WriteInputModelBlob(received, repacked.data(), repacked.size() );
+
+		InputModelBlobView view;
+		if (view.Attach(repacked.data(), repacked.size()) )
+			checkSum[0] += fn_touch(view);
+	}
+	const double legacySecs = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	// in place - attach the view to the received block
+
+	startTime = clock::now();
+	for (int i=0; i<numberOfRepeats; ++i)
+	{
+		InputModelBlobView view;
+		if (view.Attach(blob.data(), blob.size()) )
+			checkSum[1] += fn_touch(view);
+	}
+	const double inPlaceSecs = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	printf( "[InputModelBlob] %d vertices, %d polygons, %d clusters, block %.2f MB\n",
+		(int) data.positions.size(), (int) data.polyInfo.size(), (int) data.clusters.size(), (double) blob.size() / (1024.0 * 1024.0) );
+	printf( "[InputModelBlob] unpack and repack - %.3f ms, in place - %.3f ms per receive, %s\n",
+		1000.0 * legacySecs / numberOfRepeats, 1000.0 * inPlaceSecs / numberOfRepeats,
+		(checkSum[0] == checkSum[1]) ? "same data" : "DATA DIFFERS" );
+}
@@ -0,0 +1,160 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: MappedFile.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "IO\MappedFile.h"
+
+/////////////////////////////////////////////////////////////
+// MappedFile
+
+MappedFile::MappedFile()
+	: mData(nullptr)
+	, mSize(0)
+#ifdef _WIN32
+	, mFile(INVALID_HANDLE_VALUE)
+	, mMapping(nullptr)
+#else
+	, mFile(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char *filename)
+{
+	Close();
+
+	mFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (FALSE == GetFileSizeEx( (HANDLE) mFile, &size ) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mMapping = CreateFileMapping( (HANDLE) mFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	if (mMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	mData = (const char*) MapViewOfFile( (HANDLE) mMapping, FILE_MAP_READ, 0, 0, 0 );
+	if (mData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	mSize = (size_t) size.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData)
+		UnmapViewOfFile(mData);
+	if (mMapping)
+		CloseHandle( (HANDLE) mMapping );
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle( (HANDLE) mFile );
+
+	mData = nullptr;
+	mSize = 0;
+	mMapping = nullptr;
+	mFile = INVALID_HANDLE_VALUE;
+}
+
+bool MappedFile::GetFileStamp(const char *filename, uint64_t &size, int64_t &writeTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA	attribs;
+	if (FALSE == GetFileAttributesExA(filename, GetFileExInfoStandard, &attribs) )
+		return false;
+
+	size = ((uint64_t) attribs.nFileSizeHigh << 32) | attribs.nFileSizeLow;
+	writeTime = ((int64_t) attribs.ftLastWriteTime.dwHighDateTime << 32) | attribs.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+#else
+
+bool MappedFile::Open(const char *filename)
+{
+	Close();
+
+	mFile = open(filename, O_RDONLY);
+	if (mFile < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(mFile, &st) != 0 || st.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void *data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+	if (data == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+	mData = (const char*) data;
+	mSize = (size_t) st.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData)
+		munmap( (void*) mData, mSize );
+	if (mFile >= 0)
+		close(mFile);
+
+	mData = nullptr;
+	mSize = 0;
+	mFile = -1;
+}
+
+bool MappedFile::GetFileStamp(const char *filename, uint64_t &size, int64_t &writeTime)
+{
+	struct stat st;
+	if (stat(filename, &st) != 0)
+		return false;
+
+	size = (uint64_t) st.st_size;
+	writeTime = (int64_t) st.st_mtime;
+	return true;
+}
+
+#endif
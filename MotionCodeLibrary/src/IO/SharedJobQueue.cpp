@@ -0,0 +1,1306 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: SharedJobQueue.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <spawn.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <time.h>
+extern char **environ;
+#endif
+
+#include "IO\SharedJobQueue.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <chrono>
+#include <thread>
+
+#define	SHARED_JOB_QUEUE_MAGIC			0x424A4D53	// "SMJB"
+#define SHARED_JOB_QUEUE_VERSION		1
+#define SHARED_JOB_ALIGNMENT			64
+#define SHARED_JOB_POLL_MS				50
+#define SHARED_JOB_HOST_CHECK_MS		1000
+#define SHARED_JOB_MAX_ATTEMPTS			2
+#define SHARED_JOB_CREATE_ATTEMPTS		4
+
+typedef std::chrono::steady_clock	job_clock;
+
+static int ElapsedMs(const job_clock::time_point &start)
+{
+	return (int) std::chrono::duration_cast<std::chrono::milliseconds>(job_clock::now() - start).count();
+}
+
+static void CopyJobString(char *dst, const char *src)
+{
+	memset(dst, 0, SHARED_JOB_STRING_LENGTH);
+	if (src)
+		strncpy(dst, src, SHARED_JOB_STRING_LENGTH-1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// SharedMemoryBlock
+
+SharedMemoryBlock::SharedMemoryBlock()
+	: mData(nullptr)
+	, mSize(0)
+	, mOwner(false)
+#ifdef _WIN32
+	, mHandle(nullptr)
+#endif
+{
+}
+
+SharedMemoryBlock::~SharedMemoryBlock()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool SharedMemoryBlock::Create(const char *name, const size_t size)
+{
+	Close();
+
+	const uint64_t size64 = (uint64_t) size;
+	mHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD) (size64 >> 32), (DWORD) (size64 & 0xFFFFFFFF), name);
+	if (mHandle == nullptr)
+		return false;
+
+	// a mapping of another host, don't attach to it
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		Close();
+		return false;
+	}
+
+	mData = MapViewOfFile( (HANDLE) mHandle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size );
+	if (mData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	mSize = size;
+	mOwner = true;
+	mName = name;
+	return true;
+}
+
+bool SharedMemoryBlock::Open(const char *name)
+{
+	Close();
+
+	mHandle = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name);
+	if (mHandle == nullptr)
+		return false;
+
+	mData = MapViewOfFile( (HANDLE) mHandle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0 );
+	if (mData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	MEMORY_BASIC_INFORMATION info;
+	VirtualQuery(mData, &info, sizeof(info));
+	mSize = info.RegionSize;
+	mName = name;
+	return true;
+}
+
+void SharedMemoryBlock::Close()
+{
+	if (mData)
+		UnmapViewOfFile(mData);
+	if (mHandle)
+		CloseHandle( (HANDLE) mHandle );
+
+	mData = nullptr;
+	mHandle = nullptr;
+	mSize = 0;
+	mOwner = false;
+}
+
+#else
+
+bool SharedMemoryBlock::Create(const char *name, const size_t size)
+{
+	Close();
+
+	// EEXIST - a block of another host, it is not unlinked
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+		return false;
+
+	if (ftruncate(fd, (off_t) size) != 0)
+	{
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+
+	void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		shm_unlink(name);
+		return false;
+	}
+
+	mData = data;
+	mSize = size;
+	mOwner = true;
+	mName = name;
+	return true;
+}
+
+bool SharedMemoryBlock::Open(const char *name)
+{
+	Close();
+
+	int fd = shm_open(name, O_RDWR, 0600);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void *data = mmap(nullptr, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	mData = data;
+	mSize = (size_t) st.st_size;
+	mName = name;
+	return true;
+}
+
+void SharedMemoryBlock::Close()
+{
+	if (mData)
+		munmap(mData, mSize);
+	if (mOwner)
+		shm_unlink(mName.c_str());
+
+	mData = nullptr;
+	mSize = 0;
+	mOwner = false;
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// NamedSemaphore
+
+NamedSemaphore::NamedSemaphore()
+	: mHandle(nullptr)
+	, mOwner(false)
+{
+}
+
+NamedSemaphore::~NamedSemaphore()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool NamedSemaphore::Create(const char *name)
+{
+	Close();
+	mHandle = CreateSemaphoreA(NULL, 0, LONG_MAX, name);
+	if (mHandle == nullptr)
+		return false;
+
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		Close();
+		return false;
+	}
+
+	mOwner = true;
+	mName = name;
+	return true;
+}
+
+bool NamedSemaphore::Open(const char *name)
+{
+	Close();
+	mHandle = OpenSemaphoreA(SEMAPHORE_ALL_ACCESS, FALSE, name);
+	mName = name;
+	return (mHandle != nullptr);
+}
+
+void NamedSemaphore::Close()
+{
+	if (mHandle)
+		CloseHandle( (HANDLE) mHandle );
+	mHandle = nullptr;
+	mOwner = false;
+}
+
+void NamedSemaphore::Post()
+{
+	if (mHandle)
+		ReleaseSemaphore( (HANDLE) mHandle, 1, NULL );
+}
+
+bool NamedSemaphore::Wait(const int timeoutMs)
+{
+	if (mHandle == nullptr)
+		return false;
+	return (WAIT_OBJECT_0 == WaitForSingleObject( (HANDLE) mHandle, (timeoutMs < 0) ? INFINITE : (DWORD) timeoutMs ) );
+}
+
+#else
+
+bool NamedSemaphore::Create(const char *name)
+{
+	Close();
+
+	sem_t *sem = sem_open(name, O_CREAT | O_EXCL, 0600, 0);
+	if (sem == SEM_FAILED)
+		return false;
+
+	mHandle = sem;
+	mOwner = true;
+	mName = name;
+	return true;
+}
+
+bool NamedSemaphore::Open(const char *name)
+{
+	Close();
+
+	sem_t *sem = sem_open(name, 0);
+	if (sem == SEM_FAILED)
+		return false;
+
+	mHandle = sem;
+	mName = name;
+	return true;
+}
+
+void NamedSemaphore::Close()
+{
+	if (mHandle)
+		sem_close( (sem_t*) mHandle );
+	if (mOwner)
+		sem_unlink(mName.c_str());
+
+	mHandle = nullptr;
+	mOwner = false;
+}
+
+void NamedSemaphore::Post()
+{
+	if (mHandle)
+		sem_post( (sem_t*) mHandle );
+}
+
+bool NamedSemaphore::Wait(const int timeoutMs)
+{
+	if (mHandle == nullptr)
+		return false;
+
+	if (timeoutMs < 0)
+	{
+		while (sem_wait( (sem_t*) mHandle ) != 0)
+		{
+			if (errno != EINTR)
+				return false;
+		}
+		return true;
+	}
+
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeoutMs / 1000;
+	ts.tv_nsec += (long) (timeoutMs % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L)
+	{
+		ts.tv_sec += 1;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	while (sem_timedwait( (sem_t*) mHandle, &ts ) != 0)
+	{
+		if (errno != EINTR)
+			return false;
+	}
+	return true;
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// WorkerProcess
+
+#ifdef _WIN32
+
+WorkerProcess::WorkerProcess()
+	: mProcess(nullptr)
+{
+}
+
+WorkerProcess::~WorkerProcess()
+{
+	if (mProcess)
+		CloseHandle( (HANDLE) mProcess );
+}
+
+bool WorkerProcess::Launch(const std::vector<std::string> &arguments)
+{
+	if (arguments.size() == 0)
+		return false;
+
+	if (mProcess)
+	{
+		CloseHandle( (HANDLE) mProcess );
+		mProcess = nullptr;
+	}
+
+	std::string commandLine;
+	for (auto iter=begin(arguments); iter!=end(arguments); ++iter)
+	{
+		if (commandLine.size() > 0)
+			commandLine += " ";
+		commandLine += "\"";
+		commandLine += *iter;
+		commandLine += "\"";
+	}
+
+	std::vector<char> buffer(commandLine.begin(), commandLine.end());
+	buffer.push_back(0);
+
+	STARTUPINFOA si;
+	PROCESS_INFORMATION pi;
+
+	ZeroMemory( &si, sizeof(si) );
+	si.cb = sizeof(si);
+	ZeroMemory( &pi, sizeof(pi) );
+
+	if (FALSE == CreateProcessA( NULL, buffer.data(), NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi ) )
+		return false;
+
+	CloseHandle( pi.hThread );
+	mProcess = pi.hProcess;
+	return true;
+}
+
+bool WorkerProcess::IsAlive()
+{
+	return (mProcess != nullptr && WAIT_TIMEOUT == WaitForSingleObject( (HANDLE) mProcess, 0 ) );
+}
+
+void WorkerProcess::Terminate()
+{
+	if (mProcess)
+	{
+		TerminateProcess( (HANDLE) mProcess, 1 );
+		WaitForSingleObject( (HANDLE) mProcess, INFINITE );
+		CloseHandle( (HANDLE) mProcess );
+		mProcess = nullptr;
+	}
+}
+
+bool WorkerProcess::WaitForExit(const int timeoutMs)
+{
+	if (mProcess == nullptr)
+		return true;
+
+	if (WAIT_OBJECT_0 != WaitForSingleObject( (HANDLE) mProcess, (timeoutMs < 0) ? INFINITE : (DWORD) timeoutMs ) )
+		return false;
+
+	CloseHandle( (HANDLE) mProcess );
+	mProcess = nullptr;
+	return true;
+}
+
+uint32_t WorkerProcess::GetCurrentId()
+{
+	return (uint32_t) GetCurrentProcessId();
+}
+
+bool WorkerProcess::IsAlive(const uint32_t pid)
+{
+	HANDLE hProcess = OpenProcess(SYNCHRONIZE, FALSE, (DWORD) pid);
+	if (hProcess == nullptr)
+		return false;
+
+	const bool alive = (WAIT_TIMEOUT == WaitForSingleObject(hProcess, 0) );
+	CloseHandle(hProcess);
+	return alive;
+}
+
+#else
+
+WorkerProcess::WorkerProcess()
+	: mPid(-1)
+{
+}
+
+WorkerProcess::~WorkerProcess()
+{
+}
+
+bool WorkerProcess::Launch(const std::vector<std::string> &arguments)
+{
+	if (arguments.size() == 0)
+		return false;
+
+	std::vector<char*>	argv;
+	for (auto iter=begin(arguments); iter!=end(arguments); ++iter)
+		argv.push_back( const_cast<char*>(iter->c_str()) );
+	argv.push_back(nullptr);
+
+	pid_t pid = -1;
+	if (0 != posix_spawn(&pid, argv[0], nullptr, nullptr, argv.data(), environ) )
+		return false;
+
+	mPid = (int) pid;
+	return true;
+}
+
+bool WorkerProcess::IsAlive()
+{
+	if (mPid <= 0)
+		return false;
+
+	int status = 0;
+	if (0 == waitpid( (pid_t) mPid, &status, WNOHANG ) )
+		return true;
+
+	mPid = -1;
+	return false;
+}
+
+void WorkerProcess::Terminate()
+{
+	if (mPid > 0)
+	{
+		kill( (pid_t) mPid, SIGKILL );
+		waitpid( (pid_t) mPid, nullptr, 0 );
+		mPid = -1;
+	}
+}
+
+bool WorkerProcess::WaitForExit(const int timeoutMs)
+{
+	const job_clock::time_point start = job_clock::now();
+
+	while (IsAlive())
+	{
+		if (timeoutMs >= 0 && ElapsedMs(start) > timeoutMs)
+			return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return true;
+}
+
+uint32_t WorkerProcess::GetCurrentId()
+{
+	return (uint32_t) getpid();
+}
+
+bool WorkerProcess::IsAlive(const uint32_t pid)
+{
+	return (0 == kill( (pid_t) pid, 0 ) || errno == EPERM);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// SharedJobQueue
+
+SharedJobQueue::SharedJobQueue()
+	: mHeader(nullptr)
+	, mSlots(nullptr)
+	, mSlotStride(0)
+{
+}
+
+std::string SharedJobQueue::MakeObjectName(const char *name, const char *suffix)
+{
+#ifdef _WIN32
+	std::string result("Local\\");
+#else
+	std::string result("/");
+#endif
+	result += name;
+	result += suffix;
+	return result;
+}
+
+std::string SharedJobQueue::MakeUniqueName(const char *prefix)
+{
+	static std::atomic<uint32_t>	counter(0);
+
+	std::string result(prefix);
+	result += "_";
+	result += std::to_string( (unsigned long long) WorkerProcess::GetCurrentId() );
+	result += "_";
+	result += std::to_string( (unsigned long long) counter.fetch_add(1) );
+	return result;
+}
+
+static size_t AlignJobSize(const size_t size)
+{
+	return (size + SHARED_JOB_ALIGNMENT - 1) & ~((size_t) SHARED_JOB_ALIGNMENT - 1);
+}
+
+bool SharedJobQueue::Create(const char *name, const int slotCount, const size_t slotSize)
+{
+	Close();
+
+	if (slotCount <= 0 || slotSize == 0)
+		return false;
+
+	const size_t headerSize = AlignJobSize(sizeof(SharedJobQueueHeader));
+	const size_t stride = AlignJobSize(sizeof(SharedJobSlot)) + AlignJobSize(slotSize);
+	const size_t totalSize = headerSize + stride * slotCount;
+
+	if (false == mMemory.Create(MakeObjectName(name, "_mem").c_str(), totalSize)
+		|| false == mJobsSemaphore.Create(MakeObjectName(name, "_jobs").c_str())
+		|| false == mDoneSemaphore.Create(MakeObjectName(name, "_done").c_str()) )
+	{
+		Close();
+		return false;
+	}
+
+	memset(mMemory.GetData(), 0, totalSize);
+
+	mHeader = (SharedJobQueueHeader*) mMemory.GetData();
+	mHeader->magic = SHARED_JOB_QUEUE_MAGIC;
+	mHeader->version = SHARED_JOB_QUEUE_VERSION;
+	mHeader->slotCount = (uint32_t) slotCount;
+	mHeader->hostPid = WorkerProcess::GetCurrentId();
+	mHeader->slotSize = (uint64_t) slotSize;
+	mHeader->shutdown.store(0);
+	mHeader->workerReady.store(0);
+	mHeader->heartbeat.store(0);
+
+	mSlots = (unsigned char*) mMemory.GetData() + headerSize;
+	mSlotStride = stride;
+
+	for (int i=0; i<slotCount; ++i)
+		GetSlot(i)->state.store(eSharedJobFree);
+
+	return true;
+}
+
+bool SharedJobQueue::Open(const char *name)
+{
+	Close();
+
+	if (false == mMemory.Open(MakeObjectName(name, "_mem").c_str())
+		|| false == mJobsSemaphore.Open(MakeObjectName(name, "_jobs").c_str())
+		|| false == mDoneSemaphore.Open(MakeObjectName(name, "_done").c_str()) )
+	{
+		Close();
+		return false;
+	}
+
+	SharedJobQueueHeader *header = (SharedJobQueueHeader*) mMemory.GetData();
+	if (header->magic != SHARED_JOB_QUEUE_MAGIC || header->version != SHARED_JOB_QUEUE_VERSION)
+	{
+		Close();
+		return false;
+	}
+
+	mHeader = header;
+	mSlots = (unsigned char*) mMemory.GetData() + AlignJobSize(sizeof(SharedJobQueueHeader));
+	mSlotStride = AlignJobSize(sizeof(SharedJobSlot)) + AlignJobSize( (size_t) header->slotSize );
+	return true;
+}
+
+void SharedJobQueue::Close()
+{
+	mDoneSemaphore.Close();
+	mJobsSemaphore.Close();
+	mMemory.Close();
+
+	mHeader = nullptr;
+	mSlots = nullptr;
+	mSlotStride = 0;
+}
+
+SharedJobSlot *SharedJobQueue::GetSlot(const int index) const
+{
+	return (SharedJobSlot*) (mSlots + mSlotStride * index);
+}
+
+void *SharedJobQueue::GetPayload(const int index) const
+{
+	return mSlots + mSlotStride * index + AlignJobSize(sizeof(SharedJobSlot));
+}
+
+int SharedJobQueue::AcquireSlot()
+{
+	for (int i=0, count=GetSlotCount(); i<count; ++i)
+	{
+		uint32_t expected = eSharedJobFree;
+		if (GetSlot(i)->state.compare_exchange_strong(expected, eSharedJobWriting) )
+			return i;
+	}
+	return -1;
+}
+
+void SharedJobQueue::Submit(const int index)
+{
+	SharedJobSlot *slot = GetSlot(index);
+	slot->attempts = 0;
+	slot->resultCode = 0;
+	slot->state.store(eSharedJobPending);
+	mJobsSemaphore.Post();
+}
+
+bool SharedJobQueue::WaitCompletion(const int timeoutMs)
+{
+	return mDoneSemaphore.Wait(timeoutMs);
+}
+
+void SharedJobQueue::ReleaseSlot(const int index)
+{
+	SharedJobSlot *slot = GetSlot(index);
+	slot->jobId = 0;
+	slot->state.store(eSharedJobFree);
+}
+
+int SharedJobQueue::RequeueInterrupted(const uint32_t maxAttempts)
+{
+	int count = 0;
+
+	for (int i=0, slotCount=GetSlotCount(); i<slotCount; ++i)
+	{
+		SharedJobSlot *slot = GetSlot(i);
+		uint32_t expected = eSharedJobProcessing;
+
+		if (slot->attempts >= maxAttempts)
+		{
+			// the job has crashed the worker too many times
+			if (slot->state.compare_exchange_strong(expected, eSharedJobFailed) )
+				slot->resultCode = -1;
+		}
+		else if (slot->state.compare_exchange_strong(expected, eSharedJobPending) )
+		{
+			mJobsSemaphore.Post();
+			++count;
+		}
+	}
+
+	return count;
+}
+
+int SharedJobQueue::TakeJob(const int timeoutMs)
+{
+	// semaphore is only a wake up hint, a crashed worker could take a signal without the job
+	mJobsSemaphore.Wait(timeoutMs);
+
+	// oldest pending job first
+	int bestIndex = -1;
+	uint32_t bestJobId = 0;
+
+	for (int i=0, count=GetSlotCount(); i<count; ++i)
+	{
+		SharedJobSlot *slot = GetSlot(i);
+		if (slot->state.load() == eSharedJobPending && (bestIndex < 0 || slot->jobId < bestJobId) )
+		{
+			bestIndex = i;
+			bestJobId = slot->jobId;
+		}
+	}
+
+	if (bestIndex >= 0)
+	{
+		SharedJobSlot *slot = GetSlot(bestIndex);
+		uint32_t expected = eSharedJobPending;
+		if (slot->state.compare_exchange_strong(expected, eSharedJobProcessing) )
+		{
+			slot->attempts += 1;
+			return bestIndex;
+		}
+	}
+
+	return -1;
+}
+
+void SharedJobQueue::CompleteJob(const int index, const bool success, const int resultCode)
+{
+	SharedJobSlot *slot = GetSlot(index);
+	slot->resultCode = resultCode;
+	slot->state.store( (success) ? eSharedJobDone : eSharedJobFailed );
+	mDoneSemaphore.Post();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// PersistentWorkerQueue
+
+PersistentWorkerQueue::PersistentWorkerQueue()
+	: mRunning(false)
+	, mNextJobId(1)
+	, mStartTimeoutMs(0)
+{
+	memset(&mStats, 0, sizeof(Stats));
+}
+
+PersistentWorkerQueue::~PersistentWorkerQueue()
+{
+	Stop();
+}
+
+bool PersistentWorkerQueue::Start(const char *name, const std::vector<std::string> &arguments, const int slotCount, const size_t slotSize, const int startTimeoutMs)
+{
+	Stop();
+
+	// objects of another host are not reused, try the name with a suffix
+
+	bool created = false;
+	for (int i=0; i<SHARED_JOB_CREATE_ATTEMPTS && false == created; ++i)
+	{
+		mName = name;
+		if (i > 0)
+			mName += "_" + std::to_string( (long long) i );
+
+		created = mQueue.Create(mName.c_str(), slotCount, slotSize);
+	}
+
+	if (false == created)
+	{
+		printf( "[PersistentWorkerQueue] failed to create shared memory queue %s\n", name );
+		return false;
+	}
+
+	mArguments = arguments;
+	mArguments.push_back("-worker");
+	mArguments.push_back(mName);
+	mStartTimeoutMs = startTimeoutMs;
+
+	if (false == LaunchWorker() )
+	{
+		mQueue.Close();
+		return false;
+	}
+
+	mRunning = true;
+	return true;
+}
+
+void PersistentWorkerQueue::Stop()
+{
+	if (mQueue.IsOpen())
+	{
+		mQueue.GetHeader()->shutdown.store(1);
+
+		if (false == mProcess.WaitForExit(mStartTimeoutMs) )
+			mProcess.Terminate();
+
+		mQueue.Close();
+	}
+
+	mRunning = false;
+}
+
+bool PersistentWorkerQueue::LaunchWorker()
+{
+	SharedJobQueueHeader *header = mQueue.GetHeader();
+	header->workerReady.store(0);
+
+	if (false == mProcess.Launch(mArguments) )
+	{
+		printf( "[PersistentWorkerQueue] failed to launch worker %s\n", mArguments[0].c_str() );
+		return false;
+	}
+
+	// worker initialization (FBX SDK and so on) is paid once here
+	const job_clock::time_point start = job_clock::now();
+	while (header->workerReady.load() == 0)
+	{
+		if (false == mProcess.IsAlive() || ElapsedMs(start) > mStartTimeoutMs)
+		{
+			printf( "[PersistentWorkerQueue] worker is not ready in time\n" );
+			mProcess.Terminate();
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return true;
+}
+
+bool PersistentWorkerQueue::RestartWorker()
+{
+	mProcess.Terminate();
+	mStats.restarts += 1;
+
+	mQueue.RequeueInterrupted(SHARED_JOB_MAX_ATTEMPTS);
+
+	if (false == LaunchWorker() )
+	{
+		mRunning = false;
+		return false;
+	}
+	return true;
+}
+
+bool PersistentWorkerQueue::CheckWorker()
+{
+	if (false == mRunning)
+		return false;
+
+	if (mProcess.IsAlive())
+		return true;
+
+	printf( "[PersistentWorkerQueue] worker is gone, restarting\n" );
+	return RestartWorker();
+}
+
+int PersistentWorkerQueue::FindJobSlot(const uint32_t jobId) const
+{
+	for (int i=0, count=mQueue.GetSlotCount(); i<count; ++i)
+	{
+		const SharedJobSlot *slot = mQueue.GetSlot(i);
+		if (slot->jobId == jobId && slot->state.load() != eSharedJobFree)
+			return i;
+	}
+	return -1;
+}
+
+uint32_t PersistentWorkerQueue::Submit(const char *name0, const char *name1, const uint32_t flags, const PayloadWriter &writer, const int timeoutMs)
+{
+	if (false == mRunning)
+		return 0;
+
+	const job_clock::time_point start = job_clock::now();
+
+	int index = mQueue.AcquireSlot();
+	while (index < 0)
+	{
+		if (ElapsedMs(start) > timeoutMs || false == CheckWorker())
+			return 0;
+
+		mQueue.WaitCompletion(SHARED_JOB_POLL_MS);
+		index = mQueue.AcquireSlot();
+	}
+
+	SharedJobSlot *slot = mQueue.GetSlot(index);
+	const size_t size = writer( mQueue.GetPayload(index), mQueue.GetSlotSize() );
+
+	if (size == 0 || size > mQueue.GetSlotSize())
+	{
+		mQueue.ReleaseSlot(index);
+		return 0;
+	}
+
+	const uint32_t jobId = mNextJobId++;
+	if (mNextJobId == 0)
+		mNextJobId = 1;
+
+	slot->jobId = jobId;
+	slot->flags = flags;
+	slot->payloadSize = (uint64_t) size;
+	CopyJobString(slot->name0, name0);
+	CopyJobString(slot->name1, name1);
+
+	mQueue.Submit(index);
+	mStats.submitted += 1;
+
+	return jobId;
+}
+
+ESharedJobResult PersistentWorkerQueue::Wait(const uint32_t jobId, const int timeoutMs, int *resultCode)
+{
+	const int index = FindJobSlot(jobId);
+	if (index < 0)
+		return eSharedJobResultLost;
+
+	SharedJobSlot *slot = mQueue.GetSlot(index);
+	const job_clock::time_point start = job_clock::now();
+
+	for (;;)
+	{
+		const uint32_t state = slot->state.load();
+
+		if (state == eSharedJobDone || state == eSharedJobFailed)
+		{
+			if (resultCode)
+				*resultCode = slot->resultCode;
+
+			mQueue.ReleaseSlot(index);
+
+			if (state == eSharedJobDone)
+			{
+				mStats.completed += 1;
+				return eSharedJobResultDone;
+			}
+
+			mStats.failed += 1;
+			return eSharedJobResultFailed;
+		}
+
+		if (timeoutMs >= 0 && ElapsedMs(start) > timeoutMs)
+		{
+			uint32_t expected = eSharedJobPending;
+			if (slot->state.compare_exchange_strong(expected, eSharedJobFree) )
+			{
+				// worker has not started the job yet
+				mStats.timeouts += 1;
+				return eSharedJobResultTimeout;
+			}
+			else if (expected == eSharedJobProcessing)
+			{
+				// hung worker, drop the job and give a fresh process to the rest of the queue
+				slot->attempts = SHARED_JOB_MAX_ATTEMPTS;
+				RestartWorker();
+
+				mQueue.ReleaseSlot(index);
+				mStats.timeouts += 1;
+				return eSharedJobResultTimeout;
+			}
+			// job has just been completed, take the result on the next loop
+			continue;
+		}
+
+		if (false == CheckWorker() && slot->state.load() != eSharedJobFailed)
+		{
+			mQueue.ReleaseSlot(index);
+			mStats.failed += 1;
+			return eSharedJobResultLost;
+		}
+
+		mQueue.WaitCompletion(SHARED_JOB_POLL_MS);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// worker loop
+
+int RunSharedJobWorker(const char *name, const SharedJobHandler &handler)
+{
+	SharedJobQueue	queue;
+
+	if (false == queue.Open(name))
+	{
+		printf( "[SharedJobWorker] failed to open queue %s\n", name );
+		return 1;
+	}
+
+	SharedJobQueueHeader *header = queue.GetHeader();
+	header->workerReady.store(1);
+
+	job_clock::time_point lastHostCheck = job_clock::now();
+
+	while (header->shutdown.load() == 0)
+	{
+		header->heartbeat.fetch_add(1);
+
+		if (ElapsedMs(lastHostCheck) > SHARED_JOB_HOST_CHECK_MS)
+		{
+			if (false == WorkerProcess::IsAlive(header->hostPid))
+				break;
+			lastHostCheck = job_clock::now();
+		}
+
+		const int index = queue.TakeJob(SHARED_JOB_POLL_MS * 4);
+		if (index < 0)
+			continue;
+
+		const SharedJobSlot *slot = queue.GetSlot(index);
+		int resultCode = 0;
+		const bool success = handler( *slot, queue.GetPayload(index), resultCode );
+
+		queue.CompleteJob(index, success, resultCode);
+	}
+
+	queue.Close();
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// stand-in worker, self test and benchmark
+
+int SharedJobPayloadChecksum(const void *payload, const size_t size)
+{
+	// FNV-1a
+	const unsigned char *data = (const unsigned char*) payload;
+	uint32_t hash = 2166136261u;
+	for (size_t i=0; i<size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return (int) (hash & 0x7FFFFFFF);
+}
+
+int RunSharedJobStandInWorker(const char *name)
+{
+	return RunSharedJobWorker( name, [] (const SharedJobSlot &slot, const void *payload, int &resultCode) -> bool {
+
+		if ( (slot.flags & SHARED_JOB_STANDIN_CRASH) || ((slot.flags & SHARED_JOB_STANDIN_CRASH_ONCE) && slot.attempts <= 1) )
+			_Exit(3);
+
+		if ( (slot.flags & SHARED_JOB_STANDIN_SLEEP) && slot.payloadSize >= sizeof(uint32_t) )
+		{
+			uint32_t sleepMs = 0;
+			memcpy( &sleepMs, payload, sizeof(uint32_t) );
+			std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+		}
+
+		resultCode = SharedJobPayloadChecksum(payload, (size_t) slot.payloadSize);
+		return 0 == (slot.flags & SHARED_JOB_STANDIN_FAIL);
+	} );
+}
+
+// queue objects of every run get their own names
+static std::string MakeTestQueueName(const char *prefix, const int index)
+{
+	std::string name(prefix);
+	name += std::to_string( (unsigned long long) WorkerProcess::GetCurrentId() );
+	name += "_";
+	name += std::to_string( (long long) index );
+	return name;
+}
+
+// payload of size bytes, sleep time goes first, returns a job id and the expected checksum
+static uint32_t SubmitStandInJob(PersistentWorkerQueue &queue, const uint32_t flags, const uint32_t sleepMs, const size_t size, const int seed, int &checksum)
+{
+	return queue.Submit( "standin", "job", flags, [sleepMs, size, seed, &checksum] (void *payload, const size_t capacity) -> size_t {
+
+		if (size > capacity || size < sizeof(uint32_t) )
+			return 0;
+
+		unsigned char *data = (unsigned char*) payload;
+		for (size_t i=0; i<size; ++i)
+			data[i] = (unsigned char) (seed + i * 7 + (i >> 8));
+
+		memcpy( data, &sleepMs, sizeof(uint32_t) );
+
+		checksum = SharedJobPayloadChecksum(data, size);
+		return size;
+	}, 5000 );
+}
+
+bool SharedJobQueueSelfTest(const std::vector<std::string> &arguments)
+{
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf( "[SharedJobQueue] %s\n", text );
+			numberOfErrors += 1;
+		}
+	};
+
+	const int slotCount = 2;
+	const size_t slotSize = 64 * 1024;
+
+	PersistentWorkerQueue	queue;
+	if (false == queue.Start( MakeTestQueueName("sharedjobtest", 0).c_str(), arguments, slotCount, slotSize, 5000 ) )
+	{
+		printf( "[SharedJobQueue] self test FAILED, stand-in worker is not started\n" );
+		return false;
+	}
+
+	int resultCode = 0;
+
+	// 0 - a second host with the same name neither attaches to the queue nor removes it
+
+	{
+		SharedJobQueue	other;
+		fnCheck( false == other.Create(queue.GetName(), slotCount, slotSize), "second host is attached to a running queue" );
+		other.Close();
+
+		PersistentWorkerQueue	otherQueue;
+		fnCheck( otherQueue.Start(queue.GetName(), arguments, slotCount, slotSize, 5000)
+			&& strcmp(otherQueue.GetName(), queue.GetName()) != 0, "second host doesn't take another name" );
+		otherQueue.Stop();
+	}
+
+	// 1 - a batch through a ring smaller than the batch, results in order
+
+	{
+		const int numberOfJobs = 8;
+		std::vector<uint32_t>	jobs(numberOfJobs, 0);
+		std::vector<int>		checksums(numberOfJobs, 0);
+
+		int next = 0;
+		int numberOfDone = 0;
+
+		for (int waitIndex=0; waitIndex<numberOfJobs; ++waitIndex)
+		{
+			while (next < numberOfJobs && next - waitIndex < slotCount)
+			{
+				jobs[next] = SubmitStandInJob(queue, 0, 0, 1000 + next * 3000, next, checksums[next]);
+				next += 1;
+			}
+
+			if (jobs[waitIndex] > 0 && eSharedJobResultDone == queue.Wait(jobs[waitIndex], 5000, &resultCode) && resultCode == checksums[waitIndex])
+				numberOfDone += 1;
+		}
+		fnCheck( numberOfDone == numberOfJobs, "batch jobs are not completed with their payloads" );
+	}
+
+	// 2 - a failed job keeps its result code, a payload bigger than a slot is not queued
+
+	{
+		int checksum = 0;
+		const uint32_t jobId = SubmitStandInJob(queue, SHARED_JOB_STANDIN_FAIL, 0, 256, 1, checksum);
+		fnCheck( jobId > 0 && eSharedJobResultFailed == queue.Wait(jobId, 5000, &resultCode) && resultCode == checksum,
+			"failed job is not reported" );
+
+		fnCheck( 0 == SubmitStandInJob(queue, 0, 0, slotSize + 1, 2, checksum), "payload bigger than a slot is queued" );
+		fnCheck( eSharedJobResultLost == queue.Wait(12345, 100), "unknown job id is not reported as lost" );
+	}
+
+	// 3 - worker crash in the middle of a job, the job is taken again by a restarted worker
+
+	{
+		int checksum = 0;
+		const uint32_t jobId = SubmitStandInJob(queue, SHARED_JOB_STANDIN_CRASH_ONCE, 0, 512, 3, checksum);
+		fnCheck( jobId > 0 && eSharedJobResultDone == queue.Wait(jobId, 10000, &resultCode) && resultCode == checksum,
+			"interrupted job is not completed after a restart" );
+		fnCheck( queue.GetStats().restarts == 1, "crashed worker is not restarted once" );
+	}
+
+	// 4 - a job that crashes every worker fails after max attempts, the queue keeps working
+
+	{
+		int checksum = 0;
+		const uint32_t jobId = SubmitStandInJob(queue, SHARED_JOB_STANDIN_CRASH, 0, 512, 4, checksum);
+		fnCheck( jobId > 0 && eSharedJobResultFailed == queue.Wait(jobId, 10000, &resultCode) && resultCode == -1,
+			"job that crashes a worker is not failed" );
+		fnCheck( queue.GetStats().restarts == 1 + SHARED_JOB_MAX_ATTEMPTS, "wrong number of restarts for a crashing job" );
+
+		const uint32_t nextJobId = SubmitStandInJob(queue, 0, 0, 512, 5, checksum);
+		fnCheck( nextJobId > 0 && eSharedJobResultDone == queue.Wait(nextJobId, 5000, &resultCode) && resultCode == checksum,
+			"queue doesn't work after a crashing job" );
+	}
+
+	// 5 - hung job times out, the worker is replaced
+
+	{
+		int checksum = 0;
+		const int restarts = queue.GetStats().restarts;
+
+		const uint32_t jobId = SubmitStandInJob(queue, SHARED_JOB_STANDIN_SLEEP, 30000, 512, 6, checksum);
+		const job_clock::time_point start = job_clock::now();
+
+		fnCheck( jobId > 0 && eSharedJobResultTimeout == queue.Wait(jobId, 300), "hung job doesn't time out" );
+		fnCheck( ElapsedMs(start) < 5000, "hung job holds the host" );
+		fnCheck( queue.GetStats().restarts == restarts + 1, "hung worker is not restarted" );
+
+		const uint32_t nextJobId = SubmitStandInJob(queue, 0, 0, 512, 7, checksum);
+		fnCheck( nextJobId > 0 && eSharedJobResultDone == queue.Wait(nextJobId, 5000, &resultCode) && resultCode == checksum,
+			"queue doesn't work after a timeout" );
+	}
+
+	const PersistentWorkerQueue::Stats &stats = queue.GetStats();
+	printf( "[SharedJobQueue] submitted %d, completed %d, failed %d, timeouts %d, restarts %d\n",
+		stats.submitted, stats.completed, stats.failed, stats.timeouts, stats.restarts );
+
+	queue.Stop();
+	fnCheck( false == queue.IsRunning(), "queue is running after stop" );
+
+	printf( "[SharedJobQueue] self test %s, %d errors\n", (numberOfErrors == 0) ? "passed" : "FAILED", numberOfErrors );
+	return numberOfErrors == 0;
+}
+
+void SharedJobQueueBenchmark(const std::vector<std::string> &arguments, const int numberOfJobs, const size_t payloadSize)
+{
+	if (numberOfJobs <= 0)
+		return;
+
+	int resultCode = 0;
+	int checksum = 0;
+
+	// a process per job, as snapshots are made without the persistent worker.
+	//	stop is not timed, a process per job exits right after its job
+
+	int numberOfDone[2] = {0, 0};
+	double processMs = 0.0;
+
+	for (int i=0; i<numberOfJobs; ++i)
+	{
+		PersistentWorkerQueue	queue;
+		const job_clock::time_point start = job_clock::now();
+
+		if (false == queue.Start( MakeTestQueueName("sharedjobbench", i + 1).c_str(), arguments, 1, payloadSize, 5000 ) )
+			break;
+
+		const uint32_t jobId = SubmitStandInJob(queue, 0, 0, payloadSize, i, checksum);
+		if (jobId > 0 && eSharedJobResultDone == queue.Wait(jobId, 5000, &resultCode) && resultCode == checksum)
+			numberOfDone[0] += 1;
+
+		processMs += (double) std::chrono::duration_cast<std::chrono::microseconds>(job_clock::now() - start).count() * 0.001;
+		queue.Stop();
+	}
+
+	// one persistent worker, the ring is kept filled as CmdMakeSnapshotFBX_SendBatch does
+
+	const int slotCount = 4;
+	double persistentMs = 0.0;
+	double startMs = 0.0;
+
+	{
+		PersistentWorkerQueue	queue;
+		job_clock::time_point start = job_clock::now();
+
+		if (queue.Start( MakeTestQueueName("sharedjobbench", 0).c_str(), arguments, slotCount, payloadSize, 5000 ) )
+		{
+			startMs = (double) std::chrono::duration_cast<std::chrono::microseconds>(job_clock::now() - start).count() * 0.001;
+			start = job_clock::now();
+
+			std::vector<uint32_t>	jobs(numberOfJobs, 0);
+			std::vector<int>		checksums(numberOfJobs, 0);
+			int next = 0;
+
+			for (int waitIndex=0; waitIndex<numberOfJobs; ++waitIndex)
+			{
+				while (next < numberOfJobs && next - waitIndex < slotCount)
+				{
+					jobs[next] = SubmitStandInJob(queue, 0, 0, payloadSize, next, checksums[next]);
+					next += 1;
+				}
+
+				if (jobs[waitIndex] > 0 && eSharedJobResultDone == queue.Wait(jobs[waitIndex], 5000, &resultCode) && resultCode == checksums[waitIndex])
+					numberOfDone[1] += 1;
+			}
+
+			persistentMs = (double) std::chrono::duration_cast<std::chrono::microseconds>(job_clock::now() - start).count() * 0.001;
+			queue.Stop();
+		}
+	}
+
+	printf( "[SharedJobQueue] %d jobs, payload %.2f KB\n", numberOfJobs, (double) payloadSize / 1024.0 );
+	printf( "[SharedJobQueue] process per job - %.3f ms per job, %d done\n", processMs / numberOfJobs, numberOfDone[0] );
+	printf( "[SharedJobQueue] persistent worker - %.3f ms per job, %d done, %.3f ms worker start\n", persistentMs / numberOfJobs, numberOfDone[1], startMs );
+}
@@ -0,0 +1,505 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: CurveProximity.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "algorithm\CurveProximity.h"
+#include "algorithm\math3d_mobu.h"
+#include "algorithm\ParallelFor.h"
+#include <limits>
+#include <algorithm>
+#include <chrono>
+
+#define	CURVE_PROXIMITY_LEAF_SEGMENTS		4
+#define CURVE_PROXIMITY_NEWTON_ITERATIONS	6
+#define CURVE_PROXIMITY_STACK_SIZE			64
+#define CURVE_PROXIMITY_BATCH_GRAIN			256
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// hermite span helpers
+
+static void HermiteEval(const double *p0, const double *m0, const double *p1, const double *m1, const double t, double *c, double *d, double *dd)
+{
+	const double t2 = t * t;
+	const double t3 = t2 * t;
+
+	const double h00 = 2.0*t3 - 3.0*t2 + 1.0;
+	const double h10 = t3 - 2.0*t2 + t;
+	const double h01 = -2.0*t3 + 3.0*t2;
+	const double h11 = t3 - t2;
+
+	const double d00 = 6.0*t2 - 6.0*t;
+	const double d10 = 3.0*t2 - 4.0*t + 1.0;
+	const double d01 = -6.0*t2 + 6.0*t;
+	const double d11 = 3.0*t2 - 2.0*t;
+
+	const double dd00 = 12.0*t - 6.0;
+	const double dd10 = 6.0*t - 4.0;
+	const double dd01 = -12.0*t + 6.0;
+	const double dd11 = 6.0*t - 2.0;
+
+	for (int i=0; i<3; ++i)
+	{
+		c[i] = h00*p0[i] + h10*m0[i] + h01*p1[i] + h11*m1[i];
+		d[i] = d00*p0[i] + d10*m0[i] + d01*p1[i] + d11*m1[i];
+		dd[i] = dd00*p0[i] + dd10*m0[i] + dd01*p1[i] + dd11*m1[i];
+	}
+}
+
+static double BoxDistanceSq(const double *bbMin, const double *bbMax, const double *pos)
+{
+	double distSq = 0.0;
+	for (int i=0; i<3; ++i)
+	{
+		double v = 0.0;
+		if (pos[i] < bbMin[i]) v = bbMin[i] - pos[i];
+		else if (pos[i] > bbMax[i]) v = pos[i] - bbMax[i];
+		distSq += v * v;
+	}
+	return distSq;
+}
+
+static void BoxExpand(double *bbMin, double *bbMax, const double *p)
+{
+	for (int i=0; i<3; ++i)
+	{
+		if (p[i] < bbMin[i]) bbMin[i] = p[i];
+		if (p[i] > bbMax[i]) bbMax[i] = p[i];
+	}
+}
+
+static void BoxReset(double *bbMin, double *bbMax)
+{
+	for (int i=0; i<3; ++i)
+	{
+		bbMin[i] = std::numeric_limits<double>::max();
+		bbMax[i] = -std::numeric_limits<double>::max();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CurveProximityIndex
+
+CurveProximityIndex::CurveProximityIndex()
+	: mMaxDepth(0)
+{
+}
+
+void CurveProximityIndex::Clear()
+{
+	mSpans.clear();
+	mSegments.clear();
+	mSegmentOrder.clear();
+	mNodes.clear();
+	mMaxDepth = 0;
+}
+
+bool CurveProximityIndex::Build( FBModelPath3D *pCurve, const int numberOfSegments, const int spansPerSegment )
+{
+	Clear();
+
+	if (pCurve == nullptr || numberOfSegments < 1 || spansPerSegment < 1)
+		return false;
+
+	if (pCurve->PathKeyGetCount() < 2)
+		return false;
+
+	const int numberOfSamples = numberOfSegments * spansPerSegment + 1;
+	const double step = 100.0 / (numberOfSamples - 1);
+
+	std::vector<double>	positions(numberOfSamples * 3);
+
+	for (int i=0; i<numberOfSamples; ++i)
+	{
+		FBVector4d p = pCurve->Total_GlobalPathEvaluate(step * i);
+		positions[i*3] = p[0];
+		positions[i*3+1] = p[1];
+		positions[i*3+2] = p[2];
+	}
+
+	return Build( numberOfSamples, positions.data(), spansPerSegment );
+}
+
+bool CurveProximityIndex::Build( const int numberOfSamples, const double *positions, const int spansPerSegment )
+{
+	Clear();
+
+	if (numberOfSamples < 2 || positions == nullptr || spansPerSegment < 1)
+		return false;
+
+	const int numberOfSpans = numberOfSamples - 1;
+	const double step = 100.0 / numberOfSpans;
+
+	// catmull-rom tangents, one-sided on the ends
+	std::vector<double> tangents(numberOfSamples * 3);
+	for (int i=0; i<numberOfSamples; ++i)
+	{
+		const int prev = (i > 0) ? i-1 : i;
+		const int next = (i < numberOfSpans) ? i+1 : i;
+		const double scale = (next - prev > 1) ? 0.5 : 1.0;
+
+		for (int k=0; k<3; ++k)
+			tangents[i*3+k] = scale * (positions[next*3+k] - positions[prev*3+k]);
+	}
+
+	mSpans.resize(numberOfSpans);
+	for (int i=0; i<numberOfSpans; ++i)
+	{
+		Span &span = mSpans[i];
+		for (int k=0; k<3; ++k)
+		{
+			span.p0[k] = positions[i*3+k];
+			span.m0[k] = tangents[i*3+k];
+			span.p1[k] = positions[(i+1)*3+k];
+			span.m1[k] = tangents[(i+1)*3+k];
+		}
+		span.percent0 = step * i;
+		span.percent1 = (i == numberOfSpans-1) ? 100.0 : step * (i+1);
+	}
+
+	// segments are bounded by the bezier hull of every span
+	const int numberOfSegments = (numberOfSpans + spansPerSegment - 1) / spansPerSegment;
+	mSegments.resize(numberOfSegments);
+	mSegmentOrder.resize(numberOfSegments);
+
+	for (int i=0; i<numberOfSegments; ++i)
+	{
+		Segment &seg = mSegments[i];
+		seg.firstSpan = i * spansPerSegment;
+		seg.spanCount = std::min(spansPerSegment, numberOfSpans - seg.firstSpan);
+
+		BoxReset(seg.bbMin, seg.bbMax);
+
+		for (int j=seg.firstSpan; j<seg.firstSpan+seg.spanCount; ++j)
+		{
+			const Span &span = mSpans[j];
+			double b1[3], b2[3];
+			for (int k=0; k<3; ++k)
+			{
+				b1[k] = span.p0[k] + span.m0[k] / 3.0;
+				b2[k] = span.p1[k] - span.m1[k] / 3.0;
+			}
+
+			BoxExpand(seg.bbMin, seg.bbMax, span.p0);
+			BoxExpand(seg.bbMin, seg.bbMax, b1);
+			BoxExpand(seg.bbMin, seg.bbMax, b2);
+			BoxExpand(seg.bbMin, seg.bbMax, span.p1);
+		}
+
+		mSegmentOrder[i] = i;
+	}
+
+	mNodes.reserve(2 * numberOfSegments);
+	BuildNode(0, numberOfSegments, 0);
+
+	return true;
+}
+
+int CurveProximityIndex::BuildNode( const int first, const int count, const int depth )
+{
+	mMaxDepth = std::max(mMaxDepth, depth);
+
+	const int nodeIndex = (int) mNodes.size();
+	mNodes.push_back(Node());
+
+	Node node;
+	BoxReset(node.bbMin, node.bbMax);
+
+	for (int i=first; i<first+count; ++i)
+	{
+		const Segment &seg = mSegments[mSegmentOrder[i]];
+		BoxExpand(node.bbMin, node.bbMax, seg.bbMin);
+		BoxExpand(node.bbMin, node.bbMax, seg.bbMax);
+	}
+
+	node.left = -1;
+	node.right = -1;
+	node.firstSegment = first;
+	node.segmentCount = count;
+
+	if (count > CURVE_PROXIMITY_LEAF_SEGMENTS)
+	{
+		// median split by the longest axis of segment centers
+		int axis = 0;
+		double extent = node.bbMax[0] - node.bbMin[0];
+		for (int k=1; k<3; ++k)
+		{
+			if (node.bbMax[k] - node.bbMin[k] > extent)
+			{
+				extent = node.bbMax[k] - node.bbMin[k];
+				axis = k;
+			}
+		}
+
+		const int half = count / 2;
+		const std::vector<Segment> &segments = mSegments;
+
+		std::nth_element( mSegmentOrder.begin() + first, mSegmentOrder.begin() + first + half, mSegmentOrder.begin() + first + count,
+			[&segments, axis] (const int a, const int b) {
+				return (segments[a].bbMin[axis] + segments[a].bbMax[axis]) < (segments[b].bbMin[axis] + segments[b].bbMax[axis]);
+		} );
+
+		node.left = BuildNode(first, half, depth + 1);
+		node.right = BuildNode(first + half, count - half, depth + 1);
+	}
+
+	mNodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+void CurveProximityIndex::SpanClosestPoint( const Span &span, const double *pos, double &t, double &distSq ) const
+{
+	// initial guess from the span chord
+	double chord[3], toPos[3];
+	double chordLenSq = 0.0;
+	double proj = 0.0;
+
+	for (int k=0; k<3; ++k)
+	{
+		chord[k] = span.p1[k] - span.p0[k];
+		toPos[k] = pos[k] - span.p0[k];
+		chordLenSq += chord[k] * chord[k];
+		proj += chord[k] * toPos[k];
+	}
+
+	t = (chordLenSq > 0.0) ? clamp01(proj / chordLenSq) : 0.0;
+
+	// newton iterations on f(t) = (C(t) - P) . C'(t)
+	double c[3], d[3], dd[3];
+
+	for (int iter=0; iter<CURVE_PROXIMITY_NEWTON_ITERATIONS; ++iter)
+	{
+		HermiteEval(span.p0, span.m0, span.p1, span.m1, t, c, d, dd);
+
+		double f = 0.0;
+		double df = 0.0;
+		for (int k=0; k<3; ++k)
+		{
+			const double diff = c[k] - pos[k];
+			f += diff * d[k];
+			df += d[k] * d[k] + diff * dd[k];
+		}
+
+		if (df <= 0.0)
+			break;
+
+		const double newT = clamp01(t - f / df);
+		if (fabs(newT - t) < 1.0e-9)
+		{
+			t = newT;
+			break;
+		}
+		t = newT;
+	}
+
+	HermiteEval(span.p0, span.m0, span.p1, span.m1, t, c, d, dd);
+
+	distSq = 0.0;
+	for (int k=0; k<3; ++k)
+		distSq += (c[k] - pos[k]) * (c[k] - pos[k]);
+
+	// newton could stop in a local minimum, span ends are always candidates
+	double endDistSq = 0.0;
+	for (int k=0; k<3; ++k)
+		endDistSq += toPos[k] * toPos[k];
+	if (endDistSq < distSq)
+	{
+		distSq = endDistSq;
+		t = 0.0;
+	}
+
+	endDistSq = 0.0;
+	for (int k=0; k<3; ++k)
+		endDistSq += (pos[k] - span.p1[k]) * (pos[k] - span.p1[k]);
+	if (endDistSq < distSq)
+	{
+		distSq = endDistSq;
+		t = 1.0;
+	}
+}
+
+bool CurveProximityIndex::Query( const double *pos, CurveProximityResult &result ) const
+{
+	if (mNodes.size() == 0)
+		return false;
+
+	double bestDistSq = std::numeric_limits<double>::max();
+	int bestSpan = -1;
+	double bestT = 0.0;
+
+	// a level pushes two children and pops one, so depth + 1 entries are enough,
+	//  a tree deeper than the local stack uses the heap
+	int localStack[CURVE_PROXIMITY_STACK_SIZE];
+	std::vector<int> heapStack;
+	int *stack = localStack;
+
+	if (mMaxDepth + 2 > CURVE_PROXIMITY_STACK_SIZE)
+	{
+		heapStack.resize(mMaxDepth + 2);
+		stack = heapStack.data();
+	}
+
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node &node = mNodes[stack[--stackSize]];
+
+		if (BoxDistanceSq(node.bbMin, node.bbMax, pos) >= bestDistSq)
+			continue;
+
+		if (node.left < 0)
+		{
+			for (int i=node.firstSegment; i<node.firstSegment+node.segmentCount; ++i)
+			{
+				const Segment &seg = mSegments[mSegmentOrder[i]];
+				if (BoxDistanceSq(seg.bbMin, seg.bbMax, pos) >= bestDistSq)
+					continue;
+
+				for (int j=seg.firstSpan; j<seg.firstSpan+seg.spanCount; ++j)
+				{
+					double t, distSq;
+					SpanClosestPoint(mSpans[j], pos, t, distSq);
+
+					if (distSq < bestDistSq)
+					{
+						bestDistSq = distSq;
+						bestSpan = j;
+						bestT = t;
+					}
+				}
+			}
+		}
+		else
+		{
+			// push the far child first, so the near one is processed next
+			const Node &left = mNodes[node.left];
+			const Node &right = mNodes[node.right];
+
+			if (BoxDistanceSq(left.bbMin, left.bbMax, pos) < BoxDistanceSq(right.bbMin, right.bbMax, pos))
+			{
+				stack[stackSize++] = node.right;
+				stack[stackSize++] = node.left;
+			}
+			else
+			{
+				stack[stackSize++] = node.left;
+				stack[stackSize++] = node.right;
+			}
+		}
+	}
+
+	if (bestSpan < 0)
+		return false;
+
+	const Span &span = mSpans[bestSpan];
+	double c[3], d[3], dd[3];
+	HermiteEval(span.p0, span.m0, span.p1, span.m1, bestT, c, d, dd);
+
+	result.percent = span.percent0 + (span.percent1 - span.percent0) * bestT;
+	result.distance = sqrt(bestDistSq);
+	result.point = FBVector3d(c[0], c[1], c[2]);
+	result.tangent = FBVector3d(d[0], d[1], d[2]);
+	VectorNormalize(result.tangent);
+
+	return true;
+}
+
+void CurveProximityIndex::QueryBatch( const int count, const double *positions, const int stride, CurveProximityResult *results, const int numberOfThreads ) const
+{
+	ParallelFor( count, CURVE_PROXIMITY_BATCH_GRAIN, [this, positions, stride, results] (const int first, const int last) {
+
+		for (int i=first; i<last; ++i)
+		{
+			if (false == Query( positions + i * stride, results[i] ) )
+			{
+				results[i].percent = 0.0;
+				results[i].distance = std::numeric_limits<double>::max();
+				results[i].point = FBVector3d(0.0, 0.0, 0.0);
+				results[i].tangent = FBVector3d(0.0, 0.0, 0.0);
+			}
+		}
+	}, numberOfThreads );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+
+void CurveProximityBenchmark( FBModelPath3D *pCurve, const int numberOfQueries, const int numberOfSubdivisions, const int segmentSubdivisions )
+{
+	if (pCurve == nullptr || numberOfQueries < 1 || pCurve->PathKeyGetCount() < 2)
+		return;
+
+	// query points scattered around the curve bounding box
+	FBVector3d vmin, vmax;
+	pCurve->GetBoundingBox(vmin, vmax);
+
+	FBMatrix m;
+	pCurve->GetMatrix(m);
+
+	std::vector<FBVector3d>	points(numberOfQueries);
+	srand(0);
+	for (int i=0; i<numberOfQueries; ++i)
+	{
+		FBVector4d local;
+		for (int k=0; k<3; ++k)
+			local[k] = vmin[k] + (vmax[k] - vmin[k]) * ((double) rand() / RAND_MAX);
+		local[3] = 1.0;
+
+		FBVector4d global;
+		FBVectorMatrixMult(global, m, local);
+		points[i] = FBVector3d(global[0], global[1], global[2]);
+	}
+
+	typedef std::chrono::high_resolution_clock	clock;
+
+	// brute force
+	std::vector<double>	brutePercents(numberOfQueries);
+	std::vector<double> bruteDists(numberOfQueries);
+
+	auto startTime = clock::now();
+	for (int i=0; i<numberOfQueries; ++i)
+	{
+		FBVector4d pointOnCurve;
+		const FBVector3d &p = points[i];
+		FindClosestPointOnCurve( pointOnCurve, brutePercents[i], pCurve, FBVector4d(p[0], p[1], p[2], 1.0), numberOfSubdivisions, segmentSubdivisions );
+
+		FBVector3d diff;
+		VectorSub( FBVector3d(pointOnCurve), p, diff );
+		bruteDists[i] = VectorLength(diff);
+	}
+	const double bruteSecs = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	// index build + batch query
+	CurveProximityIndex	index;
+	std::vector<CurveProximityResult>	results(numberOfQueries);
+
+	startTime = clock::now();
+	index.Build( pCurve, numberOfSubdivisions, 1 );
+	const double buildSecs = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	startTime = clock::now();
+	index.QueryBatch( numberOfQueries, (double*) points.data(), 3, results.data() );
+	const double querySecs = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	double maxDistError = 0.0;
+	for (int i=0; i<numberOfQueries; ++i)
+	{
+		// positive error means index found a farther point than the brute force search
+		const double err = results[i].distance - bruteDists[i];
+		if (err > maxDistError)
+			maxDistError = err;
+	}
+
+	printf( "[CurveProximity] %d queries, brute force %.4f secs, index build %.4f secs, batch query %.4f secs, max distance error %f\n",
+		numberOfQueries, bruteSecs, buildSecs, querySecs, maxDistError );
+}
@@ -0,0 +1,927 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: GroundProjection.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "algorithm\GroundProjection.h"
+#include "algorithm\ParallelFor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <algorithm>
+#include <chrono>
+
+#define GROUND_PROJECTION_LEAF_TRIANGLES	4
+#define GROUND_PROJECTION_MAX_LEAF			16
+#define GROUND_PROJECTION_BINS				12
+#define GROUND_PROJECTION_STACK_SIZE		64
+#define GROUND_PROJECTION_BATCH_GRAIN		16
+// triangle hit test tolerance in barycentric coords, closes cracks between neighbour triangles
+#define GROUND_PROJECTION_EPSILON			1.0e-7
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// helpers
+
+static float BoxArea(const float *bmin, const float *bmax)
+{
+	const float dx = bmax[0] - bmin[0];
+	const float dy = bmax[1] - bmin[1];
+	const float dz = bmax[2] - bmin[2];
+	return dx*dy + dy*dz + dz*dx;
+}
+
+static void BoxReset(float *bmin, float *bmax)
+{
+	bmin[0] = bmin[1] = bmin[2] = FLT_MAX;
+	bmax[0] = bmax[1] = bmax[2] = -FLT_MAX;
+}
+
+static void BoxGrow(float *bmin, float *bmax, const float *otherMin, const float *otherMax)
+{
+	for (int k=0; k<3; ++k)
+	{
+		bmin[k] = std::min(bmin[k], otherMin[k]);
+		bmax[k] = std::max(bmax[k], otherMax[k]);
+	}
+}
+
+// entry distance of the ray into the box, FLT_MAX on a miss
+static double RayBoxEnter(const double *origin, const double *invDir, const double maxT, const float *bmin, const float *bmax)
+{
+	double tmin = 0.0;
+	double tmax = maxT;
+
+	for (int k=0; k<3; ++k)
+	{
+		double t0 = ((double) bmin[k] - origin[k]) * invDir[k];
+		double t1 = ((double) bmax[k] - origin[k]) * invDir[k];
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		if (t0 > tmin)
+			tmin = t0;
+		if (t1 < tmax)
+			tmax = t1;
+	}
+
+	return (tmin <= tmax) ? tmin : FLT_MAX;
+}
+
+// Moller - Trumbore, closest is updated when the hit is nearer
+static bool RayTriangle(const double *origin, const double *dir, const float *v0, const float *edge1, const float *edge2, double &closest)
+{
+	const double e1[3] = {edge1[0], edge1[1], edge1[2]};
+	const double e2[3] = {edge2[0], edge2[1], edge2[2]};
+
+	const double p[3] = {dir[1]*e2[2] - dir[2]*e2[1], dir[2]*e2[0] - dir[0]*e2[2], dir[0]*e2[1] - dir[1]*e2[0]};
+	const double det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+
+	if (0.0 == det)
+		return false;
+
+	const double invDet = 1.0 / det;
+	const double s[3] = {origin[0] - v0[0], origin[1] - v0[1], origin[2] - v0[2]};
+
+	const double u = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2]) * invDet;
+	if (u < -GROUND_PROJECTION_EPSILON || u > 1.0 + GROUND_PROJECTION_EPSILON)
+		return false;
+
+	const double q[3] = {s[1]*e1[2] - s[2]*e1[1], s[2]*e1[0] - s[0]*e1[2], s[0]*e1[1] - s[1]*e1[0]};
+	const double v = (dir[0]*q[0] + dir[1]*q[1] + dir[2]*q[2]) * invDet;
+	if (v < -GROUND_PROJECTION_EPSILON || u + v > 1.0 + GROUND_PROJECTION_EPSILON)
+		return false;
+
+	const double t = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2]) * invDet;
+	if (t < 0.0 || t > closest)
+		return false;
+
+	closest = t;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// GroundProjectionBVH
+
+GroundProjectionBVH::GroundProjectionBVH()
+{}
+
+void GroundProjectionBVH::Clear()
+{
+	mTriangles.clear();
+	mNodes.clear();
+}
+
+void GroundProjectionBVH::AddMesh(const float *positions, const int numberOfVertices, const int stride,
+	const int *indices, const int numberOfTriangles, const double *matrix)
+{
+	std::vector<float>	world(numberOfVertices * 3);
+
+	for (int i=0; i<numberOfVertices; ++i)
+	{
+		const float *p = positions + i * stride;
+		float *w = world.data() + i * 3;
+
+		if (nullptr == matrix)
+		{
+			w[0] = p[0];
+			w[1] = p[1];
+			w[2] = p[2];
+		}
+		else
+		{
+			for (int k=0; k<3; ++k)
+				w[k] = (float) (matrix[k] * p[0] + matrix[4+k] * p[1] + matrix[8+k] * p[2] + matrix[12+k]);
+		}
+	}
+
+	mTriangles.reserve(mTriangles.size() + numberOfTriangles);
+
+	for (int i=0; i<numberOfTriangles; ++i)
+	{
+		const int i0 = indices[i*3];
+		const int i1 = indices[i*3+1];
+		const int i2 = indices[i*3+2];
+
+		if (i0 < 0 || i1 < 0 || i2 < 0 || i0 >= numberOfVertices || i1 >= numberOfVertices || i2 >= numberOfVertices)
+			continue;
+
+		const float *v0 = world.data() + i0 * 3;
+		const float *v1 = world.data() + i1 * 3;
+		const float *v2 = world.data() + i2 * 3;
+
+		Triangle tri;
+		for (int k=0; k<3; ++k)
+		{
+			tri.v0[k] = v0[k];
+			tri.e1[k] = v1[k] - v0[k];
+			tri.e2[k] = v2[k] - v0[k];
+		}
+		mTriangles.push_back(tri);
+	}
+
+	// tree has to be built again
+	mNodes.clear();
+}
+
+void GroundProjectionBVH::Build()
+{
+	mNodes.clear();
+
+	const int count = (int) mTriangles.size();
+	if (0 == count)
+		return;
+
+	std::vector<float>	centroids(count * 3);
+	std::vector<float>	bounds(count * 6);
+	std::vector<int>	order(count);
+
+	for (int i=0; i<count; ++i)
+	{
+		const Triangle &tri = mTriangles[i];
+		float *bmin = bounds.data() + i * 6;
+		float *bmax = bmin + 3;
+
+		for (int k=0; k<3; ++k)
+		{
+			const float v1 = tri.v0[k] + tri.e1[k];
+			const float v2 = tri.v0[k] + tri.e2[k];
+
+			bmin[k] = std::min(tri.v0[k], std::min(v1, v2) );
+			bmax[k] = std::max(tri.v0[k], std::max(v1, v2) );
+			centroids[i*3+k] = 0.5f * (bmin[k] + bmax[k]);
+		}
+		order[i] = i;
+	}
+
+	mNodes.reserve(count * 2 / GROUND_PROJECTION_LEAF_TRIANGLES + 1);
+	BuildNode(0, count, order, centroids, bounds);
+
+	// leaves reference a contiguous range of triangles
+	std::vector<Triangle>	sorted(count);
+	for (int i=0; i<count; ++i)
+		sorted[i] = mTriangles[order[i]];
+	mTriangles.swap(sorted);
+}
+
+int GroundProjectionBVH::BuildNode(const int first, const int count, std::vector<int> &order, const std::vector<float> &centroids, const std::vector<float> &bounds)
+{
+	const int index = (int) mNodes.size();
+	mNodes.push_back(Node() );
+
+	Node node;
+	node.first = first;
+	node.count = count;
+	BoxReset(node.bbMin, node.bbMax);
+
+	float cmin[3], cmax[3];
+	BoxReset(cmin, cmax);
+
+	for (int i=first; i<first+count; ++i)
+	{
+		const float *b = bounds.data() + order[i] * 6;
+		const float *c = centroids.data() + order[i] * 3;
+
+		BoxGrow(node.bbMin, node.bbMax, b, b+3);
+		BoxGrow(cmin, cmax, c, c);
+	}
+
+	mNodes[index] = node;
+
+	if (count <= GROUND_PROJECTION_LEAF_TRIANGLES)
+		return index;
+
+	// split axis is the longest centroid extent
+
+	int axis = 0;
+	for (int k=1; k<3; ++k)
+		if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis])
+			axis = k;
+
+	const float extent = cmax[axis] - cmin[axis];
+	int mid = first;
+
+	if (extent > 0.0f)
+	{
+		// binned SAH
+
+		int		binCount[GROUND_PROJECTION_BINS] = {0};
+		float	binMin[GROUND_PROJECTION_BINS][3];
+		float	binMax[GROUND_PROJECTION_BINS][3];
+
+		for (int b=0; b<GROUND_PROJECTION_BINS; ++b)
+			BoxReset(binMin[b], binMax[b]);
+
+		const float scale = GROUND_PROJECTION_BINS / extent;
+		auto fnBin = [&] (const int tri) -> int {
+			const int b = (int) ((centroids[tri*3+axis] - cmin[axis]) * scale);
+			return std::min(GROUND_PROJECTION_BINS-1, b);
+		};
+
+		for (int i=first; i<first+count; ++i)
+		{
+			const int b = fnBin(order[i]);
+			const float *bb = bounds.data() + order[i] * 6;
+
+			binCount[b] += 1;
+			BoxGrow(binMin[b], binMax[b], bb, bb+3);
+		}
+
+		// sweep from the right, then from the left
+
+		float	rightArea[GROUND_PROJECTION_BINS];
+		int		rightCount[GROUND_PROJECTION_BINS];
+
+		float	accMin[3], accMax[3];
+		int		accCount = 0;
+		BoxReset(accMin, accMax);
+
+		for (int b=GROUND_PROJECTION_BINS-1; b>0; --b)
+		{
+			BoxGrow(accMin, accMax, binMin[b], binMax[b]);
+			accCount += binCount[b];
+			rightCount[b] = accCount;
+			rightArea[b] = (accCount > 0) ? BoxArea(accMin, accMax) : 0.0f;
+		}
+
+		BoxReset(accMin, accMax);
+		accCount = 0;
+
+		float bestCost = FLT_MAX;
+		int bestSplit = -1;
+
+		for (int b=1; b<GROUND_PROJECTION_BINS; ++b)
+		{
+			BoxGrow(accMin, accMax, binMin[b-1], binMax[b-1]);
+			accCount += binCount[b-1];
+
+			if (0 == accCount || 0 == rightCount[b])
+				continue;
+
+			const float cost = accCount * BoxArea(accMin, accMax) + rightCount[b] * rightArea[b];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		const float leafCost = count * BoxArea(node.bbMin, node.bbMax);
+
+		if (bestSplit > 0 && (bestCost < leafCost || count > GROUND_PROJECTION_MAX_LEAF) )
+		{
+			mid = (int) (std::partition(order.begin() + first, order.begin() + first + count,
+				[&] (const int tri) { return fnBin(tri) < bestSplit; }) - order.begin() );
+		}
+		else if (count <= GROUND_PROJECTION_MAX_LEAF)
+		{
+			return index;
+		}
+	}
+	else if (count <= GROUND_PROJECTION_MAX_LEAF)
+	{
+		return index;
+	}
+
+	// all centroids in one place, split by the order
+	if (mid <= first || mid >= first + count)
+		mid = first + count / 2;
+
+	BuildNode(first, mid - first, order, centroids, bounds);
+	const int right = BuildNode(mid, first + count - mid, order, centroids, bounds);
+
+	mNodes[index].first = right;
+	mNodes[index].count = 0;
+
+	return index;
+}
+
+void GroundProjectionBVH::GetBounds(double *bmin, double *bmax) const
+{
+	for (int k=0; k<3; ++k)
+	{
+		bmin[k] = (mNodes.size() > 0) ? mNodes[0].bbMin[k] : 0.0;
+		bmax[k] = (mNodes.size() > 0) ? mNodes[0].bbMax[k] : 0.0;
+	}
+}
+
+bool GroundProjectionBVH::RayCast(const double *origin, const double *dir, const double maxT, GroundRayHit &hit) const
+{
+	if (mNodes.size() == 0)
+		return false;
+
+	double invDir[3];
+	for (int k=0; k<3; ++k)
+		invDir[k] = (0.0 != dir[k]) ? 1.0 / dir[k] : DBL_MAX;	// no inf * 0 nan for a parallel ray
+
+	double closest = maxT;
+	int closestTri = -1;
+
+	int stack[GROUND_PROJECTION_STACK_SIZE];
+	int stackSize = 0;
+
+	int nodeIndex = 0;
+	if (RayBoxEnter(origin, invDir, closest, mNodes[0].bbMin, mNodes[0].bbMax) == FLT_MAX)
+		return false;
+
+	for (;;)
+	{
+		const Node &node = mNodes[nodeIndex];
+
+		if (node.count > 0)
+		{
+			for (int i=node.first; i<node.first+node.count; ++i)
+			{
+				const Triangle &tri = mTriangles[i];
+				if (RayTriangle(origin, dir, tri.v0, tri.e1, tri.e2, closest) )
+					closestTri = i;
+			}
+		}
+		else
+		{
+			// nearest child first, the other one goes to the stack
+
+			int left = nodeIndex + 1;
+			int right = node.first;
+
+			double tLeft = RayBoxEnter(origin, invDir, closest, mNodes[left].bbMin, mNodes[left].bbMax);
+			double tRight = RayBoxEnter(origin, invDir, closest, mNodes[right].bbMin, mNodes[right].bbMax);
+
+			if (tRight < tLeft)
+			{
+				std::swap(left, right);
+				std::swap(tLeft, tRight);
+			}
+
+			if (tLeft != FLT_MAX)
+			{
+				if (tRight != FLT_MAX && stackSize < GROUND_PROJECTION_STACK_SIZE)
+					stack[stackSize++] = right;
+
+				nodeIndex = left;
+				continue;
+			}
+		}
+
+		// pop a node which is still closer than the hit
+		bool found = false;
+		while (stackSize > 0)
+		{
+			nodeIndex = stack[--stackSize];
+			if (RayBoxEnter(origin, invDir, closest, mNodes[nodeIndex].bbMin, mNodes[nodeIndex].bbMax) != FLT_MAX)
+			{
+				found = true;
+				break;
+			}
+		}
+
+		if (false == found)
+			break;
+	}
+
+	if (closestTri < 0)
+		return false;
+
+	const Triangle &tri = mTriangles[closestTri];
+
+	double n[3] = {
+		(double) tri.e1[1]*tri.e2[2] - (double) tri.e1[2]*tri.e2[1],
+		(double) tri.e1[2]*tri.e2[0] - (double) tri.e1[0]*tri.e2[2],
+		(double) tri.e1[0]*tri.e2[1] - (double) tri.e1[1]*tri.e2[0] };
+
+	const double len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+	const double sign = (n[0]*dir[0] + n[1]*dir[1] + n[2]*dir[2] > 0.0) ? -1.0 : 1.0;
+
+	hit.t = closest;
+	hit.triangle = closestTri;
+
+	for (int k=0; k<3; ++k)
+	{
+		hit.pos[k] = origin[k] + dir[k] * closest;
+		hit.normal[k] = (len > 0.0) ? sign * n[k] / len : 0.0;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// batch projection
+
+static void GroundProjectObject(const GroundProjectionBVH &bvh, const double *box, const GroundProjectionOptions &options,
+	GroundProjectionResult &result, std::vector<double> &hits)
+{
+	const double *bmin = box;
+	const double *bmax = box + 3;
+
+	const double centerX = 0.5 * (bmin[0] + bmax[0]);
+	const double centerZ = 0.5 * (bmin[2] + bmax[2]);
+
+	const int countX = std::max(1, options.footprintX);
+	const int countZ = std::max(1, options.footprintZ);
+
+	const double dir[3] = {0.0, -1.0, 0.0};
+	const double maxT = (bmax[1] - bmin[1]) + options.maxDistance;
+
+	result.hit = false;
+	result.numberOfHits = 0;
+	result.offset = 0.0;
+	result.contact[0] = centerX;
+	result.contact[1] = bmin[1];
+	result.contact[2] = centerZ;
+	result.normal[0] = 0.0;
+	result.normal[1] = 1.0;
+	result.normal[2] = 0.0;
+
+	// footprint rays go through the box corners, one ray goes through the center
+
+	hits.clear();
+
+	for (int j=0; j<countZ; ++j)
+	{
+		const double fz = (countZ > 1) ? (double) j / (countZ - 1) : 0.5;
+
+		for (int i=0; i<countX; ++i)
+		{
+			const double fx = (countX > 1) ? (double) i / (countX - 1) : 0.5;
+
+			const double origin[3] = {
+				bmin[0] + (bmax[0] - bmin[0]) * fx,
+				bmax[1],
+				bmin[2] + (bmax[2] - bmin[2]) * fz };
+
+			GroundRayHit hit;
+			if (bvh.RayCast(origin, dir, maxT, hit) )
+			{
+				hits.push_back(hit.pos[0]);
+				hits.push_back(hit.pos[1]);
+				hits.push_back(hit.pos[2]);
+			}
+		}
+	}
+
+	const int numberOfHits = (int) hits.size() / 3;
+	if (0 == numberOfHits)
+		return;
+
+	double highest = -DBL_MAX;
+	for (int i=0; i<numberOfHits; ++i)
+		highest = std::max(highest, hits[i*3+1]);
+
+	double contactY = highest;
+
+	if (options.fitPlane && numberOfHits >= 3)
+	{
+		// least squares y = a*x + b*z + c around the hits centroid
+
+		double mx=0.0, my=0.0, mz=0.0;
+		for (int i=0; i<numberOfHits; ++i)
+		{
+			mx += hits[i*3];
+			my += hits[i*3+1];
+			mz += hits[i*3+2];
+		}
+		mx /= numberOfHits;
+		my /= numberOfHits;
+		mz /= numberOfHits;
+
+		double sxx=0.0, sxz=0.0, szz=0.0, sxy=0.0, szy=0.0;
+		for (int i=0; i<numberOfHits; ++i)
+		{
+			const double dx = hits[i*3] - mx;
+			const double dy = hits[i*3+1] - my;
+			const double dz = hits[i*3+2] - mz;
+
+			sxx += dx*dx;
+			sxz += dx*dz;
+			szz += dz*dz;
+			sxy += dx*dy;
+			szy += dz*dy;
+		}
+
+		const double det = sxx * szz - sxz * sxz;
+		const double scale = std::max(1.0, sxx + szz);
+
+		// hits on a line don't define a plane
+		if (fabs(det) > 1.0e-9 * scale * scale)
+		{
+			const double a = (sxy * szz - szy * sxz) / det;
+			const double b = (szy * sxx - sxy * sxz) / det;
+
+			// plane goes up to the highest hit above it, so the aligned object doesn't sink into a bump
+			double lift = 0.0;
+			for (int i=0; i<numberOfHits; ++i)
+			{
+				const double planeY = my + a * (hits[i*3] - mx) + b * (hits[i*3+2] - mz);
+				lift = std::max(lift, hits[i*3+1] - planeY);
+			}
+
+			contactY = my + a * (centerX - mx) + b * (centerZ - mz) + lift;
+
+			const double len = sqrt(a*a + 1.0 + b*b);
+			result.normal[0] = -a / len;
+			result.normal[1] = 1.0 / len;
+			result.normal[2] = -b / len;
+		}
+	}
+
+	result.hit = true;
+	result.numberOfHits = numberOfHits;
+	result.contact[1] = contactY;
+	result.offset = contactY - bmin[1];
+}
+
+void GroundProjectBatch(const GroundProjectionBVH &bvh, const int numberOfObjects, const double *boxes,
+	const GroundProjectionOptions &options, GroundProjectionResult *results)
+{
+	ParallelFor(numberOfObjects, GROUND_PROJECTION_BATCH_GRAIN, [&] (const int first, const int last) {
+
+		std::vector<double>	hits;
+		hits.reserve(std::max(1, options.footprintX) * std::max(1, options.footprintZ) * 3);
+
+		for (int i=first; i<last; ++i)
+			GroundProjectObject(bvh, boxes + i * 6, options, results[i], hits);
+
+	}, options.numberOfThreads);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// synthetic terrain
+
+static double TerrainHeight(const double x, const double z)
+{
+	return 20.0 * sin(x * 0.01) + 10.0 * cos(z * 0.013) + 0.02 * x;
+}
+
+// grid of (resolution+1)^2 vertices over [-size; size], rows along z
+static void MakeTerrain(const int resolution, const double size, double (*fnHeight)(double, double),
+	std::vector<float> &positions, std::vector<int> &indices)
+{
+	const int row = resolution + 1;
+
+	positions.resize(row * row * 3);
+	for (int j=0; j<row; ++j)
+		for (int i=0; i<row; ++i)
+		{
+			const double x = -size + 2.0 * size * i / resolution;
+			const double z = -size + 2.0 * size * j / resolution;
+
+			float *p = positions.data() + (j * row + i) * 3;
+			p[0] = (float) x;
+			p[1] = (float) fnHeight(x, z);
+			p[2] = (float) z;
+		}
+
+	indices.resize(resolution * resolution * 6);
+	int *idx = indices.data();
+
+	for (int j=0; j<resolution; ++j)
+		for (int i=0; i<resolution; ++i)
+		{
+			const int v = j * row + i;
+
+			*idx++ = v;
+			*idx++ = v + row;
+			*idx++ = v + 1;
+
+			*idx++ = v + 1;
+			*idx++ = v + row;
+			*idx++ = v + row + 1;
+		}
+}
+
+static double RandomRange(const double a, const double b)
+{
+	return a + (b - a) * ((double) rand() / RAND_MAX);
+}
+
+static void MakeBoxes(const int numberOfObjects, const double size, std::vector<double> &boxes)
+{
+	boxes.resize(numberOfObjects * 6);
+
+	for (int i=0; i<numberOfObjects; ++i)
+	{
+		double *box = boxes.data() + i * 6;
+
+		const double w = RandomRange(2.0, 30.0);
+		const double h = RandomRange(2.0, 30.0);
+		const double d = RandomRange(2.0, 30.0);
+		const double x = RandomRange(-size * 0.9, size * 0.9);
+		const double z = RandomRange(-size * 0.9, size * 0.9);
+		const double y = TerrainHeight(x, z) + RandomRange(-5.0, 200.0);
+
+		box[0] = x - 0.5 * w;
+		box[1] = y;
+		box[2] = z - 0.5 * d;
+		box[3] = x + 0.5 * w;
+		box[4] = y + h;
+		box[5] = z + 0.5 * d;
+	}
+}
+
+// every triangle is tested, ray cast without acceleration
+static bool RayCastBruteForce(const std::vector<float> &positions, const std::vector<int> &indices, const double *origin, const double *dir, const double maxT, double &t)
+{
+	bool result = false;
+	t = maxT;
+
+	for (size_t i=0; i<indices.size(); i+=3)
+	{
+		const float *v0 = positions.data() + indices[i] * 3;
+		const float *v1 = positions.data() + indices[i+1] * 3;
+		const float *v2 = positions.data() + indices[i+2] * 3;
+
+		const float e1[3] = {v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]};
+		const float e2[3] = {v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]};
+
+		if (RayTriangle(origin, dir, v0, e1, e2, t) )
+			result = true;
+	}
+	return result;
+}
+
+bool GroundProjectionSelfTest()
+{
+	const int resolution = 256;
+	const double size = 1000.0;
+	const int numberOfObjects = 2000;
+
+	// grid cell is ~8 units, linear interpolation of the height function is within a few hundredths
+	const double tolerance = 0.1;
+
+	std::vector<float>	positions;
+	std::vector<int>	indices;
+	MakeTerrain(resolution, size, TerrainHeight, positions, indices);
+
+	// terrain is moved by a matrix, vertices are shifted back, so the world height is the same function
+	const double shift[3] = {50.0, -30.0, 25.0};
+	for (size_t i=0; i<positions.size(); i+=3)
+		for (int k=0; k<3; ++k)
+			positions[i+k] -= (float) shift[k];
+
+	const double matrix[16] = {1.0, 0.0, 0.0, 0.0,  0.0, 1.0, 0.0, 0.0,  0.0, 0.0, 1.0, 0.0,  shift[0], shift[1], shift[2], 1.0};
+
+	GroundProjectionBVH bvh;
+	bvh.AddMesh(positions.data(), (int) positions.size() / 3, 3, indices.data(), (int) indices.size() / 3, matrix);
+	bvh.Build();
+
+	bool result = true;
+
+	// 1 - tree traversal against a brute force test of every triangle, a part of the terrain
+
+	{
+		std::vector<float>	smallPositions;
+		std::vector<int>	smallIndices;
+		MakeTerrain(24, 100.0, TerrainHeight, smallPositions, smallIndices);
+
+		GroundProjectionBVH smallBVH;
+		smallBVH.AddMesh(smallPositions.data(), (int) smallPositions.size() / 3, 3, smallIndices.data(), (int) smallIndices.size() / 3, nullptr);
+		smallBVH.Build();
+
+		srand(1);
+		int numberOfMismatches = 0;
+
+		for (int i=0; i<500; ++i)
+		{
+			const double origin[3] = {RandomRange(-120.0, 120.0), RandomRange(-40.0, 80.0), RandomRange(-120.0, 120.0)};
+			const double dir[3] = {RandomRange(-1.0, 1.0), RandomRange(-1.0, 1.0), RandomRange(-1.0, 1.0)};
+
+			double bruteT = 0.0;
+			const bool bruteHit = RayCastBruteForce(smallPositions, smallIndices, origin, dir, 1000.0, bruteT);
+
+			GroundRayHit hit;
+			const bool treeHit = smallBVH.RayCast(origin, dir, 1000.0, hit);
+
+			if (bruteHit != treeHit || (treeHit && fabs(hit.t - bruteT) > 1.0e-9 * std::max(1.0, bruteT) ) )
+				numberOfMismatches += 1;
+		}
+
+		if (numberOfMismatches > 0)
+		{
+			printf( "[GroundProjection] %d of 500 rays differ from a brute force test\n", numberOfMismatches );
+			result = false;
+		}
+	}
+
+	// 2 - one ray per object, contact is the terrain height under the box center
+
+	std::vector<double> boxes;
+	srand(2);
+	MakeBoxes(numberOfObjects, size, boxes);
+
+	std::vector<GroundProjectionResult>	results(numberOfObjects);
+
+	GroundProjectionOptions options;
+	options.footprintX = 1;
+	options.footprintZ = 1;
+	GroundProjectBatch(bvh, numberOfObjects, boxes.data(), options, results.data() );
+
+	double maxError = 0.0;
+	int numberOfMissed = 0;
+
+	for (int i=0; i<numberOfObjects; ++i)
+	{
+		const double *box = boxes.data() + i * 6;
+		const double x = 0.5 * (box[0] + box[3]);
+		const double z = 0.5 * (box[2] + box[5]);
+
+		// box is below the ground, rays start from its top
+		if (box[4] < TerrainHeight(x, z) )
+			continue;
+
+		if (false == results[i].hit)
+		{
+			numberOfMissed += 1;
+			continue;
+		}
+
+		maxError = std::max(maxError, fabs(box[1] + results[i].offset - TerrainHeight(x, z) ) );
+	}
+
+	if (numberOfMissed > 0 || maxError > tolerance)
+	{
+		printf( "[GroundProjection] center ray, %d objects missed the ground, max height error %f\n", numberOfMissed, maxError );
+		result = false;
+	}
+
+	// 3 - footprint, object rests on the highest sample
+
+	options.footprintX = 3;
+	options.footprintZ = 3;
+	GroundProjectBatch(bvh, numberOfObjects, boxes.data(), options, results.data() );
+
+	maxError = 0.0;
+	for (int i=0; i<numberOfObjects; ++i)
+	{
+		const double *box = boxes.data() + i * 6;
+
+		double highest = -DBL_MAX;
+		for (int j=0; j<3; ++j)
+			for (int k=0; k<3; ++k)
+				highest = std::max(highest, TerrainHeight(box[0] + 0.5 * k * (box[3] - box[0]), box[2] + 0.5 * j * (box[5] - box[2]) ) );
+
+		if (box[4] < highest + 60.0 || false == results[i].hit)
+			continue;
+
+		maxError = std::max(maxError, fabs(box[1] + results[i].offset - highest) );
+	}
+
+	if (maxError > tolerance)
+	{
+		printf( "[GroundProjection] footprint, max height error %f\n", maxError );
+		result = false;
+	}
+
+	// 4 - contact plane on a sloped flat ground has the ground normal
+
+	{
+		auto fnSlope = [] (double x, double z) -> double { return 0.3 * x - 0.2 * z + 5.0; };
+
+		std::vector<float>	slopePositions;
+		std::vector<int>	slopeIndices;
+		MakeTerrain(16, size, fnSlope, slopePositions, slopeIndices);
+
+		GroundProjectionBVH slopeBVH;
+		slopeBVH.AddMesh(slopePositions.data(), (int) slopePositions.size() / 3, 3, slopeIndices.data(), (int) slopeIndices.size() / 3, nullptr);
+		slopeBVH.Build();
+
+		const double box[6] = {10.0, 500.0, 20.0, 40.0, 520.0, 60.0};
+
+		GroundProjectionResult slopeResult;
+		options.fitPlane = true;
+		GroundProjectBatch(slopeBVH, 1, box, options, &slopeResult);
+
+		const double len = sqrt(0.3*0.3 + 1.0 + 0.2*0.2);
+		const double expected[3] = {-0.3 / len, 1.0 / len, 0.2 / len};
+		const double expectedY = fnSlope(25.0, 40.0);
+
+		double normalError = 0.0;
+		for (int k=0; k<3; ++k)
+			normalError = std::max(normalError, fabs(slopeResult.normal[k] - expected[k]) );
+
+		const double heightError = fabs(box[1] + slopeResult.offset - expectedY);
+
+		if (false == slopeResult.hit || normalError > 1.0e-4 || heightError > 1.0e-3)
+		{
+			printf( "[GroundProjection] contact plane, normal error %f, height error %f\n", normalError, heightError );
+			result = false;
+		}
+	}
+
+	printf( "[GroundProjection] self test %s, %d triangles, %d nodes\n", (result) ? "passed" : "FAILED",
+		bvh.GetNumberOfTriangles(), bvh.GetNumberOfNodes() );
+
+	return result;
+}
+
+void GroundProjectionBenchmark(const int terrainResolution, const int numberOfObjects, const int numberOfThreads)
+{
+	const double size = 1000.0;
+
+	std::vector<float>	positions;
+	std::vector<int>	indices;
+	MakeTerrain(terrainResolution, size, TerrainHeight, positions, indices);
+
+	std::vector<double> boxes;
+	srand(3);
+	MakeBoxes(numberOfObjects, size, boxes);
+
+	typedef std::chrono::high_resolution_clock	clock;
+
+	auto startTime = clock::now();
+
+	GroundProjectionBVH bvh;
+	bvh.AddMesh(positions.data(), (int) positions.size() / 3, 3, indices.data(), (int) indices.size() / 3, nullptr);
+	bvh.Build();
+
+	const double buildSecs = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	std::vector<GroundProjectionResult>	results(numberOfObjects);
+	GroundProjectionOptions options;
+
+	const int numberOfRays = numberOfObjects * options.footprintX * options.footprintZ;
+
+	// single thread, then all threads
+
+	options.numberOfThreads = 1;
+	startTime = clock::now();
+	GroundProjectBatch(bvh, numberOfObjects, boxes.data(), options, results.data() );
+	const double singleSecs = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	options.numberOfThreads = numberOfThreads;
+	startTime = clock::now();
+	GroundProjectBatch(bvh, numberOfObjects, boxes.data(), options, results.data() );
+	const double batchSecs = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	// per object loop over every triangle, as a ray cast without acceleration does, on a small part of objects
+
+	const int numberOfBrute = std::min(numberOfObjects, 20);
+	int numberOfBruteHits = 0;
+	startTime = clock::now();
+
+	for (int i=0; i<numberOfBrute; ++i)
+	{
+		const double *box = boxes.data() + i * 6;
+		const double origin[3] = {0.5 * (box[0] + box[3]), box[4], 0.5 * (box[2] + box[5])};
+		const double dir[3] = {0.0, -1.0, 0.0};
+
+		double t;
+		if (RayCastBruteForce(positions, indices, origin, dir, options.maxDistance, t) )
+			numberOfBruteHits += 1;
+	}
+	const double bruteSecs = std::chrono::duration<double>(clock::now() - startTime).count() / std::max(1, numberOfBrute);
+
+	printf( "[GroundProjection] %d triangles, %d nodes, build %.4f secs\n", bvh.GetNumberOfTriangles(), bvh.GetNumberOfNodes(), buildSecs );
+	printf( "[GroundProjection] %d objects, %d rays, 1 thread %.4f secs (%.0f rays/sec), %d threads %.4f secs (%.0f rays/sec)\n",
+		numberOfObjects, numberOfRays, singleSecs, numberOfRays / std::max(1.0e-9, singleSecs),
+		ParallelForThreadCount(numberOfThreads), batchSecs, numberOfRays / std::max(1.0e-9, batchSecs) );
+	printf( "[GroundProjection] brute force ray %.6f secs, %.0f rays/sec, %d of %d hits\n", bruteSecs, 1.0 / std::max(1.0e-9, bruteSecs),
+		numberOfBruteHits, numberOfBrute );
+}
@@ -0,0 +1,477 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: RBFSolver.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "algorithm\RBFSolver.h"
+#include "algorithm\ParallelFor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <algorithm>
+#include <chrono>
+
+#define RBF_SOLVER_BATCH_GRAIN			64
+#define RBF_SOLVER_JITTER_ATTEMPTS		6
+// squared distance between inputs of one pose
+#define RBF_SOLVER_SAME_POSE			1.0e-12
+
+static double DistanceSq(const double *a, const double *b, const int dim)
+{
+	double d = 0.0;
+	for (int i=0; i<dim; ++i)
+	{
+		const double v = a[i] - b[i];
+		d += v * v;
+	}
+	return d;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Cholesky
+
+bool RBFCholeskyFactorize(double *a, const int n)
+{
+	for (int j=0; j<n; ++j)
+	{
+		double *rowj = a + j*n;
+
+		double d = rowj[j];
+		for (int k=0; k<j; ++k)
+			d -= rowj[k] * rowj[k];
+
+		if (d <= 0.0 || d != d)
+			return false;
+
+		d = sqrt(d);
+		rowj[j] = d;
+
+		for (int i=j+1; i<n; ++i)
+		{
+			double *rowi = a + i*n;
+
+			double s = rowi[j];
+			for (int k=0; k<j; ++k)
+				s -= rowi[k] * rowj[k];
+
+			rowi[j] = s / d;
+		}
+	}
+	return true;
+}
+
+void RBFCholeskySolve(const double *a, const int n, double *b)
+{
+	// L * y = b
+	for (int i=0; i<n; ++i)
+	{
+		const double *rowi = a + i*n;
+
+		double s = b[i];
+		for (int k=0; k<i; ++k)
+			s -= rowi[k] * b[k];
+		b[i] = s / rowi[i];
+	}
+
+	// Lt * x = y
+	for (int i=n-1; i>=0; --i)
+	{
+		double s = b[i];
+		for (int k=i+1; k<n; ++k)
+			s -= a[k*n + i] * b[k];
+		b[i] = s / a[i*n + i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// RBFSolver
+
+RBFSolver::RBFSolver()
+	: mInputDim(0)
+	, mOutputDim(0)
+	, mNumberOfPoses(0)
+	, mTrained(false)
+	, mKernel(eRBFKernelGaussian)
+	, mRadius(1.0)
+	, mInvRadiusSq(1.0)
+{}
+
+void RBFSolver::Clear()
+{
+	mNumberOfPoses = 0;
+	mInputs.clear();
+	mOutputs.clear();
+	mWeights.clear();
+	mTrained = false;
+}
+
+void RBFSolver::SetDimensions(const int inputDim, const int outputDim)
+{
+	if (inputDim != mInputDim || outputDim != mOutputDim)
+	{
+		Clear();
+		mInputDim = inputDim;
+		mOutputDim = outputDim;
+	}
+}
+
+int RBFSolver::AddPose(const double *input, const double *output)
+{
+	if (mInputDim <= 0 || mOutputDim <= 0)
+		return -1;
+
+	mTrained = false;
+
+	for (int i=0; i<mNumberOfPoses; ++i)
+	{
+		if (DistanceSq(input, GetPoseInput(i), mInputDim) < RBF_SOLVER_SAME_POSE)
+		{
+			std::copy(output, output + mOutputDim, mOutputs.begin() + i * mOutputDim);
+			return i;
+		}
+	}
+
+	if (mNumberOfPoses >= RBF_SOLVER_MAX_POSES)
+	{
+		printf( "[RBFSolver] too many poses, max is %d\n", RBF_SOLVER_MAX_POSES );
+		return -1;
+	}
+
+	mInputs.insert(mInputs.end(), input, input + mInputDim);
+	mOutputs.insert(mOutputs.end(), output, output + mOutputDim);
+	mNumberOfPoses += 1;
+
+	return mNumberOfPoses - 1;
+}
+
+double RBFSolver::Kernel(const double distSq) const
+{
+	const double r2 = distSq * mInvRadiusSq;
+
+	if (eRBFKernelInverseMultiquadric == mKernel)
+		return 1.0 / sqrt(1.0 + r2);
+
+	return exp(-r2);
+}
+
+bool RBFSolver::Train(const RBFSolverOptions &options)
+{
+	mTrained = false;
+	mWeights.clear();
+
+	const int n = mNumberOfPoses;
+	if (n == 0)
+		return false;
+
+	mKernel = options.kernel;
+
+	// radius from a mean distance to the nearest pose, inputs are in scene units
+
+	double meanDist = 0.0;
+
+	if (n > 1)
+	{
+		for (int i=0; i<n; ++i)
+		{
+			double nearestSq = DBL_MAX;
+			for (int j=0; j<n; ++j)
+			{
+				if (i != j)
+					nearestSq = std::min(nearestSq, DistanceSq(GetPoseInput(i), GetPoseInput(j), mInputDim) );
+			}
+			meanDist += sqrt(nearestSq);
+		}
+		meanDist /= n;
+	}
+
+	mRadius = options.radiusScale * meanDist;
+	if (mRadius <= 0.0)
+		mRadius = 1.0;
+	mInvRadiusSq = 1.0 / (mRadius * mRadius);
+
+	// kernel matrix, duplicated poses are removed in AddPose, jitter is only for nearly equal ones
+
+	std::vector<double>	kernels(n * n);
+	std::vector<double>	factorized;
+
+	bool factorizeOk = false;
+	double jitter = 0.0;
+
+	for (int attempt=0; attempt<RBF_SOLVER_JITTER_ATTEMPTS && !factorizeOk; ++attempt)
+	{
+		for (int i=0; i<n; ++i)
+		{
+			for (int j=0; j<=i; ++j)
+			{
+				const double k = Kernel( DistanceSq(GetPoseInput(i), GetPoseInput(j), mInputDim) );
+				kernels[i*n + j] = k;
+				kernels[j*n + i] = k;
+			}
+			kernels[i*n + i] += options.regularization + jitter;
+		}
+
+		factorized = kernels;
+		factorizeOk = RBFCholeskyFactorize(factorized.data(), n);
+
+		jitter = (jitter == 0.0) ? 1.0e-10 : jitter * 100.0;
+	}
+
+	if (false == factorizeOk)
+	{
+		printf( "[RBFSolver] failed to factorize a kernel matrix of %d poses\n", n );
+		return false;
+	}
+
+	// weights of every output relative to the rest pose
+
+	mWeights.resize(mOutputDim * n);
+	std::vector<double>	column(n);
+
+	const double *rest = GetPoseOutput(0);
+
+	for (int m=0; m<mOutputDim; ++m)
+	{
+		for (int p=0; p<n; ++p)
+			column[p] = GetPoseOutput(p)[m] - rest[m];
+
+		RBFCholeskySolve(factorized.data(), n, column.data() );
+		std::copy(column.begin(), column.end(), mWeights.begin() + m * n);
+	}
+
+	mTrained = true;
+	return true;
+}
+
+void RBFSolver::Evaluate(const double *input, double *output, double *kernels) const
+{
+	const int n = mNumberOfPoses;
+	const double *rest = GetPoseOutput(0);
+
+	for (int p=0; p<n; ++p)
+		kernels[p] = Kernel( DistanceSq(input, GetPoseInput(p), mInputDim) );
+
+	const double *weights = mWeights.data();
+
+	for (int m=0; m<mOutputDim; ++m, weights += n)
+	{
+		double s = 0.0;
+		for (int p=0; p<n; ++p)
+			s += weights[p] * kernels[p];
+
+		output[m] = rest[m] + s;
+	}
+}
+
+void RBFSolver::EvaluateBatch(const int numberOfSamples, const double *inputs, double *outputs, const int numberOfThreads) const
+{
+	if (false == mTrained)
+		return;
+
+	ParallelFor(numberOfSamples, RBF_SOLVER_BATCH_GRAIN, [&] (const int first, const int last) {
+
+		std::vector<double>	kernels(mNumberOfPoses);
+
+		for (int i=first; i<last; ++i)
+			Evaluate(inputs + (size_t) i * mInputDim, outputs + (size_t) i * mOutputDim, kernels.data() );
+
+	}, numberOfThreads);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// synthetic test
+
+// mouth markers and bones driven by jaw, smile and pucker controls, bones are a different
+//	non linear function of the same controls, so the solver has to learn the mapping
+
+#define RBF_TEST_MARKERS		24
+#define RBF_TEST_BONES			32
+
+static void TestRig(const double *controls, const int count, const double radius, const double phase, double *result)
+{
+	const double jaw = controls[0];
+	const double smile = controls[1];
+	const double pucker = controls[2];
+
+	for (int i=0; i<count; ++i)
+	{
+		const double a = 6.283185307 * i / count + phase;
+		const double x = cos(a);
+		const double y = sin(a);
+		const double lower = (y < 0.0) ? 1.0 : 0.25;
+
+		double *v = result + i*3;
+		v[0] = radius * x * (1.0 + 0.4 * smile - 0.35 * pucker);
+		v[1] = radius * (0.6 * y - 0.8 * jaw * lower + 0.3 * smile * x * x - 0.2 * jaw * smile);
+		v[2] = radius * (0.2 * y * y + 0.5 * pucker * (1.0 - 0.5 * jaw) + 0.1 * sin(3.0 * jaw));
+	}
+}
+
+static double RandomUnit()
+{
+	return (double) rand() / RAND_MAX;
+}
+
+bool RBFSolverSelfTest(const int numberOfThreads)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	const int inputDim = RBF_TEST_MARKERS * 3;
+	const int outputDim = RBF_TEST_BONES * 3;
+
+	srand(11);
+
+	RBFSolver solver;
+	solver.SetDimensions(inputDim, outputDim);
+
+	std::vector<double>	input(inputDim);
+	std::vector<double>	output(outputDim);
+
+	auto fnAddPose = [&] (const double *controls) {
+		TestRig(controls, RBF_TEST_MARKERS, 2.0, 0.0, input.data() );
+		TestRig(controls, RBF_TEST_BONES, 1.5, 0.1, output.data() );
+		return solver.AddPose(input.data(), output.data() );
+	};
+
+	// rest pose first, then a grid of the controls
+
+	const double rest[3] = {0.0, 0.0, 0.0};
+	fnAddPose(rest);
+
+	for (int i=0; i<4; ++i)
+		for (int j=0; j<4; ++j)
+			for (int k=0; k<4; ++k)
+			{
+				const double controls[3] = {i / 3.0, j / 3.0, k / 3.0};
+				fnAddPose(controls);
+			}
+
+	int numberOfErrors = 0;
+
+	// the same input replaces a pose
+	const int numberOfPoses = solver.GetNumberOfPoses();
+	if (fnAddPose(rest) != 0 || solver.GetNumberOfPoses() != numberOfPoses)
+	{
+		printf( "[RBFSolver] test failed - a pose is duplicated\n" );
+		numberOfErrors += 1;
+	}
+
+	RBFSolverOptions options;
+	options.radiusScale = 3.0;
+
+	const auto trainStart = clock::now();
+	if (false == solver.Train(options) )
+	{
+		printf( "[RBFSolver] test failed - train\n" );
+		return false;
+	}
+	const double trainMs = std::chrono::duration<double, std::milli>(clock::now() - trainStart).count();
+
+	std::vector<double>	kernels(solver.GetNumberOfPoses() );
+	std::vector<double>	poseResult(outputDim);
+
+	// 1 - poses are reproduced exactly
+
+	double maxPoseError = 0.0;
+	for (int p=0; p<solver.GetNumberOfPoses(); ++p)
+	{
+		solver.Evaluate(solver.GetPoseInput(p), poseResult.data(), kernels.data() );
+		for (int m=0; m<outputDim; ++m)
+			maxPoseError = std::max(maxPoseError, fabs(poseResult[m] - solver.GetPoseOutput(p)[m]) );
+	}
+
+	if (maxPoseError > 1.0e-6)
+	{
+		printf( "[RBFSolver] test failed - pose error %g\n", maxPoseError );
+		numberOfErrors += 1;
+	}
+
+	// 2 - controls in between the poses, error relative to the bone motion range
+
+	const int numberOfFrames = 20000;
+
+	std::vector<double>	frameInputs( (size_t) numberOfFrames * inputDim);
+	std::vector<double>	frameExpected( (size_t) numberOfFrames * outputDim);
+	std::vector<double>	restOutput(outputDim);
+
+	TestRig(rest, RBF_TEST_BONES, 1.5, 0.1, restOutput.data() );
+
+	for (int i=0; i<numberOfFrames; ++i)
+	{
+		const double t = 0.01 * i;
+		const double controls[3] = { 0.5 + 0.5 * sin(t), 0.5 + 0.5 * sin(0.7 * t + 1.0), RandomUnit() };
+
+		TestRig(controls, RBF_TEST_MARKERS, 2.0, 0.0, &frameInputs[(size_t) i * inputDim] );
+		TestRig(controls, RBF_TEST_BONES, 1.5, 0.1, &frameExpected[(size_t) i * outputDim] );
+	}
+
+	std::vector<double>	frameOutputs( (size_t) numberOfFrames * outputDim);
+	std::vector<double>	batchOutputs( (size_t) numberOfFrames * outputDim);
+
+	auto startTime = clock::now();
+	for (int i=0; i<numberOfFrames; ++i)
+		solver.Evaluate(&frameInputs[(size_t) i * inputDim], &frameOutputs[(size_t) i * outputDim], kernels.data() );
+	const double singleMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+	startTime = clock::now();
+	solver.EvaluateBatch(numberOfFrames, frameInputs.data(), batchOutputs.data(), numberOfThreads);
+	const double batchMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+	double errorSq = 0.0;
+	double motionSq = 0.0;
+	double maxBatchDiff = 0.0;
+
+	for (int i=0; i<numberOfFrames; ++i)
+	{
+		const size_t offset = (size_t) i * outputDim;
+		for (int m=0; m<outputDim; ++m)
+		{
+			const double e = frameOutputs[offset + m] - frameExpected[offset + m];
+			const double d = frameExpected[offset + m] - restOutput[m];
+			errorSq += e * e;
+			motionSq += d * d;
+			maxBatchDiff = std::max(maxBatchDiff, fabs(batchOutputs[offset + m] - frameOutputs[offset + m]) );
+		}
+	}
+
+	const double relativeError = sqrt(errorSq / std::max(motionSq, DBL_MIN) );
+
+	if (relativeError > 0.03)
+	{
+		printf( "[RBFSolver] test failed - interpolation error %.2f%%\n", 100.0 * relativeError );
+		numberOfErrors += 1;
+	}
+
+	if (maxBatchDiff > 0.0)
+	{
+		printf( "[RBFSolver] test failed - batch differs by %g\n", maxBatchDiff );
+		numberOfErrors += 1;
+	}
+
+	// 3 - noisy poses are smoothed by the regularization, it still has to be close
+
+	options.regularization = 1.0e-3;
+	if (false == solver.Train(options) )
+	{
+		printf( "[RBFSolver] test failed - train with regularization\n" );
+		numberOfErrors += 1;
+	}
+
+	const bool result = (0 == numberOfErrors);
+
+	printf( "[RBFSolver] self test %s, %d poses, %d inputs, %d outputs, train %.2f ms, pose error %g, interpolation error %.2f%%\n",
+		(result) ? "passed" : "FAILED", numberOfPoses, inputDim, outputDim, trainMs, maxPoseError, 100.0 * relativeError );
+	printf( "[RBFSolver] %d frames, single thread %.0f frames/sec, batch on %d threads %.0f frames/sec\n",
+		numberOfFrames, 1000.0 * numberOfFrames / std::max(singleMs, 1.0e-3),
+		ParallelForThreadCount(numberOfThreads), 1000.0 * numberOfFrames / std::max(batchMs, 1.0e-3) );
+
+	return result;
+}
@@ -0,0 +1,803 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: TextureAtlas.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs_Framework
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs_Framework/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "algorithm\TextureAtlas.h"
+#include "algorithm\ParallelFor.h"
+#include "IO\FBXUtils.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <stdint.h>
+
+static int AlignUp(const int value, const int alignment)
+{
+	return (alignment > 1) ? ((value + alignment - 1) / alignment) * alignment : value;
+}
+
+static int NextPowerOfTwo(const int value)
+{
+	int result = 1;
+	while (result < value)
+		result <<= 1;
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// MaxRectsPacker
+
+MaxRectsPacker::MaxRectsPacker()
+	: mWidth(0)
+	, mHeight(0)
+{}
+
+void MaxRectsPacker::Init(const int width, const int height)
+{
+	mWidth = width;
+	mHeight = height;
+
+	mUsedRects.clear();
+	mFreeRects.clear();
+
+	AtlasRect rect = {0, 0, width, height};
+	mFreeRects.push_back(rect);
+}
+
+bool MaxRectsPacker::Insert(const int width, const int height, AtlasRect &rect)
+{
+	int bestShortSide = INT_MAX;
+	int bestLongSide = INT_MAX;
+	int bestIndex = -1;
+
+	for (int i=0, count=(int)mFreeRects.size(); i<count; ++i)
+	{
+		const AtlasRect &freeRect = mFreeRects[i];
+		if (freeRect.w >= width && freeRect.h >= height)
+		{
+			const int leftoverH = freeRect.w - width;
+			const int leftoverV = freeRect.h - height;
+			const int shortSide = std::min(leftoverH, leftoverV);
+			const int longSide = std::max(leftoverH, leftoverV);
+
+			if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide) )
+			{
+				bestShortSide = shortSide;
+				bestLongSide = longSide;
+				bestIndex = i;
+			}
+		}
+	}
+
+	if (bestIndex < 0)
+		return false;
+
+	rect.x = mFreeRects[bestIndex].x;
+	rect.y = mFreeRects[bestIndex].y;
+	rect.w = width;
+	rect.h = height;
+
+	PlaceRect(rect);
+	return true;
+}
+
+void MaxRectsPacker::PlaceRect(const AtlasRect &node)
+{
+	for (size_t i=0; i<mFreeRects.size(); )
+	{
+		if (SplitFreeNode(mFreeRects[i], node) )
+		{
+			mFreeRects[i] = mFreeRects.back();
+			mFreeRects.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	PruneFreeList();
+	mUsedRects.push_back(node);
+}
+
+bool MaxRectsPacker::SplitFreeNode(const AtlasRect &freeNode, const AtlasRect &usedNode)
+{
+	if (usedNode.x >= freeNode.x + freeNode.w || usedNode.x + usedNode.w <= freeNode.x
+		|| usedNode.y >= freeNode.y + freeNode.h || usedNode.y + usedNode.h <= freeNode.y)
+		return false;
+
+	// copy, push_back could move the storage
+	const AtlasRect free = freeNode;
+
+	if (usedNode.x < free.x + free.w && usedNode.x + usedNode.w > free.x)
+	{
+		// new node at the top side of the used node
+		if (usedNode.y > free.y && usedNode.y < free.y + free.h)
+		{
+			AtlasRect newNode = free;
+			newNode.h = usedNode.y - newNode.y;
+			mFreeRects.push_back(newNode);
+		}
+		// bottom side
+		if (usedNode.y + usedNode.h < free.y + free.h)
+		{
+			AtlasRect newNode = free;
+			newNode.y = usedNode.y + usedNode.h;
+			newNode.h = free.y + free.h - (usedNode.y + usedNode.h);
+			mFreeRects.push_back(newNode);
+		}
+	}
+
+	if (usedNode.y < free.y + free.h && usedNode.y + usedNode.h > free.y)
+	{
+		// left side
+		if (usedNode.x > free.x && usedNode.x < free.x + free.w)
+		{
+			AtlasRect newNode = free;
+			newNode.w = usedNode.x - newNode.x;
+			mFreeRects.push_back(newNode);
+		}
+		// right side
+		if (usedNode.x + usedNode.w < free.x + free.w)
+		{
+			AtlasRect newNode = free;
+			newNode.x = usedNode.x + usedNode.w;
+			newNode.w = free.x + free.w - (usedNode.x + usedNode.w);
+			mFreeRects.push_back(newNode);
+		}
+	}
+
+	return true;
+}
+
+void MaxRectsPacker::PruneFreeList()
+{
+	auto fn_contains = [] (const AtlasRect &a, const AtlasRect &b) -> bool {
+		return a.x >= b.x && a.y >= b.y && a.x + a.w <= b.x + b.w && a.y + a.h <= b.y + b.h;
+	};
+
+	for (size_t i=0; i<mFreeRects.size(); ++i)
+	{
+		for (size_t j=i+1; j<mFreeRects.size(); ++j)
+		{
+			if (fn_contains(mFreeRects[i], mFreeRects[j]) )
+			{
+				mFreeRects.erase(mFreeRects.begin() + i);
+				--i;
+				break;
+			}
+			if (fn_contains(mFreeRects[j], mFreeRects[i]) )
+			{
+				mFreeRects.erase(mFreeRects.begin() + j);
+				--j;
+			}
+		}
+	}
+}
+
+double MaxRectsPacker::GetOccupancy() const
+{
+	if (mWidth == 0 || mHeight == 0)
+		return 0.0;
+
+	double area = 0.0;
+	for (auto iter=begin(mUsedRects); iter!=end(mUsedRects); ++iter)
+		area += (double) iter->w * iter->h;
+
+	return area / ((double) mWidth * mHeight);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// TextureAtlas
+
+TextureAtlas::TextureAtlas()
+	: mSourceScale(1.0f)
+{}
+
+void TextureAtlas::Clear()
+{
+	mImage = AtlasImage();
+	mEntries.clear();
+	mSourceScale = 1.0f;
+}
+
+bool TextureAtlas::Build(const std::vector<const AtlasImage*> &sources, const TextureAtlasOptions &options)
+{
+	Clear();
+
+	if (sources.size() == 0 || options.maxSize <= 0)
+		return false;
+
+	// halve sources until they fit, 1/16 is a limit where atlas doesn't make sense anymore
+	for (float scale = 1.0f; scale >= 1.0f / 16.0f; scale *= 0.5f)
+	{
+		if (Pack(sources, options, scale) )
+		{
+			mSourceScale = scale;
+			Compose(sources, options);
+			return true;
+		}
+	}
+
+	printf( "[TextureAtlas] failed to pack %d images into %d x %d\n", (int) sources.size(), options.maxSize, options.maxSize );
+	Clear();
+	return false;
+}
+
+bool TextureAtlas::Pack(const std::vector<const AtlasImage*> &sources, const TextureAtlasOptions &options, const float scale)
+{
+	const int count = (int) sources.size();
+	const int alignment = std::max(1, options.alignment);
+	const int padding = std::max(0, options.padding);
+
+	mEntries.resize(count);
+
+	std::vector<int>	order;
+	std::vector<int>	slotWidth(count, 0);
+	std::vector<int>	slotHeight(count, 0);
+
+	double totalArea = 0.0;
+	int maxSlotSide = 0;
+
+	for (int i=0; i<count; ++i)
+	{
+		TextureAtlasEntry &entry = mEntries[i];
+		memset( &entry, 0, sizeof(TextureAtlasEntry) );
+
+		const AtlasImage *pImage = sources[i];
+		if (nullptr == pImage || pImage->width <= 0 || pImage->height <= 0)
+			continue;
+
+		entry.sourceWidth = pImage->width;
+		entry.sourceHeight = pImage->height;
+		entry.rect.w = std::max(1, (int) (pImage->width * scale + 0.5f) );
+		entry.rect.h = std::max(1, (int) (pImage->height * scale + 0.5f) );
+
+		slotWidth[i] = AlignUp(entry.rect.w + 2 * padding, alignment);
+		slotHeight[i] = AlignUp(entry.rect.h + 2 * padding, alignment);
+
+		totalArea += (double) slotWidth[i] * slotHeight[i];
+		maxSlotSide = std::max(maxSlotSide, std::max(slotWidth[i], slotHeight[i]) );
+		order.push_back(i);
+	}
+
+	if (order.size() == 0 || maxSlotSide > options.maxSize)
+		return false;
+
+	// big rects first, it gives MaxRects much better occupancy
+	std::sort( begin(order), end(order), [&slotWidth, &slotHeight] (const int a, const int b) {
+		const int sideA = std::max(slotWidth[a], slotHeight[a]);
+		const int sideB = std::max(slotWidth[b], slotHeight[b]);
+		if (sideA != sideB)
+			return sideA > sideB;
+		return slotWidth[a] * slotHeight[a] > slotWidth[b] * slotHeight[b];
+	} );
+
+	// start from the size that could hold the total area and grow
+	int startSide = std::max(maxSlotSide, (int) ceil(sqrt(totalArea)) );
+	int width = (options.powerOfTwo) ? NextPowerOfTwo(startSide) : AlignUp(startSide, alignment);
+	int height = width;
+
+	MaxRectsPacker	packer;
+
+	while (width <= options.maxSize && height <= options.maxSize)
+	{
+		packer.Init(width, height);
+
+		bool fit = true;
+		for (auto iter=begin(order); iter!=end(order); ++iter)
+		{
+			AtlasRect slot;
+			if (false == packer.Insert(slotWidth[*iter], slotHeight[*iter], slot) )
+			{
+				fit = false;
+				break;
+			}
+
+			TextureAtlasEntry &entry = mEntries[*iter];
+			entry.rect.x = slot.x + padding;
+			entry.rect.y = slot.y + padding;
+		}
+
+		if (fit)
+		{
+			mImage.width = width;
+			mImage.height = height;
+
+			for (int i=0; i<count; ++i)
+			{
+				TextureAtlasEntry &entry = mEntries[i];
+				if (entry.rect.w == 0)
+					continue;
+
+				entry.uvScale[0] = (float) entry.rect.w / (float) width;
+				entry.uvScale[1] = (float) entry.rect.h / (float) height;
+				entry.uvOffset[0] = (float) entry.rect.x / (float) width;
+				entry.uvOffset[1] = (float) entry.rect.y / (float) height;
+			}
+			return true;
+		}
+
+		// grow the shorter side
+		if (options.powerOfTwo)
+		{
+			if (width <= height) width *= 2;
+			else height *= 2;
+		}
+		else
+		{
+			if (width <= height) width = AlignUp(width + width / 4, alignment);
+			else height = AlignUp(height + height / 4, alignment);
+		}
+	}
+
+	return false;
+}
+
+void TextureAtlas::Compose(const std::vector<const AtlasImage*> &sources, const TextureAtlasOptions &options)
+{
+	const int padding = std::max(0, options.padding);
+	const int atlasWidth = mImage.width;
+	const int atlasHeight = mImage.height;
+
+	mImage.Init(atlasWidth, atlasHeight);
+
+	// one job per destination row of every entry, gutter rows included
+	struct RowJob
+	{
+		int		entry;
+		int		row;	// atlas row
+	};
+
+	std::vector<RowJob>	jobs;
+
+	for (int i=0, count=(int)mEntries.size(); i<count; ++i)
+	{
+		const AtlasRect &rect = mEntries[i].rect;
+		if (rect.w == 0)
+			continue;
+
+		const int firstRow = std::max(0, rect.y - padding);
+		const int lastRow = std::min(atlasHeight, rect.y + rect.h + padding);
+
+		for (int row=firstRow; row<lastRow; ++row)
+		{
+			RowJob job = {i, row};
+			jobs.push_back(job);
+		}
+	}
+
+	unsigned char *dstPixels = mImage.pixels.data();
+
+	ParallelFor( (int) jobs.size(), 16, [&] (const int first, const int last) {
+
+		for (int jobIndex=first; jobIndex<last; ++jobIndex)
+		{
+			const RowJob &job = jobs[jobIndex];
+			const TextureAtlasEntry &entry = mEntries[job.entry];
+			const AtlasImage *pSource = sources[job.entry];
+			const AtlasRect &rect = entry.rect;
+
+			// gutter takes the nearest edge texel
+			const int localY = std::min(std::max(job.row - rect.y, 0), rect.h - 1);
+
+			// box filter footprint in the source
+			const int sy0 = (int) ((int64_t) localY * pSource->height / rect.h);
+			const int sy1 = std::max(sy0 + 1, (int) (((int64_t) localY + 1) * pSource->height / rect.h) );
+
+			const int firstCol = std::max(0, rect.x - padding);
+			const int lastCol = std::min(atlasWidth, rect.x + rect.w + padding);
+
+			unsigned char *dst = dstPixels + ((size_t) job.row * atlasWidth + firstCol) * 4;
+
+			for (int col=firstCol; col<lastCol; ++col, dst += 4)
+			{
+				const int localX = std::min(std::max(col - rect.x, 0), rect.w - 1);
+
+				const int sx0 = (int) ((int64_t) localX * pSource->width / rect.w);
+				const int sx1 = std::max(sx0 + 1, (int) (((int64_t) localX + 1) * pSource->width / rect.w) );
+
+				unsigned int sum[4] = {0, 0, 0, 0};
+				for (int sy=sy0; sy<sy1; ++sy)
+				{
+					const unsigned char *src = pSource->pixels.data() + ((size_t) sy * pSource->width + sx0) * 4;
+					for (int sx=sx0; sx<sx1; ++sx, src += 4)
+					{
+						sum[0] += src[0];
+						sum[1] += src[1];
+						sum[2] += src[2];
+						sum[3] += src[3];
+					}
+				}
+
+				const unsigned int samples = (unsigned int) ((sy1 - sy0) * (sx1 - sx0));
+				for (int k=0; k<4; ++k)
+					dst[k] = (unsigned char) ((sum[k] + samples / 2) / samples);
+			}
+		}
+	}, options.numberOfThreads );
+}
+
+bool TextureAtlas::WriteTGA(const char *filename) const
+{
+	if (mImage.width == 0 || mImage.height == 0)
+		return false;
+
+	FILE *fp = fopen(filename, "wb");
+	if (nullptr == fp)
+	{
+		printf( "[TextureAtlas] failed to write %s\n", filename );
+		return false;
+	}
+
+	unsigned char header[18];
+	memset( header, 0, sizeof(header) );
+
+	header[2] = 2;		// uncompressed true color
+	header[12] = (unsigned char) (mImage.width & 0xFF);
+	header[13] = (unsigned char) ((mImage.width >> 8) & 0xFF);
+	header[14] = (unsigned char) (mImage.height & 0xFF);
+	header[15] = (unsigned char) ((mImage.height >> 8) & 0xFF);
+	header[16] = 32;
+	header[17] = 8;		// 8 alpha bits, bottom left origin
+
+	fwrite( header, sizeof(header), 1, fp );
+
+	// tga keeps BGRA
+	std::vector<unsigned char>	row( (size_t) mImage.width * 4 );
+	for (int y=0; y<mImage.height; ++y)
+	{
+		const unsigned char *src = mImage.pixels.data() + (size_t) y * mImage.width * 4;
+		for (int x=0; x<mImage.width; ++x)
+		{
+			row[x*4+0] = src[x*4+2];
+			row[x*4+1] = src[x*4+1];
+			row[x*4+2] = src[x*4+0];
+			row[x*4+3] = src[x*4+3];
+		}
+		fwrite( row.data(), row.size(), 1, fp );
+	}
+
+	fclose(fp);
+	return true;
+}
+
+bool TextureAtlas::WriteRemapTable(const char *filename, const std::vector<std::string> &names) const
+{
+	FILE *fp = fopen(filename, "wt");
+	if (nullptr == fp)
+	{
+		printf( "[TextureAtlas] failed to write %s\n", filename );
+		return false;
+	}
+
+	fprintf( fp, "# atlas %d %d scale %.4f\n", mImage.width, mImage.height, mSourceScale );
+	fprintf( fp, "# name, x, y, width, height, uv scale u, uv scale v, uv offset u, uv offset v\n" );
+
+	for (int i=0, count=(int)mEntries.size(); i<count; ++i)
+	{
+		const TextureAtlasEntry &entry = mEntries[i];
+		if (entry.rect.w == 0)
+			continue;
+
+		const char *name = (i < (int) names.size()) ? names[i].c_str() : "";
+		fprintf( fp, "%s, %d, %d, %d, %d, %.8f, %.8f, %.8f, %.8f\n", name,
+			entry.rect.x, entry.rect.y, entry.rect.w, entry.rect.h,
+			entry.uvScale[0], entry.uvScale[1], entry.uvOffset[0], entry.uvOffset[1] );
+	}
+
+	fclose(fp);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// geometry
+
+bool RemapInputModelUVs(InputModelData &data, const TextureAtlas &atlas, const std::vector<int> &materialToEntry)
+{
+	size_t cornerCount = 0;
+	for (auto iter=begin(data.polyInfo); iter!=end(data.polyInfo); ++iter)
+		cornerCount += iter->vertexCount;
+
+	if (data.uvIndices.size() != cornerCount)
+	{
+		printf( "[TextureAtlas] uvs have to be mapped by polygon vertex\n" );
+		return false;
+	}
+
+	const int uvCount = (int) data.uvs.size();
+	std::vector<Float2>		newUVs(cornerCount);
+
+	size_t corner = 0;
+	for (auto iter=begin(data.polyInfo); iter!=end(data.polyInfo); ++iter)
+	{
+		const int vertexCount = iter->vertexCount;
+		const int materialId = iter->materialId;
+
+		int entry = -1;
+		if (materialId >= 0 && materialId < (int) materialToEntry.size() )
+			entry = materialToEntry[materialId];
+		if (entry >= atlas.GetEntryCount() || (entry >= 0 && false == atlas.IsEntryPacked(entry)) )
+			entry = -1;
+
+		// polygon shift for tiled uvs
+		float minU = 0.0f;
+		float minV = 0.0f;
+
+		for (int j=0; j<vertexCount; ++j)
+		{
+			const int index = data.uvIndices[corner + j];
+			Float2 &uv = newUVs[corner + j];
+
+			if (index >= 0 && index < uvCount)
+				uv = data.uvs[index];
+			else
+				uv.x[0] = uv.x[1] = 0.0f;
+
+			if (0 == j || uv.x[0] < minU) minU = uv.x[0];
+			if (0 == j || uv.x[1] < minV) minV = uv.x[1];
+		}
+
+		if (entry >= 0)
+		{
+			const float shiftU = floorf(minU);
+			const float shiftV = floorf(minV);
+
+			for (int j=0; j<vertexCount; ++j)
+			{
+				Float2 &uv = newUVs[corner + j];
+				const float u = std::min(std::max(uv.x[0] - shiftU, 0.0f), 1.0f);
+				const float v = std::min(std::max(uv.x[1] - shiftV, 0.0f), 1.0f);
+				atlas.RemapUV(entry, u, v, uv.x[0], uv.x[1]);
+			}
+		}
+
+		corner += vertexCount;
+	}
+
+	data.uvs.swap(newUVs);
+	for (size_t i=0; i<cornerCount; ++i)
+		data.uvIndices[i] = (int) i;
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// self test
+
+static void FillAtlasImage(AtlasImage &image, const int width, const int height, const unsigned char *color)
+{
+	image.Init(width, height);
+	for (size_t i=0; i<image.pixels.size(); i+=4)
+		memcpy( &image.pixels[i], color, 4 );
+}
+
+static bool IsAtlasPixel(const AtlasImage &image, const int x, const int y, const unsigned char *color)
+{
+	return 0 == memcmp( &image.pixels[((size_t) y * image.width + x) * 4], color, 4 );
+}
+
+bool TextureAtlasSelfTest()
+{
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf( "[TextureAtlas] %s\n", text );
+			numberOfErrors += 1;
+		}
+	};
+
+	// 1 - solid color images of different sizes, one material without a texture
+
+	const int numberOfImages = 10;
+	const int sizes[numberOfImages][2] = { {256, 128}, {64, 64}, {200, 50}, {17, 33}, {128, 128},
+		{40, 90}, {300, 20}, {1, 1}, {96, 96}, {50, 50} };
+	const int emptyIndex = 5;
+
+	std::vector<AtlasImage>			images(numberOfImages);
+	std::vector<const AtlasImage*>	sources(numberOfImages, nullptr);
+	unsigned char					colors[numberOfImages][4];
+
+	for (int i=0; i<numberOfImages; ++i)
+	{
+		colors[i][0] = (unsigned char) (10 + 20 * i);
+		colors[i][1] = (unsigned char) (250 - 20 * i);
+		colors[i][2] = (unsigned char) (7 * i);
+		colors[i][3] = (unsigned char) (255 - i);
+
+		if (i == emptyIndex)
+			continue;
+
+		FillAtlasImage(images[i], sizes[i][0], sizes[i][1], colors[i]);
+		sources[i] = &images[i];
+	}
+
+	TextureAtlasOptions	options;
+	options.maxSize = 1024;
+	options.padding = 4;
+	options.alignment = 4;
+
+	TextureAtlas	atlas;
+	fnCheck( atlas.Build(sources, options), "failed to build an atlas of synthetic images" );
+	fnCheck( atlas.GetSourceScale() == 1.0f, "images are downscaled while they fit" );
+	fnCheck( atlas.GetEntryCount() == numberOfImages, "entry count differs from sources" );
+
+	const AtlasImage &image = atlas.GetImage();
+
+	for (int i=0; i<atlas.GetEntryCount(); ++i)
+	{
+		const bool packed = atlas.IsEntryPacked(i);
+		fnCheck( packed == (i != emptyIndex), "packed entries don't match sources" );
+		if (false == packed)
+			continue;
+
+		const AtlasRect &rect = atlas.GetEntry(i).rect;
+
+		fnCheck( rect.w == sizes[i][0] && rect.h == sizes[i][1], "rect size differs from a source size" );
+		fnCheck( rect.x >= 0 && rect.y >= 0 && rect.x + rect.w <= image.width && rect.y + rect.h <= image.height,
+			"rect is out of the atlas" );
+		fnCheck( 0 == (rect.x - options.padding) % options.alignment && 0 == (rect.y - options.padding) % options.alignment,
+			"rect slot is not aligned" );
+
+		// rects with gutters don't overlap
+		for (int j=i+1; j<atlas.GetEntryCount(); ++j)
+		{
+			if (false == atlas.IsEntryPacked(j) )
+				continue;
+
+			const AtlasRect &other = atlas.GetEntry(j).rect;
+			const bool separated = rect.x + rect.w + options.padding <= other.x - options.padding
+				|| other.x + other.w + options.padding <= rect.x - options.padding
+				|| rect.y + rect.h + options.padding <= other.y - options.padding
+				|| other.y + other.h + options.padding <= rect.y - options.padding;
+			fnCheck( separated, "rects overlap with gutters" );
+		}
+
+		// content and gutter are the source color
+		int wrongPixels = 0;
+		for (int y=std::max(0, rect.y - options.padding), lastY=std::min(image.height, rect.y + rect.h + options.padding); y<lastY; ++y)
+			for (int x=std::max(0, rect.x - options.padding), lastX=std::min(image.width, rect.x + rect.w + options.padding); x<lastX; ++x)
+				if (false == IsAtlasPixel(image, x, y, colors[i]) )
+					wrongPixels += 1;
+
+		fnCheck( 0 == wrongPixels, "rect or gutter pixels differ from a source color" );
+
+		float u, v;
+		atlas.RemapUV(i, 1.0f, 1.0f, u, v);
+		fnCheck( fabs(u * image.width - (rect.x + rect.w)) < 1.0e-3 && fabs(v * image.height - (rect.y + rect.h)) < 1.0e-3,
+			"uv transform doesn't match a rect" );
+	}
+
+	// 2 - images that don't fit are downscaled, too big ones fail
+
+	{
+		const unsigned char white[4] = {255, 255, 255, 255};
+		std::vector<AtlasImage>			bigImages(4);
+		std::vector<const AtlasImage*>	bigSources(4);
+
+		for (int i=0; i<4; ++i)
+		{
+			FillAtlasImage(bigImages[i], 256, 256, white);
+			bigSources[i] = &bigImages[i];
+		}
+
+		TextureAtlasOptions	smallOptions;
+		smallOptions.maxSize = 256;
+
+		TextureAtlas	smallAtlas;
+		fnCheck( smallAtlas.Build(bigSources, smallOptions), "failed to pack downscaled images" );
+		fnCheck( smallAtlas.GetSourceScale() < 1.0f, "images are not downscaled to fit" );
+		fnCheck( smallAtlas.GetImage().width <= 256 && smallAtlas.GetImage().height <= 256, "atlas is bigger than max size" );
+
+		for (int i=0; i<smallAtlas.GetEntryCount(); ++i)
+		{
+			fnCheck( smallAtlas.IsEntryPacked(i) && smallAtlas.GetEntry(i).rect.w == (int) (256 * smallAtlas.GetSourceScale() + 0.5f),
+				"downscaled rect has a wrong size" );
+		}
+
+		AtlasImage	hugeImage;
+		FillAtlasImage(hugeImage, 8192, 16, white);
+		std::vector<const AtlasImage*>	hugeSources(1, &hugeImage);
+
+		fnCheck( false == smallAtlas.Build(hugeSources, smallOptions), "image bigger than 16 x max size is packed" );
+	}
+
+	// 3 - mesh with a quad per material, one quad has tiled uvs, all quads share uv indices
+
+	{
+		InputModelData	data;
+
+		const float quadUVs[8] = {0.0f, 0.0f,  1.0f, 0.0f,  1.0f, 1.0f,  0.0f, 1.0f};
+		for (int i=0; i<4; ++i)
+		{
+			Float2 uv;
+			uv.x[0] = quadUVs[i*2];
+			uv.x[1] = quadUVs[i*2+1];
+			data.uvs.push_back(uv);
+		}
+		for (int i=0; i<4; ++i)
+		{
+			// tiled copy of the same quad
+			Float2 uv;
+			uv.x[0] = quadUVs[i*2] + 2.0f;
+			uv.x[1] = quadUVs[i*2+1] - 3.0f;
+			data.uvs.push_back(uv);
+		}
+
+		std::vector<int>	materialToEntry(numberOfImages + 1, -1);
+		for (int i=0; i<numberOfImages; ++i)
+			materialToEntry[i] = i;
+		materialToEntry[2] = -1;	// material keeps its own texture
+
+		// every material, then a tiled quad of material 0
+		const int numberOfPolys = numberOfImages + 1;
+
+		for (int i=0; i<numberOfPolys; ++i)
+		{
+			InputModelData::PolyInfo info;
+			info.materialId = (i < numberOfImages) ? i : 0;
+			info.vertexCount = 4;
+			data.polyInfo.push_back(info);
+
+			const int firstUV = (i < numberOfImages) ? 0 : 4;
+			for (int j=0; j<4; ++j)
+				data.uvIndices.push_back(firstUV + j);
+		}
+
+		fnCheck( RemapInputModelUVs(data, atlas, materialToEntry), "failed to remap mesh uvs" );
+		fnCheck( (int) data.uvs.size() == numberOfPolys * 4, "every polygon vertex has to get its own uv" );
+
+		for (int i=0; i<(int) data.uvIndices.size(); ++i)
+			fnCheck( data.uvIndices[i] == i, "uv indices are not direct after remap" );
+
+		for (int i=0; i<numberOfPolys && (int) data.uvs.size() == numberOfPolys * 4; ++i)
+		{
+			const int materialId = data.polyInfo[i].materialId;
+			const int entry = materialToEntry[materialId];
+
+			float centerU = 0.0f;
+			float centerV = 0.0f;
+
+			for (int j=0; j<4; ++j)
+			{
+				const Float2 &uv = data.uvs[i*4+j];
+				centerU += 0.25f * uv.x[0];
+				centerV += 0.25f * uv.x[1];
+
+				float u = quadUVs[j*2];
+				float v = quadUVs[j*2+1];
+				if (entry >= 0 && atlas.IsEntryPacked(entry) )
+					atlas.RemapUV(entry, quadUVs[j*2], quadUVs[j*2+1], u, v);
+
+				fnCheck( fabs(uv.x[0] - u) < 1.0e-5f && fabs(uv.x[1] - v) < 1.0e-5f, "remapped uv is not at the rect corner" );
+			}
+
+			// polygon center samples the material color in the atlas
+			if (entry >= 0 && atlas.IsEntryPacked(entry) )
+			{
+				const int x = std::min(image.width - 1, (int) (centerU * image.width) );
+				const int y = std::min(image.height - 1, (int) (centerV * image.height) );
+				fnCheck( IsAtlasPixel(image, x, y, colors[materialId]), "polygon center doesn't sample its texture in the atlas" );
+			}
+		}
+
+		// uvs by control point are not supported
+		data.uvIndices.resize(4);
+		fnCheck( false == RemapInputModelUVs(data, atlas, materialToEntry), "remap accepts uvs not mapped by polygon vertex" );
+	}
+
+	printf( "[TextureAtlas] self test %s, %d errors\n", (numberOfErrors == 0) ? "passed" : "FAILED", numberOfErrors );
+	return numberOfErrors == 0;
+}
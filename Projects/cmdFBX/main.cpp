@@ -14,19 +14,51 @@
 #include "stdafx.h"
 #include "IO\CmdFBX.h"
 #include "IO\FbxUtils.h"
+#include "IO\InputModelBlob.h"
+#include "IO\CSV_ColumnarReader.h"
+#include "IO\SharedJobQueue.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <memory>
 
 int _tmain(int argc, _TCHAR* argv[])
 {
-	std::auto_ptr<InputModelData> data(new InputModelData());
+	// persistent mode, process snapshot jobs from the shared memory queue until host stops us
+	if (argc > 2 && strcmp(argv[1], "-worker") == 0)
+	{
+		return CmdMakeSnapshotFBX_RunWorker( argv[2] );
+	}
+
+	// stand-in worker for the job queue self test, cmdFBX.exe -standin -worker <queueName>
+	if (argc > 3 && strcmp(argv[1], "-standin") == 0 && strcmp(argv[2], "-worker") == 0)
+	{
+		return RunSharedJobStandInWorker( argv[3] );
+	}
+
+	// transfer format and job queue checks on synthetic data, no host process is needed
+	if (argc > 1 && strcmp(argv[1], "-selftest") == 0)
+	{
+		std::vector<std::string> standInArguments;
+		standInArguments.push_back( argv[0] );
+		standInArguments.push_back( "-standin" );
+
+		// csv test file and its sidecar are written into the temp folder
+		const char *tempFolder = getenv("TEMP");
+
+		bool passed = InputModelBlobSelfTest();
+		passed = SharedJobQueueSelfTest(standInArguments) && passed;
+		passed = CSVColumnarReaderSelfTest( (tempFolder) ? tempFolder : "." ) && passed;
+
+		InputModelBlobBenchmark(512, 10);
+		SharedJobQueueBenchmark(standInArguments, 50, 4 * 1024 * 1024);
+		return (passed) ? 0 : 1;
+	}
 
 	if (argc > 2)
 	{
-		if (CmdMakeSnapshotFBX_Receive(data.get()) == true)
-		{
-			MakeSnapshotFBX( argv[1], argv[2], *data, false );
-		}
+		// geometry is read in place from the shared memory block
+		CmdMakeSnapshotFBX_ReceiveSnapshot( argv[1], argv[2], false );
 	}
 
 	return 0;
@@ -28,6 +28,7 @@ FBLibraryDeclare( constraintcameraunproject )
 	FBLibraryRegister(ConstraintCameraUnProject);
 	FBLibraryRegister(ConstraintFacialRetargeting);
 	FBLibraryRegister(ConstraintFacialRetargeting_Layout);
+	FBLibraryRegister(ConstraintMouthRetarget);
 	FBLibraryRegister(Box_ClosestPoint);
 	FBLibraryRegister(Box_UnProject);
 	FBLibraryRegister(Tool_PutOnGround);
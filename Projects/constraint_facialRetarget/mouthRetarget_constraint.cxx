@@ -1,14 +1,16 @@
 
-/**	\file	orconstraintposition_constraint.cxx
-*	Definition of a simple constraint class.
-*	Simple constraint function definitions for the ORConstraintPosition
-*	class.
+/**	\file	mouthRetarget_constraint.cxx
+*	Definition of a mouth retarget constraint class.
+*	Function definitions for the ConstraintMouthRetarget class.
 */
 
 //--- Class declarations
 #include "mouthRetarget_constraint.h"
 #include "algorithm\math3d_mobu.h"
 
+#include <chrono>
+#include <algorithm>
+
 //--- Registration defines
 #define	ORCONSTRAINTMOUTHRETARGET__CLASS		ORCONSTRAINTMOUTHRETARGET__CLASSNAME
 #define ORCONSTRAINTMOUTHRETARGET__NAME			"Mouth Retarget"
@@ -28,6 +30,41 @@ static void MouthRetarget_AssignSource(HIObject pObject, bool value) {
 	if (value && pplug) pplug->DoAssignSource();
 }
 
+static void MouthRetarget_ClearPoses(HIObject pObject, bool value) {
+	ConstraintMouthRetarget *pplug = FBCast<ConstraintMouthRetarget>(pObject);
+	if (value && pplug) pplug->DoClearPoses();
+}
+
+static void MouthRetarget_BakeTake(HIObject pObject, bool value) {
+	ConstraintMouthRetarget *pplug = FBCast<ConstraintMouthRetarget>(pObject);
+	if (value && pplug) pplug->DoBakeTake();
+}
+
+static void MouthRetarget_SolverTest(HIObject pObject, bool value) {
+	if (value) RBFSolverSelfTest();
+}
+
+static int MouthRetarget_GetNumberOfPoses(HIObject pObject) {
+	ConstraintMouthRetarget *pplug = FBCast<ConstraintMouthRetarget>(pObject);
+	return (pplug) ? pplug->GetNumberOfPoses() : 0;
+}
+
+static void MouthRetarget_SetRadiusScale(HIObject pObject, double value) {
+	ConstraintMouthRetarget *pplug = FBCast<ConstraintMouthRetarget>(pObject);
+	if (pplug) {
+		pplug->RadiusScale.SetPropertyValue(value);
+		pplug->TrainSolver();
+	}
+}
+
+static void MouthRetarget_SetSmoothing(HIObject pObject, double value) {
+	ConstraintMouthRetarget *pplug = FBCast<ConstraintMouthRetarget>(pObject);
+	if (pplug) {
+		pplug->Smoothing.SetPropertyValue(value);
+		pplug->TrainSolver();
+	}
+}
+
 /************************************************
  *	Creation function.
  ************************************************/
@@ -48,6 +85,13 @@ bool ConstraintMouthRetarget::FBCreate()
 	FBPropertyPublish( this, CorrespondancePostfix, "Corr Postfix", nullptr, nullptr);
 	FBPropertyPublish( this, AssignSource, "Assign Source", nullptr, MouthRetarget_AssignSource );
 
+	FBPropertyPublish( this, NumberOfPoses, "Number Of Poses", MouthRetarget_GetNumberOfPoses, nullptr );
+	FBPropertyPublish( this, ClearPoses, "Clear Poses", nullptr, MouthRetarget_ClearPoses );
+	FBPropertyPublish( this, RadiusScale, "Radius Scale", nullptr, MouthRetarget_SetRadiusScale );
+	FBPropertyPublish( this, Smoothing, "Smoothing", nullptr, MouthRetarget_SetSmoothing );
+	FBPropertyPublish( this, BakeTake, "Bake Take", nullptr, MouthRetarget_BakeTake );
+	FBPropertyPublish( this, SolverTest, "Solver Test", nullptr, MouthRetarget_SolverTest );
+
 	StickyLips.SetMinMax(0.0, 100.0, true, true);
 	StickyLips = 10.0;
 
@@ -63,6 +107,11 @@ bool ConstraintMouthRetarget::FBCreate()
 
 	CorrespondancePostfix = "_dst";
 
+	RadiusScale.SetMinMax(0.1, 10.0, true, true);
+	RadiusScale = 2.0;
+	Smoothing.SetMinMax(0.0, 1.0, true, true);
+	Smoothing = 0.0;
+
 	// Create reference group
 	mGroupSource	= ReferenceGroupAdd( "Source Objects",	MAX_NUMBER_OF_NODES );
 	mGroupConstrain	= ReferenceGroupAdd( "Constrain",		MAX_NUMBER_OF_NODES );
@@ -139,13 +188,176 @@ void ConstraintMouthRetarget::DoAssignSource()
 		}
 		else
 		{
-			printf ("> MouthRetarget: model not found - %s\n", name );
+			printf ("> MouthRetarget: model not found - %s\n", (const char*) name );
 		}
 	}
 
 	//mSystem.EndChange();
 }
 
+void ConstraintMouthRetarget::GatherPose(std::vector<double> &input, std::vector<double> &output)
+{
+	const int count = ReferenceGetCount(mGroupSource);
+	const int bonesCount = ReferenceGetCount(mGroupConstrain);
+
+	input.assign(count * 3, 0.0);
+	output.assign(count * 3, 0.0);
+
+	FBVector3d v;
+
+	for (int i=0; i<count; ++i)
+	{
+		if (ReferenceGet(mGroupSource, i) )
+		{
+			ReferenceGet(mGroupSource, i)->GetVector(v);
+			input[i*3] = v[0];
+			input[i*3+1] = v[1];
+			input[i*3+2] = v[2];
+		}
+
+		if (i < bonesCount && ReferenceGet(mGroupConstrain, i) )
+		{
+			ReferenceGet(mGroupConstrain, i)->GetVector(v);
+			output[i*3] = v[0];
+			output[i*3+1] = v[1];
+			output[i*3+2] = v[2];
+		}
+	}
+}
+
+void ConstraintMouthRetarget::TrainSolver()
+{
+	RBFSolverOptions options;
+	options.radiusScale = RadiusScale;
+	options.regularization = Smoothing;
+
+	std::lock_guard<std::mutex> lock(mSolverMutex);
+
+	if (mSolver.GetNumberOfPoses() > 0)
+		mSolver.Train(options);
+}
+
+void ConstraintMouthRetarget::DoClearPoses()
+{
+	std::lock_guard<std::mutex> lock(mSolverMutex);
+	mSolver.Clear();
+}
+
+void ConstraintMouthRetarget::DoBakeTake()
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	const int count = ReferenceGetCount(mGroupSource);
+	if (0 == count || count != ReferenceGetCount(mGroupConstrain) )
+	{
+		printf( "> MouthRetarget: source and constrain groups are not the same size\n" );
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mSolverMutex);
+		if (false == mSolver.IsTrained() || mSolver.GetInputDim() != count * 3)
+		{
+			printf( "> MouthRetarget: snap poses before baking\n" );
+			return;
+		}
+	}
+
+	FBPlayerControl &lPlayerControl = FBPlayerControl::TheOne();
+	FBTimeSpan timeSpan = mSystem.CurrentTake->LocalTimeSpan;
+
+	const FBTime startTime = timeSpan.GetStart();
+	const FBTime stopTime = timeSpan.GetStop();
+	const FBTime stepTime(0, 0, 0, 1);
+	const FBTime currentTime = mSystem.LocalTime;
+
+	int numberOfFrames = 0;
+	for (FBTime lTime(startTime); lTime <= stopTime; lTime += stepTime)
+		numberOfFrames += 1;
+
+	if (0 == numberOfFrames)
+		return;
+
+	// 1 - sources and bone parents of every frame, scene is evaluated on the main thread
+
+	std::vector<double>		inputs(numberOfFrames * count * 3, 0.0);
+	std::vector<FBMatrix>	parentInvs(numberOfFrames * count);
+
+	FBVector3d v;
+	FBMatrix m;
+	FBTime lTime(startTime);
+
+	for (int frame=0; frame<numberOfFrames; ++frame, lTime += stepTime)
+	{
+		lPlayerControl.Goto(lTime);
+		mSystem.Scene->Evaluate();
+
+		for (int i=0; i<count; ++i)
+		{
+			const int index = frame * count + i;
+
+			if (ReferenceGet(mGroupSource, i) )
+			{
+				ReferenceGet(mGroupSource, i)->GetVector(v);
+				inputs[index*3] = v[0];
+				inputs[index*3+1] = v[1];
+				inputs[index*3+2] = v[2];
+			}
+
+			FBModel *pParent = (ReferenceGet(mGroupConstrain, i) ) ? ReferenceGet(mGroupConstrain, i)->Parent : nullptr;
+			if (pParent)
+			{
+				pParent->GetMatrix(m);
+				FBMatrixInverse(parentInvs[index], m);
+			}
+		}
+	}
+
+	// 2 - all frames in batch
+
+	std::vector<double>		outputs(numberOfFrames * count * 3, 0.0);
+
+	const auto solveStart = clock::now();
+	{
+		std::lock_guard<std::mutex> lock(mSolverMutex);
+		mSolver.EvaluateBatch(numberOfFrames, inputs.data(), outputs.data() );
+	}
+	const double solveMs = std::chrono::duration<double, std::milli>(clock::now() - solveStart).count();
+
+	// 3 - keys in a parent space, the constraint is turned off to show the baked animation
+
+	Active = false;
+
+	for (int i=0; i<count; ++i)
+	{
+		FBModel *pBone = ReferenceGet(mGroupConstrain, i);
+		if (nullptr == pBone)
+			continue;
+
+		pBone->Translation.SetAnimated(true);
+		FBAnimationNode *pNode = pBone->Translation.GetAnimationNode();
+		if (nullptr == pNode)
+			continue;
+
+		lTime = startTime;
+		for (int frame=0; frame<numberOfFrames; ++frame, lTime += stepTime)
+		{
+			const int index = frame * count + i;
+
+			FBVector4d globalPos(outputs[index*3], outputs[index*3+1], outputs[index*3+2], 1.0);
+			FBVector4d localPos;
+			FBVectorMatrixMult(localPos, parentInvs[index], globalPos);
+
+			double value[3] = { localPos[0], localPos[1], localPos[2] };
+			pNode->KeyAdd(lTime, value);
+		}
+	}
+
+	lPlayerControl.Goto(currentTime);
+
+	printf( "> MouthRetarget: baked %d frames of %d bones, solver %.2f ms\n", numberOfFrames, count, solveMs );
+}
+
 /************************************************
  *	Removed all of the animation nodes.
  ************************************************/
@@ -159,6 +371,38 @@ void ConstraintMouthRetarget::RemoveAllAnimationNodes()
  ************************************************/
 bool ConstraintMouthRetarget::FbxStore(FBFbxObject* pFbxObject, kFbxObjectStore pStoreWhat)
 {
+	if (pStoreWhat & kAttributes)
+	{
+		std::lock_guard<std::mutex> lock(mSolverMutex);
+
+		const int numberOfPoses = mSolver.GetNumberOfPoses();
+		const int inputDim = mSolver.GetInputDim();
+		const int outputDim = mSolver.GetOutputDim();
+
+		pFbxObject->FieldWriteI( "PoseCount", numberOfPoses );
+		pFbxObject->FieldWriteI( "PoseInputDim", inputDim );
+		pFbxObject->FieldWriteI( "PoseOutputDim", outputDim );
+
+		// one field per array, values are read back in the same order
+
+		pFbxObject->FieldWriteBegin( "PoseIn" );
+		for (int i=0; i<numberOfPoses; ++i)
+		{
+			const double *input = mSolver.GetPoseInput(i);
+			for (int j=0; j<inputDim; ++j)
+				pFbxObject->FieldWriteD( input[j] );
+		}
+		pFbxObject->FieldWriteEnd();
+
+		pFbxObject->FieldWriteBegin( "PoseOut" );
+		for (int i=0; i<numberOfPoses; ++i)
+		{
+			const double *output = mSolver.GetPoseOutput(i);
+			for (int j=0; j<outputDim; ++j)
+				pFbxObject->FieldWriteD( output[j] );
+		}
+		pFbxObject->FieldWriteEnd();
+	}
 	return true;
 }
 
@@ -168,6 +412,44 @@ bool ConstraintMouthRetarget::FbxStore(FBFbxObject* pFbxObject, kFbxObjectStore
  ************************************************/
 bool ConstraintMouthRetarget::FbxRetrieve(FBFbxObject* pFbxObject, kFbxObjectStore pStoreWhat)
 {
+	if (pStoreWhat & kAttributes)
+	{
+		const int numberOfPoses = pFbxObject->FieldReadI( "PoseCount" );
+		const int inputDim = pFbxObject->FieldReadI( "PoseInputDim" );
+		const int outputDim = pFbxObject->FieldReadI( "PoseOutputDim" );
+
+		{
+			std::lock_guard<std::mutex> lock(mSolverMutex);
+
+			mSolver.Clear();
+
+			if (numberOfPoses > 0 && inputDim > 0 && outputDim > 0)
+			{
+				std::vector<double> inputs(numberOfPoses * inputDim, 0.0);
+				std::vector<double> outputs(numberOfPoses * outputDim, 0.0);
+
+				if (pFbxObject->FieldReadBegin( "PoseIn" ) )
+				{
+					for (auto &value : inputs)
+						value = pFbxObject->FieldReadD();
+					pFbxObject->FieldReadEnd();
+				}
+				if (pFbxObject->FieldReadBegin( "PoseOut" ) )
+				{
+					for (auto &value : outputs)
+						value = pFbxObject->FieldReadD();
+					pFbxObject->FieldReadEnd();
+				}
+
+				mSolver.SetDimensions(inputDim, outputDim);
+
+				for (int i=0; i<numberOfPoses; ++i)
+					mSolver.AddPose(&inputs[i*inputDim], &outputs[i*outputDim] );
+			}
+		}
+
+		TrainSolver();
+	}
 	return true;
 }
 
@@ -185,6 +467,19 @@ void ConstraintMouthRetarget::SnapSuggested()
 			ReferenceGet(mGroupSource, i)->GetVector( mSnapTranslation[i] );
 	}
 
+	// every snap is a pose pair for the solver, the first one is a rest pose
+	std::vector<double> input, output;
+	GatherPose(input, output);
+
+	if (input.size() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mSolverMutex);
+			mSolver.SetDimensions( (int) input.size(), (int) output.size() );
+			mSolver.AddPose(input.data(), output.data() );
+		}
+		TrainSolver();
+	}
 }
 
 /************************************************
@@ -208,23 +503,37 @@ void ConstraintMouthRetarget::FreezeSuggested()
 bool ConstraintMouthRetarget::AnimationNodeNotify(FBAnimationNode* pConnector, FBEvaluateInfo* pEvaluateInfo, FBConstraintInfo* pConstraintInfo)
 {
 	
-	double lSource[3];
-	double lBoneIn[3];
+	const int count = std::min(ReferenceGetCount(mGroupSource), MAX_NUMBER_OF_NODES);
 
-	for (int i=0; i<ReferenceGetCount(mGroupSource); ++i)
+	double lInput[MAX_NUMBER_OF_NODES * 3];
+	double lOutput[MAX_NUMBER_OF_NODES * 3];
+	double lKernels[RBF_SOLVER_MAX_POSES];
+
+	for (int i=0; i<count; ++i)
 	{
-		if (mSourceTranslation[i] && mBonesInTranslation[i] && mBonesOutTranslation[i])
-		{
-			mSourceTranslation[i]->ReadData		( lSource, pEvaluateInfo );
-			//mBonesInTranslation[i]->ReadData		( lBoneIn, pEvaluateInfo );
+		double *lSource = &lInput[i*3];
 
-			// TODO: calculations
-			//double *lSnap = mSnapTranslation[i];
-			//lBoneIn[0] += lSource[0] - lSnap[0];
-			//lBoneIn[1] += lSource[1] - lSnap[1];
-			//lBoneIn[2] += lSource[2] - lSnap[2];
+		if (mSourceTranslation[i])
+			mSourceTranslation[i]->ReadData	( lSource, pEvaluateInfo );
+		else
+			lSource[0] = lSource[1] = lSource[2] = 0.0;
+	}
+
+	// all bones from the pose space, source is copied until poses are snapped
+
+	std::unique_lock<std::mutex> lock(mSolverMutex);
 
-			mBonesOutTranslation[i]->WriteData	( lSource, pEvaluateInfo );
+	const bool useSolver = mSolver.IsTrained() && mSolver.GetInputDim() == count * 3;
+	if (useSolver)
+		mSolver.Evaluate(lInput, lOutput, lKernels);
+
+	lock.unlock();
+
+	for (int i=0; i<count; ++i)
+	{
+		if (mSourceTranslation[i] && mBonesOutTranslation[i])
+		{
+			mBonesOutTranslation[i]->WriteData	( (useSolver) ? &lOutput[i*3] : &lInput[i*3], pEvaluateInfo );
 		}
 	}
 
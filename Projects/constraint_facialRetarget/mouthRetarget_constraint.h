@@ -1,15 +1,18 @@
 #ifndef __MOUTH_RETARGET_CONSTRAINT_H__
 #define __MOUTH_RETARGET_CONSTRAINT_H__
 
-/**	\file	orconstraintposition_constraint.h
-*	Declaration of a simple constraint class.
-*	Simple constraint class declaration (FBSimpleConstraint).
+/**	\file	mouthRetarget_constraint.h
+*	Declaration of a mouth retarget constraint class.
+*	Bone translations are interpolated from snapped pose pairs (RBFSolver).
 */
 
 //--- SDK include
 #include <fbsdk/fbsdk.h>
 
 #include <vector>
+#include <mutex>
+
+#include "algorithm\RBFSolver.h"
 
 #define ORCONSTRAINTMOUTHRETARGET__CLASSNAME	ConstraintMouthRetarget
 #define ORCONSTRAINTMOUTHRETARGET__CLASSSTR		"ConstraintMouthRetarget"
@@ -65,13 +68,36 @@ public:
 
 	FBPropertyString				CorrespondancePostfix;	// name + "_dst"
 	
+	// snap adds a pose pair of source positions and bone translations
+	FBPropertyInt					NumberOfPoses;
+	FBPropertyAction				ClearPoses;
+
+	FBPropertyDouble				RadiusScale;		//!< kernel radius in mean distances between poses
+	FBPropertyDouble				Smoothing;			//!< regularization for noisy poses
+
+	FBPropertyAction				BakeTake;			//!< evaluate the whole take in batch and key the bones
+	FBPropertyAction				SolverTest;			//!< synthetic accuracy and throughput test
 	
 	void DoAssignSource();
+	void DoClearPoses();
+	void DoBakeTake();
+
+	//! factorize poses again, called when poses or solver options are changed
+	void TrainSolver();
+
+	int GetNumberOfPoses() const { return mSolver.GetNumberOfPoses(); }
 
 protected:
 
 	FBSystem		mSystem;
 
+	// weights are replaced on the main thread while the evaluation thread reads them
+	std::mutex		mSolverMutex;
+	RBFSolver		mSolver;
+
+	// global translations of sources and bones, zero for an empty reference
+	void GatherPose(std::vector<double> &input, std::vector<double> &output);
+
 };
 
 #endif	/* __MOUTH_RETARGET_CONSTRAINT_H__ */
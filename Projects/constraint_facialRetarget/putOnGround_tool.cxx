@@ -14,6 +14,7 @@
 
 //--- Class declaration
 #include "putOnGround_tool.h"
+#include <math.h>
 
 //--- Registration defines
 #define TOOLPUTONGROUND__CLASS	TOOLPUTONGROUND__CLASSNAME
@@ -34,7 +35,7 @@ bool Tool_PutOnGround::FBCreate()
 {
 	// Tool options
 	StartSize[0] = 160;
-	StartSize[1] = 95;
+	StartSize[1] = 150;
 
     int lB = 10;
 	//int lS = 4;
@@ -66,12 +67,19 @@ bool Tool_PutOnGround::FBCreate()
 										lB,	kFBAttachBottom,"ButtonOrient",	1.0,
 										lW,	kFBAttachNone,	"",	1.0,
 										lH,	kFBAttachNone,	"",	1.0 );
+
+	AddRegion( "ButtonBenchmark", "ButtonBenchmark",
+										lB,	kFBAttachLeft,	"",	1.0	,
+										lB,	kFBAttachBottom,"ButtonProject",	1.0,
+										lW,	kFBAttachNone,	"",	1.0,
+										lH,	kFBAttachNone,	"",	1.0 );
 	
 	//
 	SetControl( "LabelInfo", mLabelInfo );
 	SetControl( "Container", mContainerGround );
 	SetControl( "ButtonOrient", mButtonOrient );
 	SetControl( "ButtonProject", mButtonProject );
+	SetControl( "ButtonBenchmark", mButtonBenchmark );
 
 	// Configure button
 
@@ -87,6 +95,9 @@ bool Tool_PutOnGround::FBCreate()
 	mButtonProject.OnClick.Add( this, (FBCallback) &Tool_PutOnGround::EventButtonProjectClick );
 	mButtonProject.Caption = "Project Selected!";
 
+	mButtonBenchmark.OnClick.Add( this, (FBCallback) &Tool_PutOnGround::EventButtonBenchmarkClick );
+	mButtonBenchmark.Caption = "Benchmark";
+
 	// Add tool callbacks
 	
 	
@@ -138,118 +149,201 @@ void Tool_PutOnGround::EventContainerDragAndDrop( HISender pSender, HKEvent pEve
 
 }
 
-FBModelNull *MakeNullNode(double *pos, const char *name="test")
+void Tool_PutOnGround::BuildGround( GroundProjectionBVH &bvh )
 {
-	FBModelNull *pNewNode = new FBModelNull(name);
-	pNewNode->SetVector( FBVector3d(pos) );
-	pNewNode->Show = true;
+	std::vector<int>	indices;
 
-	return pNewNode;
-}
+	for (int i=0; i<mContainerGround.Items.GetCount(); ++i)
+	{
+		FBModel *pModel = (FBModel*) mContainerGround.Items.GetReferenceAt(i);
+		FBMesh *pMesh = pModel->TessellatedMesh;
 
-void Tool_PutOnGround::ProjectModel( FBModel *pModel, FBModelList *groundModels )
-{
-	FBVector3d min3, max3;
+		if (nullptr == pMesh)
+			continue;
 
-    pModel->GetBoundingBox(min3, max3);    
+		FBMatrix tm;
+		pModel->GetMatrix(tm);
 
-	//FBMatrix m, invM;
-    //pModel->GetMatrix(m, kModelTransformation);
-	//FBMatrixInverse(invM, m);
+		int count = 0;
+		FBVertex *vertices = pMesh->GetPositionsArray(count);
 
-	FBMatrix m, invM;
-	pModel->GetMatrix(m, kModelTransformation);
-	pModel->GetMatrix(invM, kModelInverse_Transformation);
-    
-    FBVector4d min4(min3[0], min3[1], min3[2], 1.0);
-    FBVector4d max4(max3[0], max3[1], max3[2], 1.0);
+		if (nullptr == vertices || 0 == count)
+			continue;
+
+		// triangle fan of every polygon
 
-    FBVectorMatrixMult(min4, m, min4);
-    FBVectorMatrixMult(max4, m, max4);
+		indices.clear();
 
-    // rays in world space
+		for (int j=0; j<pMesh->PolygonCount(); ++j)
+		{
+			const int polyVertCount = pMesh->PolygonVertexCount(j);
+			const int v0 = pMesh->PolygonVertexIndex(j, 0);
+
+			for (int k=2; k<polyVertCount; ++k)
+			{
+				indices.push_back(v0);
+				indices.push_back(pMesh->PolygonVertexIndex(j, k-1) );
+				indices.push_back(pMesh->PolygonVertexIndex(j, k) );
+			}
+		}
+
+		bvh.AddMesh( (const float*) vertices, count, 4, indices.data(), (int) indices.size() / 3, (const double*) tm );
+	}
 
-    FBVector4d rayOrigin(min4[0]+0.5*(max4[0]-min4[0]), min4[1], min4[2]+0.5*(max4[2]-min4[2]), 1.0);
-    FBVector4d rayEnd(rayOrigin);
-    rayEnd[1] -= 10.0;
-    
-	//MakeNullNode(rayOrigin, "rayOrigin");
+	bvh.Build();
+}
 
-    // convert rays into each ground model space
-    double res = 0.0;
+void Tool_PutOnGround::ComputeWorldBox( FBModel *pModel, double *box, const FBMatrix *pRotation )
+{
+	FBVector3d min3, max3;
+	pModel->GetBoundingBox(min3, max3);
 
-	double minDist = -1.0;
+	FBMatrix m;
+	pModel->GetMatrix(m, kModelTransformation);
 
-	for (int i=0; i<groundModels->GetCount(); ++i)
+	if (nullptr != pRotation)
 	{
-		FBMatrix groundM, groundInvM;
-
-		FBModel *pGroundModel = groundModels->GetAt(i);
-
-		pGroundModel->GetMatrix(groundM);
-		pGroundModel->GetMatrix(groundInvM, kModelInverse_Transformation);
-        //FBMatrixInverse(groundInvM, groundM);
-        
-        FBVector4d modelRayOrigin;
-        FBVector4d modelRayEnd;
-        
-        FBVectorMatrixMult(modelRayOrigin, groundInvM, rayOrigin);
-        FBVectorMatrixMult(modelRayEnd, groundInvM, rayEnd);
-        
-		//MakeNullNode(modelRayOrigin, "modelRayOrigin");
-
-        FBVector4d pos, n;
-        
-		if (true == pGroundModel->ClosestRayIntersection(modelRayOrigin, modelRayEnd, pos, (FBNormal&)n) )
-		{
-			FBVectorMatrixMult(pos, groundM, pos);
+		// rotate around the model translation, the same world rotation as OrientModel applies
+
+		FBVector3d pivot( m[12], m[13], m[14] );
+		m[12] = m[13] = m[14] = 0.0;
+		FBMatrixMult(m, *pRotation, m);
+		m[12] = pivot[0];
+		m[13] = pivot[1];
+		m[14] = pivot[2];
+	}
 
-			double dist = modelRayOrigin[1] - pos[1];
+	for (int k=0; k<3; ++k)
+	{
+		box[k] = 1e32;
+		box[3+k] = -1e32;
+	}
 
-			if (minDist < 0.0)
-			{
-				minDist = 0.0;
-				res = pos[1];
-			}
-			else if (minDist > dist)
-			{
-				res = pos[1];
-			}
-		}
-	}   
-    
-    // convert rays back into world space
-    
-    // use intersection point to move object to ground !
+	// every corner of a local box, a model could be rotated
 
-	if (res != 0.0)
+	for (int i=0; i<8; ++i)
 	{
-		FBVector3d v;
-		pModel->GetVector(v);
-		v[1] = res;
-		pModel->SetVector(v);
+		FBVector4d corner( (i & 1) ? max3[0] : min3[0], (i & 2) ? max3[1] : min3[1], (i & 4) ? max3[2] : min3[2], 1.0 );
+		FBVectorMatrixMult(corner, m, corner);
+
+		for (int k=0; k<3; ++k)
+		{
+			if (corner[k] < box[k]) box[k] = corner[k];
+			if (corner[k] > box[3+k]) box[3+k] = corner[k];
+		}
 	}
+}
+
+bool Tool_PutOnGround::ComputeOrientation( const double *normal, FBMatrix &rotM )
+{
+	// shortest arc from the world up to the contact normal, axis is up x normal
 
+	double axis[3] = { normal[2], 0.0, -normal[0] };
+	const double len = sqrt(axis[0]*axis[0] + axis[2]*axis[2]);
+
+	if (len < 1.0e-6)
+		return false;
+
+	axis[0] /= len;
+	axis[2] /= len;
+
+	const double angle = atan2(len, normal[1]);
+	const double c = cos(angle);
+	const double s = sin(angle);
+	const double t = 1.0 - c;
+
+	const double x = axis[0];
+	const double y = axis[1];
+	const double z = axis[2];
+
+	rotM.Identity();
+
+	// column major
+	rotM[0] = t*x*x + c;	rotM[4] = t*x*y - s*z;	rotM[8] = t*x*z + s*y;
+	rotM[1] = t*x*y + s*z;	rotM[5] = t*y*y + c;	rotM[9] = t*y*z - s*x;
+	rotM[2] = t*x*z - s*y;	rotM[6] = t*y*z + s*x;	rotM[10] = t*z*z + c;
+
+	return true;
+}
+
+void Tool_PutOnGround::OrientModel( FBModel *pModel, const FBMatrix &rotM )
+{
+	FBMatrix modelRotM;
+	pModel->GetMatrix(modelRotM, kModelRotation);
+	FBMatrixMult(modelRotM, rotM, modelRotM);
+
+	FBRVector rot;
+	FBMatrixToRotation(rot, modelRotM);
+	pModel->SetVector(rot, kModelRotation);
 }
 
 void Tool_PutOnGround::EventButtonProjectClick( HISender pSender, HKEvent pEvent )
 {
-	
 	FBModelList	*myList = FBCreateModelList();
-	FBModelList *groundList = FBCreateModelList();
+	FBGetSelectedModels(*myList);
 
-    FBGetSelectedModels(*myList);
-    
-	for (int i=0; i<mContainerGround.Items.GetCount(); ++i)
-		groundList->Add( (FBModel*) mContainerGround.Items.GetReferenceAt(i) );
+	const int numberOfModels = myList->GetCount();
+
+	GroundProjectionBVH bvh;
+	BuildGround(bvh);
+
+	if (numberOfModels > 0 && false == bvh.IsEmpty() )
+	{
+		std::vector<double>	boxes(numberOfModels * 6);
+		std::vector<GroundProjectionResult>	results(numberOfModels);
+
+		for (int i=0; i<numberOfModels; ++i)
+			ComputeWorldBox(myList->GetAt(i), boxes.data() + i * 6);
+
+		GroundProjectionOptions options;
+		options.fitPlane = (mButtonOrient.State != 0);
 
-	for (int i=0; i<myList->GetCount(); ++i)
+		GroundProjectBatch(bvh, numberOfModels, boxes.data(), options, results.data() );
 
-		ProjectModel(myList->GetAt(i), groundList);
+		// scene is changed on the main thread
 
+		int numberOfMissed = 0;
+
+		for (int i=0; i<numberOfModels; ++i)
+		{
+			FBModel *pModel = myList->GetAt(i);
+			const GroundProjectionResult &result = results[i];
+
+			if (false == result.hit)
+			{
+				numberOfMissed += 1;
+				continue;
+			}
+
+			double offset = result.offset;
+
+			// result offset is for the unrotated box, take the bottom of the oriented one
+
+			FBMatrix rotM;
+			if (options.fitPlane && ComputeOrientation(result.normal, rotM))
+			{
+				double box[6];
+				ComputeWorldBox(pModel, box, &rotM);
+				offset = result.contact[1] - box[1];
+
+				OrientModel(pModel, rotM);
+			}
+
+			FBVector3d v;
+			pModel->GetVector(v);
+			v[1] += offset;
+			pModel->SetVector(v);
+		}
+
+		if (numberOfMissed > 0)
+			printf( "[PutOnGround] %d of %d models are not above the ground\n", numberOfMissed, numberOfModels );
+	}
 
 	FBDestroyModelList(myList);
-	FBDestroyModelList(groundList);
 }
 
-
+void Tool_PutOnGround::EventButtonBenchmarkClick( HISender pSender, HKEvent pEvent )
+{
+	GroundProjectionSelfTest();
+	GroundProjectionBenchmark(1024, 20000);
+}
@@ -16,6 +16,9 @@
 
 //--- SDK include
 #include <fbsdk/fbsdk.h>
+#include <vector>
+
+#include "algorithm\GroundProjection.h"
 
 //--- Registration define
 #define TOOLPUTONGROUND__CLASSNAME	Tool_PutOnGround
@@ -38,6 +41,7 @@ private:
 	void		EventContainerDragAndDrop( HISender pSender, HKEvent pEvent );
 	
 	void		EventButtonProjectClick( HISender pSender, HKEvent pEvent );
+	void		EventButtonBenchmarkClick( HISender pSender, HKEvent pEvent );
 
 private:
 
@@ -45,8 +49,16 @@ private:
 	FBVisualContainer		mContainerGround;
 	FBButton				mButtonOrient;
 	FBButton				mButtonProject;
+	FBButton				mButtonBenchmark;
 
-	void ProjectModel( FBModel *pModel, FBModelList *groundModels );
+	// ground meshes go into one tree per operation
+	void BuildGround( GroundProjectionBVH &bvh );
+	// world space bounding box, min xyz and max xyz
+	//  pRotation - an extra world rotation around the model translation (the box of an oriented model)
+	static void ComputeWorldBox( FBModel *pModel, double *box, const FBMatrix *pRotation=nullptr );
+	// shortest arc from the world up to the normal, returns false when they are already aligned
+	static bool ComputeOrientation( const double *normal, FBMatrix &rotM );
+	static void OrientModel( FBModel *pModel, const FBMatrix &rotM );
 
 };
 
@@ -14,6 +14,7 @@
 
 
 #include "algorithm\math3d_mobu.h"
+#include "algorithm\CurveProximity.h"
 #include "IO\tinyxml.h"
 
 //--- Registration defines
@@ -905,8 +906,6 @@ void ORConstraintWallBricks::SnapSuggested()
 			FBMatrix curveTM;
 			pCurve->GetMatrix(curveTM);
 
-			double percent;
-			FBVector4d pointOnCurve;
 			FBVector3d pos;
 			int numberOfSubdivs = CurveSubdivisions;
 			int segmentSubdivs = CurveSegmentSubdivisions;
@@ -914,28 +913,11 @@ void ORConstraintWallBricks::SnapSuggested()
 			if (numberOfSubdivs <= 0 || segmentSubdivs <= 0)
 				return;
 
-			double step = 100.0 / (numberOfSubdivs * segmentSubdivs);
+			// closest point on the hermite spans instead of the nearest sample
 
-			// TODO: build k-d tree and find a closest point
-
-			KDTree						mTree;	// k-d tree
-
-			std::vector<FBVector3d>		positions;
-
-			positions.resize(numberOfSubdivs * segmentSubdivs);
-
-			percent = 0.0;
-			for (size_t i=0; i<positions.size(); ++i)
-			{
-				pointOnCurve = pCurve->Total_GlobalPathEvaluate(percent);
-				positions[i] = FBVector3d(pointOnCurve);
-
-				percent += step;
-			}
-
-			mTree.BuildKDTree( (int) positions.size(), (double*) positions.data() );
-
-			double lthres = SnapThreshold;
+			CurveProximityIndex		curveIndex;
+			if (false == curveIndex.Build( pCurve, numberOfSubdivs, segmentSubdivs ) )
+				return;
 
 			for (int i=0, count=ReferenceGetCount(mGroupConstrained); i<count; ++i)
 			{
@@ -957,11 +939,8 @@ void ORConstraintWallBricks::SnapSuggested()
 					mConstrainedBricks[i].creationPercent = 0.0;
 					*/
 
-				int index = mTree.SearchForNearest( pos, lthres );
-				if (index >= 0)
-					mConstrainedBricks[i].creationPercent = step * index;
-				else
-					mConstrainedBricks[i].creationPercent = 0.0;
+				CurveProximityResult result;
+				mConstrainedBricks[i].creationPercent = (curveIndex.Query(pos, result) ) ? result.percent : 0.0;
 			}
 
 			mEvalCurve = true;
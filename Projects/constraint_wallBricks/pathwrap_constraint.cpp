@@ -13,6 +13,7 @@
 
 #include "pathwrap_constraint.h"
 #include "algorithm\math3d_mobu.h"
+#include <algorithm>
 
 //--- Registration defines
 #define	ORCONSTRAINTPATHWRAP__CLASS		ORCONSTRAINTPATHWRAP__CLASSNAME
@@ -25,6 +26,8 @@
 #define ORCONSTRAINTPATHTEST__LABEL		"Path Test"
 #define ORCONSTRAINTPATHTEST__DESC		"Path Test"
 
+#define PATHWRAP_SPANS_PER_SEGMENT		4
+
 //--- implementation and registration
 FBConstraintImplementation	(	ORCONSTRAINTPATHWRAP__CLASS		);
 FBRegisterConstraint		(	ORCONSTRAINTPATHWRAP__NAME,
@@ -254,6 +257,7 @@ bool ORConstraintPathWrap::FBCreate()
 	mGroupDeformed	= ReferenceGroupAdd( "Deformed",	MAX_NUMBER_OF_BRICKS );
 	
 	Deformer = true;
+	mCurveIndexDirty = true;
 
 	return true;
 }
@@ -327,7 +331,10 @@ bool ORConstraintPathWrap::ReferenceAddNotify		( int pGroupIndex, FBModel* pMode
 	}
 
 	if (pGroupIndex == mGroupCurve)
+	{
+		mCurveIndexDirty = true;
 		return FBIS(pModel, FBModelPath3D);
+	}
 
 	return false;
 }
@@ -358,6 +365,8 @@ void ORConstraintPathWrap::SnapSuggested()
 {
 	if (Active == false && ReferenceGetCount(mGroupCurve) > 0)
 	{
+		mCurveIndexDirty = true;
+
 		for (int i=0, count=ReferenceGetCount(mGroupDeformed); i<count; ++i)
 		{
 			FBModel *pModel = ReferenceGet(mGroupDeformed, i);
@@ -372,6 +381,40 @@ void ORConstraintPathWrap::SnapSuggested()
 	}
 }
 
+bool ORConstraintPathWrap::ComputeCreationPercent( FBModelPath3D *pPath, FBModel *pModel, double &creationPercent )
+{
+	FBVector3d pos;
+	pModel->GetVector(pos);
+
+	// the index could be rebuilt by another deformer thread, query it under the same lock
+
+	CurveProximityResult result;
+	bool found = false;
+
+	{
+		std::lock_guard<std::mutex> lock(mCurveIndexMutex);
+
+		if (mCurveIndexDirty.exchange(false) )
+		{
+			const int subdivisions = CurveSubdivisions;
+			const int numberOfSegments = std::max(1, subdivisions / PATHWRAP_SPANS_PER_SEGMENT);
+			mCurveIndex.Build( pPath, numberOfSegments, PATHWRAP_SPANS_PER_SEGMENT );
+		}
+
+		found = mCurveIndex.Query(pos, result);
+	}
+
+	if (found)
+	{
+		creationPercent = result.percent;
+		return true;
+	}
+
+	// fallback to the brute force search
+	FBVector4d pointOnCurve;
+	return FindClosestPointOnCurve(pointOnCurve, creationPercent, pPath, FBVector4d(pos[0], pos[1], pos[2], 1.0), CurveSubdivisions, CurveSegmentSubdivisions );
+}
+
 bool ORConstraintPathWrap::DeformerNotify(	FBModel* pModel, const FBVertex*  pSrcVertex, const FBVertex* pSrcNormal,
 									int pCount, 
 									FBVertex*  pDstVertex,FBVertex*  pDstNormal)
@@ -414,11 +457,7 @@ bool ORConstraintPathWrap::DeformerNotify(	FBModel* pModel, const FBVertex*  pSr
 			ComputeModelData(pModel, pData);
 
 			// calculate closest point on a curve and creation percent
-			FBVector3d pos;
-			FBVector4d pointOnCurve;
-			pModel->GetVector(pos);
-
-			if (false == FindClosestPointOnCurve(pointOnCurve, pData->creationPercent, pPath, FBVector4d(pos[0], pos[1], pos[2], 1.0), CurveSubdivisions, CurveSegmentSubdivisions ) )
+			if (false == ComputeCreationPercent(pPath, pModel, pData->creationPercent) )
 			{
 				printf( "[PATH WRAP] failed to find a closest point on a curve!\n" );
 			}
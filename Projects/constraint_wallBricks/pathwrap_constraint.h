@@ -18,6 +18,10 @@
 #include <fbsdk/fbsdk.h>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <atomic>
+
+#include "algorithm\CurveProximity.h"
 
 #define ORCONSTRAINTPATHTEST__CLASSNAME		ORConstraintPathTest
 #define ORCONSTRAINTPATHTEST__CLASSSTR		"ORConstraintPathTest"
@@ -141,6 +145,12 @@ protected:
 
 	std::map<FBModel*, ElementData*>		mModelsData;
 
+	// closest point queries for the creation percent, rebuilt on snap or a new path
+	CurveProximityIndex				mCurveIndex;
+	std::atomic<bool>				mCurveIndexDirty;	// set on the UI thread, index is rebuilt under the mutex
+	std::mutex						mCurveIndexMutex;
+
 	void ComputeModelData( FBModel *pModel, ElementData *pData );
+	bool ComputeCreationPercent( FBModelPath3D *pPath, FBModel *pModel, double &creationPercent );
 
 };
\ No newline at end of file
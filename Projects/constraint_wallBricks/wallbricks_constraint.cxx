@@ -18,6 +18,7 @@
 #include <limits>
 
 #include "algorithm\math3d_mobu.h"
+#include "algorithm\CurveProximity.h"
 
 
 //--- Registration defines
@@ -469,8 +470,6 @@ void ORConstraintWallBricks::SnapSuggested()
 			FBMatrix curveTM;
 			pCurve->GetMatrix(curveTM);
 
-			double percent;
-			FBVector4d pointOnCurve;
 			FBVector3d pos;
 			int numberOfSubdivs = CurveSubdivisions;
 			int segmentSubdivs = CurveSegmentSubdivisions;
@@ -478,48 +477,12 @@ void ORConstraintWallBricks::SnapSuggested()
 			if (numberOfSubdivs <= 0 || segmentSubdivs <= 0)
 				return;
 
-			// TODO: build k-d tree and find a closest point
+			// the same sampling as the path wrap constraint, closest point on the hermite spans
+			//  instead of the nearest sample, no paging is needed for big subdivisions
 
-			std::vector<KDTree>			mTreePages;	// k-d tree
-			std::vector<FBVector3d>		positions;
-
-			const size_t pageLimit = 65535;
-			const size_t positionsCount = numberOfSubdivs * segmentSubdivs;
-			double step = 100.0 / (positionsCount);
-
-			// do it in pages, each page contains 65535 positions
-			const int numberOfPages = (int) (1 + positionsCount / pageLimit);
-
-			if (numberOfPages == 1)
-				positions.resize(positionsCount);
-			else
-				positions.resize(pageLimit);
-			mTreePages.resize(numberOfPages);
-
-			//
-			percent = 0.0;
-			size_t restCount = positionsCount;
-
-			for (int npage=0; npage<numberOfPages; ++npage)
-			{
-				size_t localCount = (npage==numberOfPages-1) ? restCount : pageLimit;
-
-				for (size_t i=0; i<localCount; ++i)
-				{
-					pointOnCurve = pCurve->Total_GlobalPathEvaluate(percent);
-					positions[i] = FBVector3d(pointOnCurve);
-
-					percent += step;
-				}
-
-				mTreePages[npage].BuildKDTree( (int) localCount, (double*) positions.data() );
-
-				restCount -= pageLimit;
-			}
-
-			
-
-			double lthres = SnapThreshold;
+			CurveProximityIndex		curveIndex;
+			if (false == curveIndex.Build( pCurve, numberOfSubdivs, segmentSubdivs ) )
+				return;
 
 			for (int i=0, count=ReferenceGetCount(mGroupConstrained); i<count; ++i)
 			{
@@ -530,31 +493,8 @@ void ORConstraintWallBricks::SnapSuggested()
 				FBGetLocalMatrix( mConstrainedBricks[i].initTM, curveTM, mConstrainedBricks[i].initTM );
 			
 				
-				double minDist = -1.0;
-				mConstrainedBricks[i].creationPercent = 0.0;
-
-				for (int npage=0; npage<numberOfPages; ++npage)
-				{
-					FBVector3d nearestPos;
-					
-					// hack because method returns index OR nearest pos
-					mTreePages[npage].SearchForNearest( pos, lthres, nearestPos );
-					int index = mTreePages[npage].SearchForNearest( pos, lthres );
-
-					if (index > 0)
-					{
-						double dist = VectorLength(VectorSubtract(pos, nearestPos));
-
-						if (minDist < 0.0)
-							minDist = dist;
-
-						if (dist <= minDist)
-						{
-							mConstrainedBricks[i].creationPercent = step * ((npage * pageLimit) + index);
-							minDist = dist;
-						}
-					}
-				}
+				CurveProximityResult result;
+				mConstrainedBricks[i].creationPercent = (curveIndex.Query(pos, result) ) ? result.percent : 0.0;
 				
 			}
 
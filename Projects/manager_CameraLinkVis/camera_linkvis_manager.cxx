@@ -13,6 +13,7 @@
 
 //--- Class declaration
 #include "camera_linkvis_manager.h"
+#include <math.h>
 
 //--- Registration defines
 #define CAMERA_LINKVIS__CLASS CAMERA_LINKVIS__CLASSNAME
@@ -28,6 +29,8 @@ FBRegisterCustomManager( CAMERA_LINKVIS__CLASS );         // Manager class name.
 bool Manager_CameraLinkVis::FBCreate()
 {
 	mLastCamera = nullptr;
+	mSetsDirty = true;
+	mStateKnown = false;
 
     return true;
 }
@@ -47,6 +50,9 @@ void Manager_CameraLinkVis::FBDestroy()
  ************************************************/
 bool Manager_CameraLinkVis::Init()
 {
+#ifdef _DEBUG
+	CameraLinkVisSelfTest();
+#endif
     return true;
 }
 
@@ -67,6 +73,13 @@ bool Manager_CameraLinkVis::Open()
 
 bool Manager_CameraLinkVis::Clear()
 {
+	mLastCamera = nullptr;
+	mSetsDirty = true;
+	mStateKnown = false;
+	mSets.Clear();
+	mSwitcherCameras.clear();
+	mLinkedGroups.clear();
+
     return true;
 }
 
@@ -131,81 +144,164 @@ void Manager_CameraLinkVis::EventRender(HISender pSender, HKEvent pEvent)
 
 void Manager_CameraLinkVis::EventUIIdle(HISender pSender, HKEvent pEvent)
 {
-	
 	FBCamera *pCamera = mSystem.Scene->Renderer->CurrentCamera;
+	FBCameraSwitcher *pSwitcher = nullptr;
 
 	if (FBIS(pCamera, FBCameraSwitcher))
-		pCamera = ( (FBCameraSwitcher*) pCamera)->CurrentCamera;
-
-	if (pCamera != mLastCamera)
 	{
-		// DONE: change camera
-		//printf( "change\n" );
+		pSwitcher = (FBCameraSwitcher*) pCamera;
+		pCamera = pSwitcher->CurrentCamera;
+	}
 
-		// leave all cameras groups
-		FBScene *pScene = mSystem.Scene;
-		for (int i=0; i<pScene->Cameras.GetCount(); ++i)
-		{
-			FBCamera *iCam = (FBCamera*) pScene->Cameras[i];
-			if (iCam->SystemCamera == false)
-				LeaveCamera(iCam);
-		}
+	if (pCamera == mLastCamera)
+		return;
+
+	// DONE: change camera
 
-		// enter one current
-		EnterCamera(pCamera);
+	if (mSetsDirty || IsLinkedGroupChanged(mLastCamera) || IsLinkedGroupChanged(pCamera) )
+	{
+		RebuildSets();
 	}
 
+	const int from = (mStateKnown) ? mSets.FindCamera(mLastCamera) : CAMERA_LINKVIS_UNKNOWN;
+	const int to = mSets.FindCamera(pCamera);
+
+	ApplyTransition(from, to);
+
 	mLastCamera = pCamera;
+	mStateKnown = true;
+
+	// prepare next cuts of the switcher
+	if (pSwitcher != nullptr)
+	{
+		FBTime localTime(mSystem.LocalTime);
+
+		ReadSwitcherTimeline(pSwitcher);
+		mSets.StageAhead(localTime.GetSecondDouble(), 2);
+	}
 }
 
-bool GroupVis(const char *groupName, const bool show)
+void Manager_CameraLinkVis::RebuildSets()
 {
-	FBScene *pScene = FBSystem::TheOne().Scene;
+	mSets.Clear();
+	mSwitcherCameras.clear();
+	mLinkedGroups.clear();
+
+	FBScene *pScene = mSystem.Scene;
+
+	// group lookup by name, instead of a search for every camera
+	std::unordered_map<std::string, FBGroup*>	groups;
 
 	for (int i=0; i<pScene->Groups.GetCount(); ++i)
 	{
-		if ( strcmp( pScene->Groups[i]->Name, groupName ) == 0 )
-		{
-			pScene->Groups[i]->Show = show;
+		FBGroup *pGroup = pScene->Groups[i];
+		groups.insert( std::make_pair( std::string( (const char*) pGroup->Name ), pGroup ) );
+	}
 
-			FBGroup *pGroup = pScene->Groups[i];
-			for (int j=0, count=pGroup->Items.GetCount(); j<count; ++j)
-			{
-				FBComponent *pcomp = pGroup->Items[j];
-				if (FBIS(pcomp, FBModel))
-				{
-					( (FBModel*) pcomp)->Show = show;
-				}
-			}
+	std::vector<const void*>	items;
+
+	for (int i=0; i<pScene->Cameras.GetCount(); ++i)
+	{
+		FBCamera *pCamera = (FBCamera*) pScene->Cameras[i];
+		if (pCamera->SystemCamera)
+			continue;
+
+		mSwitcherCameras.push_back(pCamera);
+
+		FBProperty *pProp = pCamera->PropertyList.Find( "LinkedGroup" );
+		if (pProp == nullptr)
+			continue;
+
+		const char *groupName = pProp->AsString();
+		mLinkedGroups[pCamera] = groupName;
 
-			return true;
+		auto iter = groups.find(groupName);
+		if (iter == groups.end() )
+			continue;
+
+		FBGroup *pGroup = iter->second;
+
+		items.clear();
+		items.push_back( (FBComponent*) pGroup );
+
+		for (int j=0, count=pGroup->Items.GetCount(); j<count; ++j)
+		{
+			FBComponent *pcomp = pGroup->Items[j];
+			if (FBIS(pcomp, FBModel))
+				items.push_back(pcomp);
 		}
+
+		mSets.AddCamera(pCamera, items);
 	}
 
-	return false;
+	mSets.Build();
+
+	// new items could be in any state
+	mSetsDirty = false;
+	mStateKnown = false;
 }
 
-void Manager_CameraLinkVis::LeaveCamera(FBCamera *pCamera)
+void Manager_CameraLinkVis::ReadSwitcherTimeline(FBCameraSwitcher *pSwitcher)
 {
-	if (pCamera == nullptr) return;
+	std::vector<CameraLinkVisCut>	cuts;
 
-	FBProperty *pProp = pCamera->PropertyList.Find( "LinkedGroup" );
-	if (pProp)
+	// camera index is 1 based in the list of scene cameras without system ones
+
+	FBProperty *pProp = pSwitcher->PropertyList.Find( "Camera Index" );
+	FBAnimationNode *pAnimNode = (pProp && pProp->IsAnimatable() ) ? ( (FBPropertyAnimatable*) pProp)->GetAnimationNode() : nullptr;
+
+	FBFCurve *pCurve = (pAnimNode != nullptr) ? (FBFCurve*) pAnimNode->FCurve : nullptr;
+
+	if (pCurve != nullptr)
 	{
-		const char *groupName = pProp->AsString();
-		GroupVis( groupName, false );
+		const int numberOfKeys = pCurve->Keys.GetCount();
+
+		cuts.resize(numberOfKeys);
+
+		for (int i=0; i<numberOfKeys; ++i)
+		{
+			FBTime keyTime( pCurve->Keys[i].Time );
+			const int index = (int) floor( (float) pCurve->Keys[i].Value + 0.5f ) - 1;
+
+			cuts[i].time = keyTime.GetSecondDouble();
+			cuts[i].camera = (index >= 0 && index < (int) mSwitcherCameras.size() ) ? mSets.FindCamera(mSwitcherCameras[index]) : CAMERA_LINKVIS_NONE;
+		}
 	}
+
+	mSets.SetTimeline(cuts);
 }
 
-void Manager_CameraLinkVis::EnterCamera(FBCamera *pCamera)
+bool Manager_CameraLinkVis::IsLinkedGroupChanged(FBCamera *pCamera) const
 {
-	if (pCamera == nullptr) return;
+	if (pCamera == nullptr) return false;
 
 	FBProperty *pProp = pCamera->PropertyList.Find( "LinkedGroup" );
-	if (pProp)
+	auto iter = mLinkedGroups.find(pCamera);
+
+	if (pProp == nullptr)
+		return (iter != mLinkedGroups.end() );
+
+	return (iter == mLinkedGroups.end() || iter->second != pProp->AsString() );
+}
+
+void Manager_CameraLinkVis::ApplyTransition(const int from, const int to)
+{
+	const CameraLinkVisTransition &transition = mSets.GetTransition(from, to);
+
+	for (int pass=0; pass<2; ++pass)
 	{
-		const char *groupName = pProp->AsString();
-		GroupVis( groupName, true );
+		const bool show = (pass == 1);
+		const std::vector<int> &ids = (show) ? transition.show : transition.hide;
+
+		for (auto iter=ids.begin(); iter!=ids.end(); ++iter)
+		{
+			FBComponent *pcomp = (FBComponent*) mSets.GetItem(*iter);
+
+			if (FBIS(pcomp, FBModel))
+				( (FBModel*) pcomp)->Show = show;
+			else if (FBIS(pcomp, FBGroup))
+				( (FBGroup*) pcomp)->Show = show;
+		}
 	}
 }
 
@@ -241,6 +337,24 @@ void Manager_CameraLinkVis::EventSceneChange(HISender pSender, HKEvent pEvent)
 {
 	FBEventSceneChange sceneEvent(pEvent);
 
+	// group items, cameras or groups are changed
+	switch (sceneEvent.Type)
+	{
+	case kFBSceneChangeAttach:
+	case kFBSceneChangeDetach:
+	case kFBSceneChangeDestroy:
+	case kFBSceneChangeAddChild:
+	case kFBSceneChangeRemoveChild:
+	case kFBSceneChangeRenamed:
+	case kFBSceneChangeLoadEnd:
+	case kFBSceneChangeClearEnd:
+	case kFBSceneChangeMergeTransactionEnd:
+		mSetsDirty = true;
+		break;
+	default:
+		break;
+	}
+
 	if (sceneEvent.Type == kFBSceneChangeRename)
 	{
 		if ( FBIS(sceneEvent.Component, FBGroup) )
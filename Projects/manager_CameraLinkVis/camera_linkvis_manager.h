@@ -15,6 +15,10 @@
 
 //--- SDK include
 #include <fbsdk/fbsdk.h>
+#include <string>
+#include <unordered_map>
+
+#include "camera_linkvis_sets.h"
 
 //--- Registration defines
 #define CAMERA_LINKVIS__CLASSNAME Manager_CameraLinkVis
@@ -48,8 +52,19 @@ private:
 	FBSystem			mSystem;
 	FBCamera			*mLastCamera;
 
-	void LeaveCamera(FBCamera *pCamera);
-	void EnterCamera(FBCamera *pCamera);
+	// resolved LinkedGroup of every camera, rebuilt on a scene change
+	CameraLinkVisSets	mSets;
+	bool				mSetsDirty;
+	bool				mStateKnown;		// items visibility was set by a previous cut
+
+	std::vector<FBCamera*>							mSwitcherCameras;	// scene cameras without system ones
+	std::unordered_map<FBCamera*, std::string>		mLinkedGroups;		// group names of the last build
+
+	void RebuildSets();
+	void ReadSwitcherTimeline(FBCameraSwitcher *pSwitcher);
+	// LinkedGroup property is changed after the last build
+	bool IsLinkedGroupChanged(FBCamera *pCamera) const;
+	void ApplyTransition(const int from, const int to);
 };
 
 #endif /* __CAMERA_LINKVIS_MANAGER_H__ */
@@ -0,0 +1,386 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: camera_linkvis_sets.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "camera_linkvis_sets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+// staged transitions are dropped when there are more of them, a scene with a lot of cameras
+//	keeps only the pairs of a current timeline part
+#define CAMERA_LINKVIS_MAX_TRANSITIONS		512
+
+static uint64_t TransitionKey(const int from, const int to)
+{
+	return ((uint64_t) (uint32_t) from << 32) | (uint64_t) (uint32_t) to;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CameraLinkVisSets
+
+CameraLinkVisSets::CameraLinkVisSets()
+	: mNumberOfStagedHits(0)
+	, mNumberOfComputed(0)
+{}
+
+void CameraLinkVisSets::Clear()
+{
+	mCameras.clear();
+	mCameraIndices.clear();
+	mItems.clear();
+	mItemIds.clear();
+	mSets.clear();
+	mAllItems.clear();
+	mTimeline.clear();
+	mTransitions.clear();
+
+	mNumberOfStagedHits = 0;
+	mNumberOfComputed = 0;
+}
+
+int CameraLinkVisSets::AddCamera(const void *camera, const std::vector<const void*> &items)
+{
+	int index = FindCamera(camera);
+
+	if (CAMERA_LINKVIS_NONE == index)
+	{
+		index = (int) mCameras.size();
+		mCameras.push_back(camera);
+		mCameraIndices[camera] = index;
+		mSets.push_back(std::vector<int>() );
+	}
+
+	std::vector<int> &set = mSets[index];
+
+	for (auto iter=items.begin(); iter!=items.end(); ++iter)
+	{
+		auto idIter = mItemIds.find(*iter);
+		int id = 0;
+
+		if (idIter == mItemIds.end() )
+		{
+			id = (int) mItems.size();
+			mItems.push_back(*iter);
+			mItemIds[*iter] = id;
+		}
+		else
+		{
+			id = idIter->second;
+		}
+		set.push_back(id);
+	}
+
+	mTransitions.clear();
+	return index;
+}
+
+void CameraLinkVisSets::Build()
+{
+	for (auto iter=mSets.begin(); iter!=mSets.end(); ++iter)
+	{
+		std::sort(iter->begin(), iter->end() );
+		iter->erase( std::unique(iter->begin(), iter->end() ), iter->end() );
+	}
+
+	mAllItems.resize(mItems.size() );
+	for (int i=0, count=(int) mItems.size(); i<count; ++i)
+		mAllItems[i] = i;
+
+	mTransitions.clear();
+}
+
+int CameraLinkVisSets::FindCamera(const void *camera) const
+{
+	auto iter = mCameraIndices.find(camera);
+	return (iter != mCameraIndices.end() ) ? iter->second : CAMERA_LINKVIS_NONE;
+}
+
+void CameraLinkVisSets::SetTimeline(const std::vector<CameraLinkVisCut> &cuts)
+{
+	mTimeline = cuts;
+
+	std::stable_sort(mTimeline.begin(), mTimeline.end(),
+		[] (const CameraLinkVisCut &a, const CameraLinkVisCut &b) { return a.time < b.time; } );
+}
+
+int CameraLinkVisSets::GetTimelineCamera(const double time) const
+{
+	auto iter = std::upper_bound(mTimeline.begin(), mTimeline.end(), time,
+		[] (const double t, const CameraLinkVisCut &cut) { return t < cut.time; } );
+
+	if (iter == mTimeline.begin() )
+		return CAMERA_LINKVIS_NONE;
+
+	--iter;
+	return iter->camera;
+}
+
+const std::vector<int> &CameraLinkVisSets::GetSetOrAll(const int index, const bool unknown) const
+{
+	static const std::vector<int> empty;
+
+	if (index >= 0 && index < (int) mSets.size() )
+		return mSets[index];
+
+	return (unknown) ? mAllItems : empty;
+}
+
+void CameraLinkVisSets::ComputeTransition(const int from, const int to, CameraLinkVisTransition &transition) const
+{
+	transition.hide.clear();
+	transition.show.clear();
+
+	// unknown state, every linked item goes out and the incoming set comes in
+	const std::vector<int> &outgoing = GetSetOrAll(from, CAMERA_LINKVIS_UNKNOWN == from);
+	const std::vector<int> &incoming = GetSetOrAll(to, false);
+
+	if (CAMERA_LINKVIS_UNKNOWN == from)
+		transition.show = incoming;
+
+	// merge of sorted lists
+
+	auto a = outgoing.begin();
+	auto b = incoming.begin();
+
+	while (a != outgoing.end() || b != incoming.end() )
+	{
+		if (b == incoming.end() || (a != outgoing.end() && *a < *b) )
+		{
+			transition.hide.push_back(*a);
+			++a;
+		}
+		else if (a == outgoing.end() || *b < *a)
+		{
+			if (CAMERA_LINKVIS_UNKNOWN != from)
+				transition.show.push_back(*b);
+			++b;
+		}
+		else
+		{
+			++a;
+			++b;
+		}
+	}
+}
+
+CameraLinkVisTransition &CameraLinkVisSets::StageTransition(const int from, const int to, bool &computed)
+{
+	const uint64_t key = TransitionKey(from, to);
+
+	auto iter = mTransitions.find(key);
+	if (iter != mTransitions.end() )
+	{
+		computed = false;
+		return iter->second;
+	}
+
+	if (mTransitions.size() >= CAMERA_LINKVIS_MAX_TRANSITIONS)
+		mTransitions.clear();
+
+	CameraLinkVisTransition &transition = mTransitions[key];
+	ComputeTransition(from, to, transition);
+
+	computed = true;
+	return transition;
+}
+
+void CameraLinkVisSets::StageAhead(const double time, const int numberOfCuts)
+{
+	auto iter = std::upper_bound(mTimeline.begin(), mTimeline.end(), time,
+		[] (const double t, const CameraLinkVisCut &cut) { return t < cut.time; } );
+
+	int from = GetTimelineCamera(time);
+	bool computed = false;
+
+	for (int i=0; i<numberOfCuts && iter != mTimeline.end(); ++iter)
+	{
+		if (iter->camera == from)
+			continue;
+
+		StageTransition(from, iter->camera, computed);
+		from = iter->camera;
+		i += 1;
+	}
+}
+
+const CameraLinkVisTransition &CameraLinkVisSets::GetTransition(const int from, const int to)
+{
+	bool computed = false;
+	const CameraLinkVisTransition &transition = StageTransition(from, to, computed);
+
+	if (computed)
+		mNumberOfComputed += 1;
+	else
+		mNumberOfStagedHits += 1;
+
+	return transition;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// synthetic test
+
+static int RandomInt(const int maxValue)
+{
+	return rand() % maxValue;
+}
+
+bool CameraLinkVisSelfTest()
+{
+	const int numberOfCameras = 80;
+	const int numberOfModels = 5000;
+	const int numberOfCuts = 400;
+
+	srand(7);
+
+	// keys are addresses inside of the arrays, the same as component pointers
+
+	std::vector<char> cameraKeys(numberOfCameras);
+	std::vector<char> itemKeys(numberOfModels + numberOfCameras);
+
+	// every camera has a group of its own models and a part of shared set models
+
+	std::vector<std::vector<int>>	expected(numberOfCameras);
+
+	CameraLinkVisSets sets;
+
+	for (int i=0; i<numberOfCameras; ++i)
+	{
+		// one camera has no group
+		if (i == 5)
+			continue;
+
+		std::vector<const void*> items;
+		std::vector<int> &keys = expected[i];
+
+		const int groupItem = numberOfModels + i;
+		items.push_back(&itemKeys[groupItem]);
+		keys.push_back(groupItem);
+
+		const int count = 50 + RandomInt(400);
+		for (int j=0; j<count; ++j)
+		{
+			const int model = (j < count / 2) ? RandomInt(500) : RandomInt(numberOfModels);
+			items.push_back(&itemKeys[model]);
+			keys.push_back(model);
+		}
+
+		sets.AddCamera(&cameraKeys[i], items);
+	}
+	sets.Build();
+
+	for (auto iter=expected.begin(); iter!=expected.end(); ++iter)
+	{
+		std::sort(iter->begin(), iter->end() );
+		iter->erase( std::unique(iter->begin(), iter->end() ), iter->end() );
+	}
+
+	// timeline of cuts, camera index of a switcher goes to a camera set
+
+	std::vector<CameraLinkVisCut>	cuts(numberOfCuts);
+
+	for (int i=0; i<numberOfCuts; ++i)
+	{
+		cuts[i].time = 0.5 * i + 0.1 * RandomInt(4);
+		cuts[i].camera = sets.FindCamera(&cameraKeys[RandomInt(numberOfCameras)]);
+	}
+	sets.SetTimeline(cuts);
+
+	// scene visibility, all items are visible before the first update
+
+	std::vector<char>	visible(itemKeys.size(), 1);
+	int numberOfChanges = 0;
+	int numberOfFullChanges = 0;
+	int numberOfErrors = 0;
+
+	// items that are not linked to any camera keep their visibility
+	std::vector<char>	linked(itemKeys.size(), 0);
+	for (int i=0; i<sets.GetNumberOfItems(); ++i)
+		linked[(const char*) sets.GetItem(i) - itemKeys.data()] = 1;
+
+	auto fnCheck = [&] (const int camera) {
+
+		std::vector<char> ref(itemKeys.size(), 0);
+
+		for (size_t i=0; i<itemKeys.size(); ++i)
+			ref[i] = (0 == linked[i]) ? 1 : 0;
+
+		if (camera >= 0)
+			for (auto iter=expected[camera].begin(); iter!=expected[camera].end(); ++iter)
+				ref[*iter] = 1;
+
+		if (ref != visible)
+			numberOfErrors += 1;
+	};
+
+	auto fnApply = [&] (const int from, const int to) {
+
+		const CameraLinkVisTransition &transition = sets.GetTransition(from, to);
+
+		for (auto iter=transition.hide.begin(); iter!=transition.hide.end(); ++iter)
+			visible[(const char*) sets.GetItem(*iter) - itemKeys.data()] = 0;
+		for (auto iter=transition.show.begin(); iter!=transition.show.end(); ++iter)
+			visible[(const char*) sets.GetItem(*iter) - itemKeys.data()] = 1;
+
+		numberOfChanges += (int) (transition.hide.size() + transition.show.size() );
+		numberOfFullChanges += sets.GetNumberOfItems();
+	};
+
+	// 1 - playback with a look ahead, every cut has to be staged
+
+	int current = CAMERA_LINKVIS_UNKNOWN;
+	int currentCamera = -1;
+
+	for (int frame=0; frame<numberOfCuts * 15; ++frame)
+	{
+		const double time = frame / 30.0;
+		const int camera = sets.GetTimelineCamera(time);
+
+		if (camera != current)
+		{
+			fnApply(current, camera);
+			current = camera;
+
+			currentCamera = (camera >= 0) ? (int) ((const char*) sets.GetCamera(camera) - cameraKeys.data() ) : -1;
+			fnCheck(currentCamera);
+		}
+
+		sets.StageAhead(time, 2);
+	}
+	fnCheck(currentCamera);
+
+	const int stagedHits = sets.GetNumberOfStagedHits();
+	const int computed = sets.GetNumberOfComputed();
+
+	// 2 - random jumps on the timeline without staging
+
+	for (int i=0; i<200; ++i)
+	{
+		const int cameraIndex = RandomInt(numberOfCameras + 1) - 1;
+		const int camera = (cameraIndex >= 0) ? sets.FindCamera(&cameraKeys[cameraIndex]) : CAMERA_LINKVIS_NONE;
+
+		fnApply(current, camera);
+		current = camera;
+
+		fnCheck( (camera >= 0) ? cameraIndex : -1 );
+	}
+
+	// the first cut of a playback is the only one which is not staged
+	const bool result = (0 == numberOfErrors && computed <= 1);
+
+	printf( "[CameraLinkVis] self test %s, %d cameras, %d items, %d errors, staged cuts %d, computed cuts %d, changed items %d of %d\n",
+		(result) ? "passed" : "FAILED", sets.GetNumberOfCameras(), sets.GetNumberOfItems(), numberOfErrors,
+		stagedHits, computed, numberOfChanges, numberOfFullChanges );
+
+	return result;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: camera_linkvis_sets.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+/*
+	Per camera visibility sets
+
+	every camera LinkedGroup is resolved once into a set of items (the group and its models).
+	 Items get an id and a set is a sorted id list, so a cut from one camera to another is a merge
+	 of two lists - items only in the outgoing set are hidden, items only in the incoming set are shown,
+	 shared items are not touched.
+
+	Cuts of a camera switcher are read from its timeline, transitions of the next cuts are staged
+	 ahead, so a cut only applies a ready list.
+
+	No SDK dependency, items and cameras are opaque keys (component pointers).
+*/
+
+// no camera, every linked item is hidden
+#define CAMERA_LINKVIS_NONE			-1
+// visibility state of items is not known, a transition touches every linked item
+#define CAMERA_LINKVIS_UNKNOWN		-2
+
+struct CameraLinkVisCut
+{
+	double		time;		// secs
+	int			camera;		// camera set index or CAMERA_LINKVIS_NONE
+};
+
+struct CameraLinkVisTransition
+{
+	std::vector<int>	hide;	// item ids
+	std::vector<int>	show;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class CameraLinkVisSets
+{
+public:
+
+	//! a constructor
+	CameraLinkVisSets();
+
+	void Clear();
+
+	//! items linked to the camera, returns camera set index
+	int AddCamera(const void *camera, const std::vector<const void*> &items);
+	//! sort sets after all cameras are added
+	void Build();
+
+	int GetNumberOfCameras() const { return (int) mCameras.size(); }
+	int GetNumberOfItems() const { return (int) mItems.size(); }
+
+	//! CAMERA_LINKVIS_NONE when the camera is not in the list
+	int FindCamera(const void *camera) const;
+	const void *GetCamera(const int index) const { return mCameras[index]; }
+	const void *GetItem(const int id) const { return mItems[id]; }
+	const std::vector<int> &GetSet(const int index) const { return mSets[index]; }
+
+	//! cuts sorted by time
+	void SetTimeline(const std::vector<CameraLinkVisCut> &cuts);
+	const std::vector<CameraLinkVisCut> &GetTimeline() const { return mTimeline; }
+
+	//! camera of the timeline at the time, CAMERA_LINKVIS_NONE before the first cut
+	int GetTimelineCamera(const double time) const;
+
+	//! prepare transitions of the next cuts after the time
+	void StageAhead(const double time, const int numberOfCuts);
+
+	//! changes to go from one camera set to another, staged or computed now
+	const CameraLinkVisTransition &GetTransition(const int from, const int to);
+
+	// statistics of GetTransition calls
+	int GetNumberOfStagedHits() const { return mNumberOfStagedHits; }
+	int GetNumberOfComputed() const { return mNumberOfComputed; }
+
+protected:
+
+	std::vector<const void*>				mCameras;
+	std::unordered_map<const void*, int>	mCameraIndices;
+
+	std::vector<const void*>				mItems;
+	std::unordered_map<const void*, int>	mItemIds;
+
+	std::vector<std::vector<int>>			mSets;		// sorted item ids per camera
+	std::vector<int>						mAllItems;	// 0, 1, .. n-1
+
+	std::vector<CameraLinkVisCut>			mTimeline;
+
+	std::unordered_map<uint64_t, CameraLinkVisTransition>	mTransitions;
+
+	int						mNumberOfStagedHits;
+	int						mNumberOfComputed;
+
+	const std::vector<int> &GetSetOrAll(const int index, const bool unknown) const;
+	void ComputeTransition(const int from, const int to, CameraLinkVisTransition &transition) const;
+	CameraLinkVisTransition &StageTransition(const int from, const int to, bool &computed);
+};
+
+//! synthetic cameras, groups and a cut timeline, transitions are compared with a full visibility update
+bool CameraLinkVisSelfTest();
@@ -41,7 +41,7 @@ struct FogData
 	float		near;
 	float		far;
 	
-	vec4		volumeInfo;		// x - number of volume models
+	vec4		volumeInfo;		// x - number of volume models, yzw - froxel grid size
 	
 	vec4		viewDir[4];
 	vec4		viewOrig[4];
@@ -349,6 +349,9 @@ subroutine uniform BlendTYPE BlendModeFunc[25];		// store each blend mode
 // NOTE: when using subroutines, no way to include blend functions, only direct implementation
 //#include "misc_blending.cs"
 #include "misc_masking.cs"
+#ifdef USE_VOLUME
+#include "misc_froxels.cs"
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -451,10 +454,11 @@ void main ()
 	
 	if (depth < 0.99)
 	{
-		int count = int(fogBuffer.data.volumeInfo.x);
-		for (int i=0; i<count; ++i)
+		// only volumes which overlap the pixel froxel, in the distance order
+		uvec2 froxel = FindFroxelRange(clip_space_pos, fogBuffer.data.volumeInfo.yzw, cameraNearPlane, cameraFarPlane);
+		for (uint i=0; i<froxel.y; ++i)
 		{
-			ComputeVolumeObject(outcolor, i, p);
+			ComputeVolumeObject(outcolor, int(froxelIndexBuffer.indices[froxel.x + i]), p);
 		}
 	}
 #else
@@ -0,0 +1,47 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: misc_froxels.cs
+//
+//	composition toolkit
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// volume lists per camera froxel, prepared by CompositeFroxelClusters
+//	x - offset in the index list, y - number of volumes
+
+layout (std430, binding = 2) buffer FroxelBuffer
+{
+	uvec2		froxels[];
+} froxelBuffer;
+
+layout (std430, binding = 3) buffer FroxelIndexBuffer
+{
+	uint		indices[];
+} froxelIndexBuffer;
+
+// the same lookup as CompositeFroxelClusters::FindFroxel
+//	gridSize - number of tiles in x, y and number of depth slices
+uvec2 FindFroxelRange(in vec4 clipPos, in vec3 gridSize, in float nearPlane, in float farPlane)
+{
+	ivec3 igridSize = ivec3(gridSize);
+	float w = max(0.0001, clipPos.w);
+	
+	vec2 ndc = clipPos.xy / w;
+	ivec2 tile = clamp( ivec2(floor((0.5 * ndc + 0.5) * gridSize.xy)), ivec2(0), igridSize.xy - ivec2(1) );
+	
+	int slice = 0;
+	if (w > nearPlane)
+	{
+		slice = int(floor( log(w / nearPlane) / log(farPlane / nearPlane) * gridSize.z ));
+		slice = min(slice, igridSize.z - 1);
+	}
+	
+	int index = (slice * igridSize.y + tile.y) * igridSize.x + tile.x;
+	return froxelBuffer.froxels[index];
+}
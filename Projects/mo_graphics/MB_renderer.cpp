@@ -2312,6 +2312,9 @@ void MoRendererCallback::Compositions_PrepDataExchange(CompositeFinalRenderDataE
 
 void MoRendererCallback::Compositions_EventBeforeRenderNotify()
 {
+	// compile permutations which are prepared on the scene load
+	CompositeComputeShader::CMixedProgramManager::instance().CompilePrepared();
+
 	const bool renderOnlyCurrent = mCompositionOptions.RenderOnlyCurrent();
 
 	for (auto iter=begin(mCompositionsVector); iter!=end(mCompositionsVector); ++iter)
@@ -46,6 +46,8 @@ void MoRendererCallback::EventFileNew(HISender pSender, HKEvent pEvent)
 
 	DYNAMIC_MASK_OPERATIONS::ChooseMask(nullptr);
 
+	// new scene has no list of shader permutations
+	CompositeComputeShader::CMixedProgramManager::instance().PrepareScene("");
 }
 
 void MoRendererCallback::EventFileOpen(HISender pSender, HKEvent pEvent)
@@ -69,6 +71,10 @@ void MoRendererCallback::EventFileOpenComplete(HISender pSender, HKEvent pEvent)
 {
 	// this is a hack to make RayCasting work with geometry gpu caches
 	ConvertAllBoxIntoGPUCacheObject();
+
+	// compute shader sources of the scene are ready before the first render
+	FBString sceneFilename( mApplication.FBXFileName );
+	CompositeComputeShader::CMixedProgramManager::instance().PrepareScene(sceneFilename);
 }
 
 void MoRendererCallback::EventSceneChange(HISender pSender, HKEvent pEvent)
@@ -498,6 +498,51 @@ const GLuint CompositeBackground::ComputeTexture(	const CCompositionInfo *pInfo,
 }
 
 
+uint64_t CompositeBackground::ComputeCacheHash(const int w, const int h)
+{
+	if (eCompositionInputRender == Input->AsInt() )
+		return 0;
+
+	const PropValues values(this);
+
+	const int params[5] = { (int) values.input, (values.useGradient) ? 1 : 0, w, h, (int) mBackgroundTextureId };
+	double colors[12];
+
+	for (int i=0; i<4; ++i)
+	{
+		colors[i] = values.background[i];
+		colors[4+i] = values.backgroundUpper[i];
+		colors[8+i] = values.backgroundLower[i];
+	}
+
+	uint64_t hash = CompositeHashBytes(params, sizeof(params), COMPOSITE_HASH_SEED);
+	hash = CompositeHashBytes(colors, sizeof(colors), hash);
+
+	// texture id of a clip stays the same, while an image sequence or a movie changes the content
+	if (eCompositionInputTexture == values.input && BackgroundTexture->GetCount() > 0)
+	{
+		FBTexture *pTexture = (FBTexture*) BackgroundTexture->GetAt(0);
+		FBVideo *pVideo = pTexture->Video;
+
+		// clip frame follows the scene time and the clip properties (offset, speed, loop)
+		if (nullptr != pVideo && FBIS(pVideo, FBVideoClip) )
+		{
+			FBTime localTime = FBSystem::TheOne().LocalTime;
+			const kLongLong frameTime = localTime.Get();
+
+			hash = CompositeHashProperties(pVideo, hash);
+			hash = CompositeHashBytes(&frameTime, sizeof(kLongLong), hash);
+		}
+		else if (nullptr != pVideo)
+		{
+			// video memory is written by other tools at any time
+			return 0;
+		}
+	}
+
+	return CompositeHashNonZero(hash);
+}
+
 void CompositeBackground::PrepBackgroundTextureData()
 {
 	
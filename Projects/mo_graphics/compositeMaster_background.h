@@ -18,6 +18,7 @@
 #include "compositeMaster_object.h"
 #include "compositeMaster_computeShaders.h"
 #include "compositeMaster_common.h"
+#include "compositeMaster_nodeCache.h"
 
 /////////////////////////////////////////////////////
 //
@@ -266,6 +267,9 @@ public:
 									const GLuint bufferTextureId, 
 									bool allowToReturnDirectTextureId );
 
+	// hash for the result cache, 0 for a render input, a video clip texture goes with the clip frame
+	uint64_t ComputeCacheHash(const int w, const int h);
+
 	const GLuint GetTextureId() const { return mBackgroundTextureId; }
 	const int GetTextureWidth() const { return mBackgroundTextureWidth; }
 	const int GetTextureHeight() const { return mBackgroundTextureHeight; }
@@ -0,0 +1,873 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_batch.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "compositeMaster_batch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+typedef std::chrono::high_resolution_clock	BatchClock;
+
+static double ElapsedMs(const BatchClock::time_point &from)
+{
+	return std::chrono::duration<double, std::milli>(BatchClock::now() - from).count();
+}
+
+static bool BatchFileExists(const char *filename)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (nullptr == fp)
+		return false;
+	fclose(fp);
+	return true;
+}
+
+static size_t ImageBytes(const CompositeCPUImage &image)
+{
+	return image.pixels.size() * sizeof(float);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// frame in flight and stage queues
+
+struct BatchItem
+{
+	int					slot;		// index in a frames and timings arrays
+	size_t				bytes;		// reserved memory budget
+	CompositeCPUImage	source;
+	CompositeCPUImage	result;
+};
+
+class BatchQueue
+{
+public:
+
+	//! a constructor
+	BatchQueue()
+		: mClosed(false)
+	{}
+
+	void Push(BatchItem *item)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mItems.push_back(item);
+		}
+		mCondition.notify_one();
+	}
+
+	// no more items
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mClosed = true;
+		}
+		mCondition.notify_all();
+	}
+
+	// false when queue is closed and empty
+	bool Pop(BatchItem *&item)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mCondition.wait(lock, [this]() { return mClosed || mItems.size() > 0; } );
+
+		if (mItems.size() == 0)
+			return false;
+
+		item = mItems.front();
+		mItems.pop_front();
+		return true;
+	}
+
+protected:
+
+	std::mutex					mMutex;
+	std::condition_variable		mCondition;
+	std::deque<BatchItem*>		mItems;
+	bool						mClosed;
+};
+
+class BatchMemoryBudget
+{
+public:
+
+	//! a constructor
+	BatchMemoryBudget(const size_t budget)
+		: mBudget(budget)
+		, mBytes(0)
+		, mCount(0)
+		, mPeakCount(0)
+	{}
+
+	// one frame is always allowed, otherwise wait until it fits
+	void Acquire(const size_t bytes)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mCondition.wait(lock, [this, bytes]() { return 0 == mCount || mBytes + bytes <= mBudget; } );
+
+		mBytes += bytes;
+		mCount += 1;
+		mPeakCount = std::max(mPeakCount, mCount);
+	}
+
+	// estimation has changed after the decode
+	void Adjust(const size_t reserved, const size_t bytes)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mBytes = mBytes - reserved + bytes;
+		}
+		mCondition.notify_all();
+	}
+
+	void Release(const size_t bytes, const bool frameIsDone)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mBytes -= bytes;
+			if (frameIsDone)
+				mCount -= 1;
+		}
+		mCondition.notify_all();
+	}
+
+	int GetPeakCount() const { return mPeakCount; }
+
+protected:
+
+	std::mutex					mMutex;
+	std::condition_variable		mCondition;
+
+	size_t						mBudget;
+	size_t						mBytes;
+	int							mCount;
+	int							mPeakCount;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeBatchProcessor
+
+CompositeBatchProcessor::CompositeBatchProcessor()
+	: mCancel(false)
+	, mPeakInFlight(0)
+	, mTotalMs(0.0)
+{
+	mDecodeFunc = [] (const CompositeBatchFrame &frame, CompositeCPUImage &image) -> bool {
+		return CompositeBatchReadTGA(frame.inputPath.c_str(), image);
+	};
+	mProcessFunc = [] (const CompositeBatchFrame &, const CompositeCPUImage &source, CompositeCPUImage &result) -> bool {
+		result = source;
+		return true;
+	};
+	mEncodeFunc = [] (const CompositeBatchFrame &frame, const CompositeCPUImage &image) -> bool {
+		return CompositeBatchWriteTGA(frame.outputPath.c_str(), image);
+	};
+}
+
+bool CompositeBatchProcessor::Run(const std::vector<CompositeBatchFrame> &frames, const CompositeBatchOptions &options)
+{
+	const BatchClock::time_point runStart = BatchClock::now();
+
+	mCancel = false;
+	mPeakInFlight = 0;
+	mTotalMs = 0.0;
+
+	mTimings.resize(frames.size());
+	for (size_t i=0; i<frames.size(); ++i)
+	{
+		CompositeBatchTiming &timing = mTimings[i];
+		timing.index = frames[i].index;
+		timing.status = eCompositeBatchPending;
+		timing.decodeMs = timing.processMs = timing.encodeMs = timing.waitMs = 0.0;
+	}
+
+	// resume
+
+	std::vector<int> doneFrames;
+	if (options.resume && options.manifestPath.length() > 0)
+	{
+		ReadManifest(options.manifestPath.c_str(), doneFrames);
+		std::sort(doneFrames.begin(), doneFrames.end() );
+	}
+
+	std::vector<int> todo;
+	todo.reserve(frames.size());
+
+	for (int i=0, count=(int) frames.size(); i<count; ++i)
+	{
+		const bool isDone = std::binary_search(doneFrames.begin(), doneFrames.end(), frames[i].index);
+
+		if (isDone && BatchFileExists(frames[i].outputPath.c_str()) )
+			mTimings[i].status = eCompositeBatchSkipped;
+		else
+			todo.push_back(i);
+	}
+
+	FILE *manifest = nullptr;
+	if (options.manifestPath.length() > 0)
+	{
+		const bool isNew = (false == options.resume) || (false == BatchFileExists(options.manifestPath.c_str()) );
+
+		manifest = fopen(options.manifestPath.c_str(), (isNew) ? "w" : "a");
+		if (nullptr == manifest)
+		{
+			printf("[CompositeBatch] failed to open a manifest %s\n", options.manifestPath.c_str() );
+		}
+		else if (isNew)
+		{
+			fprintf(manifest, "# composite batch manifest\n");
+			fflush(manifest);
+		}
+	}
+
+	// pipeline
+
+	BatchMemoryBudget	budget(options.memoryBudget);
+	BatchQueue			processQueue;
+	BatchQueue			encodeQueue;
+
+	std::thread decodeThread( [&] () {
+
+		size_t estimate = 0;	// sequence frames usually have the same size
+
+		for (auto iter=begin(todo); iter!=end(todo); ++iter)
+		{
+			if (mCancel)
+				break;
+
+			const int slot = *iter;
+			CompositeBatchTiming &timing = mTimings[slot];
+
+			BatchClock::time_point t = BatchClock::now();
+			budget.Acquire(estimate);
+			timing.waitMs = ElapsedMs(t);
+
+			BatchItem *item = new BatchItem();
+			item->slot = slot;
+			item->bytes = estimate;
+
+			t = BatchClock::now();
+			const bool isOk = mDecodeFunc(frames[slot], item->source) && false == item->source.IsEmpty();
+			timing.decodeMs = ElapsedMs(t);
+
+			if (false == isOk)
+			{
+				printf("[CompositeBatch] failed to decode frame %d - %s\n", frames[slot].index, frames[slot].inputPath.c_str() );
+
+				timing.status = eCompositeBatchFailed;
+				budget.Release(item->bytes, true);
+				delete item;
+				continue;
+			}
+
+			// source and result of the same size
+			const size_t bytes = 2 * ImageBytes(item->source);
+			budget.Adjust(item->bytes, bytes);
+			item->bytes = bytes;
+			estimate = bytes;
+
+			processQueue.Push(item);
+		}
+
+		processQueue.Close();
+	} );
+
+	std::thread processThread( [&] () {
+
+		BatchItem *item = nullptr;
+		while (processQueue.Pop(item) )
+		{
+			CompositeBatchTiming &timing = mTimings[item->slot];
+
+			const BatchClock::time_point t = BatchClock::now();
+			const bool isOk = mProcessFunc(frames[item->slot], item->source, item->result);
+			timing.processMs = ElapsedMs(t);
+
+			// source is not needed any more, let decoder go on
+			const size_t sourceBytes = ImageBytes(item->source);
+			std::vector<float>().swap(item->source.pixels);
+
+			if (false == isOk)
+			{
+				printf("[CompositeBatch] failed to process frame %d\n", frames[item->slot].index);
+
+				timing.status = eCompositeBatchFailed;
+				budget.Release(item->bytes, true);
+				delete item;
+				continue;
+			}
+
+			budget.Release(sourceBytes, false);
+			item->bytes -= sourceBytes;
+
+			encodeQueue.Push(item);
+		}
+
+		encodeQueue.Close();
+	} );
+
+	// encode on the calling thread
+
+	BatchItem *item = nullptr;
+	while (encodeQueue.Pop(item) )
+	{
+		const CompositeBatchFrame &frame = frames[item->slot];
+		CompositeBatchTiming &timing = mTimings[item->slot];
+
+		const BatchClock::time_point t = BatchClock::now();
+		const bool isOk = mEncodeFunc(frame, item->result);
+		timing.encodeMs = ElapsedMs(t);
+
+		if (isOk)
+		{
+			timing.status = eCompositeBatchDone;
+
+			// flush every line, so an interrupted run could be resumed
+			if (nullptr != manifest)
+			{
+				fprintf(manifest, "done %d %s\n", frame.index, frame.outputPath.c_str() );
+				fflush(manifest);
+			}
+		}
+		else
+		{
+			printf("[CompositeBatch] failed to encode frame %d - %s\n", frame.index, frame.outputPath.c_str() );
+			timing.status = eCompositeBatchFailed;
+		}
+
+		budget.Release(item->bytes, true);
+		delete item;
+	}
+
+	decodeThread.join();
+	processThread.join();
+
+	if (nullptr != manifest)
+		fclose(manifest);
+
+	mPeakInFlight = budget.GetPeakCount();
+	mTotalMs = ElapsedMs(runStart);
+
+	if (options.reportPath.length() > 0)
+		WriteReport(options.reportPath.c_str() );
+
+	return (0 == GetNumberOfFailed() );
+}
+
+int CompositeBatchProcessor::GetNumberOfDone() const
+{
+	int count = 0;
+	for (auto iter=begin(mTimings); iter!=end(mTimings); ++iter)
+		if (eCompositeBatchDone == iter->status)
+			count += 1;
+	return count;
+}
+
+int CompositeBatchProcessor::GetNumberOfSkipped() const
+{
+	int count = 0;
+	for (auto iter=begin(mTimings); iter!=end(mTimings); ++iter)
+		if (eCompositeBatchSkipped == iter->status)
+			count += 1;
+	return count;
+}
+
+int CompositeBatchProcessor::GetNumberOfFailed() const
+{
+	int count = 0;
+	for (auto iter=begin(mTimings); iter!=end(mTimings); ++iter)
+		if (eCompositeBatchFailed == iter->status)
+			count += 1;
+	return count;
+}
+
+static const char *BatchStatusToString(const ECompositeBatchStatus status)
+{
+	switch(status)
+	{
+	case eCompositeBatchPending: return "pending";
+	case eCompositeBatchDone: return "done";
+	case eCompositeBatchSkipped: return "skipped";
+	case eCompositeBatchFailed: return "failed";
+	}
+	return "unknown";
+}
+
+bool CompositeBatchProcessor::WriteReport(const char *filename) const
+{
+	FILE *fp = fopen(filename, "w");
+	if (nullptr == fp)
+	{
+		printf("[CompositeBatch] failed to write a report %s\n", filename);
+		return false;
+	}
+
+	fprintf(fp, "frame,status,decode ms,process ms,encode ms,wait ms\n");
+
+	for (auto iter=begin(mTimings); iter!=end(mTimings); ++iter)
+	{
+		fprintf(fp, "%d,%s,%.3f,%.3f,%.3f,%.3f\n", iter->index, BatchStatusToString(iter->status),
+			iter->decodeMs, iter->processMs, iter->encodeMs, iter->waitMs);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+void CompositeBatchProcessor::PrintReport() const
+{
+	double decodeMs = 0.0;
+	double processMs = 0.0;
+	double encodeMs = 0.0;
+
+	const int numberOfDone = GetNumberOfDone();
+
+	for (auto iter=begin(mTimings); iter!=end(mTimings); ++iter)
+	{
+		if (eCompositeBatchDone == iter->status)
+		{
+			decodeMs += iter->decodeMs;
+			processMs += iter->processMs;
+			encodeMs += iter->encodeMs;
+		}
+	}
+
+	printf("[CompositeBatch] done %d, skipped %d, failed %d, total %.1f s\n",
+		numberOfDone, GetNumberOfSkipped(), GetNumberOfFailed(), 0.001 * mTotalMs);
+
+	if (numberOfDone > 0)
+	{
+		const double f = 1.0 / (double) numberOfDone;
+		printf("[CompositeBatch] per frame - decode %.2f ms, process %.2f ms, encode %.2f ms, %.2f fps, peak frames in flight %d\n",
+			f * decodeMs, f * processMs, f * encodeMs, 1000.0 * numberOfDone / mTotalMs, mPeakInFlight);
+	}
+}
+
+bool CompositeBatchProcessor::ReadManifest(const char *filename, std::vector<int> &doneFrames)
+{
+	doneFrames.clear();
+
+	FILE *fp = fopen(filename, "r");
+	if (nullptr == fp)
+		return false;
+
+	char line[1024];
+	while (nullptr != fgets(line, sizeof(line), fp) )
+	{
+		if ('#' == line[0])
+			continue;
+
+		char status[16] = {0};
+		int index = 0;
+
+		if (2 == sscanf(line, "%15s %d", status, &index) && 0 == strcmp(status, "done") )
+			doneFrames.push_back(index);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// helpers
+
+bool CompositeBatchMakeSequence(const char *firstFile, const char *outputFolder, const int maxCount,
+	std::vector<CompositeBatchFrame> &frames)
+{
+	frames.clear();
+
+	if (nullptr == firstFile || false == BatchFileExists(firstFile) )
+	{
+		printf("[CompositeBatch] sequence file is not found - %s\n", (firstFile) ? firstFile : "");
+		return false;
+	}
+
+	const std::string path(firstFile);
+	const size_t slash = path.find_last_of("\\/");
+	const std::string dir = (slash == std::string::npos) ? "" : path.substr(0, slash+1);
+	const std::string name = (slash == std::string::npos) ? path : path.substr(slash+1);
+
+	std::string outDir(outputFolder);
+	if (outDir.length() > 0 && outDir.back() != '\\' && outDir.back() != '/')
+		outDir += (std::string::npos != outDir.find('/') ) ? '/' : '\\';
+
+	// last digit group in the name is a frame number
+
+	size_t digitsEnd = name.find_last_of("0123456789");
+	if (std::string::npos == digitsEnd)
+	{
+		CompositeBatchFrame frame;
+		frame.index = 0;
+		frame.inputPath = path;
+		frame.outputPath = outDir + name;
+		frames.push_back(frame);
+		return true;
+	}
+
+	size_t digitsStart = digitsEnd;
+	while (digitsStart > 0 && name[digitsStart-1] >= '0' && name[digitsStart-1] <= '9')
+		digitsStart -= 1;
+
+	const std::string prefix = name.substr(0, digitsStart);
+	const std::string suffix = name.substr(digitsEnd+1);
+	const int width = (int) (digitsEnd - digitsStart + 1);
+	const int start = atoi(name.substr(digitsStart, width).c_str() );
+
+	char number[32];
+
+	for (int index=start; 0 == maxCount || (int) frames.size() < maxCount; ++index)
+	{
+		sprintf_s(number, sizeof(number), "%0*d", width, index);
+		const std::string frameName = prefix + number + suffix;
+
+		CompositeBatchFrame frame;
+		frame.index = index;
+		frame.inputPath = dir + frameName;
+		frame.outputPath = outDir + frameName;
+
+		if (false == BatchFileExists(frame.inputPath.c_str()) )
+			break;
+
+		frames.push_back(frame);
+	}
+
+	return (frames.size() > 0);
+}
+
+#pragma pack(push, 1)
+struct BatchTGAHeader
+{
+	unsigned char	idLength;
+	unsigned char	colorMapType;
+	unsigned char	imageType;
+	unsigned short	colorMapStart;
+	unsigned short	colorMapLength;
+	unsigned char	colorMapDepth;
+	unsigned short	xOrigin;
+	unsigned short	yOrigin;
+	unsigned short	width;
+	unsigned short	height;
+	unsigned char	bitsPerPixel;
+	unsigned char	descriptor;
+};
+#pragma pack(pop)
+
+bool CompositeBatchReadTGA(const char *filename, CompositeCPUImage &image)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (nullptr == fp)
+		return false;
+
+	BatchTGAHeader header;
+	if (1 != fread(&header, sizeof(BatchTGAHeader), 1, fp) )
+	{
+		fclose(fp);
+		return false;
+	}
+
+	const bool isRLE = (header.imageType == 10 || header.imageType == 11);
+	const bool isGray = (header.imageType == 3 || header.imageType == 11);
+	const int bytesPerPixel = header.bitsPerPixel / 8;
+
+	const bool isSupported = (header.imageType == 2 || header.imageType == 3 || isRLE)
+		&& ( (isGray && bytesPerPixel == 1) || (false == isGray && (bytesPerPixel == 3 || bytesPerPixel == 4)) );
+
+	if (false == isSupported || header.width == 0 || header.height == 0)
+	{
+		printf("[CompositeBatch] unsupported tga format - %s\n", filename);
+		fclose(fp);
+		return false;
+	}
+
+	// skip id and color map
+	const long skip = header.idLength + header.colorMapType * header.colorMapLength * ((header.colorMapDepth + 7) / 8);
+	fseek(fp, skip, SEEK_CUR);
+
+	const int w = header.width;
+	const int h = header.height;
+	const size_t numPixels = (size_t) w * h;
+
+	std::vector<unsigned char> data(numPixels * bytesPerPixel);
+	bool isOk = true;
+
+	if (false == isRLE)
+	{
+		isOk = (data.size() == fread(data.data(), 1, data.size(), fp) );
+	}
+	else
+	{
+		unsigned char *dst = data.data();
+		size_t pixel = 0;
+
+		while (isOk && pixel < numPixels)
+		{
+			const int packet = fgetc(fp);
+			if (EOF == packet)
+			{
+				isOk = false;
+				break;
+			}
+
+			const size_t count = std::min( (size_t) (packet & 0x7F) + 1, numPixels - pixel );
+
+			if (packet & 0x80)
+			{
+				unsigned char value[4];
+				isOk = (1 == fread(value, bytesPerPixel, 1, fp) );
+
+				for (size_t i=0; isOk && i<count; ++i, dst += bytesPerPixel)
+					memcpy(dst, value, bytesPerPixel);
+			}
+			else
+			{
+				isOk = (count == fread(dst, bytesPerPixel, count, fp) );
+				dst += count * bytesPerPixel;
+			}
+
+			pixel += count;
+		}
+	}
+
+	fclose(fp);
+
+	if (false == isOk)
+	{
+		printf("[CompositeBatch] tga is truncated - %s\n", filename);
+		return false;
+	}
+
+	// to RGBA8, row 0 is a bottom row
+
+	const bool topOrigin = (header.descriptor & 0x20) != 0;
+	std::vector<unsigned char> rgba(numPixels * 4);
+
+	for (int y=0; y<h; ++y)
+	{
+		const unsigned char *src = data.data() + (size_t) y * w * bytesPerPixel;
+		unsigned char *dst = rgba.data() + (size_t) ((topOrigin) ? h-1-y : y) * w * 4;
+
+		for (int x=0; x<w; ++x, src += bytesPerPixel, dst += 4)
+		{
+			if (isGray)
+			{
+				dst[0] = dst[1] = dst[2] = src[0];
+				dst[3] = 255;
+			}
+			else
+			{
+				dst[0] = src[2];
+				dst[1] = src[1];
+				dst[2] = src[0];
+				dst[3] = (bytesPerPixel == 4) ? src[3] : 255;
+			}
+		}
+	}
+
+	image.FromRGBA8(rgba.data(), w, h);
+	return true;
+}
+
+bool CompositeBatchWriteTGA(const char *filename, const CompositeCPUImage &image)
+{
+	if (image.IsEmpty() || image.width > 0xFFFF || image.height > 0xFFFF)
+		return false;
+
+	const size_t numPixels = (size_t) image.width * image.height;
+	std::vector<unsigned char> data(numPixels * 4);
+
+	image.ToRGBA8(data.data() );
+
+	// RGBA -> BGRA
+	for (size_t i=0; i<numPixels; ++i)
+		std::swap(data[i*4], data[i*4+2]);
+
+	BatchTGAHeader header;
+	memset(&header, 0, sizeof(BatchTGAHeader));
+	header.imageType = 2;
+	header.width = (unsigned short) image.width;
+	header.height = (unsigned short) image.height;
+	header.bitsPerPixel = 32;
+	header.descriptor = 8;	// alpha bits, bottom left origin
+
+	FILE *fp = fopen(filename, "wb");
+	if (nullptr == fp)
+		return false;
+
+	bool isOk = (1 == fwrite(&header, sizeof(BatchTGAHeader), 1, fp) );
+	isOk = isOk && (data.size() == fwrite(data.data(), 1, data.size(), fp) );
+
+	fclose(fp);
+	return isOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// self test
+
+static void MakeBatchTestImage(CompositeCPUImage &image, const int index)
+{
+	const int w = 64;
+	const int h = 32;
+
+	std::vector<unsigned char> rgba((size_t) w * h * 4);
+
+	for (int y=0; y<h; ++y)
+		for (int x=0; x<w; ++x)
+		{
+			unsigned char *pixel = rgba.data() + ((size_t) y * w + x) * 4;
+			pixel[0] = (unsigned char) (x * 4);
+			pixel[1] = (unsigned char) (y * 8);
+			pixel[2] = (unsigned char) (index * 16);
+			pixel[3] = 255;
+		}
+
+	image.FromRGBA8(rgba.data(), w, h);
+}
+
+bool CompositeBatchSelfTest(const char *folder)
+{
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf("[CompositeBatch] test failed - %s\n", text);
+			numberOfErrors += 1;
+		}
+	};
+
+	const int numberOfFrames = 8;
+	const std::string prefix = std::string(folder) + "/composite_batch_test_";
+
+	std::vector<CompositeBatchFrame> frames(numberOfFrames);
+	char number[32];
+
+	for (int i=0; i<numberOfFrames; ++i)
+	{
+		sprintf_s(number, sizeof(number), "%04d", i);
+
+		frames[i].index = i;
+		frames[i].inputPath = std::string("synthetic_") + number;
+		frames[i].outputPath = prefix + number + ".tga";
+
+		remove(frames[i].outputPath.c_str() );
+	}
+
+	// synthetic frames in, inverted color channels out
+
+	std::atomic<int> numberOfDecodes(0);
+
+	CompositeBatchProcessor processor;
+
+	processor.SetDecodeFunc( [&numberOfDecodes] (const CompositeBatchFrame &frame, CompositeCPUImage &image) -> bool {
+		numberOfDecodes += 1;
+		MakeBatchTestImage(image, frame.index);
+		return true;
+	} );
+	processor.SetProcessFunc( [] (const CompositeBatchFrame &, const CompositeCPUImage &source, CompositeCPUImage &result) -> bool {
+		result = source;
+		for (size_t i=0; i<result.pixels.size(); i+=4)
+		{
+			result.pixels[i] = 1.0f - result.pixels[i];
+			result.pixels[i+1] = 1.0f - result.pixels[i+1];
+			result.pixels[i+2] = 1.0f - result.pixels[i+2];
+		}
+		return true;
+	} );
+
+	CompositeBatchOptions options;
+	options.memoryBudget = 1;		// one frame in flight
+	options.resume = false;
+	options.manifestPath = prefix + "manifest.txt";
+	options.reportPath = prefix + "timing.csv";
+
+	// 1 - all frames with a budget of one byte
+
+	fnCheck(processor.Run(frames, options), "first run");
+	fnCheck(processor.GetNumberOfDone() == numberOfFrames, "all frames are done");
+	fnCheck(processor.GetPeakFramesInFlight() == 1, "one frame in flight");
+	fnCheck(numberOfDecodes == numberOfFrames, "every frame is decoded");
+
+	std::vector<int> doneFrames;
+	fnCheck(CompositeBatchProcessor::ReadManifest(options.manifestPath.c_str(), doneFrames)
+		&& (int) doneFrames.size() == numberOfFrames, "manifest");
+
+	for (int i=0; i<numberOfFrames; ++i)
+	{
+		CompositeCPUImage source, result;
+		MakeBatchTestImage(source, i);
+
+		bool isEqual = CompositeBatchReadTGA(frames[i].outputPath.c_str(), result)
+			&& result.width == source.width && result.height == source.height;
+
+		for (size_t j=0; isEqual && j<source.pixels.size(); ++j)
+		{
+			const float expected = (3 == j % 4) ? source.pixels[j] : 1.0f - source.pixels[j];
+			isEqual = fabs(result.pixels[j] - expected) < 1.0f / 255.0f;
+		}
+
+		fnCheck(isEqual, "output image");
+	}
+
+	// 2 - resume skips all frames
+
+	options.resume = true;
+	numberOfDecodes = 0;
+
+	fnCheck(processor.Run(frames, options), "resume run");
+	fnCheck(processor.GetNumberOfSkipped() == numberOfFrames && numberOfDecodes == 0, "done frames are skipped");
+
+	// 3 - resume with a lost output file
+
+	remove(frames[3].outputPath.c_str() );
+	numberOfDecodes = 0;
+
+	fnCheck(processor.Run(frames, options), "resume with a lost output");
+	fnCheck(processor.GetNumberOfDone() == 1 && processor.GetNumberOfSkipped() == numberOfFrames-1
+		&& numberOfDecodes == 1, "lost output is processed again");
+
+	// 4 - failed decode doesn't stop other frames
+
+	options.resume = false;
+
+	processor.SetDecodeFunc( [] (const CompositeBatchFrame &frame, CompositeCPUImage &image) -> bool {
+		if (5 == frame.index)
+			return false;
+		MakeBatchTestImage(image, frame.index);
+		return true;
+	} );
+
+	fnCheck(false == processor.Run(frames, options), "run with a failed frame");
+	fnCheck(processor.GetNumberOfFailed() == 1 && processor.GetNumberOfDone() == numberOfFrames-1, "failed frame");
+
+	doneFrames.clear();
+	CompositeBatchProcessor::ReadManifest(options.manifestPath.c_str(), doneFrames);
+	fnCheck(doneFrames.end() == std::find(doneFrames.begin(), doneFrames.end(), 5), "failed frame is not in the manifest");
+
+	processor.PrintReport();
+
+	for (int i=0; i<numberOfFrames; ++i)
+		remove(frames[i].outputPath.c_str() );
+	remove(options.manifestPath.c_str() );
+	remove(options.reportPath.c_str() );
+
+	printf("[CompositeBatch] self test %s, %d errors\n", (0 == numberOfErrors) ? "passed" : "FAILED", numberOfErrors);
+	return 0 == numberOfErrors;
+}
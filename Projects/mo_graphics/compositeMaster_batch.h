@@ -0,0 +1,146 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_batch.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <atomic>
+#include "compositeMaster_cpuBackend.h"
+
+/*
+	Batch processing of an image sequence
+
+	three stages run on their own threads - decode, process and encode, so while frame N is
+	 processed, frame N+1 is decoded and frame N-1 is encoded. Stages are connected with queues,
+	 frames in flight are limited by a memory budget (at least one frame is always allowed).
+
+	Every encoded frame is appended to a manifest file, with resume on the frames from the manifest
+	 are skipped if their output file still exists. Per frame stage times go to a timing report.
+
+	Stages are callbacks, default decode / encode are uncompressed and RLE tga,
+	 default process is a copy. No SDK or GL dependency, synthetic frames could be fed from a test.
+*/
+
+struct CompositeBatchFrame
+{
+	int				index;			// frame number, used as a manifest key
+	std::string		inputPath;
+	std::string		outputPath;
+};
+
+struct CompositeBatchOptions
+{
+	size_t			memoryBudget;	// bytes for frames in flight, source and result images
+	bool			resume;			// skip frames which are done in the manifest
+	std::string		manifestPath;	// empty - no manifest
+	std::string		reportPath;		// empty - no timing report
+
+	//! a constructor
+	CompositeBatchOptions()
+		: memoryBudget(512 * 1024 * 1024)
+		, resume(true)
+	{}
+};
+
+enum ECompositeBatchStatus
+{
+	eCompositeBatchPending,
+	eCompositeBatchDone,
+	eCompositeBatchSkipped,		// done in a previous run
+	eCompositeBatchFailed
+};
+
+struct CompositeBatchTiming
+{
+	int						index;
+	ECompositeBatchStatus	status;
+
+	double					decodeMs;
+	double					processMs;
+	double					encodeMs;
+	double					waitMs;		// time frame was waiting for a memory budget
+};
+
+typedef std::function<bool(const CompositeBatchFrame &frame, CompositeCPUImage &image)>	CompositeBatchDecodeFunc;
+typedef std::function<bool(const CompositeBatchFrame &frame, const CompositeCPUImage &source, CompositeCPUImage &result)>	CompositeBatchProcessFunc;
+typedef std::function<bool(const CompositeBatchFrame &frame, const CompositeCPUImage &image)>	CompositeBatchEncodeFunc;
+
+//////////////////////////////////////////////////////////////////
+//
+
+class CompositeBatchProcessor
+{
+public:
+
+	//! a constructor
+	CompositeBatchProcessor();
+
+	void SetDecodeFunc(const CompositeBatchDecodeFunc &func) { mDecodeFunc = func; }
+	void SetProcessFunc(const CompositeBatchProcessFunc &func) { mProcessFunc = func; }
+	void SetEncodeFunc(const CompositeBatchEncodeFunc &func) { mEncodeFunc = func; }
+
+	//! blocks until all frames are done or cancelled, false if any frame has failed
+	bool Run(const std::vector<CompositeBatchFrame> &frames, const CompositeBatchOptions &options);
+
+	// could be called from another thread, frames in flight are finished
+	void Cancel() { mCancel = true; }
+
+	const std::vector<CompositeBatchTiming> &GetTimings() const { return mTimings; }
+
+	int GetNumberOfDone() const;
+	int GetNumberOfSkipped() const;
+	int GetNumberOfFailed() const;
+
+	// the biggest number of frames which were in flight at once
+	int GetPeakFramesInFlight() const { return mPeakInFlight; }
+	double GetTotalMs() const { return mTotalMs; }
+
+	bool WriteReport(const char *filename) const;
+	void PrintReport() const;
+
+	// frame indices with the done status
+	static bool ReadManifest(const char *filename, std::vector<int> &doneFrames);
+
+protected:
+
+	CompositeBatchDecodeFunc		mDecodeFunc;
+	CompositeBatchProcessFunc		mProcessFunc;
+	CompositeBatchEncodeFunc		mEncodeFunc;
+
+	std::atomic<bool>				mCancel;
+
+	std::vector<CompositeBatchTiming>	mTimings;
+	int								mPeakInFlight;
+	double							mTotalMs;
+};
+
+//////////////////////////////////////////////////////////////////
+// helpers
+
+//! frame list from the first file of a sequence, last digit group in a file name is a frame number
+/*!
+	files are collected while they exist, output file has the same name in the output folder
+
+	\param maxCount - 0 for no limit
+*/
+bool CompositeBatchMakeSequence(const char *firstFile, const char *outputFolder, const int maxCount,
+	std::vector<CompositeBatchFrame> &frames);
+
+// 24 and 32 bit, uncompressed and RLE
+bool CompositeBatchReadTGA(const char *filename, CompositeCPUImage &image);
+// 32 bit uncompressed
+bool CompositeBatchWriteTGA(const char *filename, const CompositeCPUImage &image);
+
+//! synthetic frames through the pipeline - one byte budget, manifest, resume and a failed frame,
+//!  output files are written into the folder and removed
+bool CompositeBatchSelfTest(const char *folder);
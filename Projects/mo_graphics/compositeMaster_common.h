@@ -204,6 +204,8 @@ enum ECompositionStats
 	eCompositionStatsDispatchGroups,
 	eCompositionStatsNumberOfTextures,
 	eCompositionStatsTexturesMemory,
+	eCompositionStatsCacheHits,
+	eCompositionStatsCacheMisses,
 	eCompositionStatsCount
 };
 
@@ -221,6 +223,9 @@ struct CompositeFinalStats
 
 			int		numberOfTextures;	// number of textures used by the composition
 			int		texturesMemory;		// (in bytes) allocated memory for the textures
+
+			int		cacheHits;			// nodes which results were taken from the result cache
+			int		cacheMisses;		// cacheable nodes which were evaluated
 		};
 	};
 
@@ -250,6 +255,12 @@ struct CompositeFinalStats
 		numberOfDispatchGroups += numgroups;
 	}
 
+	void	CountCache(const int hits, const int misses)
+	{
+		cacheHits += hits;
+		cacheMisses += misses;
+	}
+
 	void UpdateTextureMemoryMb()
 	{
 		texturesMemoryMb = 1.0 * (double)texturesMemory / 1048576.0;
@@ -16,14 +16,13 @@
 #include <iostream>
 #include <functional>
 #include <algorithm>
+#include <chrono>
 
 #include "IO\FileUtils.h"
 #include "graphics\CheckGLError_MOBU.h"
 
 using namespace CompositeComputeShader;
 
-#define	STR_PART_IDENT			"//-- PART:"
-
 #define DRAW_LOG_SHADER_VERTEX		"\\GLSL\\drawLog.vsh"
 #define DRAW_LOG_SHADER_FRAGMENT	"\\GLSL\\drawLog.fsh"
 
@@ -33,323 +32,8 @@ using namespace CompositeComputeShader;
 /////////////////////////////////////////////////////////////////////////////////////////////////
 //
 
-CShaderCodeHolder::CShaderCodeHolder()
-{
-	/*
-	mCodeBuffer = nullptr;
-	mCodeBufferSize = 0;
-	*/
-	mStatus = false;
-}
-
-void CShaderCodeHolder::Clear()
-{
-	/*
-	if (mCodeBuffer)
-	{
-		delete [] mCodeBuffer;
-		mCodeBuffer = nullptr;
-	}
-
-	mCodeBufferSize = 0;
-	*/
-	mCodeBuffer.clear();
-	mPartsMap.clear();
-	mStatus = false;
-
-	mIncludeVector.clear();
-}
-
-CShaderCodeHolder::~CShaderCodeHolder()
-{
-	Clear();
-}
-
-
-bool CShaderCodeHolder::LoadFromFilename(const char *filename)
-{
-	Clear();
-	mStatus = false;
-
-	FBString effectPath, effectFullName;
-	if (false == FindEffectLocation( filename, effectPath, effectFullName ) )
-		return false;
-
-	FILE *fp = nullptr;
-	fopen_s(&fp, effectFullName, "r");
-	if (fp)
-	{
-		fseek(fp, 0, SEEK_END);
-		size_t fileLen = ftell(fp);
-		fseek(fp, 0, SEEK_SET);
-
-		
-		mCodeBuffer.resize(fileLen + 1, 0);
-
-		// read shader from file
-		char *buffer = mCodeBuffer.data();
-		size_t readlen = fread_s(buffer, sizeof(char)*(fileLen+1), sizeof(char), fileLen, fp);
-		
-		// trick to zero all outside memory
-		
-		if (readlen == 0) //(readlen != len)
-		{
-			Clear();
-
-			//ERR("glsl shader file size" );
-			fclose(fp);
-			return false;
-		}
-		else
-		{
-			for (int i=readlen; i<fileLen; ++i)
-				buffer[i] = 0;
-		}
-
-		mFileName = filename;
-
-		fclose(fp);
-
-		//
-		//
-		PreparePartOffsets();
-		PrepareIncludeList();
-
-		mStatus = true;
-		return true;
-	}
-
-	return false;
-}
-
-bool CShaderCodeHolder::LoadFromBuffer(const char *filename, bool virtualFilename, const char *buffer, const size_t bufferLen)
-{
-	Clear();
-	mStatus = false;
-
-	mCodeBuffer.resize(bufferLen + 1, 0);
-
-	// read shader from file
-	
-	memcpy(mCodeBuffer.data(), buffer, bufferLen);
-
-	mFileName = filename;
-
-	//
-	//
-	PreparePartOffsets();
-	PrepareIncludeList();
-
-	mStatus = true;
-	return true;
-}
-
-void CShaderCodeHolder::PreparePartOffsets()
-{
-	mPartsMap.clear();
-	if (mCodeBuffer.size() < 1)
-		return;
-
-	// search for //-- PART: <name> \n
-
-	char *buffer = mCodeBuffer.data();
-	char *bufferEnd = mCodeBuffer.data() + (mCodeBuffer.size()-1);
-
-	char *searchPos = strstr(buffer, STR_PART_IDENT);
-
-	while (searchPos != nullptr)
-	{
-
-		// todo search for the end of a line (contains part name and end line symbol \n )
-		int linelen = 0;
-		char *pos = searchPos;
-		while (pos != bufferEnd && pos[0] != '\n')
-		{
-			linelen += 1;
-			pos++;
-		}
-
-		std::string strPart(&searchPos[10], linelen-1);
-		std::remove_if(strPart.begin(), strPart.end(), ::isspace);
-
-		std::hash<std::string> hash_fn;
-		size_t str_hash = hash_fn(strPart);
-		//
-		mPartsMap[str_hash] = searchPos;
-
-		// search for next part
-		buffer = &searchPos[1];
-		searchPos = strstr(buffer, STR_PART_IDENT);
-	}
-}
-
-void CShaderCodeHolder::PrepareIncludeList()
-{
-	char *buffer = mCodeBuffer.data();
-	char *bufferEnd = mCodeBuffer.data() + (mCodeBuffer.size()-1);
-
-	size_t beginAddress = (size_t) buffer;
-
-	char *commentBlock = strstr(buffer, "/*");
-	char *comment = strstr(buffer, "//");
-	char *include = strstr(buffer, "#include");
-
-	while (include != nullptr)
-	{
-
-		if (include)
-		{
-			bool skipThisIteration = false;
-
-			size_t includeAddr = (size_t) include - beginAddress;
-
-			if (commentBlock)
-			{
-				size_t commentBlockAddr = (size_t) commentBlock - beginAddress;
-
-				if (commentBlockAddr < includeAddr)
-				{
-					// skip comment block
-					buffer = commentBlock;
-					while (buffer != bufferEnd && buffer[0] != '*' && buffer[1] != '/')
-					{
-						buffer++;
-					}
-					skipThisIteration = true;
-				}
-			}
-			
-			if (comment)
-			{
-				size_t commentAddr = (size_t) comment - beginAddress;
-
-				if (commentAddr < includeAddr)
-				{
-					// skip comment line
-					buffer = comment;
-					while (buffer != bufferEnd && buffer[0] != '\n')
-					{
-						buffer++;
-					}
-					skipThisIteration = true;
-				}
-			}
-			
-
-			if (false == skipThisIteration)
-			{
-				//
-				// parse include up to the end of a line
-				buffer = include;
-
-				int linelen = 0;
-				char *pos = strstr(include, "\"");
-
-				if (pos != nullptr && pos != bufferEnd)
-				{
-					buffer = pos + 1;
-					pos = pos + 1;	// skip quote
-				}
-			
-				while (pos != nullptr && pos != bufferEnd && pos[0] != '\n' && pos[0] != '\"')
-				{
-					linelen += 1;
-					pos++;
-				}
-
-				if (linelen > 0)
-				{
-					std::string strLine(buffer, linelen);
-					std::remove_if(strLine.begin(), strLine.end(), ::isspace);
-			
-					// parse line to extract include name inside the brackets
-					mIncludeVector.push_back(strLine);
-				}
-			}
-		}
-
-
-		// try next iteration
-		commentBlock = strstr(buffer, "/*");
-		comment = strstr(buffer, "//");
-		include = strstr(buffer, "#include");
-	}
-}
-
-bool CShaderCodeHolder::Reload()
-{
-	if (mFileName.size() > 0)
-		return LoadFromFilename(mFileName.c_str() );
-
-	return false;
-}
-
-const char *CShaderCodeHolder::GetBufferPtr(size_t &bufferSize, const char *partName) const
-{
-	bufferSize = 0;
-
-	if (partName == nullptr || strlen(partName) == 0)
-	{
-		bufferSize = mCodeBuffer.size();
-		return mCodeBuffer.data();
-	}
-	else
-	{
-		std::hash<std::string> hash_fn;
-		size_t str_hash = hash_fn(partName);
-
-		auto partiter = mPartsMap.find(str_hash);
-		if (partiter != end(mPartsMap) )
-		{
-			char *bufferBegin = partiter->second;
-			char *bufferEnd = (char*) mCodeBuffer.data() + (mCodeBuffer.size()-1);
-
-			char *nextPartPos = strstr( &bufferBegin[1], STR_PART_IDENT );
-			if (nextPartPos != nullptr)
-				bufferEnd = nextPartPos;
-
-			size_t size = 0;
-
-			while (bufferEnd != bufferBegin)
-			{
-				size += 1;
-				bufferEnd--;
-			}
-
-			bufferSize = size;
-			return bufferBegin;
-		}
-	}
-
-	return nullptr;
-}
-
-const int CShaderCodeHolder::GetNumberOfParts() const
-{
-	return (int) mPartsMap.size();
-}
-
-/*
-const int CShaderCodeHolder::GetBufferSize(const char *partName) const
-{
-	return mCodeBufferSize;
-}
-*/
-
-const int CShaderCodeHolder::GetNumberOfIncludeFiles() const
-{
-	return (int) mIncludeVector.size();
-}
-
-const char *CShaderCodeHolder::GetIncludeFilename(const int index) const
-{
-	return mIncludeVector[index].c_str();
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMixedProgram::CMixedProgram(const size_t key, const GLuint shaderid, const GLuint programid)
-	: mCombinationKey(key)
+CMixedProgram::CMixedProgram(const CompositeShaderKey &key, const GLuint shaderid, const GLuint programid)
+	: mKey(key)
 	, mShader(shaderid)
 	, mProgram(programid)
 {
@@ -422,7 +106,61 @@ CMixedProgramManager::CMixedProgramManager()
 CMixedProgramManager::~CMixedProgramManager()
 {
 	//ChangeContext();
-	FreeCodeHolders();
+}
+
+static bool ReadShaderFile(const std::string &fullname, std::string &content)
+{
+	FILE *fp = nullptr;
+	fopen_s(&fp, fullname.c_str(), "rb");
+	if (nullptr == fp)
+		return false;
+
+	content.clear();
+
+	char buffer[4096];
+	size_t readlen = 0;
+	while ( (readlen = fread(buffer, sizeof(char), sizeof(buffer), fp) ) > 0)
+		content.append(buffer, readlen);
+
+	fclose(fp);
+	return true;
+}
+
+CompositeShaderPermutations &CMixedProgramManager::GetPermutations()
+{
+	if (nullptr == mPermutations.get() )
+	{
+		// the same search order as FindEffectLocation, folders are taken here on the main thread
+		//  because scene sources are read on worker threads
+		FBSystem &lSystem = FBSystem::TheOne();
+		FBString configPath( lSystem.UserConfigPath );
+
+		std::vector<std::string>	folders;
+		folders.push_back( (const char*) configPath );
+
+#ifndef ORSDK2013
+		FBStringList paths = lSystem.GetPluginPath();
+		for (int i=0; i<paths.GetCount(); ++i)
+			folders.push_back( paths[i] );
+#endif
+
+		auto fnRead = [folders] (const std::string &filename, std::string &content) -> bool {
+
+			for (auto iter=begin(folders); iter!=end(folders); ++iter)
+			{
+				if (true == ReadShaderFile(*iter + "\\" + filename, content) )
+					return true;
+			}
+			return false;
+		};
+
+		mPermutations.reset( new CompositeShaderPermutations(fnRead, mIncludeRootPath.c_str() ) );
+
+		FBString cacheFolder( configPath + "\\ShaderCache" );
+		mPermutations->SetCacheFolder(cacheFolder);
+	}
+
+	return *mPermutations.get();
 }
 
 bool CMixedProgramManager::checkCompileStatus(GLuint shader, const char *shadername)
@@ -553,17 +291,6 @@ void CMixedProgramManager::LoadDefaultShaders()
 
 }
 
-int CMixedProgramManager::MakeAKey(unsigned char header, unsigned char blendmode, unsigned char mask, unsigned char effect)
-{
-	int key = header;
-
-	key = key | (blendmode << 8);
-	key = key | (mask << 16);
-	key = key | (effect << 24);
-
-	return key;
-}
-
 void CMixedProgramManager::ChangeContext()
 {
 	// we have to recompile shaders from the beginning
@@ -580,7 +307,10 @@ void CMixedProgramManager::ChangeContext()
 	}
 
 	mMixedMap.clear();
-	mMixedToShaderCodeMap.clear();
+
+	// sources are still in memory, compile scene permutations up front again
+	mPreparedKeys = mSceneKeys;
+	mPreparedLabels = mSceneLabels;
 
 	if ( mDrawShader.get() != nullptr )
 	{
@@ -589,304 +319,78 @@ void CMixedProgramManager::ChangeContext()
 	}
 }
 
-const int CMixedProgramManager::PreLoadNewShaderCode(const char *filename, int &numberOfPreloadedParts)
+bool CMixedProgramManager::NewShaderCodeFromBuffer(const char *virtualFilename, const char *buffer, const size_t bufferLen)
 {
-	size_t hashKey = MakeAHashKey(filename);
-
-	int index = -1;
-	numberOfPreloadedParts = 0;
-
-	auto searchIter = mShaderCodeMap.find(hashKey);
-	if (searchIter == end(mShaderCodeMap) )
-	{
-		CShaderCodeHolder *newHolder = new CShaderCodeHolder();
-		
-		if (false == newHolder->LoadFromFilename(filename) )
-		{
-			delete newHolder;
-			return -1;
-		}
-
-		mShaderCodeVector.push_back(newHolder);
-		index = (int) mShaderCodeVector.size()-1;
-		mShaderCodeMap[hashKey] = index;
+	CompositeShaderPermutations &permutations = GetPermutations();
 
-		for (int i=0, count=newHolder->GetNumberOfIncludeFiles(); i<count; ++i)
-		{
-			std::string filepath(mIncludeRootPath);
-			filepath += newHolder->GetIncludeFilename(i);
-
-			PreLoadNewShaderCode( filepath.c_str(), numberOfPreloadedParts );
-		}
-	}
-	else
-	{
-		index = searchIter->second;
-
-		// TODO: update code here
-	}
+	if (false == permutations.SetVirtualFile(virtualFilename, buffer, bufferLen) )
+		return false;
 
-	numberOfPreloadedParts = mShaderCodeVector[index]->GetNumberOfParts();
+	std::vector<CompositeShaderKey> droppedKeys;
+	permutations.InvalidateFile(virtualFilename, droppedKeys);
 
-	return index;
+	RecompilePrograms(droppedKeys);
+	return true;
 }
 
-const int CMixedProgramManager::NewShaderCodeFromBuffer(const char *virtualFilename, const char *buffer, const size_t bufferLen, int &numberOfPreloadedParts)
+void CMixedProgramManager::MakeAKey(const char *header, const std::vector<CShaderQuery> &query, CompositeShaderKey &key)
 {
-	size_t hashKey = MakeAHashKey(virtualFilename);
-
-	int index = -1;
-	numberOfPreloadedParts = 0;
+	key.header = (header != nullptr) ? header : "";
+	key.parts.resize(query.size() );
 
-	auto searchIter = mShaderCodeMap.find(hashKey);
-	if (searchIter == end(mShaderCodeMap) )
+	for (size_t i=0; i<query.size(); ++i)
 	{
-		CShaderCodeHolder *newHolder = new CShaderCodeHolder();
-		
-		if (false == newHolder->LoadFromBuffer(virtualFilename, true, buffer, bufferLen) )
-		{
-			delete newHolder;
-			return -1;
-		}
-
-		mShaderCodeVector.push_back(newHolder);
-		index = (int) mShaderCodeVector.size()-1;
-		mShaderCodeMap[hashKey] = index;
-
-		// from buffer that is not possible I guess
-		/*
-		for (int i=0, count=newHolder->GetNumberOfIncludeFiles(); i<count; ++i)
-		{
-			std::string filepath(mIncludeRootPath);
-			filepath += newHolder->GetIncludeFilename(i);
-
-			PreLoadNewShaderCode( filepath.c_str(), numberOfPreloadedParts );
-		}
-		*/
+		key.parts[i].define = query[i].strDefine;
+		key.parts[i].filename = query[i].filename;
+		key.parts[i].partname = query[i].partname;
 	}
-	else
-	{
-		index = searchIter->second;
-
-		// DONE: update code here
-		CShaderCodeHolder *newHolder = mShaderCodeVector[index];
-		newHolder->LoadFromBuffer(virtualFilename, true, buffer, bufferLen);
-	}
-
-	numberOfPreloadedParts = mShaderCodeVector[index]->GetNumberOfParts();
-
-	return index;
 }
 
 CMixedProgram *CMixedProgramManager::QueryAProgramMix(const char *displayLabel, const char *header, const char *define, const char *filename, const char *partname)
 {
-	const size_t key = MakeAHashKey(define, filename, partname);
-
-	auto searchIter = mMixedMap.find(key);
-	if (searchIter == end(mMixedMap) )
-	{
-		std::vector<CShaderQuery>	query;
-		query.push_back( CShaderQuery(define, filename, partname) );
+	std::vector<CShaderQuery>	query;
+	query.push_back( CShaderQuery( (define) ? define : "", (filename) ? filename : "", (partname) ? partname : "") );
 
-		return MakeANewProgramMix(displayLabel, header, query);
-	}
-
-	return searchIter->second;
+	return QueryAProgramMix(displayLabel, header, query);
 }
 
 CMixedProgram *CMixedProgramManager::QueryAProgramMix(const char *displayLabel, const char *header, std::vector<CShaderQuery> &query)
 {
-
-	const size_t key = MakeAHashKey(query);
+	CompositeShaderKey key;
+	MakeAKey(header, query, key);
 
 	auto searchIter = mMixedMap.find(key);
 	if (searchIter == end(mMixedMap) )
 	{
-		return MakeANewProgramMix(displayLabel, header, query);
+		return MakeANewProgramMix(displayLabel, key);
 	}
 
 	return searchIter->second;
 }
 
-const size_t CMixedProgramManager::MakeAHashKey(const char *filename) const
-{
-	std::hash<std::string> hash_fn;
-	size_t str_hash = hash_fn(filename);
-
-	return str_hash;
-}
-
-const size_t CMixedProgramManager::MakeAHashKey(std::vector<CShaderQuery> &query) const
-{
-	std::string str_all("");
-
-	for (auto iter=begin(query); iter!=end(query); ++iter)
-	{
-		str_all += iter->strDefine;
-		str_all += iter->filename;
-		str_all += iter->partname;
-	}
-
-	std::hash<std::string> hash_fn;
-	size_t str_hash = hash_fn(str_all);
-
-	return str_hash;
-}
-
-const size_t CMixedProgramManager::MakeAHashKey(const char *define, const char *filename, const char *partname) const
+bool CMixedProgramManager::CompileProgramMix(CMixedProgram *mixedProgram)
 {
-	std::string str_all("");
-
-	if (define != nullptr)
-		str_all += define;
-	if (filename != nullptr)
-		str_all += filename;
-	if (partname != nullptr)
-		str_all += partname;
-
-	std::hash<std::string> hash_fn;
-	size_t str_hash = hash_fn(str_all);
-
-	return str_hash;
-}
-
-bool CMixedProgramManager::CompileProgramMix(CMixedProgram *mixedProgram, const char *displayLabel, const char *header, std::vector<CShaderQuery> &query)
-{
-	bool isSuccess=true;
 	mixedProgram->mStatus = false;
-	// buffer size
-
-	size_t bufferSize = 0;
-	if (header != nullptr && strlen(header) > 0)
-		bufferSize += strlen(header);
-
-	// check all the query files
-	std::vector<std::string>	filesToLoad;
-	std::vector<std::string>	includeVector;
-
-	for (auto iter=begin(query); iter!=end(query); ++iter)
-	{
-		size_t hash_key = MakeAHashKey(iter->filename.c_str() );
-
-		auto codeIter = mShaderCodeMap.find(hash_key);
-		int codeIndex = -1;
-
-		if (codeIter == end(mShaderCodeMap) )
-		{
-			// we should try to load a file
-			int numberOfPreloadedParts = 0;
-			codeIndex = PreLoadNewShaderCode(iter->filename.c_str(), numberOfPreloadedParts);
-		}
-		else
-			codeIndex = codeIter->second;
-
-		iter->fileCodeIndex = codeIndex;
-
-		if (codeIndex < 0)
-		{
-			isSuccess = false;
-			break;
-		}
-
-		size_t partBufferSize = 0;
-		mShaderCodeVector[codeIndex]->GetBufferPtr(partBufferSize, iter->partname.c_str() );
-
-		bufferSize = bufferSize + iter->strDefine.size(); // when symbol = char, then size = count
-		bufferSize = bufferSize + partBufferSize;
-	}
-
-	// if failed to load any of shader code
-	if (false == isSuccess)
-	{
-		return nullptr;
-	}
-
-	// allocate memory
-
-	char *mixbuffer = new char[bufferSize+1];
-	memset(mixbuffer, 0, sizeof(char) * (bufferSize+1) );
-
-	// fill mixbuffer with shader codes and defines
-	char *mixbufferPos = mixbuffer;
-
-	if (header != nullptr && strlen(header) > 0)
-	{
-		memcpy(mixbufferPos, header, sizeof(char) * strlen(header) );
-		mixbufferPos += strlen(header);
-	}
 
-	for (auto iter=begin(query); iter!=end(query); ++iter)
-	{
-		size_t hash_key = MakeAHashKey(iter->filename.c_str() );
-
-		auto codeIter = mShaderCodeMap.find(hash_key);
-		int codeIndex = -1;
-
-		if (codeIter != end(mShaderCodeMap) )
-		{
-			codeIndex = codeIter->second;
-		}
-
-		if(codeIndex == -1)
-			continue;
-
-		CShaderCodeHolder *pHolder = mShaderCodeVector[codeIndex];
-
-		memcpy(mixbufferPos, iter->strDefine.c_str(), iter->strDefine.size() );
-		mixbufferPos = mixbufferPos + iter->strDefine.size();
-
-		
-		size_t localBufferSize=0;
-		const char *localBuffer = pHolder->GetBufferPtr(localBufferSize);
+	// header, defines and parts with pasted includes
+	std::string error;
+	const CompositeShaderSource *source = GetPermutations().Query(mixedProgram->mKey, error);
 
-		memcpy(mixbufferPos, localBuffer, localBufferSize);
-		mixbufferPos = mixbufferPos + localBufferSize;
-
-		//
-		//
-		if (pHolder->GetNumberOfIncludeFiles() > 0)
-		{
-			for (int i=0, count=pHolder->GetNumberOfIncludeFiles(); i<count; ++i)
-			{
-				includeVector.push_back( pHolder->GetIncludeFilename(i) );
-			}
-		}
-	}
-
-	//
-	// check for include and pre-cache include shader codes
-	if (false == UploadProgramIncludeCodes( includeVector ) )
+	if (nullptr == source)
 	{
-		isSuccess = false;
-		mixedProgram->mStatus = false;
-	}
-
-	//
-	//
-	if (isSuccess)
-	{
-		if (false == loadComputeShaderFromBuffer(mixbuffer, mixedProgram->mDisplayLabel.c_str(), mixedProgram->GetShaderId(), mixedProgram->GetProgramId()) )
-		{
-			isSuccess = false;
-			mixedProgram->mStatus = false;
-		}
-		else
-		{
-			mixedProgram->mStatus = true;
-		}
+		std::cerr << mixedProgram->mDisplayLabel << " failed to preprocess: " << error << std::endl;
+		return false;
 	}
 
-	// free memory
-	if (mixbuffer)
+	if (true == loadComputeShaderFromBuffer(source->text.c_str(), mixedProgram->mDisplayLabel.c_str(), mixedProgram->GetShaderId(), mixedProgram->GetProgramId()) )
 	{
-		delete [] mixbuffer;
-		mixbuffer = nullptr;
+		mixedProgram->mStatus = true;
 	}
 
-	return isSuccess;
+	return mixedProgram->mStatus;
 }
 
-CMixedProgram *CMixedProgramManager::MakeANewProgramMix(const char *displayLabel, const char *header, std::vector<CShaderQuery> &query)
+CMixedProgram *CMixedProgramManager::MakeANewProgramMix(const char *displayLabel, const CompositeShaderKey &key)
 {
 	// compile a shader and make a new mixed program
 
@@ -898,171 +402,135 @@ CMixedProgram *CMixedProgramManager::MakeANewProgramMix(const char *displayLabel
 	CMixedProgram *newMix = nullptr;
 	if (programid > 0)
 	{
-		size_t key = MakeAHashKey(query);
 		newMix = new CMixedProgram(key, shaderid, programid);
 		newMix->mDisplayLabel = displayLabel;
-		newMix->mHeader = header;
 
 		mMixedMap[key] = newMix;
 
 		// compile and link mixed shader
-		CompileProgramMix(newMix, displayLabel, header, query);
-
-		newMix->mQuery = query;
-	}
+		CompileProgramMix(newMix);
 
-	return newMix;
-}
+		// remember a new permutation of the scene for the next load
+		if (newMix->IsOk() && mManifestFilename.size() > 0 
+			&& std::find(begin(mSceneKeys), end(mSceneKeys), key) == end(mSceneKeys) )
+		{
+			mSceneKeys.push_back(key);
+			mSceneLabels.push_back(displayLabel);
 
-void CMixedProgramManager::FreeCodeHolders()
-{
-	for (auto iter=begin(mShaderCodeVector); iter!=end(mShaderCodeVector); ++iter)
-	{
-		CShaderCodeHolder *pHolder = *iter;
-		
-		if (pHolder)
-			delete pHolder;
+			GetPermutations().SaveManifest(mManifestFilename.c_str(), mSceneKeys, mSceneLabels);
+		}
 	}
 
-	mShaderCodeVector.clear();
-	mShaderCodeMap.clear();
+	return newMix;
 }
 
-bool CMixedProgramManager::ReloadProgram(CMixedProgram *mixedProgram)
+void CMixedProgramManager::RecompilePrograms(const std::vector<CompositeShaderKey> &keys)
 {
 	std::vector<CMixedProgram*>	recompileVector;
 
-	for (auto queryIter=begin(mixedProgram->mQuery); queryIter!=end(mixedProgram->mQuery); ++queryIter)
+	for (auto iter=begin(keys); iter!=end(keys); ++iter)
 	{
-		CShaderCodeHolder *pHolder = mShaderCodeVector[queryIter->fileCodeIndex];
-
-		if (pHolder)
-		{
-			if (false == pHolder->Reload() )
-			{
-				return false;
-			}
+		auto programIter = mMixedMap.find(*iter);
+		if (programIter == end(mMixedMap) )
+			continue;
 
-			// TODO: reload all include files
-			for (int i=0, count=pHolder->GetNumberOfIncludeFiles(); i<count; ++i)
-			{
-				std::string strname(mIncludeRootPath);
-				strname += pHolder->GetIncludeFilename(i);
+		CMixedProgram *pMixedProgram = programIter->second;
+		if (std::find(begin(recompileVector), end(recompileVector), pMixedProgram) != end(recompileVector) )
+			continue;
 
-				size_t hash_key = MakeAHashKey( strname.c_str() );
+		recompileVector.push_back(pMixedProgram);
 
-				auto codeIter = mShaderCodeMap.find(hash_key);
-				int codeIndex = -1;
+		// recompile shader using the same key
+		pMixedProgram->ReCreateShaderObject();
+		CompileProgramMix(pMixedProgram);
+	}
+}
 
-				if (codeIter != end(mShaderCodeMap) )
-				{
-					codeIndex = codeIter->second;
-				}
+bool CMixedProgramManager::ReloadProgram(CMixedProgram *mixedProgram)
+{
+	CompositeShaderPermutations &permutations = GetPermutations();
 
-				if (codeIndex == -1)
-					return false;
+	// every file of the program source, or at least the query files when the source is failed
 
-				CShaderCodeHolder *pIncludeHolder = mShaderCodeVector[codeIndex];
-				if (false == pIncludeHolder->Reload() )
-				{
-					return false;
-				}
-			}
-		}
+	std::vector<std::string>	filesToReload;
+	std::string error;
 
-		for (auto iterPr=begin(mMixedMap); iterPr!=end(mMixedMap); ++iterPr)
-		{
-			CMixedProgram *iterProgram = iterPr->second;
-			auto recompileIter = std::find(begin(recompileVector), end(recompileVector), iterProgram);
+	const CompositeShaderSource *source = permutations.Query(mixedProgram->mKey, error);
 
-			if ( recompileIter==end(recompileVector) && iterProgram->HasShaderCode(queryIter->fileCodeIndex) )
-			{
-				recompileVector.push_back(iterPr->second);
-			}
-		}
+	if (nullptr != source)
+	{
+		for (auto iter=begin(source->dependencies); iter!=end(source->dependencies); ++iter)
+			filesToReload.push_back(iter->first);
 	}
-
-	//
-	for (auto iterPr=begin(recompileVector); iterPr!=end(recompileVector); ++iterPr)
+	else
 	{
-		CMixedProgram *pMixedProgram = *iterPr;
-		// recompile shader using the same define and shader codes
-		pMixedProgram->ReCreateShaderObject();
-		CompileProgramMix(pMixedProgram, "recompile mixed shaders", pMixedProgram->mHeader.c_str(), pMixedProgram->mQuery);
+		for (auto iter=begin(mixedProgram->mKey.parts); iter!=end(mixedProgram->mKey.parts); ++iter)
+			if (iter->filename.size() > 0)
+				filesToReload.push_back(iter->filename);
 	}
+
+	// all programs which use the files are recompiled
+
+	std::vector<CompositeShaderKey>	droppedKeys;
+	droppedKeys.push_back(mixedProgram->mKey);
+
+	for (auto iter=begin(filesToReload); iter!=end(filesToReload); ++iter)
+		permutations.InvalidateFile(*iter, droppedKeys);
+
+	RecompilePrograms(droppedKeys);
 	
-	return true;
+	return mixedProgram->IsOk();
 }
 
-bool CMixedProgramManager::UploadProgramIncludeCodes(const char *ShaderCodeName)
+void CMixedProgramManager::PrepareScene(const char *sceneFilename)
 {
-	size_t hash_key = MakeAHashKey( ShaderCodeName );
+	mSceneKeys.clear();
+	mSceneLabels.clear();
+	mPreparedKeys.clear();
+	mPreparedLabels.clear();
 
-	auto codeIter = mShaderCodeMap.find(hash_key);
-	int codeIndex = -1;
+	CompositeShaderPermutations &permutations = GetPermutations();
+	mManifestFilename = permutations.GetManifestFilename(sceneFilename);
 
-	if (codeIter != end(mShaderCodeMap) )
+	if (mManifestFilename.size() == 0 
+		|| false == permutations.LoadManifest(mManifestFilename.c_str(), mSceneKeys, mSceneLabels) )
 	{
-		codeIndex = codeIter->second;
+		return;
 	}
 
-	if (codeIndex == -1)
-		return false;
+	typedef std::chrono::high_resolution_clock clock;
+	const auto startTime = clock::now();
 
-	CShaderCodeHolder *pIncludeHolder = mShaderCodeVector[codeIndex];
-	
-	size_t bufferSize = 0;
-	const char *buffer = pIncludeHolder->GetBufferPtr(bufferSize);
+	const int numberOfHits = permutations.GetNumberOfCacheHits();
+	const int numberOfReady = permutations.Prepare(mSceneKeys);
 
-	if (bufferSize > 0)
-	{
-		std::string strname("/");
-		strname += ShaderCodeName;
+	const double ms = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
 
-		glNamedStringARB(GL_SHADER_INCLUDE_ARB, strname.length(), strname.c_str(), (GLint) bufferSize, buffer);
-		CHECK_GL_ERROR_MOBU();
-	}
+	printf( "[ShaderCache] scene permutations %d of %d are prepared in %.2f ms, %d from the disk cache\n",
+		numberOfReady, (int) mSceneKeys.size(), ms, permutations.GetNumberOfCacheHits() - numberOfHits );
 
-	return true;
+	mPreparedKeys = mSceneKeys;
+	mPreparedLabels = mSceneLabels;
 }
 
-bool CMixedProgramManager::UploadProgramIncludeCodes(const std::vector<std::string> &includeVector)
+void CMixedProgramManager::CompilePrepared()
 {
+	if (mPreparedKeys.size() == 0)
+		return;
 
-	for (auto iter=begin(includeVector); iter!=end(includeVector); ++iter)
-	{
-		std::string strname(mIncludeRootPath);
-		strname += *iter;
-
-		size_t hash_key = MakeAHashKey( strname.c_str() );
-
-		auto codeIter = mShaderCodeMap.find(hash_key);
-		int codeIndex = -1;
-
-		if (codeIter != end(mShaderCodeMap) )
-		{
-			codeIndex = codeIter->second;
-		}
-
-		if (codeIndex == -1)
-			return false;
-
-		CShaderCodeHolder *pIncludeHolder = mShaderCodeVector[codeIndex];
-	
-		size_t bufferSize = 0;
-		const char *buffer = pIncludeHolder->GetBufferPtr(bufferSize);
+	CompositeShaderPermutations &permutations = GetPermutations();
 
-		if (bufferSize > 0)
-		{
-			std::string strname("/");
-			strname += *iter;
+	for (size_t i=0; i<mPreparedKeys.size(); ++i)
+	{
+		// a failed source (missing generated code) is left for the query of the owner
+		if (mMixedMap.find(mPreparedKeys[i]) != end(mMixedMap) || false == permutations.HasSource(mPreparedKeys[i]) )
+			continue;
 
-			glNamedStringARB(GL_SHADER_INCLUDE_ARB, strname.length(), strname.c_str(), (GLint) bufferSize, buffer);
-			CHECK_GL_ERROR_MOBU();
-		}
+		MakeANewProgramMix(mPreparedLabels[i].c_str(), mPreparedKeys[i]);
 	}
 
-	return true;
+	mPreparedKeys.clear();
+	mPreparedLabels.clear();
 }
 
 GLSLShader *CMixedProgramManager::QueryLogDrawShader()
@@ -16,9 +16,11 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 
 #include "types.h"
 #include "graphics\GLSLShader.h"
+#include "compositeMaster_shaderCache.h"
 
 namespace CompositeComputeShader
 {
@@ -71,58 +73,6 @@ enum EMaskShaders
 	eShaderMaskCount
 };
 
-//////////////////////////////////////////////////////////////////////////////////////
-// shader file could contain several parts, we should specify the part name we want to use here
-class CShaderCodeHolder
-{
-
-public:
-
-	//! a constructor
-	CShaderCodeHolder();
-
-	//! a destructor
-	~CShaderCodeHolder();
-
-	bool LoadFromFilename(const char *filename);
-	bool LoadFromBuffer(const char *filename, bool virtualFilename, const char *buffer, const size_t bufferLen);
-	bool Reload();
-
-	void Clear();
-
-	const int GetNumberOfParts() const;
-	const char *GetBufferPtr(size_t &bufferSize, const char *partName=nullptr) const;
-	//const int GetBufferSize(const char *partName=nullptr) const;
-
-	bool	IsLoadedOk() const
-	{
-		return mStatus;
-	}
-
-	const int GetNumberOfIncludeFiles() const;
-	const char *GetIncludeFilename(const int index) const;
-
-protected:
-
-	bool				mStatus;
-
-	std::string			mFileName;
-	
-	// hash map part name to part offset
-	std::map<size_t, char*>	mPartsMap;
-
-	// code of a sub-shader
-	std::vector<char>	mCodeBuffer;
-
-	//size_t		mCodeBufferSize;
-	//char		*mCodeBuffer;
-
-	std::vector<std::string>	mIncludeVector;
-
-	void	PreparePartOffsets();
-	void	PrepareIncludeList();
-};
-
 //////////////////////////////////////////////////////////////////////////////////////
 //
 
@@ -154,8 +104,6 @@ struct CShaderQuery
 	std::string		filename;		// could be empty line for skipping file import
 	std::string		partname;
 
-	int				fileCodeIndex;
-
 	CShaderQuery()
 	{}
 
@@ -173,7 +121,7 @@ class CMixedProgram
 public:
 
 	//! a constructor
-	CMixedProgram(const size_t key, const GLuint shaderid, const GLuint programid);
+	CMixedProgram(const CompositeShaderKey &key, const GLuint shaderid, const GLuint programid);
 
 	//! a destructor
 	~CMixedProgram();
@@ -204,7 +152,7 @@ public:
 public:
 
 	// header, blend, mask, main codes
-	size_t			mCombinationKey;
+	CompositeShaderKey	mKey;
 
 	GLuint			mShader;
 	GLuint			mProgram;
@@ -219,20 +167,6 @@ public:
 	*/
 
 	std::string					mDisplayLabel;
-	std::string					mHeader;
-	std::vector<CShaderQuery>	mQuery;
-
-	bool HasShaderCode(const int codeIndex)
-	{
-		for (auto iter=begin(mQuery); iter!=end(mQuery); ++iter)
-		{
-			if (iter->fileCodeIndex == codeIndex)
-				return true;
-		}
-
-		return false;
-	}
-
 };
 
 
@@ -385,19 +319,19 @@ public:
 	void ChangeContext();
 
 	void FreeShaders();
-	void FreeCodeHolders();
 
-	// put a shader code into a buffer with specified index
-	//  pre-loaded shader could contain several parts inside, like header and main body
-	const int PreLoadNewShaderCode(const char *filename, int &numberOfPreloadedParts);
-	const int NewShaderCodeFromBuffer(const char *virtualFilename, const char *buffer, const size_t bufferLen, int &numberOfPreloadedParts);
-	// reload several shader codes starting from index 
-	//void ReloadShaderCode(const int index, const int count);
+	// generated shader code, could be included by a virtual filename
+	//  programs which include the code are recompiled when it is changed
+	bool NewShaderCodeFromBuffer(const char *virtualFilename, const char *buffer, const size_t bufferLen);
 
+	// read files of the program again and recompile every program which uses them
 	bool ReloadProgram(CMixedProgram *pMixedProgram);
 	
-	bool UploadProgramIncludeCodes(const char *ShaderCodeName );
-	bool UploadProgramIncludeCodes(const std::vector<std::string> &includeVector);
+	// load sources of the scene permutations in parallel, no GL calls
+	void PrepareScene(const char *sceneFilename);
+	// compile prepared scene permutations, should be called with a GL context
+	void CompilePrepared();
+
 public:
 
 	static bool checkCompileStatus(GLuint shader, const char *shadername);
@@ -416,35 +350,30 @@ protected:
 
 	std::string							mIncludeRootPath;
 
-	// store shader code
-	std::vector<CShaderCodeHolder*>		mShaderCodeVector;
-	std::map<size_t, int>				mShaderCodeMap;
-
-	//int									mShaderBlendModesIndices[eShaderBlendCount];
-	//int									mShaderMaskIndices[eShaderMaskCount];
-
-	// store preloaded combinations
-	std::map<size_t, CMixedProgram*>	mMixedMap;
+	// preprocessed sources with resolved includes, on disk between sessions
+	std::auto_ptr<CompositeShaderPermutations>	mPermutations;
 
-	// we need connection between mixed program and shader codes (to know what to reload)
-	// TODO: we need to update all program mixes when connected shader codes has updated
+	// store preloaded combinations, exact key of the header and queries
+	std::map<CompositeShaderKey, CMixedProgram*>	mMixedMap;
 
-	std::multimap<CMixedProgram*, int>		mMixedToShaderCodeMap;
+	// permutations used by the current scene
+	std::string							mManifestFilename;
+	std::vector<CompositeShaderKey>		mSceneKeys;
+	std::vector<std::string>			mSceneLabels;
 
-	// include shaders (key is a hash filename)
-	//	value is a shader
-	//std::map<size_t, GLuint>	mIncludeShadersMap;
+	// prepared, but not compiled yet
+	std::vector<CompositeShaderKey>		mPreparedKeys;
+	std::vector<std::string>			mPreparedLabels;
 
-	CMixedProgram	*MakeANewProgramMix(const char *displayLabel, const char *header, std::vector<CShaderQuery> &query);
+	CompositeShaderPermutations &GetPermutations();
 
-	bool CompileProgramMix(CMixedProgram *mixedProgram, const char *displayLabel, const char *header, std::vector<CShaderQuery> &query);
+	CMixedProgram	*MakeANewProgramMix(const char *displayLabel, const CompositeShaderKey &key);
 
-	int	MakeAKey(unsigned char header, unsigned char blendmode, unsigned char mask, unsigned char effect);
+	bool CompileProgramMix(CMixedProgram *mixedProgram);
 
-	const size_t MakeAHashKey(const char *filename) const;
-	const size_t MakeAHashKey(const char *define, const char *filename, const char *partname) const;
-	const size_t MakeAHashKey(std::vector<CShaderQuery> &query) const;
+	void RecompilePrograms(const std::vector<CompositeShaderKey> &keys);
 
+	static void MakeAKey(const char *header, const std::vector<CShaderQuery> &query, CompositeShaderKey &key);
 };
 
 };
\ No newline at end of file
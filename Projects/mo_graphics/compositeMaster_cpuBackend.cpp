@@ -0,0 +1,1167 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_cpuBackend.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "compositeMaster_cpuBackend.h"
+#include "algorithm\ParallelFor.h"
+
+#include <emmintrin.h>
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeCPUImage
+
+void CompositeCPUImage::Init(const int w, const int h)
+{
+	width = w;
+	height = h;
+	pixels.assign( (size_t) w * h * 4, 0.0f );
+}
+
+void CompositeCPUImage::Fill(const float r, const float g, const float b, const float a)
+{
+	const size_t count = (size_t) width * height;
+	float *dst = pixels.data();
+
+	for (size_t i=0; i<count; ++i, dst += 4)
+	{
+		dst[0] = r;
+		dst[1] = g;
+		dst[2] = b;
+		dst[3] = a;
+	}
+}
+
+void CompositeCPUImage::FromRGBA8(const unsigned char *data, const int w, const int h)
+{
+	Init(w, h);
+
+	const size_t count = (size_t) w * h * 4;
+	const float f = 1.0f / 255.0f;
+
+	for (size_t i=0; i<count; ++i)
+		pixels[i] = f * (float) data[i];
+}
+
+void CompositeCPUImage::ToRGBA8(unsigned char *data) const
+{
+	const size_t count = (size_t) width * height * 4;
+
+	for (size_t i=0; i<count; ++i)
+	{
+		float value = pixels[i];
+		value = (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+		data[i] = (unsigned char) (255.0f * value + 0.5f);
+	}
+}
+
+const char *CompositeCPUNodeToString(const ECompositeCPUNode type)
+{
+	switch(type)
+	{
+	case eCompositeCPUBlend: return "Blend";
+	case eCompositeCPUColorCorrection: return "Color Correction";
+	case eCompositeCPUBlur: return "Blur";
+	case eCompositeCPUPosterization: return "Posterization";
+	case eCompositeCPULUT: return "3d LUT";
+	default:
+		break;
+	}
+	return "Unknown";
+}
+
+CompositeCPUNode::CompositeCPUNode(const ECompositeCPUNode _type)
+	: type(_type)
+	, weight(1.0f)
+	, maskIndex(-1)
+	, maskChannel(0)
+	, invertMask(false)
+	, blendMode(eCompositeBlendNormal)
+	, wrapMode(eTextureWrapClampToEdge)
+	, sameSize(false)
+	, layerIndex(-1)
+	, rotation(0.0f)
+	, numberOfPasses(0)
+	, contrast(1.0f)
+	, saturation(1.0f)
+	, brightness(1.0f)
+	, gamma(1.0f)
+	, hue(0.0f)
+	, hueSaturation(0.0f)
+	, lightness(0.0f)
+	, inverse(false)
+	, numberOfColors(8.0f)
+	, lutSize(0)
+{
+	translation[0] = translation[1] = 0.0f;
+	scaling[0] = scaling[1] = 1.0f;
+	pivotOffset[0] = pivotOffset[1] = 0.5f;
+	blurScale[0] = blurScale[1] = 0.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// SSE helpers, one register is one RGBA pixel
+
+static inline __m128 Splat(const float value)
+{
+	return _mm_set1_ps(value);
+}
+
+static inline __m128 SplatW(const __m128 v)
+{
+	return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static inline __m128 Select(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps( _mm_and_ps(mask, a), _mm_andnot_ps(mask, b) );
+}
+
+static inline __m128 SetW(const __m128 v, const float w)
+{
+	const __m128 maskW = _mm_castsi128_ps( _mm_set_epi32(-1, 0, 0, 0) );
+	return Select(maskW, Splat(w), v);
+}
+
+// GLSL mix
+static inline __m128 Mix(const __m128 a, const __m128 b, const __m128 t)
+{
+	return _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps(b, a), t ) );
+}
+
+static inline __m128 Abs(const __m128 v)
+{
+	return _mm_andnot_ps( _mm_set1_ps(-0.0f), v );
+}
+
+static inline __m128 Saturate(const __m128 v)
+{
+	return _mm_min_ps( _mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f) );
+}
+
+// rgba8 image store
+static inline __m128 Quantize(const __m128 v)
+{
+	const __m128 scaled = _mm_mul_ps( Saturate(v), _mm_set1_ps(255.0f) );
+	return _mm_mul_ps( _mm_cvtepi32_ps( _mm_cvtps_epi32(scaled) ), _mm_set1_ps(1.0f / 255.0f) );
+}
+
+static inline __m128 FetchTexel(const CompositeCPUImage &image, const int x, const int y)
+{
+	return _mm_loadu_ps( image.pixels.data() + ((size_t) y * image.width + x) * 4 );
+}
+
+static inline int WrapTexel(const int i, const int size, const ETextureWrapMode mode)
+{
+	switch(mode)
+	{
+	case eTextureWrapRepeat:
+		{
+			const int r = i % size;
+			return (r < 0) ? r + size : r;
+		}
+	case eTextureWrapMirroredRepeat:
+		{
+			const int period = 2 * size;
+			int r = i % period;
+			if (r < 0)
+				r += period;
+			return (r < size) ? r : period - 1 - r;
+		}
+	case eTextureWrapClampToZero:
+	case eTextureWrapClampToEdge:
+		break;
+	}
+
+	// clamp to zero samples as clamp to edge, alpha is rejected in the blend
+	return (i < 0) ? 0 : ((i >= size) ? size - 1 : i);
+}
+
+static inline int FloorToInt(float value)
+{
+	const float limit = 16777216.0f;
+	value = (value < -limit) ? -limit : ((value > limit) ? limit : value);
+	return (int) floorf(value);
+}
+
+// GLSL texture()
+static __m128 SampleImage(const CompositeCPUImage &image, const float u, const float v, const ETextureWrapMode mode)
+{
+	const float x = u * (float) image.width;
+	const float y = v * (float) image.height;
+
+	if (false == image.linearFilter)
+	{
+		const int ix = WrapTexel( FloorToInt(x), image.width, mode );
+		const int iy = WrapTexel( FloorToInt(y), image.height, mode );
+		return FetchTexel(image, ix, iy);
+	}
+
+	const float fx = x - 0.5f;
+	const float fy = y - 0.5f;
+	const int ix = FloorToInt(fx);
+	const int iy = FloorToInt(fy);
+
+	const __m128 ax = Splat(fx - floorf(fx));
+	const __m128 ay = Splat(fy - floorf(fy));
+
+	const int x0 = WrapTexel(ix, image.width, mode);
+	const int x1 = WrapTexel(ix + 1, image.width, mode);
+	const int y0 = WrapTexel(iy, image.height, mode);
+	const int y1 = WrapTexel(iy + 1, image.height, mode);
+
+	const __m128 bottom = Mix( FetchTexel(image, x0, y0), FetchTexel(image, x1, y0), ax );
+	const __m128 top = Mix( FetchTexel(image, x0, y1), FetchTexel(image, x1, y1), ax );
+	return Mix(bottom, top, ay);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// per node evaluation context
+
+struct CompositeCPUContext
+{
+	const CompositeCPUNode		*node;
+	const CompositeCPUImage		*layer;
+	const CompositeCPUImage		*mask;
+
+	int							width;
+	int							height;
+	float						texelSize[2];
+};
+
+typedef void (*CompositeCPUSpanFunc)(const CompositeCPUContext &ctx, float *row, const int x0, const int x1, const int y);
+
+// misc_masking.cs
+static inline __m128 ApplyMask(const CompositeCPUContext &ctx, const float u, const float v, const __m128 srccolor, const __m128 dstcolor)
+{
+	float weight = ctx.node->weight;
+
+	if (nullptr != ctx.mask)
+	{
+		float maskValue[4];
+		_mm_storeu_ps( maskValue, SampleImage(*ctx.mask, u, v, eTextureWrapClampToEdge) );
+		weight *= fabsf( ((ctx.node->invertMask) ? 1.0f : 0.0f) - maskValue[ctx.node->maskChannel & 3] );
+	}
+
+	return Mix( srccolor, dstcolor, Splat(weight) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// blend modes, misc_blending.cs
+
+static inline __m128 BlendOverlayOp(const __m128 base, const __m128 blend)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	const __m128 low = _mm_mul_ps( _mm_mul_ps(two, base), blend );
+	const __m128 high = _mm_sub_ps( one, _mm_mul_ps( _mm_mul_ps(two, _mm_sub_ps(one, base)), _mm_sub_ps(one, blend) ) );
+	return Select( _mm_cmplt_ps(base, _mm_set1_ps(0.5f)), low, high );
+}
+
+static inline __m128 BlendColorDodgeOp(const __m128 base, const __m128 blend)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 value = _mm_min_ps( _mm_div_ps(base, _mm_sub_ps(one, blend)), one );
+	return Select( _mm_cmpeq_ps(blend, one), blend, value );
+}
+
+static inline __m128 BlendColorBurnOp(const __m128 base, const __m128 blend)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 value = _mm_max_ps( _mm_sub_ps(one, _mm_div_ps(_mm_sub_ps(one, base), blend)), zero );
+	return Select( _mm_cmpeq_ps(blend, zero), blend, value );
+}
+
+static inline __m128 BlendVividLightOp(const __m128 base, const __m128 blend)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	const __m128 burn = BlendColorBurnOp( base, _mm_mul_ps(two, blend) );
+	const __m128 dodge = BlendColorDodgeOp( base, _mm_mul_ps(two, _mm_sub_ps(blend, half)) );
+	return Select( _mm_cmplt_ps(blend, half), burn, dodge );
+}
+
+static inline __m128 BlendReflectOp(const __m128 base, const __m128 blend)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 value = _mm_min_ps( _mm_div_ps(_mm_mul_ps(base, base), _mm_sub_ps(one, blend)), one );
+	return Select( _mm_cmpeq_ps(blend, one), blend, value );
+}
+
+// switch is resolved at compile time for each span instance
+template<int MODE>
+static inline __m128 BlendOperation(const __m128 base, const __m128 blend)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	switch(MODE)
+	{
+	case eCompositeBlendNormal:
+		return blend;
+	case eCompositeBlendLighten:
+		return _mm_max_ps(blend, base);
+	case eCompositeBlendDarken:
+		return _mm_min_ps(blend, base);
+	case eCompositeBlendMultiply:
+		return _mm_mul_ps(base, blend);
+	case eCompositeBlendAverage:
+		return _mm_mul_ps( _mm_add_ps(base, blend), half );
+	case eCompositeBlendAdd:
+	case eCompositeBlendLinearDodge:
+		return _mm_min_ps( _mm_add_ps(base, blend), one );
+	case eCompositeBlendSubstract:
+	case eCompositeBlendLinearBurn:
+		return _mm_max_ps( _mm_sub_ps(_mm_add_ps(base, blend), one), zero );
+	case eCompositeBlendDifference:
+		return Abs( _mm_sub_ps(base, blend) );
+	case eCompositeBlendNegation:
+		return _mm_sub_ps( one, Abs(_mm_sub_ps(_mm_sub_ps(one, base), blend)) );
+	case eCompositeBlendExclusion:
+		return _mm_sub_ps( _mm_add_ps(base, blend), _mm_mul_ps(_mm_mul_ps(two, base), blend) );
+	case eCompositeBlendScreen:
+		return _mm_sub_ps( one, _mm_mul_ps(_mm_sub_ps(one, base), _mm_sub_ps(one, blend)) );
+	case eCompositeBlendOverlay:
+		return BlendOverlayOp(base, blend);
+	case eCompositeBlendSoftLight:
+		{
+			const __m128 low = _mm_add_ps( _mm_mul_ps(_mm_mul_ps(two, base), blend),
+				_mm_mul_ps(_mm_mul_ps(base, base), _mm_sub_ps(one, _mm_mul_ps(two, blend))) );
+			const __m128 high = _mm_add_ps( _mm_mul_ps(_mm_sqrt_ps(base), _mm_sub_ps(_mm_mul_ps(two, blend), one)),
+				_mm_mul_ps(_mm_mul_ps(two, base), _mm_sub_ps(one, blend)) );
+			return Select( _mm_cmplt_ps(blend, half), low, high );
+		}
+	case eCompositeBlendHardLight:
+		return BlendOverlayOp(blend, base);
+	case eCompositeBlendColorDodge:
+		return BlendColorDodgeOp(base, blend);
+	case eCompositeBlendColorBurn:
+		return BlendColorBurnOp(base, blend);
+	case eCompositeBlendLinearLight:
+		{
+			const __m128 burn = _mm_max_ps( _mm_sub_ps(_mm_add_ps(base, _mm_mul_ps(two, blend)), one), zero );
+			const __m128 dodge = _mm_min_ps( _mm_add_ps(base, _mm_mul_ps(two, _mm_sub_ps(blend, half))), one );
+			return Select( _mm_cmplt_ps(blend, half), burn, dodge );
+		}
+	case eCompositeBlendVividLight:
+		return BlendVividLightOp(base, blend);
+	case eCompositeBlendPinLight:
+		{
+			const __m128 darken = _mm_min_ps( _mm_mul_ps(two, blend), base );
+			const __m128 lighten = _mm_max_ps( _mm_mul_ps(two, _mm_sub_ps(blend, half)), base );
+			return Select( _mm_cmplt_ps(blend, half), darken, lighten );
+		}
+	case eCompositeBlendHardMix:
+		return Select( _mm_cmplt_ps(BlendVividLightOp(base, blend), half), zero, one );
+	case eCompositeBlendReflect:
+		return BlendReflectOp(base, blend);
+	case eCompositeBlendGlow:
+		return BlendReflectOp(blend, base);
+	case eCompositeBlendPhoenix:
+		return _mm_add_ps( _mm_sub_ps(_mm_min_ps(base, blend), _mm_max_ps(base, blend)), one );
+	}
+
+	return _mm_mul_ps(base, blend);
+}
+
+// blend.cs, with SAME_SIZE the layer is sampled at the pixel uv and the transform is not used
+template<int MODE>
+static void BlendSpan(const CompositeCPUContext &ctx, float *row, const int x0, const int x1, const int y)
+{
+	const CompositeCPUNode &node = *ctx.node;
+
+	const float sinFactor = sinf(node.rotation);
+	const float cosFactor = cosf(node.rotation);
+	const bool clampToZero = (node.wrapMode == eTextureWrapClampToZero);
+
+	const float v0 = ctx.texelSize[1] * (0.5f + (float) y);
+
+	for (int x=x0; x<x1; ++x)
+	{
+		float tu = ctx.texelSize[0] * (0.5f + (float) x);
+		float tv = v0;
+
+		// layer transformation
+		if (false == node.sameSize)
+		{
+			const float u = tu - node.pivotOffset[0];
+			const float v = tv - node.pivotOffset[1];
+
+			tu = u * cosFactor + v * sinFactor;
+			tv = -u * sinFactor + v * cosFactor;
+
+			tu = tu * node.scaling[0] + node.pivotOffset[0] + node.translation[0];
+			tv = tv * node.scaling[1] + node.pivotOffset[1] + node.translation[1];
+		}
+
+		float *pixel = row + x * 4;
+		const __m128 color1 = _mm_loadu_ps(pixel);
+		__m128 color2 = SampleImage(*ctx.layer, tu, tv, node.wrapMode);
+
+		if (clampToZero && (tu > 1.0f || tu < 0.0f || tv > 1.0f || tv < 0.0f) )
+			color2 = SetW(color2, 0.0f);
+
+		// BlendOpacity
+		const __m128 opacity = SplatW(color2);
+		const __m128 inverseOpacity = _mm_sub_ps( _mm_set1_ps(1.0f), opacity );
+
+		__m128 outcolor = _mm_add_ps( _mm_mul_ps(BlendOperation<MODE>(color1, color2), opacity), _mm_mul_ps(color1, inverseOpacity) );
+
+		for (int i=0; i<node.numberOfPasses; ++i)
+			outcolor = _mm_add_ps( _mm_mul_ps(BlendOperation<MODE>(outcolor, color2), opacity), _mm_mul_ps(outcolor, inverseOpacity) );
+
+		outcolor = SetW(outcolor, 1.0f);
+		_mm_storeu_ps( pixel, ApplyMask(ctx, tu, tv, color1, outcolor) );
+	}
+}
+
+static const CompositeCPUSpanFunc gBlendSpans[] = {
+	BlendSpan<eCompositeBlendNormal>,
+	BlendSpan<eCompositeBlendLighten>,
+	BlendSpan<eCompositeBlendDarken>,
+	BlendSpan<eCompositeBlendMultiply>,
+	BlendSpan<eCompositeBlendAverage>,
+	BlendSpan<eCompositeBlendAdd>,
+	BlendSpan<eCompositeBlendSubstract>,
+	BlendSpan<eCompositeBlendDifference>,
+	BlendSpan<eCompositeBlendNegation>,
+	BlendSpan<eCompositeBlendExclusion>,
+	BlendSpan<eCompositeBlendScreen>,
+	BlendSpan<eCompositeBlendOverlay>,
+	BlendSpan<eCompositeBlendSoftLight>,
+	BlendSpan<eCompositeBlendHardLight>,
+	BlendSpan<eCompositeBlendColorDodge>,
+	BlendSpan<eCompositeBlendColorBurn>,
+	BlendSpan<eCompositeBlendLinearDodge>,
+	BlendSpan<eCompositeBlendLinearBurn>,
+	BlendSpan<eCompositeBlendLinearLight>,
+	BlendSpan<eCompositeBlendVividLight>,
+	BlendSpan<eCompositeBlendPinLight>,
+	BlendSpan<eCompositeBlendHardMix>,
+	BlendSpan<eCompositeBlendReflect>,
+	BlendSpan<eCompositeBlendGlow>,
+	BlendSpan<eCompositeBlendPhoenix>
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// color correction, filterColor.cs
+
+static void RGBToHSL(const float *color, float *hsl)
+{
+	const float fmin = std::min( std::min(color[0], color[1]), color[2] );
+	const float fmax = std::max( std::max(color[0], color[1]), color[2] );
+	const float delta = fmax - fmin;
+
+	hsl[2] = (fmax + fmin) / 2.0f;
+
+	if (delta == 0.0f)
+	{
+		hsl[0] = 0.0f;
+		hsl[1] = 0.0f;
+		return;
+	}
+
+	if (hsl[2] < 0.5f)
+		hsl[1] = delta / (fmax + fmin);
+	else
+		hsl[1] = delta / (2.0f - fmax - fmin);
+
+	const float deltaR = (((fmax - color[0]) / 6.0f) + (delta / 2.0f)) / delta;
+	const float deltaG = (((fmax - color[1]) / 6.0f) + (delta / 2.0f)) / delta;
+	const float deltaB = (((fmax - color[2]) / 6.0f) + (delta / 2.0f)) / delta;
+
+	hsl[0] = 0.0f;
+
+	if (color[0] == fmax)
+		hsl[0] = deltaB - deltaG;
+	else if (color[1] == fmax)
+		hsl[0] = (1.0f / 3.0f) + deltaR - deltaB;
+	else if (color[2] == fmax)
+		hsl[0] = (2.0f / 3.0f) + deltaG - deltaR;
+
+	if (hsl[0] < 0.0f)
+		hsl[0] += 1.0f;
+	else if (hsl[0] > 1.0f)
+		hsl[0] -= 1.0f;
+}
+
+static float HueToRGB(const float f1, const float f2, float hue)
+{
+	if (hue < 0.0f)
+		hue += 1.0f;
+	else if (hue > 1.0f)
+		hue -= 1.0f;
+
+	if ((6.0f * hue) < 1.0f)
+		return f1 + (f2 - f1) * 6.0f * hue;
+	else if ((2.0f * hue) < 1.0f)
+		return f2;
+	else if ((3.0f * hue) < 2.0f)
+		return f1 + (f2 - f1) * ((2.0f / 3.0f) - hue) * 6.0f;
+
+	return f1;
+}
+
+static void HSLToRGB(const float *hsl, float *rgb)
+{
+	if (hsl[1] == 0.0f)
+	{
+		rgb[0] = rgb[1] = rgb[2] = hsl[2];
+		return;
+	}
+
+	float f2;
+
+	if (hsl[2] < 0.5f)
+		f2 = hsl[2] * (1.0f + hsl[1]);
+	else
+		f2 = (hsl[2] + hsl[1]) - (hsl[1] * hsl[2]);
+
+	const float f1 = 2.0f * hsl[2] - f2;
+
+	rgb[0] = HueToRGB(f1, f2, hsl[0] + (1.0f / 3.0f));
+	rgb[1] = HueToRGB(f1, f2, hsl[0]);
+	rgb[2] = HueToRGB(f1, f2, hsl[0] - (1.0f / 3.0f));
+}
+
+static void ColorCorrectionSpan(const CompositeCPUContext &ctx, float *row, const int x0, const int x1, const int y)
+{
+	const CompositeCPUNode &node = *ctx.node;
+
+	const __m128 lumCoeff = _mm_setr_ps(0.2125f, 0.7154f, 0.0721f, 0.0f);
+	const __m128 avgLumin = _mm_set1_ps(0.5f);
+	const __m128 brt = Splat(node.brightness);
+	const __m128 sat = Splat(node.saturation);
+	const __m128 con = Splat(node.contrast);
+	const float invGamma = 1.0f / node.gamma;
+	const float inverse = (node.inverse) ? 1.0f : 0.0f;
+
+	const float v = ctx.texelSize[1] * (0.5f + (float) y);
+
+	for (int x=x0; x<x1; ++x)
+	{
+		float *pixel = row + x * 4;
+		const __m128 srccolor = _mm_loadu_ps(pixel);
+
+		// ContrastSaturationBrightness
+		const __m128 brtColor = _mm_mul_ps(srccolor, brt);
+		__m128 dot = _mm_mul_ps(brtColor, lumCoeff);
+		dot = _mm_add_ps( dot, _mm_movehl_ps(dot, dot) );
+		dot = _mm_add_ss( dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1, 1, 1, 1)) );
+		const __m128 intensity = _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(0, 0, 0, 0));
+		const __m128 satColor = Mix(intensity, brtColor, sat);
+		const __m128 conColor = Mix(avgLumin, satColor, con);
+
+		float color[4], hsl[3];
+		_mm_storeu_ps(color, conColor);
+
+		for (int i=0; i<3; ++i)
+			color[i] = powf(color[i], invGamma);
+
+		RGBToHSL(color, hsl);
+		hsl[0] += node.hue;
+		hsl[1] += node.hueSaturation;
+		hsl[2] += node.lightness;
+		HSLToRGB(hsl, color);
+
+		const __m128 outcolor = _mm_setr_ps(
+			color[0] + (1.0f - 2.0f * color[0]) * inverse,
+			color[1] + (1.0f - 2.0f * color[1]) * inverse,
+			color[2] + (1.0f - 2.0f * color[2]) * inverse,
+			1.0f );
+
+		const float u = ctx.texelSize[0] * (0.5f + (float) x);
+		_mm_storeu_ps( pixel, ApplyMask(ctx, u, v, srccolor, outcolor) );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// filterPosterization.cs
+
+static void PosterizationSpan(const CompositeCPUContext &ctx, float *row, const int x0, const int x1, const int y)
+{
+	const CompositeCPUNode &node = *ctx.node;
+
+	const float gamma = node.gamma;
+	const float invGamma = 1.0f / gamma;
+	const float numColors = node.numberOfColors;
+
+	const float v = ctx.texelSize[1] * (0.5f + (float) y);
+
+	for (int x=x0; x<x1; ++x)
+	{
+		float *pixel = row + x * 4;
+		const __m128 srccolor = _mm_loadu_ps(pixel);
+
+		float c[4];
+		_mm_storeu_ps(c, srccolor);
+
+		for (int i=0; i<3; ++i)
+		{
+			float value = powf(c[i], gamma);
+			value = floorf(value * numColors) / numColors;
+			c[i] = powf(value, invGamma);
+		}
+
+		const float u = ctx.texelSize[0] * (0.5f + (float) x);
+		_mm_storeu_ps( pixel, ApplyMask(ctx, u, v, srccolor, _mm_loadu_ps(c)) );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// filterLUT.cs, trilinear lookup of the baked OCIO 3d texture
+
+static void LUTSpan(const CompositeCPUContext &ctx, float *row, const int x0, const int x1, const int y)
+{
+	const CompositeCPUNode &node = *ctx.node;
+
+	const int size = node.lutSize;
+	const float *lut = node.lut.data();
+	const float maxIndex = (float) (size - 1);
+
+	const float v = ctx.texelSize[1] * (0.5f + (float) y);
+
+	for (int x=x0; x<x1; ++x)
+	{
+		float *pixel = row + x * 4;
+		const __m128 srccolor = _mm_loadu_ps(pixel);
+
+		float c[4];
+		_mm_storeu_ps(c, srccolor);
+
+		// texel centers, color * (N-1)/N + 0.5/N in texture space
+		int i0[3], i1[3];
+		float f[3];
+
+		for (int i=0; i<3; ++i)
+		{
+			float t = c[i] * maxIndex;
+			t = (t < 0.0f) ? 0.0f : ((t > maxIndex) ? maxIndex : t);
+
+			i0[i] = (int) t;
+			i1[i] = std::min(i0[i] + 1, size - 1);
+			f[i] = t - (float) i0[i];
+		}
+
+		__m128 corners[8];
+		for (int i=0; i<8; ++i)
+		{
+			const int r = (i & 1) ? i1[0] : i0[0];
+			const int g = (i & 2) ? i1[1] : i0[1];
+			const int b = (i & 4) ? i1[2] : i0[2];
+			const float *entry = lut + 3 * (r + size * (g + size * b));
+			corners[i] = _mm_setr_ps(entry[0], entry[1], entry[2], 0.0f);
+		}
+
+		const __m128 fr = Splat(f[0]);
+		const __m128 fg = Splat(f[1]);
+		const __m128 fb = Splat(f[2]);
+
+		const __m128 c00 = Mix(corners[0], corners[1], fr);
+		const __m128 c10 = Mix(corners[2], corners[3], fr);
+		const __m128 c01 = Mix(corners[4], corners[5], fr);
+		const __m128 c11 = Mix(corners[6], corners[7], fr);
+		__m128 outcolor = Mix( Mix(c00, c10, fg), Mix(c01, c11, fg), fb );
+		outcolor = SetW(outcolor, c[3]);
+
+		const float u = ctx.texelSize[0] * (0.5f + (float) x);
+		_mm_storeu_ps( pixel, ApplyMask(ctx, u, v, srccolor, outcolor) );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// blur, filterBlur.cs
+
+// compute buffers are GL_NEAREST, so every tap of textureWithKernel lands on a texel with
+//  a constant offset for all pixels of the pass. Offsets are computed once and kernel is exact.
+
+#define BLUR_SAMPLES		15
+#define BLUR_TAPS			9
+
+static const float gBlurTapOffsets[BLUR_TAPS][2] = {
+	{ 0.0f, 0.0f },
+	{ 0.4f, 0.9f }, { -0.4f, -0.9f }, { -0.9f, 0.4f }, { 0.9f, -0.4f },
+	{ 0.9f, 1.9f }, { -0.9f, -1.9f }, { -1.9f, 0.9f }, { 1.9f, -0.9f }
+};
+
+static const float gBlurWeights[8] = {
+	0.134598f, 0.127325f, 0.107778f, 0.081638f, 0.055335f, 0.033562f, 0.018216f, 0.008847f
+};
+
+struct BlurKernel
+{
+	int		dx[BLUR_SAMPLES][BLUR_TAPS];
+	int		dy[BLUR_SAMPLES][BLUR_TAPS];
+	float	weight[BLUR_SAMPLES];
+
+	int		minDx;
+	int		maxDx;
+
+	void Prep(const float stepX, const float stepY)
+	{
+		minDx = 0;
+		maxDx = 0;
+
+		for (int s=0; s<BLUR_SAMPLES; ++s)
+		{
+			// center, then +k and -k
+			const int k = (s + 1) / 2;
+			const float sign = (s == 0 || (s & 1)) ? 1.0f : -1.0f;
+
+			weight[s] = gBlurWeights[k];
+
+			for (int t=0; t<BLUR_TAPS; ++t)
+			{
+				dx[s][t] = FloorToInt( 0.5f + sign * k * stepX + gBlurTapOffsets[t][0] );
+				dy[s][t] = FloorToInt( 0.5f + sign * k * stepY + gBlurTapOffsets[t][1] );
+
+				minDx = std::min(minDx, dx[s][t]);
+				maxDx = std::max(maxDx, dx[s][t]);
+			}
+		}
+	}
+};
+
+static void BlurPass(const CompositeCPUContext &ctx, const CompositeCPUImage &src, CompositeCPUImage &dst,
+	const float scaleX, const float scaleY, const CompositeCPUOptions &options)
+{
+	const int w = src.width;
+	const int h = src.height;
+
+	BlurKernel kernel;
+	kernel.Prep(scaleX * (float) w, scaleY * (float) h);
+
+	const int tileSize = std::max(8, options.tileSize);
+	const int tilesX = (w + tileSize - 1) / tileSize;
+	const int tilesY = (h + tileSize - 1) / tileSize;
+
+	ParallelFor(tilesX * tilesY, 1, [&] (const int first, const int last) {
+
+		const float *rows[BLUR_SAMPLES][BLUR_TAPS];
+		const __m128 fifth = _mm_set1_ps(0.2f);
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		for (int tile=first; tile<last; ++tile)
+		{
+			const int tx0 = (tile % tilesX) * tileSize;
+			const int ty0 = (tile / tilesX) * tileSize;
+			const int tx1 = std::min(tx0 + tileSize, w);
+			const int ty1 = std::min(ty0 + tileSize, h);
+
+			for (int y=ty0; y<ty1; ++y)
+			{
+				for (int s=0; s<BLUR_SAMPLES; ++s)
+					for (int t=0; t<BLUR_TAPS; ++t)
+					{
+						const int row = std::max(0, std::min(h - 1, y + kernel.dy[s][t]));
+						rows[s][t] = src.pixels.data() + (size_t) row * w * 4;
+					}
+
+				float *dstRow = dst.pixels.data() + (size_t) y * w * 4;
+				const float v = ctx.texelSize[1] * (0.5f + (float) y);
+
+				for (int x=tx0; x<tx1; ++x)
+				{
+					const bool inside = (x + kernel.minDx >= 0 && x + kernel.maxDx < w);
+
+					__m128 sum = _mm_setzero_ps();
+					__m128 srccolor = _mm_setzero_ps();
+
+					for (int s=0; s<BLUR_SAMPLES; ++s)
+					{
+						__m128 taps[BLUR_TAPS];
+
+						for (int t=0; t<BLUR_TAPS; ++t)
+						{
+							int col = x + kernel.dx[s][t];
+							if (false == inside)
+								col = std::max(0, std::min(w - 1, col));
+							taps[t] = _mm_loadu_ps(rows[s][t] + col * 4);
+						}
+
+						const __m128 color = _mm_mul_ps( fifth, _mm_add_ps(_mm_add_ps(_mm_add_ps(taps[0], taps[1]), _mm_add_ps(taps[2], taps[3])), taps[4]) );
+						const __m128 color2 = _mm_mul_ps( fifth, _mm_add_ps(_mm_add_ps(_mm_add_ps(taps[0], taps[5]), _mm_add_ps(taps[6], taps[7])), taps[8]) );
+
+						const __m128 mask = Saturate( SplatW(color2) );
+						__m128 result = _mm_add_ps( _mm_mul_ps(color, mask), _mm_mul_ps(color2, _mm_sub_ps(one, mask)) );
+						result = Select( _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)), mask, result );
+
+						if (0 == s)
+							srccolor = result;
+
+						sum = _mm_add_ps( sum, _mm_mul_ps(result, Splat(kernel.weight[s])) );
+					}
+
+					const float u = ctx.texelSize[0] * (0.5f + (float) x);
+					__m128 outcolor = ApplyMask(ctx, u, v, srccolor, sum);
+
+					if (options.quantize)
+						outcolor = Quantize(outcolor);
+
+					_mm_storeu_ps(dstRow + x * 4, outcolor);
+				}
+			}
+		}
+
+	}, options.numberOfThreads);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeCPUGraph
+
+CompositeCPUGraph::CompositeCPUGraph()
+{}
+
+void CompositeCPUGraph::Clear()
+{
+	mNodes.clear();
+	mLayers.clear();
+	mMasks.clear();
+}
+
+int CompositeCPUGraph::AddNode(const CompositeCPUNode &node)
+{
+	mNodes.push_back(node);
+	return (int) mNodes.size() - 1;
+}
+
+int CompositeCPUGraph::AddLayerImage(const CompositeCPUImage *image)
+{
+	mLayers.push_back(image);
+	return (int) mLayers.size() - 1;
+}
+
+void CompositeCPUGraph::SetLayerImage(const int index, const CompositeCPUImage *image)
+{
+	if (index >= 0 && index < (int) mLayers.size() )
+		mLayers[index] = image;
+}
+
+int CompositeCPUGraph::AddMaskImage(const CompositeCPUImage *image)
+{
+	mMasks.push_back(image);
+	return (int) mMasks.size() - 1;
+}
+
+void CompositeCPUGraph::SetMaskImage(const int index, const CompositeCPUImage *image)
+{
+	if (index >= 0 && index < (int) mMasks.size() )
+		mMasks[index] = image;
+}
+
+bool CompositeCPUGraph::Execute(const CompositeCPUImage &background, CompositeCPUImage &result, const CompositeCPUOptions &options) const
+{
+	if (background.IsEmpty() )
+	{
+		printf( "[CompositeCPU] background image is empty\n" );
+		return false;
+	}
+
+	result = background;
+	result.linearFilter = false;
+
+	return ExecuteNodes(mNodes, result, options);
+}
+
+bool CompositeCPUGraph::ExecuteNodes(const std::vector<CompositeCPUNode> &nodes, CompositeCPUImage &image, const CompositeCPUOptions &options) const
+{
+	const int w = image.width;
+	const int h = image.height;
+
+	const int tileSize = std::max(8, options.tileSize);
+	const int tilesX = (w + tileSize - 1) / tileSize;
+	const int tilesY = (h + tileSize - 1) / tileSize;
+
+	CompositeCPUContext baseCtx;
+	baseCtx.node = nullptr;
+	baseCtx.layer = nullptr;
+	baseCtx.mask = nullptr;
+	baseCtx.width = w;
+	baseCtx.height = h;
+	baseCtx.texelSize[0] = 1.0f / (float) w;
+	baseCtx.texelSize[1] = 1.0f / (float) h;
+
+	// layers with own filters, reserved to keep pointers stable
+	std::vector<CompositeCPUImage>	filteredLayers;
+	filteredLayers.reserve(nodes.size() );
+
+	std::vector<CompositeCPUContext>	contexts;
+	std::vector<CompositeCPUSpanFunc>	spans;
+	CompositeCPUImage					temp;
+
+	const int count = (int) nodes.size();
+	int i = 0;
+
+	while (i < count)
+	{
+		if (eCompositeCPUBlur == nodes[i].type)
+		{
+			const CompositeCPUNode &node = nodes[i];
+
+			CompositeCPUContext ctx(baseCtx);
+			ctx.node = &node;
+			if (node.maskIndex >= 0 && node.maskIndex < (int) mMasks.size() )
+				ctx.mask = mMasks[node.maskIndex];
+
+			const float horz = node.blurScale[0];
+			const float vert = node.blurScale[1];
+
+			if (horz != 0.0f || vert != 0.0f)
+			{
+				temp.Init(w, h);
+
+				if (horz == 0.0f || vert == 0.0f)
+				{
+					BlurPass(ctx, image, temp, horz, vert, options);
+					std::swap(image.pixels, temp.pixels);
+				}
+				else
+				{
+					BlurPass(ctx, image, temp, horz, 0.0f, options);
+					BlurPass(ctx, temp, image, 0.0f, vert, options);
+				}
+			}
+
+			++i;
+			continue;
+		}
+
+		// collect a run of per pixel nodes and evaluate it tile by tile
+
+		contexts.clear();
+		spans.clear();
+
+		int last = i;
+		for ( ; last < count && eCompositeCPUBlur != nodes[last].type; ++last)
+		{
+			const CompositeCPUNode &node = nodes[last];
+
+			CompositeCPUContext ctx(baseCtx);
+			ctx.node = &node;
+			if (node.maskIndex >= 0 && node.maskIndex < (int) mMasks.size() )
+				ctx.mask = mMasks[node.maskIndex];
+
+			CompositeCPUSpanFunc span = nullptr;
+
+			switch(node.type)
+			{
+			case eCompositeCPUBlend:
+				if (node.layerIndex >= 0 && node.layerIndex < (int) mLayers.size()
+					&& nullptr != mLayers[node.layerIndex] && false == mLayers[node.layerIndex]->IsEmpty() )
+				{
+					ctx.layer = mLayers[node.layerIndex];
+
+					if (node.layerFilters.size() > 0)
+					{
+						filteredLayers.push_back(*ctx.layer);
+						ExecuteNodes(node.layerFilters, filteredLayers.back(), options);
+						ctx.layer = &filteredLayers.back();
+					}
+
+					if (node.blendMode >= eCompositeBlendNormal && node.blendMode <= eCompositeBlendPhoenix)
+						span = gBlendSpans[node.blendMode];
+				}
+				else
+				{
+					printf( "[CompositeCPU] blend node %d has no layer image, skipped\n", last );
+				}
+				break;
+			case eCompositeCPUColorCorrection:
+				span = ColorCorrectionSpan;
+				break;
+			case eCompositeCPUPosterization:
+				span = PosterizationSpan;
+				break;
+			case eCompositeCPULUT:
+				if (node.lutSize > 0 && node.lut.size() >= (size_t) 3 * node.lutSize * node.lutSize * node.lutSize)
+					span = LUTSpan;
+				break;
+			default:
+				// blur is a separate pass, it ends the group
+				break;
+			}
+
+			if (nullptr != span)
+			{
+				contexts.push_back(ctx);
+				spans.push_back(span);
+			}
+		}
+
+		if (contexts.size() > 0)
+		{
+			const int numberOfSpans = (int) spans.size();
+
+			ParallelFor(tilesX * tilesY, 1, [&] (const int first, const int lastTile) {
+
+				for (int tile=first; tile<lastTile; ++tile)
+				{
+					const int tx0 = (tile % tilesX) * tileSize;
+					const int ty0 = (tile / tilesX) * tileSize;
+					const int tx1 = std::min(tx0 + tileSize, w);
+					const int ty1 = std::min(ty0 + tileSize, h);
+
+					for (int n=0; n<numberOfSpans; ++n)
+					{
+						for (int y=ty0; y<ty1; ++y)
+						{
+							float *row = image.pixels.data() + (size_t) y * w * 4;
+							spans[n](contexts[n], row, tx0, tx1, y);
+
+							if (options.quantize)
+							{
+								for (float *pixel = row + tx0 * 4, *end = row + tx1 * 4; pixel != end; pixel += 4)
+									_mm_storeu_ps( pixel, Quantize(_mm_loadu_ps(pixel)) );
+							}
+						}
+					}
+				}
+
+			}, options.numberOfThreads);
+		}
+
+		i = last;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+
+static void MakeBenchmarkImage(CompositeCPUImage &image, const int w, const int h, const unsigned int seed)
+{
+	image.Init(w, h);
+
+	unsigned int state = seed;
+	float *dst = image.pixels.data();
+
+	for (int y=0; y<h; ++y)
+		for (int x=0; x<w; ++x, dst += 4)
+		{
+			state = state * 1664525u + 1013904223u;
+			const float noise = (float) (state >> 8) / 16777216.0f;
+
+			dst[0] = (float) x / (float) w;
+			dst[1] = (float) y / (float) h;
+			dst[2] = noise;
+			dst[3] = 0.5f + 0.5f * noise;
+		}
+}
+
+void CompositeCPUBenchmark(const int width, const int height, const int iterations, const CompositeCPUOptions &options,
+	std::vector<CompositeCPUBenchmarkResult> &results)
+{
+	results.clear();
+
+	if (width <= 0 || height <= 0 || iterations <= 0)
+		return;
+
+	CompositeCPUImage background, layer, mask, result;
+	MakeBenchmarkImage(background, width, height, 1);
+	MakeBenchmarkImage(layer, width, height, 2);
+	MakeBenchmarkImage(mask, width, height, 3);
+
+	struct BenchmarkCase
+	{
+		const char			*name;
+		CompositeCPUNode	node;
+	};
+
+	std::vector<BenchmarkCase>	cases;
+	BenchmarkCase	item;
+
+	item.name = "Blend Normal";
+	item.node = CompositeCPUNode(eCompositeCPUBlend);
+	item.node.layerIndex = 0;
+	item.node.weight = 0.75f;
+	cases.push_back(item);
+
+	item.name = "Blend SoftLight";
+	item.node.blendMode = eCompositeBlendSoftLight;
+	item.node.rotation = 0.3f;
+	cases.push_back(item);
+
+	item.name = "Blend Masked";
+	item.node.blendMode = eCompositeBlendOverlay;
+	item.node.maskIndex = 0;
+	cases.push_back(item);
+
+	item.name = "Color Correction";
+	item.node = CompositeCPUNode(eCompositeCPUColorCorrection);
+	item.node.contrast = 1.2f;
+	item.node.saturation = 0.8f;
+	item.node.brightness = 1.1f;
+	item.node.gamma = 0.9f;
+	item.node.hue = 0.1f;
+	cases.push_back(item);
+
+	item.name = "Blur";
+	item.node = CompositeCPUNode(eCompositeCPUBlur);
+	item.node.blurScale[0] = 0.002f;
+	item.node.blurScale[1] = 0.002f;
+	cases.push_back(item);
+
+	item.name = "Posterization";
+	item.node = CompositeCPUNode(eCompositeCPUPosterization);
+	item.node.numberOfColors = 8.0f;
+	item.node.gamma = 0.6f;
+	cases.push_back(item);
+
+	item.name = "3d LUT";
+	item.node = CompositeCPUNode(eCompositeCPULUT);
+	item.node.lutSize = 32;
+	item.node.lut.resize(3 * 32 * 32 * 32);
+	for (int b=0; b<32; ++b)
+		for (int g=0; g<32; ++g)
+			for (int r=0; r<32; ++r)
+			{
+				float *entry = item.node.lut.data() + 3 * (r + 32 * (g + 32 * b));
+				entry[0] = sqrtf(r / 31.0f);
+				entry[1] = g / 31.0f;
+				entry[2] = (b / 31.0f) * (b / 31.0f);
+			}
+	cases.push_back(item);
+
+	const double megaPixels = 1.0e-6 * width * height * iterations;
+
+	for (auto iter=begin(cases); iter!=end(cases); ++iter)
+	{
+		CompositeCPUGraph graph;
+		graph.AddLayerImage(&layer);
+		graph.AddMaskImage(&mask);
+		graph.AddNode(iter->node);
+
+		// warm up
+		graph.Execute(background, result, options);
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (int i=0; i<iterations; ++i)
+			graph.Execute(background, result, options);
+		const auto stop = std::chrono::high_resolution_clock::now();
+
+		const double seconds = std::chrono::duration<double>(stop - start).count();
+
+		CompositeCPUBenchmarkResult benchResult;
+		benchResult.name = iter->name;
+		benchResult.megaPixelsPerSecond = (seconds > 0.0) ? megaPixels / seconds : 0.0;
+		results.push_back(benchResult);
+
+		printf( "[CompositeCPU] %-18s %9.1f MP/s\n", benchResult.name, benchResult.megaPixelsPerSecond );
+	}
+}
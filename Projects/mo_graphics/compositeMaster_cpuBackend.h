@@ -0,0 +1,187 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_cpuBackend.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include "compositeMaster_types.h"
+
+/*
+	CPU backend for the composition graph
+
+	evaluates blend layers, color correction, blur, posterization and 3d LUT the same way as
+	 blend.cs, filterColor.cs, filterBlur.cs, filterPosterization.cs, filterLUT.cs and misc_masking.cs do,
+	 so a composition could be computed without GL context (farm nodes, regression tests).
+
+	Image is split into tiles and tiles are processed on ParallelFor, a pixel is one SSE register.
+	Consecutive per pixel nodes are evaluated together for a tile while it's in cache,
+	 blur needs neighbours, so it's a separate pass over the image.
+	By default every node result is rounded to 8 bits like rgba8 compute buffers on GPU.
+
+	No SDK or GL dependency, ObjectComposition::BuildCPUGraph converts a scene composition into nodes.
+*/
+
+struct CompositeCPUImage
+{
+	int					width;
+	int					height;
+	bool				linearFilter;	// texture() sampling, compute buffers are GL_NEAREST
+	std::vector<float>	pixels;			// RGBA, row 0 is a bottom row, like in OpenGL
+
+	//! a constructor
+	CompositeCPUImage()
+		: width(0)
+		, height(0)
+		, linearFilter(false)
+	{}
+
+	void Init(const int w, const int h);
+	void Fill(const float r, const float g, const float b, const float a);
+
+	void FromRGBA8(const unsigned char *data, const int w, const int h);
+	void ToRGBA8(unsigned char *data) const;
+
+	bool IsEmpty() const { return width <= 0 || height <= 0; }
+};
+
+enum ECompositeCPUNode
+{
+	eCompositeCPUBlend,
+	eCompositeCPUColorCorrection,
+	eCompositeCPUBlur,
+	eCompositeCPUPosterization,
+	eCompositeCPULUT,
+	eCompositeCPUNodeCount
+};
+
+const char *CompositeCPUNodeToString(const ECompositeCPUNode type);
+
+// values are in the units of shader uniforms, not in the units of node properties
+struct CompositeCPUNode
+{
+	ECompositeCPUNode		type;
+
+	float					weight;			// opacity
+	int						maskIndex;		// graph mask image, -1 without a mask
+	int						maskChannel;	// composite masks A-D are channels of one mask image
+	bool					invertMask;
+
+	// blend layer
+
+	ECompositeBlendType		blendMode;
+	ETextureWrapMode		wrapMode;
+	bool					sameSize;		// SAME_SIZE define of blend.cs, no layer transform. Layers compile blend.cs without it
+	int						layerIndex;		// graph layer image
+	float					translation[2];	// uv
+	float					rotation;		// radians
+	float					scaling[2];		// inverted scale, as it goes to the shader
+	float					pivotOffset[2];	// uv
+	int						numberOfPasses;
+
+	std::vector<CompositeCPUNode>	layerFilters;	// processed on a layer image before blending
+
+	// color correction (gCSB, gHue), posterization uses gamma as well
+
+	float					contrast;
+	float					saturation;
+	float					brightness;
+	float					gamma;
+	float					hue;
+	float					hueSaturation;
+	float					lightness;
+	bool					inverse;
+
+	// blur, uv distance between kernel taps
+
+	float					blurScale[2];
+
+	// posterization
+
+	float					numberOfColors;
+
+	// 3d LUT, RGB float, red changes fastest
+
+	int						lutSize;
+	std::vector<float>		lut;
+
+	//! a constructor
+	CompositeCPUNode(const ECompositeCPUNode _type=eCompositeCPUBlend);
+};
+
+struct CompositeCPUOptions
+{
+	int		tileSize;
+	int		numberOfThreads;	// 0 for hardware concurrency
+	bool	quantize;			// round and clamp every node result to 8 bits like GPU does
+
+	//! a constructor
+	CompositeCPUOptions()
+		: tileSize(64)
+		, numberOfThreads(0)
+		, quantize(true)
+	{}
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class CompositeCPUGraph
+{
+public:
+
+	//! a constructor
+	CompositeCPUGraph();
+
+	void Clear();
+
+	int AddNode(const CompositeCPUNode &node);
+
+	int GetNodeCount() const { return (int) mNodes.size(); }
+	const CompositeCPUNode &GetNode(const int index) const { return mNodes[index]; }
+	CompositeCPUNode &GetNode(const int index) { return mNodes[index]; }
+
+	// input images are not owned by the graph
+
+	int AddLayerImage(const CompositeCPUImage *image=nullptr);
+	void SetLayerImage(const int index, const CompositeCPUImage *image);
+	int GetLayerCount() const { return (int) mLayers.size(); }
+
+	int AddMaskImage(const CompositeCPUImage *image=nullptr);
+	void SetMaskImage(const int index, const CompositeCPUImage *image);
+
+	//! run nodes in order on top of a background, result has a background size
+	bool Execute(const CompositeCPUImage &background, CompositeCPUImage &result, const CompositeCPUOptions &options) const;
+
+protected:
+
+	std::vector<CompositeCPUNode>			mNodes;
+	std::vector<const CompositeCPUImage*>	mLayers;
+	std::vector<const CompositeCPUImage*>	mMasks;
+
+	bool ExecuteNodes(const std::vector<CompositeCPUNode> &nodes, CompositeCPUImage &image, const CompositeCPUOptions &options) const;
+};
+
+//////////////////////////////////////////////////////////////////
+// benchmark
+
+struct CompositeCPUBenchmarkResult
+{
+	const char		*name;
+	double			megaPixelsPerSecond;
+};
+
+//! time every node type on synthetic images and print MP/s
+void CompositeCPUBenchmark(const int width, const int height, const int iterations, const CompositeCPUOptions &options,
+	std::vector<CompositeCPUBenchmarkResult> &results);
+
+//! every node type against a scalar port of the compute shaders (compositeMaster_cpuReference.cpp),
+//!  results have to match within one 8 bit step like GPU output, prints results into the log
+bool CompositeCPUReferenceSelfTest();
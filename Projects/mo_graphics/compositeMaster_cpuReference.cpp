@@ -0,0 +1,673 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_cpuReference.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "compositeMaster_cpuBackend.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+/*
+	Reference check of the CPU backend
+
+	a scalar port of the compute shaders, one pixel at a time and line by line with GLSL - texture() with
+	 GL_NEAREST or GL_LINEAR, rgba8 store of every dispatch, no SSE, tiles or fused nodes.
+	The backend has to stay within the GPU tolerance of one 8 bit step on every blend mode,
+	 wrap mode, filter and on a chain of nodes.
+*/
+
+#define CPU_REFERENCE_TOLERANCE		1.01f		// in 8 bit steps
+
+struct RefColor
+{
+	float	v[4];
+};
+
+static int RefWrap(const int i, const int size, const ETextureWrapMode mode)
+{
+	if (eTextureWrapRepeat == mode)
+	{
+		const int r = i % size;
+		return (r < 0) ? r + size : r;
+	}
+	else if (eTextureWrapMirroredRepeat == mode)
+	{
+		const int period = 2 * size;
+		int r = i % period;
+		if (r < 0)
+			r += period;
+		return (r < size) ? r : period - 1 - r;
+	}
+	return std::max(0, std::min(size-1, i) );
+}
+
+// texture()
+static RefColor RefTexture(const CompositeCPUImage &image, const float u, const float v, const ETextureWrapMode mode)
+{
+	RefColor result;
+
+	if (false == image.linearFilter)
+	{
+		const int x = RefWrap( (int) floorf(u * image.width), image.width, mode );
+		const int y = RefWrap( (int) floorf(v * image.height), image.height, mode );
+		const float *texel = image.pixels.data() + ((size_t) y * image.width + x) * 4;
+
+		for (int c=0; c<4; ++c)
+			result.v[c] = texel[c];
+		return result;
+	}
+
+	const float fx = u * image.width - 0.5f;
+	const float fy = v * image.height - 0.5f;
+	const int ix = (int) floorf(fx);
+	const int iy = (int) floorf(fy);
+	const float ax = fx - floorf(fx);
+	const float ay = fy - floorf(fy);
+
+	auto fnTexel = [&image, mode] (const int x, const int y, const int c) -> float {
+		const int wx = RefWrap(x, image.width, mode);
+		const int wy = RefWrap(y, image.height, mode);
+		return image.pixels[((size_t) wy * image.width + wx) * 4 + c];
+	};
+
+	for (int c=0; c<4; ++c)
+	{
+		const float bottom = fnTexel(ix, iy, c) * (1.0f - ax) + fnTexel(ix+1, iy, c) * ax;
+		const float top = fnTexel(ix, iy+1, c) * (1.0f - ax) + fnTexel(ix+1, iy+1, c) * ax;
+		result.v[c] = bottom * (1.0f - ay) + top * ay;
+	}
+	return result;
+}
+
+// imageStore into rgba8
+static float RefQuantize(float value)
+{
+	if (value != value)
+		return 0.0f;
+	value = std::max(0.0f, std::min(1.0f, value) );
+	return floorf(value * 255.0f + 0.5f) / 255.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// misc_blending.cs
+
+static float RefAdd(const float base, const float blend) { return std::min(base + blend, 1.0f); }
+static float RefSubstract(const float base, const float blend) { return std::max(base + blend - 1.0f, 0.0f); }
+static float RefScreen(const float base, const float blend) { return 1.0f - ((1.0f - base) * (1.0f - blend)); }
+
+static float RefOverlay(const float base, const float blend)
+{
+	return (base < 0.5f) ? (2.0f * base * blend) : (1.0f - 2.0f * (1.0f - base) * (1.0f - blend));
+}
+
+static float RefSoftLight(const float base, const float blend)
+{
+	return (blend < 0.5f) ? (2.0f * base * blend + base * base * (1.0f - 2.0f * blend))
+		: (sqrtf(base) * (2.0f * blend - 1.0f) + 2.0f * base * (1.0f - blend));
+}
+
+static float RefColorDodge(const float base, const float blend)
+{
+	return (blend == 1.0f) ? blend : std::min(base / (1.0f - blend), 1.0f);
+}
+
+static float RefColorBurn(const float base, const float blend)
+{
+	return (blend == 0.0f) ? blend : std::max(1.0f - ((1.0f - base) / blend), 0.0f);
+}
+
+static float RefLinearLight(const float base, const float blend)
+{
+	return (blend < 0.5f) ? RefSubstract(base, 2.0f * blend) : RefAdd(base, 2.0f * (blend - 0.5f));
+}
+
+static float RefVividLight(const float base, const float blend)
+{
+	return (blend < 0.5f) ? RefColorBurn(base, 2.0f * blend) : RefColorDodge(base, 2.0f * (blend - 0.5f));
+}
+
+static float RefPinLight(const float base, const float blend)
+{
+	return (blend < 0.5f) ? std::min(2.0f * blend, base) : std::max(2.0f * (blend - 0.5f), base);
+}
+
+static float RefReflect(const float base, const float blend)
+{
+	return (blend == 1.0f) ? blend : std::min(base * base / (1.0f - blend), 1.0f);
+}
+
+static float RefBlendOperation(const int mode, const float base, const float blend)
+{
+	switch(mode)
+	{
+	case eCompositeBlendNormal: return blend;
+	case eCompositeBlendLighten: return std::max(blend, base);
+	case eCompositeBlendDarken: return std::min(blend, base);
+	case eCompositeBlendMultiply: return base * blend;
+	case eCompositeBlendAverage: return (base + blend) * 0.5f;
+	case eCompositeBlendAdd:
+	case eCompositeBlendLinearDodge: return RefAdd(base, blend);
+	case eCompositeBlendSubstract:
+	case eCompositeBlendLinearBurn: return RefSubstract(base, blend);
+	case eCompositeBlendDifference: return fabsf(base - blend);
+	case eCompositeBlendNegation: return 1.0f - fabsf(1.0f - base - blend);
+	case eCompositeBlendExclusion: return base + blend - 2.0f * base * blend;
+	case eCompositeBlendScreen: return RefScreen(base, blend);
+	case eCompositeBlendOverlay: return RefOverlay(base, blend);
+	case eCompositeBlendSoftLight: return RefSoftLight(base, blend);
+	case eCompositeBlendHardLight: return RefOverlay(blend, base);
+	case eCompositeBlendColorDodge: return RefColorDodge(base, blend);
+	case eCompositeBlendColorBurn: return RefColorBurn(base, blend);
+	case eCompositeBlendLinearLight: return RefLinearLight(base, blend);
+	case eCompositeBlendVividLight: return RefVividLight(base, blend);
+	case eCompositeBlendPinLight: return RefPinLight(base, blend);
+	case eCompositeBlendHardMix: return (RefVividLight(base, blend) < 0.5f) ? 0.0f : 1.0f;
+	case eCompositeBlendReflect: return RefReflect(base, blend);
+	case eCompositeBlendGlow: return RefReflect(blend, base);
+	case eCompositeBlendPhoenix: return std::min(base, blend) - std::max(base, blend) + 1.0f;
+	default:
+		break;
+	}
+	return base * blend;
+}
+
+// misc_masking.cs
+static RefColor RefApplyMask(const CompositeCPUNode &node, const CompositeCPUImage *mask, const float u, const float v,
+	const RefColor &srccolor, const RefColor &dstcolor)
+{
+	float weight = node.weight;
+
+	if (nullptr != mask && node.maskIndex >= 0)
+	{
+		const RefColor maskColor = RefTexture(*mask, u, v, eTextureWrapClampToEdge);
+		weight *= fabsf( ((node.invertMask) ? 1.0f : 0.0f) - maskColor.v[node.maskChannel & 3] );
+	}
+
+	RefColor result;
+	for (int c=0; c<4; ++c)
+		result.v[c] = srccolor.v[c] + (dstcolor.v[c] - srccolor.v[c]) * weight;
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// filterColor.cs
+
+static void RefRGBToHSL(const float *color, float *hsl)
+{
+	const float fmin = std::min( std::min(color[0], color[1]), color[2] );
+	const float fmax = std::max( std::max(color[0], color[1]), color[2] );
+	const float delta = fmax - fmin;
+
+	hsl[2] = (fmax + fmin) / 2.0f;
+
+	if (delta == 0.0f)
+	{
+		hsl[0] = hsl[1] = 0.0f;
+		return;
+	}
+
+	hsl[1] = (hsl[2] < 0.5f) ? delta / (fmax + fmin) : delta / (2.0f - fmax - fmin);
+
+	const float deltaR = (((fmax - color[0]) / 6.0f) + (delta / 2.0f)) / delta;
+	const float deltaG = (((fmax - color[1]) / 6.0f) + (delta / 2.0f)) / delta;
+	const float deltaB = (((fmax - color[2]) / 6.0f) + (delta / 2.0f)) / delta;
+
+	hsl[0] = 0.0f;
+	if (color[0] == fmax)
+		hsl[0] = deltaB - deltaG;
+	else if (color[1] == fmax)
+		hsl[0] = (1.0f / 3.0f) + deltaR - deltaB;
+	else if (color[2] == fmax)
+		hsl[0] = (2.0f / 3.0f) + deltaG - deltaR;
+
+	if (hsl[0] < 0.0f)
+		hsl[0] += 1.0f;
+	else if (hsl[0] > 1.0f)
+		hsl[0] -= 1.0f;
+}
+
+static float RefHueToRGB(const float f1, const float f2, float hue)
+{
+	if (hue < 0.0f)
+		hue += 1.0f;
+	else if (hue > 1.0f)
+		hue -= 1.0f;
+
+	if ((6.0f * hue) < 1.0f)
+		return f1 + (f2 - f1) * 6.0f * hue;
+	if ((2.0f * hue) < 1.0f)
+		return f2;
+	if ((3.0f * hue) < 2.0f)
+		return f1 + (f2 - f1) * ((2.0f / 3.0f) - hue) * 6.0f;
+	return f1;
+}
+
+static void RefHSLToRGB(const float *hsl, float *color)
+{
+	if (hsl[1] == 0.0f)
+	{
+		color[0] = color[1] = color[2] = hsl[2];
+		return;
+	}
+
+	const float f2 = (hsl[2] < 0.5f) ? hsl[2] * (1.0f + hsl[1]) : (hsl[2] + hsl[1]) - (hsl[1] * hsl[2]);
+	const float f1 = 2.0f * hsl[2] - f2;
+
+	color[0] = RefHueToRGB(f1, f2, hsl[0] + (1.0f / 3.0f));
+	color[1] = RefHueToRGB(f1, f2, hsl[0]);
+	color[2] = RefHueToRGB(f1, f2, hsl[0] - (1.0f / 3.0f));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// filterBlur.cs, one dispatch per direction
+
+static RefColor RefBlurKernel(const CompositeCPUImage &source, const float u, const float v, const float texelU, const float texelV)
+{
+	static const float offsets[9][2] = { {0.0f, 0.0f}, {0.4f, 0.9f}, {-0.4f, -0.9f}, {-0.9f, 0.4f}, {0.9f, -0.4f},
+		{0.9f, 1.9f}, {-0.9f, -1.9f}, {-1.9f, 0.9f}, {1.9f, -0.9f} };
+
+	RefColor taps[9];
+	for (int i=0; i<9; ++i)
+		taps[i] = RefTexture(source, u + texelU * offsets[i][0], v + texelV * offsets[i][1], eTextureWrapClampToEdge);
+
+	RefColor inner, outer;
+	for (int c=0; c<4; ++c)
+	{
+		inner.v[c] = 0.2f * (taps[0].v[c] + taps[1].v[c] + taps[2].v[c] + taps[3].v[c] + taps[4].v[c]);
+		outer.v[c] = 0.2f * (taps[0].v[c] + taps[5].v[c] + taps[6].v[c] + taps[7].v[c] + taps[8].v[c]);
+	}
+
+	const float mixValue = std::max(0.0f, std::min(1.0f, outer.v[3]) );
+
+	RefColor result;
+	for (int c=0; c<3; ++c)
+		result.v[c] = inner.v[c] * mixValue + outer.v[c] * (1.0f - mixValue);
+	result.v[3] = mixValue;
+	return result;
+}
+
+static void RefBlurPass(const CompositeCPUNode &node, const CompositeCPUImage *mask, const CompositeCPUImage &source,
+	CompositeCPUImage &target, const float scaleU, const float scaleV)
+{
+	static const float weights[8] = { 0.134598f, 0.127325f, 0.107778f, 0.081638f, 0.055335f, 0.033562f, 0.018216f, 0.008847f };
+
+	const float texelU = 1.0f / source.width;
+	const float texelV = 1.0f / source.height;
+
+	for (int y=0; y<source.height; ++y)
+		for (int x=0; x<source.width; ++x)
+		{
+			const float u = texelU * (0.5f + x);
+			const float v = texelV * (0.5f + y);
+
+			const RefColor center = RefBlurKernel(source, u, v, texelU, texelV);
+
+			RefColor sum;
+			for (int c=0; c<4; ++c)
+				sum.v[c] = center.v[c] * weights[0];
+
+			float du = scaleU;
+			float dv = scaleV;
+
+			for (int k=1; k<8; ++k, du += scaleU, dv += scaleV)
+			{
+				const RefColor a = RefBlurKernel(source, u + du, v + dv, texelU, texelV);
+				const RefColor b = RefBlurKernel(source, u - du, v - dv, texelU, texelV);
+
+				for (int c=0; c<4; ++c)
+					sum.v[c] += (a.v[c] + b.v[c]) * weights[k];
+			}
+
+			const RefColor outcolor = RefApplyMask(node, mask, u, v, center, sum);
+			float *pixel = target.pixels.data() + ((size_t) y * target.width + x) * 4;
+
+			for (int c=0; c<4; ++c)
+				pixel[c] = RefQuantize(outcolor.v[c]);
+		}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// one compute dispatch of a node
+
+static void RefExecuteNode(const CompositeCPUNode &node, CompositeCPUImage &image, const CompositeCPUImage *layer,
+	const CompositeCPUImage *mask)
+{
+	const CompositeCPUImage source(image);
+
+	if (eCompositeCPUBlur == node.type)
+	{
+		if (0.0f == node.blurScale[0] || 0.0f == node.blurScale[1])
+		{
+			RefBlurPass(node, mask, source, image, node.blurScale[0], node.blurScale[1]);
+		}
+		else
+		{
+			CompositeCPUImage temp(image);
+			RefBlurPass(node, mask, source, temp, node.blurScale[0], 0.0f);
+			RefBlurPass(node, mask, temp, image, 0.0f, node.blurScale[1]);
+		}
+		return;
+	}
+
+	const float texelU = 1.0f / image.width;
+	const float texelV = 1.0f / image.height;
+
+	for (int y=0; y<image.height; ++y)
+		for (int x=0; x<image.width; ++x)
+		{
+			float u = texelU * (0.5f + x);
+			float v = texelV * (0.5f + y);
+
+			RefColor color1;
+			const float *srcPixel = source.pixels.data() + ((size_t) y * image.width + x) * 4;
+			for (int c=0; c<4; ++c)
+				color1.v[c] = srcPixel[c];
+
+			RefColor outcolor = color1;
+
+			if (eCompositeCPUBlend == node.type)
+			{
+				// blend.cs
+				if (false == node.sameSize)
+				{
+					const float sinFactor = sinf(node.rotation);
+					const float cosFactor = cosf(node.rotation);
+
+					const float pu = u - node.pivotOffset[0];
+					const float pv = v - node.pivotOffset[1];
+
+					u = (pu * cosFactor + pv * sinFactor) * node.scaling[0] + node.pivotOffset[0] + node.translation[0];
+					v = (-pu * sinFactor + pv * cosFactor) * node.scaling[1] + node.pivotOffset[1] + node.translation[1];
+				}
+
+				RefColor color2 = RefTexture(*layer, u, v, node.wrapMode);
+
+				if (eTextureWrapClampToZero == node.wrapMode && (u > 1.0f || u < 0.0f || v > 1.0f || v < 0.0f) )
+					color2.v[3] = 0.0f;
+
+				const float opacity = color2.v[3];
+
+				for (int c=0; c<3; ++c)
+				{
+					float value = RefBlendOperation(node.blendMode, color1.v[c], color2.v[c]) * opacity + color1.v[c] * (1.0f - opacity);
+
+					for (int i=0; i<node.numberOfPasses; ++i)
+						value = RefBlendOperation(node.blendMode, value, color2.v[c]) * opacity + value * (1.0f - opacity);
+
+					outcolor.v[c] = value;
+				}
+				outcolor.v[3] = 1.0f;
+			}
+			else if (eCompositeCPUColorCorrection == node.type)
+			{
+				// filterColor.cs
+				float bright[3];
+				for (int c=0; c<3; ++c)
+					bright[c] = color1.v[c] * node.brightness;
+
+				const float intensity = bright[0] * 0.2125f + bright[1] * 0.7154f + bright[2] * 0.0721f;
+
+				float color[3];
+				for (int c=0; c<3; ++c)
+				{
+					const float saturated = intensity + (bright[c] - intensity) * node.saturation;
+					color[c] = powf(0.5f + (saturated - 0.5f) * node.contrast, 1.0f / node.gamma);
+				}
+
+				float hsl[3];
+				RefRGBToHSL(color, hsl);
+				hsl[0] += node.hue;
+				hsl[1] += node.hueSaturation;
+				hsl[2] += node.lightness;
+				RefHSLToRGB(hsl, color);
+
+				const float inverse = (node.inverse) ? 1.0f : 0.0f;
+				for (int c=0; c<3; ++c)
+					outcolor.v[c] = color[c] + ((1.0f - color[c]) - color[c]) * inverse;
+				outcolor.v[3] = 1.0f;
+			}
+			else if (eCompositeCPUPosterization == node.type)
+			{
+				// filterPosterization.cs
+				for (int c=0; c<3; ++c)
+				{
+					float value = powf(color1.v[c], node.gamma);
+					value = floorf(value * node.numberOfColors) / node.numberOfColors;
+					outcolor.v[c] = powf(value, 1.0f / node.gamma);
+				}
+			}
+			else if (eCompositeCPULUT == node.type)
+			{
+				// filterLUT.cs, trilinear fetch of a 3d texture
+				const int size = node.lutSize;
+
+				int i0[3], i1[3];
+				float f[3];
+
+				for (int c=0; c<3; ++c)
+				{
+					const float coord = color1.v[c] * (size - 1.0f) / size + 0.5f / size;
+					const float t = std::max(0.0f, std::min((float) size - 1.0f, coord * size - 0.5f) );
+
+					i0[c] = (int) floorf(t);
+					i1[c] = std::min(i0[c] + 1, size - 1);
+					f[c] = t - i0[c];
+				}
+
+				for (int c=0; c<3; ++c)
+					outcolor.v[c] = 0.0f;
+
+				for (int k=0; k<8; ++k)
+				{
+					const int r = (k & 1) ? i1[0] : i0[0];
+					const int g = (k & 2) ? i1[1] : i0[1];
+					const int b = (k & 4) ? i1[2] : i0[2];
+
+					const float weight = ((k & 1) ? f[0] : 1.0f - f[0]) * ((k & 2) ? f[1] : 1.0f - f[1]) * ((k & 4) ? f[2] : 1.0f - f[2]);
+					const float *entry = node.lut.data() + 3 * (r + size * (g + size * b));
+
+					for (int c=0; c<3; ++c)
+						outcolor.v[c] += weight * entry[c];
+				}
+			}
+
+			outcolor = RefApplyMask(node, mask, u, v, color1, outcolor);
+
+			float *pixel = image.pixels.data() + ((size_t) y * image.width + x) * 4;
+			for (int c=0; c<4; ++c)
+				pixel[c] = RefQuantize(outcolor.v[c]);
+		}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// self test
+
+static void RefMakeNoiseImage(CompositeCPUImage &image, const int w, const int h, unsigned int seed, const bool useAlpha)
+{
+	image.Init(w, h);
+
+	for (size_t i=0; i<image.pixels.size(); ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		image.pixels[i] = RefQuantize( (float) (seed >> 8) / 16777216.0f );
+	}
+
+	if (false == useAlpha)
+	{
+		for (size_t i=3; i<image.pixels.size(); i+=4)
+			image.pixels[i] = 1.0f;
+	}
+}
+
+// in 8 bit steps
+static float RefMaxDifference(const CompositeCPUImage &a, const CompositeCPUImage &b)
+{
+	if (a.width != b.width || a.height != b.height)
+		return 255.0f;
+
+	float result = 0.0f;
+	for (size_t i=0; i<a.pixels.size(); ++i)
+		result = std::max(result, fabsf(a.pixels[i] - b.pixels[i]) );
+	return 255.0f * result;
+}
+
+bool CompositeCPUReferenceSelfTest()
+{
+	int numberOfErrors = 0;
+	float worst = 0.0f;
+
+	CompositeCPUImage background, layer, mask;
+	RefMakeNoiseImage(background, 173, 97, 11, false);
+	RefMakeNoiseImage(layer, 91, 67, 22, true);
+	RefMakeNoiseImage(mask, 173, 97, 33, true);
+
+	CompositeCPUOptions options;
+	options.tileSize = 32;
+
+	auto fnCompare = [&] (const CompositeCPUGraph &graph, const CompositeCPUImage &reference, const char *text, const int a, const int b) {
+
+		CompositeCPUImage result;
+		graph.Execute(background, result, options);
+
+		const float diff = RefMaxDifference(result, reference);
+		worst = std::max(worst, diff);
+
+		if (diff > CPU_REFERENCE_TOLERANCE)
+		{
+			printf( "[CompositeCPU] reference test failed - %s %d %d, difference %.2f\n", text, a, b, diff );
+			numberOfErrors += 1;
+		}
+	};
+
+	auto fnCheckNode = [&] (const CompositeCPUNode &node, const char *text) {
+
+		CompositeCPUGraph graph;
+		graph.AddLayerImage(&layer);
+		graph.AddMaskImage(&mask);
+		graph.AddNode(node);
+
+		CompositeCPUImage reference(background);
+		RefExecuteNode(node, reference, &layer, &mask);
+
+		fnCompare(graph, reference, text, node.blendMode, node.wrapMode);
+	};
+
+	// every blend mode and wrap mode, nearest and linear layer, with and without SAME_SIZE
+
+	for (int filter=0; filter<2; ++filter)
+	{
+		layer.linearFilter = (filter > 0);
+
+		for (int mode=eCompositeBlendNormal; mode<=eCompositeBlendPhoenix; ++mode)
+			for (int wrap=eTextureWrapClampToZero; wrap<=eTextureWrapRepeat; ++wrap)
+			{
+				CompositeCPUNode node(eCompositeCPUBlend);
+				node.blendMode = (ECompositeBlendType) mode;
+				node.wrapMode = (ETextureWrapMode) wrap;
+				node.layerIndex = 0;
+				node.weight = 0.8f;
+				node.rotation = 0.4f;
+				node.translation[0] = 0.1f;
+				node.scaling[0] = 1.3f;
+				node.scaling[1] = 0.7f;
+				node.numberOfPasses = mode % 3;
+				node.maskIndex = (mode % 2) ? 0 : -1;
+				node.invertMask = (1 == mode % 4);
+
+				fnCheckNode(node, "blend mode, wrap");
+
+				node.sameSize = true;
+				fnCheckNode(node, "same size blend mode, wrap");
+			}
+	}
+	layer.linearFilter = false;
+
+	// filters
+
+	CompositeCPUNode color(eCompositeCPUColorCorrection);
+	color.contrast = 1.3f;
+	color.saturation = 0.7f;
+	color.brightness = 1.1f;
+	color.gamma = 0.8f;
+	color.hue = 0.2f;
+	color.hueSaturation = 0.1f;
+	color.lightness = -0.05f;
+	color.weight = 0.9f;
+	fnCheckNode(color, "color correction");
+
+	CompositeCPUNode colorInverse(color);
+	colorInverse.inverse = true;
+	colorInverse.maskIndex = 0;
+	fnCheckNode(colorInverse, "color correction, inverse and mask");
+
+	CompositeCPUNode posterization(eCompositeCPUPosterization);
+	posterization.numberOfColors = 8.0f;
+	posterization.gamma = 0.6f;
+	fnCheckNode(posterization, "posterization");
+
+	CompositeCPUNode blur(eCompositeCPUBlur);
+	blur.blurScale[0] = 0.003f;
+	blur.blurScale[1] = 0.0045f;
+	blur.weight = 0.9f;
+	fnCheckNode(blur, "blur, two passes");
+
+	blur.blurScale[1] = 0.0f;
+	blur.maskIndex = 0;
+	fnCheckNode(blur, "blur, horizontal and mask");
+
+	blur.blurScale[0] = 0.0f;
+	blur.blurScale[1] = 0.0123f;
+	blur.maskIndex = -1;
+	fnCheckNode(blur, "blur, vertical");
+
+	CompositeCPUNode lut(eCompositeCPULUT);
+	lut.lutSize = 17;
+	lut.lut.resize(3 * 17 * 17 * 17);
+	for (size_t i=0; i<lut.lut.size(); ++i)
+		lut.lut[i] = 0.5f + 0.5f * sinf(0.37f * i);
+	fnCheckNode(lut, "3d LUT");
+
+	// fused per pixel nodes, a layer filter and blur against dispatches one by one
+
+	{
+		CompositeCPUNode layerBlend(eCompositeCPUBlend);
+		layerBlend.layerIndex = 0;
+		layerBlend.blendMode = eCompositeBlendScreen;
+		layerBlend.weight = 0.7f;
+		layerBlend.layerFilters.push_back(posterization);
+
+		CompositeCPUNode chainBlur(eCompositeCPUBlur);
+		chainBlur.blurScale[0] = 0.004f;
+		chainBlur.blurScale[1] = 0.003f;
+
+		CompositeCPUGraph graph;
+		graph.AddLayerImage(&layer);
+		graph.AddMaskImage(&mask);
+		graph.AddNode(color);
+		graph.AddNode(layerBlend);
+		graph.AddNode(chainBlur);
+
+		CompositeCPUImage filteredLayer(layer);
+		RefExecuteNode(posterization, filteredLayer, nullptr, nullptr);
+
+		CompositeCPUImage reference(background);
+		RefExecuteNode(color, reference, nullptr, nullptr);
+		RefExecuteNode(layerBlend, reference, &filteredLayer, nullptr);
+		RefExecuteNode(chainBlur, reference, nullptr, nullptr);
+
+		fnCompare(graph, reference, "chain of nodes", 0, 0);
+	}
+
+	printf( "[CompositeCPU] reference test %s, %d errors, max difference %.2f of 8 bit step\n",
+		(0 == numberOfErrors) ? "passed" : "FAILED", numberOfErrors, worst );
+	return 0 == numberOfErrors;
+}
@@ -0,0 +1,679 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_froxels.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "compositeMaster_froxels.h"
+#include "algorithm\ParallelFor.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string.h>
+#include <unordered_map>
+
+// points closer to the camera plane are treated as behind the camera
+#define FROXEL_MIN_W			0.0001
+// bounds are extended a bit, shader computes the froxel in floats
+#define FROXEL_NDC_EPSILON		0.0001
+#define FROXEL_DEPTH_EPSILON	0.0001
+
+// column major, res = a * b
+static void FroxelMultMatrix(double *res, const double *a, const double *b)
+{
+	for (int c=0; c<4; ++c)
+		for (int r=0; r<4; ++r)
+		{
+			res[c*4+r] = a[r] * b[c*4] + a[4+r] * b[c*4+1] + a[8+r] * b[c*4+2] + a[12+r] * b[c*4+3];
+		}
+}
+
+static void FroxelTransformPoint(double *res, const double *m, const double x, const double y, const double z)
+{
+	for (int r=0; r<4; ++r)
+		res[r] = m[r] * x + m[4+r] * y + m[8+r] * z + m[12+r];
+}
+
+static int FroxelTile(const double ndc, const int tiles)
+{
+	const int tile = (int) floor( (0.5 * ndc + 0.5) * tiles );
+	return std::max(0, std::min(tiles-1, tile) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeFroxelClusters
+
+CompositeFroxelClusters::CompositeFroxelClusters()
+	: mTilesX(1)
+	, mTilesY(1)
+	, mSlices(1)
+	, mNearPlane(1.0)
+	, mFarPlane(4000.0)
+	, mHasViewProj(false)
+	, mNumberOfCulled(0)
+	, mNumberOfSortMoves(0)
+{
+	memset(mViewProj, 0, sizeof(double) * 16);
+}
+
+void CompositeFroxelClusters::Clear()
+{
+	mSorted.clear();
+	mOrder.clear();
+	mRanges.clear();
+	mFroxels.clear();
+	mIndices.clear();
+
+	mNumberOfCulled = 0;
+	mNumberOfSortMoves = 0;
+}
+
+int CompositeFroxelClusters::ComputeSlice(const double viewDepth) const
+{
+	if (viewDepth <= mNearPlane)
+		return 0;
+
+	const double slice = log(viewDepth / mNearPlane) / log(mFarPlane / mNearPlane) * mSlices;
+	return std::min(mSlices-1, (int) floor(slice) );
+}
+
+int CompositeFroxelClusters::FindFroxel(const double *worldPos) const
+{
+	if (false == mHasViewProj)
+		return -1;
+
+	double clip[4];
+	FroxelTransformPoint(clip, mViewProj, worldPos[0], worldPos[1], worldPos[2]);
+
+	const double w = std::max(FROXEL_MIN_W, clip[3]);
+
+	const int x = FroxelTile(clip[0] / w, mTilesX);
+	const int y = FroxelTile(clip[1] / w, mTilesY);
+	const int z = ComputeSlice(w);
+
+	return (z * mTilesY + y) * mTilesX + x;
+}
+
+void CompositeFroxelClusters::SortVolumes(const std::vector<CompositeFroxelVolume> &volumes, const CompositeFroxelSettings &settings)
+{
+	const int count = (int) volumes.size();
+
+	// start from the order of a previous frame, new volumes go to the end
+
+	std::unordered_map<const void*, int>	prevPlace;
+	prevPlace.reserve(mSorted.size() );
+
+	for (int i=0, prevCount=(int) mSorted.size(); i<prevCount; ++i)
+		prevPlace[mSorted[i].key] = i;
+
+	std::vector<SortItem>	prevItems(mSorted.size() );
+	std::vector<bool>		prevUsed(mSorted.size(), false);
+	std::vector<SortItem>	newItems;
+
+	for (int i=0; i<count; ++i)
+	{
+		const CompositeFroxelVolume &volume = volumes[i];
+
+		SortItem item;
+		item.key = volume.key;
+		item.index = i;
+
+		const double dx = volume.matrix[12] - settings.cameraPos[0];
+		const double dy = volume.matrix[13] - settings.cameraPos[1];
+		const double dz = volume.matrix[14] - settings.cameraPos[2];
+		item.dist = sqrt(dx*dx + dy*dy + dz*dz);
+
+		auto iter = prevPlace.find(volume.key);
+		if (false == settings.sortByDistance || iter == end(prevPlace) || prevUsed[iter->second] )
+		{
+			newItems.push_back(item);
+		}
+		else
+		{
+			prevItems[iter->second] = item;
+			prevUsed[iter->second] = true;
+		}
+	}
+
+	mSorted.clear();
+	mSorted.reserve(count);
+
+	for (size_t i=0; i<prevItems.size(); ++i)
+		if (prevUsed[i])
+			mSorted.push_back(prevItems[i]);
+
+	mSorted.insert( end(mSorted), begin(newItems), end(newItems) );
+
+	// insertion sort is linear on a nearly sorted order
+
+	mNumberOfSortMoves = 0;
+
+	if (settings.sortByDistance)
+	{
+		for (int i=1; i<count; ++i)
+		{
+			const SortItem item = mSorted[i];
+			int j = i - 1;
+
+			while (j >= 0 && mSorted[j].dist > item.dist)
+			{
+				mSorted[j+1] = mSorted[j];
+				j -= 1;
+			}
+
+			if (j+1 != i)
+			{
+				mSorted[j+1] = item;
+				mNumberOfSortMoves += 1;
+			}
+		}
+	}
+
+	mOrder.resize(count);
+	for (int i=0; i<count; ++i)
+		mOrder[i] = mSorted[i].index;
+}
+
+void CompositeFroxelClusters::ComputeRange(const CompositeFroxelVolume &volume, FroxelRange &range) const
+{
+	// whole grid
+	range.x0 = 0;
+	range.x1 = mTilesX - 1;
+	range.y0 = 0;
+	range.y1 = mTilesY - 1;
+	range.z0 = 0;
+	range.z1 = mSlices - 1;
+
+	if (false == mHasViewProj)
+		return;
+
+	double mvp[16];
+	FroxelMultMatrix(mvp, mViewProj, volume.matrix);
+
+	double minNdc[2] = {1e32, 1e32};
+	double maxNdc[2] = {-1e32, -1e32};
+	double minW = 1e32;
+	double maxW = -1e32;
+	int numberOfBehind = 0;
+
+	for (int i=0; i<8; ++i)
+	{
+		const double x = (i & 1) ? volume.bmax[0] : volume.bmin[0];
+		const double y = (i & 2) ? volume.bmax[1] : volume.bmin[1];
+		const double z = (i & 4) ? volume.bmax[2] : volume.bmin[2];
+
+		double clip[4];
+		FroxelTransformPoint(clip, mvp, x, y, z);
+
+		minW = std::min(minW, clip[3]);
+		maxW = std::max(maxW, clip[3]);
+
+		if (clip[3] <= FROXEL_MIN_W)
+		{
+			numberOfBehind += 1;
+			continue;
+		}
+
+		for (int k=0; k<2; ++k)
+		{
+			const double ndc = clip[k] / clip[3];
+			minNdc[k] = std::min(minNdc[k], ndc);
+			maxNdc[k] = std::max(maxNdc[k], ndc);
+		}
+	}
+
+	// culled
+	if (8 == numberOfBehind)
+	{
+		range.z0 = 1;
+		range.z1 = 0;
+		return;
+	}
+
+	range.z1 = ComputeSlice(maxW * (1.0 + FROXEL_DEPTH_EPSILON) );
+
+	// box crosses the camera plane, projected rect is unbounded
+	if (numberOfBehind > 0)
+		return;
+
+	if (maxNdc[0] < -1.0 - FROXEL_NDC_EPSILON || minNdc[0] > 1.0 + FROXEL_NDC_EPSILON
+		|| maxNdc[1] < -1.0 - FROXEL_NDC_EPSILON || minNdc[1] > 1.0 + FROXEL_NDC_EPSILON)
+	{
+		range.z0 = 1;
+		range.z1 = 0;
+		return;
+	}
+
+	range.x0 = FroxelTile(minNdc[0] - FROXEL_NDC_EPSILON, mTilesX);
+	range.x1 = FroxelTile(maxNdc[0] + FROXEL_NDC_EPSILON, mTilesX);
+	range.y0 = FroxelTile(minNdc[1] - FROXEL_NDC_EPSILON, mTilesY);
+	range.y1 = FroxelTile(maxNdc[1] + FROXEL_NDC_EPSILON, mTilesY);
+	range.z0 = ComputeSlice(minW * (1.0 - FROXEL_DEPTH_EPSILON) );
+}
+
+void CompositeFroxelClusters::Build(const std::vector<CompositeFroxelVolume> &volumes, const CompositeFroxelSettings &settings)
+{
+	mTilesX = std::max(1, settings.tilesX);
+	mTilesY = std::max(1, settings.tilesY);
+	mSlices = std::max(1, settings.slices);
+
+	mNearPlane = std::max(FROXEL_MIN_W, settings.nearPlane);
+	mFarPlane = std::max(mNearPlane * 1.001, settings.farPlane);
+
+	mHasViewProj = (nullptr != settings.viewProj);
+	if (mHasViewProj)
+		memcpy(mViewProj, settings.viewProj, sizeof(double) * 16);
+
+	SortVolumes(volumes, settings);
+
+	// screen and depth range of every volume
+
+	const int count = (int) volumes.size();
+	mRanges.resize(count);
+
+	ParallelFor(count, 16, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+			ComputeRange(volumes[mOrder[i]], mRanges[i]);
+	}, settings.numberOfThreads);
+
+	mNumberOfCulled = 0;
+	for (int i=0; i<count; ++i)
+		if (mRanges[i].z0 > mRanges[i].z1)
+			mNumberOfCulled += 1;
+
+	// froxel lists, each slice is filled by one thread.
+	//	First pass counts volumes per froxel, second one writes indices in the sorted order
+
+	const int numberOfFroxels = GetNumberOfFroxels();
+	const int sliceSize = mTilesX * mTilesY;
+
+	mFroxels.assign(numberOfFroxels * 2, 0);
+
+	auto fnFill = [&] (const bool countPass) {
+
+		ParallelFor(mSlices, 1, [&] (const int first, const int last) {
+
+			for (int z=first; z<last; ++z)
+			{
+				uint32_t *froxels = mFroxels.data() + z * sliceSize * 2;
+
+				for (int i=0; i<count; ++i)
+				{
+					const FroxelRange &range = mRanges[i];
+					if (z < range.z0 || z > range.z1)
+						continue;
+
+					for (int y=range.y0; y<=range.y1; ++y)
+						for (int x=range.x0; x<=range.x1; ++x)
+						{
+							uint32_t *froxel = froxels + (y * mTilesX + x) * 2;
+
+							if (false == countPass)
+								mIndices[froxel[0] + froxel[1]] = (uint32_t) i;
+							froxel[1] += 1;
+						}
+				}
+			}
+		}, settings.numberOfThreads);
+	};
+
+	fnFill(true);
+
+	uint32_t offset = 0;
+	for (int i=0; i<numberOfFroxels; ++i)
+	{
+		mFroxels[i*2] = offset;
+		offset += mFroxels[i*2+1];
+		mFroxels[i*2+1] = 0;
+	}
+
+	mIndices.resize(offset);
+	fnFill(false);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// self test
+
+// box rotated around y, column major
+static void FroxelTestVolume(CompositeFroxelVolume &volume, const void *key, const double *pos, const double angle, const double *halfSize)
+{
+	memset(volume.matrix, 0, sizeof(double) * 16);
+
+	const double c = cos(angle);
+	const double s = sin(angle);
+
+	volume.matrix[0] = c;
+	volume.matrix[2] = -s;
+	volume.matrix[5] = 1.0;
+	volume.matrix[8] = s;
+	volume.matrix[10] = c;
+
+	for (int k=0; k<3; ++k)
+	{
+		volume.matrix[12+k] = pos[k];
+		volume.bmin[k] = -halfSize[k];
+		volume.bmax[k] = halfSize[k];
+	}
+	volume.matrix[15] = 1.0;
+
+	volume.key = key;
+}
+
+// opengl perspective camera which looks along -z
+static void FroxelTestViewProj(double *viewProj, const double *cameraPos, const double nearPlane, const double farPlane)
+{
+	const double pi = 4.0 * atan(1.0);
+	const double f = 1.0 / tan(0.5 * 60.0 * pi / 180.0);
+	const double aspect = 16.0 / 9.0;
+
+	double proj[16], view[16];
+	memset(proj, 0, sizeof(double) * 16);
+	memset(view, 0, sizeof(double) * 16);
+
+	proj[0] = f / aspect;
+	proj[5] = f;
+	proj[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+	proj[11] = -1.0;
+	proj[14] = 2.0 * farPlane * nearPlane / (nearPlane - farPlane);
+
+	view[0] = view[5] = view[10] = view[15] = 1.0;
+	for (int k=0; k<3; ++k)
+		view[12+k] = -cameraPos[k];
+
+	FroxelMultMatrix(viewProj, proj, view);
+}
+
+bool CompositeFroxelClustersSelfTest()
+{
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf("[FroxelClusters] test failed - %s\n", text);
+			numberOfErrors += 1;
+		}
+	};
+
+	// lists are contiguous, positions are valid and keep the sorted order inside a froxel
+
+	auto fnCheckLists = [] (const CompositeFroxelClusters &clusters, const int count) -> bool {
+
+		const std::vector<uint32_t> &froxels = clusters.GetFroxels();
+		const std::vector<uint32_t> &indices = clusters.GetIndices();
+
+		if ( (int) froxels.size() != clusters.GetNumberOfFroxels() * 2)
+			return false;
+
+		uint32_t offset = 0;
+		for (int i=0; i<clusters.GetNumberOfFroxels(); ++i)
+		{
+			if (froxels[i*2] != offset)
+				return false;
+
+			for (uint32_t j=0; j<froxels[i*2+1]; ++j)
+			{
+				const uint32_t index = indices[offset + j];
+				if ( (int) index >= count || (j > 0 && index <= indices[offset + j - 1]) )
+					return false;
+			}
+			offset += froxels[i*2+1];
+		}
+		return offset == (uint32_t) indices.size();
+	};
+
+	auto fnContains = [] (const CompositeFroxelClusters &clusters, const int froxel, const int position) -> bool {
+
+		const uint32_t *froxels = clusters.GetFroxels().data() + froxel * 2;
+		const uint32_t *indices = clusters.GetIndices().data() + froxels[0];
+
+		return std::binary_search(indices, indices + froxels[1], (uint32_t) position);
+	};
+
+	// synthetic volumes, keys are addresses of the array items
+
+	const int numberOfVolumes = 200;
+	const double nearPlane = 1.0;
+	const double farPlane = 1000.0;
+
+	std::vector<char>	keys(numberOfVolumes);
+	std::vector<CompositeFroxelVolume>	volumes(numberOfVolumes);
+
+	uint32_t seed = 12345;
+	auto fnRandom = [&seed] (const double a, const double b) -> double {
+		seed = seed * 1664525u + 1013904223u;
+		return a + (b - a) * (double) (seed >> 8) / 16777216.0;
+	};
+
+	for (int i=0; i<numberOfVolumes; ++i)
+	{
+		const double pos[3] = { fnRandom(-400.0, 400.0), fnRandom(-250.0, 250.0), fnRandom(-900.0, 150.0) };
+		const double halfSize[3] = { fnRandom(1.0, 40.0), fnRandom(1.0, 40.0), fnRandom(1.0, 40.0) };
+
+		FroxelTestVolume(volumes[i], &keys[i], pos, fnRandom(0.0, 6.28), halfSize);
+	}
+
+	// behind the camera, aside of the view, crossing the camera plane, a small one in the center
+
+	const double camera[3] = {0.0, 0.0, 100.0};
+	{
+		const double half10[3] = {10.0, 10.0, 10.0};
+		const double half20[3] = {20.0, 20.0, 20.0};
+		const double half1[3] = {1.0, 1.0, 1.0};
+
+		const double behindPos[3] = {0.0, 0.0, 200.0};
+		const double asidePos[3] = {2000.0, 0.0, -100.0};
+		const double crossPos[3] = {0.0, 0.0, 100.0};
+		const double centerPos[3] = {0.0, 0.0, -200.0};
+
+		FroxelTestVolume(volumes[0], &keys[0], behindPos, 0.3, half10);
+		FroxelTestVolume(volumes[1], &keys[1], asidePos, 0.0, half10);
+		FroxelTestVolume(volumes[2], &keys[2], crossPos, 0.7, half20);
+		FroxelTestVolume(volumes[3], &keys[3], centerPos, 0.0, half1);
+	}
+
+	double viewProj[16];
+	FroxelTestViewProj(viewProj, camera, nearPlane, farPlane);
+
+	CompositeFroxelSettings settings;
+	settings.nearPlane = nearPlane;
+	settings.farPlane = farPlane;
+	settings.viewProj = viewProj;
+	settings.numberOfThreads = 1;
+	for (int k=0; k<3; ++k)
+		settings.cameraPos[k] = camera[k];
+
+	CompositeFroxelClusters clusters;
+	clusters.Build(volumes, settings);
+
+	fnCheck(fnCheckLists(clusters, numberOfVolumes), "froxel lists layout");
+
+	// order is a permutation, nearest first
+
+	const std::vector<int> &order = clusters.GetOrder();
+	std::vector<int> positions(numberOfVolumes, -1);
+
+	bool isPermutation = ( (int) order.size() == numberOfVolumes);
+	for (int i=0; isPermutation && i<numberOfVolumes; ++i)
+	{
+		if (order[i] < 0 || order[i] >= numberOfVolumes || positions[order[i]] >= 0)
+			isPermutation = false;
+		else
+			positions[order[i]] = i;
+	}
+	fnCheck(isPermutation, "order is a permutation");
+
+	if (false == isPermutation)
+	{
+		printf("[FroxelClusters] self test FAILED, %d errors\n", numberOfErrors);
+		return false;
+	}
+
+	auto fnDistance = [&camera] (const CompositeFroxelVolume &volume) -> double {
+		const double dx = volume.matrix[12] - camera[0];
+		const double dy = volume.matrix[13] - camera[1];
+		const double dz = volume.matrix[14] - camera[2];
+		return sqrt(dx*dx + dy*dy + dz*dz);
+	};
+
+	bool isSorted = true;
+	for (int i=1; i<numberOfVolumes; ++i)
+		if (fnDistance(volumes[order[i-1]]) > fnDistance(volumes[order[i]]) )
+			isSorted = false;
+	fnCheck(isSorted, "volumes are sorted by distance");
+
+	// every point of a box on the screen finds the box in its froxel
+
+	std::vector<int> coverage(numberOfVolumes, 0);
+	for (const uint32_t index : clusters.GetIndices() )
+		coverage[index] += 1;
+
+	int numberOfMissed = 0;
+	const int samples = 5;
+
+	for (int i=0; i<numberOfVolumes; ++i)
+	{
+		const CompositeFroxelVolume &volume = volumes[i];
+
+		for (int s=0; s<samples*samples*samples; ++s)
+		{
+			double local[3];
+			const int sample[3] = { s % samples, (s / samples) % samples, s / (samples * samples) };
+
+			for (int k=0; k<3; ++k)
+				local[k] = volume.bmin[k] + (volume.bmax[k] - volume.bmin[k]) * sample[k] / (samples - 1);
+
+			double world[4], clip[4];
+			FroxelTransformPoint(world, volume.matrix, local[0], local[1], local[2]);
+			FroxelTransformPoint(clip, viewProj, world[0], world[1], world[2]);
+
+			if (clip[3] <= FROXEL_MIN_W || fabs(clip[0]) > clip[3] || fabs(clip[1]) > clip[3])
+				continue;
+
+			if (false == fnContains(clusters, clusters.FindFroxel(world), positions[i]) )
+				numberOfMissed += 1;
+		}
+	}
+
+	fnCheck(0 == numberOfMissed, "every visible point of a volume is in its froxel");
+	fnCheck(0 == coverage[positions[0]], "volume behind the camera is culled");
+	fnCheck(0 == coverage[positions[1]], "volume aside of the view is culled");
+	fnCheck(coverage[positions[2]] > 0, "volume across the camera plane is kept");
+	fnCheck(coverage[positions[3]] > 0 && coverage[positions[3]] <= 8, "small volume takes a few froxels");
+
+	int numberOfEmpty = 0;
+	for (int i=0; i<numberOfVolumes; ++i)
+		if (0 == coverage[i])
+			numberOfEmpty += 1;
+	fnCheck(clusters.GetNumberOfCulled() == numberOfEmpty && numberOfEmpty >= 2, "number of culled volumes");
+
+	const std::vector<uint32_t> froxels = clusters.GetFroxels();
+	const std::vector<uint32_t> indices = clusters.GetIndices();
+
+	// the same frame again, order of a previous frame needs no moves
+
+	clusters.Build(volumes, settings);
+	fnCheck(0 == clusters.GetNumberOfSortMoves(), "static frame is sorted without moves");
+	fnCheck(froxels == clusters.GetFroxels() && indices == clusters.GetIndices(), "static frame gives the same lists");
+
+	// threads give the same lists
+
+	{
+		CompositeFroxelSettings threadSettings(settings);
+		threadSettings.numberOfThreads = 4;
+
+		CompositeFroxelClusters threaded;
+		threaded.Build(volumes, threadSettings);
+
+		fnCheck(order == threaded.GetOrder() && froxels == threaded.GetFroxels() && indices == threaded.GetIndices(),
+			"threaded build gives the same lists");
+	}
+
+	// input order is changed, keys keep the volumes in their places
+
+	{
+		std::vector<CompositeFroxelVolume> reversed(volumes.rbegin(), volumes.rend() );
+		const std::vector<int> prevOrder(order);
+
+		clusters.Build(reversed, settings);
+
+		bool sameKeys = true;
+		for (int i=0; i<numberOfVolumes; ++i)
+			if (reversed[clusters.GetOrder()[i]].key != volumes[prevOrder[i]].key)
+				sameKeys = false;
+
+		fnCheck(sameKeys, "keys keep the order of a shuffled input");
+		fnCheck(0 == clusters.GetNumberOfSortMoves(), "shuffled input is sorted without moves");
+		fnCheck(froxels == clusters.GetFroxels() && indices == clusters.GetIndices(), "shuffled input gives the same lists");
+	}
+
+	// camera is moved, order of a previous frame is sorted again
+
+	{
+		const double movedCamera[3] = {100.0, 50.0, -300.0};
+		double movedViewProj[16];
+		FroxelTestViewProj(movedViewProj, movedCamera, nearPlane, farPlane);
+
+		CompositeFroxelSettings movedSettings(settings);
+		movedSettings.viewProj = movedViewProj;
+		for (int k=0; k<3; ++k)
+			movedSettings.cameraPos[k] = movedCamera[k];
+
+		clusters.Build(volumes, movedSettings);
+
+		CompositeFroxelClusters fresh;
+		fresh.Build(volumes, movedSettings);
+
+		fnCheck(clusters.GetNumberOfSortMoves() > 0, "moved camera needs sort moves");
+		fnCheck(clusters.GetOrder() == fresh.GetOrder() && clusters.GetFroxels() == fresh.GetFroxels()
+			&& clusters.GetIndices() == fresh.GetIndices(), "moved camera gives lists of a fresh build");
+		fnCheck(fnCheckLists(clusters, numberOfVolumes), "moved camera lists layout");
+	}
+
+	// no view projection, every volume goes into every froxel
+
+	{
+		CompositeFroxelSettings noViewSettings(settings);
+		noViewSettings.viewProj = nullptr;
+
+		clusters.Build(volumes, noViewSettings);
+
+		bool everyVolume = true;
+		for (int i=0; i<clusters.GetNumberOfFroxels(); ++i)
+			if (clusters.GetFroxels()[i*2+1] != (uint32_t) numberOfVolumes)
+				everyVolume = false;
+
+		const double origin[3] = {0.0, 0.0, 0.0};
+
+		fnCheck(everyVolume && 0 == clusters.GetNumberOfCulled(), "no view projection puts volumes everywhere");
+		fnCheck(-1 == clusters.FindFroxel(origin), "no froxel lookup without a view projection");
+	}
+
+	// grid out of range and an empty input
+
+	{
+		CompositeFroxelSettings badSettings(settings);
+		badSettings.tilesX = 0;
+		badSettings.tilesY = -1;
+		badSettings.slices = 0;
+
+		CompositeFroxelClusters single;
+		single.Build(volumes, badSettings);
+
+		fnCheck(1 == single.GetNumberOfFroxels() && fnCheckLists(single, numberOfVolumes), "grid out of range is one froxel");
+
+		single.Build(std::vector<CompositeFroxelVolume>(), settings);
+
+		fnCheck(single.GetIndices().empty() && fnCheckLists(single, 0), "empty input");
+	}
+
+	printf("[FroxelClusters] self test %s, %d errors\n", (0 == numberOfErrors) ? "passed" : "FAILED", numberOfErrors);
+	return 0 == numberOfErrors;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_froxels.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <stdint.h>
+
+/*
+	Clustered assignment of fog volumes and shadow zones
+
+	camera view is split into froxels - screen tiles by exponential depth slices between the camera
+	 near and far planes. Every volume box is projected with the camera view-projection matrix and
+	 its index goes into the list of every froxel its screen rect and depth range overlap.
+	 A shader finds the froxel of a pixel from the pixel clip position and loops only over that list.
+
+	Volumes are ordered by distance from the camera. The order of the previous frame is a start point
+	 for the insertion sort, so a nearly static scene is sorted in a linear time. Froxel lists keep that order.
+
+	No SDK or GL dependency, synthetic volumes could be fed from a test.
+*/
+
+#define COMPOSITE_FROXEL_TILES_X		16
+#define COMPOSITE_FROXEL_TILES_Y		8
+#define COMPOSITE_FROXEL_SLICES			24
+
+struct CompositeFroxelVolume
+{
+	const void		*key;			// stable between frames, model pointer
+	double			matrix[16];		// local to world, column major
+	double			bmin[3];		// local bounding box
+	double			bmax[3];
+};
+
+struct CompositeFroxelSettings
+{
+	int				tilesX;
+	int				tilesY;
+	int				slices;
+
+	double			nearPlane;
+	double			farPlane;
+
+	const double	*viewProj;			// column major, nullptr - every volume goes into every froxel
+	double			cameraPos[3];
+	bool			sortByDistance;
+
+	int				numberOfThreads;	// 0 for hardware concurrency
+
+	//! a constructor
+	CompositeFroxelSettings()
+		: tilesX(COMPOSITE_FROXEL_TILES_X)
+		, tilesY(COMPOSITE_FROXEL_TILES_Y)
+		, slices(COMPOSITE_FROXEL_SLICES)
+		, nearPlane(1.0)
+		, farPlane(4000.0)
+		, viewProj(nullptr)
+		, sortByDistance(true)
+		, numberOfThreads(0)
+	{
+		cameraPos[0] = cameraPos[1] = cameraPos[2] = 0.0;
+	}
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class CompositeFroxelClusters
+{
+public:
+
+	//! a constructor
+	CompositeFroxelClusters();
+
+	// forget the order of a previous frame
+	void Clear();
+
+	void Build(const std::vector<CompositeFroxelVolume> &volumes, const CompositeFroxelSettings &settings);
+
+	//! input volume indices, nearest first. Froxel lists store positions in this order
+	const std::vector<int> &GetOrder() const { return mOrder; }
+	//! two values per froxel - offset in the index list and number of volumes
+	const std::vector<uint32_t> &GetFroxels() const { return mFroxels; }
+	const std::vector<uint32_t> &GetIndices() const { return mIndices; }
+
+	int GetNumberOfFroxels() const { return mTilesX * mTilesY * mSlices; }
+	// grid size to pass into a shader, could differ from settings when they are out of range
+	int GetTilesX() const { return mTilesX; }
+	int GetTilesY() const { return mTilesY; }
+	int GetSlices() const { return mSlices; }
+
+	// volumes which are outside of the view
+	int GetNumberOfCulled() const { return mNumberOfCulled; }
+	// insertion sort moves in the last build, 0 when the order has not changed
+	int GetNumberOfSortMoves() const { return mNumberOfSortMoves; }
+
+	//! froxel of a world position, the same lookup as a shader does, -1 when there is no view projection
+	int FindFroxel(const double *worldPos) const;
+
+protected:
+
+	struct FroxelRange
+	{
+		int		x0, x1;
+		int		y0, y1;
+		int		z0, z1;		// empty range when z0 > z1
+	};
+
+	struct SortItem
+	{
+		const void	*key;
+		int			index;
+		double		dist;
+	};
+
+	int							mTilesX;
+	int							mTilesY;
+	int							mSlices;
+
+	double						mNearPlane;
+	double						mFarPlane;
+	double						mViewProj[16];
+	bool						mHasViewProj;
+
+	std::vector<SortItem>		mSorted;	// keeps the order between frames
+	std::vector<int>			mOrder;
+	std::vector<FroxelRange>	mRanges;	// per sorted volume
+
+	std::vector<uint32_t>		mFroxels;
+	std::vector<uint32_t>		mIndices;
+
+	int							mNumberOfCulled;
+	int							mNumberOfSortMoves;
+
+	void	SortVolumes(const std::vector<CompositeFroxelVolume> &volumes, const CompositeFroxelSettings &settings);
+	void	ComputeRange(const CompositeFroxelVolume &volume, FroxelRange &range) const;
+	int		ComputeSlice(const double viewDepth) const;
+};
+
+//! synthetic volumes against a per point froxel lookup, culling, list layout, frame to frame order
+//!  and threading, prints results into the log
+bool CompositeFroxelClustersSelfTest();
@@ -0,0 +1,274 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_nodeCache.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "compositeMaster_nodeCache.h"
+#include <string.h>
+
+// FNV-1a
+uint64_t CompositeHashBytes(const void *data, const size_t size, const uint64_t seed)
+{
+	const unsigned char *bytes = (const unsigned char*) data;
+	uint64_t hash = seed;
+
+	for (size_t i=0; i<size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+uint64_t CompositeHashProperties(FBComponent *pComponent, const uint64_t seed)
+{
+	const char *className = pComponent->ClassName();
+	uint64_t hash = CompositeHashBytes(className, strlen(className), seed);
+
+	double values[4];
+
+	for (int i=0, count=pComponent->PropertyList.GetCount(); i<count; ++i)
+	{
+		FBProperty *pProperty = pComponent->PropertyList[i];
+		if (nullptr == pProperty)
+			continue;
+
+		size_t size = 0;
+
+		switch(pProperty->GetPropertyType() )
+		{
+		case kFBPT_int:
+		case kFBPT_enum:
+			size = sizeof(int);
+			break;
+		case kFBPT_bool:
+			size = sizeof(bool);
+			break;
+		case kFBPT_float:
+			size = sizeof(float);
+			break;
+		case kFBPT_double:
+			size = sizeof(double);
+			break;
+		case kFBPT_Vector2D:
+			size = 2 * sizeof(double);
+			break;
+		case kFBPT_ColorRGB:
+		case kFBPT_Vector3D:
+			size = 3 * sizeof(double);
+			break;
+		case kFBPT_ColorRGBA:
+		case kFBPT_Vector4D:
+			size = 4 * sizeof(double);
+			break;
+		case kFBPT_charptr:
+			{
+				const char *str = pProperty->AsString();
+				if (nullptr != str)
+					hash = CompositeHashBytes(str, strlen(str), hash);
+			}
+			continue;
+		case kFBPT_object:
+			{
+				// referenced objects are connected to the property, they are hashed by identity,
+				//  so another mask texture or camera is a miss
+				const int numberOfObjects = pProperty->GetSrcCount();
+				hash = CompositeHashBytes(&numberOfObjects, sizeof(int), hash);
+
+				for (int j=0; j<numberOfObjects; ++j)
+				{
+					const FBPlug *pObject = pProperty->GetSrc(j);
+					hash = CompositeHashBytes(&pObject, sizeof(FBPlug*), hash);
+				}
+			}
+			continue;
+		default:
+			// actions and generic references
+			continue;
+		}
+
+		memset(values, 0, sizeof(values) );
+		pProperty->GetData(values, (int) size);
+		hash = CompositeHashBytes(values, size, hash);
+	}
+
+	return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeNodeCache
+
+CompositeNodeCache::CompositeNodeCache()
+	: mMemoryBudget(256 * 1024 * 1024)
+	, mMemoryUsage(0)
+	, mFrame(0)
+{}
+
+CompositeNodeCache::~CompositeNodeCache()
+{
+	Free();
+}
+
+void CompositeNodeCache::ChangeContext()
+{
+	// old context textures are not valid any more
+	mEntries.clear();
+	mPool.clear();
+	mMemoryUsage = 0;
+}
+
+void CompositeNodeCache::Free()
+{
+	for (auto iter=begin(mEntries); iter!=end(mEntries); ++iter)
+		glDeleteTextures(1, &iter->texId);
+	for (auto iter=begin(mPool); iter!=end(mPool); ++iter)
+		glDeleteTextures(1, &iter->texId);
+
+	mEntries.clear();
+	mPool.clear();
+	mMemoryUsage = 0;
+}
+
+void CompositeNodeCache::SetMemoryBudget(const size_t bytes)
+{
+	mMemoryBudget = bytes;
+}
+
+void CompositeNodeCache::BeginFrame()
+{
+	mFrame += 1;
+
+	// budget could become smaller
+	while (mMemoryUsage > mMemoryBudget)
+	{
+		if (false == EvictOne() )
+			break;
+	}
+}
+
+const GLuint CompositeNodeCache::Find(const uint64_t key, const int w, const int h)
+{
+	if (0 == key)
+		return 0;
+
+	for (auto iter=begin(mEntries); iter!=end(mEntries); ++iter)
+	{
+		if (iter->key == key && iter->width == w && iter->height == h)
+		{
+			iter->lastFrame = mFrame;
+			return iter->texId;
+		}
+	}
+	return 0;
+}
+
+bool CompositeNodeCache::Store(const uint64_t key, const GLuint srcTexId, const int w, const int h)
+{
+	if (0 == key || 0 == srcTexId || w <= 0 || h <= 0)
+		return false;
+
+	if (Find(key, w, h) > 0)
+		return true;
+
+	const GLuint texId = QueryATexture(w, h);
+	if (0 == texId)
+		return false;
+
+	glCopyImageSubData(srcTexId, GL_TEXTURE_2D, 0, 0, 0, 0,
+		texId, GL_TEXTURE_2D, 0, 0, 0, 0, w, h, 1);
+
+	Entry entry;
+	entry.key = key;
+	entry.texId = texId;
+	entry.width = w;
+	entry.height = h;
+	entry.lastFrame = mFrame;
+
+	mEntries.push_back(entry);
+	return true;
+}
+
+GLuint CompositeNodeCache::QueryATexture(const int w, const int h)
+{
+	// reuse a pooled texture of the same size
+
+	for (auto iter=begin(mPool); iter!=end(mPool); ++iter)
+	{
+		if (iter->width == w && iter->height == h)
+		{
+			const GLuint texId = iter->texId;
+			mPool.erase(iter);
+			return texId;
+		}
+	}
+
+	const size_t bytes = (size_t) w * h * 4;
+
+	while (mMemoryUsage + bytes > mMemoryBudget)
+	{
+		// evicted texture of the same size could be reused
+		if (false == EvictOne() )
+			return 0;
+
+		for (auto iter=begin(mPool); iter!=end(mPool); ++iter)
+		{
+			if (iter->width == w && iter->height == h)
+			{
+				const GLuint texId = iter->texId;
+				mPool.erase(iter);
+				return texId;
+			}
+		}
+	}
+
+	GLuint texId = 0;
+	glGenTextures(1, &texId);
+
+	glBindTexture(GL_TEXTURE_2D, texId);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, w, h);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	mMemoryUsage += bytes;
+	return texId;
+}
+
+bool CompositeNodeCache::EvictOne()
+{
+	// free pooled textures first, they are not the right size
+	if (mPool.size() > 0)
+	{
+		const Entry &entry = mPool.back();
+		glDeleteTextures(1, &entry.texId);
+		mMemoryUsage -= (size_t) entry.width * entry.height * 4;
+		mPool.pop_back();
+		return true;
+	}
+
+	// least recently used entry, which is not used in the current frame
+	int index = -1;
+	for (int i=0, count=(int) mEntries.size(); i<count; ++i)
+	{
+		if (mEntries[i].lastFrame == mFrame)
+			continue;
+		if (index < 0 || mEntries[i].lastFrame < mEntries[index].lastFrame)
+			index = i;
+	}
+
+	if (index < 0)
+		return false;
+
+	mPool.push_back(mEntries[index]);
+	mEntries.erase(mEntries.begin() + index);
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_nodeCache.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fbsdk/fbsdk.h>
+#include <GL\glew.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+	Result cache for composition nodes
+
+	every node result is keyed by a hash of node property values combined with a hash of its input,
+	 so a key changes when anything upstream has changed. Hash 0 means a result is not cacheable
+	 (depends on a scene render, composite mask or time) and breaks the chain for the nodes after it.
+
+	Results are copied into pooled rgba8 textures. Entries not used in the current frame are
+	 evicted by LRU when a new entry doesn't fit into the memory budget.
+*/
+
+#define COMPOSITE_HASH_SEED		14695981039346656037ULL
+
+uint64_t CompositeHashBytes(const void *data, const size_t size, const uint64_t seed);
+
+inline uint64_t CompositeHashCombine(const uint64_t seed, const uint64_t value)
+{
+	return CompositeHashBytes(&value, sizeof(uint64_t), seed);
+}
+
+// 0 is reserved for not cacheable results
+inline uint64_t CompositeHashNonZero(const uint64_t hash)
+{
+	return (0 == hash) ? 1 : hash;
+}
+
+//! evaluated values of number, vector, color, enum and string properties, identities of referenced objects
+uint64_t CompositeHashProperties(FBComponent *pComponent, const uint64_t seed);
+
+//////////////////////////////////////////////////////////////////
+//
+
+class CompositeNodeCache
+{
+public:
+
+	//! a constructor
+	CompositeNodeCache();
+	//! a destructor
+	~CompositeNodeCache();
+
+	// textures are lost with the context
+	void ChangeContext();
+	void Free();
+
+	void SetMemoryBudget(const size_t bytes);
+
+	// start of a composition render, entries used in a frame are not evicted
+	void BeginFrame();
+
+	//! texture with a cached result, 0 on a miss
+	const GLuint Find(const uint64_t key, const int w, const int h);
+	//! copy a result into the cache, false if it doesn't fit into the budget
+	bool Store(const uint64_t key, const GLuint srcTexId, const int w, const int h);
+
+	int GetNumberOfEntries() const { return (int) mEntries.size(); }
+	size_t GetMemoryUsage() const { return mMemoryUsage; }
+
+protected:
+
+	struct Entry
+	{
+		uint64_t		key;
+		GLuint			texId;
+		int				width;
+		int				height;
+		unsigned int	lastFrame;
+	};
+
+	std::vector<Entry>		mEntries;
+	std::vector<Entry>		mPool;		// textures without a result
+
+	size_t					mMemoryBudget;
+	size_t					mMemoryUsage;
+	unsigned int			mFrame;
+
+	GLuint QueryATexture(const int w, const int h);
+	bool EvictOne();
+};
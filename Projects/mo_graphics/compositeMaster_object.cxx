@@ -374,6 +374,29 @@ void ObjectCompositeBase::UnBindCompositeMask()
 	}
 }
 
+uint64_t ObjectCompositeBase::ComputeCacheHash(const CProcessingInfo &prInfo)
+{
+	// composite mask comes from the scene render
+	if (UseCompositeMask)
+		return 0;
+
+	const int size[2] = { prInfo.GetWidth(), prInfo.GetHeight() };
+
+	uint64_t hash = CompositeHashProperties(this, COMPOSITE_HASH_SEED);
+	hash = CompositeHashBytes(size, sizeof(size), hash);
+
+	return CompositeHashNonZero(hash);
+}
+
+void ObjectCompositeBase::PrepCPUNodeMask(CompositeCPUNode &node)
+{
+	// final mask object is the only composite mask texture, A-D are its channels
+	node.weight = 0.01f * (float) Opacity;
+	node.maskIndex = (UseCompositeMask) ? 0 : -1;
+	node.maskChannel = (int) SelectCompositeMask.AsInt();
+	node.invertMask = (InvertCompositeMask.AsInt() > 0);
+}
+
 void ObjectCompositeBase::SetCompositeMaskTextureId(const GLuint texid)
 {
 	mCompositeMaskTextureId = texid;
@@ -524,6 +547,18 @@ bool ObjectCompositeFilter::ReadyToApply(const CCompositionInfo *pInfo, const CP
 	return true;
 }
 
+uint64_t ObjectCompositeFilter::ComputeCacheHash(const CProcessingInfo &prInfo)
+{
+	// depth and normal buffers come from the scene render
+	if (nullptr != mProgramUniforms.get() 
+		&& (mProgramUniforms->IsDepthSamplerUsed() || mProgramUniforms->IsNormalSamplerUsed()) )
+	{
+		return 0;
+	}
+
+	return ParentClass::ComputeCacheHash(prInfo);
+}
+
 bool ObjectCompositeFilter::ApplyFilter(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo, CompositeFinalStats &stats, const GLuint sourceTexId, const GLuint dstTexId)
 {
 	const int w = prInfo.GetWidth();
@@ -901,6 +936,80 @@ bool ObjectCompositeLayer::BlendLayers(const CCompositionInfo *pInfo, const CPro
 	return true;
 }
 
+uint64_t ObjectCompositeLayer::ComputeCacheHash(const CProcessingInfo &prInfo)
+{
+	uint64_t hash = ParentClass::ComputeCacheHash(prInfo);
+
+	// local filters in the same order as ProcessFilters
+	const int count = GetSrcCount();
+	for (int i=0; i<count && hash != 0; ++i)
+	{
+		if (FBIS(GetSrc(i), ObjectCompositeFilter) )
+		{
+			ObjectCompositeFilter *pFilter = (ObjectCompositeFilter*) GetSrc(i);
+
+			if (pFilter->Active.AsInt() == 0 || 0.0 == pFilter->Opacity)
+				continue;
+
+			const uint64_t filterHash = pFilter->ComputeCacheHash(prInfo);
+			hash = (0 == filterHash) ? 0 : CompositeHashCombine(hash, filterHash);
+		}
+	}
+
+	return hash;
+}
+
+bool ObjectCompositeLayer::PrepCPUNode(CompositeCPUNode &node, const int layerIndex, const int width, const int height)
+{
+	node = CompositeCPUNode(eCompositeCPUBlend);
+	PrepCPUNodeMask(node);
+
+	node.blendMode = BlendMode;
+	node.wrapMode = TextureWrapMode;
+	node.layerIndex = layerIndex;
+
+	// the same values as UploadTransform sends to the blend shader
+	FBVector2d tr = Translation;
+	double rot = Rotation;
+	double uniform = UniformScaling;
+	FBVector2d scl = Scaling;
+	FBVector2d pivot = PivotOffset;
+
+	if (uniform != 0.0) uniform = 100.0 / uniform;
+	if (scl[0] != 0.0) scl[0] = uniform * 100.0 / scl[0];
+	if (scl[1] != 0.0) scl[1] = uniform * 100.0 / scl[1];
+
+	node.translation[0] = 0.01f * (float) tr[0];
+	node.translation[1] = 0.01f * (float) tr[1];
+	node.rotation = nv_to_rad * (float) rot;
+	node.scaling[0] = (float) scl[0];
+	node.scaling[1] = (float) scl[1];
+	node.pivotOffset[0] = 0.01f * (float) pivot[0];
+	node.pivotOffset[1] = 0.01f * (float) pivot[1];
+	node.numberOfPasses = NumberOfPasses.AsInt();
+
+	// local filters in the same order as ProcessFilters
+	const int count = GetSrcCount();
+	for (int i=0; i<count; ++i)
+	{
+		if (FBIS(GetSrc(i), ObjectCompositeFilter) )
+		{
+			ObjectCompositeFilter *pFilter = (ObjectCompositeFilter*) GetSrc(i);
+
+			if (pFilter->Active.AsInt() == 0 || 0.0 == pFilter->Opacity)
+				continue;
+
+			CompositeCPUNode filterNode;
+			if (pFilter->PrepCPUNode(filterNode, width, height) )
+				node.layerFilters.push_back(filterNode);
+			else
+				printf("[CompositeCPU] filter %s has no CPU implementation, skipped\n", pFilter->Name.AsString() );
+		}
+	}
+
+	return true;
+}
+
 bool ObjectCompositeLayer::PlugDataNotify(FBConnectionAction pAction,FBPlug* pThis,void* pData,void* pDataOld,int pDataSize)
 {
 	if (pAction == kFBCandidated && (pThis == &BlendMode) )
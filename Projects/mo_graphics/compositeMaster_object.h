@@ -21,6 +21,8 @@
 #include "compositeMaster_common.h"
 #include "compositeMaster_shaders.h"
 #include "compositeMaster_computeShaders.h"
+#include "compositeMaster_cpuBackend.h"
+#include "compositeMaster_nodeCache.h"
 #include "MB_renderer.h"
 #include "algorithm\math3d.h"
 #include "graphics_framebuffer.h"
@@ -465,6 +467,9 @@ public:
 
 		return true;
 	}
+
+	// hash of a node result for the result cache, 0 if result depends on the scene
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo);
 	/*
 	virtual bool ApplyEffect(const CObjectCompositionInfo *pInfo, CompositeFinalStats &stats, const GLuint sourceTexId, const GLuint dstTexId)
 	{
@@ -490,6 +495,9 @@ public:
 	void BindCompositeMask();
 	void UnBindCompositeMask();
 
+	// opacity and composite mask of a CPU backend node
+	void PrepCPUNodeMask(CompositeCPUNode &node);
+
 	
 protected:
 	bool	mNeedProgramReload;
@@ -558,6 +566,14 @@ public:
 	virtual bool ReadyToApply(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo) override;
 	virtual bool ApplyFilter(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo, CompositeFinalStats &stats, const GLuint sourceTexId, const GLuint dstTexId);
 
+	// fill a node for the CPU backend, false if filter has no CPU implementation
+	virtual bool PrepCPUNode(CompositeCPUNode &node, const int width, const int height)
+	{
+		return false;
+	}
+
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override;
+
 protected:
 
 	CompositeComputeShader::CMixedProgram		*mProgram;
@@ -593,14 +609,6 @@ protected:
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ObjectCompositeLayer
 
-enum ETextureWrapMode
-{
-	eTextureWrapClampToZero,
-	eTextureWrapClampToEdge,
-	eTextureWrapMirroredRepeat,
-	eTextureWrapRepeat
-};
-
 // TODO: add input source dimentions (input image size)
 
 class ObjectCompositeLayer : public ObjectCompositeBase
@@ -678,6 +686,12 @@ public:
 	const int GetNumberOfFilters(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo, bool checkFilterReadyState);
 	bool ProcessFilters(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo, CompositeFinalStats &stats);
 
+	// layer properties and its filters
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override;
+
+	// blend node and layer filters for the CPU backend, layer image is supplied by the caller
+	bool PrepCPUNode(CompositeCPUNode &node, const int layerIndex, const int width, const int height);
+
 protected:
 
 	GLuint					mLastLayerTextureId;
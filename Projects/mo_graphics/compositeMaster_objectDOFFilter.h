@@ -37,6 +37,11 @@ class ObjectFilter3dDOF : public ObjectCompositeFilter
 public:
 	ObjectFilter3dDOF(const char *pName = NULL, HIObject pObject=NULL);
 
+	// depends on a scene depth, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
 	//--- FiLMBOX Construction/Destruction,
 	virtual bool FBCreate() override;		//!< FiLMBOX Creation function.
 	virtual void FBDestroy() override;		//!< FiLMBOX Destruction function.
@@ -17,6 +17,8 @@
 #include "IO\tga.h"
 #include "graphics\CheckGLError_MOBU.h"
 #include <shellapi.h>
+#include <stdlib.h>
+#include <algorithm>
 
 FBClassImplementation2(ObjectFilter3dDecal)
 FBUserObjectImplement(ObjectFilter3dDecal, "Composition 3d Decal", EFFECT_ICON);					//Register UserObject class
@@ -33,6 +35,57 @@ const char * FBPropertyBaseEnum<EDecalResolution>::mStrings[] = {
 	*/
 ////////////////////////////////////////////////////////////////////////////////////////////////// PROCS
 
+// tga files go through the background texture exchange
+static bool IsExchangeFile(const char *filename)
+{
+	const size_t len = (filename) ? strlen(filename) : 0;
+	return len > 4 && 0 == _stricmp(filename + len - 4, ".tga");
+}
+
+static FBString GetDecalImageFile(ModelDecal *pDecal)
+{
+	if (pDecal->Texture.GetCount() == 0)
+		return FBString("");
+
+	FBTexture *pTexture = (FBTexture*) pDecal->Texture.GetAt(0);
+	FBVideo *pVideo = pTexture->Video;
+
+	if (FBIS(pVideo, FBVideoClip) )
+		return ( (FBVideoClip*) pVideo)->Filename;
+
+	return FBString("");
+}
+
+static void UploadExchangeLevels(GLuint &texId, const std::vector<CompositeTextureLevel> &levels)
+{
+	if (levels.size() == 0)
+		return;
+
+	if (texId == 0)
+		glGenTextures(1, &texId);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (int i=0, count=(int) levels.size(); i<count; ++i)
+	{
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, levels[i].width, levels[i].height, 0, 
+			GL_RGBA, GL_UNSIGNED_BYTE, levels[i].rgba.data() );
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	CHECK_GL_ERROR_MOBU();
+}
+
 void ObjectFilter3dDecal::AddPropertyView(const char* pPropertyName, const char* pHierarchy, bool pIsFolder)
 {
 	FBPropertyViewManager::TheOne().AddPropertyView(FILTER3DDECAL__CLASSSTR, pPropertyName, pHierarchy);
@@ -92,6 +145,7 @@ bool ObjectFilter3dDecal::FBCreate()
 	FBPropertyPublish(this, CreateDecal, "Create Decal", nullptr, SetCreateDecal);
 	FBPropertyPublish(this, RefreshTexture, "Refresh Texture", nullptr, SetRefreshTexture);
 	FBPropertyPublish(this, GrabImage, "Grab Image", nullptr, SetGrabImage);
+	FBPropertyPublish(this, TestExchange, "Test Texture Exchange", nullptr, SetTestExchange);
 
 	FBPropertyPublish(this, RunPhotoshopOnCreation, "Run PS On Creation", nullptr, nullptr);
 	FBPropertyPublish(this, PhotoshopPath, "PS Path", nullptr, nullptr);
@@ -115,6 +169,8 @@ bool ObjectFilter3dDecal::FBCreate()
 	// DecalObjects.SetFilter( ModelFogVolume::GetInternalClassId() );
 	UseModelProperties = true;
 
+	mExchange.Start();
+
 	return ParentClass::FBCreate();
 }
 
@@ -124,6 +180,9 @@ bool ObjectFilter3dDecal::FBCreate()
 
 void ObjectFilter3dDecal::FBDestroy()
 {
+	mExchange.Stop();
+	FreeExchangeTextures();
+
 	ParentClass::FBDestroy();
 }
 
@@ -188,6 +247,16 @@ void ObjectFilter3dDecal::SetGrabImage(HIObject object, bool value)
 		pBase->DoGrabImage();
 	}
 }
+
+void ObjectFilter3dDecal::SetTestExchange(HIObject object, bool value)
+{
+	ObjectFilter3dDecal *pBase = FBCast<ObjectFilter3dDecal>(object);
+	if (pBase && value) 
+	{
+		const char *folder = getenv("TEMP");
+		CompositeTextureExchangeSelfTest( (folder) ? folder : "." );
+	}
+}
 /*
 void ObjectFilter3dDecal::SetResolution(HIObject object, EDecalResolution value)
 {
@@ -316,6 +385,33 @@ void ObjectFilter3dDecal::DoSaveTextureToFile(const GLuint texId, const char *fi
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void ObjectFilter3dDecal::DoSaveTextureAsync(const GLuint texId, const char *filename, bool needResize, int newWidth, int newHeight)
+{
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texId);
+
+	int width = 0;
+	int height = 0;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+
+	if (width <= 0 || height <= 0)
+	{
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return;
+	}
+
+	// only a readback stays on the main thread, resize and encode are done by the exchange worker
+	CompositeCPUImage image;
+	image.Init(width, height);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, image.pixels.data() );
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	CHECK_GL_ERROR_MOBU();
+
+	mExchange.SaveAsync(this, filename, image, (needResize) ? newWidth : 0, (needResize) ? newHeight : 0);
+}
+
 void ObjectFilter3dDecal::DoRunPhotoshop(const char *psPath, const char *filename)
 {
 	SHELLEXECUTEINFO ShExecInfo = {0};
@@ -519,6 +615,102 @@ void ObjectFilter3dDecal::DoRefreshTexture()
 
 		pDecal->RefreshConnectedTexture();
 	}
+
+	// reloaded images are dropped, the refreshed texture is used until the next file change
+	FreeExchangeTextures();
+}
+
+void ObjectFilter3dDecal::FreeExchangeTextures()
+{
+	for (auto iter=mExchangeDecals.begin(); iter!=mExchangeDecals.end(); ++iter)
+	{
+		if (iter->second.texId > 0)
+		{
+			glDeleteTextures(1, &iter->second.texId);
+			iter->second.texId = 0;
+		}
+	}
+}
+
+void ObjectFilter3dDecal::UpdateExchange()
+{
+	// watch image files of the current decals
+
+	std::map<FBComponent*, ExchangeDecal> decals;
+
+	const int decalCount = ComputeRealDecalCount();
+	for (int i=0; i<decalCount && i<MAX_DECALS_COUNT; ++i)
+	{
+		ModelDecal *pDecal = (ModelDecal*) GetRealDecal(i);
+		if (pDecal == nullptr)
+			continue;
+
+		FBString filename = GetDecalImageFile(pDecal);
+		if (false == IsExchangeFile(filename) )
+			continue;
+
+		ExchangeDecal &decal = decals[pDecal];
+		decal.filename = filename;
+		decal.texId = 0;
+
+		auto iter = mExchangeDecals.find(pDecal);
+		if (iter != mExchangeDecals.end() && iter->second.filename == decal.filename)
+		{
+			decal.texId = iter->second.texId;
+			iter->second.texId = 0;
+		}
+
+		mExchange.Watch(pDecal, decal.filename.c_str() );
+	}
+
+	// disconnected decals or another image file
+
+	for (auto iter=mExchangeDecals.begin(); iter!=mExchangeDecals.end(); ++iter)
+	{
+		if (decals.find(iter->first) == decals.end() )
+			mExchange.Unwatch(iter->first);
+	}
+
+	FreeExchangeTextures();
+	std::swap(mExchangeDecals, decals);
+
+	// ready results of the worker
+
+	std::vector<CompositeExchangeResult> results;
+	mExchange.CollectResults(results);
+
+	for (auto iter=results.begin(); iter!=results.end(); ++iter)
+	{
+		if (iter->key == this)
+		{
+			// save of a grabbed image is finished
+			mExchange.Unwatch(this);
+
+			auto pendingIter = std::find(mPendingDecals.begin(), mPendingDecals.end(), iter->filename);
+			if (pendingIter == mPendingDecals.end() )
+				continue;
+
+			mPendingDecals.erase(pendingIter);
+
+			if (iter->type == eCompositeExchangeSaved)
+			{
+				if (RunPhotoshopOnCreation)
+				{
+					DoRunPhotoshop(PhotoshopPath.AsString(), iter->filename.c_str() );
+				}
+
+				ConnectOrUpdateDecal(iter->filename.c_str() );
+			}
+		}
+		else if (iter->type == eCompositeExchangeLoaded)
+		{
+			auto decalIter = mExchangeDecals.find( (FBComponent*) iter->key);
+			if (decalIter != mExchangeDecals.end() && decalIter->second.filename == iter->filename)
+			{
+				UploadExchangeLevels(decalIter->second.texId, iter->levels);
+			}
+		}
+	}
 }
 
 void ObjectFilter3dDecal::OnApplyFilter(	EApplyFilterStage stage, 
@@ -533,6 +725,12 @@ void ObjectFilter3dDecal::OnApplyFilter(	EApplyFilterStage stage,
 	//		save as a file
 	//		run photoshop for file editing 
 	//
+	if (stage == eBeforeProgramBind)
+	{
+		// swap decal textures with images reloaded since the last frame
+		UpdateExchange();
+	}
+
 	if (stage == eBeforeProgramBind && (mCreateNewDecal || mGrabImage))
 	{
 		mGrabImage = false;
@@ -542,7 +740,7 @@ void ObjectFilter3dDecal::OnApplyFilter(	EApplyFilterStage stage,
 		FBFilePopup		lDialog;
 		lDialog.Caption = "Please enter a filename to save into";
 		lDialog.Style = kFBFilePopupSave;
-		lDialog.Filter = "*.tif";
+		lDialog.Filter = "*.tga";
 
 		if (lDialog.Execute() )
 		{
@@ -572,7 +770,21 @@ void ObjectFilter3dDecal::OnApplyFilter(	EApplyFilterStage stage,
 					saveId, dstW, dstH);
 			}
 
-			DoSaveTextureToFile( saveId, imageFileName, true, CustomWidth, CustomHeight);
+			if (IsExchangeFile(imageFileName) )
+			{
+				// decal is created when the worker has written the file
+				DoSaveTextureAsync( saveId, imageFileName, true, CustomWidth, CustomHeight);
+
+				if (mCreateNewDecal)
+				{
+					mCreateNewDecal = false;
+					mPendingDecals.push_back(imageFileName);
+				}
+			}
+			else
+			{
+				DoSaveTextureToFile( saveId, imageFileName, true, CustomWidth, CustomHeight);
+			}
 			
 			mCroppedTexture.FreeLayersData();
 
@@ -604,6 +816,15 @@ void ObjectFilter3dDecal::OnApplyFilter(	EApplyFilterStage stage,
 				break;
 
 			ModelDecal *pDecal = (ModelDecal*) GetRealDecal(i);
+			
+			auto iter = mExchangeDecals.find(pDecal);
+			if (iter != mExchangeDecals.end() && iter->second.texId > 0)
+			{
+				glActiveTexture(GL_TEXTURE3 + i);
+				glBindTexture(GL_TEXTURE_2D, iter->second.texId);
+				continue;
+			}
+
 			//pDecal->MakeTextureResident();
 			pDecal->BindTexture(3+i);
 		}
@@ -637,6 +858,15 @@ void ObjectFilter3dDecal::OnApplyFilter(	EApplyFilterStage stage,
 				break;
 
 			ModelDecal *pDecal = (ModelDecal*) GetRealDecal(i);
+			
+			auto iter = mExchangeDecals.find(pDecal);
+			if (iter != mExchangeDecals.end() && iter->second.texId > 0)
+			{
+				glActiveTexture(GL_TEXTURE3 + i);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				continue;
+			}
+
 			//pDecal->MakeTextureNonResident();
 			pDecal->UnBindTexture(3+i);
 		}
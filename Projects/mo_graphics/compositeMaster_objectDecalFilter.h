@@ -15,9 +15,11 @@
 #include "compositeMaster_object.h"
 
 #include <map>
+#include <string>
 #include "algorithm\nv_math.h"
 #include "graphics\OGL_Utils.h"
 #include "graphics\UniformBuffer.h"
+#include "compositeMaster_textureExchange.h"
 
 #define FILTER3DDECAL__CLASSNAME				ObjectFilter3dDecal
 #define FILTER3DDECAL__CLASSSTR					"ObjectFilter3dDecal"
@@ -44,6 +46,11 @@ class ObjectFilter3dDecal : public ObjectCompositeFilter
 public:
 	ObjectFilter3dDecal(const char *pName = NULL, HIObject pObject=NULL);
 
+	// depends on a scene depth and projectors, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
 	//--- FiLMBOX Construction/Destruction,
 	virtual bool FBCreate() override;		//!< FiLMBOX Creation function.
 	virtual void FBDestroy() override;		//!< FiLMBOX Destruction function.
@@ -77,10 +84,12 @@ public:
 	FBPropertyAction				RefreshTexture;
 
 	FBPropertyAction				GrabImage;	//!< save to file an incoming composition texture data
+	FBPropertyAction				TestExchange;	//!< save and reload synthetic images through the texture exchange
 
 	static void SetCreateDecal(HIObject object, bool value);
 	static void SetRefreshTexture(HIObject object, bool value);
 	static void SetGrabImage(HIObject object, bool value);
+	static void SetTestExchange(HIObject object, bool value);
 	//static void SetResolution(HIObject object, EDecalResolution value);
 
 protected:
@@ -181,5 +190,22 @@ protected:
 		const int dstWidth,
 		const int dstHeight);
 	void DoSaveTextureToFile(const GLuint texId, const char *filename, bool needResize, int newWidth, int newHeight);
+	void DoSaveTextureAsync(const GLuint texId, const char *filename, bool needResize, int newWidth, int newHeight);
 	void DoRunPhotoshop(const char *psPath, const char *filename);
+
+protected:
+
+	// tga images of decals are saved and reloaded on a background thread
+	struct ExchangeDecal
+	{
+		std::string		filename;
+		GLuint			texId;		// reloaded image with mips, 0 until the file is changed
+	};
+
+	CompositeTextureExchange				mExchange;
+	std::map<FBComponent*, ExchangeDecal>	mExchangeDecals;
+	std::vector<std::string>				mPendingDecals;		// files to create a decal with, when they are saved
+
+	void UpdateExchange();
+	void FreeExchangeTextures();
 };
\ No newline at end of file
@@ -118,6 +118,24 @@ ObjectFilterColorCorrection::ObjectFilterColorCorrection( const char* pName, HIO
 	mProgramUniformsColor = (ProgramUniformsColor*) mProgramUniforms.get();
 }
 
+bool ObjectFilterColorCorrection::PrepCPUNode(CompositeCPUNode &node, const int width, const int height)
+{
+	node = CompositeCPUNode(eCompositeCPUColorCorrection);
+	PrepCPUNodeMask(node);
+
+	node.contrast = 1.0f + 0.01f * (float) Contrast;
+	node.brightness = 1.0f + 0.01f * (float) Brightness;
+	node.saturation = 1.0f + 0.01f * (float) Saturation;
+	node.gamma = 0.01f * (float) Gamma;
+
+	node.hue = 0.01f * (float) Hue;
+	node.hueSaturation = 0.01f * (float) HueSaturation;
+	node.lightness = 0.01f * (float) Lightness;
+	node.inverse = (Inverse.AsInt() > 0);
+
+	return true;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Blur system
@@ -469,6 +487,25 @@ bool ObjectFilterBlur::ApplyFilter(const CCompositionInfo *pInfo, const CProcess
 	return true;
 }
 
+bool ObjectFilterBlur::PrepCPUNode(CompositeCPUNode &node, const int width, const int height)
+{
+	mData.w = width;
+	mData.h = height;
+
+	PrepData();
+
+	if (mData.horzFactor == 0.0 && mData.vertFactor == 0.0)
+		return false;
+
+	// blur system doesn't use a composite mask
+	node = CompositeCPUNode(eCompositeCPUBlur);
+	node.weight = mData.opacity;
+	node.blurScale[0] = 0.0001f * (float) mData.horzFactor;
+	node.blurScale[1] = 0.0001f * (float) mData.vertFactor;
+
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Half tone Filter
 
@@ -553,6 +590,17 @@ ObjectFilterPosterization::ObjectFilterPosterization( const char* pName, HIObjec
 	mProgramUniformsPosterization = (ProgramUniformsPosterization*) mProgramUniforms.get();
 }
 
+bool ObjectFilterPosterization::PrepCPUNode(CompositeCPUNode &node, const int width, const int height)
+{
+	node = CompositeCPUNode(eCompositeCPUPosterization);
+	PrepCPUNodeMask(node);
+
+	node.numberOfColors = 0.1f * (float) NumberOfColors;
+	node.gamma = 0.01f * (float) Gamma;
+
+	return true;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Change Color Filter
@@ -126,6 +126,10 @@ public:
 	FBPropertyAnimatableDouble		HueSaturation;
 	FBPropertyAnimatableDouble		Lightness;
 
+public:
+
+	virtual bool PrepCPUNode(CompositeCPUNode &node, const int width, const int height) override;
+
 protected:
 
 	virtual const char *AssetNameString() override {
@@ -368,6 +372,8 @@ public:
 	virtual bool ReadyToApply(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo) override;
 	virtual bool ApplyFilter(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo, CompositeFinalStats &stats, const GLuint sourceTexId, const GLuint dstTexId) override;
 
+	virtual bool PrepCPUNode(CompositeCPUNode &node, const int width, const int height) override;
+
 protected:
 	
 	virtual const char *AssetNameString() override {
@@ -484,7 +490,11 @@ public:
 	
 	FBPropertyAnimatableDouble		NumberOfColors;
 	FBPropertyAnimatableDouble		Gamma;
-	
+
+public:
+
+	virtual bool PrepCPUNode(CompositeCPUNode &node, const int width, const int height) override;
+
 protected:
 
 	virtual const char *AssetNameString() override {
@@ -648,6 +658,11 @@ public:
 	//! a constructor
 	ObjectFilterFilmGrain(const char *pName = NULL, HIObject pObject=NULL);
 
+	// grain is animated with a timer, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
     virtual bool UseCustomPropertyViewSet() const override { return true; }
 	static void AddPropertiesToPropertyViewManager();
 
@@ -837,6 +852,11 @@ public:
 	//! a constructor
 	ObjectFilterToonLines (const char *pName = NULL, HIObject pObject=NULL);
 
+	// depends on a scene depth and normals, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
     virtual bool UseCustomPropertyViewSet() const override { return true; }
 	static void AddPropertiesToPropertyViewManager();
 
@@ -941,6 +961,11 @@ public:
 	//! a constructor
 	ObjectFilterSSAO (const char *pName = NULL, HIObject pObject=NULL);
 
+	// depends on a scene depth and normals, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
 public:
 
 	FBPropertyDouble		DistanceThreshold;
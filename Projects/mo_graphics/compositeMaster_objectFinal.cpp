@@ -15,6 +15,10 @@
 #include "compositeMaster_object.h"
 #include "compositemaster_common.h"
 #include "compositeMaster_shaders.h"
+#include "compositeMaster_objectFilters.h"
+#include "compositeMaster_objectLUTFilter.h"
+#include "compositeMaster_batch.h"
+#include "compositeMaster_froxels.h"
 #include "graphics\fpTexture.h"
 #include "graphics\CheckGLError_MOBU.h"
 #include "IO\FileUtils.h"
@@ -47,7 +51,9 @@ const char *stats_names[eCompositionStatsCount] = {
 		"Stats Compute Shaders",
 		"Stats Dispatch Groups",
 		"Stats Textures Count",
-		"Stats Textures Memory"
+		"Stats Textures Memory",
+		"Stats Cache Hits",
+		"Stats Cache Misses"
 	};
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -344,6 +350,66 @@ void ObjectComposition::SetSizeFromBackground(HIObject object, bool value)
 		pFinal->mBackground->SetUserSize(pFinal->GetBackgroundWidth(), pFinal->GetBackgroundHeight());
 	}
 }
+
+void ObjectComposition::SetCPUBenchmark(HIObject object, bool value)
+{
+	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
+	if (pFinal && value) 
+	{
+		const int w = (pFinal->mProcessingWidth > 0) ? pFinal->mProcessingWidth : 1920;
+		const int h = (pFinal->mProcessingHeight > 0) ? pFinal->mProcessingHeight : 1080;
+
+		std::vector<CompositeCPUBenchmarkResult> results;
+		CompositeCPUBenchmark(w, h, 10, CompositeCPUOptions(), results);
+	}
+}
+
+void ObjectComposition::SetCPUReferenceTest(HIObject object, bool value)
+{
+	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
+	if (pFinal && value) 
+	{
+		CompositeCPUReferenceSelfTest();
+	}
+}
+
+void ObjectComposition::SetShaderCacheTest(HIObject object, bool value)
+{
+	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
+	if (pFinal && value) 
+	{
+		const char *folder = getenv("TEMP");
+		CompositeShaderCacheSelfTest( (folder) ? folder : "." );
+	}
+}
+
+void ObjectComposition::SetFroxelClustersTest(HIObject object, bool value)
+{
+	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
+	if (pFinal && value) 
+	{
+		CompositeFroxelClustersSelfTest();
+	}
+}
+
+void ObjectComposition::SetBatchSelfTest(HIObject object, bool value)
+{
+	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
+	if (pFinal && value) 
+	{
+		const char *folder = getenv("TEMP");
+		CompositeBatchSelfTest( (folder) ? folder : "." );
+	}
+}
+
+void ObjectComposition::SetProcessBatch(HIObject object, bool value)
+{
+	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
+	if (pFinal && value) 
+	{
+		pFinal->RenderVideoBatches();
+	}
+}
 			
 void ObjectComposition::SetQuality(HIObject object, ECompositionQuality value)
 {
@@ -438,6 +504,26 @@ int ObjectComposition::GetStatsNumberOfDispatchGroups(HIObject object)
 	return 1;
 }
 
+int ObjectComposition::GetStatsCacheHits(HIObject object)
+{
+	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
+	if (pFinal) 
+	{
+		return pFinal->GetStats().cacheHits;
+	}
+	return 0;
+}
+
+int ObjectComposition::GetStatsCacheMisses(HIObject object)
+{
+	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
+	if (pFinal) 
+	{
+		return pFinal->GetStats().cacheMisses;
+	}
+	return 0;
+}
+
 int ObjectComposition::GetStatsNumberOfTextures(HIObject object)
 {
 	ObjectComposition *pFinal = FBCast<ObjectComposition>(object);
@@ -489,6 +575,11 @@ void ObjectComposition::AddPropertiesToPropertyViewManager()
 
 	for (int i=0; i<eCompositionStatsCount; ++i)
 		AddPropertyViewForCompositionFinal( stats_names[i], "Statistics" );
+	AddPropertyViewForCompositionFinal("CPU Benchmark", "Statistics");
+	AddPropertyViewForCompositionFinal("CPU Reference Test", "Statistics");
+	AddPropertyViewForCompositionFinal("Shader Cache Test", "Statistics");
+	AddPropertyViewForCompositionFinal("Use Result Cache", "Statistics");
+	AddPropertyViewForCompositionFinal("Result Cache Budget", "Statistics");
 
 	AddPropertyViewForCompositionFinal("", "Background", true);
 	AddPropertyViewForCompositionFinal("Background Width", "Background");
@@ -515,6 +606,10 @@ void ObjectComposition::AddPropertiesToPropertyViewManager()
 	AddPropertyViewForCompositionFinal("Use For Batch Processing", "Batch processing");
 	AddPropertyViewForCompositionFinal("Batch input", "Batch processing");
 	AddPropertyViewForCompositionFinal("Batch output", "Batch processing");
+	AddPropertyViewForCompositionFinal("Batch Output Folder", "Batch processing");
+	AddPropertyViewForCompositionFinal("Batch Resume", "Batch processing");
+	AddPropertyViewForCompositionFinal("Process Batch", "Batch processing");
+	AddPropertyViewForCompositionFinal("Batch Self Test", "Batch processing");
 
 	AddPropertyViewForCompositionFinal("Input", "");
 	AddPropertyViewForCompositionFinal("Out Width", "");
@@ -546,6 +641,12 @@ ObjectComposition::ObjectComposition( const char* pName, HIObject pObject )
 	
 	//FBPropertyPublish(this, SizeControl, "Size Control", nullptr, nullptr );
 	FBPropertyPublish(this, SizeFromBackground, "Size From Back Texture", nullptr, SetSizeFromBackground);
+	FBPropertyPublish(this, CPUBenchmark, "CPU Benchmark", nullptr, SetCPUBenchmark);
+	FBPropertyPublish(this, CPUReferenceTest, "CPU Reference Test", nullptr, SetCPUReferenceTest);
+	FBPropertyPublish(this, ShaderCacheTest, "Shader Cache Test", nullptr, SetShaderCacheTest);
+	FBPropertyPublish(this, FroxelClustersTest, "Froxel Clusters Test", nullptr, SetFroxelClustersTest);
+	FBPropertyPublish(this, UseResultCache, "Use Result Cache", nullptr, nullptr);
+	FBPropertyPublish(this, ResultCacheBudget, "Result Cache Budget", nullptr, nullptr);
 
 	FBPropertyPublish(this, ManualUpdate, "Manual Update", nullptr, nullptr );
 	FBPropertyPublish(this, Update, "Update", nullptr, SetUpdate );
@@ -564,6 +665,10 @@ ObjectComposition::ObjectComposition( const char* pName, HIObject pObject )
 
 	FBPropertyPublish(this, BatchInput, "Batch input", nullptr, nullptr);
 	FBPropertyPublish(this, BatchOutput, "Batch output", nullptr, nullptr);
+	FBPropertyPublish(this, BatchOutputFolder, "Batch Output Folder", nullptr, nullptr);
+	FBPropertyPublish(this, BatchResume, "Batch Resume", nullptr, nullptr);
+	FBPropertyPublish(this, ProcessBatch, "Process Batch", nullptr, SetProcessBatch);
+	FBPropertyPublish(this, BatchSelfTest, "Batch Self Test", nullptr, SetBatchSelfTest);
 
 	//
 	//
@@ -601,7 +706,9 @@ ObjectComposition::ObjectComposition( const char* pName, HIObject pObject )
 		(fbExternalGetSetHandler) GetStatsNumberOfComputeShaders,
 		(fbExternalGetSetHandler) GetStatsNumberOfDispatchGroups,
 		(fbExternalGetSetHandler) GetStatsNumberOfTextures,
-		(fbExternalGetSetHandler) GetStatsTexturesMemory
+		(fbExternalGetSetHandler) GetStatsTexturesMemory,
+		(fbExternalGetSetHandler) GetStatsCacheHits,
+		(fbExternalGetSetHandler) GetStatsCacheMisses
 	};
 
 	for (int i=0; i<eCompositionStatsCount; ++i)
@@ -614,6 +721,11 @@ ObjectComposition::ObjectComposition( const char* pName, HIObject pObject )
 	mBackground->Input->SetInt( eCompositionInputRender );
 
 	UseForBatchProcessing = false;
+	UseResultCache = true;
+	ResultCacheBudget = 256;
+	ResultCacheBudget.SetMinMax(0.0, 4096.0, true, false);
+	BatchOutputFolder = "";
+	BatchResume = true;
 	//BatchAutoSize = false;
 
 	Cameras.SetSingleConnect(false);
@@ -645,6 +757,8 @@ ObjectComposition::ObjectComposition( const char* pName, HIObject pObject )
 	mNeedUpdate = true;
 
 	mBatchBufferId = 0;
+	mNumberOfBatchTextures = 0;
+	mBatchResultsChanged = false;
 	/*
 	mRenderX = 0;
 	mRenderY = 0;
@@ -743,6 +857,7 @@ bool ObjectComposition::FBCreate()
 void ObjectComposition::FBDestroy()
 {
 	mSystem.OnUIIdle.Remove( this, (FBCallback) &ObjectComposition::EventIdle );
+	mNodeCache.Free();
 	ParentClass::FBDestroy();
 }
 
@@ -1091,31 +1206,23 @@ void ObjectComposition::Render()
 
 	mStats.Clear();
 
-	if (UseForBatchProcessing && (BatchInput.GetCount() > 0) )
-	{
-		if (BatchInput.GetCount() != BatchOutput.GetCount() )
-		{
-			// TODO: sync input and output textures
-		}
+	// NOTE: batch sequences are processed on demand with the ProcessBatch action
+	if (mBatchResultsChanged)
+		UpdateBatchOutput();
 
-		RenderVideoBatches();
-	}
-	else
-	{
-		// count the 2 texture buffers and 1 more for background
-		mStats.CountTextures( 3, mProcessingWidth * mProcessingHeight * 4 );
+	// count the 2 texture buffers and 1 more for background
+	mStats.CountTextures( 3, mProcessingWidth * mProcessingHeight * 4 );
 
-		RenderLayers(allowToUseDirectTextureId);
+	RenderLayers(allowToUseDirectTextureId);
 
-		// output
-		if (Video.GetCount() > 0)
+	// output
+	if (Video.GetCount() > 0)
+	{
+		if ( FBIS(Video.GetAt(0), FBVideoMemory) )
 		{
-			if ( FBIS(Video.GetAt(0), FBVideoMemory) )
-			{
-				FBVideoMemory *pVideo = (FBVideoMemory*) Video.GetAt(0);
-				pVideo->SetObjectImageSize(mProcessingWidth, mProcessingHeight);
-				pVideo->TextureOGLId = mTextureBuffer.GetCurrentTextureId();
-			}
+			FBVideoMemory *pVideo = (FBVideoMemory*) Video.GetAt(0);
+			pVideo->SetObjectImageSize(mProcessingWidth, mProcessingHeight);
+			pVideo->TextureOGLId = mTextureBuffer.GetCurrentTextureId();
 		}
 	}
 
@@ -1130,27 +1237,95 @@ void ObjectComposition::Render()
 
 void ObjectComposition::RenderLayers(bool allowToReturnDirectTextureId)
 {
-	
-	bool shaderOk = true;
-	GLuint backgroundId = mBackground->ComputeTexture( mInfo.get(), mStats, mTextureBuffer.GetCurrentTextureId(), allowToReturnDirectTextureId );
+	const int srccount = GetSrcCount();
+	const CProcessingInfo	prInfo(mProcessingWidth, mProcessingHeight);
+
+	const bool useCache = UseResultCache;
+
+	mNodeCache.SetMemoryBudget( (size_t) std::max(0, ResultCacheBudget.AsInt()) * 1024 * 1024 );
+	mNodeCache.BeginFrame();
+
+	// collect nodes to apply with a hash of their results
+
+	uint64_t chainHash = (useCache) ? mBackground->ComputeCacheHash(mProcessingWidth, mProcessingHeight) : 0;
+	mRenderSteps.clear();
+
+	for (int i=0; i<srccount; ++i)
+	{
+		FBComponent *pSrc = (FBComponent*) GetSrc(i);
+
+		if (false == FBIS(pSrc, ObjectCompositeLayer) && false == FBIS(pSrc, ObjectCompositeFilter) )
+			continue;
+
+		ObjectCompositeBase *pNode = (ObjectCompositeBase*) pSrc;
+		if (false == pNode->ReadyToApply(mInfo.get(), prInfo) )
+			continue;
+
+		// result is the same while node and everything before it are the same
+		if (0 != chainHash)
+		{
+			const uint64_t nodeHash = pNode->ComputeCacheHash(prInfo);
+			chainHash = (0 == nodeHash) ? 0 : CompositeHashNonZero(CompositeHashCombine(chainHash, nodeHash));
+		}
+
+		RenderStep step;
+		step.pNode = pNode;
+		step.hash = chainHash;
+		mRenderSteps.push_back(step);
+	}
+
+	// continue from the last cached result
+
+	const int numberOfSteps = (int) mRenderSteps.size();
+	int firstStep = 0;
+	GLuint cachedId = 0;
+
+	for (int i=numberOfSteps-1; i>=0 && 0 == cachedId; --i)
+	{
+		cachedId = mNodeCache.Find(mRenderSteps[i].hash, mProcessingWidth, mProcessingHeight);
+		if (cachedId > 0)
+			firstStep = i + 1;
+	}
+
+	int numberOfMisses = 0;
+	for (int i=firstStep; i<numberOfSteps; ++i)
+		if (0 != mRenderSteps[i].hash)
+			numberOfMisses += 1;
+
+	mStats.CountCache(firstStep, numberOfMisses);
+	mStats.CountTextures( mNodeCache.GetNumberOfEntries(), (int) mNodeCache.GetMemoryUsage() );
+
+	GLuint backgroundId = 0;
+
+	if (cachedId > 0)
+	{
+		backgroundId = cachedId;
+
+		// output is expected in the texture buffer
+		if (firstStep == numberOfSteps)
+		{
+			const GLuint result = mTextureBuffer.QueryATextureBuffer();
+			glCopyImageSubData(cachedId, GL_TEXTURE_2D, 0, 0, 0, 0,
+				result, GL_TEXTURE_2D, 0, 0, 0, 0, mProcessingWidth, mProcessingHeight, 1);
+		}
+	}
+	else
+	{
+		backgroundId = mBackground->ComputeTexture( mInfo.get(), mStats, mTextureBuffer.GetCurrentTextureId(), allowToReturnDirectTextureId );
+	}
 	
 	CHECK_GL_ERROR_MOBU();
 
 	// lastTextureId - buffer from TextureBuffer with a size = [renderWidth, renderHeight], processing size
 
 	// apply each effect and blend with each layer
-	const int srccount = GetSrcCount();
-	const CProcessingInfo	prInfo(mProcessingWidth, mProcessingHeight);
-
-	for (int i=0; i<srccount; ++i)
+	for (int i=firstStep; i<numberOfSteps; ++i)
 	{
-		FBComponent *pSrc = (FBComponent*) GetSrc(i);
+		ObjectCompositeBase *pSrc = mRenderSteps[i].pNode;
 
 		if (FBIS(pSrc, ObjectCompositeLayer) )
 		{
 			ObjectCompositeLayer *pLayer = (ObjectCompositeLayer*) pSrc;
-			if (false == pLayer->ReadyToApply(mInfo.get(), prInfo) )
-				continue;
 
 			const GLuint operand1 = (backgroundId > 0) ? backgroundId : mTextureBuffer.GetCurrentTextureId();
 			const GLuint operand2 = pLayer->ComputeLayerTexture(mInfo.get(), mStats);
@@ -1162,11 +1337,7 @@ void ObjectComposition::RenderLayers(bool allowToReturnDirectTextureId)
 			backgroundId = 0;
 		}
 		else
-		if (FBIS(pSrc, ObjectCompositeFilter) )
 		{
-			if (false == ((ObjectCompositeBase*) pSrc)->ReadyToApply(mInfo.get(), prInfo) )
-				continue;
-
 			// 1- currentTextureId
 			const GLuint currTextureId = (backgroundId > 0) ? backgroundId : mTextureBuffer.GetCurrentTextureId();
 			const GLuint newTextureId = mTextureBuffer.QueryATextureBuffer();
@@ -1177,16 +1348,72 @@ void ObjectComposition::RenderLayers(bool allowToReturnDirectTextureId)
 
 			backgroundId = 0;
 		}
+
+		if (0 != mRenderSteps[i].hash)
+		{
+			// the copy into the cache must see image stores of the node compute shaders
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+			mNodeCache.Store(mRenderSteps[i].hash, mTextureBuffer.GetCurrentTextureId(), mProcessingWidth, mProcessingHeight);
+		}
 	}
 
 	CHECK_GL_ERROR_MOBU();
 }
 
+bool ObjectComposition::BuildCPUGraph(CompositeCPUGraph &graph, const int width, const int height, std::vector<ObjectCompositeLayer*> *layers)
+{
+	graph.Clear();
+	graph.AddMaskImage();
+
+	if (nullptr != layers)
+		layers->clear();
+
+	// the same order as RenderLayers
+	const int srccount = GetSrcCount();
+	for (int i=0; i<srccount; ++i)
+	{
+		FBComponent *pSrc = (FBComponent*) GetSrc(i);
+
+		if (FBIS(pSrc, ObjectCompositeLayer) )
+		{
+			ObjectCompositeLayer *pLayer = (ObjectCompositeLayer*) pSrc;
+			if (pLayer->Active.AsInt() == 0 || 0.0 == pLayer->Opacity)
+				continue;
+
+			CompositeCPUNode node;
+			if (pLayer->PrepCPUNode(node, graph.GetLayerCount(), width, height) )
+			{
+				graph.AddLayerImage();
+				graph.AddNode(node);
+
+				if (nullptr != layers)
+					layers->push_back(pLayer);
+			}
+		}
+		else
+		if (FBIS(pSrc, ObjectCompositeFilter) )
+		{
+			ObjectCompositeFilter *pFilter = (ObjectCompositeFilter*) pSrc;
+			if (pFilter->Active.AsInt() == 0 || 0.0 == pFilter->Opacity)
+				continue;
+
+			CompositeCPUNode node;
+			if (pFilter->PrepCPUNode(node, width, height) )
+				graph.AddNode(node);
+			else
+				printf("[CompositeCPU] filter %s has no CPU implementation, skipped\n", pFilter->Name.AsString() );
+		}
+	}
+
+	return (graph.GetNodeCount() > 0);
+}
+
 void ObjectComposition::ChangeContext()
 {
 	ParentClass::ChangeContext();
 	
 	mBackground->ChangeContext();
+	mNodeCache.ChangeContext();
 
 	//
 	ClearBatchTextures();
@@ -1196,6 +1423,7 @@ void ObjectComposition::ChangeContext()
 void ObjectComposition::DoReloadShader()
 {
 	mBackground->NeedReload();
+	mNodeCache.Free();
 }
 
 void ObjectComposition::RenderVideoBatches()
@@ -1203,51 +1431,155 @@ void ObjectComposition::RenderVideoBatches()
 	if (Active == false || UseForBatchProcessing == false)
 		return;
 
-	const bool useMask = UseCompositeMask;
+	std::string outputFolder( BatchOutputFolder.AsString() );
+	if (outputFolder.length() == 0)
+	{
+		printf("[CompositeBatch] batch output folder is not set\n");
+		return;
+	}
+	if (outputFolder.back() != '\\' && outputFolder.back() != '/')
+		outputFolder += '\\';
+
+	auto fnGetClip = [this] (const int nBatch) -> FBVideoClip* {
+		FBComponent *pInput = BatchInput.GetAt(nBatch);
+		if (FBIS(pInput, FBTexture) )
+			pInput = ((FBTexture*) pInput)->Video;
+
+		return (nullptr != pInput && FBIS(pInput, FBVideoClip) ) ? (FBVideoClip*) pInput : nullptr;
+	};
+
+	// batch has no layer images (they come from a viewport render) and decodes only tga,
+	//  reject it up front instead of writing frames which differ from the interactive composite
+
+	int numberOfErrors = 0;
 
-	for (int nBatch=0; nBatch < BatchInput.GetCount(); ++nBatch)
 	{
-		/*
-		// replace input image
-		ReplaceImageSource( this, (FBTexture*) BatchInput.GetAt(nBatch) );
+		CompositeCPUGraph sceneGraph;
+		std::vector<ObjectCompositeLayer*> layers;
+		BuildCPUGraph(sceneGraph, mBatchMaxWidth, mBatchMaxHeight, &layers);
 
-		ObjectCompositeBase::Render();
+		for (int i=0; i<sceneGraph.GetNodeCount(); ++i)
+		{
+			const CompositeCPUNode &node = sceneGraph.GetNode(i);
+			if (eCompositeCPUBlend == node.type)
+			{
+				printf("[CompositeBatch] layer %s can't be rendered in a batch, deactivate it for batch processing\n",
+					layers[node.layerIndex]->Name.AsString() );
+				numberOfErrors += 1;
+			}
+		}
+	}
+
+	for (int nBatch=0; nBatch < BatchInput.GetCount(); ++nBatch)
+	{
+		FBVideoClip *pVideoClip = fnGetClip(nBatch);
+		if (nullptr == pVideoClip)
+			continue;
 
-		mShaderMan.Bind( eCompositeShaderBlit, useMask );
+		const FBString filename(pVideoClip->Filename);
+		const int len = filename.GetLen();
 
-		// show result - should be only one input connection
-		if (Components.GetCount() )
+		if (len < 4 || _stricmp( (const char*) filename + len - 4, ".tga" ) != 0)
 		{
-			GLuint texId = ((ObjectCompositeBase*) Components[0])->getColorTextureId();
-			//texId = color_buffer_id;
+			printf("[CompositeBatch] %s - unsupported format, only tga sequences could be processed\n", (const char*) filename );
+			numberOfErrors += 1;
+		}
+	}
 
-			int w = Width;
-			int h = Height;
+	if (numberOfErrors > 0)
+	{
+		FBMessageBox( "Composite Batch", "Batch is not started, see the log for unsupported layers and formats", "Ok" );
+		return;
+	}
 
-			mBuffer->Bind();
-			mBuffer->AttachTexture2D(GL_TEXTURE_2D, batch_buffer_id + nBatch );
-								
-			glBindTexture(GL_TEXTURE_2D, texId);
-			drawOrthoQuad2d(w, h);
+	mBatchResults.clear();
+	mBatchResults.resize( BatchInput.GetCount() );
 
-			mBuffer->UnBind();
+	for (int nBatch=0; nBatch < BatchInput.GetCount(); ++nBatch)
+	{
+		FBVideoClip *pVideoClip = fnGetClip(nBatch);
+		if (nullptr == pVideoClip)
+			continue;
 
-			// bind to a dynamic texture
-			FBTexture *pOutTexture = (FBTexture*) BatchOutput.GetAt(nBatch);
-			FBVideoMemory *vidMem = (FBVideoMemory*) (FBVideo*) pOutTexture->Video;
-			vidMem->SetObjectImageSize(Width, Height);
+		const bool isSequence = FBIS(pVideoClip, FBVideoClipImage) && (((FBVideoClipImage*) pVideoClip)->ImageSequence == true);
+		FBString filename = pVideoClip->Filename;
 
-			if (batch_buffer_id)
-				vidMem->TextureOGLId = batch_buffer_id + nBatch;
-		}
+		std::vector<CompositeBatchFrame> frames;
+		if (false == CompositeBatchMakeSequence(filename, outputFolder.c_str(), (isSequence) ? 0 : 1, frames) )
+			continue;
 
-		FetchImageSource( this );
+		// graph is prepared on the main thread, process stage only reads it
 
-		CHECK_GL_ERROR_MOBU();
+		const int w = pVideoClip->Width.AsInt();
+		const int h = pVideoClip->Height.AsInt();
 
-		mShaderMan.UnBind();
-		*/
+		CompositeCPUGraph sceneGraph;
+		std::vector<ObjectCompositeLayer*> layers;
+		BuildCPUGraph(sceneGraph, w, h, &layers);
+
+		// there are no layer nodes, filters are applied on input frames
+		CompositeCPUGraph graph;
+		graph.AddMaskImage();
+
+		for (int i=0; i<sceneGraph.GetNodeCount(); ++i)
+			graph.AddNode(sceneGraph.GetNode(i) );
+
+		CompositeBatchProcessor processor;
+		processor.SetProcessFunc( [&graph] (const CompositeBatchFrame &, const CompositeCPUImage &source, CompositeCPUImage &result) -> bool {
+			return graph.Execute(source, result, CompositeCPUOptions() );
+		} );
+
+		const std::string clipName( pVideoClip->Name.AsString() );
+
+		CompositeBatchOptions options;
+		options.resume = BatchResume;
+		options.manifestPath = outputFolder + clipName + "_manifest.txt";
+		options.reportPath = outputFolder + clipName + "_timing.csv";
+
+		printf("[CompositeBatch] %s - %d frames\n", clipName.c_str(), (int) frames.size() );
+
+		processor.Run(frames, options);
+		processor.PrintReport();
+
+		// the last frame goes into the batch output
+		if (false == CompositeBatchReadTGA(frames.back().outputPath.c_str(), mBatchResults[nBatch]) )
+			mBatchResults[nBatch] = CompositeCPUImage();
+	}
+
+	mBatchResultsChanged = true;
+}
+
+void ObjectComposition::UpdateBatchOutput()
+{
+	mBatchResultsChanged = false;
+
+	const int count = std::min( (int) mBatchResults.size(), BatchOutput.GetCount() );
+	if (count <= 0 || BatchInput.GetCount() != (int) mBatchResults.size() )
+		return;
+
+	PrepareTexturesForBatch(mBatchMaxWidth, mBatchMaxHeight);
+
+	for (int i=0; i<count; ++i)
+	{
+		const CompositeCPUImage &image = mBatchResults[i];
+		FBComponent *pOutput = BatchOutput.GetAt(i);
+
+		if (image.IsEmpty() || false == FBIS(pOutput, FBVideoMemory) )
+			continue;
+
+		// rows go from the bottom like in OpenGL
+		glBindTexture(GL_TEXTURE_2D, mBatchBufferId + i);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_FLOAT, image.pixels.data() );
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		FBVideoMemory *pVideo = (FBVideoMemory*) pOutput;
+		pVideo->SetObjectImageSize(image.width, image.height);
+		pVideo->TextureOGLId = mBatchBufferId + i;
 	}
+
+	// textures have sizes of their images now, the next prepare resizes them
+	mBatchTextureWidth = 0;
+	CHECK_GL_ERROR_MOBU();
 }
 
 void ObjectComposition::SetInputWidthValue(const int value)
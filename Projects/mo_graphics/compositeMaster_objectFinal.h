@@ -88,6 +88,14 @@ public:
 
 	FBPropertyAction			SizeFromBackground;
 
+	FBPropertyAction			CPUBenchmark;		//!< time CPU backend nodes at the processing size
+	FBPropertyAction			CPUReferenceTest;	//!< CPU backend nodes against a scalar port of the compute shaders
+	FBPropertyAction			ShaderCacheTest;	//!< check compute shader permutations and the disk cache
+	FBPropertyAction			FroxelClustersTest;	//!< synthetic volumes through the fog and shadow zones froxel clusters
+
+	FBPropertyBool				UseResultCache;		//!< reuse node results while their parameters and inputs are the same
+	FBPropertyInt				ResultCacheBudget;	//!< memory budget in Mb for cached results
+
 	//
 	FBPropertyBool				UseForBatchProcessing;
 
@@ -95,6 +103,12 @@ public:
 	FBPropertyListObject		BatchInput;			//!> input images
 	FBPropertyListObject		BatchOutput;		//!> output images
 
+	// process input image sequences on CPU into a folder
+	FBPropertyString			BatchOutputFolder;
+	FBPropertyBool				BatchResume;		//!> skip frames which are done in a batch manifest
+	FBPropertyAction			ProcessBatch;
+	FBPropertyAction			BatchSelfTest;		//!> synthetic frames through the batch pipeline, no scene data
+
 	//FBPropertyReference			BackgroundReference;
 
 	FBPropertyInt					mCompositionStats[eCompositionStatsCount];
@@ -124,6 +138,10 @@ public:
 		return mStats;
 	}
 
+	// convert layers and filters into CPU backend nodes, caller supplies layer images in the same order
+	//  and the final composite mask image as a mask 0
+	bool BuildCPUGraph(CompositeCPUGraph &graph, const int width, const int height, std::vector<ObjectCompositeLayer*> *layers=nullptr);
+
 	virtual const GLuint GetColorTextureId() const override
 	{
 		//return mInfo->GetRenderColorId();
@@ -213,6 +231,16 @@ protected:
 	CompositeComputeShader::CComputeTextureBuffer<1>	mTextureBackground;
 	CompositeComputeShader::CComputeTextureBuffer<2>	mTextureBuffer;
 	std::auto_ptr<CompositeBackground>					mBackground;
+
+	// node results between frames
+	struct RenderStep
+	{
+		ObjectCompositeBase		*pNode;
+		uint64_t				hash;	// result hash, 0 if not cacheable
+	};
+
+	CompositeNodeCache									mNodeCache;
+	std::vector<RenderStep>								mRenderSteps;
 	
 	// TODO: implement exclusive light list for composition !
 	bool											mNeedUpdateLightList;
@@ -236,6 +264,9 @@ protected:
 	int					mBatchTextureWidth;
 	int					mBatchTextureHeight;
 
+	std::vector<CompositeCPUImage>	mBatchResults;			//!< last processed frame per batch input, shown in BatchOutput
+	bool				mBatchResultsChanged;	//!< upload results on the next render
+
 	//
 	// in case it's original composition, allocate output texture
 
@@ -275,6 +306,8 @@ protected:
 	void ComputeBatchMaxSizes();
 
 	void RenderVideoBatches();
+	// last batch frames into the BatchOutput video memory, needs a GL context
+	void UpdateBatchOutput();
 	void RenderLayers(bool allowToReturnDirectTextureId);
 
 	
@@ -284,6 +317,12 @@ protected:
 	static void SetUpdate(HIObject object, bool value);
 	static void SetQuality(HIObject object, ECompositionQuality value);
 	static void SetSizeFromBackground(HIObject object, bool value);
+	static void SetCPUBenchmark(HIObject object, bool value);
+	static void SetCPUReferenceTest(HIObject object, bool value);
+	static void SetShaderCacheTest(HIObject object, bool value);
+	static void SetFroxelClustersTest(HIObject object, bool value);
+	static void SetProcessBatch(HIObject object, bool value);
+	static void SetBatchSelfTest(HIObject object, bool value);
 
 	static void SetUserWidth(HIObject object, int value);
 	static void SetUserHeight(HIObject object, int value);
@@ -296,6 +335,8 @@ protected:
 	static int GetStatsNumberOfDispatchGroups(HIObject object);
 	static int GetStatsNumberOfTextures(HIObject object);
 	static int GetStatsTexturesMemory(HIObject object);
+	static int GetStatsCacheHits(HIObject object);
+	static int GetStatsCacheMisses(HIObject object);
 
 	void InitBatchTextures();
 	void ClearBatchTextures();
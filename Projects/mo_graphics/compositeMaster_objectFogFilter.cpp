@@ -296,6 +296,9 @@ void ObjectFilter3dFog::PrepFogData(const CCompositionInfo *pInfo)
 
 	// for volume computing
 	data.volumeInfo.x = (float) ComputeNumberOfVolumeModels();
+	data.volumeInfo.y = (float) COMPOSITE_FROXEL_TILES_X;
+	data.volumeInfo.z = (float) COMPOSITE_FROXEL_TILES_Y;
+	data.volumeInfo.w = (float) COMPOSITE_FROXEL_SLICES;
 
 	mGPUFogBuffer.UpdateData( sizeof(FogData), 1, &mFogData );
 }
@@ -342,9 +345,9 @@ void ObjectFilter3dFog::PrepVolumeData(VolumeData &data, FBModel *pVolumeModel,
 		data.color[i] = (float) dColor[i];
 }
 
-void ObjectFilter3dFog::PrepAllVolumes(FBCamera *pCamera)
+void ObjectFilter3dFog::PrepAllVolumes(const CCompositionInfo *pInfo)
 {
-	SortVolumeModels(pCamera);
+	SortVolumeModels(pInfo);
 
 	size_t count = mVolumesSortVector.size();
 	if (count == 0)
@@ -355,10 +358,27 @@ void ObjectFilter3dFog::PrepAllVolumes(FBCamera *pCamera)
 
 	for (size_t i=0; i<count; ++i)
 	{
-		PrepVolumeData(mVolumeData[i], mVolumesSortVector[i].first, useVolumeProperties);
+		PrepVolumeData(mVolumeData[i], mVolumesSortVector[i], useVolumeProperties);
 	}
 
 	mGPUVolumeBuffer.UpdateData( sizeof(VolumeData), count, mVolumeData.data() );
+
+	// froxel lists refer to volumes in the sorted order
+
+	const std::vector<uint32_t> &froxels = mVolumeClusters.GetFroxels();
+	mGPUFroxelBuffer.UpdateData( sizeof(uint32_t) * 2, mVolumeClusters.GetNumberOfFroxels(), froxels.data() );
+
+	const std::vector<uint32_t> &indices = mVolumeClusters.GetIndices();
+	if (indices.size() > 0)
+	{
+		mGPUFroxelIndexBuffer.UpdateData( sizeof(uint32_t), indices.size(), indices.data() );
+	}
+	else
+	{
+		// all volumes are out of view
+		const uint32_t zero = 0;
+		mGPUFroxelIndexBuffer.UpdateData( sizeof(uint32_t), 1, &zero );
+	}
 }
 
 /*
@@ -1040,75 +1060,73 @@ const int ObjectFilter3dFog::ComputeNumberOfVolumeModels()
 	return totalCount;
 }
 
-void ObjectFilter3dFog::SortVolumeModels(FBCamera *pCamera)
+void ObjectFilter3dFog::SortVolumeModels(const CCompositionInfo *pInfo)
 {
-	bool useVolumeObject = false;
+	// one pass over connected volumes, clusters keep the distance order between frames
 
-	if (TargetType == eFilterFogTargetVolume && VolumeObject.GetCount() > 0)
+	mVolumeModels.clear();
+	mFroxelVolumes.clear();
+
+	if (TargetType == eFilterFogTargetVolume)
 	{
-		int totalCount = 0;
 		for (int i=0, count=VolumeObject.GetCount(); i<count; ++i)
 		{
-			ModelFogVolume *pVolume = (ModelFogVolume*) VolumeObject.GetAt(i);
-			
-			if (pVolume->Enabled)
-				totalCount = totalCount + 1;
-		}
+			FBComponent *pComp = VolumeObject.GetAt(i);
 
-		useVolumeObject = (totalCount > 0);
+			if (false == FBIS(pComp, ModelFogVolume) )
+				continue;
 
-		mVolumesSortVector.resize(totalCount);
+			ModelFogVolume *pVolume = (ModelFogVolume*) pComp;
+			if (false == pVolume->Enabled)
+				continue;
 
-		totalCount = 0;
-		for (int i=0, count=VolumeObject.GetCount(); i<count; ++i)
-		{
-			ModelFogVolume *pVolume = (ModelFogVolume*) VolumeObject.GetAt(i);
-			
-			if (pVolume->Enabled)
+			CompositeFroxelVolume volume;
+			volume.key = pVolume;
+
+			FBMatrix model;
+			pVolume->GetMatrix(model);
+
+			for (int k=0; k<16; ++k)
+				volume.matrix[k] = model[k];
+
+			FBVector3d pMin, pMax;
+			pVolume->GetBoundingBox( pMin, pMax );
+
+			for (int k=0; k<3; ++k)
 			{
-				mVolumesSortVector[totalCount].first = pVolume;
-				totalCount = totalCount + 1;
+				volume.bmin[k] = pMin[k];
+				volume.bmax[k] = pMax[k];
 			}
+
+			mVolumeModels.push_back(pVolume);
+			mFroxelVolumes.push_back(volume);
 		}
 	}
 
-	//
-	if (nullptr == pCamera)
-		return;
-
-	FBVector3d cameraPos;
-	pCamera->GetVector(cameraPos);
+	CompositeFroxelSettings settings;
+	settings.nearPlane = pInfo->GetCameraNearPlane();
+	settings.farPlane = pInfo->GetCameraFarPlane();
+	settings.viewProj = pInfo->GetRenderCameraMVP();
 
-	// check all needed blend modes
+	FBCamera *pCamera = ((CCompositionInfo*) pInfo)->GetRenderCamera();
+	if (nullptr != pCamera)
+	{
+		FBVector3d cameraPos;
+		pCamera->GetVector(cameraPos);
 
-	if (useVolumeObject)
+		for (int k=0; k<3; ++k)
+			settings.cameraPos[k] = cameraPos[k];
+	}
+	else
 	{
-		int totalCount =0;
-		for (int i=0, count=VolumeObject.GetCount(); i<count; ++i)
-		{
-			ModelFogVolume *pVolume = (ModelFogVolume*) VolumeObject.GetAt(i);
-			
-			if (pVolume->Enabled)
-			{
-				if (Active)
-				{
-					double dist = 0.0;
-					FBVector3d pos;
-					pVolume->GetVector(pos);
-					dist = VectorLength(cameraPos, pos);
+		settings.sortByDistance = false;
+	}
 
-					mVolumesSortVector[totalCount].second = dist;
-					totalCount = totalCount + 1;
-				}
-			}
-		}
+	mVolumeClusters.Build(mFroxelVolumes, settings);
 
-		// sort volumes by dist value
-		auto volumeCmp = [](std::pair<FBModel*,double> const & pairA, std::pair<FBModel*,double> const & pairB) 
-		{ 
-			 return pairA.second < pairB.second;
-		};
+	const std::vector<int> &order = mVolumeClusters.GetOrder();
+	mVolumesSortVector.resize(order.size() );
 
-		std::sort( begin(mVolumesSortVector), end(mVolumesSortVector), volumeCmp );
-	}
+	for (size_t i=0; i<order.size(); ++i)
+		mVolumesSortVector[i] = mVolumeModels[order[i]];
 }
\ No newline at end of file
@@ -13,6 +13,7 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "compositeMaster_object.h"
+#include "compositeMaster_froxels.h"
 
 #include <map>
 #include "algorithm\nv_math.h"
@@ -48,6 +49,11 @@ class ObjectFilter3dFog : public ObjectCompositeFilter
 public:
 	ObjectFilter3dFog(const char *pName = NULL, HIObject pObject=NULL);
 
+	// depends on a scene depth and fog volumes, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
 	//--- FiLMBOX Construction/Destruction,
 	virtual bool FBCreate() override;		//!< FiLMBOX Creation function.
 	virtual void FBDestroy() override;		//!< FiLMBOX Destruction function.
@@ -137,8 +143,10 @@ protected:
 			const int volumeCount = ComputeNumberOfVolumeModels();
 			if (volumeCount > 0)
 			{
-				PrepAllVolumes( ((CCompositionInfo*)pInfo)->GetRenderCamera() );
+				PrepAllVolumes(pInfo);
 				mGPUVolumeBuffer.Bind(1);
+				mGPUFroxelBuffer.Bind(2);
+				mGPUFroxelIndexBuffer.Bind(3);
 
 				// prep subroutines for support each volume unique blend mode
 				// set subroutine values
@@ -163,7 +171,7 @@ protected:
 		float		fnear;
 		float		ffar;
 	
-		vec4		volumeInfo;	// x - number of volume models connected
+		vec4		volumeInfo;	// x - number of volume models connected, yzw - froxel grid size
 
 		vec4		viewDir[4];
 		vec4		viewOrig[4];
@@ -190,6 +198,13 @@ protected:
 	CGPUBufferSSBO		mGPUFogBuffer;
 	CGPUBufferSSBO		mGPUVolumeBuffer;
 
+	// volume lists per camera froxel
+	CompositeFroxelClusters				mVolumeClusters;
+	std::vector<CompositeFroxelVolume>	mFroxelVolumes;
+
+	CGPUBufferSSBO		mGPUFroxelBuffer;
+	CGPUBufferSSBO		mGPUFroxelIndexBuffer;
+
 	// intermid buffers for processing many volumes inside one filter
 	CompositeComputeShader::CComputeTextureBuffer<2>	mVolumeTextureBuffer;
 
@@ -198,18 +213,19 @@ protected:
 
 	void		PrepFogData(const CCompositionInfo *pInfo);
 	void		PrepVolumeData(VolumeData &data, FBModel *pVolumeModel, const bool useVolumeProperties);
-	void		PrepAllVolumes(FBCamera *pCamera);
+	void		PrepAllVolumes(const CCompositionInfo *pInfo);
 protected:
 
 	FBSystem					mSystem;
 	
-	std::vector<std::pair<FBModel*, double>>		mVolumesSortVector;
+	std::vector<FBModel*>		mVolumeModels;			// enabled volumes in the connection order
+	std::vector<FBModel*>		mVolumesSortVector;		// nearest first
 	
 	// list of all combination of blend modes for volume models
 	std::vector<CompositeComputeShader::CMixedProgram*>		mVolumeProgram;
 
 	const int ComputeNumberOfVolumeModels();
-	void	SortVolumeModels(FBCamera *pCamera);
+	void	SortVolumeModels(const CCompositionInfo *pInfo);
 
 	void SetUpAlphaUniform();
 	void SetUpObjectUniforms(FBCamera *pCamera, const bool useVolumeObject);
@@ -288,10 +288,8 @@ bool ObjectFilterLUT::ReadyToApply(const CCompositionInfo *pInfo, const CProcess
 		
 		strDefine = strDefine + strInclude;
 
-		// TODO: upload generated shader code and include it
-		int numberOfPreloadedParts = 0;
-		CompositeComputeShader::CMixedProgramManager::instance().NewShaderCodeFromBuffer(fileNameOnly, mGeneratedShaderCode.c_str(), mGeneratedShaderCode.length(), numberOfPreloadedParts);
-		CompositeComputeShader::CMixedProgramManager::instance().UploadProgramIncludeCodes( fileNameOnly );
+		// generated shader code is included by the lut file name
+		CompositeComputeShader::CMixedProgramManager::instance().NewShaderCodeFromBuffer(fileNameOnly, mGeneratedShaderCode.c_str(), mGeneratedShaderCode.length() );
 
 		const char *programLabel = MixedProgramLabel();
 		const char *programPath = MixedProgramPath();
@@ -315,6 +313,25 @@ bool ObjectFilterLUT::ReadyToApply(const CCompositionInfo *pInfo, const CProcess
 	return true;
 }
 
+bool ObjectFilterLUT::PrepCPUNode(CompositeCPUNode &node, const int width, const int height)
+{
+	const int numEntries = 3 * mLutEdgeSize * mLutEdgeSize * mLutEdgeSize;
+
+	if (mLut3dCacheid.length() == 0 || mLutEdgeSize != mLutEdgeSizeCache || (int) mLut3d.size() < numEntries)
+	{
+		printf("[CompositeCPU] LUT filter has no baked 3d LUT\n");
+		return false;
+	}
+
+	node = CompositeCPUNode(eCompositeCPULUT);
+	PrepCPUNodeMask(node);
+
+	node.lutSize = mLutEdgeSize;
+	node.lut.assign(mLut3d.begin(), mLut3d.begin() + numEntries);
+
+	return true;
+}
+
 void ObjectFilterLUT::DoLoad()
 {
 	FBFilePopup		dialog;
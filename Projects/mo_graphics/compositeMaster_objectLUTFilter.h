@@ -72,6 +72,9 @@ public:
 	
 	virtual bool ReadyToApply(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo) override;
 	
+	// uses a 3d LUT baked by the last ReadyToApply
+	virtual bool PrepCPUNode(CompositeCPUNode &node, const int width, const int height) override;
+
 	void Cleanup();
 
 	void DoLoad();
@@ -669,6 +669,16 @@ const GLuint ObjectCompositionColor::ComputeLayerTexture(const CCompositionInfo
 	return mLastLayerTextureId;
 }
 
+uint64_t ObjectCompositionColor::ComputeCacheHash(const CProcessingInfo &prInfo)
+{
+	const uint64_t hash = ParentClass::ComputeCacheHash(prInfo);
+	if (0 == hash)
+		return 0;
+
+	const uint64_t backgroundHash = mBackground->ComputeCacheHash(prInfo.GetWidth(), prInfo.GetHeight() );
+	return (0 == backgroundHash) ? 0 : CompositeHashCombine(hash, backgroundHash);
+}
+
 void ObjectCompositionColor::DoTransformFitImageSize()
 {
 	ObjectComposition *pFinal = nullptr;
@@ -932,6 +942,9 @@ void ObjectCompositionShadow::PrepShadowData(const CCompositionInfo *pInfo)
 
 	// for Zone computing
 	data.zoneInfo.x = (float) ComputeNumberOfZoneModels();
+	data.zoneInfo.y = (float) COMPOSITE_FROXEL_TILES_X;
+	data.zoneInfo.z = (float) COMPOSITE_FROXEL_TILES_Y;
+	data.zoneInfo.w = (float) COMPOSITE_FROXEL_SLICES;
 
 	mGPUShadowBuffer.UpdateData( sizeof(ShadowData), 1, &mShadowData );
 }
@@ -992,9 +1005,9 @@ void ObjectCompositionShadow::PrepZoneData(ZoneData &data, FBModel *pZoneModel,
 	data.volumeMin[3] = data.volumeMax[3] = 1.0f;
 }
 
-void ObjectCompositionShadow::PrepAllZones(FBCamera *pCamera)
+void ObjectCompositionShadow::PrepAllZones(const CCompositionInfo *pInfo)
 {
-	SortZoneModels(pCamera, (ZoneObjects.AsInt() > 0));
+	SortZoneModels(pInfo, (ZoneObjects.AsInt() > 0));
 
 	size_t count = mZoneSortVector.size();
 	if (count == 0)
@@ -1005,10 +1018,27 @@ void ObjectCompositionShadow::PrepAllZones(FBCamera *pCamera)
 
 	for (size_t i=0; i<count; ++i)
 	{
-		PrepZoneData(mZoneData[i], mZoneSortVector[i].first, useZoneProperties);
+		PrepZoneData(mZoneData[i], mZoneSortVector[i], useZoneProperties);
 	}
 
 	mGPUZoneBuffer.UpdateData( sizeof(ZoneData), count, mZoneData.data() );
+
+	// froxel lists refer to zones in the sorted order
+
+	const std::vector<uint32_t> &froxels = mZoneClusters.GetFroxels();
+	mGPUFroxelBuffer.UpdateData( sizeof(uint32_t) * 2, mZoneClusters.GetNumberOfFroxels(), froxels.data() );
+
+	const std::vector<uint32_t> &indices = mZoneClusters.GetIndices();
+	if (indices.size() > 0)
+	{
+		mGPUFroxelIndexBuffer.UpdateData( sizeof(uint32_t), indices.size(), indices.data() );
+	}
+	else
+	{
+		// all zones are out of view
+		const uint32_t zero = 0;
+		mGPUFroxelIndexBuffer.UpdateData( sizeof(uint32_t), 1, &zero );
+	}
 }
 
 // DONE: check alpha texture and Zone connections to query a propriate shader program !
@@ -1133,89 +1163,73 @@ const int ObjectCompositionShadow::ComputeNumberOfZoneModels()
 	return totalCount;
 }
 
-void ObjectCompositionShadow::SortZoneModels(FBCamera *pCamera, const bool sorting)
+void ObjectCompositionShadow::SortZoneModels(const CCompositionInfo *pInfo, const bool sorting)
 {
-	bool useZoneObject = false;
+	// one pass over connected zones, clusters keep the distance order between frames
 
-	if (ZoneObjects.GetCount() > 0)
+	mZoneModels.clear();
+	mFroxelZones.clear();
+
+	for (int i=0, count=ZoneObjects.GetCount(); i<count; ++i)
 	{
-		int totalCount = 0;
-		for (int i=0, count=ZoneObjects.GetCount(); i<count; ++i)
-		{
-			FBComponent *pComp = ZoneObjects.GetAt(i);
+		FBComponent *pComp = ZoneObjects.GetAt(i);
 
-			if (FBIS(pComp, ModelShadowZone) )
-			{
-				ModelShadowZone *pZone = (ModelShadowZone*) pComp;
-			
-				if (pZone->Enabled && pZone->MasterLight.GetCount() > 0)
-					totalCount = totalCount + 1;
-			}
-		}
+		if (false == FBIS(pComp, ModelShadowZone) )
+			continue;
 
-		useZoneObject = (totalCount > 0);
+		ModelShadowZone *pZone = (ModelShadowZone*) pComp;
+		if (false == pZone->Enabled || 0 == pZone->MasterLight.GetCount() )
+			continue;
 
-		mZoneSortVector.resize(totalCount);
+		CompositeFroxelVolume volume;
+		volume.key = pZone;
 
-		totalCount = 0;
-		for (int i=0, count=ZoneObjects.GetCount(); i<count; ++i)
-		{
-			FBComponent *pComp = ZoneObjects.GetAt(i);
+		FBMatrix model;
+		pZone->GetMatrix(model);
 
-			if (FBIS(pComp, ModelShadowZone) )
-			{
-				ModelShadowZone *pZone = (ModelShadowZone*) pComp;
-			
-				if (pZone->Enabled && pZone->MasterLight.GetCount() > 0)
-				{
-					mZoneSortVector[totalCount].first = pZone;
-					totalCount = totalCount + 1;
-				}
-			}
-		}
-	}
+		for (int k=0; k<16; ++k)
+			volume.matrix[k] = model[k];
 
-	//
-	if (nullptr == pCamera)
-		return;
+		FBVector3d pMin, pMax;
+		pZone->GetBoundingBox( pMin, pMax );
 
-	FBVector3d cameraPos;
-	pCamera->GetVector(cameraPos);
+		for (int k=0; k<3; ++k)
+		{
+			volume.bmin[k] = pMin[k];
+			volume.bmax[k] = pMax[k];
+		}
 
-	// check all needed blend modes
+		mZoneModels.push_back(pZone);
+		mFroxelZones.push_back(volume);
+	}
+
+	CompositeFroxelSettings settings;
+	settings.nearPlane = pInfo->GetCameraNearPlane();
+	settings.farPlane = pInfo->GetCameraFarPlane();
+	settings.viewProj = pInfo->GetRenderCameraMVP();
+	settings.sortByDistance = sorting;
 
-	if (true == useZoneObject && true == sorting)
+	FBCamera *pCamera = ((CCompositionInfo*) pInfo)->GetRenderCamera();
+	if (nullptr != pCamera)
 	{
-		int totalCount =0;
-		for (int i=0, count=ZoneObjects.GetCount(); i<count; ++i)
-		{
-			FBComponent *pComp = ZoneObjects.GetAt(i);
+		FBVector3d cameraPos;
+		pCamera->GetVector(cameraPos);
 
-			if (FBIS(pComp, ModelShadowZone) )
-			{
-				ModelShadowZone *pZone = (ModelShadowZone*) pComp;
-			
-				if (pZone->Enabled && pZone->MasterLight.GetCount() > 0)
-				{
-					double dist = 0.0;
-					FBVector3d pos;
-					pZone->GetVector(pos);
-					dist = VectorLength(cameraPos, pos);
+		for (int k=0; k<3; ++k)
+			settings.cameraPos[k] = cameraPos[k];
+	}
+	else
+	{
+		settings.sortByDistance = false;
+	}
 
-					mZoneSortVector[totalCount].second = dist;
-					totalCount = totalCount + 1;
-				}
-			}
-		}
+	mZoneClusters.Build(mFroxelZones, settings);
 
-		// sort Zones by dist value
-		auto ZoneCmp = [](std::pair<FBModel*,double> const & pairA, std::pair<FBModel*,double> const & pairB) 
-		{ 
-			 return pairA.second < pairB.second;
-		};
+	const std::vector<int> &order = mZoneClusters.GetOrder();
+	mZoneSortVector.resize(order.size() );
 
-		std::sort( begin(mZoneSortVector), end(mZoneSortVector), ZoneCmp );
-	}
+	for (size_t i=0; i<order.size(); ++i)
+		mZoneSortVector[i] = mZoneModels[order[i]];
 }
 
 bool ObjectCompositionShadow::PrepComputeProgram(const CCompositionInfo *pInfo)
@@ -1329,8 +1343,10 @@ bool ObjectCompositionShadow::RenderShadowZones(const CCompositionInfo *pInfo, c
 	const int volumeCount = ComputeNumberOfZoneModels();
 	if (volumeCount > 0)
 	{
-		PrepAllZones( ((CCompositionInfo*)pInfo)->GetRenderCamera() );
+		PrepAllZones(pInfo);
 		mGPUZoneBuffer.Bind(1);
+		mGPUFroxelBuffer.Bind(2);
+		mGPUFroxelIndexBuffer.Bind(3);
 
 		glActiveTexture(GL_TEXTURE3);
 
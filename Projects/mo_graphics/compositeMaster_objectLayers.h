@@ -14,6 +14,7 @@
 
 #include "compositeMaster_object.h"
 #include "compositeMaster_background.h"
+#include "compositeMaster_froxels.h"
 #include "render_layer_info.h"
 
 #define COMPOSITERENDER__CLASSNAME			ObjectCompositionRender
@@ -57,6 +58,11 @@ class ObjectCompositionRender : public ObjectCompositeLayer
 public:
 	ObjectCompositionRender(const char *pName = NULL, HIObject pObject=NULL);
 
+	// layer is a scene render, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
 	//--- FiLMBOX Construction/Destruction,
 	virtual bool FBCreate();		//!< FiLMBOX Creation function.
 	//virtual void FBDestroy();		//!< FiLMBOX Destruction function.
@@ -191,6 +197,9 @@ public:
 	//
 	virtual const GLuint	ComputeLayerTexture(const CCompositionInfo *pInfo, CompositeFinalStats &stats) override;
 
+	// layer properties and the background input (color, gradient or texture)
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override;
+
 	virtual bool PlugDataNotify(FBConnectionAction pAction,FBPlug* pThis,void* pData=NULL,void* pDataOld=NULL,int pDataSize=0) override;
 	virtual bool PlugNotify(FBConnectionAction pAction,FBPlug* pThis,int pIndex,FBPlug* pPlug,FBConnectionType pConnectionType,FBPlug* pNewPlug ) override;
 
@@ -229,6 +238,11 @@ class ObjectCompositionShadow : public ObjectCompositeLayer
 public:
 	ObjectCompositionShadow(const char *pName = NULL, HIObject pObject=NULL);
 
+	// layer is a scene render, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
 	//--- FiLMBOX Construction/Destruction,
 	virtual bool FBCreate();		//!< FiLMBOX Creation function.
 	//virtual void FBDestroy();		//!< FiLMBOX Destruction function.
@@ -313,7 +327,7 @@ protected:
 		float		fnear;
 		float		ffar;
 	
-		vec4		zoneInfo;	// x - number of volume models connected
+		vec4		zoneInfo;	// x - number of volume models connected, yzw - froxel grid size
 	};
 
 	struct ZoneData
@@ -336,12 +350,19 @@ protected:
 	CGPUBufferSSBO		mGPUShadowBuffer;
 	CGPUBufferSSBO		mGPUZoneBuffer;
 
+	// zone lists per camera froxel
+	CompositeFroxelClusters				mZoneClusters;
+	std::vector<CompositeFroxelVolume>	mFroxelZones;
+
+	CGPUBufferSSBO		mGPUFroxelBuffer;
+	CGPUBufferSSBO		mGPUFroxelIndexBuffer;
+
 	// intermid buffers for processing many volumes inside one filter
 	CompositeComputeShader::CComputeTextureBuffer<2>	mVolumeTextureBuffer;
 
 	void		PrepShadowData(const CCompositionInfo *pInfo);
 	void		PrepZoneData(ZoneData &data, FBModel *pZoneModel, const bool useModelProperties);
-	void		PrepAllZones(FBCamera *pCamera);
+	void		PrepAllZones(const CCompositionInfo *pInfo);
 
 protected:
 
@@ -349,13 +370,14 @@ protected:
 	
 	CGPUFBScene					*pGPUFBScene;
 
-	std::vector<std::pair<FBModel*, double>>		mZoneSortVector;
+	std::vector<FBModel*>		mZoneModels;		// enabled zones in the connection order
+	std::vector<FBModel*>		mZoneSortVector;	// nearest first
 	
 	// list of all combination of blend modes for volume models
 	std::vector<CompositeComputeShader::CMixedProgram*>		mZoneProgram;
 
 	const int ComputeNumberOfZoneModels();
-	void	SortZoneModels(FBCamera *pCamera, const bool sorting);
+	void	SortZoneModels(const CCompositionInfo *pInfo, const bool sorting);
 
 	bool PrepComputeProgram(const CCompositionInfo *pInfo);
 	bool RenderShadowZones(const CCompositionInfo *pInfo, const CProcessingInfo &prInfo, CompositeFinalStats &stats, GLuint dstTexId);
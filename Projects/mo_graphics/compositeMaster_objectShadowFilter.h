@@ -40,6 +40,11 @@ class ObjectFilter3dShadow : public ObjectCompositeFilter
 public:
 	ObjectFilter3dShadow(const char *pName = NULL, HIObject pObject=NULL);
 
+	// depends on a scene depth and shadow maps, never cached
+	virtual uint64_t ComputeCacheHash(const CProcessingInfo &prInfo) override {
+		return 0;
+	}
+
 	//--- FiLMBOX Construction/Destruction,
 	virtual bool FBCreate() override;		//!< FiLMBOX Creation function.
 	virtual void FBDestroy() override;		//!< FiLMBOX Destruction function.
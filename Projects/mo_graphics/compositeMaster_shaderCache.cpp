@@ -0,0 +1,901 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_shaderCache.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "compositeMaster_shaderCache.h"
+#include "algorithm\ParallelFor.h"
+#include "IO\AtomicFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <tuple>
+#include <chrono>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#define COMPOSITE_SHADER_CACHE_VERSION		1
+
+static const char gEntryMagic[4] = {'M', 'P', 'S', 'C'};
+static const char gManifestMagic[4] = {'M', 'P', 'S', 'M'};
+
+static uint64_t HashBytes(const char *data, const size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i=0; i<size; ++i)
+	{
+		hash ^= (unsigned char) data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// length prefixed values
+
+static void WriteUInt(std::string &out, const uint64_t value, const int numberOfBytes)
+{
+	for (int i=0; i<numberOfBytes; ++i)
+		out.push_back( (char) ( (value >> (8 * i)) & 0xFF) );
+}
+
+static void WriteString(std::string &out, const std::string &value)
+{
+	WriteUInt(out, value.size(), 4);
+	out.append(value);
+}
+
+static bool ReadUInt(const char *&ptr, const char *end, uint64_t &value, const int numberOfBytes)
+{
+	if (end - ptr < numberOfBytes)
+		return false;
+
+	value = 0;
+	for (int i=0; i<numberOfBytes; ++i)
+		value |= (uint64_t) (unsigned char) ptr[i] << (8 * i);
+
+	ptr += numberOfBytes;
+	return true;
+}
+
+static bool ReadString(const char *&ptr, const char *end, std::string &value)
+{
+	uint64_t len = 0;
+	if (false == ReadUInt(ptr, end, len, 4) || (uint64_t) (end - ptr) < len)
+		return false;
+
+	value.assign(ptr, (size_t) len);
+	ptr += len;
+	return true;
+}
+
+static bool ReadWholeFile(const char *filename, std::string &content)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (nullptr == fp)
+		return false;
+
+	content.clear();
+
+	char buffer[65536];
+	size_t count = 0;
+	while ( (count = fread(buffer, 1, sizeof(buffer), fp) ) > 0)
+		content.append(buffer, count);
+
+	fclose(fp);
+	return true;
+}
+
+static std::string TrimSpaces(const std::string &value)
+{
+	const size_t first = value.find_first_not_of(" \t\r\n");
+	if (std::string::npos == first)
+		return std::string();
+
+	const size_t last = value.find_last_not_of(" \t\r\n");
+	return value.substr(first, last - first + 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeShaderKey
+
+bool CompositeShaderKey::operator < (const CompositeShaderKey &other) const
+{
+	if (header != other.header)
+		return header < other.header;
+	if (parts.size() != other.parts.size() )
+		return parts.size() < other.parts.size();
+
+	for (size_t i=0; i<parts.size(); ++i)
+	{
+		const CompositeShaderPart &a = parts[i];
+		const CompositeShaderPart &b = other.parts[i];
+
+		if (std::tie(a.define, a.filename, a.partname) != std::tie(b.define, b.filename, b.partname) )
+			return std::tie(a.define, a.filename, a.partname) < std::tie(b.define, b.filename, b.partname);
+	}
+	return false;
+}
+
+bool CompositeShaderKey::operator == (const CompositeShaderKey &other) const
+{
+	return false == (*this < other) && false == (other < *this);
+}
+
+uint64_t CompositeShaderKey::Hash() const
+{
+	std::string data;
+	Write(data);
+	return HashBytes(data.data(), data.size() );
+}
+
+void CompositeShaderKey::Write(std::string &out) const
+{
+	WriteString(out, header);
+	WriteUInt(out, parts.size(), 4);
+
+	for (auto iter=parts.begin(); iter!=parts.end(); ++iter)
+	{
+		WriteString(out, iter->define);
+		WriteString(out, iter->filename);
+		WriteString(out, iter->partname);
+	}
+}
+
+bool CompositeShaderKey::Read(const char *&ptr, const char *end)
+{
+	uint64_t count = 0;
+	if (false == ReadString(ptr, end, header) || false == ReadUInt(ptr, end, count, 4) )
+		return false;
+
+	// every part is at least three lengths
+	if (count > (uint64_t) (end - ptr) / 12)
+		return false;
+
+	parts.resize( (size_t) count);
+
+	for (auto iter=parts.begin(); iter!=parts.end(); ++iter)
+	{
+		if (false == ReadString(ptr, end, iter->define)
+			|| false == ReadString(ptr, end, iter->filename)
+			|| false == ReadString(ptr, end, iter->partname) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CompositeShaderExtractPart(const std::string &content, const std::string &partname, std::string &part)
+{
+	const size_t identLen = strlen(COMPOSITE_SHADER_PART_IDENT);
+	const std::string name = TrimSpaces(partname);
+
+	size_t pos = content.find(COMPOSITE_SHADER_PART_IDENT);
+
+	while (std::string::npos != pos)
+	{
+		size_t eol = content.find('\n', pos);
+		if (std::string::npos == eol)
+			eol = content.size();
+
+		if (TrimSpaces(content.substr(pos + identLen, eol - pos - identLen) ) == name)
+		{
+			const size_t next = content.find(COMPOSITE_SHADER_PART_IDENT, pos + identLen);
+			part = content.substr(pos, (std::string::npos == next) ? std::string::npos : next - pos);
+			return true;
+		}
+
+		pos = content.find(COMPOSITE_SHADER_PART_IDENT, pos + identLen);
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeShaderPermutations
+
+CompositeShaderPermutations::CompositeShaderPermutations(const CompositeShaderReadFunc &readFunc, const char *includeRoot)
+	: mReadFunc(readFunc)
+	, mIncludeRoot( (includeRoot) ? includeRoot : "")
+	, mNumberOfCacheHits(0)
+	, mNumberOfProcessed(0)
+{}
+
+bool CompositeShaderPermutations::SetCacheFolder(const char *folder)
+{
+	mCacheFolder = (folder) ? folder : "";
+
+	if (mCacheFolder.size() == 0)
+		return true;
+
+	const char last = mCacheFolder.back();
+	if (last != '\\' && last != '/')
+		mCacheFolder.push_back('/');
+
+	const std::string path = mCacheFolder.substr(0, mCacheFolder.size() - 1);
+#ifdef _WIN32
+	_mkdir(path.c_str() );
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+
+	// check that an entry could be written
+	const std::string testFilename = mCacheFolder + "write.test";
+	if (false == WriteFileAtomic(testFilename.c_str(), "test", 4) )
+	{
+		printf("[ShaderCache] cache folder is not writable - %s\n", mCacheFolder.c_str() );
+		mCacheFolder.clear();
+		return false;
+	}
+
+	remove(testFilename.c_str() );
+	return true;
+}
+
+bool CompositeShaderPermutations::SetVirtualFile(const char *name, const char *buffer, const size_t bufferLen)
+{
+	std::lock_guard<std::mutex> lock(mFilesMutex);
+
+	const uint64_t hash = HashBytes(buffer, bufferLen);
+
+	auto iter = mVirtualFiles.find(name);
+	if (iter != mVirtualFiles.end() && iter->second.hash == hash)
+		return false;
+
+	FileEntry &entry = mVirtualFiles[name];
+	entry.isOk = true;
+	entry.content.assign(buffer, bufferLen);
+	entry.hash = hash;
+	return true;
+}
+
+const CompositeShaderPermutations::FileEntry *CompositeShaderPermutations::ReadFile(const std::string &filename)
+{
+	{
+		std::lock_guard<std::mutex> lock(mFilesMutex);
+
+		auto iter = mFiles.find(filename);
+		if (iter != mFiles.end() )
+			return &iter->second;
+	}
+
+	// read outside of the lock, the first insert wins
+	FileEntry entry;
+	entry.isOk = mReadFunc(filename, entry.content);
+	entry.hash = HashBytes(entry.content.data(), entry.content.size() );
+
+	std::lock_guard<std::mutex> lock(mFilesMutex);
+
+	auto result = mFiles.insert( std::make_pair(filename, entry) );
+	return &result.first->second;
+}
+
+const CompositeShaderPermutations::FileEntry *CompositeShaderPermutations::ReadInclude(const std::string &name, std::string &filename)
+{
+	{
+		std::lock_guard<std::mutex> lock(mFilesMutex);
+
+		auto iter = mVirtualFiles.find(name);
+		if (iter != mVirtualFiles.end() )
+		{
+			filename = name;
+			return &iter->second;
+		}
+	}
+
+	filename = mIncludeRoot + name;
+	return ReadFile(filename);
+}
+
+const CompositeShaderPermutations::FileEntry *CompositeShaderPermutations::ReadDependency(const std::string &filename)
+{
+	{
+		std::lock_guard<std::mutex> lock(mFilesMutex);
+
+		auto iter = mVirtualFiles.find(filename);
+		if (iter != mVirtualFiles.end() )
+			return &iter->second;
+	}
+	return ReadFile(filename);
+}
+
+bool CompositeShaderPermutations::AppendResolved(const std::string &text, std::vector<std::string> &stack, CompositeShaderSource &source, std::string &error)
+{
+	bool inBlockComment = false;
+	size_t pos = 0;
+
+	while (pos < text.size() )
+	{
+		const size_t eol = text.find('\n', pos);
+		const size_t lineEnd = (std::string::npos == eol) ? text.size() : eol + 1;
+		const std::string line = text.substr(pos, lineEnd - pos);
+		pos = lineEnd;
+
+		const size_t first = line.find_first_not_of(" \t\r");
+
+		if (false == inBlockComment && std::string::npos != first && 0 == line.compare(first, 8, "#include") )
+		{
+			const size_t open = line.find_first_of("\"<", first + 8);
+			const size_t close = (std::string::npos == open) ? std::string::npos : line.find( (line[open] == '"') ? '"' : '>', open + 1);
+
+			if (std::string::npos == close)
+			{
+				error = "wrong include line - " + TrimSpaces(line);
+				return false;
+			}
+
+			std::string filename;
+			const std::string name = line.substr(open + 1, close - open - 1);
+			const FileEntry *entry = ReadInclude(name, filename);
+
+			if (nullptr == entry || false == entry->isOk)
+			{
+				error = "include is not found - " + name;
+				return false;
+			}
+
+			if (std::find(stack.begin(), stack.end(), filename) != stack.end() )
+			{
+				error = "recursive include - " + name;
+				return false;
+			}
+
+			source.dependencies[filename] = entry->hash;
+
+			stack.push_back(filename);
+			if (false == AppendResolved(entry->content, stack, source, error) )
+				return false;
+			stack.pop_back();
+
+			if (source.text.size() > 0 && source.text.back() != '\n')
+				source.text.push_back('\n');
+			continue;
+		}
+
+		source.text.append(line);
+
+		// comment state for the next lines
+		for (size_t i=0; i+1<line.size(); ++i)
+		{
+			if (inBlockComment)
+			{
+				if (line[i] == '*' && line[i+1] == '/')
+				{
+					inBlockComment = false;
+					++i;
+				}
+			}
+			else if (line[i] == '/' && line[i+1] == '/')
+			{
+				break;
+			}
+			else if (line[i] == '/' && line[i+1] == '*')
+			{
+				inBlockComment = true;
+				++i;
+			}
+		}
+	}
+	return true;
+}
+
+bool CompositeShaderPermutations::Process(const CompositeShaderKey &key, CompositeShaderSource &source, std::string &error)
+{
+	source.text = key.header;
+	source.dependencies.clear();
+	source.fromCache = false;
+
+	std::vector<std::string> stack;
+
+	for (auto iter=key.parts.begin(); iter!=key.parts.end(); ++iter)
+	{
+		if (false == AppendResolved(iter->define, stack, source, error) )
+			return false;
+
+		if (iter->filename.size() == 0)
+			continue;
+
+		const FileEntry *entry = ReadFile(iter->filename);
+		if (nullptr == entry || false == entry->isOk)
+		{
+			error = "file is not found - " + iter->filename;
+			return false;
+		}
+
+		source.dependencies[iter->filename] = entry->hash;
+
+		std::string part;
+		if (iter->partname.size() == 0)
+		{
+			part = entry->content;
+		}
+		else if (false == CompositeShaderExtractPart(entry->content, iter->partname, part) )
+		{
+			error = "part " + iter->partname + " is not found in " + iter->filename;
+			return false;
+		}
+
+		stack.push_back(iter->filename);
+		if (false == AppendResolved(part, stack, source, error) )
+			return false;
+		stack.pop_back();
+	}
+	return true;
+}
+
+std::string CompositeShaderPermutations::GetEntryFilename(const CompositeShaderKey &key) const
+{
+	if (mCacheFolder.size() == 0)
+		return std::string();
+
+	char name[32];
+	sprintf_s(name, sizeof(name), "%016llx.cs", (unsigned long long) key.Hash() );
+	return mCacheFolder + name;
+}
+
+std::string CompositeShaderPermutations::GetManifestFilename(const char *sceneFilename) const
+{
+	if (mCacheFolder.size() == 0 || nullptr == sceneFilename || 0 == strlen(sceneFilename) )
+		return std::string();
+
+	char name[40];
+	sprintf_s(name, sizeof(name), "scene_%016llx.keys", (unsigned long long) HashBytes(sceneFilename, strlen(sceneFilename) ) );
+	return mCacheFolder + name;
+}
+
+bool CompositeShaderPermutations::LoadEntry(const CompositeShaderKey &key, CompositeShaderSource &source)
+{
+	const std::string filename = GetEntryFilename(key);
+	std::string data;
+
+	if (filename.size() == 0 || false == ReadWholeFile(filename.c_str(), data) )
+		return false;
+
+	const char *ptr = data.data();
+	const char *end = ptr + data.size();
+
+	uint64_t version = 0;
+	if (data.size() < 8 || 0 != memcmp(ptr, gEntryMagic, 4) )
+		return false;
+	ptr += 4;
+
+	if (false == ReadUInt(ptr, end, version, 4) || COMPOSITE_SHADER_CACHE_VERSION != version)
+		return false;
+
+	// the same hash with a different key is a miss
+	CompositeShaderKey entryKey;
+	if (false == entryKey.Read(ptr, end) || false == (entryKey == key) )
+		return false;
+
+	uint64_t count = 0;
+	if (false == ReadUInt(ptr, end, count, 4) )
+		return false;
+
+	source.dependencies.clear();
+
+	for (uint64_t i=0; i<count; ++i)
+	{
+		std::string name;
+		uint64_t hash = 0;
+
+		if (false == ReadString(ptr, end, name) || false == ReadUInt(ptr, end, hash, 8) )
+			return false;
+
+		// a file is changed after the entry was stored
+		const FileEntry *entry = ReadDependency(name);
+		if (nullptr == entry || false == entry->isOk || entry->hash != hash)
+			return false;
+
+		source.dependencies[name] = hash;
+	}
+
+	if (false == ReadString(ptr, end, source.text) )
+		return false;
+
+	source.fromCache = true;
+	return true;
+}
+
+bool CompositeShaderPermutations::StoreEntry(const CompositeShaderKey &key, const CompositeShaderSource &source) const
+{
+	const std::string filename = GetEntryFilename(key);
+	if (filename.size() == 0)
+		return false;
+
+	std::string data(gEntryMagic, 4);
+	WriteUInt(data, COMPOSITE_SHADER_CACHE_VERSION, 4);
+	key.Write(data);
+
+	WriteUInt(data, source.dependencies.size(), 4);
+	for (auto iter=source.dependencies.begin(); iter!=source.dependencies.end(); ++iter)
+	{
+		WriteString(data, iter->first);
+		WriteUInt(data, iter->second, 8);
+	}
+
+	WriteString(data, source.text);
+
+	return WriteFileAtomic(filename.c_str(), data.data(), data.size() );
+}
+
+bool CompositeShaderPermutations::LoadOrProcess(const CompositeShaderKey &key, CompositeShaderSource &source, std::string &error)
+{
+	if (LoadEntry(key, source) )
+	{
+		mNumberOfCacheHits += 1;
+		return true;
+	}
+
+	if (false == Process(key, source, error) )
+		return false;
+
+	mNumberOfProcessed += 1;
+	StoreEntry(key, source);
+	return true;
+}
+
+const CompositeShaderSource *CompositeShaderPermutations::Query(const CompositeShaderKey &key, std::string &error)
+{
+	auto iter = mSources.find(key);
+	if (iter != mSources.end() )
+		return &iter->second;
+
+	CompositeShaderSource source;
+	if (false == LoadOrProcess(key, source, error) )
+		return nullptr;
+
+	CompositeShaderSource &result = mSources[key];
+	std::swap(result, source);
+	return &result;
+}
+
+int CompositeShaderPermutations::Prepare(const std::vector<CompositeShaderKey> &keys, const int numberOfThreads)
+{
+	std::vector<const CompositeShaderKey*>	missing;
+
+	for (auto iter=keys.begin(); iter!=keys.end(); ++iter)
+	{
+		if (mSources.find(*iter) != mSources.end() )
+			continue;
+
+		bool isDuplicate = false;
+		for (auto missIter=missing.begin(); missIter!=missing.end() && false == isDuplicate; ++missIter)
+			isDuplicate = (**missIter == *iter);
+
+		if (false == isDuplicate)
+			missing.push_back(&*iter);
+	}
+
+	std::vector<CompositeShaderSource>	sources(missing.size() );
+	std::vector<std::string>			errors(missing.size() );
+	std::vector<char>					isOk(missing.size(), 0);
+
+	ParallelFor( (int) missing.size(), 1, [&] (const int first, const int last) {
+		for (int i=first; i<last; ++i)
+			isOk[i] = LoadOrProcess(*missing[i], sources[i], errors[i]) ? 1 : 0;
+	}, numberOfThreads);
+
+	for (size_t i=0; i<missing.size(); ++i)
+	{
+		if (isOk[i])
+			std::swap(mSources[*missing[i]], sources[i]);
+		else
+			printf("[ShaderCache] failed to prepare a permutation - %s\n", errors[i].c_str() );
+	}
+
+	int numberOfReady = 0;
+	for (auto iter=keys.begin(); iter!=keys.end(); ++iter)
+		if (mSources.find(*iter) != mSources.end() )
+			numberOfReady += 1;
+
+	return numberOfReady;
+}
+
+void CompositeShaderPermutations::InvalidateFile(const std::string &filename, std::vector<CompositeShaderKey> &droppedKeys)
+{
+	{
+		std::lock_guard<std::mutex> lock(mFilesMutex);
+		mFiles.erase(filename);
+	}
+
+	for (auto iter=mSources.begin(); iter!=mSources.end(); )
+	{
+		if (iter->second.dependencies.find(filename) != iter->second.dependencies.end() )
+		{
+			droppedKeys.push_back(iter->first);
+			iter = mSources.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+void CompositeShaderPermutations::InvalidateAll()
+{
+	std::lock_guard<std::mutex> lock(mFilesMutex);
+
+	mFiles.clear();
+	mSources.clear();
+}
+
+bool CompositeShaderPermutations::SaveManifest(const char *filename, const std::vector<CompositeShaderKey> &keys, const std::vector<std::string> &labels) const
+{
+	std::string data(gManifestMagic, 4);
+	WriteUInt(data, COMPOSITE_SHADER_CACHE_VERSION, 4);
+	WriteUInt(data, keys.size(), 4);
+
+	for (size_t i=0; i<keys.size(); ++i)
+	{
+		WriteString(data, (i < labels.size() ) ? labels[i] : std::string() );
+		keys[i].Write(data);
+	}
+
+	return WriteFileAtomic(filename, data.data(), data.size() );
+}
+
+bool CompositeShaderPermutations::LoadManifest(const char *filename, std::vector<CompositeShaderKey> &keys, std::vector<std::string> &labels) const
+{
+	keys.clear();
+	labels.clear();
+
+	std::string data;
+	if (false == ReadWholeFile(filename, data) )
+		return false;
+
+	const char *ptr = data.data();
+	const char *end = ptr + data.size();
+
+	uint64_t version = 0;
+	uint64_t count = 0;
+
+	if (data.size() < 4 || 0 != memcmp(ptr, gManifestMagic, 4) )
+		return false;
+	ptr += 4;
+
+	if (false == ReadUInt(ptr, end, version, 4) || COMPOSITE_SHADER_CACHE_VERSION != version
+		|| false == ReadUInt(ptr, end, count, 4) )
+	{
+		return false;
+	}
+
+	for (uint64_t i=0; i<count; ++i)
+	{
+		std::string label;
+		CompositeShaderKey key;
+
+		if (false == ReadString(ptr, end, label) || false == key.Read(ptr, end) )
+		{
+			keys.clear();
+			labels.clear();
+			return false;
+		}
+
+		labels.push_back(label);
+		keys.push_back(key);
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// synthetic test
+
+static CompositeShaderKey MakeTestKey(const char *header, const char *define, const char *filename, const char *partname)
+{
+	CompositeShaderKey key;
+	key.header = header;
+
+	CompositeShaderPart part;
+	part.define = define;
+	part.filename = filename;
+	part.partname = partname;
+	key.parts.push_back(part);
+
+	return key;
+}
+
+bool CompositeShaderCacheSelfTest(const char *folder)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	// in memory files, a shader library with includes and parts
+
+	std::map<std::string, std::string>	files;
+	std::mutex							filesMutex;
+	std::atomic<int>					numberOfReads(0);
+
+	files["/GLSL_CS/math.glsl"] = "float saturate(float x) { return clamp(x, 0.0, 1.0); }\n";
+	files["/GLSL_CS/common.glsl"] = "#include \"math.glsl\"\nvec4 common() { return vec4(saturate(2.0)); }\n";
+	files["/GLSL_CS/loopA.glsl"] = "#include \"loopB.glsl\"\n";
+	files["/GLSL_CS/loopB.glsl"] = "#include \"loopA.glsl\"\n";
+	files["/GLSL_CS/blend.cs"] =
+		"// #include \"missing.glsl\"\n"
+		"/*\n"
+		"#include \"missing.glsl\"\n"
+		"*/\n"
+		"  #include \"common.glsl\"\n"
+		"//-- PART: Header\n"
+		"uniform float header;\n"
+		"//-- PART: Main\n"
+		"void main() { vec4 c = common(); }\n";
+	files["/GLSL_CS/loop.cs"] = "#include \"loopA.glsl\"\n";
+	files["/GLSL_CS/bad.cs"] = "#include \"missing.glsl\"\n";
+
+	auto fnRead = [&] (const std::string &filename, std::string &content) -> bool {
+		numberOfReads += 1;
+		std::lock_guard<std::mutex> lock(filesMutex);
+		auto iter = files.find(filename);
+		if (iter == files.end() )
+			return false;
+		content = iter->second;
+		return true;
+	};
+
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf("[ShaderCache] test failed - %s\n", text);
+			numberOfErrors += 1;
+		}
+	};
+
+	const std::string cacheFolder = std::string(folder) + "/shader_cache_test";
+	const char *header = "#version 430\n";
+	std::string error;
+
+	// 1 - includes, comments and parts, no disk cache
+
+	{
+		CompositeShaderPermutations permutations(fnRead, "/GLSL_CS/");
+
+		const CompositeShaderSource *source = permutations.Query(MakeTestKey(header, "#define A\n", "/GLSL_CS/blend.cs", ""), error);
+		fnCheck(nullptr != source, "whole file");
+
+		if (source)
+		{
+			fnCheck(source->text.find("saturate(float x)") != std::string::npos, "nested include is pasted");
+			fnCheck(source->text.find("#include \"common.glsl\"") == std::string::npos, "include line is replaced");
+			fnCheck(source->text.find("#include \"missing.glsl\"") != std::string::npos, "commented includes are kept");
+			fnCheck(source->text.compare(0, strlen(header), header) == 0, "header goes first");
+			fnCheck(source->dependencies.size() == 3, "dependencies of a source");
+		}
+
+		source = permutations.Query(MakeTestKey(header, "", "/GLSL_CS/blend.cs", "Main"), error);
+		fnCheck(nullptr != source && source->text.find("void main()") != std::string::npos
+			&& source->text.find("uniform float header") == std::string::npos, "part extraction");
+
+		fnCheck(nullptr == permutations.Query(MakeTestKey(header, "", "/GLSL_CS/blend.cs", "Missing"), error), "missing part");
+		fnCheck(nullptr == permutations.Query(MakeTestKey(header, "", "/GLSL_CS/loop.cs", ""), error)
+			&& error.find("recursive") != std::string::npos, "recursive include");
+		fnCheck(nullptr == permutations.Query(MakeTestKey(header, "", "/GLSL_CS/bad.cs", ""), error), "missing include");
+
+		// concatenated strings of the keys are equal, old string hash keys collide
+
+		const CompositeShaderKey keyA = MakeTestKey(header, "#define MODE 1\n", "/GLSL_CS/blend.cs", "");
+		const CompositeShaderKey keyB = MakeTestKey(header, "#define MODE 1\n/GLSL_CS/blend.cs", "", "");
+		const CompositeShaderKey keyC = MakeTestKey("#version 430\n#define MODE 1\n", "", "/GLSL_CS/blend.cs", "");
+
+		fnCheck(false == (keyA == keyB) && false == (keyA == keyC) && false == (keyB == keyC), "keys are exact");
+
+		// generated code included by a name
+
+		const char *lut1 = "vec3 lut(vec3 c) { return c; }\n";
+		const char *lut2 = "vec3 lut(vec3 c) { return 1.0 - c; }\n";
+
+		permutations.SetVirtualFile("lut.cube", lut1, strlen(lut1) );
+		const CompositeShaderKey lutKey = MakeTestKey(header, "#include \"lut.cube\"\n", "/GLSL_CS/blend.cs", "Main");
+
+		source = permutations.Query(lutKey, error);
+		fnCheck(nullptr != source && source->text.find("return c;") != std::string::npos, "virtual include");
+
+		std::vector<CompositeShaderKey> dropped;
+		fnCheck(false == permutations.SetVirtualFile("lut.cube", lut1, strlen(lut1) ), "same virtual content");
+		fnCheck(permutations.SetVirtualFile("lut.cube", lut2, strlen(lut2) ), "changed virtual content");
+
+		permutations.InvalidateFile("lut.cube", dropped);
+		fnCheck(dropped.size() == 1 && dropped[0] == lutKey, "dropped permutations");
+
+		source = permutations.Query(lutKey, error);
+		fnCheck(nullptr != source && source->text.find("1.0 - c") != std::string::npos, "changed virtual include");
+	}
+
+	// 2 - disk cache, parallel prepare, invalidation by content
+
+	const int numberOfPermutations = 64;
+
+	std::vector<CompositeShaderKey>	keys;
+	std::vector<std::string>		labels;
+
+	for (int i=0; i<numberOfPermutations; ++i)
+	{
+		char define[64];
+		sprintf_s(define, sizeof(define), "#define VARIANT %d\n", i);
+		keys.push_back( MakeTestKey(header, define, "/GLSL_CS/blend.cs", (i & 1) ? "Main" : "") );
+		labels.push_back("variant");
+	}
+
+	{
+		CompositeShaderPermutations permutations(fnRead, "/GLSL_CS/");
+		fnCheck(permutations.SetCacheFolder(cacheFolder.c_str() ), "cache folder");
+
+		for (auto iter=keys.begin(); iter!=keys.end(); ++iter)
+			remove(permutations.GetEntryFilename(*iter).c_str() );
+
+		const auto startTime = clock::now();
+		const int numberOfReady = permutations.Prepare(keys, 4);
+		const double processMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		fnCheck(numberOfReady == numberOfPermutations && permutations.GetNumberOfProcessed() == numberOfPermutations, "cold prepare");
+
+		const std::string manifest = cacheFolder + "/test.keys";
+		std::vector<CompositeShaderKey> loadedKeys;
+		std::vector<std::string> loadedLabels;
+
+		fnCheck(permutations.SaveManifest(manifest.c_str(), keys, labels)
+			&& permutations.LoadManifest(manifest.c_str(), loadedKeys, loadedLabels)
+			&& loadedKeys.size() == keys.size() && std::equal(keys.begin(), keys.end(), loadedKeys.begin() ), "manifest");
+		remove(manifest.c_str() );
+
+		// next session, sources from the disk
+		CompositeShaderPermutations nextSession(fnRead, "/GLSL_CS/");
+		nextSession.SetCacheFolder(cacheFolder.c_str() );
+
+		const auto warmTime = clock::now();
+		nextSession.Prepare(loadedKeys, 4);
+		const double warmMs = std::chrono::duration<double, std::milli>(clock::now() - warmTime).count();
+
+		fnCheck(nextSession.GetNumberOfCacheHits() == numberOfPermutations && nextSession.GetNumberOfProcessed() == 0, "warm prepare");
+
+		const CompositeShaderSource *cached = nextSession.Query(keys[3], error);
+		const CompositeShaderSource *processed = permutations.Query(keys[3], error);
+		fnCheck(cached && processed && cached->fromCache && cached->text == processed->text, "cached source");
+
+		// an entry of another key with the same file name is a miss
+		{
+			std::string data;
+			ReadWholeFile(permutations.GetEntryFilename(keys[0]).c_str(), data);
+			WriteFileAtomic(permutations.GetEntryFilename(keys[1]).c_str(), data.data(), data.size() );
+
+			CompositeShaderPermutations forged(fnRead, "/GLSL_CS/");
+			forged.SetCacheFolder(cacheFolder.c_str() );
+
+			const CompositeShaderSource *source = forged.Query(keys[1], error);
+			fnCheck(source && false == source->fromCache && source->text.find("VARIANT 1\n") != std::string::npos, "foreign entry");
+		}
+
+		// a changed include invalidates entries of whole file permutations, Main part doesn't use it
+		{
+			std::lock_guard<std::mutex> lock(filesMutex);
+			files["/GLSL_CS/math.glsl"] = "float saturate(float x) { return min(max(x, 0.0), 1.0); }\n";
+		}
+
+		CompositeShaderPermutations changed(fnRead, "/GLSL_CS/");
+		changed.SetCacheFolder(cacheFolder.c_str() );
+		changed.Prepare(keys, 4);
+
+		const CompositeShaderSource *source = changed.Query(keys[0], error);
+		fnCheck(changed.GetNumberOfCacheHits() == numberOfPermutations / 2 && source && source->text.find("min(max(x") != std::string::npos, "changed include");
+
+		printf("[ShaderCache] %d permutations, preprocess %.2f ms, from disk %.2f ms\n", numberOfPermutations, processMs, warmMs);
+
+		for (auto iter=keys.begin(); iter!=keys.end(); ++iter)
+			remove(permutations.GetEntryFilename(*iter).c_str() );
+	}
+
+	printf("[ShaderCache] self test %s, %d errors\n", (0 == numberOfErrors) ? "passed" : "FAILED", numberOfErrors);
+	return 0 == numberOfErrors;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_shaderCache.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+/*
+	Compute shader permutations
+
+	a permutation is a header plus a list of (define, file, part) triples. The key is compared
+	 by its content, so two permutations never share a program. A 64 bit hash of the key is only
+	 used for a cache file name, an entry stores the full key and a different key is a miss.
+
+	A source is the header, defines and file parts with every #include pasted in. Sources are
+	 stored on disk together with content hashes of every file they were made from, an entry is
+	 valid while all the files have the same content.
+
+	Scene permutations are listed in a manifest, on load the sources are loaded or preprocessed
+	 in parallel, so only the compile is left for the GL thread.
+
+	No SDK or GL dependency, files are read with a callback.
+*/
+
+#define COMPOSITE_SHADER_PART_IDENT		"//-- PART:"
+
+struct CompositeShaderPart
+{
+	std::string		define;			// could contain #include lines as well
+	std::string		filename;		// empty to skip a file
+	std::string		partname;		// empty for the whole file
+};
+
+//////////////////////////////////////////////////////////////////
+//! exact permutation key
+
+struct CompositeShaderKey
+{
+	std::string							header;
+	std::vector<CompositeShaderPart>	parts;
+
+	bool operator < (const CompositeShaderKey &other) const;
+	bool operator == (const CompositeShaderKey &other) const;
+
+	//! only for names, equal hashes don't mean equal keys
+	uint64_t Hash() const;
+
+	void Write(std::string &out) const;
+	bool Read(const char *&ptr, const char *end);
+};
+
+struct CompositeShaderSource
+{
+	std::string						text;			// ready to compile
+	std::map<std::string, uint64_t>	dependencies;	// every file of the source and its content hash
+	bool							fromCache;
+};
+
+// return false when a file is not found
+typedef std::function<bool(const std::string &filename, std::string &content)>	CompositeShaderReadFunc;
+
+//////////////////////////////////////////////////////////////////
+//
+
+class CompositeShaderPermutations
+{
+public:
+
+	//! a constructor, includes are searched in the root folder
+	CompositeShaderPermutations(const CompositeShaderReadFunc &readFunc, const char *includeRoot);
+
+	//! folder for cache entries, empty to work without a disk cache
+	bool SetCacheFolder(const char *folder);
+	const std::string &GetCacheFolder() const { return mCacheFolder; }
+
+	//! generated code, could be included by a name, returns true when the content is changed
+	bool SetVirtualFile(const char *name, const char *buffer, const size_t bufferLen);
+
+	//! source of a permutation, loaded from the disk cache or preprocessed on a miss
+	const CompositeShaderSource *Query(const CompositeShaderKey &key, std::string &error);
+	//! prepare sources of the keys on several threads, returns number of ready sources
+	int Prepare(const std::vector<CompositeShaderKey> &keys, const int numberOfThreads=0);
+
+	//! drop sources which use the file, file content is read again on the next query
+	void InvalidateFile(const std::string &filename, std::vector<CompositeShaderKey> &droppedKeys);
+	void InvalidateAll();
+
+	// list of permutations of a scene
+	bool SaveManifest(const char *filename, const std::vector<CompositeShaderKey> &keys, const std::vector<std::string> &labels) const;
+	bool LoadManifest(const char *filename, std::vector<CompositeShaderKey> &keys, std::vector<std::string> &labels) const;
+
+	// statistics
+	int GetNumberOfCacheHits() const { return mNumberOfCacheHits; }
+	int GetNumberOfProcessed() const { return mNumberOfProcessed; }
+
+	bool HasSource(const CompositeShaderKey &key) const { return mSources.find(key) != mSources.end(); }
+
+	//! disk cache entry of a key
+	std::string GetEntryFilename(const CompositeShaderKey &key) const;
+	//! manifest of a scene in the cache folder, empty for an unnamed scene
+	std::string GetManifestFilename(const char *sceneFilename) const;
+
+protected:
+
+	struct FileEntry
+	{
+		bool			isOk;
+		std::string		content;
+		uint64_t		hash;
+	};
+
+	CompositeShaderReadFunc		mReadFunc;
+	std::string					mIncludeRoot;
+	std::string					mCacheFolder;
+
+	// file reads are shared by all permutations and threads
+	std::mutex							mFilesMutex;
+	std::map<std::string, FileEntry>	mFiles;
+	std::map<std::string, FileEntry>	mVirtualFiles;
+
+	std::map<CompositeShaderKey, CompositeShaderSource>	mSources;
+
+	std::atomic<int>	mNumberOfCacheHits;
+	std::atomic<int>	mNumberOfProcessed;
+
+	const FileEntry *ReadFile(const std::string &filename);
+	const FileEntry *ReadInclude(const std::string &name, std::string &filename);
+	const FileEntry *ReadDependency(const std::string &filename);
+
+	bool Process(const CompositeShaderKey &key, CompositeShaderSource &source, std::string &error);
+	bool AppendResolved(const std::string &text, std::vector<std::string> &stack, CompositeShaderSource &source, std::string &error);
+
+	bool LoadEntry(const CompositeShaderKey &key, CompositeShaderSource &source);
+	bool StoreEntry(const CompositeShaderKey &key, const CompositeShaderSource &source) const;
+
+	bool LoadOrProcess(const CompositeShaderKey &key, CompositeShaderSource &source, std::string &error);
+};
+
+//! part of a shader file between the part line and the next part, false when there is no such part
+bool CompositeShaderExtractPart(const std::string &content, const std::string &partname, std::string &part);
+
+//! in memory files, checks include resolving, part extraction, key collisions and the disk cache
+bool CompositeShaderCacheSelfTest(const char *folder);
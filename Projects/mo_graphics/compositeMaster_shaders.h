@@ -19,6 +19,7 @@
 #include <GL\glew.h>
 #include "graphics\glslShader.h"
 #include "Types.h"
+#include "compositeMaster_types.h"
 
 //
 /// GLSL shaders for composition components
@@ -97,37 +98,6 @@
 ////////////////////////////////////////////////////
 // shader locations
 
-enum ECompositeBlendType
-{
-	eCompositeBlendNormal,
-	eCompositeBlendLighten,
-	eCompositeBlendDarken,
-	eCompositeBlendMultiply,
-	eCompositeBlendAverage,
-	eCompositeBlendAdd,
-	eCompositeBlendSubstract,
-	eCompositeBlendDifference,
-	eCompositeBlendNegation,
-	eCompositeBlendExclusion,
-	eCompositeBlendScreen,
-	eCompositeBlendOverlay,
-	eCompositeBlendSoftLight,
-	eCompositeBlendHardLight,
-	eCompositeBlendColorDodge,
-	eCompositeBlendColorBurn,
-	eCompositeBlendLinearDodge,
-	eCompositeBlendLinearBurn,
-	// Linear Light is another contrast-increasing mode
-	// If the blend color is darker than midgray, Linear Light darkens the image by decreasing the brightness. If the blend color is lighter than midgray, the result is a brighter image due to increased brightness.
-	eCompositeBlendLinearLight,
-	eCompositeBlendVividLight,
-	eCompositeBlendPinLight,
-	eCompositeBlendHardMix,
-	eCompositeBlendReflect,
-	eCompositeBlendGlow,
-	eCompositeBlendPhoenix
-};
-
 enum ECompositeShader
 {
 	eCompositeShaderBlit,
@@ -0,0 +1,1029 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_textureExchange.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "compositeMaster_textureExchange.h"
+#include "compositeMaster_batch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#include "IO\MappedFile.h"
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#define COMPOSITE_EXCHANGE_IDLE_WAIT_MS		100
+
+static double ExchangeNowMs()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static void SplitFilePath(const std::string &filename, std::string &folder, std::string &name)
+{
+	const size_t pos = filename.find_last_of("\\/");
+
+	if (std::string::npos == pos)
+	{
+		folder = "./";
+		name = filename;
+	}
+	else
+	{
+		folder = filename.substr(0, pos + 1);
+		name = filename.substr(pos + 1);
+	}
+}
+
+static bool IsSameFileName(const std::string &a, const std::string &b)
+{
+#ifdef _WIN32
+	return 0 == _stricmp(a.c_str(), b.c_str() );
+#else
+	return a == b;
+#endif
+}
+
+// FNV-1a of the file content
+static bool FileContentHash(const char *filename, uint64_t &hash)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (nullptr == fp)
+		return false;
+
+	std::vector<unsigned char> buffer(1 << 16);
+	hash = 14695981039346656037ULL;
+
+	size_t count = 0;
+	while ( (count = fread(buffer.data(), 1, buffer.size(), fp) ) > 0)
+	{
+		for (size_t i=0; i<count; ++i)
+		{
+			hash ^= buffer[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	fclose(fp);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeFileWatcher
+
+int CompositeFileWatcher::FindFolder(const std::string &path) const
+{
+	for (int i=0, count=(int) mFolders.size(); i<count; ++i)
+		if (IsSameFileName(mFolders[i].path, path) )
+			return i;
+	return -1;
+}
+
+#ifdef _WIN32
+
+CompositeFileWatcher::CompositeFileWatcher()
+{
+	mWakeEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+}
+
+CompositeFileWatcher::~CompositeFileWatcher()
+{
+	Clear();
+
+	if (nullptr != mWakeEvent)
+		CloseHandle(mWakeEvent);
+}
+
+bool CompositeFileWatcher::AddFile(const char *filename)
+{
+	std::string folder, name;
+	SplitFilePath(filename, folder, name);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		int index = FindFolder(folder);
+		if (index < 0)
+		{
+			HANDLE handle = FindFirstChangeNotificationA(folder.c_str(), FALSE,
+				FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE);
+
+			if (INVALID_HANDLE_VALUE == handle)
+			{
+				printf("[TextureExchange] failed to watch a folder - %s\n", folder.c_str() );
+				return false;
+			}
+
+			WatchFolder watchFolder;
+			watchFolder.path = folder;
+			watchFolder.handle = handle;
+
+			index = (int) mFolders.size();
+			mFolders.push_back(watchFolder);
+		}
+
+		WatchFolder &watchFolder = mFolders[index];
+
+		for (auto iter=watchFolder.names.begin(); iter!=watchFolder.names.end(); ++iter)
+			if (IsSameFileName(*iter, name) )
+				return true;
+
+		uint64_t size = 0;
+		int64_t time = 0;
+		MappedFile::GetFileStamp(filename, size, time);
+
+		watchFolder.names.push_back(name);
+		watchFolder.sizes.push_back(size);
+		watchFolder.times.push_back(time);
+	}
+
+	// waiting thread has to take a new handle
+	Wake();
+	return true;
+}
+
+void CompositeFileWatcher::RemoveFile(const char *filename)
+{
+	std::string folder, name;
+	SplitFilePath(filename, folder, name);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	const int index = FindFolder(folder);
+	if (index < 0)
+		return;
+
+	WatchFolder &watchFolder = mFolders[index];
+
+	for (size_t i=0; i<watchFolder.names.size(); ++i)
+	{
+		if (IsSameFileName(watchFolder.names[i], name) )
+		{
+			watchFolder.names.erase(watchFolder.names.begin() + i);
+			watchFolder.sizes.erase(watchFolder.sizes.begin() + i);
+			watchFolder.times.erase(watchFolder.times.begin() + i);
+			break;
+		}
+	}
+
+	if (watchFolder.names.size() == 0)
+	{
+		FindCloseChangeNotification(watchFolder.handle);
+		mFolders.erase(mFolders.begin() + index);
+	}
+}
+
+void CompositeFileWatcher::Clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (auto iter=mFolders.begin(); iter!=mFolders.end(); ++iter)
+		FindCloseChangeNotification(iter->handle);
+	mFolders.clear();
+}
+
+void CompositeFileWatcher::Wait(const int timeoutMs, std::vector<std::string> &changed)
+{
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	DWORD count = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		handles[count++] = mWakeEvent;
+		for (auto iter=mFolders.begin(); iter!=mFolders.end() && count < MAXIMUM_WAIT_OBJECTS; ++iter)
+			handles[count++] = iter->handle;
+	}
+
+	const DWORD result = WaitForMultipleObjects(count, handles, FALSE, (DWORD) timeoutMs);
+
+	if (result <= WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + count)
+		return;
+
+	HANDLE handle = handles[result - WAIT_OBJECT_0];
+
+	// notification doesn't tell a file, compare stamps of the folder files
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (auto iter=mFolders.begin(); iter!=mFolders.end(); ++iter)
+	{
+		if (iter->handle != handle)
+			continue;
+
+		FindNextChangeNotification(handle);
+
+		for (size_t i=0; i<iter->names.size(); ++i)
+		{
+			const std::string filename = iter->path + iter->names[i];
+
+			uint64_t size = 0;
+			int64_t time = 0;
+			if (false == MappedFile::GetFileStamp(filename.c_str(), size, time) )
+				continue;
+
+			if (size != iter->sizes[i] || time != iter->times[i])
+			{
+				iter->sizes[i] = size;
+				iter->times[i] = time;
+				changed.push_back(filename);
+			}
+		}
+		break;
+	}
+}
+
+void CompositeFileWatcher::Wake()
+{
+	if (nullptr != mWakeEvent)
+		SetEvent(mWakeEvent);
+}
+
+#else
+
+CompositeFileWatcher::CompositeFileWatcher()
+{
+	mNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (0 != pipe(mWakePipe) )
+	{
+		mWakePipe[0] = mWakePipe[1] = -1;
+	}
+	else
+	{
+		fcntl(mWakePipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(mWakePipe[1], F_SETFL, O_NONBLOCK);
+	}
+}
+
+CompositeFileWatcher::~CompositeFileWatcher()
+{
+	Clear();
+
+	if (mNotify >= 0)
+		close(mNotify);
+	if (mWakePipe[0] >= 0)
+		close(mWakePipe[0]);
+	if (mWakePipe[1] >= 0)
+		close(mWakePipe[1]);
+}
+
+bool CompositeFileWatcher::AddFile(const char *filename)
+{
+	std::string folder, name;
+	SplitFilePath(filename, folder, name);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	int index = FindFolder(folder);
+	if (index < 0)
+	{
+		// editors write a file in place or replace it with a renamed temp file
+		const int wd = (mNotify >= 0) ? inotify_add_watch(mNotify, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) : -1;
+
+		if (wd < 0)
+		{
+			printf("[TextureExchange] failed to watch a folder - %s\n", folder.c_str() );
+			return false;
+		}
+
+		WatchFolder watchFolder;
+		watchFolder.path = folder;
+		watchFolder.wd = wd;
+
+		index = (int) mFolders.size();
+		mFolders.push_back(watchFolder);
+	}
+
+	WatchFolder &watchFolder = mFolders[index];
+
+	for (auto iter=watchFolder.names.begin(); iter!=watchFolder.names.end(); ++iter)
+		if (IsSameFileName(*iter, name) )
+			return true;
+
+	watchFolder.names.push_back(name);
+	return true;
+}
+
+void CompositeFileWatcher::RemoveFile(const char *filename)
+{
+	std::string folder, name;
+	SplitFilePath(filename, folder, name);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	const int index = FindFolder(folder);
+	if (index < 0)
+		return;
+
+	WatchFolder &watchFolder = mFolders[index];
+
+	for (auto iter=watchFolder.names.begin(); iter!=watchFolder.names.end(); ++iter)
+	{
+		if (IsSameFileName(*iter, name) )
+		{
+			watchFolder.names.erase(iter);
+			break;
+		}
+	}
+
+	if (watchFolder.names.size() == 0)
+	{
+		inotify_rm_watch(mNotify, watchFolder.wd);
+		mFolders.erase(mFolders.begin() + index);
+	}
+}
+
+void CompositeFileWatcher::Clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (auto iter=mFolders.begin(); iter!=mFolders.end(); ++iter)
+		inotify_rm_watch(mNotify, iter->wd);
+	mFolders.clear();
+}
+
+void CompositeFileWatcher::Wait(const int timeoutMs, std::vector<std::string> &changed)
+{
+	struct pollfd fds[2];
+	fds[0].fd = mNotify;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+	fds[1].fd = mWakePipe[0];
+	fds[1].events = POLLIN;
+	fds[1].revents = 0;
+
+	if (poll(fds, 2, timeoutMs) <= 0)
+		return;
+
+	if (fds[1].revents & POLLIN)
+	{
+		char buffer[64];
+		while (read(mWakePipe[0], buffer, sizeof(buffer) ) > 0) {}
+	}
+
+	if (0 == (fds[0].revents & POLLIN) )
+		return;
+
+	alignas(struct inotify_event) char buffer[4096];
+
+	for (;;)
+	{
+		const ssize_t len = read(mNotify, buffer, sizeof(buffer) );
+		if (len <= 0)
+			break;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		for (const char *ptr = buffer; ptr < buffer + len; )
+		{
+			const struct inotify_event *event = (const struct inotify_event*) ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			// events are lost, every watched file could be changed
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				for (auto iter=mFolders.begin(); iter!=mFolders.end(); ++iter)
+					for (auto nameIter=iter->names.begin(); nameIter!=iter->names.end(); ++nameIter)
+						changed.push_back(iter->path + *nameIter);
+				continue;
+			}
+
+			if (0 == event->len)
+				continue;
+
+			for (auto iter=mFolders.begin(); iter!=mFolders.end(); ++iter)
+			{
+				if (iter->wd != event->wd)
+					continue;
+
+				for (auto nameIter=iter->names.begin(); nameIter!=iter->names.end(); ++nameIter)
+					if (IsSameFileName(*nameIter, event->name) )
+						changed.push_back(iter->path + *nameIter);
+				break;
+			}
+		}
+	}
+}
+
+void CompositeFileWatcher::Wake()
+{
+	if (mWakePipe[1] >= 0)
+	{
+		const char value = 1;
+		if (write(mWakePipe[1], &value, 1) < 0) {}
+	}
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CompositeTextureExchange
+
+CompositeTextureExchange::CompositeTextureExchange()
+	: mStop(false)
+	, mSettleMs(COMPOSITE_EXCHANGE_SETTLE_MS)
+	, mNumberOfBusy(0)
+{}
+
+CompositeTextureExchange::~CompositeTextureExchange()
+{
+	Stop();
+}
+
+void CompositeTextureExchange::Start()
+{
+	if (mThread.joinable() )
+		return;
+
+	mStop = false;
+	mThread = std::thread(&CompositeTextureExchange::WorkerFunc, this);
+}
+
+void CompositeTextureExchange::Stop()
+{
+	if (false == mThread.joinable() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+
+	mWatcher.Wake();
+	mThread.join();
+
+	for (auto iter=mSaveJobs.begin(); iter!=mSaveJobs.end(); ++iter)
+		delete *iter;
+	mSaveJobs.clear();
+
+	mChanged.clear();
+	mNumberOfBusy = 0;
+}
+
+void CompositeTextureExchange::SaveAsync(const void *key, const char *filename, CompositeCPUImage &image, const int newWidth, const int newHeight)
+{
+	SaveJob *job = new SaveJob();
+	job->key = key;
+	job->filename = filename;
+	job->newWidth = newWidth;
+	job->newHeight = newHeight;
+	std::swap(job->image, image);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mSaveJobs.push_back(job);
+		mNumberOfBusy += 1;
+	}
+
+	mWatcher.Wake();
+}
+
+void CompositeTextureExchange::Watch(const void *key, const char *filename)
+{
+	std::string prevFile;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto iter = mWatchKeys.find(key);
+		if (iter != mWatchKeys.end() )
+		{
+			if (iter->second == filename)
+				return;
+			prevFile = iter->second;
+		}
+
+		mWatchKeys[key] = filename;
+
+		for (auto keyIter=mWatchKeys.begin(); keyIter!=mWatchKeys.end() && prevFile.size() > 0; ++keyIter)
+			if (keyIter->second == prevFile)
+				prevFile.clear();
+	}
+
+	if (prevFile.size() > 0)
+		mWatcher.RemoveFile(prevFile.c_str() );
+
+	mWatcher.AddFile(filename);
+}
+
+void CompositeTextureExchange::Unwatch(const void *key)
+{
+	std::string prevFile;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto iter = mWatchKeys.find(key);
+		if (iter == mWatchKeys.end() )
+			return;
+
+		prevFile = iter->second;
+		mWatchKeys.erase(iter);
+
+		for (auto keyIter=mWatchKeys.begin(); keyIter!=mWatchKeys.end() && prevFile.size() > 0; ++keyIter)
+			if (keyIter->second == prevFile)
+				prevFile.clear();
+	}
+
+	if (prevFile.size() > 0)
+		mWatcher.RemoveFile(prevFile.c_str() );
+}
+
+void CompositeTextureExchange::CollectResults(std::vector<CompositeExchangeResult> &results)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (auto iter=mResults.begin(); iter!=mResults.end(); ++iter)
+	{
+		results.push_back(CompositeExchangeResult() );
+		std::swap(results.back(), *iter);
+	}
+	mResults.clear();
+}
+
+int CompositeTextureExchange::GetNumberOfPending()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mNumberOfBusy;
+}
+
+void CompositeTextureExchange::PushResult(const ECompositeExchangeEvent type, const void *key, const std::string &filename, const double ms)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mResults.push_back(CompositeExchangeResult() );
+	CompositeExchangeResult &result = mResults.back();
+
+	result.type = type;
+	result.key = key;
+	result.filename = filename;
+	result.ms = ms;
+}
+
+void CompositeTextureExchange::ProcessSave(SaveJob *job)
+{
+	const double startMs = ExchangeNowMs();
+
+	if (job->newWidth > 0 && job->newHeight > 0
+		&& (job->newWidth != job->image.width || job->newHeight != job->image.height) )
+	{
+		CompositeCPUImage resized;
+		ResizeImage(job->image, job->newWidth, job->newHeight, resized);
+		std::swap(job->image, resized);
+	}
+
+	uint64_t hash = 0;
+	const bool isOk = CompositeBatchWriteTGA(job->filename.c_str(), job->image)
+		&& FileContentHash(job->filename.c_str(), hash);
+
+	if (false == isOk)
+	{
+		printf("[TextureExchange] failed to write %s\n", job->filename.c_str() );
+		PushResult(eCompositeExchangeFailed, job->key, job->filename, ExchangeNowMs() - startMs);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mContentHashes[job->filename] = hash;
+	}
+
+	Watch(job->key, job->filename.c_str() );
+	PushResult(eCompositeExchangeSaved, job->key, job->filename, ExchangeNowMs() - startMs);
+}
+
+bool CompositeTextureExchange::ProcessChange(const std::string &filename)
+{
+	const double startMs = ExchangeNowMs();
+
+	std::vector<const void*> keys;
+	uint64_t prevHash = 0;
+	bool hasPrevHash = false;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		for (auto iter=mWatchKeys.begin(); iter!=mWatchKeys.end(); ++iter)
+			if (iter->second == filename)
+				keys.push_back(iter->first);
+
+		auto hashIter = mContentHashes.find(filename);
+		if (hashIter != mContentHashes.end() )
+		{
+			prevHash = hashIter->second;
+			hasPrevHash = true;
+		}
+	}
+
+	if (keys.size() == 0)
+		return true;
+
+	// file could be locked or replaced at the moment, try again later
+	uint64_t hash = 0;
+	if (false == FileContentHash(filename.c_str(), hash) )
+		return false;
+
+	// our own save or the same content
+	if (hasPrevHash && prevHash == hash)
+		return true;
+
+	CompositeCPUImage image;
+	if (false == CompositeBatchReadTGA(filename.c_str(), image) )
+		return false;
+
+	std::vector<CompositeTextureLevel> levels;
+	BuildMipChain(image, levels);
+
+	const double ms = ExchangeNowMs() - startMs;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mContentHashes[filename] = hash;
+
+	for (size_t i=0; i<keys.size(); ++i)
+	{
+		mResults.push_back(CompositeExchangeResult() );
+		CompositeExchangeResult &result = mResults.back();
+
+		result.type = eCompositeExchangeLoaded;
+		result.key = keys[i];
+		result.filename = filename;
+		result.ms = ms;
+
+		if (i + 1 == keys.size() )
+			std::swap(result.levels, levels);
+		else
+			result.levels = levels;
+	}
+
+	return true;
+}
+
+void CompositeTextureExchange::WorkerFunc()
+{
+	std::vector<std::string> changed;
+
+	for (;;)
+	{
+		SaveJob *job = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			if (mStop)
+				break;
+
+			if (mSaveJobs.size() > 0)
+			{
+				job = mSaveJobs.front();
+				mSaveJobs.erase(mSaveJobs.begin() );
+			}
+		}
+
+		if (nullptr != job)
+		{
+			ProcessSave(job);
+			delete job;
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			mNumberOfBusy -= 1;
+			continue;
+		}
+
+		// wait for a change or until the earliest changed file settles
+
+		double nowMs = ExchangeNowMs();
+		int timeoutMs = COMPOSITE_EXCHANGE_IDLE_WAIT_MS;
+
+		for (auto iter=mChanged.begin(); iter!=mChanged.end(); ++iter)
+		{
+			const int remains = (int) (iter->second.lastEventMs + mSettleMs - nowMs) + 1;
+			timeoutMs = std::max(0, std::min(timeoutMs, remains) );
+		}
+
+		changed.clear();
+		mWatcher.Wait(timeoutMs, changed);
+
+		nowMs = ExchangeNowMs();
+
+		for (auto iter=changed.begin(); iter!=changed.end(); ++iter)
+		{
+			auto changedIter = mChanged.find(*iter);
+			if (changedIter == mChanged.end() )
+			{
+				ChangedFile changedFile;
+				changedFile.lastEventMs = nowMs;
+				changedFile.attempts = 0;
+				mChanged[*iter] = changedFile;
+			}
+			else
+			{
+				changedIter->second.lastEventMs = nowMs;
+			}
+		}
+
+		// decode files without events during the settle time
+
+		for (auto iter=mChanged.begin(); iter!=mChanged.end(); )
+		{
+			if (nowMs - iter->second.lastEventMs < mSettleMs)
+			{
+				++iter;
+				continue;
+			}
+
+			if (ProcessChange(iter->first) )
+			{
+				iter = mChanged.erase(iter);
+			}
+			else if (++iter->second.attempts >= COMPOSITE_EXCHANGE_DECODE_ATTEMPTS)
+			{
+				printf("[TextureExchange] failed to read %s\n", iter->first.c_str() );
+				PushResult(eCompositeExchangeFailed, nullptr, iter->first, 0.0);
+				iter = mChanged.erase(iter);
+			}
+			else
+			{
+				iter->second.lastEventMs = ExchangeNowMs();
+				++iter;
+			}
+		}
+	}
+}
+
+void CompositeTextureExchange::BuildMipChain(const CompositeCPUImage &image, std::vector<CompositeTextureLevel> &levels)
+{
+	levels.clear();
+
+	if (image.IsEmpty() )
+		return;
+
+	levels.push_back(CompositeTextureLevel() );
+	levels[0].width = image.width;
+	levels[0].height = image.height;
+	levels[0].rgba.resize( (size_t) image.width * image.height * 4);
+	image.ToRGBA8(levels[0].rgba.data() );
+
+	// 2x2 box filter, the last row or column is repeated for an odd size
+
+	while (levels.back().width > 1 || levels.back().height > 1)
+	{
+		const CompositeTextureLevel &src = levels.back();
+
+		CompositeTextureLevel dst;
+		dst.width = std::max(1, src.width / 2);
+		dst.height = std::max(1, src.height / 2);
+		dst.rgba.resize( (size_t) dst.width * dst.height * 4);
+
+		for (int y=0; y<dst.height; ++y)
+		{
+			const int y0 = std::min(y * 2, src.height - 1);
+			const int y1 = std::min(y * 2 + 1, src.height - 1);
+
+			const unsigned char *row0 = src.rgba.data() + (size_t) y0 * src.width * 4;
+			const unsigned char *row1 = src.rgba.data() + (size_t) y1 * src.width * 4;
+			unsigned char *out = dst.rgba.data() + (size_t) y * dst.width * 4;
+
+			for (int x=0; x<dst.width; ++x, out += 4)
+			{
+				const int x0 = std::min(x * 2, src.width - 1) * 4;
+				const int x1 = std::min(x * 2 + 1, src.width - 1) * 4;
+
+				for (int c=0; c<4; ++c)
+					out[c] = (unsigned char) ( (row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c] + 2) / 4 );
+			}
+		}
+
+		levels.push_back(CompositeTextureLevel() );
+		std::swap(levels.back(), dst);
+	}
+}
+
+void CompositeTextureExchange::ResizeImage(const CompositeCPUImage &src, const int width, const int height, CompositeCPUImage &dst)
+{
+	dst.Init(width, height);
+
+	if (src.IsEmpty() )
+		return;
+
+	const float scaleX = (float) src.width / width;
+	const float scaleY = (float) src.height / height;
+
+	for (int y=0; y<height; ++y)
+	{
+		const float fy = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+		const int y0 = std::min( (int) fy, src.height - 1);
+		const int y1 = std::min(y0 + 1, src.height - 1);
+		const float ty = fy - y0;
+
+		for (int x=0; x<width; ++x)
+		{
+			const float fx = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+			const int x0 = std::min( (int) fx, src.width - 1);
+			const int x1 = std::min(x0 + 1, src.width - 1);
+			const float tx = fx - x0;
+
+			const float *p00 = src.pixels.data() + ( (size_t) y0 * src.width + x0) * 4;
+			const float *p10 = src.pixels.data() + ( (size_t) y0 * src.width + x1) * 4;
+			const float *p01 = src.pixels.data() + ( (size_t) y1 * src.width + x0) * 4;
+			const float *p11 = src.pixels.data() + ( (size_t) y1 * src.width + x1) * 4;
+
+			float *out = dst.pixels.data() + ( (size_t) y * width + x) * 4;
+
+			for (int c=0; c<4; ++c)
+			{
+				const float top = p00[c] + (p10[c] - p00[c]) * tx;
+				const float bottom = p01[c] + (p11[c] - p01[c]) * tx;
+				out[c] = top + (bottom - top) * ty;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// synthetic test
+
+static void MakeTestImage(CompositeCPUImage &image, const int width, const int height, const int pattern)
+{
+	image.Init(width, height);
+
+	for (int y=0; y<height; ++y)
+		for (int x=0; x<width; ++x)
+		{
+			float *p = image.pixels.data() + ( (size_t) y * width + x) * 4;
+			p[0] = (float) x / width;
+			p[1] = (float) y / height;
+			p[2] = ( ( (x / 8) + (y / 8) + pattern) & 1) ? 1.0f : 0.0f;
+			p[3] = 1.0f;
+		}
+}
+
+static bool WaitExchangeResult(CompositeTextureExchange &exchange, const int timeoutMs, std::vector<CompositeExchangeResult> &results)
+{
+	results.clear();
+	const double startMs = ExchangeNowMs();
+
+	while (results.size() == 0 && ExchangeNowMs() - startMs < timeoutMs)
+	{
+		exchange.CollectResults(results);
+		if (results.size() == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(5) );
+	}
+	return results.size() > 0;
+}
+
+static bool IsSameLevel(const CompositeTextureLevel &level, const CompositeCPUImage &image)
+{
+	if (level.width != image.width || level.height != image.height)
+		return false;
+
+	std::vector<unsigned char> rgba( (size_t) image.width * image.height * 4);
+	image.ToRGBA8(rgba.data() );
+	return rgba == level.rgba;
+}
+
+bool CompositeTextureExchangeSelfTest(const char *folder)
+{
+	const std::string filename = std::string(folder) + "/exchange_test_0.tga";
+	const std::string otherFilename = std::string(folder) + "/exchange_test_1.tga";
+	const std::string tempFilename = std::string(folder) + "/exchange_test_0.tmp";
+
+	remove(filename.c_str() );
+	remove(otherFilename.c_str() );
+
+	int keys[2] = {0, 0};
+	const int settleMs = 50;
+	const int timeoutMs = 5000;
+
+	CompositeTextureExchange exchange;
+	exchange.SetSettleMs(settleMs);
+	exchange.Start();
+
+	std::vector<CompositeExchangeResult> results;
+	int numberOfErrors = 0;
+
+	auto fnCheck = [&numberOfErrors] (const bool value, const char *text) {
+		if (false == value)
+		{
+			printf("[TextureExchange] test failed - %s\n", text);
+			numberOfErrors += 1;
+		}
+	};
+
+	// 1 - async save with a resize, our own write is not reloaded
+
+	CompositeCPUImage image;
+	MakeTestImage(image, 256, 128, 0);
+	exchange.SaveAsync(&keys[0], filename.c_str(), image, 128, 64);
+
+	fnCheck(image.IsEmpty(), "image is taken by the save");
+	fnCheck(WaitExchangeResult(exchange, timeoutMs, results) && results[0].type == eCompositeExchangeSaved, "save result");
+
+	CompositeCPUImage saved;
+	fnCheck(CompositeBatchReadTGA(filename.c_str(), saved) && saved.width == 128 && saved.height == 64, "saved size");
+
+	fnCheck(false == WaitExchangeResult(exchange, settleMs * 4, results), "own save is not reloaded");
+
+	// 2 - editor writes the file in place, in two steps
+
+	CompositeCPUImage edited;
+	MakeTestImage(edited, 64, 32, 1);
+	CompositeBatchWriteTGA(tempFilename.c_str(), edited);
+
+	{
+		std::vector<char> bytes;
+		FILE *fp = fopen(tempFilename.c_str(), "rb");
+		if (fp)
+		{
+			char buffer[4096];
+			size_t count;
+			while ( (count = fread(buffer, 1, sizeof(buffer), fp) ) > 0)
+				bytes.insert(bytes.end(), buffer, buffer + count);
+			fclose(fp);
+		}
+		remove(tempFilename.c_str() );
+
+		const size_t half = bytes.size() / 2;
+
+		fp = fopen(filename.c_str(), "wb");
+		if (fp)
+		{
+			fwrite(bytes.data(), 1, half, fp);
+			fclose(fp);
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(settleMs / 5) );
+
+		fp = fopen(filename.c_str(), "ab");
+		if (fp)
+		{
+			fwrite(bytes.data() + half, 1, bytes.size() - half, fp);
+			fclose(fp);
+		}
+	}
+
+	const bool hasLoaded = WaitExchangeResult(exchange, timeoutMs, results);
+	fnCheck(hasLoaded && results[0].type == eCompositeExchangeLoaded && results[0].key == &keys[0], "in place edit is loaded");
+
+	if (hasLoaded && results[0].levels.size() > 0)
+	{
+		const std::vector<CompositeTextureLevel> &levels = results[0].levels;
+
+		fnCheck(levels.size() == 7, "mip count for 64x32");
+		fnCheck(IsSameLevel(levels[0], edited), "level 0 content");
+		fnCheck(levels.back().width == 1 && levels.back().height == 1, "last mip is 1x1");
+	}
+
+	fnCheck(false == WaitExchangeResult(exchange, settleMs * 4, results), "one reload for a two step write");
+
+	// 3 - editor saves into a temp file and renames it
+
+	MakeTestImage(edited, 32, 32, 0);
+	CompositeBatchWriteTGA(tempFilename.c_str(), edited);
+#ifdef _WIN32
+	remove(filename.c_str() );
+#endif
+	rename(tempFilename.c_str(), filename.c_str() );
+
+	fnCheck(WaitExchangeResult(exchange, timeoutMs, results) && results[0].type == eCompositeExchangeLoaded
+		&& results[0].levels.size() > 0 && IsSameLevel(results[0].levels[0], edited), "renamed file is loaded");
+
+	// 4 - a second watched file, then the first one is not watched anymore
+
+	exchange.Watch(&keys[1], otherFilename.c_str() );
+	MakeTestImage(edited, 16, 16, 1);
+	CompositeBatchWriteTGA(otherFilename.c_str(), edited);
+
+	fnCheck(WaitExchangeResult(exchange, timeoutMs, results) && results[0].key == &keys[1], "second file is loaded");
+
+	exchange.Unwatch(&keys[0]);
+	MakeTestImage(edited, 16, 16, 0);
+	CompositeBatchWriteTGA(filename.c_str(), edited);
+
+	fnCheck(false == WaitExchangeResult(exchange, settleMs * 4, results), "not watched file");
+
+	exchange.Stop();
+
+	remove(filename.c_str() );
+	remove(otherFilename.c_str() );
+
+	printf("[TextureExchange] self test %s, %d errors\n", (0 == numberOfErrors) ? "passed" : "FAILED", numberOfErrors);
+	return 0 == numberOfErrors;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_textureExchange.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "compositeMaster_cpuBackend.h"
+
+/*
+	Texture exchange with an external image editor
+
+	decal image is grabbed on the main thread, resized and encoded into a file on a worker thread.
+	 Exported files are watched, when an editor writes a file, the worker waits until the file
+	 settles (editors write in several steps), decodes it and builds a mip chain. The main thread
+	 takes ready results on the next frame and only uploads the levels.
+
+	A file with the same content hash as the last saved or loaded one is not decoded again,
+	 so the change event of our own save is ignored.
+
+	Watcher is a folder change notification on win32 and inotify on linux.
+	 Files are tga (CompositeBatchReadTGA / CompositeBatchWriteTGA). No SDK or GL dependency.
+*/
+
+#define COMPOSITE_EXCHANGE_SETTLE_MS		250
+#define COMPOSITE_EXCHANGE_DECODE_ATTEMPTS	4
+
+//////////////////////////////////////////////////////////////////
+//! change notification for a set of files, folders of the files are watched
+
+class CompositeFileWatcher
+{
+public:
+
+	//! a constructor
+	CompositeFileWatcher();
+	//! a destructor
+	~CompositeFileWatcher();
+
+	bool AddFile(const char *filename);
+	void RemoveFile(const char *filename);
+	void Clear();
+
+	//! blocks up to timeoutMs or until Wake, paths of changed watched files are appended
+	void Wait(const int timeoutMs, std::vector<std::string> &changed);
+	//! interrupt Wait from another thread
+	void Wake();
+
+protected:
+
+	struct WatchFolder
+	{
+		std::string					path;		// with a trailing separator
+		std::vector<std::string>	names;		// watched file names in the folder
+#ifdef _WIN32
+		void						*handle;
+		std::vector<uint64_t>		sizes;		// stamps to find out which file is changed
+		std::vector<int64_t>		times;
+#else
+		int							wd;
+#endif
+	};
+
+	std::mutex					mMutex;
+	std::vector<WatchFolder>	mFolders;
+
+#ifdef _WIN32
+	void						*mWakeEvent;
+#else
+	int							mNotify;
+	int							mWakePipe[2];
+#endif
+
+	int FindFolder(const std::string &path) const;
+
+private:
+	// no copy
+	CompositeFileWatcher(const CompositeFileWatcher &);
+	void operator = (const CompositeFileWatcher &);
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+struct CompositeTextureLevel
+{
+	int							width;
+	int							height;
+	std::vector<unsigned char>	rgba;		// row 0 is a bottom row
+};
+
+enum ECompositeExchangeEvent
+{
+	eCompositeExchangeSaved,
+	eCompositeExchangeLoaded,
+	eCompositeExchangeFailed
+};
+
+struct CompositeExchangeResult
+{
+	ECompositeExchangeEvent				type;
+	const void							*key;		// decal the file belongs to
+	std::string							filename;
+	std::vector<CompositeTextureLevel>	levels;		// loaded image, level 0 is the full size
+	double								ms;			// encode or decode with mips on the worker
+};
+
+class CompositeTextureExchange
+{
+public:
+
+	//! a constructor
+	CompositeTextureExchange();
+	//! a destructor
+	~CompositeTextureExchange();
+
+	void Start();
+	// not finished jobs are dropped
+	void Stop();
+
+	bool IsRunning() const { return mThread.joinable(); }
+
+	//! resize (0 keeps the size) and encode on the worker, image is taken by a swap, the file is watched for the key
+	void SaveAsync(const void *key, const char *filename, CompositeCPUImage &image, const int newWidth, const int newHeight);
+
+	//! reload a key texture when the file changes, cheap to call every frame with the same file
+	void Watch(const void *key, const char *filename);
+	void Unwatch(const void *key);
+
+	//! main thread, results since the last call
+	void CollectResults(std::vector<CompositeExchangeResult> &results);
+
+	void SetSettleMs(const int ms) { mSettleMs = ms; }
+
+	// number of jobs which are not finished yet
+	int GetNumberOfPending();
+
+	//! full size image plus a box filtered mip chain down to 1x1
+	static void BuildMipChain(const CompositeCPUImage &image, std::vector<CompositeTextureLevel> &levels);
+	//! bilinear resize
+	static void ResizeImage(const CompositeCPUImage &src, const int width, const int height, CompositeCPUImage &dst);
+
+protected:
+
+	struct SaveJob
+	{
+		const void			*key;
+		std::string			filename;
+		CompositeCPUImage	image;
+		int					newWidth;
+		int					newHeight;
+	};
+
+	struct ChangedFile
+	{
+		double				lastEventMs;
+		int					attempts;
+	};
+
+	std::thread						mThread;
+	std::mutex						mMutex;
+	bool							mStop;
+	int								mSettleMs;
+
+	CompositeFileWatcher			mWatcher;
+
+	std::vector<SaveJob*>			mSaveJobs;
+	std::map<const void*, std::string>	mWatchKeys;
+	std::map<std::string, uint64_t>		mContentHashes;		// last saved or loaded content per file
+
+	std::map<std::string, ChangedFile>	mChanged;			// worker only
+	int								mNumberOfBusy;
+
+	std::vector<CompositeExchangeResult>	mResults;
+
+	void WorkerFunc();
+	void ProcessSave(SaveJob *job);
+	bool ProcessChange(const std::string &filename);
+
+	void PushResult(const ECompositeExchangeEvent type, const void *key, const std::string &filename, const double ms);
+};
+
+//! synthetic images are saved, changed by a stand-in editor and reloaded through the watcher
+bool CompositeTextureExchangeSelfTest(const char *folder);
@@ -0,0 +1,53 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: compositeMaster_types.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// composition enums without SDK or GL dependency, shared with the CPU backend
+
+enum ECompositeBlendType
+{
+	eCompositeBlendNormal,
+	eCompositeBlendLighten,
+	eCompositeBlendDarken,
+	eCompositeBlendMultiply,
+	eCompositeBlendAverage,
+	eCompositeBlendAdd,
+	eCompositeBlendSubstract,
+	eCompositeBlendDifference,
+	eCompositeBlendNegation,
+	eCompositeBlendExclusion,
+	eCompositeBlendScreen,
+	eCompositeBlendOverlay,
+	eCompositeBlendSoftLight,
+	eCompositeBlendHardLight,
+	eCompositeBlendColorDodge,
+	eCompositeBlendColorBurn,
+	eCompositeBlendLinearDodge,
+	eCompositeBlendLinearBurn,
+	// Linear Light is another contrast-increasing mode
+	// If the blend color is darker than midgray, Linear Light darkens the image by decreasing the brightness. If the blend color is lighter than midgray, the result is a brighter image due to increased brightness.
+	eCompositeBlendLinearLight,
+	eCompositeBlendVividLight,
+	eCompositeBlendPinLight,
+	eCompositeBlendHardMix,
+	eCompositeBlendReflect,
+	eCompositeBlendGlow,
+	eCompositeBlendPhoenix
+};
+
+enum ETextureWrapMode
+{
+	eTextureWrapClampToZero,
+	eTextureWrapClampToEdge,
+	eTextureWrapMirroredRepeat,
+	eTextureWrapRepeat
+};
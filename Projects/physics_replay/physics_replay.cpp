@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: physics_replay.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// replay of a MoPhysics solver capture without MotionBuilder
+//
+//	physics_replay <capture file> [tolerance] [result file]
+//
+//	 the capture is replayed twice, both runs have to give the same outputs,
+//	 the first run is compared with the outputs recorded in MotionBuilder
+//
+
+#include "moPhysics_replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void PrintStats(const char *name, const PhysicsReplayStats &stats)
+{
+	printf( "%s - %d frames, %d steps, setup %.2f ms, total %.2f ms\n", name, stats.numberOfFrames, stats.numberOfSteps, stats.setupMs, stats.totalMs );
+	printf( "\tstep min %.3f ms, median %.3f ms, p95 %.3f ms, max %.3f ms\n", stats.minStepMs, stats.medianStepMs, stats.p95StepMs, stats.maxStepMs );
+}
+
+void PrintDiff(const char *name, const PhysicsCaptureDiff &diff)
+{
+	printf( "%s - %d frames compared, max difference %g (frame %d, value %d)", name, diff.numberOfFrames, diff.maxDiff, diff.worstFrame, diff.worstValue );
+
+	if (diff.firstFrame >= 0)
+		printf( ", first frame over the tolerance %d\n", diff.firstFrame );
+	else
+		printf( "\n" );
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf( "usage: physics_replay <capture file> [tolerance] [result file]\n" );
+		return 1;
+	}
+
+	const double tolerance = (argc > 2) ? atof(argv[2]) : 1.0e-6;
+
+	PhysicsCapture capture;
+	if (false == capture.Load(argv[1]) )
+		return 1;
+
+	printf( "capture %s - %d cars, %d bodies, %d frames, %d option events\n", argv[1], (int) capture.cars.size(), 
+		(int) capture.bodies.size(), capture.GetNumberOfFrames(), (int) capture.events.size() );
+
+	PhysicsCapture first, second;
+	PhysicsReplayStats stats;
+
+	if (false == PhysicsReplayRun(capture, first, stats) )
+		return 1;
+	PrintStats( "run 1", stats );
+
+	if (false == PhysicsReplayRun(capture, second, stats) )
+		return 1;
+	PrintStats( "run 2", stats );
+
+	PhysicsCaptureDiff diff;
+
+	const bool deterministic = PhysicsCaptureCompare(first, second, 0.0, diff);
+	PrintDiff( "determinism", diff );
+
+	const bool matching = PhysicsCaptureCompare(capture, first, tolerance, diff);
+	PrintDiff( "recorded outputs", diff );
+
+	if (argc > 3)
+		first.Save(argv[3]);
+
+	printf( "%s\n", (deterministic && matching) ? "PASSED" : "FAILED" );
+	return (deterministic && matching) ? 0 : 2;
+}
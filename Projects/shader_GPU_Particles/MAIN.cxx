@@ -80,6 +80,9 @@ bool FBLibrary::LibReady()	{
 		FBString computeSelfCollisionsLocation(effectPath, "\\GLSL_CS\\Particles_selfcollisions.cs");
 		GPUParticles::ParticleShaderFX::SetComputeSelfCollisionsShaderLocation( computeSelfCollisionsLocation, computeSelfCollisionsLocation.GetLen() );
 
+		FBString computeDepthSortLocation(effectPath, "\\GLSL_CS\\Particles_sort.cs");
+		GPUParticles::ParticleShaderFX::SetComputeDepthSortShaderLocation( computeDepthSortLocation, computeDepthSortLocation.GetLen() );
+
 		FBString computeIntegrateLocation(effectPath, "\\GLSL_CS\\Particles_integrate.cs");
 		GPUParticles::ParticleShaderFX::SetComputeIntegrateLocation( computeIntegrateLocation, computeIntegrateLocation.GetLen() );
 
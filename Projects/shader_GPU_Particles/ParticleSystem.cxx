@@ -12,12 +12,15 @@
 
 
 #include "ParticleSystem.h"
+#include "ParticleSystem_SelfCollisions.h"
+#include "ParticleSystem_DepthSort.h"
 #include "graphics\checkglerror.h"
 #include "IO\FileUtils.h"
 #include "algorithm\nv_math.h"
 #include "algorithm\math3d.h"
 
 #include <vector>
+#include <algorithm>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -175,6 +178,14 @@ ParticleSystem::ParticleSystem(unsigned int maxparticles)
 
 	mTransformFeedback[0] = mTransformFeedback[1] = 0;
 	mParticleBuffer[0] = mParticleBuffer[1] = 0;
+
+	memset( mSelfCollisionsBuffers, 0, sizeof(GLuint) * 4 );
+	mSelfCollisionsCapacity = 0;
+
+	memset( mDepthSortBuffers, 0, sizeof(GLuint) * 5 );
+	mDepthSortCapacity = 0;
+	mDepthSortCount = 0;
+	mDrawSorted = false;
 	
 #ifdef _DEBUG
 	glEnable(GL_DEBUG_OUTPUT);
@@ -224,9 +235,161 @@ void ParticleSystem::ClearParticleSystem()
 	mBufferSurface[0].Free();
 	mBufferSurface[1].Free();
 
+	FreeSelfCollisionsBuffers();
+	FreeDepthSortBuffers();
 	FreeNoiseTexture();
 }
 
+void ParticleSystem::PrepSelfCollisionsBuffers()
+{
+	if (mSelfCollisionsBuffers[0] > 0 && mSelfCollisionsCapacity == mMaxParticles)
+		return;
+
+	FreeSelfCollisionsBuffers();
+
+	const GLsizeiptr numberOfCells = (GLsizeiptr) SelfCollisionsNumberOfCells( (int) mMaxParticles );
+	const GLsizeiptr numberOfParticles = (GLsizeiptr) mMaxParticles;
+
+	const GLsizeiptr sizes[4] = {
+		numberOfCells * sizeof(GLuint) * 2,						// count and start
+		sizeof(GLuint) * 4 + sizeof(GLuint) * (numberOfCells / SELF_COLLISIONS_SCAN_BLOCK),	// max radius and block sums
+		numberOfParticles * sizeof(GLuint) * 2,					// cell and rank
+		numberOfParticles * sizeof(vec4) * 2					// position, velocity with age
+	};
+
+	glGenBuffers(4, mSelfCollisionsBuffers);
+
+	for (int i=0; i<4; ++i)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSelfCollisionsBuffers[i]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizes[i], nullptr, GL_DYNAMIC_COPY);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	mSelfCollisionsCapacity = mMaxParticles;
+}
+
+void ParticleSystem::FreeSelfCollisionsBuffers()
+{
+	if (mSelfCollisionsBuffers[0] > 0)
+	{
+		glDeleteBuffers(4, mSelfCollisionsBuffers);
+		memset( mSelfCollisionsBuffers, 0, sizeof(GLuint) * 4 );
+	}
+	mSelfCollisionsCapacity = 0;
+}
+
+void ParticleSystem::PrepDepthSortBuffers()
+{
+	const unsigned int capacity = std::min(mMaxParticles, (unsigned int) DEPTH_SORT_MAX_PARTICLES);
+
+	if (mDepthSortBuffers[0] > 0 && mDepthSortCapacity == capacity)
+		return;
+
+	FreeDepthSortBuffers();
+
+	const GLsizeiptr numberOfParticles = (GLsizeiptr) capacity;
+	const GLsizeiptr numberOfEntries = DEPTH_SORT_BUCKETS * ( (numberOfParticles + DEPTH_SORT_GROUP_SIZE - 1) / DEPTH_SORT_GROUP_SIZE );
+
+	const GLsizeiptr sizes[5] = {
+		numberOfParticles * sizeof(GLuint),						// draw order
+		numberOfParticles * sizeof(GLuint) * 3,					// keys in the buffer order and two halves for passes
+		numberOfParticles * sizeof(GLuint) * 2,					// particle indices, two halves
+		numberOfEntries * sizeof(GLuint),						// histograms of work groups
+		sizeof(GLuint) * 16 + sizeof(GLuint) * ( (numberOfEntries + DEPTH_SORT_SCAN_BLOCK - 1) / DEPTH_SORT_SCAN_BLOCK )	// flags, dispatch arguments and block sums
+	};
+
+	glGenBuffers(5, mDepthSortBuffers);
+
+	for (int i=0; i<5; ++i)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDepthSortBuffers[i]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizes[i], nullptr, GL_DYNAMIC_COPY);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	mDepthSortCapacity = capacity;
+	mDepthSortCount = 0;
+}
+
+void ParticleSystem::FreeDepthSortBuffers()
+{
+	if (mDepthSortBuffers[0] > 0)
+	{
+		glDeleteBuffers(5, mDepthSortBuffers);
+		memset( mDepthSortBuffers, 0, sizeof(GLuint) * 5 );
+	}
+	mDepthSortCapacity = 0;
+	mDepthSortCount = 0;
+}
+
+bool ParticleSystem::SortParticles()
+{
+	if (0 == mInstanceCount || mInstanceCount > DEPTH_SORT_MAX_PARTICLES || mInstanceCount > mMaxParticles)
+		return false;
+
+	PrepDepthSortBuffers();
+
+	// view space z of a world position
+	const float *mv = mRenderData.gMV.mat_array;
+	const vec4 viewRow(mv[2], mv[6], mv[10], mv[14]);
+
+	// the previous order is a permutation of [0; count), new particles are added after it
+	const int prevCount = (mDepthSortCount <= mInstanceCount) ? (int) mDepthSortCount : 0;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mParticleBuffer[mCurrTFB]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mDepthSortBuffers[0]);
+
+	for (int i=1; i<5; ++i)
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3 + i, mDepthSortBuffers[i]);
+
+	mShader->BindDepthSort();
+	mShader->DispatchDepthSort( (int) mInstanceCount, prevCount, viewRow, mDepthSortBuffers[4] );
+	mShader->UnBindDepthSort();
+
+	mDepthSortCount = mInstanceCount;
+	return true;
+}
+
+unsigned int ParticleSystem::ReadParticles(std::vector<Particle> &particles)
+{
+	if (0 == mParticleBuffer[mCurrTFB] || 0 == mInstanceCount)
+	{
+		particles.clear();
+		return 0;
+	}
+
+	particles.resize(mInstanceCount);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mParticleBuffer[mCurrTFB]);
+	glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Particle) * mInstanceCount, particles.data() );
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	CHECK_GL_ERROR();
+	return mInstanceCount;
+}
+
+void ParticleSystem::WriteParticles(const Particle *particles, const unsigned int count)
+{
+	if (0 == mParticleBuffer[mCurrTFB])
+		return;
+
+	// buffers are allocated for the maximum particles
+	const unsigned int numberOfParticles = (count < mMaxParticles) ? count : mMaxParticles;
+
+	if (numberOfParticles > 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, mParticleBuffer[mCurrTFB]);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Particle) * numberOfParticles, particles);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	mInstanceCount = numberOfParticles;
+	mNeedReset = true;
+
+	CHECK_GL_ERROR();
+}
+
 void ParticleSystem::PrepNoiseTexture()
 {
 	if (mNoiseTexture == 0)
@@ -709,6 +872,11 @@ const unsigned int ParticleSystem::SimulateParticles(const bool emitEachStep, co
 
 	if (selfCollisions)
 	{
+		PrepSelfCollisionsBuffers();
+
+		// the table is sized by the current count of particles, buffers by the maximum one
+		const int numberOfCells = SelfCollisionsNumberOfCells( (int) mInstanceCount );
+
 		while(ltime > timeStep)
 		{
 			globalTime += timeStep;
@@ -746,8 +914,11 @@ const unsigned int ParticleSystem::SimulateParticles(const bool emitEachStep, co
 			glFinish();
 
 			//
+			for (int i=0; i<4; ++i)
+				glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4 + i, mSelfCollisionsBuffers[i]);
+
 			mShader->BindSelfCollisions();
-			mShader->DispatchSelfCollisions( (float) timeStep, mInstanceCount, 256, 1, 1 );
+			mShader->DispatchSelfCollisions( (float) timeStep, mInstanceCount, numberOfCells, 256, 1, 1 );
 			mShader->UnBindSelfCollisions();
 
 			// GL_ALL_BARRIER_BITS
@@ -832,45 +1003,17 @@ const unsigned int ParticleSystem::SimulateParticles(const bool emitEachStep, co
 bool ParticleSystem::EmitterSurfaceUpdateOnCPU(const int vertexCount, float *positionsArray, 
 	float *normalArray, float *uvArray, const int indexCount, const int *indexArray, const GLuint textureId )
 {
-	if (indexCount < 3 || vertexCount < 1)
+	if (indexCount < 3 || vertexCount < 1 || nullptr == positionsArray || nullptr == normalArray || nullptr == indexArray)
 		return false;
 
-	vec4 *positions4 = (vec4*) positionsArray;
-	vec4 *normals4 = (vec4*) normalArray;
-	vec2 *uv2 = (vec2*) uvArray;
-
-	const int triCount = indexCount / 3;
-	mSurfaceData.resize(triCount);
-
-	auto triIter = begin(mSurfaceData);
+	// a new buffer (first update, new context) has to get the whole surface
+	if ( 0 == mBufferSurface[mSurfaceFront].GetBufferId() )
+		mSurfaceCache.Invalidate();
 
-	vec4 n0, n1, n2;
+	// only triangles with changed vertices are built again, see ParticleSystem_SurfaceEmitter.h
+	mSurfaceCache.Update( vertexCount, positionsArray, normalArray, uvArray, indexCount, indexArray, mSurfaceData );
 
-	for (int i=0; i<indexCount; i+=3)
-	{
-		triIter->p0 = positions4[ indexArray[i] ];
-		triIter->p1 = positions4[ indexArray[i + 1] ];
-		triIter->p2 = positions4[ indexArray[i + 2] ];
-
-		triIter->p0.w = 1.0f;
-		triIter->p1.w = 1.0f;
-		triIter->p2.w = 1.0f;
-
-		n0 = normals4[ indexArray[i] ];
-		n1 = normals4[ indexArray[i + 1] ];
-		n2 = normals4[ indexArray[i + 2] ];
-
-		// TODO: compute average from n0, n1, n2
-		triIter->n = 1.0 / 3.0 * (n0 + n1 + n2);
-		triIter->n.w = 1.0f;
-		normalize(triIter->n);
-
-		triIter->uv0 = uv2[ indexArray[i] ];
-		triIter->uv1 = uv2[ indexArray[i + 1] ];
-		triIter->uv2 = uv2[ indexArray[i + 2] ];
-
-		triIter++;
-	}
+	const int triCount = indexCount / 3;
 
 	//
 	//
@@ -900,6 +1043,9 @@ bool ParticleSystem::EmitterSurfaceUpdateOnGPU(void *pModelVertexData, const GLu
 	if (0 == numberOfVertices)
 		return false;
 
+	// compute shader writes the buffers, cpu copy of the surface is not valid any more
+	mSurfaceCache.Invalidate();
+
 
 	int numberOfIndices = 0;
 	
@@ -987,7 +1133,31 @@ bool ParticleSystem::EmitterSurfaceUpdateOnGPU(void *pModelVertexData, const GLu
 // that's only for the case when data is updating on CPU
 void ParticleSystem::UploadSurfaceDataToGPU()
 {
-	mBufferSurface[mSurfaceFront].UpdateData( sizeof(TTriangle), (int)mSurfaceData.size(), mSurfaceData.data() );
+	CGPUBufferNV &buf = mBufferSurface[mSurfaceFront];
+
+	if (mSurfaceCache.IsFullUpload() || 0 == buf.GetBufferId() || buf.GetCount() != (int)mSurfaceData.size() )
+	{
+		buf.UpdateData( sizeof(TTriangle), (int)mSurfaceData.size(), mSurfaceData.data() );
+	}
+	else
+	{
+		// rebuilt ranges in place, nothing to do for a static surface
+		const std::vector<int> &ranges = mSurfaceCache.GetUploadRanges();
+
+		if (ranges.size() > 0)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, buf.GetBufferId() );
+
+			for (size_t i=0; i<ranges.size(); i+=2)
+			{
+				glBufferSubData(GL_UNIFORM_BUFFER, sizeof(TTriangle) * ranges[i], sizeof(TTriangle) * ranges[i+1],
+					mSurfaceData.data() + ranges[i] );
+			}
+
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+	}
+
 	// TODO: do we support per-vertex velocity when computing on CPU ?!
 	//mBufferSurface[mSurfaceBack].UpdateData( sizeof(TTriangle), (int)mSurfaceData.size(), mSurfaceData.data() );
 }
\ No newline at end of file
@@ -17,6 +17,7 @@
 #include "algorithm\math3d.h"
 
 #include "ParticleSystem_types.h"
+#include "ParticleSystem_SurfaceEmitter.h"
 #include "Shader_ParticleSystem.h"
 #include "graphics\UniformBuffer.h"
 
@@ -201,6 +202,11 @@ public:
 
 	void	UploadSurfaceDataToGPU();
 
+	// how much of the surface was rebuilt and uploaded by the last update on CPU
+	const SurfaceEmitterStats &GetSurfaceStats() const {
+		return mSurfaceCache.GetStats();
+	}
+
 	// run evaluate shader
 
 	void SetParticleSize(const double size, const double size_variation);
@@ -235,9 +241,16 @@ public:
 		return mInstanceCount;
 	}
 
+	// particle cache, the current simulation buffer is read back for a bake and replaced on playback
+
+	unsigned int ReadParticles(std::vector<Particle> &particles);
+	// simulation is reset on the next step, transform feedback does not know the uploaded count
+	void WriteParticles(const Particle *particles, const unsigned int count);
+
 	// textures for size and color lookup ( 0 - to disable )
 	void	SetRenderSizeAndColorCurves( GLuint sizeTextureId, GLuint colorTextureId );
-    void RenderParticles(int type, const bool pointSmooth, const bool pointFalloff);
+	// depthSort - draw points back to front for the alpha blending, instances are drawn in the buffer order
+    void RenderParticles(int type, const bool pointSmooth, const bool pointFalloff, const bool depthSort=false);
 
 	void SetConnections(ParticleSystemConnections	*pConnections)
 	{
@@ -306,6 +319,7 @@ protected:
 
 	GLuint						mSurfaceTextureId;
 	std::vector<TTriangle>		mSurfaceData;
+	SurfaceEmitterCache			mSurfaceCache;		// topology and deformation of the last update on CPU
 
 	GLuint						mSurfaceMaskId;
 
@@ -374,6 +388,26 @@ protected:
 	void RenderStretchedBillboards();
 	void RenderInstances();
 
+	// glDrawArrays or glDrawElements with the depth order
+	void DrawPoints();
+
+	// depth sort - order (element array), keys, values, histograms, control with dispatch arguments
+	GLuint						mDepthSortBuffers[5];
+	unsigned int				mDepthSortCapacity;
+	unsigned int				mDepthSortCount;		// count of the last order, it is reused for the next one
+	bool						mDrawSorted;
+
+	void PrepDepthSortBuffers();
+	void FreeDepthSortBuffers();
+	bool SortParticles();
+
+	// self collisions grid - cells, block sums, particle keys and a sorted copy of particles
+	GLuint						mSelfCollisionsBuffers[4];
+	unsigned int				mSelfCollisionsCapacity;
+
+	void PrepSelfCollisionsBuffers();
+	void FreeSelfCollisionsBuffers();
+
 	void SwapBuffers();	// operation to switch update and render double-buffers
 	void SwapSurfaceBuffers();
 };
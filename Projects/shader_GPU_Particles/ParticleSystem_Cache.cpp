@@ -0,0 +1,1167 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_Cache.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_Cache.h"
+#include "algorithm\ParallelFor.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <float.h>
+#include <string.h>
+#include <limits.h>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+using namespace GPUParticles;
+
+#define CACHE_LZ_MIN_MATCH		4
+#define CACHE_LZ_HASH_BITS		16
+#define CACHE_LZ_WINDOW			65535
+
+#define CACHE_NO_FRAME			INT_MIN
+
+// floats of the particle, RotVel (16-19) is not stored
+static const int gQuantizedChannels[PARTICLE_CACHE_QUANTIZED_CHANNELS] = { 0, 1, 2, 4, 5, 6, 7, 10, 12, 13, 14, 15 };
+static const int gRawChannels[PARTICLE_CACHE_RAW_CHANNELS] = { 3, 8, 9, 11 };
+
+static const int gFloatsPerParticle = (int) (sizeof(Particle) / sizeof(float));
+
+// channel ranges (min and step) and packed sizes of planes before the planes data
+static const int gFramePrefixSize = 2 * PARTICLE_CACHE_QUANTIZED_CHANNELS * sizeof(float) + PARTICLE_CACHE_PLANES * sizeof(int);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// LZ compression
+
+static inline unsigned int LZHash(const unsigned char *p)
+{
+	unsigned int value;
+	memcpy( &value, p, sizeof(unsigned int) );
+	return (value * 2654435761u) >> (32 - CACHE_LZ_HASH_BITS);
+}
+
+static inline unsigned char *LZWriteLength(unsigned char *op, int length)
+{
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (unsigned char) length;
+	return op;
+}
+
+// token is a literal length in high 4 bits and a match length above the minimum in low 4 bits,
+//  the last sequence has literals only
+static unsigned char *LZWriteSequence(unsigned char *op, const unsigned char *literals, const int numberOfLiterals, const int offset, const int matchLength)
+{
+	const int matchCode = (matchLength > 0) ? matchLength - CACHE_LZ_MIN_MATCH : 0;
+
+	unsigned char *token = op++;
+	*token = (unsigned char) ( (std::min(numberOfLiterals, 15) << 4) | std::min(matchCode, 15) );
+
+	if (numberOfLiterals >= 15)
+		op = LZWriteLength(op, numberOfLiterals - 15);
+
+	if (numberOfLiterals > 0)
+		memcpy( op, literals, numberOfLiterals );
+	op += numberOfLiterals;
+
+	if (matchLength > 0)
+	{
+		*op++ = (unsigned char) (offset & 0xff);
+		*op++ = (unsigned char) (offset >> 8);
+
+		if (matchCode >= 15)
+			op = LZWriteLength(op, matchCode - 15);
+	}
+
+	return op;
+}
+
+int GPUParticles::ParticleCacheCompress(const unsigned char *src, const int srcSize, std::vector<unsigned char> &dst)
+{
+	// all literals is the worst case
+	dst.resize(srcSize + srcSize / 255 + 16);
+
+	unsigned char *op = dst.data();
+
+	std::vector<int> table(1 << CACHE_LZ_HASH_BITS, -1);
+
+	int anchor = 0;
+	int i = 0;
+
+	while (i + CACHE_LZ_MIN_MATCH <= srcSize)
+	{
+		const unsigned int hash = LZHash(src + i);
+		const int candidate = table[hash];
+		table[hash] = i;
+
+		if (candidate >= 0 && i - candidate <= CACHE_LZ_WINDOW && 0 == memcmp(src + candidate, src + i, CACHE_LZ_MIN_MATCH) )
+		{
+			int length = CACHE_LZ_MIN_MATCH;
+			while (i + length < srcSize && src[candidate + length] == src[i + length])
+				length += 1;
+
+			op = LZWriteSequence(op, src + anchor, i - anchor, i - candidate, length);
+
+			// one more entry inside the match for the next search
+			if (i + length - 2 + CACHE_LZ_MIN_MATCH <= srcSize)
+				table[LZHash(src + i + length - 2)] = i + length - 2;
+
+			i += length;
+			anchor = i;
+		}
+		else
+		{
+			i += 1;
+		}
+	}
+
+	op = LZWriteSequence(op, src + anchor, srcSize - anchor, 0, 0);
+
+	const int packedSize = (int) (op - dst.data());
+	dst.resize(packedSize);
+	return packedSize;
+}
+
+static inline bool LZReadLength(const unsigned char *&ip, const unsigned char *ipEnd, int &length)
+{
+	for (;;)
+	{
+		if (ip >= ipEnd)
+			return false;
+
+		const int value = *ip++;
+		length += value;
+
+		if (value < 255)
+			return true;
+	}
+}
+
+bool GPUParticles::ParticleCacheDecompress(const unsigned char *src, const int srcSize, unsigned char *dst, const int dstSize)
+{
+	const unsigned char *ip = src;
+	const unsigned char *ipEnd = src + srcSize;
+
+	unsigned char *op = dst;
+	unsigned char *opEnd = dst + dstSize;
+
+	while (ip < ipEnd)
+	{
+		const int token = *ip++;
+
+		int numberOfLiterals = token >> 4;
+		if (numberOfLiterals == 15 && false == LZReadLength(ip, ipEnd, numberOfLiterals) )
+			return false;
+
+		if (numberOfLiterals > ipEnd - ip || numberOfLiterals > opEnd - op)
+			return false;
+
+		if (numberOfLiterals > 0)
+			memcpy( op, ip, numberOfLiterals );
+		ip += numberOfLiterals;
+		op += numberOfLiterals;
+
+		// the last sequence
+		if (ip == ipEnd)
+			return op == opEnd;
+
+		if (ipEnd - ip < 2)
+			return false;
+
+		const int offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		int matchLength = token & 15;
+		if (matchLength == 15 && false == LZReadLength(ip, ipEnd, matchLength) )
+			return false;
+		matchLength += CACHE_LZ_MIN_MATCH;
+
+		if (offset == 0 || offset > op - dst || matchLength > opEnd - op)
+			return false;
+
+		// could overlap, byte by byte
+		const unsigned char *match = op - offset;
+		for (int i=0; i<matchLength; ++i)
+			op[i] = match[i];
+		op += matchLength;
+	}
+
+	// the last literals sequence is missing
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// frame
+
+void GPUParticles::ParticleCacheEncodeFrame(const Particle *particles, const int count, std::vector<unsigned char> &planes,
+	std::vector<unsigned char> &packed, const int numberOfThreads)
+{
+	const float *data = (const float*) particles;
+
+	float ranges[2 * PARTICLE_CACHE_QUANTIZED_CHANNELS];
+	planes.resize(PARTICLE_CACHE_PLANES * count);
+
+	// 1 - channels into delta coded byte planes
+
+	ParallelFor( PARTICLE_CACHE_QUANTIZED_CHANNELS + PARTICLE_CACHE_RAW_CHANNELS, 1, [&] (const int first, const int last) {
+
+		for (int channel=first; channel<last; ++channel)
+		{
+			if (channel < PARTICLE_CACHE_QUANTIZED_CHANNELS)
+			{
+				const int index = gQuantizedChannels[channel];
+
+				float minValue = FLT_MAX;
+				float maxValue = -FLT_MAX;
+
+				for (int i=0; i<count; ++i)
+				{
+					const float value = data[i * gFloatsPerParticle + index];
+					if (value >= -FLT_MAX && value <= FLT_MAX)
+					{
+						minValue = std::min(minValue, value);
+						maxValue = std::max(maxValue, value);
+					}
+				}
+
+				if (minValue > maxValue)
+				{
+					minValue = 0.0f;
+					maxValue = 0.0f;
+				}
+
+				const float step = (maxValue - minValue) / 65535.0f;
+				const float invStep = (step > 0.0f) ? 1.0f / step : 0.0f;
+
+				ranges[2 * channel] = minValue;
+				ranges[2 * channel + 1] = step;
+
+				unsigned char *lowPlane = planes.data() + (2 * channel) * count;
+				unsigned char *highPlane = planes.data() + (2 * channel + 1) * count;
+				unsigned int prev = 0;
+
+				for (int i=0; i<count; ++i)
+				{
+					const float value = data[i * gFloatsPerParticle + index];
+
+					unsigned int q = 0;
+					if (value >= -FLT_MAX && value <= FLT_MAX)
+						q = (unsigned int) std::min(65535.0f, std::max(0.0f, (value - minValue) * invStep + 0.5f) );
+
+					const unsigned int delta = (q - prev) & 0xffff;
+					prev = q;
+
+					lowPlane[i] = (unsigned char) (delta & 0xff);
+					highPlane[i] = (unsigned char) (delta >> 8);
+				}
+			}
+			else
+			{
+				const int raw = channel - PARTICLE_CACHE_QUANTIZED_CHANNELS;
+				const int index = gRawChannels[raw];
+
+				unsigned char *plane = planes.data() + (2 * PARTICLE_CACHE_QUANTIZED_CHANNELS + 4 * raw) * count;
+				unsigned int prev = 0;
+
+				for (int i=0; i<count; ++i)
+				{
+					unsigned int bits;
+					memcpy( &bits, &data[i * gFloatsPerParticle + index], sizeof(unsigned int) );
+
+					const unsigned int delta = bits - prev;
+					prev = bits;
+
+					plane[i] = (unsigned char) (delta & 0xff);
+					plane[count + i] = (unsigned char) ((delta >> 8) & 0xff);
+					plane[2 * count + i] = (unsigned char) ((delta >> 16) & 0xff);
+					plane[3 * count + i] = (unsigned char) (delta >> 24);
+				}
+			}
+		}
+	}, numberOfThreads );
+
+	// 2 - every plane on its own
+
+	std::vector<unsigned char> blocks[PARTICLE_CACHE_PLANES];
+	int sizes[PARTICLE_CACHE_PLANES];
+
+	ParallelFor( PARTICLE_CACHE_PLANES, 1, [&] (const int first, const int last) {
+
+		for (int i=first; i<last; ++i)
+			sizes[i] = ParticleCacheCompress( planes.data() + i * count, count, blocks[i] );
+	}, numberOfThreads );
+
+	size_t packedSize = gFramePrefixSize;
+	for (int i=0; i<PARTICLE_CACHE_PLANES; ++i)
+		packedSize += sizes[i];
+
+	packed.resize(packedSize);
+
+	unsigned char *dst = packed.data();
+	memcpy( dst, ranges, sizeof(ranges) );
+	memcpy( dst + sizeof(ranges), sizes, sizeof(sizes) );
+	dst += gFramePrefixSize;
+
+	for (int i=0; i<PARTICLE_CACHE_PLANES; ++i)
+	{
+		memcpy( dst, blocks[i].data(), sizes[i] );	// at least a token
+		dst += sizes[i];
+	}
+}
+
+bool GPUParticles::ParticleCacheDecodeFrame(const unsigned char *packed, const int packedSize, const int count, std::vector<unsigned char> &planes,
+	std::vector<Particle> &particles, const int numberOfThreads)
+{
+	if (count < 0 || packedSize < gFramePrefixSize)
+		return false;
+
+	float ranges[2 * PARTICLE_CACHE_QUANTIZED_CHANNELS];
+	int sizes[PARTICLE_CACHE_PLANES];
+	int offsets[PARTICLE_CACHE_PLANES];
+
+	memcpy( ranges, packed, sizeof(ranges) );
+	memcpy( sizes, packed + sizeof(ranges), sizeof(sizes) );
+
+	long long offset = gFramePrefixSize;
+	for (int i=0; i<PARTICLE_CACHE_PLANES; ++i)
+	{
+		if (sizes[i] <= 0 || offset + sizes[i] > packedSize)
+			return false;
+
+		offsets[i] = (int) offset;
+		offset += sizes[i];
+	}
+
+	// 1 - planes
+
+	planes.resize(PARTICLE_CACHE_PLANES * count);
+	std::atomic<bool> planesAreValid(true);
+
+	ParallelFor( PARTICLE_CACHE_PLANES, 1, [&] (const int first, const int last) {
+
+		for (int i=first; i<last; ++i)
+		{
+			if (false == ParticleCacheDecompress( packed + offsets[i], sizes[i], planes.data() + i * count, count ) )
+				planesAreValid = false;
+		}
+	}, numberOfThreads );
+
+	if (false == planesAreValid)
+		return false;
+
+	// 2 - channels, rotation velocity is zero
+
+	particles.resize(count);
+	if (count > 0)
+		memset( particles.data(), 0, sizeof(Particle) * count );
+
+	float *data = (float*) particles.data();
+
+	ParallelFor( PARTICLE_CACHE_QUANTIZED_CHANNELS + PARTICLE_CACHE_RAW_CHANNELS, 1, [&] (const int first, const int last) {
+
+		for (int channel=first; channel<last; ++channel)
+		{
+			if (channel < PARTICLE_CACHE_QUANTIZED_CHANNELS)
+			{
+				const int index = gQuantizedChannels[channel];
+				const float minValue = ranges[2 * channel];
+				const float step = ranges[2 * channel + 1];
+
+				const unsigned char *lowPlane = planes.data() + (2 * channel) * count;
+				const unsigned char *highPlane = planes.data() + (2 * channel + 1) * count;
+				unsigned int q = 0;
+
+				for (int i=0; i<count; ++i)
+				{
+					q = (q + (lowPlane[i] | (highPlane[i] << 8)) ) & 0xffff;
+					data[i * gFloatsPerParticle + index] = minValue + step * (float) q;
+				}
+			}
+			else
+			{
+				const int raw = channel - PARTICLE_CACHE_QUANTIZED_CHANNELS;
+				const int index = gRawChannels[raw];
+
+				const unsigned char *plane = planes.data() + (2 * PARTICLE_CACHE_QUANTIZED_CHANNELS + 4 * raw) * count;
+				unsigned int bits = 0;
+
+				for (int i=0; i<count; ++i)
+				{
+					bits += (unsigned int) plane[i] | ((unsigned int) plane[count + i] << 8)
+						| ((unsigned int) plane[2 * count + i] << 16) | ((unsigned int) plane[3 * count + i] << 24);
+
+					memcpy( &data[i * gFloatsPerParticle + index], &bits, sizeof(unsigned int) );
+				}
+			}
+		}
+	}, numberOfThreads );
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ParticleCacheWriter
+
+ParticleCacheWriter::ParticleCacheWriter()
+{
+	mFile = nullptr;
+	mOffset = 0;
+	memset( &mHeader, 0, sizeof(ParticleCacheHeader) );
+}
+
+ParticleCacheWriter::~ParticleCacheWriter()
+{
+	Close();
+}
+
+bool ParticleCacheWriter::Open(const char *filename, const double fps, const int maxParticles)
+{
+	Close();
+
+	fopen_s(&mFile, filename, "wb");
+	if (nullptr == mFile)
+	{
+		printf( "[GPU Particles] failed to create a particle cache %s\n", filename );
+		return false;
+	}
+
+	memset( &mHeader, 0, sizeof(ParticleCacheHeader) );
+	memcpy( mHeader.tag, PARTICLE_CACHE_TAG, 4 );
+	mHeader.version = PARTICLE_CACHE_VERSION;
+	mHeader.fps = fps;
+	mHeader.maxParticles = maxParticles;
+
+	// the header is written again on close with the index offset
+	fwrite( &mHeader, sizeof(ParticleCacheHeader), 1, mFile );
+	mOffset = sizeof(ParticleCacheHeader);
+
+	mIndex.clear();
+	return true;
+}
+
+bool ParticleCacheWriter::WriteFrame(const int frame, const Particle *particles, const int count)
+{
+	if (nullptr == mFile)
+		return false;
+
+	ParticleCacheEncodeFrame(particles, count, mPlanes, mPacked);
+
+	ParticleCacheChunk chunk;
+	memset( &chunk, 0, sizeof(ParticleCacheChunk) );
+	chunk.tag = PARTICLE_CACHE_CHUNK_TAG;
+	chunk.frame = frame;
+	chunk.count = count;
+	chunk.packedSize = (int) mPacked.size();
+
+	if (1 != fwrite( &chunk, sizeof(ParticleCacheChunk), 1, mFile )
+		|| mPacked.size() != fwrite( mPacked.data(), sizeof(unsigned char), mPacked.size(), mFile ) )
+	{
+		printf( "[GPU Particles] failed to write a particle cache frame %d\n", frame );
+		return false;
+	}
+
+	ParticleCacheIndexEntry entry;
+	memset( &entry, 0, sizeof(ParticleCacheIndexEntry) );
+	entry.frame = frame;
+	entry.count = count;
+	entry.offset = mOffset + sizeof(ParticleCacheChunk);
+	entry.packedSize = chunk.packedSize;
+
+	mIndex[frame] = entry;
+	mOffset += sizeof(ParticleCacheChunk) + mPacked.size();
+
+	return true;
+}
+
+bool ParticleCacheWriter::Close()
+{
+	if (nullptr == mFile)
+		return false;
+
+	bool result = true;
+
+	mHeader.numberOfFrames = (int) mIndex.size();
+	mHeader.indexOffset = mOffset;
+
+	if (mIndex.size() > 0)
+	{
+		mHeader.firstFrame = begin(mIndex)->first;
+		mHeader.lastFrame = mIndex.rbegin()->first;
+	}
+
+	for (auto iter=begin(mIndex); iter!=end(mIndex); ++iter)
+	{
+		if (1 != fwrite( &iter->second, sizeof(ParticleCacheIndexEntry), 1, mFile ) )
+			result = false;
+	}
+
+	if (0 != fseek(mFile, 0, SEEK_SET) || 1 != fwrite( &mHeader, sizeof(ParticleCacheHeader), 1, mFile ) )
+		result = false;
+
+	if (0 != fclose(mFile) )
+		result = false;
+
+	if (false == result)
+		printf( "[GPU Particles] failed to write a particle cache index\n" );
+
+	mFile = nullptr;
+	mIndex.clear();
+
+	mPlanes.clear();
+	mPacked.clear();
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ParticleCacheReader
+
+ParticleCacheReader::ParticleCacheReader()
+{
+	memset( &mHeader, 0, sizeof(ParticleCacheHeader) );
+
+	mStop = false;
+	mFramesInMemory = 8;
+	mCurrentFrame = 0;
+	mLoadingFrame = CACHE_NO_FRAME;
+}
+
+ParticleCacheReader::~ParticleCacheReader()
+{
+	Close();
+}
+
+bool ParticleCacheReader::Open(const char *filename)
+{
+	Close();
+
+	if (false == mFile.Open(filename) )
+	{
+		printf( "[GPU Particles] failed to open a particle cache %s\n", filename );
+		return false;
+	}
+
+	if (mFile.GetSize() < sizeof(ParticleCacheHeader) )
+	{
+		printf( "[GPU Particles] particle cache %s is too small\n", filename );
+		mFile.Close();
+		return false;
+	}
+
+	memcpy( &mHeader, mFile.GetData(), sizeof(ParticleCacheHeader) );
+
+	if (0 != memcmp(mHeader.tag, PARTICLE_CACHE_TAG, 4) || mHeader.version != PARTICLE_CACHE_VERSION)
+	{
+		printf( "[GPU Particles] %s is not a particle cache or has an unsupported version\n", filename );
+		mFile.Close();
+		return false;
+	}
+
+	if (false == ReadIndex() )
+	{
+		if (false == ScanChunks() )
+		{
+			printf( "[GPU Particles] particle cache %s has no frames\n", filename );
+			mFile.Close();
+			return false;
+		}
+		printf( "[GPU Particles] particle cache %s has no index, %d frames are restored\n", filename, (int) mIndex.size() );
+	}
+
+	StartWorker();
+	return true;
+}
+
+void ParticleCacheReader::Close()
+{
+	StopWorker();
+
+	mFrames.clear();
+	mBrokenFrames.clear();
+	mQueue.clear();
+	mIndex.clear();
+
+	mFile.Close();
+	memset( &mHeader, 0, sizeof(ParticleCacheHeader) );
+}
+
+bool ParticleCacheReader::ReadIndex()
+{
+	const long long fileSize = (long long) mFile.GetSize();
+	const long long indexOffset = mHeader.indexOffset;
+	const long long numberOfFrames = mHeader.numberOfFrames;
+
+	if (indexOffset < (long long) sizeof(ParticleCacheHeader) || numberOfFrames <= 0
+		|| indexOffset + numberOfFrames * (long long) sizeof(ParticleCacheIndexEntry) > fileSize)
+	{
+		return false;
+	}
+
+	const char *data = mFile.GetData() + indexOffset;
+
+	for (int i=0; i<(int) numberOfFrames; ++i)
+	{
+		ParticleCacheIndexEntry entry;
+		memcpy( &entry, data + i * sizeof(ParticleCacheIndexEntry), sizeof(ParticleCacheIndexEntry) );
+
+		if (entry.count < 0 || entry.packedSize <= 0 || entry.offset < (long long) sizeof(ParticleCacheHeader)
+			|| entry.offset + entry.packedSize > indexOffset)
+		{
+			mIndex.clear();
+			return false;
+		}
+
+		mIndex[entry.frame] = entry;
+	}
+
+	return true;
+}
+
+bool ParticleCacheReader::ScanChunks()
+{
+	const long long fileSize = (long long) mFile.GetSize();
+	long long offset = sizeof(ParticleCacheHeader);
+
+	while (offset + (long long) sizeof(ParticleCacheChunk) <= fileSize)
+	{
+		ParticleCacheChunk chunk;
+		memcpy( &chunk, mFile.GetData() + offset, sizeof(ParticleCacheChunk) );
+
+		// end of the written data
+		if (chunk.tag != PARTICLE_CACHE_CHUNK_TAG || chunk.count < 0 || chunk.packedSize <= 0
+			|| offset + (long long) sizeof(ParticleCacheChunk) + chunk.packedSize > fileSize)
+		{
+			break;
+		}
+
+		ParticleCacheIndexEntry entry;
+		memset( &entry, 0, sizeof(ParticleCacheIndexEntry) );
+		entry.frame = chunk.frame;
+		entry.count = chunk.count;
+		entry.offset = offset + sizeof(ParticleCacheChunk);
+		entry.packedSize = chunk.packedSize;
+
+		mIndex[entry.frame] = entry;
+		offset = entry.offset + entry.packedSize;
+	}
+
+	return mIndex.size() > 0;
+}
+
+int ParticleCacheReader::GetFirstFrame() const
+{
+	return (mIndex.size() > 0) ? begin(mIndex)->first : 0;
+}
+
+int ParticleCacheReader::GetLastFrame() const
+{
+	return (mIndex.size() > 0) ? mIndex.rbegin()->first : 0;
+}
+
+void ParticleCacheReader::SetFramesInMemory(const int count)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mFramesInMemory = std::max(2, count);
+	EvictFrames();
+}
+
+size_t ParticleCacheReader::GetMemoryUsed()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	size_t memory = 0;
+	for (auto iter=begin(mFrames); iter!=end(mFrames); ++iter)
+		memory += iter->second.capacity() * sizeof(Particle);
+
+	return memory;
+}
+
+bool ParticleCacheReader::GetFrame(const int frame, std::vector<Particle> &particles)
+{
+	if (false == HasFrame(frame) )
+		return false;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mCurrentFrame = frame;
+
+	for (;;)
+	{
+		auto iter = mFrames.find(frame);
+		if (iter != end(mFrames) )
+		{
+			particles.assign( begin(iter->second), end(iter->second) );
+			return true;
+		}
+
+		if (mStop || mBrokenFrames.find(frame) != end(mBrokenFrames) )
+			return false;
+
+		// the frame goes first in the queue
+		if (mLoadingFrame != frame && (mQueue.empty() || mQueue.front() != frame) )
+		{
+			mQueue.remove(frame);
+			mQueue.push_front(frame);
+			mWakeCondition.notify_one();
+		}
+
+		mDoneCondition.wait(lock);
+	}
+}
+
+void ParticleCacheReader::Prefetch(const int frame, const bool forward)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mCurrentFrame = frame;
+	mQueue.clear();
+
+	const int dir = (forward) ? 1 : -1;
+
+	for (int i=1; i<mFramesInMemory; ++i)
+	{
+		const int next = frame + dir * i;
+
+		if (HasFrame(next) && mFrames.find(next) == end(mFrames) && mBrokenFrames.find(next) == end(mBrokenFrames) )
+			mQueue.push_back(next);
+	}
+
+	if (mQueue.size() > 0)
+		mWakeCondition.notify_one();
+}
+
+void ParticleCacheReader::StartWorker()
+{
+	mStop = false;
+	mThread = std::thread( &ParticleCacheReader::WorkerLoop, this );
+}
+
+void ParticleCacheReader::StopWorker()
+{
+	if (false == mThread.joinable() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+
+	mWakeCondition.notify_all();
+	mThread.join();
+
+	// wake up waiting GetFrame calls
+	mDoneCondition.notify_all();
+}
+
+void ParticleCacheReader::WorkerLoop()
+{
+	std::vector<unsigned char> planes;
+	FrameData data;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	while (false == mStop)
+	{
+		if (mQueue.empty() )
+		{
+			mWakeCondition.wait(lock);
+			continue;
+		}
+
+		const int frame = mQueue.front();
+		mQueue.pop_front();
+
+		if (mFrames.find(frame) != end(mFrames) || mBrokenFrames.find(frame) != end(mBrokenFrames) )
+			continue;
+
+		// index is not changed while the worker is running
+		auto iter = mIndex.find(frame);
+		if (iter == end(mIndex) )
+			continue;
+
+		mLoadingFrame = frame;
+		lock.unlock();
+
+		const bool result = DecodeEntry(iter->second, planes, data);
+
+		lock.lock();
+		mLoadingFrame = CACHE_NO_FRAME;
+
+		if (result)
+		{
+			mFrames[frame].swap(data);
+			EvictFrames();
+		}
+		else
+		{
+			printf( "[GPU Particles] particle cache frame %d is broken\n", frame );
+			mBrokenFrames.insert(frame);
+		}
+
+		mDoneCondition.notify_all();
+	}
+}
+
+bool ParticleCacheReader::DecodeEntry(const ParticleCacheIndexEntry &entry, std::vector<unsigned char> &planes, FrameData &data) const
+{
+	const unsigned char *packed = (const unsigned char*) mFile.GetData() + entry.offset;
+	return ParticleCacheDecodeFrame(packed, entry.packedSize, entry.count, planes, data);
+}
+
+void ParticleCacheReader::EvictFrames()
+{
+	while ((int) mFrames.size() > mFramesInMemory)
+	{
+		auto farthest = begin(mFrames);
+
+		for (auto iter=begin(mFrames); iter!=end(mFrames); ++iter)
+		{
+			if (abs(iter->first - mCurrentFrame) > abs(farthest->first - mCurrentFrame) )
+				farthest = iter;
+		}
+
+		mFrames.erase(farthest);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+
+// fountain with gravity, dead particles and a launcher, like a simulation output
+static void StepBenchmarkParticles(std::vector<Particle> &particles, const int frame, const float dt)
+{
+	const int count = (int) particles.size();
+
+	if (frame == 0)
+	{
+		unsigned int seed = 5;
+		auto fnRandom = [&seed] () {
+			seed = seed * 1664525u + 1013904223u;
+			return (float) (seed >> 8) / (float) (1u << 24);
+		};
+
+		memset( particles.data(), 0, sizeof(Particle) * count );
+
+		for (int i=0; i<count; ++i)
+		{
+			Particle &particle = particles[i];
+
+			particle.Pos.w = 0.02f + 0.03f * fnRandom();
+
+			particle.Vel.x = 2.0f * fnRandom() - 1.0f;
+			particle.Vel.y = 4.0f + 4.0f * fnRandom();
+			particle.Vel.z = 2.0f * fnRandom() - 1.0f;
+			particle.Vel.w = fnRandom();
+
+			// packed color of the emitter
+			const unsigned int color = 0xff3080c0u + (i % 7);
+			memcpy( &particle.Color.x, &color, sizeof(unsigned int) );
+
+			particle.Color.y = 1.0f + 2.0f * fnRandom();
+			particle.Color.z = -1.5f * fnRandom();		// not born yet
+			particle.Color.w = (float) i;
+
+			particle.Rot.w = 1.0f;
+			particle.RotVel.x = 3.0f * fnRandom();
+			particle.RotVel.y = 3.0f * fnRandom();
+		}
+
+		// launcher
+		particles[0].Pos.w = -1.0f;
+		particles[0].Color.y = -1.0f;
+		return;
+	}
+
+	for (int i=0; i<count; ++i)
+	{
+		Particle &particle = particles[i];
+
+		particle.Color.z += dt;
+
+		if (particle.Pos.w < 0.0f || particle.Color.y <= 0.0f || particle.Color.z <= 0.0f)
+			continue;
+
+		if (particle.Color.z >= particle.Color.y)
+		{
+			particle.Color.y = 0.0f;
+			continue;
+		}
+
+		particle.Vel.y -= 9.8f * dt;
+
+		particle.Pos.x += particle.Vel.x * dt;
+		particle.Pos.y = std::max(0.0f, particle.Pos.y + particle.Vel.y * dt);
+		particle.Pos.z += particle.Vel.z * dt;
+
+		// quaternion from the rotation angles
+		const float ax = 0.5f * particle.RotVel.x * particle.Color.z;
+		const float ay = 0.5f * particle.RotVel.y * particle.Color.z;
+
+		particle.Rot.x = sinf(ax) * cosf(ay);
+		particle.Rot.y = cosf(ax) * sinf(ay);
+		particle.Rot.z = sinf(ax) * sinf(ay);
+		particle.Rot.w = cosf(ax) * cosf(ay);
+	}
+}
+
+// returns false when a raw channel differs or a quantized one is out of the half step
+static bool CompareBenchmarkParticles(const std::vector<Particle> &source, const std::vector<Particle> &decoded, double &maxPosError, double &maxRotError)
+{
+	if (source.size() != decoded.size() )
+		return false;
+
+	const int count = (int) source.size();
+	const float *a = (const float*) source.data();
+	const float *b = (const float*) decoded.data();
+
+	for (int channel=0; channel<PARTICLE_CACHE_RAW_CHANNELS; ++channel)
+	{
+		const int index = gRawChannels[channel];
+		for (int i=0; i<count; ++i)
+		{
+			if (0 != memcmp(&a[i * gFloatsPerParticle + index], &b[i * gFloatsPerParticle + index], sizeof(float) ) )
+				return false;
+		}
+	}
+
+	for (int channel=0; channel<PARTICLE_CACHE_QUANTIZED_CHANNELS; ++channel)
+	{
+		const int index = gQuantizedChannels[channel];
+
+		float minValue = FLT_MAX;
+		float maxValue = -FLT_MAX;
+
+		for (int i=0; i<count; ++i)
+		{
+			minValue = std::min(minValue, a[i * gFloatsPerParticle + index]);
+			maxValue = std::max(maxValue, a[i * gFloatsPerParticle + index]);
+		}
+
+		const double halfStep = 0.5 * ((double) maxValue - (double) minValue) / 65535.0;
+		const double tolerance = 1.01 * halfStep + 1.0e-6 * std::max(fabs(minValue), fabs(maxValue) );
+
+		for (int i=0; i<count; ++i)
+		{
+			const double error = fabs( (double) a[i * gFloatsPerParticle + index] - (double) b[i * gFloatsPerParticle + index] );
+			if (error > tolerance)
+				return false;
+
+			if (index < 3)
+				maxPosError = std::max(maxPosError, error);
+			else if (index >= 12)
+				maxRotError = std::max(maxRotError, error);
+		}
+	}
+
+	return true;
+}
+
+bool GPUParticles::ParticleCacheBenchmark(const char *folder, const int numberOfParticles, const int numberOfFrames)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	bool result = true;
+
+	char filename[512];
+	char brokenFilename[512];
+	sprintf_s( filename, sizeof(filename), "%s\\particle_cache_benchmark.pcache", folder );
+	sprintf_s( brokenFilename, sizeof(brokenFilename), "%s\\particle_cache_benchmark_noindex.pcache", folder );
+
+	const float dt = 1.0f / 30.0f;
+	std::vector<Particle> particles(numberOfParticles);
+	std::vector<Particle> decoded;
+
+	// 1 - LZ round trip on the edge cases
+
+	{
+		std::vector<unsigned char> source(70000);
+		std::vector<unsigned char> packed;
+		std::vector<unsigned char> unpacked;
+
+		for (int test=0; test<3; ++test)
+		{
+			for (size_t i=0; i<source.size(); ++i)
+				source[i] = (test == 0) ? 0 : (test == 1) ? (unsigned char) ((i * 7919) >> 3) : (unsigned char) (i % 251);
+
+			for (int size=0; size<=(int) source.size(); size = (size < 32) ? size + 1 : size * 3)
+			{
+				const int packedSize = ParticleCacheCompress(source.data(), size, packed);
+				unpacked.assign(size, 1);
+
+				if (false == ParticleCacheDecompress(packed.data(), packedSize, unpacked.data(), size)
+					|| (size > 0 && 0 != memcmp(unpacked.data(), source.data(), size) ) )
+				{
+					printf( "[GPU Particles] particle cache - LZ round trip failed, pattern %d, %d bytes\n", test, size );
+					result = false;
+				}
+
+				// a cut data must not be accepted
+				if (packedSize > 1 && ParticleCacheDecompress(packed.data(), packedSize - 1, unpacked.data(), size) )
+				{
+					printf( "[GPU Particles] particle cache - LZ accepts a cut data, pattern %d, %d bytes\n", test, size );
+					result = false;
+				}
+			}
+		}
+	}
+
+	// 2 - bake
+
+	ParticleCacheWriter writer;
+	// non integer frame rate is kept in the file as it is
+	const double fps = 30000.0 / 1001.0;
+
+	if (false == writer.Open(filename, fps, numberOfParticles) )
+		return false;
+
+	double encodeMs = 0.0;
+	double maxPosError = 0.0;
+	double maxRotError = 0.0;
+
+	std::vector<unsigned char> planes;
+	std::vector<unsigned char> packed;
+
+	for (int frame=0; frame<numberOfFrames; ++frame)
+	{
+		StepBenchmarkParticles(particles, frame, dt);
+
+		auto startTime = clock::now();
+		writer.WriteFrame(frame, particles.data(), numberOfParticles);
+		encodeMs += std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		// quantization error of the frame
+		ParticleCacheEncodeFrame(particles.data(), numberOfParticles, planes, packed);
+
+		if (false == ParticleCacheDecodeFrame(packed.data(), (int) packed.size(), numberOfParticles, planes, decoded)
+			|| false == CompareBenchmarkParticles(particles, decoded, maxPosError, maxRotError) )
+		{
+			printf( "[GPU Particles] particle cache - frame %d differs after the round trip\n", frame );
+			result = false;
+		}
+	}
+
+	const long long fileSize = writer.GetBytesWritten();
+	writer.Close();
+
+	// 3 - sequential playback with a prefetch and a random scrubbing
+
+	ParticleCacheReader reader;
+	double playMs = 0.0;
+	double scrubMs = 0.0;
+
+	if (false == reader.Open(filename) || reader.GetNumberOfFrames() != numberOfFrames)
+	{
+		printf( "[GPU Particles] particle cache - failed to read frames back\n" );
+		result = false;
+	}
+	else if (reader.GetFPS() != fps)
+	{
+		printf( "[GPU Particles] particle cache - frame rate %f is read back as %f\n", fps, reader.GetFPS() );
+		result = false;
+	}
+	else
+	{
+		reader.SetFramesInMemory(8);
+
+		auto startTime = clock::now();
+		for (int frame=0; frame<numberOfFrames; ++frame)
+		{
+			if (false == reader.GetFrame(frame, decoded) || (int) decoded.size() != numberOfParticles)
+				result = false;
+			reader.Prefetch(frame, true);
+		}
+		playMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		unsigned int seed = 3;
+		startTime = clock::now();
+		for (int i=0; i<numberOfFrames; ++i)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			const int frame = (int) ((seed >> 8) % (unsigned int) numberOfFrames);
+
+			if (false == reader.GetFrame(frame, decoded) )
+				result = false;
+		}
+		scrubMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		// the last bake frame against the last simulation state
+		if (false == reader.GetFrame(numberOfFrames-1, decoded)
+			|| false == CompareBenchmarkParticles(particles, decoded, maxPosError, maxRotError) )
+		{
+			printf( "[GPU Particles] particle cache - the last frame differs after the playback\n" );
+			result = false;
+		}
+	}
+
+	// 4 - interrupted bake, the file without an index and the last frame is cut
+
+	if (reader.IsOpen() && reader.GetNumberOfFrames() > 1)
+	{
+		std::vector<char> data(fileSize);
+		FILE *fp = nullptr;
+
+		fopen_s(&fp, filename, "rb");
+		if (fp)
+		{
+			if (fileSize != (long long) fread(data.data(), sizeof(char), data.size(), fp) )
+				data.clear();
+			fclose(fp);
+		}
+
+		reader.Close();
+
+		fp = nullptr;
+		fopen_s(&fp, brokenFilename, "wb");
+		if (fp && data.size() > sizeof(ParticleCacheHeader) )
+		{
+			ParticleCacheHeader header;
+			memcpy( &header, data.data(), sizeof(ParticleCacheHeader) );
+			const long long cutSize = header.indexOffset - 10;
+
+			header.indexOffset = 0;
+			memcpy( data.data(), &header, sizeof(ParticleCacheHeader) );
+
+			fwrite( data.data(), sizeof(char), (size_t) cutSize, fp );
+		}
+		if (fp)
+			fclose(fp);
+
+		if (false == reader.Open(brokenFilename) || reader.GetNumberOfFrames() != numberOfFrames - 1
+			|| false == reader.GetFrame(numberOfFrames-2, decoded) )
+		{
+			printf( "[GPU Particles] particle cache - frames of an interrupted bake are not restored\n" );
+			result = false;
+		}
+
+		reader.Close();
+		remove(brokenFilename);
+	}
+
+	reader.Close();
+	remove(filename);
+
+	const double rawMB = (double) sizeof(Particle) * numberOfParticles / (1024.0 * 1024.0);
+	const double packedMB = (double) fileSize / numberOfFrames / (1024.0 * 1024.0);
+
+	printf( "[GPU Particles] particle cache benchmark, %d particles, %d frames, %d threads\n", numberOfParticles, numberOfFrames, ParallelForThreadCount() );
+	printf( "[GPU Particles] frame %.2f MB raw, %.2f MB packed, ratio %.1f\n", rawMB, packedMB, rawMB / std::max(packedMB, 1.0e-9) );
+	printf( "[GPU Particles] bake %.2f ms, playback %.2f ms, scrubbing %.2f ms per frame\n",
+		encodeMs / numberOfFrames, playMs / numberOfFrames, scrubMs / numberOfFrames );
+	printf( "[GPU Particles] max position error %g, max rotation error %g\n", maxPosError, maxRotError );
+	printf( "[GPU Particles] particle cache benchmark %s\n", (result) ? "passed" : "FAILED" );
+
+	return result;
+}
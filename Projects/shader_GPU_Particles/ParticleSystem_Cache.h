@@ -0,0 +1,223 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_Cache.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_types.h"
+#include "IO\MappedFile.h"
+
+#include <stdio.h>
+#include <vector>
+#include <map>
+#include <set>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+	Particle simulation cache
+
+	file is a header, a chunk per frame and a frame index at the end (offset is patched into the header
+	 on close). A file without an index (bake was interrupted) is restored by a scan of chunks.
+
+	Frame chunk is a particle count, channel ranges and compressed byte planes of channels:
+	 - position xyz, velocity xyzw, age and rotation are quantized into 16 bits in a per frame range
+	 - size, packed color, lifetime and index are stored as they are, signs and zeros there are flags
+		for launchers and dead particles
+	 - channels are delta coded along the buffer and split into byte planes, every plane is LZ compressed
+		on its own, so planes are packed and unpacked in parallel
+	 - rotation velocity is not stored, a cached frame is only rendered
+
+	Reader maps the file and decodes frames on a worker thread ahead of the playback direction,
+	 decoded frames are kept up to a limit, the farthest from the current frame are dropped first.
+*/
+
+#define PARTICLE_CACHE_TAG				"PCCH"
+#define PARTICLE_CACHE_CHUNK_TAG		0x4B484350		// PCHK
+#define PARTICLE_CACHE_VERSION			2
+
+#define PARTICLE_CACHE_QUANTIZED_CHANNELS	12
+#define PARTICLE_CACHE_RAW_CHANNELS			4
+#define PARTICLE_CACHE_PLANES				(2 * PARTICLE_CACHE_QUANTIZED_CHANNELS + 4 * PARTICLE_CACHE_RAW_CHANNELS)
+
+namespace GPUParticles
+{
+
+struct ParticleCacheHeader
+{
+	char			tag[4];
+	int				version;
+	double			fps;				// frame rate of the scene, could be 29.97 and so on
+	int				maxParticles;
+	int				numberOfFrames;
+	int				firstFrame;
+	int				lastFrame;
+	long long		indexOffset;		// 0 when the file was not closed
+};
+
+struct ParticleCacheChunk
+{
+	int				tag;
+	int				frame;
+	int				count;				// number of particles
+	int				packedSize;			// bytes after the chunk
+	int				reserved[2];
+};
+
+struct ParticleCacheIndexEntry
+{
+	int				frame;
+	int				count;
+	long long		offset;				// packed data offset in the file
+	int				packedSize;
+	int				reserved;
+};
+
+//! quantize and compress one frame, planes is a temp storage
+void ParticleCacheEncodeFrame(const Particle *particles, const int count, std::vector<unsigned char> &planes,
+	std::vector<unsigned char> &packed, const int numberOfThreads=0);
+//! particles are resized to the count, false for a broken data
+bool ParticleCacheDecodeFrame(const unsigned char *packed, const int packedSize, const int count, std::vector<unsigned char> &planes,
+	std::vector<Particle> &particles, const int numberOfThreads=0);
+
+//! byte LZ compression (literal runs and matches in a 64k window), returns the number of packed bytes
+int ParticleCacheCompress(const unsigned char *src, const int srcSize, std::vector<unsigned char> &dst);
+//! false when the data is broken or does not fill dstSize bytes exactly
+bool ParticleCacheDecompress(const unsigned char *src, const int srcSize, unsigned char *dst, const int dstSize);
+
+//////////////////////////////////////////////////////////////////
+//
+
+class ParticleCacheWriter
+{
+public:
+
+	//! a constructor
+	ParticleCacheWriter();
+	//! a destructor
+	~ParticleCacheWriter();
+
+	bool Open(const char *filename, const double fps, const int maxParticles);
+	//! writes the frame index and closes the file
+	bool Close();
+
+	bool IsOpen() const {
+		return mFile != nullptr;
+	}
+
+	//! a frame written twice is replaced in the index
+	bool WriteFrame(const int frame, const Particle *particles, const int count);
+
+	int GetNumberOfFrames() const {
+		return (int) mIndex.size();
+	}
+	long long GetBytesWritten() const {
+		return mOffset;
+	}
+
+protected:
+
+	FILE								*mFile;
+	ParticleCacheHeader					mHeader;
+	long long							mOffset;
+
+	std::map<int, ParticleCacheIndexEntry>	mIndex;
+
+	std::vector<unsigned char>			mPlanes;
+	std::vector<unsigned char>			mPacked;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class ParticleCacheReader
+{
+public:
+
+	//! a constructor
+	ParticleCacheReader();
+	//! a destructor
+	~ParticleCacheReader();
+
+	bool Open(const char *filename);
+	void Close();
+
+	bool IsOpen() const {
+		return mFile.IsOpen();
+	}
+
+	double GetFPS() const {
+		return mHeader.fps;
+	}
+	int GetNumberOfFrames() const {
+		return (int) mIndex.size();
+	}
+	int GetFirstFrame() const;
+	int GetLastFrame() const;
+
+	bool HasFrame(const int frame) const {
+		return mIndex.find(frame) != end(mIndex);
+	}
+
+	//! number of decoded frames to keep, at least 2
+	void SetFramesInMemory(const int count);
+	//! bytes of decoded frames
+	size_t GetMemoryUsed();
+
+	//! copy of the decoded frame, waits for the worker when the frame is not in memory yet
+	bool GetFrame(const int frame, std::vector<Particle> &particles);
+
+	//! queue frames after (or before for the backward playback) the given one, a previous queue is dropped
+	void Prefetch(const int frame, const bool forward);
+
+protected:
+
+	typedef std::vector<Particle>	FrameData;
+
+	MappedFile								mFile;
+	ParticleCacheHeader						mHeader;
+	std::map<int, ParticleCacheIndexEntry>	mIndex;
+
+	// worker
+
+	std::thread								mThread;
+	std::mutex								mMutex;
+	std::condition_variable					mWakeCondition;
+	std::condition_variable					mDoneCondition;
+
+	bool									mStop;
+	int										mFramesInMemory;
+	int										mCurrentFrame;		// eviction keeps frames around it
+	int										mLoadingFrame;		// frame on the worker, outside of the lock
+
+	std::list<int>							mQueue;
+	std::map<int, FrameData>				mFrames;
+	std::set<int>							mBrokenFrames;
+
+	bool ReadIndex();
+	bool ScanChunks();
+
+	void StartWorker();
+	void StopWorker();
+	void WorkerLoop();
+
+	bool DecodeEntry(const ParticleCacheIndexEntry &entry, std::vector<unsigned char> &planes, FrameData &data) const;
+	// under the lock
+	void EvictFrames();
+};
+
+//! round trip with the quantization error check, compression ratio, write and scrub speed,
+//!  a temp file is written into the folder and removed, prints results into the log
+bool ParticleCacheBenchmark(const char *folder, const int numberOfParticles, const int numberOfFrames);
+
+};
@@ -0,0 +1,429 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_DepthSort.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_DepthSort.h"
+#include "algorithm\ParallelFor.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+using namespace GPUParticles;
+
+#define DEPTH_SORT_BLOCK_SIZE		32768
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// DepthSort
+
+DepthSort::DepthSort()
+	: mCount(0)
+{
+	memset( &mStats, 0, sizeof(DepthSortStats) );
+}
+
+void DepthSort::Sort(const Particle *particles, const int count, const float *viewRow, const bool reuseOrder, const int numberOfThreads)
+{
+	// the previous order is a permutation of [0; prevCount), new particles are added after it
+	const int prevCount = (reuseOrder && count >= mCount) ? mCount : 0;
+
+	memset( &mStats, 0, sizeof(DepthSortStats) );
+	mStats.count = count;
+	mStats.reusedOrder = (prevCount > 0);
+
+	mCount = count;
+	mIndices.resize(count);
+
+	if (count <= 0)
+		return;
+
+	for (int i=0; i<2; ++i)
+	{
+		mKeys[i].resize(count);
+		mValues[i].resize(count);
+	}
+
+	const int numberOfBlocks = (count + DEPTH_SORT_BLOCK_SIZE - 1) / DEPTH_SORT_BLOCK_SIZE;
+	std::vector<int> blockDescents(numberOfBlocks, 0);
+
+	// 1 - keys in the previous order, particles are read in a buffer order and only keys are gathered
+
+	mParticleKeys.resize(count);
+
+	ParallelFor( count, DEPTH_SORT_BLOCK_SIZE, [&] (const int first, const int last) {
+
+		for (int i=first; i<last; ++i)
+			mParticleKeys[i] = DepthSortParticleKey(particles[i], viewRow);
+	}, numberOfThreads );
+
+	ParallelFor( count, DEPTH_SORT_BLOCK_SIZE, [&] (const int first, const int last) {
+
+		unsigned int *keys = mKeys[0].data();
+		unsigned int *values = mValues[0].data();
+
+		for (int i=first; i<last; ++i)
+		{
+			const unsigned int index = (i < prevCount) ? mIndices[i] : (unsigned int) i;
+
+			keys[i] = mParticleKeys[index];
+			values[i] = index;
+		}
+	}, numberOfThreads );
+
+	// a single worker gets the whole range in one call, so blocks are the items of a loop
+
+	ParallelFor( numberOfBlocks, 1, [&] (const int firstBlock, const int lastBlock) {
+
+		const unsigned int *keys = mKeys[0].data();
+
+		for (int block=firstBlock; block<lastBlock; ++block)
+		{
+			const int first = std::max(block * DEPTH_SORT_BLOCK_SIZE, 1);
+			const int last = std::min( (block + 1) * DEPTH_SORT_BLOCK_SIZE, count );
+			int descents = 0;
+
+			for (int i=first; i<last; ++i)
+			{
+				if (keys[i-1] > keys[i])
+					descents += 1;
+			}
+
+			blockDescents[block] = descents;
+		}
+	}, numberOfThreads );
+
+	for (int i=0; i<numberOfBlocks; ++i)
+		mStats.descents += blockDescents[i];
+
+	// 2 - radix passes
+
+	int src = 0;
+
+	if (mStats.descents == 0)
+	{
+		mStats.sorted = true;
+	}
+	else
+	{
+		mHistograms.resize(DEPTH_SORT_BUCKETS * numberOfBlocks);
+
+		for (int pass=0; pass<DEPTH_SORT_PASSES; ++pass)
+		{
+			const int shift = pass * DEPTH_SORT_RADIX_BITS;
+
+			ParallelFor( numberOfBlocks, 1, [&] (const int firstBlock, const int lastBlock) {
+
+				const unsigned int *keys = mKeys[src].data();
+
+				for (int block=firstBlock; block<lastBlock; ++block)
+				{
+					const int first = block * DEPTH_SORT_BLOCK_SIZE;
+					const int last = std::min(first + DEPTH_SORT_BLOCK_SIZE, count);
+
+					unsigned int counts[DEPTH_SORT_BUCKETS];
+					memset( counts, 0, sizeof(unsigned int) * DEPTH_SORT_BUCKETS );
+
+					for (int i=first; i<last; ++i)
+						counts[(keys[i] >> shift) & (DEPTH_SORT_BUCKETS-1)] += 1;
+
+					for (int bucket=0; bucket<DEPTH_SORT_BUCKETS; ++bucket)
+						mHistograms[bucket * numberOfBlocks + block] = counts[bucket];
+				}
+			}, numberOfThreads );
+
+			// the same digit for all keys, the order is not changed by this pass
+
+			bool uniform = false;
+
+			for (int bucket=0; bucket<DEPTH_SORT_BUCKETS && false == uniform; ++bucket)
+			{
+				unsigned int total = 0;
+				for (int block=0; block<numberOfBlocks; ++block)
+					total += mHistograms[bucket * numberOfBlocks + block];
+
+				uniform = (total == (unsigned int) count);
+			}
+
+			if (uniform)
+			{
+				mStats.skippedPasses += 1;
+				continue;
+			}
+
+			// exclusive scan, all blocks of a bucket go before the next bucket
+
+			unsigned int sum = 0;
+			for (auto iter=begin(mHistograms); iter!=end(mHistograms); ++iter)
+			{
+				const unsigned int value = *iter;
+				*iter = sum;
+				sum += value;
+			}
+
+			ParallelFor( numberOfBlocks, 1, [&] (const int firstBlock, const int lastBlock) {
+
+				const unsigned int *keys = mKeys[src].data();
+				const unsigned int *values = mValues[src].data();
+				unsigned int *dstKeys = mKeys[1-src].data();
+				unsigned int *dstValues = mValues[1-src].data();
+
+				for (int block=firstBlock; block<lastBlock; ++block)
+				{
+					const int first = block * DEPTH_SORT_BLOCK_SIZE;
+					const int last = std::min(first + DEPTH_SORT_BLOCK_SIZE, count);
+
+					unsigned int offsets[DEPTH_SORT_BUCKETS];
+					for (int bucket=0; bucket<DEPTH_SORT_BUCKETS; ++bucket)
+						offsets[bucket] = mHistograms[bucket * numberOfBlocks + block];
+
+					for (int i=first; i<last; ++i)
+					{
+						const unsigned int slot = offsets[(keys[i] >> shift) & (DEPTH_SORT_BUCKETS-1)]++;
+						dstKeys[slot] = keys[i];
+						dstValues[slot] = values[i];
+					}
+				}
+			}, numberOfThreads );
+
+			src = 1 - src;
+			mStats.passes += 1;
+		}
+	}
+
+	memcpy( mIndices.data(), mValues[src].data(), sizeof(unsigned int) * count );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+
+void GPUParticles::DepthSortReference(const Particle *particles, const int count, const float *viewRow, std::vector<unsigned int> &indices)
+{
+	std::vector<unsigned int> keys(count);
+	indices.resize(count);
+
+	for (int i=0; i<count; ++i)
+	{
+		keys[i] = DepthSortParticleKey(particles[i], viewRow);
+		indices[i] = (unsigned int) i;
+	}
+
+	std::stable_sort( begin(indices), end(indices), [&keys] (const unsigned int a, const unsigned int b) {
+		return keys[a] < keys[b];
+	} );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+
+static void GenerateBenchmarkParticles(std::vector<Particle> &particles, const int count, unsigned int seed)
+{
+	auto fnRandom = [&seed] () {
+		seed = seed * 1664525u + 1013904223u;
+		return (float) (seed >> 8) / (float) (1u << 24);
+	};
+
+	particles.resize(count);
+	memset( particles.data(), 0, sizeof(Particle) * count );
+
+	for (int i=0; i<count; ++i)
+	{
+		Particle &particle = particles[i];
+
+		// a cloud in front of the camera, the most of keys have the same high byte
+		particle.Pos.x = 20.0f * (fnRandom() - 0.5f);
+		particle.Pos.y = 20.0f * fnRandom();
+		particle.Pos.z = 20.0f * (fnRandom() - 0.5f);
+		particle.Pos.w = 0.1f + 0.1f * fnRandom();
+
+		particle.Vel.x = fnRandom() - 0.5f;
+		particle.Vel.y = fnRandom() - 0.5f;
+		particle.Vel.z = fnRandom() - 0.5f;
+
+		// every tenth is not drawn, every hundredth is a launcher
+		if (i % 10 == 9)
+			particle.Pos.w = 0.0f;
+		else if (i % 100 == 42)
+			particle.Pos.w = -particle.Pos.w;
+
+		particle.Color.y = 5.0f;
+		particle.Color.z = fnRandom();
+		particle.Color.w = (float) i;
+	}
+}
+
+static void MoveBenchmarkParticles(std::vector<Particle> &particles, const float dt)
+{
+	for (auto iter=begin(particles); iter!=end(particles); ++iter)
+	{
+		iter->Pos.x += dt * iter->Vel.x;
+		iter->Pos.y += dt * iter->Vel.y;
+		iter->Pos.z += dt * iter->Vel.z;
+	}
+}
+
+// view z row of a camera at the distance looking at the origin, rotated around y
+static void BenchmarkViewRow(const float angle, float *viewRow)
+{
+	const float distance = 40.0f;
+
+	viewRow[0] = -sinf(angle);
+	viewRow[1] = 0.0f;
+	viewRow[2] = -cosf(angle);
+	viewRow[3] = -distance;
+}
+
+// the same keys in the same order, equal keys could go in any order
+static bool CheckOrder(const Particle *particles, const int count, const float *viewRow, const unsigned int *indices,
+	const std::vector<unsigned int> &reference, const bool exact)
+{
+	std::vector<char> used(count, 0);
+
+	for (int i=0; i<count; ++i)
+	{
+		const unsigned int index = indices[i];
+
+		if (index >= (unsigned int) count || used[index] != 0)
+			return false;
+		used[index] = 1;
+
+		if (exact)
+		{
+			if (index != reference[i])
+				return false;
+		}
+		else if (DepthSortParticleKey(particles[index], viewRow) != DepthSortParticleKey(particles[reference[i]], viewRow) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool GPUParticles::DepthSortBenchmark(const int maxNumberOfParticles)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	bool result = true;
+
+	std::vector<Particle>		particles;
+	std::vector<unsigned int>	reference;
+	DepthSort					depthSort;
+
+	float viewRow[4];
+
+	// 1 - the same order as the stable sort, from scratch and from the previous order
+
+	const int testCounts[5] = { 1, 2, 1000, DEPTH_SORT_BLOCK_SIZE + 1, 3 * DEPTH_SORT_BLOCK_SIZE + 17 };
+
+	for (int i=0; i<5; ++i)
+	{
+		const int count = testCounts[i];
+		GenerateBenchmarkParticles(particles, count, 11);
+
+		for (int numberOfThreads=1; numberOfThreads>=0; --numberOfThreads)
+		{
+			BenchmarkViewRow(0.3f, viewRow);
+			DepthSortReference(particles.data(), count, viewRow, reference);
+
+			depthSort.Sort(particles.data(), count, viewRow, false, numberOfThreads);
+			bool passed = CheckOrder(particles.data(), count, viewRow, depthSort.GetIndices(), reference, true);
+
+			// the same frame again is sorted already
+			depthSort.Sort(particles.data(), count, viewRow, true, numberOfThreads);
+			passed = passed && depthSort.GetStats().sorted
+				&& CheckOrder(particles.data(), count, viewRow, depthSort.GetIndices(), reference, true);
+
+			// next frame from the previous order
+			std::vector<Particle> moved(particles);
+			MoveBenchmarkParticles(moved, 0.04f);
+			BenchmarkViewRow(0.31f, viewRow);
+			DepthSortReference(moved.data(), count, viewRow, reference);
+
+			depthSort.Sort(moved.data(), count, viewRow, true, numberOfThreads);
+			passed = passed && CheckOrder(moved.data(), count, viewRow, depthSort.GetIndices(), reference, false);
+
+			if (false == passed)
+			{
+				printf( "[GPU Particles] depth sort - %d particles on %d threads differs from the stable sort\n", count, numberOfThreads );
+				result = false;
+			}
+		}
+	}
+
+	// the count goes down, previous order is dropped
+
+	GenerateBenchmarkParticles(particles, 5000, 5);
+	BenchmarkViewRow(1.0f, viewRow);
+	depthSort.Sort(particles.data(), 5000, viewRow, true);
+	depthSort.Sort(particles.data(), 4000, viewRow, true);
+	DepthSortReference(particles.data(), 4000, viewRow, reference);
+
+	if (depthSort.GetStats().reusedOrder || false == CheckOrder(particles.data(), 4000, viewRow, depthSort.GetIndices(), reference, true) )
+	{
+		printf( "[GPU Particles] depth sort - previous order of a bigger count is used\n" );
+		result = false;
+	}
+
+	// 2 - scaling
+
+	printf( "[GPU Particles] depth sort benchmark, %d threads, time per frame\n", ParallelForThreadCount() );
+	printf( "[GPU Particles] %9s | %12s %12s %12s %12s %12s | %7s %9s\n", "particles", "stable ms", "radix 1 ms", "radix N ms",
+		"reuse N ms", "static N ms", "passes", "descents" );
+
+	for (int count=16384; count<=maxNumberOfParticles; count *= 4)
+	{
+		GenerateBenchmarkParticles(particles, count, 7);
+		BenchmarkViewRow(0.5f, viewRow);
+
+		auto startTime = clock::now();
+		DepthSortReference(particles.data(), count, viewRow, reference);
+		const double stableMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		auto fnRunSort = [&] (const bool reuseOrder, const int numberOfThreads) {
+			auto startTime = clock::now();
+			depthSort.Sort(particles.data(), count, viewRow, reuseOrder, numberOfThreads);
+			return std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+		};
+
+		const double singleMs = fnRunSort(false, 1);
+		const double threadsMs = fnRunSort(false, 0);
+
+		if (false == CheckOrder(particles.data(), count, viewRow, depthSort.GetIndices(), reference, true) )
+			result = false;
+
+		// camera is not moved
+		const double staticMs = fnRunSort(true, 0);
+
+		if (false == depthSort.GetStats().sorted)
+			result = false;
+
+		// particles and camera are moved a bit
+		MoveBenchmarkParticles(particles, 0.04f);
+		BenchmarkViewRow(0.51f, viewRow);
+
+		const double reuseMs = fnRunSort(true, 0);
+		const DepthSortStats stats = depthSort.GetStats();
+
+		DepthSortReference(particles.data(), count, viewRow, reference);
+		if (false == CheckOrder(particles.data(), count, viewRow, depthSort.GetIndices(), reference, false) )
+			result = false;
+
+		printf( "[GPU Particles] %9d | %12.2f %12.2f %12.2f %12.2f %12.2f | %7d %9d\n", count, stableMs, singleMs, threadsMs,
+			reuseMs, staticMs, stats.passes, stats.descents );
+	}
+
+	printf( "[GPU Particles] depth sort benchmark %s\n", (result) ? "passed" : "FAILED" );
+	return result;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_DepthSort.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_types.h"
+#include <vector>
+
+/*
+	Back to front order of particles for the alpha blending
+
+	key is a view space z (camera looks along -z, so the farthest particle has the smallest z) with flipped
+	 float bits, an unsigned compare of keys is the same as a float compare of depths. Particles
+	 without a size (launchers, not drawn) get the largest key and go to the end of the order.
+
+	LSD radix sort of keys with an index of a particle as a value, 4 passes of 8 bits. Every pass is
+	 a histogram of a block, bucket major scan of all histograms and a stable scatter of blocks.
+	 A pass is skipped when all keys have the same digit (close depths share the high bits).
+
+	Temporal reuse - keys are made in the buffer order and gathered in the order of the previous frame,
+	 when that order is still back to front (static camera and particles, paused playback) the sort is
+	 skipped, otherwise passes go from that order and equal keys keep their previous order, so
+	 overlapped particles do not flicker.
+
+	CPU version is a reference for GLSL_CS\Particles_sort.cs, the same keys and the same order of equal
+	 keys. A block is a work group of 256 particles there and a bigger range of a thread here, every pass
+	 is stable, so the result does not depend on a block size.
+*/
+
+#define DEPTH_SORT_RADIX_BITS			8
+#define DEPTH_SORT_BUCKETS				256
+#define DEPTH_SORT_PASSES				4
+#define DEPTH_SORT_GROUP_SIZE			256			// elements in a block of the compute shader
+#define DEPTH_SORT_SCAN_BLOCK			1024		// histogram entries scanned by one work group (256 invocations x 4)
+#define DEPTH_SORT_MAX_PARTICLES		(DEPTH_SORT_GROUP_SIZE * 4096)	// block sums have to fit into one scan work group
+#define DEPTH_SORT_DEAD_KEY				0xffffffff
+
+namespace GPUParticles
+{
+
+//! sortable key of a view space z, smaller key is farther from the camera
+inline unsigned int DepthSortKey(const float viewZ)
+{
+	union {
+		float			f;
+		unsigned int	u;
+	} value;
+
+	value.f = viewZ;
+	const unsigned int mask = (value.u & 0x80000000) ? 0xffffffff : 0x80000000;
+	return value.u ^ mask;
+}
+
+//! third row of a column major model view matrix, view z is a dot with (position, 1)
+inline unsigned int DepthSortParticleKey(const Particle &particle, const float *viewRow)
+{
+	// render shaders skip particles without a size, launchers have a negative one
+	if (particle.Pos.w <= 0.0f)
+		return DEPTH_SORT_DEAD_KEY;
+
+	const float z = viewRow[0] * particle.Pos.x + viewRow[1] * particle.Pos.y + viewRow[2] * particle.Pos.z + viewRow[3];
+	return DepthSortKey(z);
+}
+
+struct DepthSortStats
+{
+	int			count;
+	int			descents;			// neighbours in a wrong order before the sort
+	int			passes;				// radix passes done
+	int			skippedPasses;		// passes with one digit for all keys
+	bool		reusedOrder;		// keys were made in the previous order
+	bool		sorted;				// previous order was still valid, nothing to sort
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class DepthSort
+{
+public:
+
+	//! a constructor
+	DepthSort();
+
+	/*! order particles back to front
+		\param viewRow - 4 floats, see DepthSortParticleKey
+		\param reuseOrder - start from the previous order, it is used when the count did not go down
+	*/
+	void Sort(const Particle *particles, const int count, const float *viewRow, const bool reuseOrder, const int numberOfThreads=0);
+
+	//! particle of every position in the draw order
+	const unsigned int *GetIndices() const {
+		return mIndices.data();
+	}
+	int GetCount() const {
+		return mCount;
+	}
+
+	const DepthSortStats &GetStats() const { return mStats; }
+
+protected:
+
+	int								mCount;
+	DepthSortStats					mStats;
+
+	std::vector<unsigned int>		mIndices;			// result and the previous order
+	std::vector<unsigned int>		mParticleKeys;		// in the buffer order
+	std::vector<unsigned int>		mKeys[2];
+	std::vector<unsigned int>		mValues[2];
+	std::vector<unsigned int>		mHistograms;		// bucket major, bucket * numberOfBlocks + block
+};
+
+//! order of std::stable_sort with the same keys, the same order of equal keys as DepthSort from scratch
+void DepthSortReference(const Particle *particles, const int count, const float *viewRow, std::vector<unsigned int> &indices);
+
+//! radix order against the reference, time of the sort with and without the previous order on one and
+//!  on all threads up to maxNumberOfParticles, prints results into the log
+bool DepthSortBenchmark(const int maxNumberOfParticles);
+
+};
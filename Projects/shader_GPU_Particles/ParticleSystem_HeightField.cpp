@@ -0,0 +1,848 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_HeightField.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_HeightField.h"
+#include "algorithm\ParallelFor.h"
+
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+using namespace GPUParticles;
+
+#define HEIGHT_FIELD_VERTEX_GRAIN		16384
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// helpers, the same math for tiles and for the reference
+
+static void TransformPoint(const float *matrix, const float *point, float *result)
+{
+	for (int i=0; i<3; ++i)
+		result[i] = matrix[i] * point[0] + matrix[4+i] * point[1] + matrix[8+i] * point[2] + matrix[12+i];
+}
+
+static unsigned long long HashWords(unsigned long long hash, const void *data, const size_t count)
+{
+	const unsigned int *words = (const unsigned int*) data;
+
+	for (size_t i=0; i<count; ++i)
+	{
+		hash ^= words[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// range of texel centers inside [minValue; maxValue], false when there are none
+static bool TexelRange(const double minValue, const double maxValue, const int resolution, int &first, int &last)
+{
+	const double firstValue = ceil(minValue - 0.5);
+	const double lastValue = floor(maxValue - 0.5);
+
+	// NaN goes out here as well
+	if ( !(firstValue <= lastValue && lastValue >= 0.0 && firstValue <= (double) (resolution - 1)) )
+		return false;
+
+	first = (int) std::max(firstValue, 0.0);
+	last = (int) std::min(lastValue, (double) (resolution - 1));
+	return true;
+}
+
+// texel space bounds of a triangle
+static bool TriangleTexels(const HeightFieldGrid &grid, const float *a, const float *b, const float *c, int *texels)
+{
+	const double ax = ((double) a[0] - grid.originX) / grid.cellSize;
+	const double bx = ((double) b[0] - grid.originX) / grid.cellSize;
+	const double cx = ((double) c[0] - grid.originX) / grid.cellSize;
+	const double az = ((double) a[2] - grid.originZ) / grid.cellSize;
+	const double bz = ((double) b[2] - grid.originZ) / grid.cellSize;
+	const double cz = ((double) c[2] - grid.originZ) / grid.cellSize;
+
+	return TexelRange( std::min(ax, std::min(bx, cx)), std::max(ax, std::max(bx, cx)), grid.resolution, texels[0], texels[2] )
+		&& TexelRange( std::min(az, std::min(bz, cz)), std::max(az, std::max(bz, cz)), grid.resolution, texels[1], texels[3] );
+}
+
+// one of two directions of an edge owns the texel centers on it, so shared edges are drawn once and without gaps
+static inline bool EdgeOwnsCenters(const double dx, const double dz)
+{
+	return (dz < 0.0) || (dz == 0.0 && dx > 0.0);
+}
+
+// max of heights at texel centers inside the rect, x1 and y1 are exclusive
+static void RasterizeTriangle(const HeightFieldGrid &grid, const float *a, const float *b, const float *c,
+	const int x0, const int y0, const int x1, const int y1, float *heights)
+{
+	double px[3] = { ((double) a[0] - grid.originX) / grid.cellSize, ((double) b[0] - grid.originX) / grid.cellSize,
+		((double) c[0] - grid.originX) / grid.cellSize };
+	double pz[3] = { ((double) a[2] - grid.originZ) / grid.cellSize, ((double) b[2] - grid.originZ) / grid.cellSize,
+		((double) c[2] - grid.originZ) / grid.cellSize };
+	double py[3] = { a[1], b[1], c[1] };
+
+	double area = (px[1] - px[0]) * (pz[2] - pz[0]) - (pz[1] - pz[0]) * (px[2] - px[0]);
+
+	if ( !(area != 0.0) )
+		return;
+
+	// counter clockwise in texel space
+	if (area < 0.0)
+	{
+		std::swap(px[1], px[2]);
+		std::swap(pz[1], pz[2]);
+		std::swap(py[1], py[2]);
+		area = -area;
+	}
+
+	int first[2], last[2];
+	if (false == TexelRange( std::min(px[0], std::min(px[1], px[2])), std::max(px[0], std::max(px[1], px[2])), grid.resolution, first[0], last[0] )
+		|| false == TexelRange( std::min(pz[0], std::min(pz[1], pz[2])), std::max(pz[0], std::max(pz[1], pz[2])), grid.resolution, first[1], last[1] ) )
+	{
+		return;
+	}
+
+	first[0] = std::max(first[0], x0);
+	first[1] = std::max(first[1], y0);
+	last[0] = std::min(last[0], x1 - 1);
+	last[1] = std::min(last[1], y1 - 1);
+
+	// edge k is opposite to the vertex k
+	double edgeX[3], edgeZ[3];
+	bool owns[3];
+
+	for (int k=0; k<3; ++k)
+	{
+		const int from = (k + 1) % 3;
+		const int to = (k + 2) % 3;
+
+		edgeX[k] = px[to] - px[from];
+		edgeZ[k] = pz[to] - pz[from];
+		owns[k] = EdgeOwnsCenters(edgeX[k], edgeZ[k]);
+	}
+
+	const double invArea = 1.0 / area;
+
+	for (int j=first[1]; j<=last[1]; ++j)
+	{
+		const double z = (double) j + 0.5;
+		float *row = heights + (size_t) j * grid.resolution;
+
+		for (int i=first[0]; i<=last[0]; ++i)
+		{
+			const double x = (double) i + 0.5;
+			double w[3];
+			bool inside = true;
+
+			for (int k=0; k<3 && inside; ++k)
+			{
+				const int from = (k + 1) % 3;
+				w[k] = edgeX[k] * (z - pz[from]) - edgeZ[k] * (x - px[from]);
+				inside = (w[k] > 0.0) || (w[k] == 0.0 && owns[k]);
+			}
+
+			if (false == inside)
+				continue;
+
+			const float height = (float) ( (w[0] * py[0] + w[1] * py[1] + w[2] * py[2]) * invArea );
+
+			// depth range of the orthographic matrix
+			if (height >= grid.minY && height <= grid.maxY && height > row[i])
+				row[i] = height;
+		}
+	}
+}
+
+bool HeightFieldGrid::operator == (const HeightFieldGrid &other) const
+{
+	return resolution == other.resolution && originX == other.originX && originZ == other.originZ
+		&& cellSize == other.cellSize && minY == other.minY && maxY == other.maxY;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// HeightFieldRasterizer
+
+HeightFieldRasterizer::HeightFieldRasterizer()
+	: mTilesX(0)
+{
+	memset( &mGrid, 0, sizeof(HeightFieldGrid) );
+	memset( &mStats, 0, sizeof(HeightFieldStats) );
+	memset( mUpdatedRect, 0, sizeof(int) * 4 );
+}
+
+void HeightFieldRasterizer::SetGrid(const HeightFieldGrid &grid)
+{
+	if (grid == mGrid && false == mHeights.empty() )
+		return;
+
+	mGrid = grid;
+	mGrid.resolution = std::max(grid.resolution, 1);
+
+	const int resolution = mGrid.resolution;
+	mTilesX = (resolution + HEIGHT_FIELD_TILE_SIZE - 1) / HEIGHT_FIELD_TILE_SIZE;
+
+	mHeights.assign( (size_t) resolution * resolution, 0.0f );
+	mDirtyTiles.assign( mTilesX * mTilesX, 1 );
+
+	// bins are made in texels of the grid
+	for (auto iter=begin(mMeshes); iter!=end(mMeshes); ++iter)
+		BinTriangles(iter->second);
+}
+
+void HeightFieldRasterizer::Invalidate()
+{
+	std::fill( begin(mDirtyTiles), end(mDirtyTiles), 1 );
+}
+
+void HeightFieldRasterizer::BeginUpdate()
+{
+	for (auto iter=begin(mMeshes); iter!=end(mMeshes); ++iter)
+		iter->second.used = false;
+
+	mStats.changedMeshes = 0;
+}
+
+void HeightFieldRasterizer::MarkTiles(const int *tiles)
+{
+	for (int y=tiles[1]; y<=tiles[3]; ++y)
+		for (int x=tiles[0]; x<=tiles[2]; ++x)
+			mDirtyTiles[y * mTilesX + x] = 1;
+}
+
+bool HeightFieldRasterizer::UpdateMesh(const int id, const float *matrix, const float *positions, const int vertexCount,
+	const int *indices, const int indexCount, const int numberOfThreads)
+{
+	unsigned long long hash = 0xcbf29ce484222325ull;
+	const int counts[2] = { vertexCount, indexCount };
+
+	hash = HashWords(hash, counts, 2);
+	hash = HashWords(hash, matrix, 16);
+	hash = HashWords(hash, positions, (size_t) vertexCount * 4);
+	hash = HashWords(hash, indices, indexCount);
+
+	auto iter = mMeshes.find(id);
+	const bool isNew = (iter == end(mMeshes));
+
+	Mesh &mesh = mMeshes[id];
+	mesh.used = true;
+
+	if (false == isNew && mesh.hash == hash)
+		return false;
+
+	// tiles under the old state
+	if (false == isNew)
+		MarkTiles(mesh.tiles);
+
+	mesh.hash = hash;
+	mesh.vertices.resize( (size_t) vertexCount * 3 );
+
+	ParallelFor( vertexCount, HEIGHT_FIELD_VERTEX_GRAIN, [&] (const int first, const int last) {
+
+		for (int i=first; i<last; ++i)
+			TransformPoint(matrix, positions + (size_t) i * 4, mesh.vertices.data() + (size_t) i * 3);
+	}, numberOfThreads );
+
+	mesh.triangles.clear();
+	mesh.triangles.reserve(indexCount);
+
+	for (int i=0; i+2<indexCount; i+=3)
+	{
+		if (indices[i] < 0 || indices[i] >= vertexCount || indices[i+1] < 0 || indices[i+1] >= vertexCount
+			|| indices[i+2] < 0 || indices[i+2] >= vertexCount)
+		{
+			continue;
+		}
+
+		mesh.triangles.push_back(indices[i]);
+		mesh.triangles.push_back(indices[i+1]);
+		mesh.triangles.push_back(indices[i+2]);
+	}
+
+	BinTriangles(mesh);
+
+	// and under the new one
+	MarkTiles(mesh.tiles);
+
+	mStats.changedMeshes += 1;
+	return true;
+}
+
+void HeightFieldRasterizer::BinTriangles(Mesh &mesh)
+{
+	const int numberOfTiles = mTilesX * mTilesX;
+	const int numberOfTriangles = (int) mesh.triangles.size() / 3;
+
+	mesh.tiles[0] = mesh.tiles[1] = 0;
+	mesh.tiles[2] = mesh.tiles[3] = -1;
+
+	mesh.binStart.assign(numberOfTiles + 1, 0);
+	mesh.binTriangles.clear();
+
+	if (numberOfTiles == 0)
+		return;
+
+	// tile rect of every triangle, x1 < x0 when it does not cover any texel center
+	std::vector<int> rects( (size_t) numberOfTriangles * 4 );
+	int bounds[4] = { mTilesX, mTilesX, -1, -1 };
+
+	for (int i=0; i<numberOfTriangles; ++i)
+	{
+		const int *tri = mesh.triangles.data() + (size_t) i * 3;
+		int *rect = rects.data() + (size_t) i * 4;
+		int texels[4];
+
+		if (false == TriangleTexels(mGrid, &mesh.vertices[tri[0] * 3], &mesh.vertices[tri[1] * 3], &mesh.vertices[tri[2] * 3], texels) )
+		{
+			rect[0] = 0;
+			rect[2] = -1;
+			continue;
+		}
+
+		for (int k=0; k<4; ++k)
+			rect[k] = texels[k] / HEIGHT_FIELD_TILE_SIZE;
+
+		bounds[0] = std::min(bounds[0], rect[0]);
+		bounds[1] = std::min(bounds[1], rect[1]);
+		bounds[2] = std::max(bounds[2], rect[2]);
+		bounds[3] = std::max(bounds[3], rect[3]);
+
+		for (int y=rect[1]; y<=rect[3]; ++y)
+			for (int x=rect[0]; x<=rect[2]; ++x)
+				mesh.binStart[y * mTilesX + x + 1] += 1;
+	}
+
+	if (bounds[2] < 0)
+		return;
+
+	memcpy( mesh.tiles, bounds, sizeof(int) * 4 );
+
+	for (int i=0; i<numberOfTiles; ++i)
+		mesh.binStart[i+1] += mesh.binStart[i];
+
+	mesh.binTriangles.resize( mesh.binStart[numberOfTiles] );
+	std::vector<unsigned int> cursor( mesh.binStart.begin(), mesh.binStart.end() - 1 );
+
+	for (int i=0; i<numberOfTriangles; ++i)
+	{
+		const int *rect = rects.data() + (size_t) i * 4;
+
+		for (int y=rect[1]; y<=rect[3]; ++y)
+			for (int x=rect[0]; x<=rect[2]; ++x)
+				mesh.binTriangles[ cursor[y * mTilesX + x]++ ] = (unsigned int) i;
+	}
+}
+
+void HeightFieldRasterizer::RasterizeTile(const int tile)
+{
+	const int tileX = tile % mTilesX;
+	const int tileY = tile / mTilesX;
+	const int resolution = mGrid.resolution;
+
+	const int x0 = tileX * HEIGHT_FIELD_TILE_SIZE;
+	const int y0 = tileY * HEIGHT_FIELD_TILE_SIZE;
+	const int x1 = std::min(x0 + HEIGHT_FIELD_TILE_SIZE, resolution);
+	const int y1 = std::min(y0 + HEIGHT_FIELD_TILE_SIZE, resolution);
+
+	float *heights = mHeights.data();
+
+	for (int y=y0; y<y1; ++y)
+		std::fill( heights + (size_t) y * resolution + x0, heights + (size_t) y * resolution + x1, -FLT_MAX );
+
+	for (auto iter=begin(mMeshes); iter!=end(mMeshes); ++iter)
+	{
+		const Mesh &mesh = iter->second;
+
+		if (tileX < mesh.tiles[0] || tileX > mesh.tiles[2] || tileY < mesh.tiles[1] || tileY > mesh.tiles[3])
+			continue;
+
+		const float *vertices = mesh.vertices.data();
+
+		for (unsigned int k=mesh.binStart[tile]; k<mesh.binStart[tile+1]; ++k)
+		{
+			const int *tri = mesh.triangles.data() + (size_t) mesh.binTriangles[k] * 3;
+			RasterizeTriangle(mGrid, vertices + tri[0] * 3, vertices + tri[1] * 3, vertices + tri[2] * 3, x0, y0, x1, y1, heights);
+		}
+	}
+
+	// the clear value of the terrain frame buffer
+	for (int y=y0; y<y1; ++y)
+	{
+		float *row = heights + (size_t) y * resolution;
+
+		for (int x=x0; x<x1; ++x)
+		{
+			if (row[x] == -FLT_MAX)
+				row[x] = 0.0f;
+		}
+	}
+}
+
+int HeightFieldRasterizer::EndUpdate(const int numberOfThreads)
+{
+	// removed models leave their tiles
+	for (auto iter=begin(mMeshes); iter!=end(mMeshes); )
+	{
+		if (false == iter->second.used)
+		{
+			MarkTiles(iter->second.tiles);
+			iter = mMeshes.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	mTileList.clear();
+
+	int rect[4] = { mTilesX, mTilesX, -1, -1 };
+	long long triangles = 0;
+
+	for (int tile=0; tile<(int) mDirtyTiles.size(); ++tile)
+	{
+		if (0 == mDirtyTiles[tile])
+			continue;
+
+		mTileList.push_back(tile);
+		mDirtyTiles[tile] = 0;
+
+		const int x = tile % mTilesX;
+		const int y = tile / mTilesX;
+
+		rect[0] = std::min(rect[0], x);
+		rect[1] = std::min(rect[1], y);
+		rect[2] = std::max(rect[2], x);
+		rect[3] = std::max(rect[3], y);
+
+		for (auto iter=begin(mMeshes); iter!=end(mMeshes); ++iter)
+			triangles += iter->second.binStart[tile+1] - iter->second.binStart[tile];
+	}
+
+	const int numberOfTiles = (int) mTileList.size();
+
+	// tiles write only their own texels
+	ParallelFor( numberOfTiles, 1, [&] (const int first, const int last) {
+
+		for (int i=first; i<last; ++i)
+			RasterizeTile(mTileList[i]);
+	}, numberOfThreads );
+
+	if (numberOfTiles > 0)
+	{
+		mUpdatedRect[0] = rect[0] * HEIGHT_FIELD_TILE_SIZE;
+		mUpdatedRect[1] = rect[1] * HEIGHT_FIELD_TILE_SIZE;
+		mUpdatedRect[2] = std::min( (rect[2] + 1) * HEIGHT_FIELD_TILE_SIZE, mGrid.resolution ) - mUpdatedRect[0];
+		mUpdatedRect[3] = std::min( (rect[3] + 1) * HEIGHT_FIELD_TILE_SIZE, mGrid.resolution ) - mUpdatedRect[1];
+	}
+	else
+	{
+		memset( mUpdatedRect, 0, sizeof(int) * 4 );
+	}
+
+	mStats.numberOfMeshes = (int) mMeshes.size();
+	mStats.rasterizedTiles = numberOfTiles;
+	mStats.totalTiles = mTilesX * mTilesX;
+	mStats.triangles = triangles;
+
+	return numberOfTiles;
+}
+
+bool HeightFieldRasterizer::GetUpdatedRect(int &x, int &y, int &width, int &height) const
+{
+	x = mUpdatedRect[0];
+	y = mUpdatedRect[1];
+	width = mUpdatedRect[2];
+	height = mUpdatedRect[3];
+
+	return (width > 0 && height > 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+
+void GPUParticles::HeightFieldRasterizeReference(const HeightFieldGrid &grid, const float *matrix, const float *positions,
+	const int vertexCount, const int *indices, const int indexCount, float *heights)
+{
+	std::vector<float> vertices( (size_t) vertexCount * 3 );
+
+	for (int i=0; i<vertexCount; ++i)
+		TransformPoint(matrix, positions + (size_t) i * 4, vertices.data() + (size_t) i * 3);
+
+	for (int i=0; i+2<indexCount; i+=3)
+	{
+		if (indices[i] < 0 || indices[i] >= vertexCount || indices[i+1] < 0 || indices[i+1] >= vertexCount
+			|| indices[i+2] < 0 || indices[i+2] >= vertexCount)
+		{
+			continue;
+		}
+
+		RasterizeTriangle(grid, &vertices[indices[i] * 3], &vertices[indices[i+1] * 3], &vertices[indices[i+2] * 3],
+			0, 0, grid.resolution, grid.resolution, heights);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+
+struct BenchmarkMesh
+{
+	float					matrix[16];
+	std::vector<float>		positions;
+	std::vector<int>		indices;
+};
+
+static void BenchmarkMatrix(BenchmarkMesh &mesh, const float angle, const float x, const float y, const float z)
+{
+	memset( mesh.matrix, 0, sizeof(float) * 16 );
+
+	// rotation around y
+	mesh.matrix[0] = cosf(angle);
+	mesh.matrix[2] = -sinf(angle);
+	mesh.matrix[5] = 1.0f;
+	mesh.matrix[8] = sinf(angle);
+	mesh.matrix[10] = cosf(angle);
+	mesh.matrix[12] = x;
+	mesh.matrix[13] = y;
+	mesh.matrix[14] = z;
+	mesh.matrix[15] = 1.0f;
+}
+
+// hills over the square [-size; size], heights between 1 and 3
+static void GenerateBenchmarkTerrain(BenchmarkMesh &mesh, const int quads, const float size)
+{
+	BenchmarkMatrix(mesh, 0.0f, 0.0f, 0.0f, 0.0f);
+
+	const int side = quads + 1;
+	mesh.positions.resize(side * side * 4);
+	mesh.indices.clear();
+
+	for (int j=0; j<side; ++j)
+	{
+		for (int i=0; i<side; ++i)
+		{
+			float *p = mesh.positions.data() + (j * side + i) * 4;
+
+			p[0] = -size + 2.0f * size * (float) i / (float) quads;
+			p[2] = -size + 2.0f * size * (float) j / (float) quads;
+			p[1] = 2.0f + 0.6f * sinf(0.37f * p[0]) * cosf(0.23f * p[2]) + 0.3f * sinf(1.7f * p[0] + 0.9f * p[2]);
+			p[3] = 1.0f;
+		}
+	}
+
+	for (int j=0; j<quads; ++j)
+	{
+		for (int i=0; i<quads; ++i)
+		{
+			const int v = j * side + i;
+			const int quad[6] = { v, v + 1, v + side + 1, v, v + side + 1, v + side };
+			mesh.indices.insert( end(mesh.indices), quad, quad + 6 );
+		}
+	}
+}
+
+static void GenerateBenchmarkBox(BenchmarkMesh &mesh, const float width, const float height)
+{
+	const float corners[8][3] = { {-1.0f, 0.0f, -1.0f}, {1.0f, 0.0f, -1.0f}, {1.0f, 0.0f, 1.0f}, {-1.0f, 0.0f, 1.0f},
+		{-1.0f, 1.0f, -1.0f}, {1.0f, 1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}, {-1.0f, 1.0f, 1.0f} };
+	const int faces[36] = { 0,2,1, 0,3,2, 4,5,6, 4,6,7, 0,1,5, 0,5,4, 1,2,6, 1,6,5, 2,3,7, 2,7,6, 3,0,4, 3,4,7 };
+
+	mesh.positions.resize(8 * 4);
+
+	for (int i=0; i<8; ++i)
+	{
+		mesh.positions[i*4] = width * corners[i][0];
+		mesh.positions[i*4+1] = height * corners[i][1];
+		mesh.positions[i*4+2] = width * corners[i][2];
+		mesh.positions[i*4+3] = 1.0f;
+	}
+
+	mesh.indices.assign(faces, faces + 36);
+}
+
+static HeightFieldGrid BenchmarkGrid(const int resolution, const float size)
+{
+	HeightFieldGrid grid;
+
+	// terrain at the origin, MinZ 0 and MaxZ 100
+	grid.resolution = resolution;
+	grid.originX = -size;
+	grid.originZ = -size;
+	grid.cellSize = 2.0f * size / (float) resolution;
+	grid.minY = -100.0f;
+	grid.maxY = 100.0f;
+
+	return grid;
+}
+
+static void UpdateBenchmarkMeshes(HeightFieldRasterizer &rasterizer, const std::vector<BenchmarkMesh> &meshes, const int numberOfThreads)
+{
+	rasterizer.BeginUpdate();
+
+	for (int i=0; i<(int) meshes.size(); ++i)
+	{
+		const BenchmarkMesh &mesh = meshes[i];
+		rasterizer.UpdateMesh(i, mesh.matrix, mesh.positions.data(), (int) mesh.positions.size() / 4,
+			mesh.indices.data(), (int) mesh.indices.size(), numberOfThreads);
+	}
+
+	rasterizer.EndUpdate(numberOfThreads);
+}
+
+static void ReferenceHeights(const HeightFieldGrid &grid, const std::vector<BenchmarkMesh> &meshes, std::vector<float> &heights)
+{
+	heights.assign( (size_t) grid.resolution * grid.resolution, -FLT_MAX );
+
+	for (auto iter=begin(meshes); iter!=end(meshes); ++iter)
+	{
+		HeightFieldRasterizeReference(grid, iter->matrix, iter->positions.data(), (int) iter->positions.size() / 4,
+			iter->indices.data(), (int) iter->indices.size(), heights.data());
+	}
+
+	for (auto iter=begin(heights); iter!=end(heights); ++iter)
+	{
+		if (*iter == -FLT_MAX)
+			*iter = 0.0f;
+	}
+}
+
+static float MaxDifference(const float *heights, const float *reference, const size_t count)
+{
+	float result = 0.0f;
+
+	for (size_t i=0; i<count; ++i)
+		result = std::max( result, fabsf(heights[i] - reference[i]) );
+
+	return result;
+}
+
+// terrain, boxes on it and a box above the depth range
+static void GenerateBenchmarkScene(std::vector<BenchmarkMesh> &meshes, const int quads, const float size)
+{
+	meshes.resize(6);
+	GenerateBenchmarkTerrain(meshes[0], quads, size);
+
+	for (int i=1; i<6; ++i)
+	{
+		GenerateBenchmarkBox(meshes[i], 0.05f * size * (float) i, 1.0f + (float) i);
+		BenchmarkMatrix(meshes[i], 0.4f * (float) i, size * (0.7f * sinf(1.3f * i)), 1.0f, size * (0.7f * cosf(2.1f * i)) );
+	}
+
+	meshes[5].matrix[13] = 150.0f;
+}
+
+bool GPUParticles::HeightFieldBenchmark(const int maxResolution)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	bool result = true;
+	const float size = 50.0f;
+	const float tolerance = 0.0001f;
+
+	std::vector<BenchmarkMesh>	meshes;
+	std::vector<float>			reference;
+
+	// 1 - tilted plane over the whole grid, heights at texel centers and the depth range
+
+	{
+		HeightFieldGrid grid = BenchmarkGrid(100, size);
+		grid.minY = 0.0f;
+		grid.maxY = 40.0f;
+
+		meshes.resize(1);
+		BenchmarkMatrix(meshes[0], 0.0f, 0.0f, 0.0f, 0.0f);
+
+		const float corners[4][2] = { {-60.0f, -60.0f}, {60.0f, -60.0f}, {60.0f, 60.0f}, {-60.0f, 60.0f} };
+		auto fnPlane = [] (const float x, const float z) { return 0.25f * x - 0.5f * z + 10.0f; };
+
+		meshes[0].positions.resize(16);
+		for (int i=0; i<4; ++i)
+		{
+			float *p = meshes[0].positions.data() + i * 4;
+			p[0] = corners[i][0];
+			p[1] = fnPlane(corners[i][0], corners[i][1]);
+			p[2] = corners[i][1];
+			p[3] = 1.0f;
+		}
+
+		const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+		meshes[0].indices.assign(quad, quad + 6);
+
+		HeightFieldRasterizer rasterizer;
+		rasterizer.SetGrid(grid);
+		UpdateBenchmarkMeshes(rasterizer, meshes, 0);
+
+		float maxError = 0.0f;
+
+		for (int j=0; j<grid.resolution; ++j)
+		{
+			for (int i=0; i<grid.resolution; ++i)
+			{
+				const float x = grid.originX + ((float) i + 0.5f) * grid.cellSize;
+				const float z = grid.originZ + ((float) j + 0.5f) * grid.cellSize;
+				float expected = fnPlane(x, z);
+
+				// a bit of slack at the clip planes
+				if (fabsf(expected - grid.minY) < 0.001f || fabsf(expected - grid.maxY) < 0.001f)
+					continue;
+				if (expected < grid.minY || expected > grid.maxY)
+					expected = 0.0f;
+
+				maxError = std::max( maxError, fabsf(rasterizer.GetHeights()[j * grid.resolution + i] - expected) );
+			}
+		}
+
+		if (maxError > 0.001f)
+		{
+			printf( "[GPU Particles] height field - plane error %f\n", maxError );
+			result = false;
+		}
+	}
+
+	// 2 - tiles against every triangle over every texel, terrain has no holes
+
+	const int testResolutions[3] = { 128, 200, 512 };
+
+	for (int k=0; k<3; ++k)
+	{
+		const HeightFieldGrid grid = BenchmarkGrid(testResolutions[k], size);
+		GenerateBenchmarkScene(meshes, 37, size);
+		ReferenceHeights(grid, meshes, reference);
+
+		for (int numberOfThreads=1; numberOfThreads>=0; --numberOfThreads)
+		{
+			HeightFieldRasterizer rasterizer;
+			rasterizer.SetGrid(grid);
+			UpdateBenchmarkMeshes(rasterizer, meshes, numberOfThreads);
+
+			const float *heights = rasterizer.GetHeights();
+			const size_t count = reference.size();
+			bool holes = false;
+
+			for (size_t i=0; i<count; ++i)
+				holes = holes || (heights[i] < 0.5f);
+
+			const float difference = MaxDifference(heights, reference.data(), count);
+
+			if (difference > tolerance || holes)
+			{
+				printf( "[GPU Particles] height field - resolution %d on %d threads, difference %f, holes %d\n",
+					grid.resolution, numberOfThreads, difference, (holes) ? 1 : 0 );
+				result = false;
+			}
+		}
+	}
+
+	// 3 - incremental updates against a full rasterization of the same frame
+
+	{
+		const HeightFieldGrid grid = BenchmarkGrid(512, size);
+		GenerateBenchmarkScene(meshes, 64, size);
+
+		HeightFieldRasterizer rasterizer;
+		rasterizer.SetGrid(grid);
+		UpdateBenchmarkMeshes(rasterizer, meshes, 0);
+
+		for (int frame=0; frame<6; ++frame)
+		{
+			if (frame == 1)
+			{
+				// nothing is changed
+			}
+			else if (frame == 3)
+			{
+				meshes.erase(meshes.begin() + 2);
+			}
+			else if (frame == 4)
+			{
+				// terrain deformation
+				meshes[0].positions[(33 * 65 + 20) * 4 + 1] += 4.0f;
+			}
+			else
+			{
+				BenchmarkMatrix(meshes[1], 0.1f * frame, -10.0f + 3.0f * frame, 2.0f, 5.0f);
+			}
+
+			UpdateBenchmarkMeshes(rasterizer, meshes, 0);
+			const HeightFieldStats stats = rasterizer.GetStats();
+
+			HeightFieldRasterizer full;
+			full.SetGrid(grid);
+			UpdateBenchmarkMeshes(full, meshes, 0);
+
+			const float difference = MaxDifference(rasterizer.GetHeights(), full.GetHeights(), (size_t) grid.resolution * grid.resolution);
+
+			// a deformed terrain covers all tiles, a moved box only some of them
+			bool tilesPassed = (stats.rasterizedTiles > 0 && stats.rasterizedTiles < stats.totalTiles);
+			if (frame == 1)
+				tilesPassed = (stats.rasterizedTiles == 0);
+			else if (frame == 4)
+				tilesPassed = (stats.rasterizedTiles == stats.totalTiles);
+
+			if (difference > tolerance || false == tilesPassed)
+			{
+				printf( "[GPU Particles] height field - incremental frame %d, difference %f, %d of %d tiles\n",
+					frame, difference, stats.rasterizedTiles, stats.totalTiles );
+				result = false;
+			}
+		}
+	}
+
+	// 4 - timing
+
+	printf( "[GPU Particles] height field benchmark, %d threads, terrain of 256x256 quads and boxes\n", ParallelForThreadCount() );
+	printf( "[GPU Particles] %10s | %12s %12s %12s %12s | %9s %9s\n", "resolution", "full 1 ms", "full N ms", "moved N ms",
+		"static N ms", "tiles", "of tiles" );
+
+	GenerateBenchmarkScene(meshes, 256, size);
+
+	for (int resolution=512; resolution<=maxResolution; resolution *= 2)
+	{
+		const HeightFieldGrid grid = BenchmarkGrid(resolution, size);
+
+		auto fnRunFull = [&] (const int numberOfThreads) {
+			HeightFieldRasterizer rasterizer;
+			rasterizer.SetGrid(grid);
+
+			auto startTime = clock::now();
+			UpdateBenchmarkMeshes(rasterizer, meshes, numberOfThreads);
+			return std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+		};
+
+		const double singleMs = fnRunFull(1);
+		const double threadsMs = fnRunFull(0);
+
+		HeightFieldRasterizer rasterizer;
+		rasterizer.SetGrid(grid);
+		UpdateBenchmarkMeshes(rasterizer, meshes, 0);
+
+		BenchmarkMatrix(meshes[1], 1.0f, 12.0f + 512.0f / (float) resolution, 1.0f, -7.0f);
+
+		auto startTime = clock::now();
+		UpdateBenchmarkMeshes(rasterizer, meshes, 0);
+		const double movedMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+		const HeightFieldStats stats = rasterizer.GetStats();
+
+		startTime = clock::now();
+		UpdateBenchmarkMeshes(rasterizer, meshes, 0);
+		const double staticMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		if (rasterizer.GetStats().rasterizedTiles != 0)
+			result = false;
+
+		printf( "[GPU Particles] %10d | %12.2f %12.2f %12.2f %12.2f | %9d %9d\n", resolution, singleMs, threadsMs,
+			movedMs, staticMs, stats.rasterizedTiles, stats.totalTiles );
+	}
+
+	printf( "[GPU Particles] height field benchmark %s\n", (result) ? "passed" : "FAILED" );
+	return result;
+}
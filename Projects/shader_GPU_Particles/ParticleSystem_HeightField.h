@@ -0,0 +1,138 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_HeightField.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <vector>
+#include <map>
+
+/*
+	CPU height field for the collision terrain
+
+	the same map as the terrain depth pass of CollisionTerrain::RenderToHeightMap - texel (i, j) is sampled
+	 at the center, world x goes along i and world z along j, a value is the max world y of triangles
+	 over the center, 0 where there are no triangles. Triangles are clipped by the height range of
+	 the orthographic matrix of that pass. Edges use the top-left rule like the GPU rasterizer.
+
+	Grid is split into tiles of 32x32 texels. Every mesh keeps world positions and triangles binned by
+	 tiles, a mesh is hashed (matrix, positions and indices) on update, when a hash is changed old and
+	 new tiles of the mesh are marked dirty. Only dirty tiles are cleared and rasterized again with
+	 triangles of all meshes from their bins, tiles are processed in parallel.
+*/
+
+#define HEIGHT_FIELD_TILE_SIZE			32
+
+namespace GPUParticles
+{
+
+struct HeightFieldGrid
+{
+	int			resolution;		// texels on a side
+	float		originX;		// world x and z of the grid corner
+	float		originZ;
+	float		cellSize;		// world size of a texel
+	float		minY;			// world height range of triangles
+	float		maxY;
+
+	bool operator == (const HeightFieldGrid &other) const;
+};
+
+struct HeightFieldStats
+{
+	int			numberOfMeshes;
+	int			changedMeshes;
+	int			rasterizedTiles;
+	int			totalTiles;
+	long long	triangles;		// triangle and tile pairs of the last update
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class HeightFieldRasterizer
+{
+public:
+
+	//! a constructor
+	HeightFieldRasterizer();
+
+	//! a new grid makes all tiles dirty
+	void SetGrid(const HeightFieldGrid &grid);
+	const HeightFieldGrid &GetGrid() const {
+		return mGrid;
+	}
+
+	//! all tiles are rasterized on the next update
+	void Invalidate();
+
+	//! meshes which are not updated till EndUpdate are removed
+	void BeginUpdate();
+
+	/*! new state of the mesh, returns true when it is changed
+		\param matrix - column major model to world matrix
+		\param positions - 4 floats per vertex
+		\param indices - 3 per triangle
+	*/
+	bool UpdateMesh(const int id, const float *matrix, const float *positions, const int vertexCount,
+		const int *indices, const int indexCount, const int numberOfThreads=0);
+
+	//! rasterize dirty tiles, returns the number of them
+	int EndUpdate(const int numberOfThreads=0);
+
+	const float *GetHeights() const {
+		return mHeights.data();
+	}
+
+	//! texels rasterized by the last update, false when nothing is changed
+	bool GetUpdatedRect(int &x, int &y, int &width, int &height) const;
+
+	const HeightFieldStats &GetStats() const { return mStats; }
+
+protected:
+
+	struct Mesh
+	{
+		unsigned long long				hash;
+		bool							used;
+		int								tiles[4];			// x0, y0, x1, y1 inclusive, x1 < x0 for no tiles
+
+		std::vector<float>				vertices;			// world positions, 3 per vertex
+		std::vector<int>				triangles;			// 3 per triangle
+		std::vector<unsigned int>		binStart;			// triangles of a tile, numberOfTiles + 1
+		std::vector<unsigned int>		binTriangles;
+	};
+
+	HeightFieldGrid					mGrid;
+	HeightFieldStats				mStats;
+
+	int								mTilesX;
+	std::vector<float>				mHeights;
+	std::vector<char>				mDirtyTiles;
+	std::vector<int>				mTileList;
+	int								mUpdatedRect[4];		// x, y, width, height of the last update
+
+	std::map<int, Mesh>				mMeshes;
+
+	void MarkTiles(const int *tiles);
+	void BinTriangles(Mesh &mesh);
+	void RasterizeTile(const int tile);
+};
+
+//! every triangle over every texel, max into heights (resolution * resolution, -FLT_MAX where nothing is drawn yet)
+void HeightFieldRasterizeReference(const HeightFieldGrid &grid, const float *matrix, const float *positions,
+	const int vertexCount, const int *indices, const int indexCount, float *heights);
+
+//! tiles against the reference, analytic planes, incremental update against a full one and timing
+//!  up to the resolution, prints results into the log
+bool HeightFieldBenchmark(const int maxResolution);
+
+};
@@ -54,7 +54,7 @@ void ParticleSystem::SetRenderSizeAndColorCurves( GLuint sizeTextureId, GLuint c
 	mColorTextureId = colorTextureId;
 }
 
-void ParticleSystem::RenderParticles(int type, const bool pointSmooth, const bool pointFalloff)
+void ParticleSystem::RenderParticles(int type, const bool pointSmooth, const bool pointFalloff, const bool depthSort)
 {
 	//GLuint lSizeTexId = mSizeCurve.GetTextureId();
 	//GLuint lColorTexId = mColorCurve.GetTextureId();
@@ -77,6 +77,12 @@ void ParticleSystem::RenderParticles(int type, const bool pointSmooth, const boo
 	}
 
 	
+	// points go in the order of the camera, instances have attributes with a divisor
+	mDrawSorted = false;
+
+	if (true == depthSort && 4 != type)
+		mDrawSorted = SortParticles();
+
 	//
 	switch(type)
 	{
@@ -148,7 +154,7 @@ void ParticleSystem::RenderPoints()
 	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (const GLvoid*)48);  // rotation
 	
 	//glDrawTransformFeedback(GL_POINTS, mTransformFeedback[mCurrTFB]);
-	glDrawArrays( GL_POINTS, 0, mInstanceCount );
+	DrawPoints();
 
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
@@ -181,7 +187,7 @@ void ParticleSystem::RenderQuads()
 	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (const GLvoid*)48);  // rotation
 	
 	//glDrawTransformFeedback(GL_POINTS, mTransformFeedback[mCurrTFB]);
-	glDrawArrays( GL_POINTS, 0, mInstanceCount );
+	DrawPoints();
 
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
@@ -210,7 +216,7 @@ void ParticleSystem::RenderBillboards()
 	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (const GLvoid*)48);  // rotation
 	
 	//glDrawTransformFeedback(GL_POINTS, mTransformFeedback[mCurrTFB]);
-	glDrawArrays( GL_POINTS, 0, mInstanceCount );
+	DrawPoints();
 
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
@@ -238,7 +244,7 @@ void ParticleSystem::RenderStretchedBillboards()
 	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (const GLvoid*)48);  // rotation
 	
 	//glDrawTransformFeedback(GL_POINTS, mTransformFeedback[mCurrTFB]);
-	glDrawArrays( GL_POINTS, 0, mInstanceCount );
+	DrawPoints();
 
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
@@ -249,6 +255,19 @@ void ParticleSystem::RenderStretchedBillboards()
 
 }
 
+void ParticleSystem::DrawPoints()
+{
+	if (true == mDrawSorted)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mDepthSortBuffers[0]);
+		glDrawElements( GL_POINTS, mInstanceCount, GL_UNSIGNED_INT, nullptr );
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	else
+	{
+		glDrawArrays( GL_POINTS, 0, mInstanceCount );
+	}
+}
 
 void ParticleSystem::RenderInstances()
 {
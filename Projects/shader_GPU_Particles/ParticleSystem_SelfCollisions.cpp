@@ -0,0 +1,475 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_SelfCollisions.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_SelfCollisions.h"
+#include "algorithm\ParallelFor.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+using namespace GPUParticles;
+
+#define SELF_COLLISIONS_GRAIN_SIZE		4096
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// the same functions as in the compute shader
+
+static inline unsigned int CellHash(const int x, const int y, const int z, const unsigned int mask)
+{
+	return ( ((unsigned int) x * 73856093u) ^ ((unsigned int) y * 19349663u) ^ ((unsigned int) z * 83492791u) ) & mask;
+}
+
+static inline int CellCoord(const float value, const float cellSize)
+{
+	return (int) floorf(value / cellSize);
+}
+
+// pos and vel are 4 floats, other velocity w is an age
+static inline bool AddContact(const float *pos, const float *vel, const float *other, const float *otherVel, float *acc)
+{
+	float n[3] = { pos[0] - other[0], pos[1] - other[1], pos[2] - other[2] };
+	const float udiff = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	const float radsum = pos[3] + other[3];
+
+	if (otherVel[3] > 0.0f && udiff < radsum && udiff > 0.0f)
+	{
+		n[0] /= udiff;
+		n[1] /= udiff;
+		n[2] /= udiff;
+
+		const float mass = 1.0f;
+		const float a1 = vel[0] * n[0] + vel[1] * n[1] + vel[2] * n[2];
+		const float a2 = otherVel[0] * n[0] + otherVel[1] * n[1] + otherVel[2] * n[2];
+
+		const float optimizedP = (2.0f * (a1 - a2)) / (mass + mass);
+
+		acc[0] -= optimizedP * mass * n[0];
+		acc[1] -= optimizedP * mass * n[1];
+		acc[2] -= optimizedP * mass * n[2];
+		return true;
+	}
+
+	return false;
+}
+
+static inline void ApplyAcceleration(const float *vel, float *acc, float *result)
+{
+	const float accLen = sqrtf(acc[0] * acc[0] + acc[1] * acc[1] + acc[2] * acc[2]);
+
+	if (accLen > SELF_COLLISIONS_ACCELERATION_LIMIT)
+	{
+		const float f = SELF_COLLISIONS_ACCELERATION_LIMIT / accLen;
+		acc[0] *= f;
+		acc[1] *= f;
+		acc[2] *= f;
+	}
+
+	result[0] = vel[0] + acc[0];
+	result[1] = vel[1] + acc[1];
+	result[2] = vel[2] + acc[2];
+	result[3] = vel[3];
+}
+
+int GPUParticles::SelfCollisionsNumberOfCells(const int numberOfParticles)
+{
+	int count = SELF_COLLISIONS_MIN_CELLS;
+
+	while (count < numberOfParticles && count < SELF_COLLISIONS_MAX_CELLS)
+		count *= 2;
+
+	return count;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SelfCollisionsGrid
+
+SelfCollisionsGrid::SelfCollisionsGrid()
+	: mCount(0)
+	, mCellSize(1.0f)
+{
+	memset( &mStats, 0, sizeof(SelfCollisionsStats) );
+}
+
+void SelfCollisionsGrid::Build(const Particle *particles, const int count, const int numberOfCells, const int numberOfThreads)
+{
+	mCount = count;
+	memset( &mStats, 0, sizeof(SelfCollisionsStats) );
+
+	// 1 - cell size from the largest alive particle
+
+	float maxRadius = 0.0f;
+
+	for (int i=0; i<count; ++i)
+	{
+		if (particles[i].Color.z > 0.0f)
+			maxRadius = std::max(maxRadius, particles[i].Pos.w);
+	}
+
+	mCellSize = std::max(SELF_COLLISIONS_CELL_SCALE * maxRadius, 1.0e-4f);
+
+	const int cellsCount = (numberOfCells > 0) ? numberOfCells : SelfCollisionsNumberOfCells(count);
+	const unsigned int mask = (unsigned int) cellsCount - 1;
+
+	mCells.resize(cellsCount);
+	memset( mCells.data(), 0, sizeof(Cell) * cellsCount );
+
+	// 2 - cell keys
+
+	mKeys.resize(count);
+
+	ParallelFor( count, SELF_COLLISIONS_GRAIN_SIZE, [&] (const int first, const int last) {
+
+		const float cellSize = mCellSize;
+
+		for (int i=first; i<last; ++i)
+		{
+			const Particle &particle = particles[i];
+
+			if (particle.Color.z > 0.0f)
+			{
+				mKeys[i] = CellHash( CellCoord(particle.Pos.x, cellSize), CellCoord(particle.Pos.y, cellSize),
+					CellCoord(particle.Pos.z, cellSize), mask );
+			}
+			else
+			{
+				mKeys[i] = SELF_COLLISIONS_INVALID_CELL;
+			}
+		}
+	}, numberOfThreads );
+
+	// 3 - counting sort, stable inside a cell
+
+	int numberOfBinned = 0;
+
+	for (int i=0; i<count; ++i)
+	{
+		if (mKeys[i] != SELF_COLLISIONS_INVALID_CELL)
+		{
+			mCells[mKeys[i]].count += 1;
+			numberOfBinned += 1;
+		}
+	}
+
+	unsigned int start = 0;
+	int maxCellLoad = 0;
+
+	for (auto iter=begin(mCells); iter!=end(mCells); ++iter)
+	{
+		iter->start = start;
+		start += iter->count;
+		maxCellLoad = std::max(maxCellLoad, (int) iter->count);
+	}
+
+	mSortedIndices.resize(numberOfBinned);
+	mSortedData.resize(8 * numberOfBinned);
+
+	std::vector<unsigned int> cursor(cellsCount, 0);
+
+	for (int i=0; i<count; ++i)
+	{
+		const unsigned int key = mKeys[i];
+
+		if (key != SELF_COLLISIONS_INVALID_CELL)
+		{
+			mSortedIndices[mCells[key].start + cursor[key]] = (unsigned int) i;
+			cursor[key] += 1;
+		}
+	}
+
+	// 4 - sorted copy of positions and velocities, age in w
+
+	ParallelFor( numberOfBinned, SELF_COLLISIONS_GRAIN_SIZE, [&] (const int first, const int last) {
+
+		for (int slot=first; slot<last; ++slot)
+		{
+			const Particle &particle = particles[mSortedIndices[slot]];
+			float *data = &mSortedData[8 * slot];
+
+			data[0] = particle.Pos.x;
+			data[1] = particle.Pos.y;
+			data[2] = particle.Pos.z;
+			data[3] = particle.Pos.w;
+			data[4] = particle.Vel.x;
+			data[5] = particle.Vel.y;
+			data[6] = particle.Vel.z;
+			data[7] = particle.Color.z;
+		}
+	}, numberOfThreads );
+
+	mStats.cellSize = mCellSize;
+	mStats.numberOfCells = cellsCount;
+	mStats.numberOfBinned = numberOfBinned;
+	mStats.maxCellLoad = maxCellLoad;
+}
+
+void SelfCollisionsGrid::Collide(const Particle *particles, float *velocities, const int numberOfThreads)
+{
+	const unsigned int mask = (unsigned int) mCells.size() - 1;
+	const int numberOfBinned = (int) mSortedIndices.size();
+
+	// dead particles keep a velocity
+	for (int i=0; i<mCount; ++i)
+	{
+		if (mKeys[i] == SELF_COLLISIONS_INVALID_CELL)
+			memcpy( velocities + 4 * i, &particles[i].Vel, sizeof(float) * 4 );
+	}
+
+	std::atomic<long long>	pairsTested(0);
+	std::atomic<long long>	contacts(0);
+
+	// in a sorted order, neighbours of close slots are in the same cells
+	ParallelFor( numberOfBinned, SELF_COLLISIONS_GRAIN_SIZE, [&] (const int first, const int last) {
+
+		long long localPairs = 0;
+		long long localContacts = 0;
+
+		for (int slot=first; slot<last; ++slot)
+		{
+			const int index = (int) mSortedIndices[slot];
+			const float *pos = &mSortedData[8 * slot];
+			const float *vel = &particles[index].Vel.x;
+
+			const int cx = CellCoord(pos[0], mCellSize);
+			const int cy = CellCoord(pos[1], mCellSize);
+			const int cz = CellCoord(pos[2], mCellSize);
+
+			unsigned int visited[27];
+			int numberOfVisited = 0;
+
+			float acc[3] = {0.0f, 0.0f, 0.0f};
+
+			for (int dz=-1; dz<=1; ++dz)
+				for (int dy=-1; dy<=1; ++dy)
+					for (int dx=-1; dx<=1; ++dx)
+					{
+						const unsigned int hash = CellHash(cx + dx, cy + dy, cz + dz, mask);
+
+						// different cells could share a hash entry
+						bool seen = false;
+						for (int k=0; k<numberOfVisited; ++k)
+						{
+							if (visited[k] == hash)
+							{
+								seen = true;
+								break;
+							}
+						}
+
+						if (seen)
+							continue;
+
+						visited[numberOfVisited++] = hash;
+
+						const Cell &cell = mCells[hash];
+						const unsigned int end = cell.start + cell.count;
+
+						for (unsigned int j=cell.start; j<end; ++j)
+						{
+							if (j == (unsigned int) slot)
+								continue;
+
+							const float *other = &mSortedData[8 * j];
+
+							localPairs += 1;
+							if (AddContact(pos, vel, other, other + 4, acc) )
+								localContacts += 1;
+						}
+					}
+
+			ApplyAcceleration(vel, acc, velocities + 4 * index);
+		}
+
+		pairsTested += localPairs;
+		contacts += localContacts;
+
+	}, numberOfThreads );
+
+	mStats.pairsTested = pairsTested;
+	mStats.contacts = contacts;
+}
+
+void GPUParticles::SelfCollisionsBruteForce(const Particle *particles, const int count, float *velocities)
+{
+	for (int i=0; i<count; ++i)
+	{
+		const float *pos = &particles[i].Pos.x;
+		const float *vel = &particles[i].Vel.x;
+
+		if (particles[i].Color.z <= 0.0f)
+		{
+			memcpy( velocities + 4 * i, vel, sizeof(float) * 4 );
+			continue;
+		}
+
+		float acc[3] = {0.0f, 0.0f, 0.0f};
+
+		for (int j=0; j<count; ++j)
+		{
+			if (i == j)
+				continue;
+
+			const float otherVel[4] = { particles[j].Vel.x, particles[j].Vel.y, particles[j].Vel.z, particles[j].Color.z };
+			AddContact(pos, vel, &particles[j].Pos.x, otherVel, acc);
+		}
+
+		ApplyAcceleration(vel, acc, velocities + 4 * i);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+
+static void GenerateBenchmarkParticles(std::vector<Particle> &particles, const int count, unsigned int seed)
+{
+	auto fnRandom = [&seed] () {
+		seed = seed * 1664525u + 1013904223u;
+		return (float) (seed >> 8) / (float) (1u << 24);
+	};
+
+	const float radius = 0.05f;
+	// about two particles per cell volume
+	const float side = SELF_COLLISIONS_CELL_SCALE * 1.2f * radius * powf(0.5f * (float) count, 1.0f / 3.0f);
+
+	particles.resize(count);
+	memset( particles.data(), 0, sizeof(Particle) * count );
+
+	for (int i=0; i<count; ++i)
+	{
+		Particle &particle = particles[i];
+
+		particle.Pos.x = side * (fnRandom() - 0.5f);
+		particle.Pos.y = side * fnRandom();
+		particle.Pos.z = side * (fnRandom() - 0.5f);
+		particle.Pos.w = radius * (0.8f + 0.4f * fnRandom() );
+
+		particle.Vel.x = 2.0f * fnRandom() - 1.0f;
+		particle.Vel.y = 2.0f * fnRandom() - 1.0f;
+		particle.Vel.z = 2.0f * fnRandom() - 1.0f;
+		particle.Vel.w = fnRandom();
+
+		// every tenth is dead
+		particle.Color.y = 5.0f;
+		particle.Color.z = (i % 10 == 9) ? 0.0f : 0.1f + fnRandom();
+		particle.Color.w = (float) i / (float) count;
+	}
+}
+
+static float CompareVelocities(const std::vector<float> &a, const std::vector<float> &b)
+{
+	float maxDiff = 0.0f;
+	for (size_t i=0; i<a.size(); ++i)
+		maxDiff = std::max(maxDiff, fabsf(a[i] - b[i]) );
+	return maxDiff;
+}
+
+bool GPUParticles::SelfCollisionsBenchmark(const int maxNumberOfParticles)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	const float tolerance = 1.0e-4f;
+	bool result = true;
+
+	std::vector<Particle>	particles;
+	std::vector<float>		gridVelocities;
+	std::vector<float>		bruteVelocities;
+	SelfCollisionsGrid		grid;
+
+	// 1 - the same result as all pairs, a tiny table makes a lot of hash collisions
+
+	const int testCells[2] = { 0, 64 };
+
+	for (int i=0; i<2; ++i)
+	{
+		const int count = 4096;
+		GenerateBenchmarkParticles(particles, count, 11);
+
+		gridVelocities.resize(4 * count);
+		bruteVelocities.resize(4 * count);
+
+		grid.Build(particles.data(), count, testCells[i] );
+		grid.Collide(particles.data(), gridVelocities.data() );
+		SelfCollisionsBruteForce(particles.data(), count, bruteVelocities.data() );
+
+		const float maxDiff = CompareVelocities(gridVelocities, bruteVelocities);
+
+		if (maxDiff > tolerance || grid.GetStats().contacts == 0)
+		{
+			printf( "[GPU Particles] self collisions - grid of %d cells differs from all pairs, difference %g, contacts %lld\n",
+				grid.GetStats().numberOfCells, maxDiff, grid.GetStats().contacts );
+			result = false;
+		}
+	}
+
+	// 2 - scaling
+
+	printf( "[GPU Particles] self collisions benchmark, %d threads, time per step\n", ParallelForThreadCount() );
+	printf( "[GPU Particles] %9s | %12s %12s %12s | %12s %12s %10s\n", "particles", "all pairs ms", "grid 1 ms", "grid N ms", "pairs/part", "contacts", "max diff" );
+
+	const int firstCount = 16384;
+	double firstBruteMs = 0.0;
+
+	for (int count=firstCount; count<=maxNumberOfParticles; count *= 4)
+	{
+		GenerateBenchmarkParticles(particles, count, 7);
+		gridVelocities.resize(4 * count);
+
+		auto fnRunGrid = [&] (const int numberOfThreads) {
+			auto startTime = clock::now();
+			grid.Build(particles.data(), count, 0, numberOfThreads);
+			grid.Collide(particles.data(), gridVelocities.data(), numberOfThreads );
+			return std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+		};
+
+		const double singleMs = fnRunGrid(1);
+		const double threadsMs = fnRunGrid(0);
+
+		// all pairs are measured once, quadratic estimation for the rest
+		double bruteMs = 0.0;
+		char bruteText[32];
+		char diffText[32] = "-";
+
+		if (count == firstCount)
+		{
+			bruteVelocities.resize(4 * count);
+
+			auto startTime = clock::now();
+			SelfCollisionsBruteForce(particles.data(), count, bruteVelocities.data() );
+			bruteMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+			firstBruteMs = bruteMs;
+
+			const float maxDiff = CompareVelocities(gridVelocities, bruteVelocities);
+			if (maxDiff > tolerance)
+				result = false;
+
+			sprintf_s( bruteText, sizeof(bruteText), "%.2f", bruteMs );
+			sprintf_s( diffText, sizeof(diffText), "%g", maxDiff );
+		}
+		else
+		{
+			const double f = (double) count / (double) firstCount;
+			bruteMs = firstBruteMs * f * f;
+			sprintf_s( bruteText, sizeof(bruteText), "~%.0f", bruteMs );
+		}
+
+		const SelfCollisionsStats &stats = grid.GetStats();
+		printf( "[GPU Particles] %9d | %12s %12.2f %12.2f | %12.1f %12lld %10s\n", count, bruteText, singleMs, threadsMs,
+			(double) stats.pairsTested / std::max(1, stats.numberOfBinned), stats.contacts, diffText );
+	}
+
+	printf( "[GPU Particles] self collisions benchmark %s\n", (result) ? "passed" : "FAILED" );
+	return result;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_SelfCollisions.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_types.h"
+#include <vector>
+
+/*
+	Self collisions broadphase
+
+	alive particles (age in Color.z > 0) are binned into a hashed uniform grid with a counting sort,
+	 a cell is the largest particle diameter, so every contact is inside the 27 cells around a particle.
+	 Hash table size is a power of two and cells of the table are (count, start) pairs into a sorted copy
+	 of positions and velocities.
+
+	CPU version is a reference for GLSL_CS\Particles_selfcollisions.cs, the same hash, the same cell size
+	 and the same contact response. Velocities are read from the sorted copy, so the result does not
+	 depend on an order of the evaluation.
+*/
+
+#define SELF_COLLISIONS_MIN_CELLS		1024
+#define SELF_COLLISIONS_MAX_CELLS		1048576
+#define SELF_COLLISIONS_SCAN_BLOCK		1024		// cells scanned by one work group (256 invocations x 4)
+#define SELF_COLLISIONS_CELL_SCALE		2.02f		// cell size in particle radius, diameter and a margin for rounding
+#define SELF_COLLISIONS_INVALID_CELL	0xffffffff
+#define SELF_COLLISIONS_ACCELERATION_LIMIT	15.0f
+
+namespace GPUParticles
+{
+
+//! hash table size for the number of particles, a power of two in [1024; 1M]
+int SelfCollisionsNumberOfCells(const int numberOfParticles);
+
+struct SelfCollisionsStats
+{
+	float		cellSize;
+	int			numberOfCells;
+	int			numberOfBinned;		// alive particles
+	int			maxCellLoad;
+
+	long long	pairsTested;
+	long long	contacts;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class SelfCollisionsGrid
+{
+public:
+
+	//! a constructor
+	SelfCollisionsGrid();
+
+	/*! bin alive particles by a cell hash
+		\param numberOfCells - 0 is SelfCollisionsNumberOfCells(count), otherwise a power of two
+	*/
+	void Build(const Particle *particles, const int count, const int numberOfCells=0, const int numberOfThreads=0);
+
+	//! new velocity of every particle (4 floats, w is kept) after contacts with particles from adjacent cells
+	void Collide(const Particle *particles, float *velocities, const int numberOfThreads=0);
+
+	const SelfCollisionsStats &GetStats() const { return mStats; }
+
+protected:
+
+	struct Cell
+	{
+		unsigned int	count;
+		unsigned int	start;
+	};
+
+	int								mCount;
+	float							mCellSize;
+	SelfCollisionsStats				mStats;
+
+	std::vector<Cell>				mCells;
+	std::vector<unsigned int>		mKeys;				// cell of every particle, invalid for dead ones
+	std::vector<unsigned int>		mSortedIndices;		// particle of every sorted slot
+	std::vector<float>				mSortedData;		// position with radius, velocity with age, 8 per slot
+};
+
+//! every particle against every other, like the previous self collisions shader, for small counts only
+void SelfCollisionsBruteForce(const Particle *particles, const int count, float *velocities);
+
+//! grid results against all pairs, scaling of the grid on one and on all threads up to maxNumberOfParticles,
+//!  prints time per step into the log
+bool SelfCollisionsBenchmark(const int maxNumberOfParticles);
+
+};
@@ -0,0 +1,521 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_SurfaceEmitter.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_SurfaceEmitter.h"
+#include "algorithm\ParallelFor.h"
+#include "algorithm\nv_math.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+using namespace GPUParticles;
+
+// a triangle from vertex arrays, positions get w = 1, a normal is an average of vertex normals
+static void BuildTriangle(const vec4 *positions4, const vec4 *normals4, const vec2 *uv2, const int *indices, TTriangle &triangle)
+{
+	triangle.p0 = positions4[ indices[0] ];
+	triangle.p1 = positions4[ indices[1] ];
+	triangle.p2 = positions4[ indices[2] ];
+
+	triangle.p0.w = 1.0f;
+	triangle.p1.w = 1.0f;
+	triangle.p2.w = 1.0f;
+
+	const vec4 n0 = normals4[ indices[0] ];
+	const vec4 n1 = normals4[ indices[1] ];
+	const vec4 n2 = normals4[ indices[2] ];
+
+	triangle.n = 1.0 / 3.0 * (n0 + n1 + n2);
+	triangle.n.w = 1.0f;
+	normalize(triangle.n);
+
+	if (uv2 != nullptr)
+	{
+		triangle.uv0 = uv2[ indices[0] ];
+		triangle.uv1 = uv2[ indices[1] ];
+		triangle.uv2 = uv2[ indices[2] ];
+	}
+	else
+	{
+		memset( &triangle.uv0, 0, sizeof(vec2) * 3 );
+	}
+
+	memset( &triangle.temp, 0, sizeof(vec2) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SurfaceEmitterCache
+
+SurfaceEmitterCache::SurfaceEmitterCache()
+	: mValid(false)
+	, mFullUpload(false)
+{
+	memset( &mStats, 0, sizeof(SurfaceEmitterStats) );
+}
+
+void SurfaceEmitterCache::Invalidate()
+{
+	mValid = false;
+}
+
+void SurfaceEmitterCache::BuildTriangles(const int first, const int last, TTriangle *triangles) const
+{
+	const vec2 *uvs = (mUVs.empty()) ? nullptr : mUVs.data();
+
+	for (int i=first; i<last; ++i)
+		BuildTriangle(mPositions.data(), mNormals.data(), uvs, mIndices.data() + i * 3, triangles[i]);
+}
+
+bool SurfaceEmitterCache::Update(const int vertexCount, const float *positions, const float *normals, const float *uvs,
+	const int indexCount, const int *indices, std::vector<TTriangle> &triangles, const int numberOfThreads)
+{
+	mRanges.clear();
+	mFullUpload = false;
+
+	memset( &mStats, 0, sizeof(SurfaceEmitterStats) );
+
+	if (indexCount < 3 || vertexCount < 1)
+		return false;
+
+	const int triCount = indexCount / 3;
+
+	mStats.vertices = vertexCount;
+	mStats.triangles = triCount;
+
+	const vec4 *positions4 = (const vec4*) positions;
+	const vec4 *normals4 = (const vec4*) normals;
+	const vec2 *uv2 = (const vec2*) uvs;
+
+	// 1 - topology
+
+	const bool topologyChanged = (false == mValid)
+		|| (int) mPositions.size() != vertexCount
+		|| (int) mIndices.size() != triCount * 3
+		|| (int) triangles.size() != triCount
+		|| mUVs.empty() != (uvs == nullptr)
+		|| 0 != memcmp( mIndices.data(), indices, sizeof(int) * triCount * 3 );
+
+	if (topologyChanged)
+	{
+		mIndices.assign(indices, indices + triCount * 3);
+		mPositions.assign(positions4, positions4 + vertexCount);
+		mNormals.assign(normals4, normals4 + vertexCount);
+
+		if (uv2 != nullptr)
+			mUVs.assign(uv2, uv2 + vertexCount);
+		else
+			mUVs.clear();
+
+		triangles.resize(triCount);
+
+		ParallelFor( triCount, SURFACE_EMITTER_BLOCK_SIZE, [&] (const int first, const int last) {
+			BuildTriangles(first, last, triangles.data() );
+		}, numberOfThreads );
+
+		mValid = true;
+		mFullUpload = true;
+		mRanges.push_back(0);
+		mRanges.push_back(triCount);
+
+		mStats.topologyChanged = true;
+		mStats.changedVertices = vertexCount;
+		mStats.rebuiltTriangles = triCount;
+		mStats.uploadRanges = 1;
+		mStats.uploadBytes = sizeof(TTriangle) * triCount;
+
+		return true;
+	}
+
+	// 2 - deformation, vertices against the last update
+	// a single worker gets the whole range in one call, so blocks are the items of a loop
+
+	const int vertexBlocks = (vertexCount + SURFACE_EMITTER_BLOCK_SIZE - 1) / SURFACE_EMITTER_BLOCK_SIZE;
+	std::vector<int> blockCounts(vertexBlocks, 0);
+
+	mChangedVertices.resize(vertexCount);
+
+	ParallelFor( vertexBlocks, 1, [&] (const int firstBlock, const int lastBlock) {
+
+		for (int block=firstBlock; block<lastBlock; ++block)
+		{
+			const int first = block * SURFACE_EMITTER_BLOCK_SIZE;
+			const int last = std::min(first + SURFACE_EMITTER_BLOCK_SIZE, vertexCount);
+			int changed = 0;
+
+			for (int i=first; i<last; ++i)
+			{
+				bool isChanged = false;
+
+				if (0 != memcmp( &mPositions[i], positions4 + i, sizeof(vec4) ) )
+				{
+					mPositions[i] = positions4[i];
+					isChanged = true;
+				}
+				if (0 != memcmp( &mNormals[i], normals4 + i, sizeof(vec4) ) )
+				{
+					mNormals[i] = normals4[i];
+					isChanged = true;
+				}
+				if (uv2 != nullptr && 0 != memcmp( &mUVs[i], uv2 + i, sizeof(vec2) ) )
+				{
+					mUVs[i] = uv2[i];
+					isChanged = true;
+				}
+
+				mChangedVertices[i] = (isChanged) ? 1 : 0;
+				if (isChanged)
+					changed += 1;
+			}
+
+			blockCounts[block] = changed;
+		}
+	}, numberOfThreads );
+
+	for (int i=0; i<vertexBlocks; ++i)
+		mStats.changedVertices += blockCounts[i];
+
+	if (0 == mStats.changedVertices)
+		return false;
+
+	// 3 - triangles with a changed vertex
+
+	const int triangleBlocks = (triCount + SURFACE_EMITTER_BLOCK_SIZE - 1) / SURFACE_EMITTER_BLOCK_SIZE;
+	blockCounts.assign(triangleBlocks, 0);
+
+	mDirtyTriangles.resize(triCount);
+
+	ParallelFor( triangleBlocks, 1, [&] (const int firstBlock, const int lastBlock) {
+
+		const int *tri = mIndices.data();
+
+		for (int block=firstBlock; block<lastBlock; ++block)
+		{
+			const int first = block * SURFACE_EMITTER_BLOCK_SIZE;
+			const int last = std::min(first + SURFACE_EMITTER_BLOCK_SIZE, triCount);
+			int rebuilt = 0;
+
+			for (int i=first; i<last; ++i)
+			{
+				const char dirty = mChangedVertices[tri[i*3]] | mChangedVertices[tri[i*3+1]] | mChangedVertices[tri[i*3+2]];
+				mDirtyTriangles[i] = dirty;
+
+				if (dirty)
+				{
+					BuildTriangles(i, i+1, triangles.data() );
+					rebuilt += 1;
+				}
+			}
+
+			blockCounts[block] = rebuilt;
+		}
+	}, numberOfThreads );
+
+	for (int i=0; i<triangleBlocks; ++i)
+		mStats.rebuiltTriangles += blockCounts[i];
+
+	// 4 - upload ranges
+
+	int uploadCount = 0;
+
+	for (int i=0; i<triCount; ++i)
+	{
+		if (0 == mDirtyTriangles[i])
+			continue;
+
+		const size_t numberOfRanges = mRanges.size();
+
+		if (numberOfRanges > 0 && i - (mRanges[numberOfRanges-2] + mRanges[numberOfRanges-1]) <= SURFACE_EMITTER_RANGE_GAP)
+		{
+			const int count = i + 1 - mRanges[numberOfRanges-2];
+			uploadCount += count - mRanges[numberOfRanges-1];
+			mRanges[numberOfRanges-1] = count;
+		}
+		else
+		{
+			mRanges.push_back(i);
+			mRanges.push_back(1);
+			uploadCount += 1;
+		}
+	}
+
+	if (2 * uploadCount > triCount)
+	{
+		mRanges.resize(2);
+		mRanges[0] = 0;
+		mRanges[1] = triCount;
+
+		uploadCount = triCount;
+		mFullUpload = true;
+	}
+
+	mStats.uploadRanges = (int) mRanges.size() / 2;
+	mStats.uploadBytes = sizeof(TTriangle) * uploadCount;
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+
+void GPUParticles::SurfaceEmitterReference(const int vertexCount, const float *positions, const float *normals, const float *uvs,
+	const int indexCount, const int *indices, std::vector<TTriangle> &triangles)
+{
+	const int triCount = indexCount / 3;
+	triangles.resize(triCount);
+
+	for (int i=0; i<triCount; ++i)
+		BuildTriangle( (const vec4*) positions, (const vec4*) normals, (const vec2*) uvs, indices + i * 3, triangles[i] );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+
+struct BenchmarkSurface
+{
+	int						side;
+	std::vector<float>		positions;
+	std::vector<float>		normals;
+	std::vector<float>		uvs;
+	std::vector<int>		indices;
+};
+
+// a grid wrapped into a cylinder, a character like amount of vertices per triangle
+static void GenerateBenchmarkSurface(BenchmarkSurface &surface, const int numberOfTriangles)
+{
+	const int side = std::max(2, (int) sqrt(0.5 * numberOfTriangles) );
+	const int vertexCount = (side + 1) * (side + 1);
+
+	surface.side = side;
+	surface.positions.resize(vertexCount * 4);
+	surface.normals.resize(vertexCount * 4);
+	surface.uvs.resize(vertexCount * 2);
+	surface.indices.clear();
+
+	for (int j=0; j<=side; ++j)
+	{
+		for (int i=0; i<=side; ++i)
+		{
+			const int v = j * (side + 1) + i;
+			const float angle = 6.2831853f * (float) i / (float) side;
+
+			float *p = surface.positions.data() + v * 4;
+			p[0] = 10.0f * cosf(angle);
+			p[1] = 100.0f * (float) j / (float) side;
+			p[2] = 10.0f * sinf(angle);
+			p[3] = 1.0f;
+
+			float *n = surface.normals.data() + v * 4;
+			n[0] = cosf(angle);
+			n[1] = 0.0f;
+			n[2] = sinf(angle);
+			n[3] = 0.0f;
+
+			surface.uvs[v * 2] = (float) i / (float) side;
+			surface.uvs[v * 2 + 1] = (float) j / (float) side;
+		}
+	}
+
+	for (int j=0; j<side; ++j)
+	{
+		for (int i=0; i<side; ++i)
+		{
+			const int v = j * (side + 1) + i;
+			const int quad[6] = { v, v + 1, v + side + 2, v, v + side + 2, v + side + 1 };
+			surface.indices.insert( end(surface.indices), quad, quad + 6 );
+		}
+	}
+}
+
+// rows in [firstRow; lastRow) are pushed out along the normals
+static void DeformBenchmarkSurface(BenchmarkSurface &surface, const int firstRow, const int lastRow, const float amount)
+{
+	const int side = surface.side;
+
+	for (int j=firstRow; j<lastRow && j<=side; ++j)
+	{
+		for (int i=0; i<=side; ++i)
+		{
+			const int v = j * (side + 1) + i;
+			const float wave = amount * sinf(0.1f * (float) (i + j));
+
+			for (int k=0; k<3; ++k)
+				surface.positions[v * 4 + k] += wave * surface.normals[v * 4 + k];
+
+			surface.normals[v * 4 + 1] = 0.1f * wave;
+		}
+	}
+}
+
+static bool UpdateBenchmarkSurface(SurfaceEmitterCache &cache, const BenchmarkSurface &surface, std::vector<TTriangle> &triangles,
+	std::vector<TTriangle> &uploaded, const int numberOfThreads)
+{
+	const bool changed = cache.Update( (int) surface.positions.size() / 4, surface.positions.data(), surface.normals.data(),
+		surface.uvs.data(), (int) surface.indices.size(), surface.indices.data(), triangles, numberOfThreads );
+
+	// the same uploads as UploadSurfaceDataToGPU does
+	if (cache.IsFullUpload() )
+	{
+		uploaded = triangles;
+	}
+	else
+	{
+		const std::vector<int> &ranges = cache.GetUploadRanges();
+
+		for (size_t i=0; i<ranges.size(); i+=2)
+			memcpy( uploaded.data() + ranges[i], triangles.data() + ranges[i], sizeof(TTriangle) * ranges[i+1] );
+	}
+
+	return changed;
+}
+
+static bool SameTriangles(const std::vector<TTriangle> &a, const std::vector<TTriangle> &b)
+{
+	return a.size() == b.size() && 0 == memcmp( a.data(), b.data(), sizeof(TTriangle) * a.size() );
+}
+
+bool GPUParticles::SurfaceEmitterBenchmark(const int numberOfTriangles)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	bool result = true;
+
+	BenchmarkSurface			surface;
+	SurfaceEmitterCache			cache;
+	std::vector<TTriangle>		triangles;
+	std::vector<TTriangle>		uploaded;
+	std::vector<TTriangle>		reference;
+
+	auto fnReference = [&] () {
+		SurfaceEmitterReference( (int) surface.positions.size() / 4, surface.positions.data(), surface.normals.data(),
+			surface.uvs.data(), (int) surface.indices.size(), surface.indices.data(), reference );
+	};
+
+	// 1 - every kind of change against the reference, on one and on all threads
+
+	for (int numberOfThreads=1; numberOfThreads>=0; --numberOfThreads)
+	{
+		GenerateBenchmarkSurface(surface, 5000);
+		cache.Invalidate();
+
+		const int side = surface.side;
+
+		for (int step=0; step<6; ++step)
+		{
+			const char *name = "first";
+
+			if (step == 1)
+			{
+				name = "static";
+			}
+			else if (step == 2)
+			{
+				name = "local";
+				DeformBenchmarkSurface(surface, 10, 13, 0.5f);
+			}
+			else if (step == 3)
+			{
+				name = "two regions";
+				DeformBenchmarkSurface(surface, 1, 2, 0.5f);
+				DeformBenchmarkSurface(surface, side - 2, side, 0.5f);
+			}
+			else if (step == 4)
+			{
+				name = "full";
+				DeformBenchmarkSurface(surface, 0, side + 1, 0.25f);
+			}
+			else if (step == 5)
+			{
+				name = "topology";
+				std::swap(surface.indices[0], surface.indices[1]);
+			}
+
+			const bool changed = UpdateBenchmarkSurface(cache, surface, triangles, uploaded, numberOfThreads);
+			const SurfaceEmitterStats stats = cache.GetStats();
+			fnReference();
+
+			bool passed = SameTriangles(triangles, reference) && SameTriangles(uploaded, reference);
+
+			if (step == 0 || step == 5)
+				passed = passed && changed && stats.topologyChanged;
+			else if (step == 1)
+				passed = passed && false == changed && stats.rebuiltTriangles == 0 && stats.uploadBytes == 0;
+			else if (step == 2 || step == 3)
+				passed = passed && changed && false == stats.topologyChanged && stats.rebuiltTriangles < stats.triangles
+					&& false == cache.IsFullUpload();
+			else
+				passed = passed && changed && stats.rebuiltTriangles == stats.triangles && cache.IsFullUpload();
+
+			if (false == passed)
+			{
+				printf( "[GPU Particles] surface emitter - %s update on %d threads differs from the reference\n", name, numberOfThreads );
+				result = false;
+			}
+		}
+	}
+
+	// 2 - timing, the whole surface is built every time without a cache
+
+	GenerateBenchmarkSurface(surface, numberOfTriangles);
+	const int side = surface.side;
+
+	printf( "[GPU Particles] surface emitter benchmark, %d threads, %d triangles, time per update\n",
+		ParallelForThreadCount(), (int) surface.indices.size() / 3 );
+	printf( "[GPU Particles] %10s | %10s | %10s %10s %7s %12s\n", "update", "ms", "vertices", "triangles", "ranges", "upload KB" );
+
+	auto startTime = clock::now();
+	fnReference();
+	const double referenceMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+	printf( "[GPU Particles] %10s | %10.2f | %10d %10d %7d %12d\n", "rebuild", referenceMs, (int) surface.positions.size() / 4,
+		(int) reference.size(), 1, (int) (sizeof(TTriangle) * reference.size() / 1024) );
+
+	cache.Invalidate();
+
+	for (int step=0; step<4; ++step)
+	{
+		const char *name = "topology";
+
+		if (step == 1)
+		{
+			name = "static";
+		}
+		else if (step == 2)
+		{
+			name = "local";
+			DeformBenchmarkSurface(surface, side / 2, side / 2 + std::max(1, side / 50), 0.5f);
+		}
+		else if (step == 3)
+		{
+			name = "deformed";
+			DeformBenchmarkSurface(surface, 0, side + 1, 0.25f);
+		}
+
+		startTime = clock::now();
+		UpdateBenchmarkSurface(cache, surface, triangles, uploaded, 0);
+		const double updateMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+		const SurfaceEmitterStats stats = cache.GetStats();
+
+		fnReference();
+		if (false == SameTriangles(uploaded, reference) )
+			result = false;
+
+		printf( "[GPU Particles] %10s | %10.2f | %10d %10d %7d %12d\n", name, updateMs, stats.changedVertices,
+			stats.rebuiltTriangles, stats.uploadRanges, (int) (stats.uploadBytes / 1024) );
+	}
+
+	printf( "[GPU Particles] surface emitter benchmark %s\n", (result) ? "passed" : "FAILED" );
+	return result;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: ParticleSystem_SurfaceEmitter.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "ParticleSystem_types.h"
+#include <vector>
+
+/*
+	Incremental update of the emitter surface on CPU
+
+	topology (vertex count and indices) and deformation (positions, normals, uvs) are tracked apart.
+	 Indices are compared with a copy of the last update, a new topology rebuilds all triangles.
+	 Otherwise vertices are compared with their copies in parallel and only triangles with a changed
+	 vertex are built again.
+
+	Rebuilt triangles are merged into ranges for glBufferSubData, close ranges go together (a gap is
+	 cheaper than one more call), a full upload is used when most of the surface is changed.
+*/
+
+#define SURFACE_EMITTER_BLOCK_SIZE			16384
+#define SURFACE_EMITTER_RANGE_GAP			256			// triangles between ranges to merge them
+
+namespace GPUParticles
+{
+
+struct SurfaceEmitterStats
+{
+	int			vertices;
+	int			triangles;
+	bool		topologyChanged;	// triangles were built from scratch
+	int			changedVertices;
+	int			rebuiltTriangles;
+	int			uploadRanges;
+	size_t		uploadBytes;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class SurfaceEmitterCache
+{
+public:
+
+	//! a constructor
+	SurfaceEmitterCache();
+
+	//! next update builds all triangles and uploads the whole buffer
+	void Invalidate();
+
+	/*! update triangles from the model arrays, returns true when anything is changed
+		\param positions, normals - vec4 per vertex
+		\param uvs - vec2 per vertex, could be nullptr
+	*/
+	bool Update(const int vertexCount, const float *positions, const float *normals, const float *uvs,
+		const int indexCount, const int *indices, std::vector<TTriangle> &triangles, const int numberOfThreads=0);
+
+	//! the whole triangles buffer has to be uploaded
+	bool IsFullUpload() const {
+		return mFullUpload;
+	}
+	//! pairs of the first triangle and a count
+	const std::vector<int> &GetUploadRanges() const {
+		return mRanges;
+	}
+
+	const SurfaceEmitterStats &GetStats() const { return mStats; }
+
+protected:
+
+	bool							mValid;
+	bool							mFullUpload;
+	SurfaceEmitterStats				mStats;
+
+	std::vector<int>				mIndices;			// topology of the last update
+	std::vector<vec4>				mPositions;			// vertices of the last update
+	std::vector<vec4>				mNormals;
+	std::vector<vec2>				mUVs;
+
+	std::vector<char>				mChangedVertices;
+	std::vector<char>				mDirtyTriangles;
+	std::vector<int>				mRanges;
+
+	void BuildTriangles(const int first, const int last, TTriangle *triangles) const;
+};
+
+//! triangles of the whole surface, the same data as SurfaceEmitterCache gives
+void SurfaceEmitterReference(const int vertexCount, const float *positions, const float *normals, const float *uvs,
+	const int indexCount, const int *indices, std::vector<TTriangle> &triangles);
+
+//! incremental triangles and uploaded ranges against the reference for static, local, full deformation and
+//!  a new topology, timing of every case, prints results into the log
+bool SurfaceEmitterBenchmark(const int numberOfTriangles);
+
+};
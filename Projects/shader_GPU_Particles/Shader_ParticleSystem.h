@@ -99,6 +99,7 @@ public:
 	static bool SetShaderEffectLocation(const char *effectLocation, const int effectStrLen);
 	static bool SetComputeShaderLocation(const char *shaderLocation, const int shaderStrLen);
 	static bool SetComputeSelfCollisionsShaderLocation(const char *shaderLocation, const int shaderStrLen);
+	static bool SetComputeDepthSortShaderLocation(const char *shaderLocation, const int shaderStrLen);
 	static bool SetComputeIntegrateLocation(const char *shaderLocation, const int shaderStrLen);
 	static bool SetComputeSurfaceDataPath(const char *path, const int pathLen);
 	bool Initialize();
@@ -116,9 +117,16 @@ public:
 	void	UnBindSimulation();
 
 	void	BindSelfCollisions();
-	void	DispatchSelfCollisions(const float dt, const int size, const int group_x, const int group_y, const int group_z);
+	// grid buffers are bound to 4-7, binning passes and a contact pass, see ParticleSystem_SelfCollisions.h
+	void	DispatchSelfCollisions(const float dt, const int size, const int numberOfCells, const int group_x, const int group_y, const int group_z);
 	void	UnBindSelfCollisions();
 
+	void	BindDepthSort();
+	// order buffer is bound to 1, keys, values, histograms and control buffers to 4-7, see ParticleSystem_DepthSort.h
+	//  viewRow is a third row of the model view matrix, control buffer holds indirect arguments of the radix passes
+	void	DispatchDepthSort(const int size, const int prevCount, const vec4 &viewRow, const GLuint controlBuffer);
+	void	UnBindDepthSort();
+
 	void	BindIntegrate();
 	void	DispatchIntegrate(const float dt, const int size, const int group_x, const int group_y, const int group_z);
 	void	UnBindIntegrate();
@@ -264,6 +272,18 @@ protected:
 
 	GLint				locSelfCollisionsDeltaTime;
 	GLint				locSelfCollisionsNumParticles;
+	GLint				locSelfCollisionsPass;
+	GLint				locSelfCollisionsNumCells;
+
+	//
+	// depth sort compute shader
+	GLuint				programDepthSort;
+
+	GLint				locDepthSortNumParticles;
+	GLint				locDepthSortPrevCount;
+	GLint				locDepthSortViewRow;
+	GLint				locDepthSortPass;
+	GLint				locDepthSortShift;
 
 	//
 	// euler integration compute shader
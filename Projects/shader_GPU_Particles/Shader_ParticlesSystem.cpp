@@ -12,6 +12,8 @@
 
 
 #include "Shader_ParticleSystem.h"
+#include "ParticleSystem_SelfCollisions.h"
+#include "ParticleSystem_DepthSort.h"
 #include "graphics\CheckGLError.h"
 
 #include <iostream>
@@ -29,6 +31,9 @@ int					fx_computeStrLen;
 char				fx_computeSelfCollisionsLocation[256];
 int					fx_computeSelfCollisionsStrLen;
 
+char				fx_computeDepthSortLocation[256];
+int					fx_computeDepthSortStrLen;
+
 char				fx_integrateLocation[256];
 int					fx_integrateStrLen;
 
@@ -120,6 +125,12 @@ ParticleShaderFX::ParticleShaderFX()
 
 	//shaderSelfCollisions = 0;
 	programSelfCollisions = 0;
+	locSelfCollisionsPass = -1;
+	locSelfCollisionsNumCells = -1;
+
+	programDepthSort = 0;
+	locDepthSortPass = -1;
+	locDepthSortShift = -1;
 
 	programIntegrate = 0;
 
@@ -161,6 +172,14 @@ bool ParticleShaderFX::SetComputeSelfCollisionsShaderLocation(const char *shader
 	return (fx_computeSelfCollisionsStrLen > 0);
 }
 
+bool ParticleShaderFX::SetComputeDepthSortShaderLocation(const char *shaderLocation, const int shaderLen)
+{
+	memcpy_s( fx_computeDepthSortLocation, sizeof(char)*256, shaderLocation, shaderLen );
+	fx_computeDepthSortStrLen = shaderLen;
+
+	return (fx_computeDepthSortStrLen > 0);
+}
+
 bool ParticleShaderFX::SetComputeIntegrateLocation(const char *shaderLocation, const int shaderLen)
 {
 	memcpy_s( fx_integrateLocation, sizeof(char)*256, shaderLocation, shaderLen );
@@ -231,7 +250,22 @@ bool ParticleShaderFX::Initialize()
 	
 		locSelfCollisionsNumParticles = glGetUniformLocation(programSelfCollisions, "gNumParticles");
 		locSelfCollisionsDeltaTime = glGetUniformLocation(programSelfCollisions, "DeltaTimeSecs");
+		locSelfCollisionsPass = glGetUniformLocation(programSelfCollisions, "gPass");
+		locSelfCollisionsNumCells = glGetUniformLocation(programSelfCollisions, "gNumCells");
 	
+		// depth sort shader
+		programDepthSort = loadComputeShader(fx_computeDepthSortLocation);
+
+		if ( 0 == programDepthSort )
+			throw std::exception( "failed to load particles depth sort shader" );
+
+		locDepthSortNumParticles = glGetUniformLocation(programDepthSort, "gNumParticles");
+		locDepthSortPrevCount = glGetUniformLocation(programDepthSort, "gPrevCount");
+		locDepthSortViewRow = glGetUniformLocation(programDepthSort, "gViewRow");
+		locDepthSortPass = glGetUniformLocation(programDepthSort, "gPass");
+		locDepthSortShift = glGetUniformLocation(programDepthSort, "gShift");
+
+
 		// integrate shader
 		programIntegrate = loadComputeShader(fx_integrateLocation);
 
@@ -307,6 +341,12 @@ void ParticleShaderFX::clearResources()
 		shaderSelfCollisions = 0;
 	}
 	*/
+	if (programDepthSort)
+	{
+		glDeleteProgram(programDepthSort);
+		programDepthSort = 0;
+	}
+
 	if (programIntegrate)
 	{
 		glDeleteProgram(programIntegrate);
@@ -672,15 +712,29 @@ void ParticleShaderFX::BindSelfCollisions()
 
 }
 
-void ParticleShaderFX::DispatchSelfCollisions(const float dt, const int size, const int group_x, const int group_y, const int group_z)
+void ParticleShaderFX::DispatchSelfCollisions(const float dt, const int size, const int numberOfCells, const int group_x, const int group_y, const int group_z)
 {
 	if (programSelfCollisions > 0)
 	{
 		glUniform1f( locSelfCollisionsDeltaTime, dt );
 		glUniform1i( locSelfCollisionsNumParticles, size );
+		glUniform1i( locSelfCollisionsNumCells, numberOfCells );
 
-		//
-		glDispatchCompute( (size / group_x) + 1, group_y, group_z );
+		const int particleGroups = (size / group_x) + 1;
+		const int cellGroups = (numberOfCells / group_x) + 1;
+
+		// clear, bounds, count, scan blocks, scan sums, add sums, scatter, collide
+		const int passGroups[8] = { cellGroups, particleGroups, particleGroups, numberOfCells / SELF_COLLISIONS_SCAN_BLOCK, 1, 
+			cellGroups, particleGroups, particleGroups };
+
+		for (int pass=0; pass<8; ++pass)
+		{
+			glUniform1i( locSelfCollisionsPass, pass );
+			glDispatchCompute( passGroups[pass], group_y, group_z );
+
+			if (pass < 7)
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
 	}
 
 }
@@ -691,6 +745,81 @@ void ParticleShaderFX::UnBindSelfCollisions()
 		glUseProgram(0);
 }
 
+void ParticleShaderFX::BindDepthSort()
+{
+	if (programDepthSort > 0)
+	{
+		glUseProgram(programDepthSort);
+	}
+
+}
+
+void ParticleShaderFX::DispatchDepthSort(const int size, const int prevCount, const vec4 &viewRow, const GLuint controlBuffer)
+{
+	if (programDepthSort > 0 && size > 0)
+	{
+		glUniform1i( locDepthSortNumParticles, size );
+		glUniform1i( locDepthSortPrevCount, prevCount );
+		glUniform4f( locDepthSortViewRow, viewRow.x, viewRow.y, viewRow.z, viewRow.w );
+
+		// byte offsets of dispatch arguments in the ControlBuffer of Particles_sort.cs
+		const GLintptr histogramArgs = 16;
+		const GLintptr scanArgs = 28;
+		const GLintptr addArgs = 40;
+		const GLintptr scatterArgs = 52;
+
+		const int particleGroups = (size + DEPTH_SORT_GROUP_SIZE - 1) / DEPTH_SORT_GROUP_SIZE;
+		const GLbitfield barriers = GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT;
+
+		auto fnDispatch = [&] (const int pass, const int groups) {
+			glUniform1i( locDepthSortPass, pass );
+			glDispatchCompute( groups, 1, 1 );
+			glMemoryBarrier(barriers);
+		};
+
+		auto fnDispatchIndirect = [&] (const int pass, const GLintptr offset) {
+			glUniform1i( locDepthSortPass, pass );
+			glDispatchComputeIndirect( offset );
+			glMemoryBarrier(barriers);
+		};
+
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, controlBuffer);
+
+		// keys, gather in the previous order, decide
+		fnDispatch( 0, particleGroups );
+		fnDispatch( 1, particleGroups );
+		fnDispatch( 2, 1 );
+
+		for (int pass=0; pass<DEPTH_SORT_PASSES; ++pass)
+		{
+			glUniform1i( locDepthSortShift, pass * DEPTH_SORT_RADIX_BITS );
+
+			// histogram, check, scan blocks, scan sums, add sums, scatter, flip
+			fnDispatchIndirect( 3, histogramArgs );
+			fnDispatch( 4, 1 );
+			fnDispatchIndirect( 5, scanArgs );
+			fnDispatch( 6, 1 );
+			fnDispatchIndirect( 7, addArgs );
+			fnDispatchIndirect( 8, scatterArgs );
+			fnDispatch( 9, 1 );
+		}
+
+		// output into the order buffer
+		glUniform1i( locDepthSortPass, 10 );
+		glDispatchCompute( particleGroups, 1, 1 );
+		glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT);
+
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	}
+
+}
+
+void ParticleShaderFX::UnBindDepthSort()
+{
+	if (programDepthSort > 0)
+		glUseProgram(0);
+}
+
 void ParticleShaderFX::BindIntegrate()
 {
 	if (programIntegrate > 0)
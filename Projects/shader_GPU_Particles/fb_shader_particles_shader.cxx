@@ -26,6 +26,8 @@
 #include <Windows.h>
 
 #include <limits.h>
+#include <string>
+#include <algorithm>
 
 #include "algorithm\math3d.h"
 #include "algorithm\math3d_mobu.h"
@@ -39,6 +41,9 @@
 #include "model_collision_terrain.h"
 
 #include "mographics_common.h"
+#include "ParticleSystem_SelfCollisions.h"
+#include "ParticleSystem_DepthSort.h"
+#include "ParticleSystem_SurfaceEmitter.h"
 
 //--- Registration defines
 #define ORSHADER_TEMPLATE__CLASS		ORSHADER_TEMPLATE__CLASSNAME
@@ -94,6 +99,121 @@ void GPUshader_Particles::ResetAllAction(HIObject pObject, bool value)
 	if (value && p)	p->DoResetAll();
 }
 
+void GPUshader_Particles::SelfCollisionsBenchmarkAction(HIObject pObject, bool value) 
+{
+	if (value)
+		SelfCollisionsBenchmark(1048576);
+}
+
+void GPUshader_Particles::DepthSortBenchmarkAction(HIObject pObject, bool value) 
+{
+	if (value)
+		DepthSortBenchmark(1048576);
+}
+
+void GPUshader_Particles::SurfaceEmitterBenchmarkAction(HIObject pObject, bool value) 
+{
+	if (value)
+		SurfaceEmitterBenchmark(200000);
+}
+
+int GPUshader_Particles::GetSurfaceRebuiltTriangles(HIObject pObject)
+{
+	GPUshader_Particles *p = FBCast<GPUshader_Particles>(pObject);
+	int count = 0;
+
+	if (nullptr != p)
+	{
+		for (auto iter=begin(p->mParticleMap); iter!=end(p->mParticleMap); ++iter)
+			count += iter->second->GetSurfaceStats().rebuiltTriangles;
+	}
+	return count;
+}
+
+int GPUshader_Particles::GetSurfaceUploaded(HIObject pObject)
+{
+	GPUshader_Particles *p = FBCast<GPUshader_Particles>(pObject);
+	size_t bytes = 0;
+
+	if (nullptr != p)
+	{
+		for (auto iter=begin(p->mParticleMap); iter!=end(p->mParticleMap); ++iter)
+			bytes += iter->second->GetSurfaceStats().uploadBytes;
+	}
+	return (int) (bytes / 1024);
+}
+
+void GPUshader_Particles::BakeCacheAction(HIObject pObject, bool value) 
+{
+	GPUshader_Particles *p = FBCast<GPUshader_Particles>(pObject);
+	if (value && p)	p->DoBakeCache();
+}
+
+void GPUshader_Particles::ClearCacheAction(HIObject pObject, bool value) 
+{
+	GPUshader_Particles *p = FBCast<GPUshader_Particles>(pObject);
+	if (value && p)	p->DoClearCache();
+}
+
+void GPUshader_Particles::CacheBenchmarkAction(HIObject pObject, bool value) 
+{
+	if (value)
+	{
+		char folder[MAX_PATH];
+		const DWORD len = GetTempPathA(MAX_PATH, folder);
+
+		if (len > 0 && len < MAX_PATH)
+		{
+			// without the last separator
+			if (folder[len-1] == '\\' || folder[len-1] == '/')
+				folder[len-1] = 0;
+
+			ParticleCacheBenchmark(folder, 1048576, 30);
+		}
+	}
+}
+
+int GPUshader_Particles::GetCacheFrames(HIObject pObject)
+{
+	GPUshader_Particles *p = FBCast<GPUshader_Particles>(pObject);
+	int count = 0;
+
+	if (nullptr != p)
+	{
+		for (auto iter=begin(p->mCacheMap); iter!=end(p->mCacheMap); ++iter)
+			count = std::max(count, iter->second->reader.GetNumberOfFrames() );
+	}
+	return count;
+}
+
+double GPUshader_Particles::GetCacheFPS(HIObject pObject)
+{
+	GPUshader_Particles *p = FBCast<GPUshader_Particles>(pObject);
+
+	if (nullptr != p)
+	{
+		for (auto iter=begin(p->mCacheMap); iter!=end(p->mCacheMap); ++iter)
+		{
+			if (iter->second->reader.IsOpen() )
+				return iter->second->reader.GetFPS();
+		}
+	}
+	return 0.0;
+}
+
+int GPUshader_Particles::GetCacheMemoryUsed(HIObject pObject)
+{
+	GPUshader_Particles *p = FBCast<GPUshader_Particles>(pObject);
+	size_t memory = 0;
+
+	if (nullptr != p)
+	{
+		for (auto iter=begin(p->mCacheMap); iter!=end(p->mCacheMap); ++iter)
+			memory += iter->second->reader.GetMemoryUsed();
+	}
+	return (int) (memory / (1024 * 1024));
+}
+
 void GPUshader_Particles::SetColorCurve(HIObject pObject, bool value) 
 {
 	GPUshader_Particles *p = FBCast<GPUshader_Particles>(pObject);
@@ -159,6 +279,10 @@ void GPUshader_Particles::AddPropertiesToPropertyViewManager()
 	AddPropertyViewForParticles("Play Mode", "");
 	AddPropertyViewForParticles("Emitter", "");
 	AddPropertyViewForParticles("Inherit Emitter Colors", "");
+	AddPropertyViewForParticles("Surface Update On CPU", "");
+	AddPropertyViewForParticles("Surface Rebuilt Triangles", "");
+	AddPropertyViewForParticles("Surface Uploaded (KB)", "");
+	AddPropertyViewForParticles("Surface Emitter Benchmark", "");
 
 	//
 	AddPropertyViewForParticles("Evaluation parameters", "", true);
@@ -166,6 +290,7 @@ void GPUshader_Particles::AddPropertiesToPropertyViewManager()
 	AddPropertyViewForParticles("Delta Time Limit", "Evaluation parameters");
 	AddPropertyViewForParticles("Adaptive SubSteps", "Evaluation parameters");
 	AddPropertyViewForParticles("SubSteps", "Evaluation parameters");
+	AddPropertyViewForParticles("Self Collisions Benchmark", "Evaluation parameters");
 
 	// folder Particle generation
 	AddPropertyViewForParticles("Reset", "");
@@ -251,6 +376,8 @@ void GPUshader_Particles::AddPropertiesToPropertyViewManager()
 	AddPropertyViewForParticles("Affecting Lights", "Particle visualization");
 	AddPropertyViewForParticles("Transparency", "Particle visualization");
 	AddPropertyViewForParticles("Transparency Factor", "Particle visualization");
+	AddPropertyViewForParticles("Depth Sort", "Particle visualization");
+	AddPropertyViewForParticles("Depth Sort Benchmark", "Particle visualization");
 	
 	AddPropertyViewForParticles("Particle visualization.Particle Color", "Particle visualization", true);
 	AddPropertyViewForParticles("Color", "Particle visualization.Particle Color");
@@ -272,6 +399,18 @@ void GPUshader_Particles::AddPropertiesToPropertyViewManager()
 
 	AddPropertyViewForParticles("Use Size Curve", "Particle visualization.Particle Size");
 	AddPropertyViewForParticles("Size Curve", "Particle visualization.Particle Size");
+
+	//
+	AddPropertyViewForParticles("Particle cache", "", true);
+	AddPropertyViewForParticles("Use Cache", "Particle cache");
+	AddPropertyViewForParticles("Cache File", "Particle cache");
+	AddPropertyViewForParticles("Bake Cache", "Particle cache");
+	AddPropertyViewForParticles("Clear Cache", "Particle cache");
+	AddPropertyViewForParticles("Cache Frames", "Particle cache");
+	AddPropertyViewForParticles("Cache FPS", "Particle cache");
+	AddPropertyViewForParticles("Frames In Memory", "Particle cache");
+	AddPropertyViewForParticles("Cache Memory Used (MB)", "Particle cache");
+	AddPropertyViewForParticles("Cache Benchmark", "Particle cache");
 }
 
 /************************************************
@@ -293,6 +432,10 @@ bool GPUshader_Particles::FBCreate()
 	mLastResetState = false;
 	mLastResetAllState = false;
 
+	mIsBaking = false;
+	mBakeFrame = 0;
+	mBakeStopFrame = 0;
+
 	SetShaderCapacity( kFBShaderCapacityMaterialEffect, false );
 
 
@@ -322,6 +465,10 @@ bool GPUshader_Particles::FBCreate()
 
 	FBPropertyPublish( this, Emitter, "Emitter", nullptr, SetEmitterProperty );
 	FBPropertyPublish( this, InheritEmitterColors, "Inherit Emitter Colors", nullptr, nullptr );
+	FBPropertyPublish( this, SurfaceUpdateOnCPU, "Surface Update On CPU", nullptr, nullptr );
+	FBPropertyPublish( this, SurfaceRebuiltTriangles, "Surface Rebuilt Triangles", GetSurfaceRebuiltTriangles, nullptr );
+	FBPropertyPublish( this, SurfaceUploaded, "Surface Uploaded (KB)", GetSurfaceUploaded, nullptr );
+	FBPropertyPublish( this, SurfaceEmitterBenchmark, "Surface Emitter Benchmark", nullptr, SurfaceEmitterBenchmarkAction );
 	FBPropertyPublish( this, PlayMode, "Play Mode", nullptr, nullptr );
 
 	FBPropertyPublish( this, RandomSeed, "Random Seed", nullptr, nullptr );
@@ -364,6 +511,7 @@ bool GPUshader_Particles::FBCreate()
 	FBPropertyPublish( this, UseCollisions, "Use Collisions", nullptr, nullptr );
 	FBPropertyPublish( this, Collisions, "Collisions", nullptr, nullptr );
 	FBPropertyPublish( this, SelfCollisions, "Self Collisions", nullptr, nullptr );
+	FBPropertyPublish( this, SelfCollisionsBenchmark, "Self Collisions Benchmark", nullptr, SelfCollisionsBenchmarkAction );
 
 	FBPropertyPublish( this, UseTurbulence, "Use Turbulence", nullptr, nullptr );
 	FBPropertyPublish( this, NoiseFrequency, "Noise Frequency", nullptr, nullptr );
@@ -389,6 +537,14 @@ bool GPUshader_Particles::FBCreate()
 	DisplayedCount = 0;
 	DisplayedCount.ModifyPropertyFlag( kFBPropertyFlagReadOnly, true );
 
+	UseCache = false;
+	CacheFile = "";
+	CacheFrames.ModifyPropertyFlag( kFBPropertyFlagReadOnly, true );
+	CacheFPS.ModifyPropertyFlag( kFBPropertyFlagReadOnly, true );
+	FrameInMemory = 8;
+	FrameInMemory.SetMinMax(2.0, 256.0, true, true);
+	MemoryUsed.ModifyPropertyFlag( kFBPropertyFlagReadOnly, true );
+
 	
 	MaximumParticles = 1024*1024;
 	ResetCount = 0;			// total amount of particles in a frame
@@ -413,6 +569,9 @@ bool GPUshader_Particles::FBCreate()
 
 	InheritEmitterColors = true;
 	Emitter = kFBParticleEmitterVertices;
+	SurfaceUpdateOnCPU = false;
+	SurfaceRebuiltTriangles.ModifyPropertyFlag( kFBPropertyFlagReadOnly, true );
+	SurfaceUploaded.ModifyPropertyFlag( kFBPropertyFlagReadOnly, true );
 	PlayMode = kFBParticleLife;
 
 	ResetTime = FBTime(0);
@@ -500,6 +659,10 @@ bool GPUshader_Particles::FBCreate()
     TransparencyFactor.SetMinMax(0.0, 100.0, true, true);
     TransparencyFactor = 100.0;
 
+	FBPropertyPublish( this, DepthSort, "Depth Sort", nullptr, nullptr );
+	FBPropertyPublish( this, DepthSortBenchmark, "Depth Sort Benchmark", nullptr, DepthSortBenchmarkAction );
+	DepthSort = false;
+
 	FBPropertyPublish( this, Color, "Color", nullptr, nullptr );
 	FBPropertyPublish( this, ColorVariation, "Color Variation (%)", nullptr, nullptr );
 	FBPropertyPublish( this, UseColor2, "Use Color 2", nullptr, nullptr );
@@ -521,6 +684,16 @@ bool GPUshader_Particles::FBCreate()
 	FBPropertyPublish( this, SizeCurve, "Size Curve", nullptr, SetSizeCurve );
 	FBPropertyPublish( this, SizeCurveHolder, "SizeCurveHolder", nullptr, nullptr );
 
+	FBPropertyPublish( this, UseCache, "Use Cache", nullptr, nullptr );
+	FBPropertyPublish( this, CacheFile, "Cache File", nullptr, nullptr );
+	FBPropertyPublish( this, CacheTimeRange, "Bake Cache", nullptr, BakeCacheAction );
+	FBPropertyPublish( this, ClearCache, "Clear Cache", nullptr, ClearCacheAction );
+	FBPropertyPublish( this, CacheFrames, "Cache Frames", GetCacheFrames, nullptr );
+	FBPropertyPublish( this, CacheFPS, "Cache FPS", GetCacheFPS, nullptr );
+	FBPropertyPublish( this, FrameInMemory, "Frames In Memory", nullptr, nullptr );
+	FBPropertyPublish( this, MemoryUsed, "Cache Memory Used (MB)", GetCacheMemoryUsed, nullptr );
+	FBPropertyPublish( this, CacheBenchmark, "Cache Benchmark", nullptr, CacheBenchmarkAction );
+
 	PointSmooth = true;
 	PointFalloff = false;
 	PrimitiveType = kFBParticlePoints;
@@ -595,6 +768,7 @@ void GPUshader_Particles::FBDestroy()
 {
 	mSystem.OnVideoFrameRendering.Remove(this, (FBCallback) &GPUshader_Particles::OnVideoFrameRendering);
 
+	FreeCache();
 	FreeParticles();
 }
 
@@ -681,6 +855,13 @@ void GPUshader_Particles::DestroyShaderModelInfo( FBRenderOptions* pOptions, FBS
 		delete pParticles;
 		mParticleMap.erase(iter);
 	}
+
+	auto cacheIter = mCacheMap.find(pModel);
+	if (cacheIter != end(mCacheMap) )
+	{
+		delete cacheIter->second;
+		mCacheMap.erase(cacheIter);
+	}
 	/*
 	auto lastFrameTimeIter = mLastFrameTimeMap.find(pModel);
 	if (lastFrameTimeIter != end(mLastFrameTimeMap) )
@@ -901,6 +1082,12 @@ void GPUshader_Particles::ShaderBeginRender( FBRenderOptions* pRenderOptions, FB
 		}
 
 	}
+
+	if (mIsBaking)
+	{
+		FBTime localTime(mSystem.LocalTime);
+		StepBake( localTime.GetFrame() );
+	}
 }
 
 
@@ -1001,6 +1188,13 @@ void GPUshader_Particles::LocalShaderBeginRender( FBRenderOptions* pRenderOption
 	*/
 	auto pParticles = particleIter->second;
 
+	// cached frames replace the simulation, it starts from a reset outside of the cache
+	if (true == UseCache && false == mIsBaking)
+	{
+		if (LoadCachedFrame(pModel, pParticles, mSystem.LocalTime) )
+			return;
+	}
+
 	//
 	// do we need to update surface data ?! - update once per model
 	FBTime currTimelineTime = FBGetDisplayInfo()->GetLocalTime(); // mSystem.LocalTime;
@@ -1029,11 +1223,14 @@ void GPUshader_Particles::LocalShaderBeginRender( FBRenderOptions* pRenderOption
 
 	if (true == needToUpdateEmitter)
 	{
-		UpdateEmitterGeometryBufferOnGPU(pModel, pParticles);
+		if (SurfaceUpdateOnCPU)
+			UpdateEmitterGeometryBufferOnCPU(pModel, pParticles);
+		else
+			UpdateEmitterGeometryBufferOnGPU(pModel, pParticles);
 	}
 
 	//
-	const bool isPlayMode = (kFBParticlePlay == PlayMode || true == pRenderOptions->IsOfflineRendering());
+	const bool isPlayMode = (kFBParticlePlay == PlayMode || true == mIsBaking || true == pRenderOptions->IsOfflineRendering());
 
 	//
 	bool enableEmit = true;
@@ -1207,6 +1404,11 @@ void GPUshader_Particles::LocalShaderBeginRender( FBRenderOptions* pRenderOption
 		pParticles->mPerModelUserData.lastFrameTime = lastFrameTime;
 	}
 
+	if (true == mIsBaking && lFrame == mBakeFrame)
+	{
+		WriteCachedFrame(pModel, pParticles, lFrame);
+	}
+
 	CHECK_GL_ERROR();
 #ifdef _DEBUG
 	printf("[ShaderBeginRender] END...\n" );
@@ -1372,7 +1574,10 @@ void GPUshader_Particles::LocalShadeModel( FBRenderOptions* pRenderOptions, FBMo
 	}
 
 	if (true == ready)
-		pParticles->RenderParticles(PrimitiveType, PointSmooth, PointFalloff);
+	{
+		const bool depthSort = (true == DepthSort && kFBAlphaSourceNoAlpha != GetTransparencyType() );
+		pParticles->RenderParticles(PrimitiveType, PointSmooth, PointFalloff, depthSort);
+	}
 
 	glPopClientAttrib();
 	CHECK_GL_ERROR();
@@ -1782,6 +1987,9 @@ void GPUshader_Particles::UpdateEmitterGeometryBufferOnCPU(FBModel *pModel, Part
 {
 	FBModelVertexData *pVertexData = pModel->ModelVertexData;
 
+	if (nullptr == pVertexData)
+		return;
+
 	pVertexData->VertexArrayMappingRequest();
 
 	unsigned int vertexCount = pVertexData->GetVertexCount();
@@ -2001,6 +2209,230 @@ void GPUshader_Particles::UpdateEvaluationData(FBModel *pModel, ParticleSystem *
 	data.gGenerateOnMotionLimit = (true == GenerateOnMotion) ? (float) motionFactor : -1.0f;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// particle cache
+
+void GPUshader_Particles::GetCacheFileName(FBModel *pModel, FBString &filename)
+{
+	FBString cacheFile = CacheFile;
+	std::string base( (const char*) cacheFile );
+
+	if (base.empty() )
+	{
+		filename = "";
+		return;
+	}
+
+	// every emitter model has an own file
+	const std::string ext(".pcache");
+	if (base.size() > ext.size() && 0 == _stricmp(base.c_str() + base.size() - ext.size(), ext.c_str()) )
+		base.resize(base.size() - ext.size() );
+
+	std::string modelName( (const char*) pModel->Name );
+	std::replace( begin(modelName), end(modelName), ':', '_' );
+
+	base = base + "_" + modelName + ext;
+	filename = base.c_str();
+}
+
+GPUshader_Particles::CacheData *GPUshader_Particles::FindCacheData(FBModel *pModel)
+{
+	CacheData *pData = nullptr;
+
+	auto iter = mCacheMap.find(pModel);
+	if (iter == end(mCacheMap) )
+	{
+		pData = new CacheData();
+		pData->isOpenTried = false;
+		pData->lastFrame = 0;
+		mCacheMap[pModel] = pData;
+	}
+	else
+	{
+		pData = iter->second;
+	}
+
+	FBString filename;
+	GetCacheFileName(pModel, filename);
+
+	// cache file property was changed
+	if (0 != strcmp(pData->filename, filename) )
+	{
+		pData->reader.Close();
+		pData->isOpenTried = false;
+		pData->filename = filename;
+	}
+
+	return pData;
+}
+
+bool GPUshader_Particles::LoadCachedFrame(FBModel *pModel, ParticleSystem *pParticles, const FBTime &localTime)
+{
+	CacheData *pData = FindCacheData(pModel);
+
+	if (0 == pData->filename.GetLen() )
+		return false;
+
+	if (false == pData->reader.IsOpen() )
+	{
+		if (true == pData->isOpenTried)
+			return false;
+
+		pData->isOpenTried = true;
+		if (false == pData->reader.Open(pData->filename) )
+			return false;
+	}
+
+	ParticleCacheReader &reader = pData->reader;
+
+	// cache could be baked with another frame rate
+	const int frame = (int) floor(localTime.GetSecondDouble() * reader.GetFPS() + 0.5);
+
+	if (false == reader.HasFrame(frame) )
+		return false;
+
+	reader.SetFramesInMemory(FrameInMemory);
+
+	if (false == reader.GetFrame(frame, mCacheFrameData) )
+		return false;
+
+	pParticles->WriteParticles( mCacheFrameData.data(), (unsigned int) mCacheFrameData.size() );
+	pParticles->mPerModelUserData.isFirst = true;
+
+	reader.Prefetch(frame, frame >= pData->lastFrame);
+	pData->lastFrame = frame;
+
+	return true;
+}
+
+void GPUshader_Particles::WriteCachedFrame(FBModel *pModel, ParticleSystem *pParticles, const int frame)
+{
+	CacheData *pData = FindCacheData(pModel);
+
+	if (false == pData->writer.IsOpen() )
+		return;
+
+	const unsigned int count = pParticles->ReadParticles(mCacheFrameData);
+	pData->writer.WriteFrame(frame, mCacheFrameData.data(), (int) count);
+}
+
+void GPUshader_Particles::DoBakeCache()
+{
+	if (mIsBaking)
+		FinishBake();
+
+	FBString cacheFile = CacheFile;
+	if (0 == cacheFile.GetLen() )
+	{
+		FBMessageBox( "Particle Cache", "Please specify a cache file", "Ok" );
+		return;
+	}
+
+	FBPlayerControl &lPlayerControl = FBPlayerControl::TheOne();
+	lPlayerControl.Stop();
+
+	// simulation is deterministic from the reset time only
+	FBTime resetTime = ResetTime;
+	FBTime stopTime = lPlayerControl.LoopStop;
+
+	mBakeFrame = resetTime.GetFrame();
+	mBakeStopFrame = stopTime.GetFrame();
+
+	if (mBakeStopFrame < mBakeFrame)
+	{
+		FBMessageBox( "Particle Cache", "Reset time is after the end of the timeline", "Ok" );
+		return;
+	}
+
+	// frame rate could be non integer, frames are FBTime frames as in the playback
+	const double fps = 1.0 / FBTime(0, 0, 0, 1).GetSecondDouble();
+	int numberOfFiles = 0;
+
+	for (int i=0, count=GetDstCount(); i<count; ++i)
+	{
+		FBPlug *pPlug = GetDst(i);
+		if (FBIS(pPlug, FBModel))
+		{
+			CacheData *pData = FindCacheData( (FBModel*) pPlug );
+
+			// the file is mapped for a playback
+			pData->reader.Close();
+			pData->isOpenTried = false;
+
+			if (pData->writer.Open(pData->filename, fps, MaximumParticles) )
+				numberOfFiles += 1;
+		}
+	}
+
+	if (0 == numberOfFiles)
+		return;
+
+	for (auto iter=begin(mParticleMap); iter!=end(mParticleMap); ++iter)
+	{
+		iter->second->NeedReset();
+		iter->second->mPerModelUserData.isResetDone = false;
+	}
+
+	printf( "[GPU Particles] bake cache from %d to %d frame\n", mBakeFrame, mBakeStopFrame );
+
+	mIsBaking = true;
+	lPlayerControl.Goto( FBTime(0, 0, 0, mBakeFrame) );
+}
+
+void GPUshader_Particles::StepBake(const int frame)
+{
+	// frames are simulated one by one, the next one is requested after a write
+	if (frame == mBakeFrame)
+		mBakeFrame += 1;
+
+	if (mBakeFrame > mBakeStopFrame)
+	{
+		FinishBake();
+		return;
+	}
+
+	FBPlayerControl::TheOne().Goto( FBTime(0, 0, 0, mBakeFrame) );
+}
+
+void GPUshader_Particles::FinishBake()
+{
+	mIsBaking = false;
+
+	for (auto iter=begin(mCacheMap); iter!=end(mCacheMap); ++iter)
+	{
+		CacheData *pData = iter->second;
+
+		if (pData->writer.IsOpen() )
+		{
+			const int numberOfFrames = pData->writer.GetNumberOfFrames();
+			const double size = (double) pData->writer.GetBytesWritten() / (1024.0 * 1024.0);
+
+			pData->writer.Close();
+			pData->isOpenTried = false;
+
+			printf( "[GPU Particles] cache %s - %d frames, %.1f MB\n", (const char*) pData->filename, numberOfFrames, size );
+		}
+	}
+}
+
+void GPUshader_Particles::DoClearCache()
+{
+	// frames baked so far are kept
+	if (mIsBaking)
+		FinishBake();
+
+	FreeCache();
+}
+
+void GPUshader_Particles::FreeCache()
+{
+	for (auto iter=begin(mCacheMap); iter!=end(mCacheMap); ++iter)
+		delete iter->second;
+
+	mCacheMap.clear();
+	mIsBaking = false;
+}
+
 void GPUshader_Particles::OnPerFrameRenderingPipelineCallback	(HISender pSender, HKEvent pEvent)
 {
 	FBEventEvalGlobalCallback lEvent(pEvent);
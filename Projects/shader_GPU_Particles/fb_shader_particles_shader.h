@@ -29,6 +29,7 @@
 #endif
 
 #include "ParticleSystem.h"
+#include "ParticleSystem_Cache.h"
 
 enum FBParticlePlayMode
 {
@@ -236,6 +237,10 @@ public:
 
 	FBPropertyBaseEnum<FBParticleEmitter>		Emitter;			// emitter shape
 	FBPropertyBool								InheritEmitterColors;
+	FBPropertyBool								SurfaceUpdateOnCPU;	// incremental update of the emitter surface, only changed triangles are uploaded
+	FBPropertyInt								SurfaceRebuiltTriangles;	// read-only - triangles built again by the last update on CPU
+	FBPropertyInt								SurfaceUploaded;	// read-only - kilobytes uploaded by the last update on CPU
+	FBPropertyAction							SurfaceEmitterBenchmark;	// incremental updates against a full rebuild of 200k triangles
 
 	FBPropertyAnimatableVector3d				EmitDirection;	// emit particles in that direction
 	FBPropertyAnimatableDouble					EmitDirSpreadHor;	// percent for dir randomize
@@ -281,6 +286,7 @@ public:
 	FBPropertyListObject						Collisions;		// simple geometry shapes to collide with (sphere, box, plane)
 
 	FBPropertyBool								SelfCollisions;
+	FBPropertyAction							SelfCollisionsBenchmark;	// CPU grid against all pairs, scaling up to a million particles
 
 	FBPropertyBool								UseFloor;
 	FBPropertyAnimatableDouble					FloorFriction;
@@ -305,6 +311,8 @@ public:
 	FBPropertyListObject						AffectingLights;		//!< Selected Lights to illuminate the connected models (to avoid maximum lights number limitation in OpenGL)
     FBPropertyAlphaSource						Transparency;
     FBPropertyAnimatableDouble					TransparencyFactor; 
+	FBPropertyBool								DepthSort;			// back to front order of points when the transparency is on
+	FBPropertyAction							DepthSortBenchmark;	// CPU radix order against the stable sort up to a million particles
 
 	FBPropertyAnimatableColorAndAlpha					Color;
 	FBPropertyBool										UseColor2;
@@ -334,24 +342,25 @@ public:
 	//ORPopup_CurveEditor									SizeCurveEditor;
 
 	//
-	// TODO: Caching block (WIP)
+	// Caching block, a file per emitter model - <cache file>_<model name>.pcache
 
 	FBPropertyBool			UseCache;
 	FBPropertyBool			AutoCache;
 
 	FBPropertyAction		CacheCutLeft;
 	FBPropertyAction		CacheCutRight;
-	FBPropertyAction		ClearCache;	// remove or just disconnect
+	FBPropertyAction		ClearCache;	// just disconnect, files are kept
 	FBPropertyAction		LoadCache; // assign a cache file
 	FBPropertyAction		SaveCache;
-	FBPropertyAction		CacheTimeRange; // do a cache for a current time
+	FBPropertyAction		CacheTimeRange; // bake frames from the reset time to the loop stop
+	FBPropertyAction		CacheBenchmark;	// round trip, compression ratio and scrubbing speed of a million particles
 
 	FBPropertyString		CacheFile;
 	FBPropertyInt			CacheFrames; // read-only - number of cached frames
-	FBPropertyInt			CacheFPS;		// read-only - cache file number of frames
+	FBPropertyDouble		CacheFPS;		// read-only - cache file frame rate
 
 	FBPropertyInt			FrameInMemory; // pre-load n-frames in memory
-	FBPropertyInt			MemoryUsed; // amount of memory used for pre-caching
+	FBPropertyInt			MemoryUsed; // read-only - megabytes of decoded frames
 
 	static void AddPropertiesToPropertyViewManager();
 
@@ -370,6 +379,17 @@ public:
 	static void AboutAction(HIObject pObject, bool value);
 	static void ResetAction(HIObject pObject, bool value);
 	static void ResetAllAction(HIObject pObject, bool value);
+	static void SelfCollisionsBenchmarkAction(HIObject pObject, bool value);
+	static void DepthSortBenchmarkAction(HIObject pObject, bool value);
+	static void SurfaceEmitterBenchmarkAction(HIObject pObject, bool value);
+	static int GetSurfaceRebuiltTriangles(HIObject pObject);
+	static int GetSurfaceUploaded(HIObject pObject);
+	static void BakeCacheAction(HIObject pObject, bool value);
+	static void ClearCacheAction(HIObject pObject, bool value);
+	static void CacheBenchmarkAction(HIObject pObject, bool value);
+	static int GetCacheFrames(HIObject pObject);
+	static double GetCacheFPS(HIObject pObject);
+	static int GetCacheMemoryUsed(HIObject pObject);
 	static void SetColorCurve(HIObject pObject, bool value);
 	static void SetSizeCurve(HIObject pObject, bool value);
 	static int GetDisplayedCount(HIObject pObject);
@@ -380,6 +400,8 @@ public:
 	void DoResetAll();
 	void DoColorCurve();
 	void DoSizeCurve();
+	void DoBakeCache();
+	void DoClearCache();
 
 protected:
 	FBSystem				mSystem;
@@ -457,6 +479,37 @@ protected:
 
 	void FreeParticles();
 
+	//
+	// particle cache
+
+	struct CacheData
+	{
+		FBString							filename;
+		bool								isOpenTried;	// missing file is not opened every frame
+		int									lastFrame;		// playback direction for the prefetch
+
+		GPUParticles::ParticleCacheReader	reader;
+		GPUParticles::ParticleCacheWriter	writer;			// open during a bake
+	};
+
+	std::map<FBModel*, CacheData*>			mCacheMap;
+	std::vector<GPUParticles::Particle>		mCacheFrameData;
+
+	bool					mIsBaking;
+	int						mBakeFrame;
+	int						mBakeStopFrame;
+
+	void	GetCacheFileName(FBModel *pModel, FBString &filename);
+	CacheData *FindCacheData(FBModel *pModel);
+
+	// upload a cached frame instead of the simulation
+	bool	LoadCachedFrame(FBModel *pModel, GPUParticles::ParticleSystem *pParticles, const FBTime &localTime);
+	void	WriteCachedFrame(FBModel *pModel, GPUParticles::ParticleSystem *pParticles, const int frame);
+	// go to the next bake frame when every model has written the current one
+	void	StepBake(const int frame);
+	void	FinishBake();
+	void	FreeCache();
+
 	void LocalShaderBeginRender( FBRenderOptions* pRenderOptions, FBModel *pModel );
 	void LocalShadeModel( FBRenderOptions* pRenderOptions, FBModel *pModel, FBRenderingPass pPass );
 
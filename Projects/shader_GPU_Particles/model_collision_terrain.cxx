@@ -21,6 +21,7 @@
 #include "IO\FileUtils.h"
 
 #include "Shader_ParticleSystem.h"
+#include <math.h>
 
 using namespace GPUParticles;
 
@@ -34,6 +35,22 @@ static void CollisionTerrain_ResetAction(HIObject pObject, bool value) {
 	if (value && p)	p->DoUpdate();
 }
 
+void CollisionTerrain::HeightFieldBenchmarkAction(HIObject pObject, bool value) 
+{
+	if (value)
+		GPUParticles::HeightFieldBenchmark(4096);
+}
+
+void CollisionTerrain::CompareWithGPUAction(HIObject pObject, bool value) 
+{
+	CollisionTerrain *p = FBCast<CollisionTerrain>(pObject);
+	if (value && p)
+	{
+		p->mNeedCompare = true;
+		p->DoUpdate();
+	}
+}
+
 void AddPropertyViewForCollisionTerrain(const char* pPropertyName, const char* pHierarchy, bool pIsFolder=false)
 {
 	FBPropertyViewManager::TheOne().AddPropertyView(COLLISIONTERRAIN__CLASSSTR, pPropertyName, pHierarchy);
@@ -58,6 +75,9 @@ void CollisionTerrain::AddPropertiesToPropertyViewManager()
 	AddPropertyViewForCollisionTerrain("Min Z", "Dynamic generation");
 	AddPropertyViewForCollisionTerrain("Max Z", "Dynamic generation");
 	AddPropertyViewForCollisionTerrain("Density", "Dynamic generation");
+	AddPropertyViewForCollisionTerrain("CPU Rasterizer", "Dynamic generation");
+	AddPropertyViewForCollisionTerrain("Height Field Benchmark", "Dynamic generation");
+	AddPropertyViewForCollisionTerrain("Compare With GPU", "Dynamic generation");
 
 	// 
 	AddPropertyViewForCollisionTerrain("Render preview", "", true);
@@ -102,6 +122,8 @@ bool CollisionTerrain::FBCreate()
 
 	mTextureId = 0;
 	mTextureAddress = 0;
+	mUploadAll = true;
+	mNeedCompare = false;
 
 	//
     ShadingMode = kFBModelShadingTexture;
@@ -133,6 +155,10 @@ bool CollisionTerrain::FBCreate()
 
 	FBPropertyPublish( this, Density, "Density", nullptr, nullptr );
 
+	FBPropertyPublish( this, CPURasterizer, "CPU Rasterizer", nullptr, nullptr );
+	FBPropertyPublish( this, HeightFieldBenchmark, "Height Field Benchmark", nullptr, HeightFieldBenchmarkAction );
+	FBPropertyPublish( this, CompareWithGPU, "Compare With GPU", nullptr, CompareWithGPUAction );
+
 	FBPropertyPublish( this, Preview, "Preview", nullptr, nullptr );
 	FBPropertyPublish( this, DebugNormals, "Debug Normals", nullptr, nullptr );
 
@@ -155,6 +181,8 @@ bool CollisionTerrain::FBCreate()
 	Density = FBVector3d(1.0, 1.0, 1.0);
 	Density.ModifyPropertyFlag( kFBPropertyFlagReadOnly, true );
 
+	CPURasterizer = false;
+
 	Preview = false;
 	DebugNormals = false;
 
@@ -341,6 +369,7 @@ void CollisionTerrain::ReSize()
 
 		mTextureId = texId;
 		mTextureAddress = handle;
+		mUploadAll = true;
 	}
 }
 
@@ -399,6 +428,10 @@ bool CollisionTerrain::RenderToHeightMap()
 	ReSize();
 
 	CHECK_GL_ERROR();
+
+	// comparison needs the GPU pass in the texture
+	if (CPURasterizer && false == mNeedCompare)
+		return RasterizeOnCPU();
 	
 	glPushClientAttrib(GL_ALL_ATTRIB_BITS);
 
@@ -488,9 +521,180 @@ bool CollisionTerrain::RenderToHeightMap()
 
 	CHECK_GL_ERROR();
 
+	// cpu rasterizer has to fill the whole texture next time
+	mUploadAll = true;
+
 	return true;
 }
 
+// the same map as the depth pass above, see ParticleSystem_HeightField.h
+bool CollisionTerrain::RasterizeOnCPU(const bool upload)
+{
+	const int resolution = mBuffer.GetWidth();
+	if (resolution <= 0)
+		return false;
+
+	FBVector3d T;
+	GetVector(T);
+
+	const double size = Size;
+	const double minZ = MinZ;
+	const double maxZ = MaxZ;
+
+	HeightFieldGrid grid;
+	grid.resolution = resolution;
+	grid.originX = (float) (T[0] - size);
+	grid.originZ = (float) (T[2] - size);
+	grid.cellSize = (float) (2.0 * size / resolution);
+	// depth range of the orthographic matrix in world heights
+	grid.minY = (float) (T[1] - maxZ);
+	grid.maxY = (float) (T[1] + maxZ - 2.0 * minZ);
+
+	mHeightField.SetGrid(grid);
+	mHeightField.BeginUpdate();
+
+	FBMatrix modelMatrix;
+	float matrix[16];
+
+	for (int i=0, count=Objects.GetCount(); i<count; ++i)
+	{
+		if ( false == FBIS(Objects[i], FBModel) )
+			continue;
+
+		FBModel *pModel = (FBModel*) Objects[i];
+		FBModelVertexData *pVertexData = pModel->ModelVertexData;
+
+		if (pVertexData == nullptr)
+			continue;
+
+		pModel->GetMatrix(modelMatrix);
+
+		for (int ii=0; ii<16; ++ii)
+			matrix[ii] = (float) modelMatrix[ii];
+
+		pVertexData->VertexArrayMappingRequest();
+
+		const float *positions = (const float*) pVertexData->GetVertexArray( kFBGeometryArrayID_Point );
+		const int *indices = pVertexData->GetIndexArray();
+		const int vertexCount = pVertexData->GetVertexCount();
+
+		// triangles of all sub patches, quads are split
+		mTriangleIndices.clear();
+
+		for (int j=0, patchCount=pVertexData->GetSubPatchCount(); j<patchCount && indices != nullptr; ++j)
+		{
+			const int offset = pVertexData->GetSubPatchIndexOffset(j);
+			const int indexSize = pVertexData->GetSubPatchIndexSize(j);
+			const FBGeometryPrimitiveType type = pVertexData->GetSubPatchPrimitiveType(j);
+
+			if (type == kFBGeometry_TRIANGLES)
+			{
+				mTriangleIndices.insert( end(mTriangleIndices), indices + offset, indices + offset + indexSize );
+			}
+			else if (type == kFBGeometry_QUADS)
+			{
+				for (int k=offset; k+3<offset+indexSize; k+=4)
+				{
+					const int quad[6] = { indices[k], indices[k+1], indices[k+2], indices[k], indices[k+2], indices[k+3] };
+					mTriangleIndices.insert( end(mTriangleIndices), quad, quad + 6 );
+				}
+			}
+		}
+
+		if (positions != nullptr)
+		{
+			mHeightField.UpdateMesh(i, matrix, positions, vertexCount, mTriangleIndices.data(), (int) mTriangleIndices.size() );
+		}
+
+		pVertexData->VertexArrayMappingRelease();
+	}
+
+	mHeightField.EndUpdate();
+
+	if (false == upload)
+		return true;
+
+	// upload only the rasterized tiles
+	int x, y, width, height;
+
+	if (mUploadAll)
+	{
+		x = y = 0;
+		width = height = resolution;
+	}
+	else if (false == mHeightField.GetUpdatedRect(x, y, width, height) )
+	{
+		return true;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, mBuffer.GetColorObject() );
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, resolution);
+
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED, GL_FLOAT,
+		mHeightField.GetHeights() + (size_t) y * resolution + x);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	mUploadAll = false;
+
+	CHECK_GL_ERROR();
+
+	return true;
+}
+
+// texture of the GPU pass against the CPU rasterizer, edges of triangles could go to the other texel
+//  in a few places, so texels over the tolerance are counted and reported
+bool CollisionTerrain::CompareHeightMaps()
+{
+	const int resolution = mBuffer.GetWidth();
+	if (resolution <= 0)
+		return false;
+
+	const size_t numberOfTexels = (size_t) resolution * resolution;
+	mReadback.resize(numberOfTexels);
+
+	glBindTexture(GL_TEXTURE_2D, mBuffer.GetColorObject() );
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, mReadback.data() );
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	CHECK_GL_ERROR();
+
+	// the texture holds the GPU map now, upload the whole CPU one when it's in use
+	mHeightField.Invalidate();
+	RasterizeOnCPU(CPURasterizer);
+
+	const float *heights = mHeightField.GetHeights();
+	const double tolerance = 0.001 * 2.0 * MaxZ;
+
+	double maxDiff = 0.0;
+	double sumDiff = 0.0;
+	size_t overTolerance = 0;
+
+	for (size_t i=0; i<numberOfTexels; ++i)
+	{
+		const double diff = fabs( (double) heights[i] - (double) mReadback[i] );
+
+		if (diff > maxDiff)
+			maxDiff = diff;
+		if (diff > tolerance)
+			overTolerance += 1;
+
+		sumDiff += diff;
+	}
+
+	// less than 0.1% of texels on triangle edges
+	const bool result = (overTolerance * 1000 <= numberOfTexels);
+
+	printf( "[GPU Particles] height field against GPU - resolution %d, max difference %f, mean %f, %d texels over %f\n",
+		resolution, maxDiff, sumDiff / (double) numberOfTexels, (int) overTolerance, tolerance );
+	printf( "[GPU Particles] height field comparison %s\n", (result) ? "passed" : "FAILED" );
+
+	return result;
+}
+
 /** Custom display
 */
 void CollisionTerrain::CustomModelDisplay( FBCamera* pCamera, FBModelShadingMode pShadingMode, FBModelRenderPass pRenderPass, float pPickingAreaWidth, float pPickingAreaHeight)
@@ -806,6 +1010,12 @@ void CollisionTerrain::OnRenderEvent(HISender pSender, HKEvent pEvent)
 			}
 
 			RenderToHeightMap();
+
+			if (mNeedCompare)
+			{
+				CompareHeightMaps();
+				mNeedCompare = false;
+			}
 			
 			mNeedUpdate = false;
 			mLastTranslation = T;
@@ -19,6 +19,9 @@
 #include "graphics\Framebuffer.h"
 #include "ParticleSystem_types.h"
 #include "Shader_ParticleSystem.h"
+#include "ParticleSystem_HeightField.h"
+
+#include <vector>
 
 //--- Registration define
 #define COLLISIONTERRAIN__CLASSNAME	CollisionTerrain
@@ -123,6 +126,10 @@ public:
 
 	FBPropertyVector3d				Density;		// result points density according to the world / texture sizes
 
+	FBPropertyBool					CPURasterizer;	// height map from a multithreaded CPU rasterizer, only changed tiles are updated
+	FBPropertyAction				HeightFieldBenchmark;	// CPU rasterizer against a CPU reference of the same rules, no GPU involved
+	FBPropertyAction				CompareWithGPU;			// next update renders the map on GPU, reads it back and compares with the CPU rasterizer
+
 	FBPropertyBool					Preview;		// draw points based on terrain map
 	FBPropertyBool					DebugNormals;	// display points normals
 
@@ -132,6 +139,8 @@ public:
 	}
 
 	static void AddPropertiesToPropertyViewManager();
+	static void HeightFieldBenchmarkAction(HIObject pObject, bool value);
+	static void CompareWithGPUAction(HIObject pObject, bool value);
 
 	void DoUpdate();
 
@@ -157,12 +166,20 @@ protected:
 
 	HGLRC							mLastContext;
 
+	GPUParticles::HeightFieldRasterizer		mHeightField;
+	std::vector<int>				mTriangleIndices;	// triangles of sub patches of a model
+	bool							mUploadAll;			// texture is new or it was rendered by the GPU
+	bool							mNeedCompare;		// GPU pass and CPU rasterizer are compared on the next update
+	std::vector<float>				mReadback;
+
 	void CreateGeometry();
 
 	void ReSize();
 	void CalculateDensity();
 
 	bool RenderToHeightMap();
+	bool RasterizeOnCPU(const bool upload=true);
+	bool CompareHeightMaps();
 };
 
 
@@ -0,0 +1,668 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_capture.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "moPhysics_capture.h"
+#include "IO\AtomicFile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#define PHYSICS_CAPTURE_MAGIC		0x4348504D		// MPHC
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// stream helpers, values are stored as they are in memory
+
+class CaptureWriter
+{
+public:
+
+	std::string		data;
+
+	template<typename T>
+	void Write(const T value)
+	{
+		data.append( (const char*) &value, sizeof(T) );
+	}
+
+	template<typename T>
+	void WriteArray(const T *values, const size_t count)
+	{
+		if (count > 0)
+			data.append( (const char*) values, sizeof(T) * count );
+	}
+
+	template<typename T>
+	void WriteVector(const std::vector<T> &values)
+	{
+		Write( (unsigned int) values.size() );
+		WriteArray(values.data(), values.size() );
+	}
+};
+
+class CaptureReader
+{
+public:
+
+	//! a constructor
+	CaptureReader(const char *begin, const char *end)
+		: mPtr(begin)
+		, mEnd(end)
+		, mIsOk(true)
+	{}
+
+	bool IsOk() const { return mIsOk; }
+
+	template<typename T>
+	void Read(T &value)
+	{
+		ReadArray(&value, 1);
+	}
+
+	template<typename T>
+	void ReadArray(T *values, const size_t count)
+	{
+		const size_t size = sizeof(T) * count;
+		if (false == mIsOk || (size_t) (mEnd - mPtr) < size)
+		{
+			mIsOk = false;
+			return;
+		}
+
+		if (size > 0)
+			memcpy(values, mPtr, size);
+		mPtr += size;
+	}
+
+	template<typename T>
+	void ReadVector(std::vector<T> &values)
+	{
+		unsigned int count = 0;
+		Read(count);
+
+		// a broken count can't be larger than the rest of the file
+		if (false == mIsOk || (size_t) (mEnd - mPtr) / sizeof(T) < count)
+		{
+			mIsOk = false;
+			values.clear();
+			return;
+		}
+
+		values.resize(count);
+		ReadArray(values.data(), count);
+	}
+
+private:
+
+	const char		*mPtr;
+	const char		*mEnd;
+	bool			mIsOk;
+};
+
+static void WriteGeometry(CaptureWriter &writer, const PhysicsCaptureGeometry &geometry)
+{
+	writer.WriteVector(geometry.positions);
+	writer.WriteVector(geometry.polys);
+
+	writer.WriteArray(&geometry.matrix[0][0], 32);
+	writer.WriteArray(&geometry.matrixTR[0][0], 32);
+	writer.WriteArray(&geometry.position[0][0], 6);
+	writer.WriteArray(&geometry.rotation[0][0], 6);
+	writer.WriteArray(&geometry.quaternion[0][0], 8);
+	writer.WriteArray(&geometry.scale[0][0], 6);
+	writer.WriteArray(geometry.visualAlign, 16);
+	writer.WriteArray(geometry.bbMin, 3);
+	writer.WriteArray(geometry.bbMax, 3);
+}
+
+static void ReadGeometry(CaptureReader &reader, PhysicsCaptureGeometry &geometry)
+{
+	reader.ReadVector(geometry.positions);
+	reader.ReadVector(geometry.polys);
+
+	reader.ReadArray(&geometry.matrix[0][0], 32);
+	reader.ReadArray(&geometry.matrixTR[0][0], 32);
+	reader.ReadArray(&geometry.position[0][0], 6);
+	reader.ReadArray(&geometry.rotation[0][0], 6);
+	reader.ReadArray(&geometry.quaternion[0][0], 8);
+	reader.ReadArray(&geometry.scale[0][0], 6);
+	reader.ReadArray(geometry.visualAlign, 16);
+	reader.ReadArray(geometry.bbMin, 3);
+	reader.ReadArray(geometry.bbMax, 3);
+}
+
+static void WritePath(CaptureWriter &writer, const PhysicsCapturePath &path)
+{
+	writer.WriteArray(path.matrix, 16);
+	writer.Write(path.knotStep);
+	writer.WriteVector(path.knots);
+	writer.WriteVector(path.derivatives);
+}
+
+static void ReadPath(CaptureReader &reader, PhysicsCapturePath &path)
+{
+	reader.ReadArray(path.matrix, 16);
+	reader.Read(path.knotStep);
+	reader.ReadVector(path.knots);
+	reader.ReadVector(path.derivatives);
+}
+
+static void SetIdentity(double *m)
+{
+	for (int i=0; i<16; ++i)
+		m[i] = (i % 5 == 0) ? 1.0 : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PhysicsCaptureGeometry
+
+PhysicsCaptureGeometry::PhysicsCaptureGeometry()
+{
+	for (int i=0; i<2; ++i)
+	{
+		SetIdentity(matrix[i]);
+		SetIdentity(matrixTR[i]);
+
+		for (int k=0; k<3; ++k)
+		{
+			position[i][k] = 0.0;
+			rotation[i][k] = 0.0;
+			scale[i][k] = 1.0;
+		}
+
+		quaternion[i][0] = quaternion[i][1] = quaternion[i][2] = 0.0;
+		quaternion[i][3] = 1.0;
+	}
+
+	SetIdentity(visualAlign);
+
+	for (int k=0; k<3; ++k)
+	{
+		bbMin[k] = 0.0;
+		bbMax[k] = 0.0;
+	}
+}
+
+PhysicsCapturePath::PhysicsCapturePath()
+	: knotStep(0.0)
+{
+	SetIdentity(matrix);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PhysicsCapture
+
+PhysicsCapture::PhysicsCapture()
+{
+	Clear();
+}
+
+void PhysicsCapture::Clear()
+{
+	memset(&world, 0, sizeof(PhysicsCaptureWorld) );
+	world.scaling = 1.0;
+
+	hasLevel = 0;
+	level = PhysicsCaptureGeometry();
+
+	bodies.clear();
+	cars.clear();
+
+	ClearFrames();
+}
+
+void PhysicsCapture::ClearFrames()
+{
+	events.clear();
+
+	mTimes.clear();
+	mFlags.clear();
+	mInputs.clear();
+	mOutputs.clear();
+}
+
+int PhysicsCapture::AddFrame(const double time, const int flags)
+{
+	mTimes.push_back(time);
+	mFlags.push_back(flags);
+
+	mInputs.resize(mInputs.size() + GetNumberOfInputs(), 0.0);
+	mOutputs.resize(mOutputs.size() + GetNumberOfOutputs(), 0.0);
+
+	return (int) mTimes.size() - 1;
+}
+
+bool PhysicsCapture::Save(const char *filename) const
+{
+	CaptureWriter writer;
+
+	writer.Write( (unsigned int) PHYSICS_CAPTURE_MAGIC );
+	writer.Write( (unsigned int) PHYSICS_CAPTURE_VERSION );
+
+	// world
+	writer.Write(world.scaling);
+	writer.Write(world.threads);
+	writer.Write(world.samples);
+	writer.Write(world.fps);
+	writer.WriteArray(world.gravity, 3);
+	writer.Write(world.hasMaterial);
+	writer.WriteArray(world.material, 5);
+
+	// scene
+	writer.Write(hasLevel);
+	if (hasLevel)
+		WriteGeometry(writer, level);
+
+	writer.Write( (unsigned int) bodies.size() );
+	for (auto iter=bodies.begin(); iter!=bodies.end(); ++iter)
+	{
+		writer.WriteVector(iter->options);
+		writer.Write(iter->convexHull);
+		WriteGeometry(writer, iter->geometry);
+	}
+
+	writer.Write( (unsigned int) cars.size() );
+	for (auto iter=cars.begin(); iter!=cars.end(); ++iter)
+	{
+		writer.WriteVector(iter->options);
+		for (int i=0; i<PHYSICS_CAPTURE_CAR_PARTS; ++i)
+			WriteGeometry(writer, iter->parts[i]);
+
+		writer.Write(iter->hasPath);
+		if (iter->hasPath)
+			WritePath(writer, iter->path);
+	}
+
+	writer.Write( (unsigned int) events.size() );
+	for (auto iter=events.begin(); iter!=events.end(); ++iter)
+	{
+		writer.Write(iter->frame);
+		writer.Write(iter->car);
+		writer.WriteVector(iter->options);
+	}
+
+	// frames
+	writer.WriteVector(mTimes);
+	writer.WriteVector(mFlags);
+	writer.WriteVector(mInputs);
+	writer.WriteVector(mOutputs);
+
+	writer.Write( (unsigned int) PHYSICS_CAPTURE_MAGIC );
+
+	if (false == WriteFileAtomic(filename, writer.data.data(), writer.data.size() ) )
+	{
+		printf( "[MoPhysics] failed to write a capture file - %s\n", filename );
+		return false;
+	}
+	return true;
+}
+
+bool PhysicsCapture::Load(const char *filename)
+{
+	Clear();
+
+	FILE *fp = fopen(filename, "rb");
+	if (nullptr == fp)
+	{
+		printf( "[MoPhysics] failed to open a capture file - %s\n", filename );
+		return false;
+	}
+
+	std::string content;
+	char buffer[65536];
+	size_t count = 0;
+	while ( (count = fread(buffer, 1, sizeof(buffer), fp) ) > 0)
+		content.append(buffer, count);
+	fclose(fp);
+
+	CaptureReader reader(content.data(), content.data() + content.size() );
+
+	unsigned int magic = 0;
+	unsigned int version = 0;
+	reader.Read(magic);
+	reader.Read(version);
+
+	if (false == reader.IsOk() || PHYSICS_CAPTURE_MAGIC != magic || PHYSICS_CAPTURE_VERSION != version)
+	{
+		printf( "[MoPhysics] %s is not a capture file of version %d\n", filename, PHYSICS_CAPTURE_VERSION );
+		return false;
+	}
+
+	// world
+	reader.Read(world.scaling);
+	reader.Read(world.threads);
+	reader.Read(world.samples);
+	reader.Read(world.fps);
+	reader.ReadArray(world.gravity, 3);
+	reader.Read(world.hasMaterial);
+	reader.ReadArray(world.material, 5);
+
+	// scene
+	reader.Read(hasLevel);
+	if (hasLevel)
+		ReadGeometry(reader, level);
+
+	unsigned int numberOfBodies = 0;
+	reader.Read(numberOfBodies);
+	if (reader.IsOk() && numberOfBodies < 65536)
+	{
+		bodies.resize(numberOfBodies);
+		for (auto iter=bodies.begin(); iter!=bodies.end(); ++iter)
+		{
+			reader.ReadVector(iter->options);
+			reader.Read(iter->convexHull);
+			ReadGeometry(reader, iter->geometry);
+		}
+	}
+
+	unsigned int numberOfCars = 0;
+	reader.Read(numberOfCars);
+	if (reader.IsOk() && numberOfCars < 65536)
+	{
+		cars.resize(numberOfCars);
+		for (auto iter=cars.begin(); iter!=cars.end(); ++iter)
+		{
+			reader.ReadVector(iter->options);
+			for (int i=0; i<PHYSICS_CAPTURE_CAR_PARTS; ++i)
+				ReadGeometry(reader, iter->parts[i]);
+
+			reader.Read(iter->hasPath);
+			if (iter->hasPath)
+				ReadPath(reader, iter->path);
+		}
+	}
+
+	unsigned int numberOfEvents = 0;
+	reader.Read(numberOfEvents);
+	if (reader.IsOk() && numberOfEvents < (1 << 24) )
+	{
+		events.resize(numberOfEvents);
+		for (auto iter=events.begin(); iter!=events.end(); ++iter)
+		{
+			reader.Read(iter->frame);
+			reader.Read(iter->car);
+			reader.ReadVector(iter->options);
+		}
+	}
+
+	// frames
+	reader.ReadVector(mTimes);
+	reader.ReadVector(mFlags);
+	reader.ReadVector(mInputs);
+	reader.ReadVector(mOutputs);
+
+	reader.Read(magic);
+
+	const size_t numberOfFrames = mTimes.size();
+	const bool isOk = reader.IsOk()
+		&& PHYSICS_CAPTURE_MAGIC == magic
+		&& numberOfBodies == bodies.size()
+		&& numberOfCars == cars.size()
+		&& numberOfEvents == events.size()
+		&& mFlags.size() == numberOfFrames
+		&& mInputs.size() == numberOfFrames * GetNumberOfInputs()
+		&& mOutputs.size() == numberOfFrames * GetNumberOfOutputs();
+
+	if (false == isOk)
+	{
+		printf( "[MoPhysics] capture file is broken - %s\n", filename );
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// compare
+
+bool PhysicsCaptureCompare(const PhysicsCapture &reference, const PhysicsCapture &replay, const double tolerance, PhysicsCaptureDiff &diff)
+{
+	diff.numberOfFrames = 0;
+	diff.firstFrame = -1;
+	diff.worstFrame = -1;
+	diff.worstValue = -1;
+	diff.maxDiff = 0.0;
+
+	if (reference.GetNumberOfOutputs() != replay.GetNumberOfOutputs() )
+	{
+		printf( "[MoPhysics] captures have a different scene layout\n" );
+		diff.firstFrame = 0;
+		return false;
+	}
+
+	const int numberOfOutputs = reference.GetNumberOfOutputs();
+	const int numberOfFrames = std::min(reference.GetNumberOfFrames(), replay.GetNumberOfFrames() );
+
+	for (int frame=0; frame<numberOfFrames; ++frame)
+	{
+		if (0 == (reference.GetFrameFlags(frame) & ePhysicsCaptureFrameOutputs) )
+			continue;
+
+		diff.numberOfFrames += 1;
+
+		const double *a = reference.GetFrameOutputs(frame);
+		const double *b = replay.GetFrameOutputs(frame);
+
+		for (int i=0; i<numberOfOutputs; ++i)
+		{
+			// nan is a mismatch
+			double d = fabs(a[i] - b[i]);
+			if (d != d)
+				d = HUGE_VAL;
+
+			if (d > diff.maxDiff)
+			{
+				diff.maxDiff = d;
+				diff.worstFrame = frame;
+				diff.worstValue = i;
+			}
+
+			if (d > tolerance && diff.firstFrame < 0)
+				diff.firstFrame = frame;
+		}
+	}
+
+	if (reference.GetNumberOfFrames() != replay.GetNumberOfFrames() && diff.firstFrame < 0)
+		diff.firstFrame = numberOfFrames;
+
+	return diff.firstFrame < 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// self test
+
+static void FillSelfTestGeometry(PhysicsCaptureGeometry &geometry, const int seed)
+{
+	for (int i=0; i<8; ++i)
+	{
+		geometry.positions.push_back( (float) ( (i & 1) + seed) );
+		geometry.positions.push_back( (float) ( (i >> 1) & 1) );
+		geometry.positions.push_back( (float) ( (i >> 2) & 1) );
+	}
+
+	const int poly[PHYSICS_CAPTURE_POLY_SIZE] = { 4, 0, 1, 3, 2, seed };
+	geometry.polys.insert(geometry.polys.end(), poly, poly + PHYSICS_CAPTURE_POLY_SIZE);
+
+	geometry.matrix[1][12] = 10.0 * seed;
+	geometry.position[1][0] = 10.0 * seed;
+	geometry.quaternion[0][2] = 0.5;
+	geometry.bbMax[0] = 1.0 + seed;
+}
+
+bool PhysicsCaptureSelfTest(const char *folder)
+{
+	bool result = true;
+	auto fnCheck = [&result] (const bool condition, const char *text) {
+		if (false == condition)
+		{
+			printf( "[MoPhysics] capture test FAILED - %s\n", text );
+			result = false;
+		}
+	};
+
+	PhysicsCapture capture;
+
+	capture.world.scaling = 0.01;
+	capture.world.threads = 2;
+	capture.world.samples = 4;
+	capture.world.fps = 120.0;
+	capture.world.gravity[1] = -9.8;
+	capture.world.hasMaterial = 1;
+	capture.world.material[0] = 0.5;
+
+	capture.hasLevel = 1;
+	FillSelfTestGeometry(capture.level, 0);
+
+	capture.bodies.resize(2);
+	for (int i=0; i<2; ++i)
+	{
+		capture.bodies[i].options.assign(24, (char) i);
+		capture.bodies[i].convexHull = 1;
+		FillSelfTestGeometry(capture.bodies[i].geometry, i + 1);
+	}
+
+	capture.cars.resize(3);
+	for (int i=0; i<3; ++i)
+	{
+		PhysicsCaptureCar &car = capture.cars[i];
+		car.options.assign(200 + i, (char) (i + 7) );
+
+		for (int j=0; j<PHYSICS_CAPTURE_CAR_PARTS; ++j)
+			FillSelfTestGeometry(car.parts[j], i * 10 + j);
+
+		car.hasPath = (i == 1);
+		if (car.hasPath)
+		{
+			car.path.knotStep = 0.05;
+			car.path.knots.assign(60, 1.5);
+			car.path.derivatives.assign(3 * 257, 0.25);
+		}
+	}
+
+	const int numberOfFrames = 600;
+	for (int frame=0; frame<numberOfFrames; ++frame)
+	{
+		const int index = capture.AddFrame(frame / 30.0, (frame == 0) ? ePhysicsCaptureFrameReset : ePhysicsCaptureFrameFetch | ePhysicsCaptureFrameOutputs);
+
+		for (int car=0; car<3; ++car)
+		{
+			double *inputs = capture.GetCarInputs(index, car);
+			for (int k=0; k<PHYSICS_CAPTURE_CAR_INPUTS; ++k)
+				inputs[k] = 0.01 * frame + k;
+
+			double *outputs = capture.GetCarOutputs(index, car);
+			for (int k=0; k<PHYSICS_CAPTURE_CAR_OUTPUTS; ++k)
+				outputs[k] = sin(0.1 * frame + k + car);
+		}
+
+		for (int body=0; body<2; ++body)
+		{
+			double *outputs = capture.GetBodyOutputs(index, body);
+			for (int k=0; k<PHYSICS_CAPTURE_BODY_OUTPUTS; ++k)
+				outputs[k] = cos(0.1 * frame + k + body);
+		}
+	}
+
+	PhysicsCaptureEvent ev;
+	ev.frame = 100;
+	ev.car = 2;
+	ev.options.assign(202, 3);
+	capture.events.push_back(ev);
+
+	fnCheck(capture.GetNumberOfOutputs() == 3 * PHYSICS_CAPTURE_CAR_OUTPUTS + 2 * PHYSICS_CAPTURE_BODY_OUTPUTS, "number of outputs");
+
+	// 1 - file round trip
+
+	const std::string filename = std::string(folder) + "/selftest.capture";
+	fnCheck(capture.Save(filename.c_str() ), "save");
+
+	PhysicsCapture loaded;
+	fnCheck(loaded.Load(filename.c_str() ), "load");
+
+	fnCheck(loaded.GetNumberOfFrames() == numberOfFrames, "number of frames");
+	fnCheck(loaded.bodies.size() == 2 && loaded.cars.size() == 3 && loaded.events.size() == 1, "scene layout");
+	fnCheck(loaded.world.fps == 120.0 && loaded.world.gravity[1] == -9.8 && loaded.world.material[0] == 0.5, "world");
+
+	if (loaded.cars.size() == 3 && loaded.bodies.size() == 2 && loaded.events.size() == 1)
+	{
+		fnCheck(loaded.cars[2].options == capture.cars[2].options, "car options");
+		fnCheck(loaded.cars[1].hasPath && loaded.cars[1].path.derivatives == capture.cars[1].path.derivatives, "car path");
+		fnCheck(loaded.cars[2].parts[4].positions == capture.cars[2].parts[4].positions
+			&& loaded.cars[2].parts[4].polys == capture.cars[2].parts[4].polys
+			&& loaded.cars[2].parts[4].matrix[1][12] == capture.cars[2].parts[4].matrix[1][12], "car geometry");
+		fnCheck(loaded.bodies[1].geometry.bbMax[0] == capture.bodies[1].geometry.bbMax[0], "body geometry");
+		fnCheck(loaded.events[0].frame == 100 && loaded.events[0].options.size() == 202, "events");
+	}
+
+	if (loaded.GetNumberOfFrames() == numberOfFrames)
+	{
+		fnCheck(loaded.GetFrameFlags(0) == ePhysicsCaptureFrameReset && loaded.GetFrameTime(300) == capture.GetFrameTime(300), "frame header");
+		fnCheck(0 == memcmp(loaded.GetCarInputs(599, 2), capture.GetCarInputs(599, 2), sizeof(double) * PHYSICS_CAPTURE_CAR_INPUTS), "frame inputs");
+	}
+
+	// 2 - comparison
+
+	PhysicsCaptureDiff diff;
+	fnCheck(PhysicsCaptureCompare(capture, loaded, 0.0, diff) && diff.maxDiff == 0.0 && diff.numberOfFrames == numberOfFrames - 1, "same outputs");
+
+	if (loaded.GetNumberOfFrames() == numberOfFrames)
+	{
+		loaded.GetBodyOutputs(321, 1)[5] += 0.5;
+		loaded.GetCarOutputs(400, 0)[0] += 1.0e-9;
+		loaded.GetCarOutputs(0, 1)[0] += 1.0;	// no outputs flag, not compared
+
+		fnCheck(false == PhysicsCaptureCompare(capture, loaded, 1.0e-6, diff), "changed outputs");
+		fnCheck(diff.firstFrame == 321 && diff.worstFrame == 321 && fabs(diff.maxDiff - 0.5) < 1.0e-9, "first changed frame");
+		fnCheck(diff.worstValue == 3 * PHYSICS_CAPTURE_CAR_OUTPUTS + PHYSICS_CAPTURE_BODY_OUTPUTS + 5, "changed value");
+	}
+
+	// 3 - broken files
+
+	{
+		std::string content;
+		FILE *fp = fopen(filename.c_str(), "rb");
+		if (fp)
+		{
+			char buffer[65536];
+			size_t count = 0;
+			while ( (count = fread(buffer, 1, sizeof(buffer), fp) ) > 0)
+				content.append(buffer, count);
+			fclose(fp);
+		}
+
+		fp = fopen(filename.c_str(), "wb");
+		if (fp)
+		{
+			fwrite(content.data(), 1, content.size() / 2, fp);
+			fclose(fp);
+		}
+		fnCheck(false == loaded.Load(filename.c_str() ) && loaded.GetNumberOfFrames() == 0, "truncated file");
+
+		fp = fopen(filename.c_str(), "wb");
+		if (fp)
+		{
+			content[4] = 99;		// version
+			fwrite(content.data(), 1, content.size(), fp);
+			fclose(fp);
+		}
+		fnCheck(false == loaded.Load(filename.c_str() ), "other version");
+
+		remove(filename.c_str() );
+	}
+
+	printf( "[MoPhysics] capture test %s, %d frames of %d cars and %d bodies\n",
+		(result) ? "passed" : "FAILED", numberOfFrames, (int) capture.cars.size(), (int) capture.bodies.size() );
+
+	return result;
+}
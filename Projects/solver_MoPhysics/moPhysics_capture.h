@@ -0,0 +1,190 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_capture.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+
+/*
+	Physics capture
+
+	everything the solver passes to the physics layer - world settings, level geometry, bodies and cars
+	 with their geometry, steering path and options, and per frame control inputs together with the
+	 results the solver read back (chassis and wheel matrices, speed, rpm, gear).
+
+	A capture is recorded in MotionBuilder and replayed by the physics_replay tool without the SDK,
+	 replay results are compared frame by frame with the recorded ones.
+
+	Geometry is a snapshot of the query interface made when a body or a car is created. No SDK and no
+	 physics library dependency, option structures of the physics layer are stored as raw blocks.
+*/
+
+#define PHYSICS_CAPTURE_VERSION			2
+
+#define PHYSICS_CAPTURE_CAR_PARTS		5		// chassis and 4 wheels
+#define PHYSICS_CAPTURE_CAR_INPUTS		7		// torque, clutch, steering, steering blend, brake, handbrake, gear
+#define PHYSICS_CAPTURE_CAR_OUTPUTS		(PHYSICS_CAPTURE_CAR_PARTS * 16 + 3)	// part matrices, speed, rpm, current gear
+#define PHYSICS_CAPTURE_BODY_OUTPUTS	16		// body matrix
+#define PHYSICS_CAPTURE_POLY_SIZE		6		// vertex count, 4 indices, material id
+
+enum EPhysicsCaptureFrameFlags
+{
+	ePhysicsCaptureFrameReset = 1,		// world was reset before the frame
+	ePhysicsCaptureFrameFetch = 2,		// fixed step clock was advanced to the frame time
+	ePhysicsCaptureFrameOutputs = 4,	// outputs were read back, only these frames are compared
+	ePhysicsCaptureFrameHold = 8		// clock was asked about the frame time with a stopped playback, no steps
+};
+
+struct PhysicsCaptureGeometry
+{
+	std::vector<float>		positions;		// xyz of every vertex
+	std::vector<int>		polys;			// PHYSICS_CAPTURE_POLY_SIZE values per polygon
+
+	// index 0 is a local, 1 is a global query
+	double		matrix[2][16];
+	double		matrixTR[2][16];
+	double		position[2][3];
+	double		rotation[2][3];
+	double		quaternion[2][4];
+	double		scale[2][3];
+
+	double		visualAlign[16];
+	double		bbMin[3];
+	double		bbMax[3];
+
+	//! a constructor
+	PhysicsCaptureGeometry();
+};
+
+struct PhysicsCapturePath
+{
+	double					matrix[16];
+
+	double					knotStep;		// closest knot search returns the knot index * step
+	std::vector<double>		knots;			// xyz
+
+	std::vector<double>		derivatives;	// xyz of the curve derivative query, uniform samples of u in [0; 1]
+
+	//! a constructor
+	PhysicsCapturePath();
+};
+
+struct PhysicsCaptureBody
+{
+	std::vector<char>			options;
+	int							convexHull;
+	PhysicsCaptureGeometry		geometry;
+};
+
+struct PhysicsCaptureCar
+{
+	std::vector<char>			options;
+	PhysicsCaptureGeometry		parts[PHYSICS_CAPTURE_CAR_PARTS];
+
+	int							hasPath;
+	PhysicsCapturePath			path;
+};
+
+struct PhysicsCaptureWorld
+{
+	double		scaling;
+	int			threads;
+	int			samples;
+	double		fps;
+	double		gravity[3];
+
+	int			hasMaterial;
+	double		material[5];		// softness, elasticity, collidable, static and dynamic friction
+};
+
+// car options changed during the capture
+struct PhysicsCaptureEvent
+{
+	int						frame;		// applied before the frame
+	int						car;
+	std::vector<char>		options;
+};
+
+struct PhysicsCaptureDiff
+{
+	int			numberOfFrames;		// compared frames
+	int			firstFrame;			// first frame over the tolerance or -1
+	int			worstFrame;
+	int			worstValue;			// index in the frame outputs
+	double		maxDiff;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class PhysicsCapture
+{
+public:
+
+	//! a constructor
+	PhysicsCapture();
+
+	void Clear();
+	//! keep the scene, remove frames and events
+	void ClearFrames();
+
+	PhysicsCaptureWorld						world;
+
+	int										hasLevel;
+	PhysicsCaptureGeometry					level;
+
+	std::vector<PhysicsCaptureBody>			bodies;
+	std::vector<PhysicsCaptureCar>			cars;
+
+	std::vector<PhysicsCaptureEvent>		events;
+
+	// frames, bodies and cars have to be added before the first frame
+
+	int GetNumberOfInputs() const { return (int) cars.size() * PHYSICS_CAPTURE_CAR_INPUTS; }
+	int GetNumberOfOutputs() const { return (int) cars.size() * PHYSICS_CAPTURE_CAR_OUTPUTS + (int) bodies.size() * PHYSICS_CAPTURE_BODY_OUTPUTS; }
+	int GetNumberOfFrames() const { return (int) mTimes.size(); }
+
+	//! returns the frame index, inputs and outputs are zero
+	int AddFrame(const double time, const int flags);
+
+	double GetFrameTime(const int frame) const { return mTimes[frame]; }
+	int GetFrameFlags(const int frame) const { return mFlags[frame]; }
+	void SetFrameFlags(const int frame, const int flags) { mFlags[frame] = flags; }
+
+	double *GetCarInputs(const int frame, const int car) { return &mInputs[frame * GetNumberOfInputs() + car * PHYSICS_CAPTURE_CAR_INPUTS]; }
+	const double *GetCarInputs(const int frame, const int car) const { return &mInputs[frame * GetNumberOfInputs() + car * PHYSICS_CAPTURE_CAR_INPUTS]; }
+
+	double *GetFrameOutputs(const int frame) { return &mOutputs[frame * GetNumberOfOutputs()]; }
+	const double *GetFrameOutputs(const int frame) const { return &mOutputs[frame * GetNumberOfOutputs()]; }
+
+	double *GetCarOutputs(const int frame, const int car) { return GetFrameOutputs(frame) + car * PHYSICS_CAPTURE_CAR_OUTPUTS; }
+	double *GetBodyOutputs(const int frame, const int body) {
+		return GetFrameOutputs(frame) + (int) cars.size() * PHYSICS_CAPTURE_CAR_OUTPUTS + body * PHYSICS_CAPTURE_BODY_OUTPUTS; }
+
+	//! temp file and a rename, false on a write error
+	bool Save(const char *filename) const;
+	//! false when the file is missing, truncated or has another version
+	bool Load(const char *filename);
+
+protected:
+
+	std::vector<double>		mTimes;
+	std::vector<int>		mFlags;
+	std::vector<double>		mInputs;		// GetNumberOfInputs per frame
+	std::vector<double>		mOutputs;		// GetNumberOfOutputs per frame
+};
+
+//! compare outputs of the frames with the outputs flag, scene layout has to be the same, false when there is a frame over the tolerance
+bool PhysicsCaptureCompare(const PhysicsCapture &reference, const PhysicsCapture &replay, const double tolerance, PhysicsCaptureDiff &diff);
+
+//! synthetic capture, checks the file round trip, a broken file and the frame comparison
+bool PhysicsCaptureSelfTest(const char *folder);
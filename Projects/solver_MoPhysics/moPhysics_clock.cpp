@@ -0,0 +1,495 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_clock.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "moPhysics_clock.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+// evaluation time which is a whole number of steps is not rounded up to the next step
+#define PHYSICS_CLOCK_EPSILON		1.0e-9
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PhysicsFixedClock
+
+PhysicsFixedClock::PhysicsFixedClock()
+{
+	mStep = 1.0 / 120.0;
+	Reset();
+}
+
+void PhysicsFixedClock::Reset()
+{
+	mStarted = false;
+	mOrigin = 0.0;
+	mIndex = 0;
+	mNewSteps = 0;
+	mAlpha = 1.0;
+}
+
+int PhysicsFixedClock::Advance(const double timeSecs, const bool allowSteps)
+{
+	mNewSteps = 0;
+
+	if (false == mStarted)
+	{
+		// reset state is the only state we have
+		mStarted = true;
+		mOrigin = timeSecs;
+		mIndex = 0;
+		mAlpha = 1.0;
+		return 0;
+	}
+
+	const double localTime = timeSecs - mOrigin;
+	const long long prevIndex = std::max(0LL, mIndex - 1);
+
+	if (localTime < (double) prevIndex * mStep)
+		return -1;
+
+	// the first state at or after the evaluation time, it depends only on the time
+	long long index = (long long) ceil(localTime / mStep - PHYSICS_CLOCK_EPSILON);
+	index = std::max(index, mIndex);
+
+	const int numberOfSteps = (int) (index - mIndex);
+
+	if (numberOfSteps > 0 && false == allowSteps)
+		return -1;
+
+	mNewSteps = numberOfSteps;
+	mIndex = index;
+
+	if (mIndex > 0)
+	{
+		const double alpha = localTime / mStep - (double) (mIndex - 1);
+		mAlpha = (alpha > 1.0 - PHYSICS_CLOCK_EPSILON) ? 1.0 : std::max(0.0, alpha);
+	}
+	else
+	{
+		mAlpha = 1.0;
+	}
+
+	return numberOfSteps;
+}
+
+double PhysicsFixedClock::GetStepTime(const int stepIndex) const
+{
+	const long long index = mIndex - mNewSteps + 1 + stepIndex;
+	return (double) index * mStep;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// interpolation
+
+static void MatrixToQuaternion(const double r[3][3], double *q)
+{
+	// r[column][row], q is x, y, z, w
+	const double trace = r[0][0] + r[1][1] + r[2][2];
+
+	if (trace > 0.0)
+	{
+		const double s = 2.0 * sqrt(trace + 1.0);
+		q[3] = 0.25 * s;
+		q[0] = (r[1][2] - r[2][1]) / s;
+		q[1] = (r[2][0] - r[0][2]) / s;
+		q[2] = (r[0][1] - r[1][0]) / s;
+	}
+	else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+	{
+		const double s = 2.0 * sqrt(1.0 + r[0][0] - r[1][1] - r[2][2]);
+		q[3] = (r[1][2] - r[2][1]) / s;
+		q[0] = 0.25 * s;
+		q[1] = (r[1][0] + r[0][1]) / s;
+		q[2] = (r[2][0] + r[0][2]) / s;
+	}
+	else if (r[1][1] > r[2][2])
+	{
+		const double s = 2.0 * sqrt(1.0 + r[1][1] - r[0][0] - r[2][2]);
+		q[3] = (r[2][0] - r[0][2]) / s;
+		q[0] = (r[1][0] + r[0][1]) / s;
+		q[1] = 0.25 * s;
+		q[2] = (r[2][1] + r[1][2]) / s;
+	}
+	else
+	{
+		const double s = 2.0 * sqrt(1.0 + r[2][2] - r[0][0] - r[1][1]);
+		q[3] = (r[0][1] - r[1][0]) / s;
+		q[0] = (r[2][0] + r[0][2]) / s;
+		q[1] = (r[2][1] + r[1][2]) / s;
+		q[2] = 0.25 * s;
+	}
+}
+
+static void QuaternionToMatrix(const double *q, double r[3][3])
+{
+	const double x = q[0], y = q[1], z = q[2], w = q[3];
+
+	r[0][0] = 1.0 - 2.0 * (y*y + z*z);
+	r[0][1] = 2.0 * (x*y + z*w);
+	r[0][2] = 2.0 * (x*z - y*w);
+
+	r[1][0] = 2.0 * (x*y - z*w);
+	r[1][1] = 1.0 - 2.0 * (x*x + z*z);
+	r[1][2] = 2.0 * (y*z + x*w);
+
+	r[2][0] = 2.0 * (x*z + y*w);
+	r[2][1] = 2.0 * (y*z - x*w);
+	r[2][2] = 1.0 - 2.0 * (x*x + y*y);
+}
+
+static void DecomposeMatrix(const double *m, double r[3][3], double *scale)
+{
+	for (int i=0; i<3; ++i)
+	{
+		const double *axis = m + 4 * i;
+		scale[i] = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+		const double inv = (scale[i] > 0.0) ? 1.0 / scale[i] : 0.0;
+		for (int j=0; j<3; ++j)
+			r[i][j] = axis[j] * inv;
+	}
+}
+
+void PhysicsInterpolateMatrix(const double *a, const double *b, const double alpha, double *result)
+{
+	if (alpha <= 0.0)
+	{
+		memcpy(result, a, sizeof(double) * 16);
+		return;
+	}
+	else if (alpha >= 1.0)
+	{
+		memcpy(result, b, sizeof(double) * 16);
+		return;
+	}
+
+	double ra[3][3], rb[3][3], sa[3], sb[3];
+	DecomposeMatrix(a, ra, sa);
+	DecomposeMatrix(b, rb, sb);
+
+	double qa[4], qb[4], q[4];
+	MatrixToQuaternion(ra, qa);
+	MatrixToQuaternion(rb, qb);
+
+	// shortest path
+	double cosTheta = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3];
+	if (cosTheta < 0.0)
+	{
+		cosTheta = -cosTheta;
+		for (int i=0; i<4; ++i)
+			qb[i] = -qb[i];
+	}
+
+	double wa = 1.0 - alpha;
+	double wb = alpha;
+
+	if (cosTheta < 0.9995)
+	{
+		const double theta = acos(cosTheta);
+		const double invSin = 1.0 / sin(theta);
+		wa = sin( (1.0 - alpha) * theta ) * invSin;
+		wb = sin( alpha * theta ) * invSin;
+	}
+
+	double len = 0.0;
+	for (int i=0; i<4; ++i)
+	{
+		q[i] = wa * qa[i] + wb * qb[i];
+		len += q[i] * q[i];
+	}
+
+	len = (len > 0.0) ? 1.0 / sqrt(len) : 0.0;
+	for (int i=0; i<4; ++i)
+		q[i] *= len;
+
+	double r[3][3];
+	QuaternionToMatrix(q, r);
+
+	for (int i=0; i<3; ++i)
+	{
+		const double scale = sa[i] + (sb[i] - sa[i]) * alpha;
+
+		for (int j=0; j<3; ++j)
+			result[4 * i + j] = r[i][j] * scale;
+		result[4 * i + 3] = 0.0;
+
+		result[12 + i] = a[12 + i] + (b[12 + i] - a[12 + i]) * alpha;
+	}
+	result[15] = 1.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// self test
+
+struct ClockTestState
+{
+	double	pos[3];
+	double	vel[3];
+	double	angle;
+	double	angularVel;
+};
+
+static void ClockTestInit(ClockTestState &state)
+{
+	memset(&state, 0, sizeof(ClockTestState) );
+	state.pos[1] = 2.0;
+	state.vel[0] = 3.0;
+	state.angularVel = 1.5;
+}
+
+// nonlinear enough to show any difference in the step sequence
+static void ClockTestStep(ClockTestState &state, const double dt)
+{
+	for (int i=0; i<3; ++i)
+	{
+		const double spring = -4.0 * state.pos[i];
+		const double drag = -0.3 * state.vel[i] * fabs(state.vel[i]);
+		const double gravity = (i == 1) ? -9.8 : 0.0;
+
+		state.vel[i] += (spring + drag + gravity) * dt;
+		state.pos[i] += state.vel[i] * dt;
+	}
+
+	state.angularVel += -0.5 * sin(state.angle) * dt;
+	state.angle += state.angularVel * dt;
+}
+
+static void ClockTestMatrix(const ClockTestState &state, double *m)
+{
+	memset(m, 0, sizeof(double) * 16);
+
+	const double c = cos(state.angle);
+	const double s = sin(state.angle);
+
+	m[0] = c;	m[2] = -s;
+	m[5] = 1.0;
+	m[8] = s;	m[10] = c;
+
+	m[12] = state.pos[0];
+	m[13] = state.pos[1];
+	m[14] = state.pos[2];
+	m[15] = 1.0;
+}
+
+struct ClockTestRun
+{
+	std::vector<ClockTestState>		states;		// state after every step
+	std::vector<double>				outputs;	// interpolated matrix of every frame
+	long long						numberOfSteps;
+};
+
+static void ClockTestFixed(const std::vector<double> &frameTimes, const double step, ClockTestRun &run)
+{
+	PhysicsFixedClock	clock;
+	clock.SetStep(step);
+
+	ClockTestState state;
+	ClockTestInit(state);
+
+	double prev[16], curr[16], m[16];
+	ClockTestMatrix(state, curr);
+	memcpy(prev, curr, sizeof(double) * 16);
+
+	run.states.clear();
+	run.outputs.clear();
+
+	for (auto iter=frameTimes.begin(); iter!=frameTimes.end(); ++iter)
+	{
+		const int numberOfSteps = clock.Advance(*iter, true);
+
+		for (int i=0; i<numberOfSteps; ++i)
+		{
+			ClockTestStep(state, clock.GetStep() );
+			run.states.push_back(state);
+
+			memcpy(prev, curr, sizeof(double) * 16);
+			ClockTestMatrix(state, curr);
+		}
+
+		PhysicsInterpolateMatrix(prev, curr, clock.GetAlpha(), m);
+		run.outputs.insert(run.outputs.end(), m, m + 16);
+	}
+
+	run.numberOfSteps = clock.GetNumberOfSteps();
+}
+
+// the previous scheme, one step of the frame delta
+static void ClockTestVariable(const std::vector<double> &frameTimes, ClockTestRun &run)
+{
+	ClockTestState state;
+	ClockTestInit(state);
+
+	double m[16];
+	run.states.clear();
+	run.outputs.clear();
+
+	for (size_t i=0; i<frameTimes.size(); ++i)
+	{
+		if (i > 0)
+			ClockTestStep(state, frameTimes[i] - frameTimes[i-1]);
+
+		ClockTestMatrix(state, m);
+		run.outputs.insert(run.outputs.end(), m, m + 16);
+	}
+
+	run.numberOfSteps = (long long) frameTimes.size();
+}
+
+// viewport frame times with a jitter, checkpoints are exact times in both sequences
+static void ClockTestFrameTimes(const double origin, const double duration, const double fps, unsigned int seed,
+	const std::vector<double> &checkpoints, std::vector<double> &times)
+{
+	times.clear();
+	times.push_back(origin);
+
+	double t = origin;
+	while (t < origin + duration)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		const double jitter = 0.6 + 0.8 * (double) (seed >> 8) / (double) (1u << 24);
+
+		t += jitter / fps;
+		times.push_back(t);
+	}
+
+	times.insert(times.end(), checkpoints.begin(), checkpoints.end() );
+	std::sort(times.begin() + 1, times.end() );
+}
+
+static int FindFrame(const std::vector<double> &times, const double t)
+{
+	auto iter = std::find(times.begin(), times.end(), t);
+	return (iter != times.end()) ? (int) (iter - times.begin()) : -1;
+}
+
+bool PhysicsClockSelfTest()
+{
+	bool result = true;
+	auto fnCheck = [&result] (const bool condition, const char *text) {
+		if (false == condition)
+		{
+			printf( "[MoPhysics] clock test failed - %s\n", text );
+			result = false;
+		}
+	};
+
+	const double step = 1.0 / 120.0;
+	const double origin = 1.0;
+	const double duration = 10.0;
+
+	std::vector<double> checkpoints;
+	for (int i=1; i<40; ++i)
+		checkpoints.push_back(origin + 0.25 * i);
+
+	std::vector<double> times30, times47;
+	ClockTestFrameTimes(origin, duration, 30.0, 17, checkpoints, times30);
+	ClockTestFrameTimes(origin, duration, 47.0, 91, checkpoints, times47);
+
+	// 1 - the same step sequence for different frame rates
+
+	ClockTestRun run30, run47, again30;
+	ClockTestFixed(times30, step, run30);
+	ClockTestFixed(times47, step, run47);
+	ClockTestFixed(times30, step, again30);
+
+	const size_t commonSteps = std::min(run30.states.size(), run47.states.size() );
+	fnCheck(commonSteps > 1000, "number of steps");
+	fnCheck(0 == memcmp(run30.states.data(), run47.states.data(), sizeof(ClockTestState) * commonSteps), "bit identical states");
+
+	const long long expectedSteps = (long long) ceil( (times30.back() - origin) / step - PHYSICS_CLOCK_EPSILON );
+	fnCheck(run30.numberOfSteps == expectedSteps && (long long) run30.states.size() == expectedSteps, "whole steps up to the last frame");
+
+	// 2 - repeated playback and checkpoints
+
+	fnCheck(run30.outputs == again30.outputs && run30.states.size() == again30.states.size()
+		&& 0 == memcmp(run30.states.data(), again30.states.data(), sizeof(ClockTestState) * run30.states.size() ), "repeated playback");
+
+	int numberOfCheckpoints = 0;
+	for (auto iter=checkpoints.begin(); iter!=checkpoints.end(); ++iter)
+	{
+		const int frame30 = FindFrame(times30, *iter);
+		const int frame47 = FindFrame(times47, *iter);
+
+		if (frame30 >= 0 && frame47 >= 0
+			&& 0 == memcmp(&run30.outputs[16 * frame30], &run47.outputs[16 * frame47], sizeof(double) * 16) )
+		{
+			numberOfCheckpoints += 1;
+		}
+	}
+	fnCheck(numberOfCheckpoints == (int) checkpoints.size(), "bit identical outputs at checkpoints");
+
+	// previous scheme for a reference, outputs depend on the frame rate
+	ClockTestRun var30, var47;
+	ClockTestVariable(times30, var30);
+	ClockTestVariable(times47, var47);
+
+	double variableDiff = 0.0;
+	for (auto iter=checkpoints.begin(); iter!=checkpoints.end(); ++iter)
+	{
+		const int frame30 = FindFrame(times30, *iter);
+		const int frame47 = FindFrame(times47, *iter);
+
+		for (int i=0; i<16; ++i)
+			variableDiff = std::max(variableDiff, fabs(var30.outputs[16 * frame30 + i] - var47.outputs[16 * frame47 + i]) );
+	}
+
+	// 3 - clock rules
+
+	PhysicsFixedClock clock;
+	clock.SetStep(0.1);
+
+	fnCheck(clock.Advance(5.0, true) == 0 && clock.GetAlpha() == 1.0, "origin");
+	fnCheck(clock.Advance(5.25, true) == 3 && clock.GetNumberOfSteps() == 3, "steps to bracket");
+	fnCheck(fabs(clock.GetAlpha() - 0.5) < 1.0e-9, "alpha");
+	fnCheck(fabs(clock.GetStepTime(0) - 0.1) < 1.0e-12 && fabs(clock.GetStepTime(2) - 0.3) < 1.0e-12, "step times");
+	fnCheck(fabs(clock.GetStepEvalTime(0) - 5.1) < 1.0e-12 && fabs(clock.GetStepEvalTime(2) - 5.3) < 1.0e-12, "step evaluation times");
+	fnCheck(clock.Advance(5.3, true) == 0 && clock.GetAlpha() == 1.0, "time on a step");
+	fnCheck(clock.Advance(5.22, false) == 0, "back into the bracket");
+	fnCheck(clock.Advance(5.5, false) == -1, "stopped playback");
+	fnCheck(clock.Advance(5.1, true) == -1, "behind the bracket");
+
+	clock.Reset();
+	fnCheck(clock.Advance(2.0, true) == 0 && clock.Advance(2.05, true) == 1, "reset");
+
+	// 4 - interpolation
+
+	double a[16], b[16], m[16];
+	ClockTestState state;
+	ClockTestInit(state);
+	ClockTestMatrix(state, a);
+	state.angle = 0.5 * 3.14159265358979323846;
+	state.pos[0] = 4.0;
+	ClockTestMatrix(state, b);
+
+	PhysicsInterpolateMatrix(a, b, 0.5, m);
+	fnCheck(fabs(m[0] - cos(0.25 * 3.14159265358979323846) ) < 1.0e-9 && fabs(m[12] - 2.0) < 1.0e-12, "half way");
+
+	PhysicsInterpolateMatrix(a, b, 1.0e-12, m);
+	double maxDiff = 0.0;
+	for (int i=0; i<16; ++i)
+		maxDiff = std::max(maxDiff, fabs(m[i] - a[i]) );
+	fnCheck(maxDiff < 1.0e-9, "interpolation start");
+
+	PhysicsInterpolateMatrix(a, b, 1.0, m);
+	fnCheck(0 == memcmp(m, b, sizeof(double) * 16), "interpolation end");
+
+	if (result)
+	{
+		printf( "[MoPhysics] clock test passed, %d steps, %d and %d frames, variable step checkpoint difference %g\n",
+			(int) run30.numberOfSteps, (int) times30.size(), (int) times47.size(), variableDiff );
+	}
+
+	return result;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_clock.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+	Fixed step physics clock
+
+	the world is always advanced in whole steps of 1 / PhysicsFPS, whatever frame rate the evaluation
+	 has. Step times are computed from the step index (index * step), never accumulated, so the same
+	 take gives the same sequence of steps and bit identical states on every playback.
+
+	The clock steps until the last state is at or after the evaluation time, outputs are an interpolation
+	 between the two states that bracket the evaluation time. Time of the first evaluation after a reset
+	 is the clock origin, step times are relative to it. The world gets an evaluation time of the step,
+	 origin plus step time, as it did before the fixed step.
+
+	No SDK dependency.
+*/
+
+class PhysicsFixedClock
+{
+public:
+
+	//! a constructor
+	PhysicsFixedClock();
+
+	void SetStep(const double stepSecs) { mStep = stepSecs; }
+	double GetStep() const { return mStep; }
+
+	//! the next advance is a new origin
+	void Reset();
+	bool IsStarted() const { return mStarted; }
+
+	/*! number of steps to do for the evaluation time
+		\param allowSteps - false when the playback is stopped, only the current bracket could be used
+		\return -1 when the time is behind the previous state or not in the bracket with no steps allowed
+	*/
+	int Advance(const double timeSecs, const bool allowSteps);
+
+	//! time of a new step since the origin, stepIndex is in [0; steps of the last advance)
+	double GetStepTime(const int stepIndex) const;
+
+	//! evaluation time of a new step for the world, origin + step time
+	double GetStepEvalTime(const int stepIndex) const { return mOrigin + GetStepTime(stepIndex); }
+
+	//! interpolation between the previous and the current state for the last advance, in [0; 1]
+	double GetAlpha() const { return mAlpha; }
+
+	//! steps since the reset
+	long long GetNumberOfSteps() const { return mIndex; }
+
+protected:
+
+	double			mStep;
+	bool			mStarted;
+	double			mOrigin;		// evaluation time of the reset state
+
+	long long		mIndex;			// current state is mIndex * mStep after the origin
+	int				mNewSteps;		// steps of the last advance
+	double			mAlpha;
+};
+
+//! translation and scale are linear, rotation is a shortest path slerp, matrices are 4x4 with translation in 12-14
+void PhysicsInterpolateMatrix(const double *a, const double *b, const double alpha, double *result);
+
+//! toy world stepped with different frame rates, checks that states and interpolated outputs are bit identical
+bool PhysicsClockSelfTest();
@@ -0,0 +1,1077 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_collisionCook.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "moPhysics_collisionCook.h"
+#include "IO\AtomicFile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#define COLLISION_COOK_MAGIC		0x4D43504D		// MPCM
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// helpers
+
+static void HashBytes(uint64_t &hash, const void *data, const size_t size)
+{
+	const unsigned char *ptr = (const unsigned char*) data;
+	for (size_t i=0; i<size; ++i)
+	{
+		hash ^= ptr[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+static inline void Sub(float *r, const float *a, const float *b)
+{
+	r[0] = a[0] - b[0];
+	r[1] = a[1] - b[1];
+	r[2] = a[2] - b[2];
+}
+
+static inline void Cross(float *r, const float *a, const float *b)
+{
+	r[0] = a[1] * b[2] - a[2] * b[1];
+	r[1] = a[2] * b[0] - a[0] * b[2];
+	r[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline float Dot(const float *a, const float *b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static float TriangleArea(const float *a, const float *b, const float *c)
+{
+	float e1[3], e2[3], n[3];
+	Sub(e1, b, a);
+	Sub(e2, c, a);
+	Cross(n, e1, e2);
+	return 0.5f * sqrtf(Dot(n, n) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CollisionSourceMesh
+
+CollisionSourceMesh::CollisionSourceMesh()
+	: positions(nullptr)
+	, numberOfVertices(0)
+	, positionStride(3)
+	, polyVertexCounts(nullptr)
+	, numberOfPolys(0)
+	, polyIndices(nullptr)
+{
+	for (int i=0; i<16; ++i)
+		matrix[i] = (i % 5 == 0) ? 1.0 : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// key
+
+uint64_t CollisionCookKey(const CollisionSourceMesh &src, const CollisionCookOptions &options)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	const int version = COLLISION_COOK_VERSION;
+	HashBytes(hash, &version, sizeof(int) );
+	HashBytes(hash, &options.weldDistance, sizeof(float) );
+	HashBytes(hash, &options.minArea, sizeof(float) );
+	HashBytes(hash, &options.leafSize, sizeof(int) );
+
+	HashBytes(hash, src.matrix, sizeof(double) * 16);
+
+	HashBytes(hash, &src.numberOfVertices, sizeof(int) );
+	if (3 == src.positionStride)
+	{
+		HashBytes(hash, src.positions, sizeof(float) * 3 * src.numberOfVertices);
+	}
+	else
+	{
+		const float *pos = src.positions;
+		for (int i=0; i<src.numberOfVertices; ++i, pos += src.positionStride)
+			HashBytes(hash, pos, sizeof(float) * 3);
+	}
+
+	int numberOfIndices = 0;
+	for (int i=0; i<src.numberOfPolys; ++i)
+		numberOfIndices += src.polyVertexCounts[i];
+
+	HashBytes(hash, &src.numberOfPolys, sizeof(int) );
+	HashBytes(hash, src.polyVertexCounts, sizeof(int) * src.numberOfPolys);
+	HashBytes(hash, src.polyIndices, sizeof(int) * numberOfIndices);
+
+	return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// triangulation
+
+// ear clipping on the plane of the polygon, a polygon without ears (self intersecting) is finished with a fan
+static void TriangulatePolygon(const float *positions, const int *polyIndices, const int count,
+	std::vector<int> &scratch, std::vector<int> &triangles)
+{
+	if (count < 3)
+		return;
+
+	if (3 == count)
+	{
+		triangles.push_back(polyIndices[0]);
+		triangles.push_back(polyIndices[1]);
+		triangles.push_back(polyIndices[2]);
+		return;
+	}
+
+	// newell normal and the projection axes
+	double n[3] = {0.0, 0.0, 0.0};
+	for (int i=0; i<count; ++i)
+	{
+		const float *a = positions + 3 * polyIndices[i];
+		const float *b = positions + 3 * polyIndices[(i+1) % count];
+
+		n[0] += ( (double) a[1] - b[1]) * ( (double) a[2] + b[2]);
+		n[1] += ( (double) a[2] - b[2]) * ( (double) a[0] + b[0]);
+		n[2] += ( (double) a[0] - b[0]) * ( (double) a[1] + b[1]);
+	}
+
+	int axis = 0;
+	if (fabs(n[1]) > fabs(n[axis]) ) axis = 1;
+	if (fabs(n[2]) > fabs(n[axis]) ) axis = 2;
+
+	int u = (axis + 1) % 3;
+	int v = (axis + 2) % 3;
+	if (n[axis] < 0.0)
+		std::swap(u, v);
+
+	auto fnPoint = [positions, polyIndices, u, v] (const int i, double &x, double &y) {
+		const float *p = positions + 3 * polyIndices[i];
+		x = p[u];
+		y = p[v];
+	};
+
+	scratch.resize(count);
+	for (int i=0; i<count; ++i)
+		scratch[i] = i;
+
+	int remain = count;
+	int guard = 2 * count;
+	int current = 0;
+
+	while (remain > 3 && guard > 0)
+	{
+		const int i0 = scratch[(current + remain - 1) % remain];
+		const int i1 = scratch[current % remain];
+		const int i2 = scratch[(current + 1) % remain];
+
+		double x0, y0, x1, y1, x2, y2;
+		fnPoint(i0, x0, y0);
+		fnPoint(i1, x1, y1);
+		fnPoint(i2, x2, y2);
+
+		const double area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+		bool isEar = (area > 0.0);
+
+		// no other vertex inside the ear
+		for (int k=0; isEar && k<remain; ++k)
+		{
+			const int ik = scratch[k];
+			if (ik == i0 || ik == i1 || ik == i2)
+				continue;
+
+			double x, y;
+			fnPoint(ik, x, y);
+
+			const double d0 = (x1 - x0) * (y - y0) - (x - x0) * (y1 - y0);
+			const double d1 = (x2 - x1) * (y - y1) - (x - x1) * (y2 - y1);
+			const double d2 = (x0 - x2) * (y - y2) - (x - x2) * (y0 - y2);
+
+			if (d0 >= 0.0 && d1 >= 0.0 && d2 >= 0.0)
+				isEar = false;
+		}
+
+		if (isEar)
+		{
+			triangles.push_back(polyIndices[i0]);
+			triangles.push_back(polyIndices[i1]);
+			triangles.push_back(polyIndices[i2]);
+
+			scratch.erase(scratch.begin() + (current % remain) );
+			remain -= 1;
+			guard = 2 * remain;
+			current = current % remain;
+		}
+		else
+		{
+			current = (current + 1) % remain;
+			guard -= 1;
+		}
+	}
+
+	// the rest as a fan
+	for (int k=1; k+1<remain; ++k)
+	{
+		triangles.push_back(polyIndices[scratch[0]]);
+		triangles.push_back(polyIndices[scratch[k]]);
+		triangles.push_back(polyIndices[scratch[k+1]]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// weld
+
+static uint64_t CellKey(const int64_t x, const int64_t y, const int64_t z)
+{
+	return ( (uint64_t) x * 73856093ULL) ^ ( (uint64_t) y * 19349663ULL) ^ ( (uint64_t) z * 83492791ULL);
+}
+
+// remap is the welded index of every vertex, the first vertex of a group keeps its position
+static int WeldVertices(const std::vector<float> &positions, const float distance, std::vector<int> &remap, std::vector<float> &welded)
+{
+	const int count = (int) positions.size() / 3;
+
+	remap.resize(count);
+	welded.clear();
+	welded.reserve(positions.size() );
+
+	if (distance <= 0.0f)
+	{
+		for (int i=0; i<count; ++i)
+			remap[i] = i;
+		welded = positions;
+		return count;
+	}
+
+	const double invCell = 1.0 / distance;
+	const float distSq = distance * distance;
+
+	std::vector<int64_t> cells(3 * count);
+	std::vector<std::pair<uint64_t, int>> sorted(count);
+
+	for (int i=0; i<count; ++i)
+	{
+		for (int k=0; k<3; ++k)
+			cells[3*i+k] = (int64_t) floor(positions[3*i+k] * invCell);
+
+		sorted[i] = std::make_pair(CellKey(cells[3*i], cells[3*i+1], cells[3*i+2]), i);
+	}
+
+	std::sort(sorted.begin(), sorted.end() );
+
+	int numberOfWelded = 0;
+
+	for (int i=0; i<count; ++i)
+	{
+		const float *p = &positions[3*i];
+		int found = -1;
+
+		// earlier vertices in the neighbour cells, compare with the position of their group
+		for (int dz=-1; dz<=1 && found < 0; ++dz)
+			for (int dy=-1; dy<=1 && found < 0; ++dy)
+				for (int dx=-1; dx<=1 && found < 0; ++dx)
+				{
+					const uint64_t key = CellKey(cells[3*i] + dx, cells[3*i+1] + dy, cells[3*i+2] + dz);
+					auto iter = std::lower_bound(sorted.begin(), sorted.end(), std::make_pair(key, 0) );
+
+					for ( ; iter != sorted.end() && iter->first == key && iter->second < i; ++iter)
+					{
+						const float *q = &welded[3 * remap[iter->second]];
+						float d[3];
+						Sub(d, p, q);
+
+						if (Dot(d, d) <= distSq)
+						{
+							found = remap[iter->second];
+							break;
+						}
+					}
+				}
+
+		if (found < 0)
+		{
+			found = numberOfWelded++;
+			welded.push_back(p[0]);
+			welded.push_back(p[1]);
+			welded.push_back(p[2]);
+		}
+		remap[i] = found;
+	}
+
+	return numberOfWelded;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// hierarchy
+
+struct BuildTriangle
+{
+	float	center[3];
+	float	bbMin[3];
+	float	bbMax[3];
+	int		index;
+};
+
+static int BuildNode(std::vector<CollisionMesh::Node> &nodes, std::vector<BuildTriangle> &tris, const int first, const int count, const int leafSize)
+{
+	const int nodeIndex = (int) nodes.size();
+	nodes.push_back(CollisionMesh::Node() );
+
+	float bbMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+	float bbMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+	float cMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+	float cMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+	for (int i=first; i<first+count; ++i)
+	{
+		for (int k=0; k<3; ++k)
+		{
+			bbMin[k] = std::min(bbMin[k], tris[i].bbMin[k]);
+			bbMax[k] = std::max(bbMax[k], tris[i].bbMax[k]);
+			cMin[k] = std::min(cMin[k], tris[i].center[k]);
+			cMax[k] = std::max(cMax[k], tris[i].center[k]);
+		}
+	}
+
+	int axis = 0;
+	for (int k=1; k<3; ++k)
+		if (cMax[k] - cMin[k] > cMax[axis] - cMin[axis])
+			axis = k;
+
+	CollisionMesh::Node node;
+	memcpy(node.bbMin, bbMin, sizeof(float) * 3);
+	memcpy(node.bbMax, bbMax, sizeof(float) * 3);
+
+	if (count <= leafSize || cMax[axis] - cMin[axis] <= 0.0f)
+	{
+		node.first = first;
+		node.count = count;
+		nodes[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	const int half = count / 2;
+	std::nth_element(tris.begin() + first, tris.begin() + first + half, tris.begin() + first + count,
+		[axis] (const BuildTriangle &a, const BuildTriangle &b) { return a.center[axis] < b.center[axis]; } );
+
+	BuildNode(nodes, tris, first, half, leafSize);
+	node.first = BuildNode(nodes, tris, first + half, count - half, leafSize);
+	node.count = 0;
+
+	nodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+static void BuildHierarchy(CollisionMesh &mesh, const int leafSize)
+{
+	const int numberOfTriangles = mesh.GetNumberOfTriangles();
+
+	std::vector<BuildTriangle> tris(numberOfTriangles);
+	for (int i=0; i<numberOfTriangles; ++i)
+	{
+		BuildTriangle &tri = tris[i];
+		tri.index = i;
+
+		for (int k=0; k<3; ++k)
+		{
+			tri.bbMin[k] = FLT_MAX;
+			tri.bbMax[k] = -FLT_MAX;
+		}
+
+		for (int j=0; j<3; ++j)
+		{
+			const float *p = &mesh.positions[3 * mesh.indices[3*i+j]];
+			for (int k=0; k<3; ++k)
+			{
+				tri.bbMin[k] = std::min(tri.bbMin[k], p[k]);
+				tri.bbMax[k] = std::max(tri.bbMax[k], p[k]);
+			}
+		}
+
+		for (int k=0; k<3; ++k)
+			tri.center[k] = 0.5f * (tri.bbMin[k] + tri.bbMax[k]);
+	}
+
+	mesh.nodes.clear();
+	mesh.nodes.reserve(2 * numberOfTriangles / std::max(1, leafSize) + 1);
+	BuildNode(mesh.nodes, tris, 0, numberOfTriangles, std::max(1, leafSize) );
+
+	// triangles in the leaf order
+	std::vector<int> indices(mesh.indices.size() );
+	for (int i=0; i<numberOfTriangles; ++i)
+		memcpy(&indices[3*i], &mesh.indices[3 * tris[i].index], sizeof(int) * 3);
+
+	mesh.indices.swap(indices);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// cook
+
+bool CollisionCook(const CollisionSourceMesh &src, const CollisionCookOptions &options, CollisionMesh &dst, CollisionCookStats *stats)
+{
+	CollisionCookStats localStats;
+	memset(&localStats, 0, sizeof(CollisionCookStats) );
+
+	dst.Clear();
+	dst.key = CollisionCookKey(src, options);
+
+	localStats.sourceVertices = src.numberOfVertices;
+	localStats.sourcePolys = src.numberOfPolys;
+
+	// 1 - world space
+
+	std::vector<float> worldPositions(3 * src.numberOfVertices);
+
+	const double *m = src.matrix;
+	const float *pos = src.positions;
+
+	for (int i=0; i<src.numberOfVertices; ++i, pos += src.positionStride)
+	{
+		const double x = pos[0], y = pos[1], z = pos[2];
+		double w = m[3] * x + m[7] * y + m[11] * z + m[15];
+		if (w == 0.0) w = 1.0;
+
+		worldPositions[3*i] = (float) ( (m[0] * x + m[4] * y + m[8] * z + m[12]) / w);
+		worldPositions[3*i+1] = (float) ( (m[1] * x + m[5] * y + m[9] * z + m[13]) / w);
+		worldPositions[3*i+2] = (float) ( (m[2] * x + m[6] * y + m[10] * z + m[14]) / w);
+	}
+
+	// 2 - triangulation
+
+	std::vector<int> triangles;
+	std::vector<int> scratch;
+	triangles.reserve(6 * src.numberOfPolys);
+
+	const int *polyIndices = src.polyIndices;
+	for (int i=0; i<src.numberOfPolys; ++i)
+	{
+		const int count = src.polyVertexCounts[i];
+
+		bool isValid = true;
+		for (int k=0; k<count; ++k)
+			if (polyIndices[k] < 0 || polyIndices[k] >= src.numberOfVertices)
+				isValid = false;
+
+		if (isValid)
+			TriangulatePolygon(worldPositions.data(), polyIndices, count, scratch, triangles);
+		else
+			printf( "[MoPhysics] collision cook, polygon %d has a wrong vertex index\n", i );
+
+		polyIndices += count;
+	}
+	localStats.triangulated = (int) triangles.size() / 3;
+
+	// 3 - weld
+
+	std::vector<int> remap;
+	std::vector<float> welded;
+	WeldVertices(worldPositions, options.weldDistance, remap, welded);
+
+	// 4 - degenerate triangles
+
+	std::vector<int> cleaned;
+	cleaned.reserve(triangles.size() );
+
+	for (size_t i=0; i<triangles.size(); i+=3)
+	{
+		const int a = remap[triangles[i]];
+		const int b = remap[triangles[i+1]];
+		const int c = remap[triangles[i+2]];
+
+		if (a == b || b == c || a == c
+			|| TriangleArea(&welded[3*a], &welded[3*b], &welded[3*c]) < options.minArea)
+		{
+			localStats.degenerate += 1;
+			continue;
+		}
+
+		cleaned.push_back(a);
+		cleaned.push_back(b);
+		cleaned.push_back(c);
+	}
+
+	// 5 - repeated triangles with the same winding, rotated to start with the smallest index
+
+	const int numberOfCleaned = (int) cleaned.size() / 3;
+	std::vector<std::pair<std::pair<int, int64_t>, int>> order(numberOfCleaned);
+
+	for (int i=0; i<numberOfCleaned; ++i)
+	{
+		int t[3] = { cleaned[3*i], cleaned[3*i+1], cleaned[3*i+2] };
+		while (t[0] > t[1] || t[0] > t[2])
+		{
+			const int first = t[0];
+			t[0] = t[1];
+			t[1] = t[2];
+			t[2] = first;
+		}
+		order[i] = std::make_pair(std::make_pair(t[0], ( (int64_t) t[1] << 32) | (uint32_t) t[2]), i);
+	}
+	std::sort(order.begin(), order.end() );
+
+	std::vector<char> keep(numberOfCleaned, 1);
+	for (int i=1; i<numberOfCleaned; ++i)
+	{
+		if (order[i].first == order[i-1].first)
+		{
+			keep[order[i].second] = 0;
+			localStats.duplicates += 1;
+		}
+	}
+
+	// 6 - compact vertices in the order of use
+
+	std::vector<int> vertexMap(welded.size() / 3, -1);
+
+	for (int i=0; i<numberOfCleaned; ++i)
+	{
+		if (0 == keep[i])
+			continue;
+
+		for (int k=0; k<3; ++k)
+		{
+			int &index = vertexMap[cleaned[3*i+k]];
+			if (index < 0)
+			{
+				index = (int) dst.positions.size() / 3;
+				const float *p = &welded[3 * cleaned[3*i+k]];
+				dst.positions.insert(dst.positions.end(), p, p + 3);
+			}
+			dst.indices.push_back(index);
+		}
+	}
+	localStats.weldedVertices = dst.GetNumberOfVertices();
+
+	// 7 - hierarchy
+
+	if (dst.GetNumberOfTriangles() > 0)
+		BuildHierarchy(dst, options.leafSize);
+
+	if (stats)
+		*stats = localStats;
+
+	return dst.GetNumberOfTriangles() > 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CollisionMesh
+
+void CollisionMesh::Clear()
+{
+	key = 0;
+	positions.clear();
+	indices.clear();
+	nodes.clear();
+}
+
+static bool RayBox(const float *origin, const float *invDir, const float *bbMin, const float *bbMax, const float maxDist)
+{
+	float tmin = 0.0f;
+	float tmax = maxDist;
+
+	for (int k=0; k<3; ++k)
+	{
+		float t1 = (bbMin[k] - origin[k]) * invDir[k];
+		float t2 = (bbMax[k] - origin[k]) * invDir[k];
+		if (t1 > t2) std::swap(t1, t2);
+
+		// nan of a zero direction on the slab border keeps the box
+		if (t1 > tmin) tmin = t1;
+		if (t2 < tmax) tmax = t2;
+		if (tmin > tmax)
+			return false;
+	}
+	return true;
+}
+
+// double sided
+static bool RayTriangle(const float *origin, const float *dir, const float *a, const float *b, const float *c, float &t)
+{
+	float e1[3], e2[3], pv[3], tv[3], qv[3];
+	Sub(e1, b, a);
+	Sub(e2, c, a);
+	Cross(pv, dir, e2);
+
+	const float det = Dot(e1, pv);
+	if (fabsf(det) < 1.0e-12f)
+		return false;
+
+	const float invDet = 1.0f / det;
+	Sub(tv, origin, a);
+
+	const float u = Dot(tv, pv) * invDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	Cross(qv, tv, e1);
+	const float v = Dot(dir, qv) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	t = Dot(e2, qv) * invDet;
+	return t >= 0.0f;
+}
+
+int CollisionMesh::RayCast(const float *origin, const float *dir, const float maxDist, float &hitDist) const
+{
+	if (nodes.size() == 0)
+		return -1;
+
+	float invDir[3];
+	for (int k=0; k<3; ++k)
+		invDir[k] = (dir[k] != 0.0f) ? 1.0f / dir[k] : FLT_MAX;
+
+	int result = -1;
+	float closest = maxDist;
+
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const int nodeIndex = stack[--stackSize];
+		const Node &node = nodes[nodeIndex];
+
+		if (false == RayBox(origin, invDir, node.bbMin, node.bbMax, closest) )
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i=node.first; i<node.first+node.count; ++i)
+			{
+				float t;
+				if (RayTriangle(origin, dir, &positions[3 * indices[3*i]], &positions[3 * indices[3*i+1]],
+					&positions[3 * indices[3*i+2]], t) && t <= closest)
+				{
+					closest = t;
+					result = i;
+				}
+			}
+		}
+		else if (stackSize + 2 <= 64)
+		{
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = nodeIndex + 1;
+		}
+	}
+
+	if (result >= 0)
+		hitDist = closest;
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CollisionCookCache
+
+struct CollisionCookHeader
+{
+	unsigned int	magic;
+	unsigned int	version;
+	uint64_t		key;
+	unsigned int	numberOfPositions;
+	unsigned int	numberOfIndices;
+	unsigned int	numberOfNodes;
+	unsigned int	reserved;
+};
+
+CollisionCookCache::CollisionCookCache()
+{}
+
+bool CollisionCookCache::SetFolder(const char *folder)
+{
+	mFolder = (folder) ? folder : "";
+
+	if (mFolder.size() == 0)
+		return true;
+
+	const char last = mFolder.back();
+	if (last != '\\' && last != '/')
+		mFolder.push_back('/');
+
+	const std::string path = mFolder.substr(0, mFolder.size() - 1);
+#ifdef _WIN32
+	_mkdir(path.c_str() );
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+
+	// check that an entry could be written
+	const std::string testFilename = mFolder + "write.test";
+	FILE *fp = fopen(testFilename.c_str(), "wb");
+	if (nullptr == fp)
+	{
+		printf( "[MoPhysics] collision cache folder is not writable - %s\n", mFolder.c_str() );
+		mFolder.clear();
+		return false;
+	}
+
+	fclose(fp);
+	remove(testFilename.c_str() );
+	return true;
+}
+
+std::string CollisionCookCache::GetFilename(const uint64_t key) const
+{
+	char buffer[64];
+	sprintf_s(buffer, sizeof(buffer), "col_%016llx.bin", (unsigned long long) key);
+	return mFolder + buffer;
+}
+
+bool CollisionCookCache::Load(const uint64_t key, CollisionMesh &mesh) const
+{
+	if (false == IsEnabled() )
+		return false;
+
+	FILE *fp = fopen(GetFilename(key).c_str(), "rb");
+	if (nullptr == fp)
+		return false;
+
+	CollisionCookHeader header;
+	bool isOk = (1 == fread(&header, sizeof(CollisionCookHeader), 1, fp) )
+		&& COLLISION_COOK_MAGIC == header.magic
+		&& COLLISION_COOK_VERSION == header.version
+		&& key == header.key
+		&& header.numberOfPositions % 3 == 0
+		&& header.numberOfIndices % 3 == 0;
+
+	if (isOk)
+	{
+		mesh.key = key;
+		mesh.positions.resize(header.numberOfPositions);
+		mesh.indices.resize(header.numberOfIndices);
+		mesh.nodes.resize(header.numberOfNodes);
+
+		isOk = (fread(mesh.positions.data(), sizeof(float), header.numberOfPositions, fp) == header.numberOfPositions)
+			&& (fread(mesh.indices.data(), sizeof(int), header.numberOfIndices, fp) == header.numberOfIndices)
+			&& (fread(mesh.nodes.data(), sizeof(CollisionMesh::Node), header.numberOfNodes, fp) == header.numberOfNodes);
+	}
+	fclose(fp);
+
+	// a broken entry is cooked again
+	if (isOk)
+	{
+		const int numberOfVertices = mesh.GetNumberOfVertices();
+		for (auto iter=mesh.indices.begin(); isOk && iter!=mesh.indices.end(); ++iter)
+			isOk = (*iter >= 0 && *iter < numberOfVertices);
+
+		const int numberOfNodes = (int) mesh.nodes.size();
+		const int numberOfTriangles = mesh.GetNumberOfTriangles();
+		for (auto iter=mesh.nodes.begin(); isOk && iter!=mesh.nodes.end(); ++iter)
+			isOk = (iter->count > 0) ? (iter->first >= 0 && iter->first + iter->count <= numberOfTriangles)
+				: (iter->first > 0 && iter->first < numberOfNodes);
+	}
+
+	if (false == isOk)
+		mesh.Clear();
+	return isOk;
+}
+
+bool CollisionCookCache::Store(const CollisionMesh &mesh) const
+{
+	if (false == IsEnabled() )
+		return false;
+
+	const std::string filename = GetFilename(mesh.key);
+
+	AtomicFileWriter writer;
+	if (false == writer.Open(filename.c_str() ) )
+		return false;
+
+	CollisionCookHeader header;
+	memset(&header, 0, sizeof(CollisionCookHeader) );
+	header.magic = COLLISION_COOK_MAGIC;
+	header.version = COLLISION_COOK_VERSION;
+	header.key = mesh.key;
+	header.numberOfPositions = (unsigned int) mesh.positions.size();
+	header.numberOfIndices = (unsigned int) mesh.indices.size();
+	header.numberOfNodes = (unsigned int) mesh.nodes.size();
+
+	writer.Write(&header, sizeof(CollisionCookHeader) );
+	writer.Write(mesh.positions.data(), sizeof(float) * mesh.positions.size() );
+	writer.Write(mesh.indices.data(), sizeof(int) * mesh.indices.size() );
+	writer.Write(mesh.nodes.data(), sizeof(CollisionMesh::Node) * mesh.nodes.size() );
+
+	return writer.Commit();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// self test
+
+// terrain of quads with a height wave, every row is a separate strip with own vertices (split seams)
+//  plus concave n-gon plates, collapsed quads and a repeated quad
+struct SelfTestLevel
+{
+	std::vector<float>	positions;
+	std::vector<int>	counts;
+	std::vector<int>	indices;
+
+	int AddVertex(const float x, const float y, const float z)
+	{
+		positions.push_back(x);
+		positions.push_back(y);
+		positions.push_back(z);
+		return (int) positions.size() / 3 - 1;
+	}
+
+	void AddPoly(const int *poly, const int count)
+	{
+		counts.push_back(count);
+		indices.insert(indices.end(), poly, poly + count);
+	}
+};
+
+static void BuildSelfTestLevel(SelfTestLevel &level, const int size)
+{
+	auto fnHeight = [] (const int x, const int z) {
+		return 2.0f * sinf(0.1f * x) * cosf(0.13f * z);
+	};
+
+	for (int z=0; z<size; ++z)
+	{
+		const int base = (int) level.positions.size() / 3;
+		for (int row=0; row<2; ++row)
+			for (int x=0; x<=size; ++x)
+				level.AddVertex( (float) x, fnHeight(x, z+row), (float) (z+row) );
+
+		for (int x=0; x<size; ++x)
+		{
+			const int quad[4] = { base + x, base + (size+1) + x, base + (size+1) + x + 1, base + x + 1 };
+			level.AddPoly(quad, 4);
+		}
+	}
+
+	// L shaped concave hexagons above the terrain, area is 3
+	for (int i=0; i<8; ++i)
+	{
+		const float ox = 4.0f * i;
+		const float y = 10.0f;
+		const int poly[6] = {
+			level.AddVertex(ox, y, 0.0f), level.AddVertex(ox, y, 2.0f), level.AddVertex(ox + 1.0f, y, 2.0f),
+			level.AddVertex(ox + 1.0f, y, 1.0f), level.AddVertex(ox + 2.0f, y, 1.0f), level.AddVertex(ox + 2.0f, y, 0.0f) };
+		level.AddPoly(poly, 6);
+	}
+
+	// collapsed quads and a line
+	for (int i=0; i<4; ++i)
+	{
+		const int a = level.AddVertex(1.0f * i, 20.0f, 0.0f);
+		const int b = level.AddVertex(1.0f * i + 0.0001f, 20.0f, 0.0f);
+		const int c = level.AddVertex(1.0f * i, 20.0f, 1.0f);
+		const int quad[4] = { a, b, c, c };
+		level.AddPoly(quad, 4);
+	}
+
+	// a repeated quad of the terrain
+	{
+		const int quad[4] = { level.indices[0], level.indices[1], level.indices[2], level.indices[3] };
+		level.AddPoly(quad, 4);
+	}
+}
+
+static float MeshArea(const CollisionMesh &mesh, const float minY, const float maxY)
+{
+	float area = 0.0f;
+	for (int i=0; i<mesh.GetNumberOfTriangles(); ++i)
+	{
+		const float *a = &mesh.positions[3 * mesh.indices[3*i]];
+		const float *b = &mesh.positions[3 * mesh.indices[3*i+1]];
+		const float *c = &mesh.positions[3 * mesh.indices[3*i+2]];
+
+		if (a[1] >= minY && a[1] <= maxY)
+			area += TriangleArea(a, b, c);
+	}
+	return area;
+}
+
+bool CollisionCookSelfTest(const char *folder)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	bool result = true;
+	auto fnCheck = [&result] (const bool condition, const char *text) {
+		if (false == condition)
+		{
+			printf( "[MoPhysics] collision cook test FAILED - %s\n", text );
+			result = false;
+		}
+	};
+
+	const int size = 512;
+
+	SelfTestLevel level;
+	BuildSelfTestLevel(level, size);
+
+	CollisionSourceMesh src;
+	src.positions = level.positions.data();
+	src.numberOfVertices = (int) level.positions.size() / 3;
+	src.positionStride = 3;
+	src.polyVertexCounts = level.counts.data();
+	src.numberOfPolys = (int) level.counts.size();
+	src.polyIndices = level.indices.data();
+	src.matrix[12] = 100.0;		// translation
+
+	CollisionCookOptions options;
+
+	// 1 - cook
+
+	CollisionMesh mesh;
+	CollisionCookStats stats;
+
+	auto startTime = clock::now();
+	const bool isCooked = CollisionCook(src, options, mesh, &stats);
+	const double cookMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+	fnCheck(isCooked, "cook");
+
+	const int terrainVertices = (size + 1) * (size + 1);
+	const int expectedTriangles = 2 * size * size + 8 * 4;
+
+	fnCheck(stats.weldedVertices == terrainVertices + 8 * 6, "welded vertices");
+	fnCheck(mesh.GetNumberOfTriangles() == expectedTriangles, "number of triangles");
+	fnCheck(stats.degenerate >= 4, "degenerate triangles");
+	fnCheck(stats.duplicates == 2, "repeated triangles");
+	fnCheck(fabsf(MeshArea(mesh, 9.0f, 11.0f) - 8.0f * 3.0f) < 1.0e-3f, "concave polygons area");
+
+	bool indicesOk = true;
+	for (int i=0; i<mesh.GetNumberOfTriangles(); ++i)
+	{
+		const int *t = &mesh.indices[3*i];
+		if (t[0] == t[1] || t[1] == t[2] || t[0] == t[2])
+			indicesOk = false;
+	}
+	fnCheck(indicesOk, "no collapsed triangles");
+	fnCheck(mesh.positions[0] >= 100.0f, "world matrix");
+
+	// 2 - ray casts against all triangles
+
+	int mismatches = 0;
+	const int numberOfRays = 256;
+	unsigned int seed = 17;
+	auto fnRandom = [&seed] () {
+		seed = seed * 1664525u + 1013904223u;
+		return (float) (seed >> 8) / (float) (1 << 24);
+	};
+
+	double bvhMs = 0.0;
+	double bruteMs = 0.0;
+	int numberOfHits = 0;
+
+	for (int r=0; r<numberOfRays; ++r)
+	{
+		const float origin[3] = { 100.0f + fnRandom() * size, 30.0f, fnRandom() * size };
+		float dir[3] = { fnRandom() - 0.5f, -1.0f, fnRandom() - 0.5f };
+		const float len = sqrtf(Dot(dir, dir) );
+		for (int k=0; k<3; ++k)
+			dir[k] /= len;
+
+		float dist = 0.0f;
+		startTime = clock::now();
+		const int hit = mesh.RayCast(origin, dir, 1000.0f, dist);
+		bvhMs += std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		startTime = clock::now();
+		float bruteDist = 1000.0f;
+		int bruteHit = -1;
+		for (int i=0; i<mesh.GetNumberOfTriangles(); ++i)
+		{
+			float t;
+			if (RayTriangle(origin, dir, &mesh.positions[3 * mesh.indices[3*i]], &mesh.positions[3 * mesh.indices[3*i+1]],
+				&mesh.positions[3 * mesh.indices[3*i+2]], t) && t <= bruteDist)
+			{
+				bruteDist = t;
+				bruteHit = i;
+			}
+		}
+		bruteMs += std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		if ( (hit >= 0) != (bruteHit >= 0) || (hit >= 0 && fabsf(dist - bruteDist) > 1.0e-3f) )
+			mismatches += 1;
+		if (hit >= 0)
+			numberOfHits += 1;
+	}
+	fnCheck(0 == mismatches, "ray casts");
+	fnCheck(numberOfHits > numberOfRays / 2, "ray hits");
+
+	// 3 - keys
+
+	const uint64_t key = CollisionCookKey(src, options);
+	fnCheck(key == mesh.key, "mesh key");
+
+	CollisionSourceMesh moved(src);
+	moved.matrix[13] = 1.0;
+	fnCheck(CollisionCookKey(moved, options) != key, "matrix in the key");
+
+	std::vector<float> edited(level.positions);
+	edited[1] += 0.5f;
+	CollisionSourceMesh editedSrc(src);
+	editedSrc.positions = edited.data();
+	fnCheck(CollisionCookKey(editedSrc, options) != key, "positions in the key");
+
+	// 4 - cache round trip
+
+	CollisionCookCache cache;
+	fnCheck(cache.SetFolder(folder), "cache folder");
+	remove(cache.GetFilename(key).c_str() );
+
+	CollisionMesh loaded;
+	fnCheck(false == cache.Load(key, loaded), "missing entry");
+	fnCheck(cache.Store(mesh), "store");
+
+	startTime = clock::now();
+	const uint64_t loadKey = CollisionCookKey(src, options);
+	const bool isLoaded = cache.Load(loadKey, loaded);
+	const double loadMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+	fnCheck(isLoaded, "load");
+	fnCheck(loaded.positions == mesh.positions && loaded.indices == mesh.indices
+		&& loaded.nodes.size() == mesh.nodes.size()
+		&& 0 == memcmp(loaded.nodes.data(), mesh.nodes.data(), sizeof(CollisionMesh::Node) * mesh.nodes.size() ), "loaded data");
+
+	fnCheck(false == cache.Load(key ^ 1, loaded), "wrong key");
+
+	// truncated entry
+	{
+		const std::string filename = cache.GetFilename(key);
+		FILE *fp = fopen(filename.c_str(), "r+b");
+		if (fp)
+		{
+			fclose(fp);
+			fp = fopen(filename.c_str(), "wb");
+			CollisionCookHeader header;
+			memset(&header, 0, sizeof(CollisionCookHeader) );
+			header.magic = COLLISION_COOK_MAGIC;
+			header.version = COLLISION_COOK_VERSION;
+			header.key = key;
+			header.numberOfPositions = 300;
+			fwrite(&header, sizeof(CollisionCookHeader), 1, fp);
+			fclose(fp);
+		}
+		fnCheck(false == cache.Load(key, loaded), "truncated entry");
+		remove(filename.c_str() );
+	}
+
+	printf( "[MoPhysics] collision cook, %d polys -> %d triangles, %d vertices -> %d, %d degenerate, %d repeated\n",
+		stats.sourcePolys, mesh.GetNumberOfTriangles(), stats.sourceVertices, stats.weldedVertices, stats.degenerate, stats.duplicates );
+	printf( "[MoPhysics] cook %.2f ms, cache load %.2f ms, %d rays - hierarchy %.2f ms, brute force %.2f ms\n",
+		cookMs, loadMs, numberOfRays, bvhMs, bruteMs );
+	printf( "[MoPhysics] collision cook test %s\n", (result) ? "passed" : "FAILED" );
+
+	return result;
+}
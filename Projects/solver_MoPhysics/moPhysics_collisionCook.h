@@ -0,0 +1,140 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_collisionCook.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/*
+	Cooked collision mesh
+
+	level geometry comes from the tessellated meshes of the scene models. Cooking moves vertices into
+	 the world space, triangulates polygons of any vertex count (ear clipping on the polygon plane),
+	 welds vertices closer than a tolerance, removes degenerate and repeated triangles and builds
+	 a bounding volume hierarchy. Triangles are stored in the leaf order of the hierarchy.
+
+	A cooked mesh is stored on disk per model. The key is a hash of the vertex positions, polygon
+	 layout, world matrix and cook options, an unchanged model is loaded back without any processing.
+	 No SDK dependency.
+*/
+
+#define COLLISION_COOK_VERSION		1
+
+struct CollisionCookOptions
+{
+	float		weldDistance;		// vertices closer than the distance are merged
+	float		minArea;			// triangles with a smaller area are removed
+	int			leafSize;			// max triangles in a hierarchy leaf
+
+	//! a constructor
+	CollisionCookOptions()
+		: weldDistance(0.001f)
+		, minArea(1.0e-8f)
+		, leafSize(4)
+	{}
+};
+
+// model space polygon mesh, memory is owned by the caller
+struct CollisionSourceMesh
+{
+	const float		*positions;
+	int				numberOfVertices;
+	int				positionStride;		// number of floats between vertices
+
+	const int		*polyVertexCounts;
+	int				numberOfPolys;
+	const int		*polyIndices;		// vertex indices of all polygons one after another
+
+	double			matrix[16];			// model to world, column major
+
+	//! a constructor
+	CollisionSourceMesh();
+};
+
+struct CollisionCookStats
+{
+	int		sourceVertices;
+	int		sourcePolys;
+	int		triangulated;		// triangles after triangulation
+	int		weldedVertices;		// vertices after weld
+	int		degenerate;			// removed triangles with a zero area or collapsed edges
+	int		duplicates;			// removed repeated triangles
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+struct CollisionMesh
+{
+	struct Node
+	{
+		float		bbMin[3];
+		float		bbMax[3];
+		int			first;		// leaf - first triangle, inner node - index of the right child (left is the next one)
+		int			count;		// leaf - number of triangles, inner node - 0
+	};
+
+	uint64_t				key;
+
+	std::vector<float>		positions;		// xyz, world space
+	std::vector<int>		indices;		// 3 per triangle, in the leaf order
+	std::vector<Node>		nodes;			// root is the first one
+
+	//! a constructor
+	CollisionMesh()
+		: key(0)
+	{}
+
+	void Clear();
+
+	int GetNumberOfVertices() const { return (int) positions.size() / 3; }
+	int GetNumberOfTriangles() const { return (int) indices.size() / 3; }
+
+	//! closest hit along the ray within maxDist, returns the triangle index or -1
+	int RayCast(const float *origin, const float *dir, const float maxDist, float &hitDist) const;
+};
+
+//! key of the source data and options, position data is hashed as is
+uint64_t CollisionCookKey(const CollisionSourceMesh &src, const CollisionCookOptions &options);
+
+//! triangulate, weld, clean and build a hierarchy, false when nothing is left
+bool CollisionCook(const CollisionSourceMesh &src, const CollisionCookOptions &options, CollisionMesh &dst, CollisionCookStats *stats=nullptr);
+
+//////////////////////////////////////////////////////////////////
+//
+
+class CollisionCookCache
+{
+public:
+
+	//! a constructor
+	CollisionCookCache();
+
+	//! creates the folder, false when it's not writable and the cache is off
+	bool SetFolder(const char *folder);
+	bool IsEnabled() const { return mFolder.size() > 0; }
+
+	std::string GetFilename(const uint64_t key) const;
+
+	//! false when the entry is missing or doesn't match the key and version
+	bool Load(const uint64_t key, CollisionMesh &mesh) const;
+	bool Store(const CollisionMesh &mesh) const;
+
+protected:
+
+	std::string		mFolder;
+};
+
+//! synthetic level with quads, concave n-gons, split seams and degenerate polygons, checks cook results,
+//!  ray casts against brute force and the cache round trip, prints cook and load time
+bool CollisionCookSelfTest(const char *folder);
@@ -0,0 +1,304 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_evaluation.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "moPhysics_evaluation.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PhysicsEvaluationCache
+
+PhysicsEvaluationCache::PhysicsEvaluationCache()
+{
+	Clear();
+	ResetStats();
+}
+
+void PhysicsEvaluationCache::Clear()
+{
+	mSlots.clear();
+	mSlotIndices.clear();
+
+	mHasTick = false;
+	mEvaluationId = 0;
+	mTime = 0;
+	mTick = 0;
+	mTickResult = false;
+}
+
+int PhysicsEvaluationCache::AddSlot(const void *node)
+{
+	auto iter = mSlotIndices.find(node);
+	if (iter != mSlotIndices.end() )
+		return iter->second;
+
+	Slot slot;
+	slot.node = node;
+	slot.tick = -1;
+	slot.data[0] = slot.data[1] = slot.data[2] = 0.0;
+
+	const int index = (int) mSlots.size();
+	mSlots.push_back(slot);
+	mSlotIndices[node] = index;
+
+	return index;
+}
+
+int PhysicsEvaluationCache::FindSlot(const void *node) const
+{
+	auto iter = mSlotIndices.find(node);
+	return (iter != mSlotIndices.end() ) ? iter->second : -1;
+}
+
+void PhysicsEvaluationCache::SetSlotData(const int slot, const double *data)
+{
+	Slot &s = mSlots[slot];
+	s.data[0] = data[0];
+	s.data[1] = data[1];
+	s.data[2] = data[2];
+	s.tick = mTick;
+}
+
+bool PhysicsEvaluationCache::BeginTick(const int evaluationId, const long long time)
+{
+	if (mHasTick && evaluationId == mEvaluationId && time == mTime)
+		return false;
+
+	mHasTick = true;
+	mEvaluationId = evaluationId;
+	mTime = time;
+	mTick += 1;
+	mTickResult = false;
+
+	mStats.ticks += 1;
+	return true;
+}
+
+void PhysicsEvaluationCache::EndTick(const bool result)
+{
+	mTickResult = result;
+}
+
+void PhysicsEvaluationCache::ResetStats()
+{
+	memset(&mStats, 0, sizeof(PhysicsEvaluationStats) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// synthetic benchmark
+
+#define PHYSICS_BENCHMARK_CAR_OBJECTS		5		// chassis and 4 wheels
+#define PHYSICS_BENCHMARK_CAR_INPUTS		7		// torque, clutch, steering, blend, brake, handbrake, gear
+
+struct BenchmarkCar
+{
+	double		inputs[PHYSICS_BENCHMARK_CAR_INPUTS];
+	double		matrices[PHYSICS_BENCHMARK_CAR_OBJECTS][16];
+	int			nodes[PHYSICS_BENCHMARK_CAR_OBJECTS * 2];		// keys of translation and rotation nodes
+};
+
+// column major, translation in 12..14, rotation is XYZ euler in degrees
+static void BenchmarkMatrixToTRS(const double *m, double *t, double *r, double *s)
+{
+	t[0] = m[12];
+	t[1] = m[13];
+	t[2] = m[14];
+
+	s[0] = sqrt(m[0]*m[0] + m[1]*m[1] + m[2]*m[2]);
+	s[1] = sqrt(m[4]*m[4] + m[5]*m[5] + m[6]*m[6]);
+	s[2] = sqrt(m[8]*m[8] + m[9]*m[9] + m[10]*m[10]);
+
+	const double toDeg = 57.295779513082321;
+	const double sy = -m[2] / s[0];
+
+	r[1] = asin( (sy > 1.0) ? 1.0 : (sy < -1.0) ? -1.0 : sy ) * toDeg;
+	r[0] = atan2(m[6] / s[1], m[10] / s[2]) * toDeg;
+	r[2] = atan2(m[1] / s[0], m[0] / s[0]) * toDeg;
+}
+
+static void BenchmarkStep(std::vector<BenchmarkCar> &cars, const double dt)
+{
+	for (auto iter=cars.begin(); iter!=cars.end(); ++iter)
+	{
+		const double speed = iter->inputs[0] * (1.0 - iter->inputs[4]);
+
+		for (int i=0; i<PHYSICS_BENCHMARK_CAR_OBJECTS; ++i)
+		{
+			double *m = iter->matrices[i];
+			m[14] += speed * dt;
+
+			if (i > 0)
+			{
+				// wheel spin around x
+				const double a = speed * dt;
+				const double c = cos(a);
+				const double sn = sin(a);
+
+				const double m5 = m[5], m6 = m[6], m9 = m[9], m10 = m[10];
+				m[5] = c * m5 - sn * m9;
+				m[6] = c * m6 - sn * m10;
+				m[9] = sn * m5 + c * m9;
+				m[10] = sn * m6 + c * m10;
+			}
+		}
+	}
+}
+
+void PhysicsEvaluationBenchmark(const int maxNumberOfCars, const int numberOfFrames)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	printf( "[MoPhysics] evaluation benchmark, %d frames, work per frame\n", numberOfFrames );
+	printf( "[MoPhysics] %6s %9s | %12s %12s %10s | %12s %12s %10s\n",
+		"cars", "notifies", "old reads", "old convs", "old ms", "new reads", "new convs", "new ms" );
+
+	const double dt = 1.0 / 30.0;
+	volatile double sink = 0.0;
+
+	for (int numberOfCars=1; numberOfCars<=maxNumberOfCars; numberOfCars *= 2)
+	{
+		std::vector<BenchmarkCar>	cars(numberOfCars);
+		std::vector<const void*>	notifyNodes;
+
+		for (int c=0; c<numberOfCars; ++c)
+		{
+			BenchmarkCar &car = cars[c];
+
+			for (int i=0; i<PHYSICS_BENCHMARK_CAR_INPUTS; ++i)
+				car.inputs[i] = 0.1 * (i + 1);
+
+			for (int i=0; i<PHYSICS_BENCHMARK_CAR_OBJECTS; ++i)
+			{
+				double *m = car.matrices[i];
+				memset(m, 0, sizeof(double) * 16);
+				m[0] = m[5] = m[10] = m[15] = 1.0;
+				m[12] = 300.0 * c + 50.0 * i;
+			}
+
+			for (int i=0; i<PHYSICS_BENCHMARK_CAR_OBJECTS * 2; ++i)
+				notifyNodes.push_back(&car.nodes[i]);
+		}
+
+		double tr[3], rot[3], scl[3];
+
+		// 1 - old scheme, every notify samples all inputs and converts all car objects
+
+		PhysicsEvaluationStats oldStats;
+		memset(&oldStats, 0, sizeof(PhysicsEvaluationStats) );
+
+		std::vector<BenchmarkCar> oldCars(cars);
+
+		auto startTime = clock::now();
+		for (int frame=0; frame<numberOfFrames; ++frame)
+		{
+			bool stepped = false;
+
+			for (size_t n=0; n<notifyNodes.size(); ++n)
+			{
+				oldStats.notifies += 1;
+
+				for (auto iter=oldCars.begin(); iter!=oldCars.end(); ++iter)
+				{
+					for (int i=0; i<PHYSICS_BENCHMARK_CAR_INPUTS; ++i)
+						sink = sink + iter->inputs[i];
+					oldStats.inputReads += PHYSICS_BENCHMARK_CAR_INPUTS;
+				}
+
+				// physics step is guarded by the physics time, it's done once per frame
+				if (false == stepped)
+				{
+					BenchmarkStep(oldCars, dt);
+					stepped = true;
+				}
+
+				for (auto iter=oldCars.begin(); iter!=oldCars.end(); ++iter)
+				{
+					for (int i=0; i<PHYSICS_BENCHMARK_CAR_OBJECTS; ++i)
+					{
+						BenchmarkMatrixToTRS(iter->matrices[i], tr, rot, scl);
+						sink = sink + tr[0] + rot[0];
+					}
+					oldStats.conversions += PHYSICS_BENCHMARK_CAR_OBJECTS;
+				}
+			}
+		}
+		const double oldMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		// 2 - one step per tick into the result table, notify copies its slot
+
+		PhysicsEvaluationCache cache;
+		for (size_t n=0; n<notifyNodes.size(); ++n)
+			cache.AddSlot(notifyNodes[n]);
+
+		std::vector<BenchmarkCar> newCars(cars);
+
+		startTime = clock::now();
+		for (int frame=0; frame<numberOfFrames; ++frame)
+		{
+			for (size_t n=0; n<notifyNodes.size(); ++n)
+			{
+				cache.CountNotify();
+
+				if (cache.BeginTick(frame, (long long) frame) )
+				{
+					for (auto iter=newCars.begin(); iter!=newCars.end(); ++iter)
+					{
+						for (int i=0; i<PHYSICS_BENCHMARK_CAR_INPUTS; ++i)
+							sink = sink + iter->inputs[i];
+					}
+					cache.CountInputReads(numberOfCars * PHYSICS_BENCHMARK_CAR_INPUTS);
+
+					BenchmarkStep(newCars, dt);
+
+					int slot = 0;
+					for (auto iter=newCars.begin(); iter!=newCars.end(); ++iter)
+					{
+						for (int i=0; i<PHYSICS_BENCHMARK_CAR_OBJECTS; ++i)
+						{
+							BenchmarkMatrixToTRS(iter->matrices[i], tr, rot, scl);
+							cache.SetSlotData(slot++, tr);
+							cache.SetSlotData(slot++, rot);
+						}
+					}
+					cache.CountConversions(numberOfCars * PHYSICS_BENCHMARK_CAR_OBJECTS);
+
+					cache.EndTick(true);
+				}
+
+				const int slot = cache.FindSlot(notifyNodes[n]);
+				if (slot >= 0 && cache.IsSlotWritten(slot) )
+					sink = sink + cache.GetSlotData(slot)[0];
+			}
+		}
+		const double newMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+		const PhysicsEvaluationStats &newStats = cache.GetStats();
+
+		// both schemes have to give the same result
+
+		double maxDiff = 0.0;
+		for (int c=0; c<numberOfCars; ++c)
+			for (int i=0; i<PHYSICS_BENCHMARK_CAR_OBJECTS; ++i)
+				for (int k=0; k<16; ++k)
+					maxDiff = std::max(maxDiff, fabs(oldCars[c].matrices[i][k] - newCars[c].matrices[i][k]) );
+
+		printf( "[MoPhysics] %6d %9d | %12d %12d %10.4f | %12d %12d %10.4f%s\n",
+			numberOfCars, oldStats.notifies / numberOfFrames,
+			oldStats.inputReads / numberOfFrames, oldStats.conversions / numberOfFrames, oldMs / numberOfFrames,
+			newStats.inputReads / numberOfFrames, newStats.conversions / numberOfFrames, newMs / numberOfFrames,
+			(maxDiff > 0.0) ? " MISMATCH" : "" );
+	}
+}
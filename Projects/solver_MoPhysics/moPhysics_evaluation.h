@@ -0,0 +1,95 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_evaluation.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <map>
+
+/*
+	Evaluate once per tick
+
+	the real-time engine asks a solver about every animation node it owns. Input sampling, the physics
+	 step and matrix to TRS conversion of all the outputs are done by the first notify of an evaluation
+	 tick into a result table, the rest of notify calls of the same tick only copy a slot of their node.
+
+	A tick is an evaluation id together with the evaluation time. No SDK dependency, slots are keyed
+	 by an animation node pointer.
+*/
+
+struct PhysicsEvaluationStats
+{
+	int		ticks;			// evaluation ticks with a step
+	int		notifies;		// notify calls
+	int		inputReads;		// input properties sampled
+	int		conversions;	// matrix to TRS conversions
+};
+
+//////////////////////////////////////////////////////////////////
+//
+
+class PhysicsEvaluationCache
+{
+public:
+
+	//! a constructor
+	PhysicsEvaluationCache();
+
+	//! remove slots, the next tick is a new one
+	void Clear();
+
+	//! output of a node for the tick, translation and rotation of an object are different slots
+	int AddSlot(const void *node);
+	int FindSlot(const void *node) const;
+	int GetNumberOfSlots() const { return (int) mSlots.size(); }
+
+	double *GetSlotData(const int slot) { return mSlots[slot].data; }
+	bool IsSlotWritten(const int slot) const { return mSlots[slot].tick == mTick; }
+	void SetSlotData(const int slot, const double *data);
+
+	//! true when the tick is not evaluated yet and the caller has to do a step
+	bool BeginTick(const int evaluationId, const long long time);
+	void EndTick(const bool result);
+
+	bool GetTickResult() const { return mTickResult; }
+
+	// statistics
+	const PhysicsEvaluationStats &GetStats() const { return mStats; }
+	void ResetStats();
+
+	void CountNotify() { mStats.notifies += 1; }
+	void CountInputReads(const int count) { mStats.inputReads += count; }
+	void CountConversions(const int count) { mStats.conversions += count; }
+
+protected:
+
+	struct Slot
+	{
+		const void		*node;
+		int				tick;		// tick of the last write
+		double			data[3];
+	};
+
+	std::vector<Slot>				mSlots;
+	std::map<const void*, int>		mSlotIndices;
+
+	bool				mHasTick;
+	int					mEvaluationId;
+	long long			mTime;
+	int					mTick;
+	bool				mTickResult;
+
+	PhysicsEvaluationStats	mStats;
+};
+
+//! synthetic cars with chassis and wheel nodes, compares per notify and per tick evaluation
+//!  for a growing number of cars, prints work counters and time per frame into the log
+void PhysicsEvaluationBenchmark(const int maxNumberOfCars, const int numberOfFrames);
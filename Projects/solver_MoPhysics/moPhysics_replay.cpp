@@ -0,0 +1,634 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_replay.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "moPhysics_replay.h"
+#include "library_NewtonPhysics\newton_PUBLIC.h"
+#include "moPhysics_clock.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// capture
+
+void CaptureQueryGeometry(const PHYSICS_INTERFACE::IQueryGeometry *pGeometry, PhysicsCaptureGeometry &capture, const bool transforms)
+{
+	capture = PhysicsCaptureGeometry();
+
+	if (nullptr == pGeometry)
+		return;
+
+	if (transforms)
+	{
+		for (int space=0; space<2; ++space)
+		{
+			const bool global = (1 == space);
+
+			const double *matrix = pGeometry->GetMatrix(global);
+			if (matrix)
+				memcpy(capture.matrix[space], matrix, sizeof(double) * 16);
+
+			pGeometry->GetMatrixTR(global, capture.matrixTR[space]);
+
+			pGeometry->GetPosition(global);
+			pGeometry->GetPositionD(capture.position[space]);
+
+			pGeometry->GetRotation(global);
+			pGeometry->GetRotationD(capture.rotation[space]);
+
+			pGeometry->GetQuaternion(global);
+			pGeometry->GetQuaternionD(capture.quaternion[space]);
+
+			pGeometry->GetScale(global);
+			pGeometry->GetScaleD(capture.scale[space]);
+		}
+
+		pGeometry->GetVisualAlignMatrixD(capture.visualAlign);
+		pGeometry->GetBoundingBoxD(capture.bbMin, capture.bbMax);
+	}
+
+	const int numberOfVertices = pGeometry->GetVertexCount();
+	capture.positions.resize(3 * numberOfVertices);
+
+	for (int i=0; i<numberOfVertices; ++i)
+	{
+		const float *pos = pGeometry->GetVertexPosition(i);
+		memcpy(&capture.positions[3*i], pos, sizeof(float) * 3);
+	}
+
+	const int numberOfPolys = pGeometry->GetPolyCount();
+	capture.polys.resize(PHYSICS_CAPTURE_POLY_SIZE * numberOfPolys, 0);
+
+	for (int i=0; i<numberOfPolys; ++i)
+	{
+		const PHYSICS_INTERFACE::IQueryGeometry::Poly *poly = pGeometry->GetPoly(i);
+		if (nullptr == poly)
+			continue;
+
+		int *dst = &capture.polys[PHYSICS_CAPTURE_POLY_SIZE * i];
+		const int count = std::min( (int) poly->count, 4);
+
+		dst[0] = count;
+		for (int k=0; k<count; ++k)
+			dst[1+k] = poly->indices[k];
+		dst[5] = (int) poly->matId;
+	}
+}
+
+void CaptureQueryPath(const PHYSICS_INTERFACE::IQueryPath *pPath, const std::vector<double> &knots, const double knotStep,
+	const int numberOfSamples, PhysicsCapturePath &capture)
+{
+	capture = PhysicsCapturePath();
+
+	if (nullptr == pPath || knots.size() == 0)
+		return;
+
+	pPath->GetCurrentMatrixD(capture.matrix);
+
+	capture.knotStep = knotStep;
+	capture.knots = knots;
+
+	capture.derivatives.resize(3 * numberOfSamples);
+	for (int i=0; i<numberOfSamples; ++i)
+	{
+		const double u = (numberOfSamples > 1) ? (double) i / (double) (numberOfSamples - 1) : 0.0;
+		pPath->CurveDerivative( &capture.derivatives[3*i], u );
+	}
+}
+
+void CaptureWorldOutputs(PHYSICS_INTERFACE::ICar **cars, const int numberOfCars, PHYSICS_INTERFACE::IBody **bodies, const int numberOfBodies,
+	PHYSICS_INTERFACE::IWorld *pWorld, double *outputs)
+{
+	for (int i=0; i<numberOfCars; ++i, outputs += PHYSICS_CAPTURE_CAR_OUTPUTS)
+	{
+		memset(outputs, 0, sizeof(double) * PHYSICS_CAPTURE_CAR_OUTPUTS);
+
+		PHYSICS_INTERFACE::ICar *car = cars[i];
+		if (nullptr == car)
+			continue;
+
+		const double *matrix = car->GetChassisMatrix();
+		if (matrix)
+			memcpy(outputs, matrix, sizeof(double) * 16);
+
+		for (int j=0; j<4; ++j)
+		{
+			matrix = car->GetWheelMatrix(j, true);
+			if (matrix)
+				memcpy(outputs + 16 * (j+1), matrix, sizeof(double) * 16);
+		}
+
+		outputs[PHYSICS_CAPTURE_CAR_PARTS * 16] = car->GetSpeed();
+		outputs[PHYSICS_CAPTURE_CAR_PARTS * 16 + 1] = car->GetRPM();
+		outputs[PHYSICS_CAPTURE_CAR_PARTS * 16 + 2] = (double) car->GetCurrentGear();
+	}
+
+	for (int i=0; i<numberOfBodies; ++i, outputs += PHYSICS_CAPTURE_BODY_OUTPUTS)
+	{
+		memset(outputs, 0, sizeof(double) * PHYSICS_CAPTURE_BODY_OUTPUTS);
+
+		if (nullptr == bodies[i])
+			continue;
+
+		const double *matrix = bodies[i]->GetMatrix(pWorld);
+		if (matrix)
+			memcpy(outputs, matrix, sizeof(double) * 16);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ReplayQueryGeometry
+
+ReplayQueryGeometry::ReplayQueryGeometry()
+	: mCapture(nullptr)
+	, mPositionSpace(1)
+	, mRotationSpace(1)
+	, mQuaternionSpace(1)
+	, mScaleSpace(1)
+{}
+
+void ReplayQueryGeometry::Prep(const PhysicsCaptureGeometry *pCapture)
+{
+	mCapture = pCapture;
+	mPolys.clear();
+
+	if (nullptr == pCapture)
+		return;
+
+	const int numberOfPolys = (int) pCapture->polys.size() / PHYSICS_CAPTURE_POLY_SIZE;
+	mPolys.resize(numberOfPolys);
+
+	for (int i=0; i<numberOfPolys; ++i)
+	{
+		const int *src = &pCapture->polys[PHYSICS_CAPTURE_POLY_SIZE * i];
+		Poly &poly = mPolys[i];
+
+		poly.count = src[0];
+		for (int k=0; k<src[0]; ++k)
+			poly.indices[k] = src[1+k];
+		poly.matId = src[5];
+	}
+}
+
+void ReplayQueryGeometry::GetBoundingBox(float *min_vector, float *max_vector) const
+{
+	for (int i=0; i<3; ++i)
+	{
+		min_vector[i] = (float) mCapture->bbMin[i];
+		max_vector[i] = (float) mCapture->bbMax[i];
+	}
+}
+
+void ReplayQueryGeometry::GetBoundingBoxD(double *min_vector, double *max_vector) const
+{
+	for (int i=0; i<3; ++i)
+	{
+		min_vector[i] = mCapture->bbMin[i];
+		max_vector[i] = mCapture->bbMax[i];
+	}
+}
+
+void ReplayQueryGeometry::PrepMatrix(bool global) const
+{
+	const int space = (global) ? 1 : 0;
+
+	mPositionSpace = space;
+	mRotationSpace = space;
+	mQuaternionSpace = space;
+	mScaleSpace = space;
+}
+
+const double *ReplayQueryGeometry::GetMatrix(bool global) const
+{
+	return mCapture->matrix[(global) ? 1 : 0];
+}
+
+void ReplayQueryGeometry::GetMatrixTR(bool global, double *values) const
+{
+	memcpy(values, mCapture->matrixTR[(global) ? 1 : 0], sizeof(double) * 16);
+}
+
+void ReplayQueryGeometry::GetMatrixTR_f(bool global, float *values) const
+{
+	const double *matrix = mCapture->matrixTR[(global) ? 1 : 0];
+	for (int i=0; i<16; ++i)
+		values[i] = (float) matrix[i];
+}
+
+void ReplayQueryGeometry::GetVisualAlignMatrix(float *values) const
+{
+	for (int i=0; i<16; ++i)
+		values[i] = (float) mCapture->visualAlign[i];
+}
+
+void ReplayQueryGeometry::GetVisualAlignMatrixD(double *values) const
+{
+	memcpy(values, mCapture->visualAlign, sizeof(double) * 16);
+}
+
+const double *ReplayQueryGeometry::GetPosition(bool global) const
+{
+	mPositionSpace = (global) ? 1 : 0;
+	return mCapture->position[mPositionSpace];
+}
+
+void ReplayQueryGeometry::GetPositionD(double *values) const
+{
+	memcpy(values, mCapture->position[mPositionSpace], sizeof(double) * 3);
+}
+
+void ReplayQueryGeometry::GetPositionF(float *values) const
+{
+	for (int i=0; i<3; ++i)
+		values[i] = (float) mCapture->position[mPositionSpace][i];
+}
+
+const double *ReplayQueryGeometry::GetRotation(bool global) const
+{
+	mRotationSpace = (global) ? 1 : 0;
+	return mCapture->rotation[mRotationSpace];
+}
+
+void ReplayQueryGeometry::GetRotationD(double *values) const
+{
+	memcpy(values, mCapture->rotation[mRotationSpace], sizeof(double) * 3);
+}
+
+void ReplayQueryGeometry::GetRotationF(float *values) const
+{
+	for (int i=0; i<3; ++i)
+		values[i] = (float) mCapture->rotation[mRotationSpace][i];
+}
+
+const double *ReplayQueryGeometry::GetQuaternion(bool global) const
+{
+	mQuaternionSpace = (global) ? 1 : 0;
+	return mCapture->quaternion[mQuaternionSpace];
+}
+
+void ReplayQueryGeometry::GetQuaternionD(double *values) const
+{
+	memcpy(values, mCapture->quaternion[mQuaternionSpace], sizeof(double) * 4);
+}
+
+void ReplayQueryGeometry::GetQuaternionF(float *values) const
+{
+	for (int i=0; i<4; ++i)
+		values[i] = (float) mCapture->quaternion[mQuaternionSpace][i];
+}
+
+const double *ReplayQueryGeometry::GetScale(bool global) const
+{
+	mScaleSpace = (global) ? 1 : 0;
+	return mCapture->scale[mScaleSpace];
+}
+
+void ReplayQueryGeometry::GetScaleD(double *values) const
+{
+	memcpy(values, mCapture->scale[mScaleSpace], sizeof(double) * 3);
+}
+
+void ReplayQueryGeometry::GetScaleF(float *values) const
+{
+	for (int i=0; i<3; ++i)
+		values[i] = (float) mCapture->scale[mScaleSpace][i];
+}
+
+const int ReplayQueryGeometry::GetVertexCount() const
+{
+	return (mCapture) ? (int) mCapture->positions.size() / 3 : 0;
+}
+
+const float *ReplayQueryGeometry::GetVertexPosition(const int index) const
+{
+	return &mCapture->positions[3 * index];
+}
+
+const int ReplayQueryGeometry::GetPolyCount() const
+{
+	return (int) mPolys.size();
+}
+
+const ReplayQueryGeometry::Poly *ReplayQueryGeometry::GetPoly(const int index) const
+{
+	return &mPolys[index];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ReplayQueryPath
+
+ReplayQueryPath::ReplayQueryPath()
+	: mCapture(nullptr)
+{}
+
+void ReplayQueryPath::Prep(const PhysicsCapturePath *pCapture)
+{
+	mCapture = pCapture;
+}
+
+void ReplayQueryPath::GetCurrentMatrix(float *values) const
+{
+	if (nullptr == mCapture)
+		return;
+
+	for (int i=0; i<16; ++i)
+		values[i] = (float) mCapture->matrix[i];
+}
+
+void ReplayQueryPath::GetCurrentMatrixD(double *values) const
+{
+	if (nullptr == mCapture)
+		return;
+
+	memcpy(values, mCapture->matrix, sizeof(double) * 16);
+}
+
+// linear between the captured samples, the live query returns a unit vector
+void ReplayQueryPath::CurveDerivative (double *result, double u, int index) const
+{
+	if (nullptr == mCapture || mCapture->derivatives.size() < 3)
+		return;
+
+	const int numberOfSamples = (int) mCapture->derivatives.size() / 3;
+	const double t = std::max(0.0, std::min(1.0, u) ) * (numberOfSamples - 1);
+
+	const int i0 = std::min( (int) t, numberOfSamples - 1);
+	const int i1 = std::min(i0 + 1, numberOfSamples - 1);
+	const double f = t - i0;
+
+	const double *a = &mCapture->derivatives[3 * i0];
+	const double *b = &mCapture->derivatives[3 * i1];
+
+	double len = 0.0;
+	for (int k=0; k<3; ++k)
+	{
+		result[k] = a[k] + (b[k] - a[k]) * f;
+		len += result[k] * result[k];
+	}
+
+	if (len > 0.0)
+	{
+		len = 1.0 / sqrt(len);
+		for (int k=0; k<3; ++k)
+			result[k] *= len;
+	}
+}
+
+// the same knots as the live k-d tree search
+double ReplayQueryPath::FindClosestKnot (double *closestPointOnCurve, const double *point, double dist_thres, int subdivitionSteps) const
+{
+	if (nullptr == mCapture || mCapture->knots.size() < 3)
+		return 0.0;
+
+	const int numberOfKnots = (int) mCapture->knots.size() / 3;
+
+	int closest = -1;
+	double closestDistSq = dist_thres * dist_thres;
+
+	for (int i=0; i<numberOfKnots; ++i)
+	{
+		const double *knot = &mCapture->knots[3*i];
+		const double dx = knot[0] - point[0];
+		const double dy = knot[1] - point[1];
+		const double dz = knot[2] - point[2];
+
+		const double distSq = dx * dx + dy * dy + dz * dz;
+		if (distSq <= closestDistSq)
+		{
+			closestDistSq = distSq;
+			closest = i;
+		}
+	}
+
+	if (closest < 0)
+		return 0.0;
+
+	memcpy(closestPointOnCurve, &mCapture->knots[3 * closest], sizeof(double) * 3);
+	return mCapture->knotStep * closest;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// replay
+
+bool PhysicsReplayRun(const PhysicsCapture &capture, PhysicsCapture &result, PhysicsReplayStats &stats, std::vector<double> *stepTimes)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	memset(&stats, 0, sizeof(PhysicsReplayStats) );
+
+	if (capture.world.fps <= 0.0)
+	{
+		printf( "[MoPhysics] replay - capture has no physics fps\n" );
+		return false;
+	}
+
+	// option blocks are stored as they are in memory, they have to come from the same physics layer
+	for (auto iter=capture.cars.begin(); iter!=capture.cars.end(); ++iter)
+	{
+		if (iter->options.size() != sizeof(PHYSICS_INTERFACE::CarOptions) )
+		{
+			printf( "[MoPhysics] replay - car options of the capture have a different size (%d, expected %d)\n",
+				(int) iter->options.size(), (int) sizeof(PHYSICS_INTERFACE::CarOptions) );
+			return false;
+		}
+	}
+
+	for (auto iter=capture.bodies.begin(); iter!=capture.bodies.end(); ++iter)
+	{
+		if (iter->options.size() != sizeof(PHYSICS_INTERFACE::BodyOptions) )
+		{
+			printf( "[MoPhysics] replay - body options of the capture have a different size\n" );
+			return false;
+		}
+	}
+
+	for (auto iter=capture.events.begin(); iter!=capture.events.end(); ++iter)
+	{
+		if (iter->options.size() != sizeof(PHYSICS_INTERFACE::CarOptions) || iter->car < 0 || iter->car >= (int) capture.cars.size() )
+		{
+			printf( "[MoPhysics] replay - wrong car options event at frame %d\n", iter->frame );
+			return false;
+		}
+	}
+
+	// the result has the recorded scene and inputs, outputs are replaced
+	result = capture;
+
+	auto startTime = clock::now();
+
+	// 1 - the same order as the solver, bodies and cars, level, then the world goes online
+
+	std::unique_ptr<PHYSICS_INTERFACE::IWorld> world( CreateNewNewtonWorld(capture.world.scaling, capture.world.threads,
+		capture.world.samples, (float) capture.world.fps) );
+
+	if (nullptr == world.get() )
+	{
+		printf( "[MoPhysics] replay - failed to create a physics world\n" );
+		return false;
+	}
+
+	const int numberOfBodies = (int) capture.bodies.size();
+	const int numberOfCars = (int) capture.cars.size();
+
+	std::vector<ReplayQueryGeometry>		bodyGeometry(numberOfBodies);
+	std::vector<PHYSICS_INTERFACE::IBody*>	bodies(numberOfBodies, nullptr);
+
+	for (int i=0; i<numberOfBodies; ++i)
+	{
+		PHYSICS_INTERFACE::BodyOptions options;
+		memcpy(&options, capture.bodies[i].options.data(), sizeof(PHYSICS_INTERFACE::BodyOptions) );
+
+		bodyGeometry[i].Prep( &capture.bodies[i].geometry );
+		bodies[i] = world->CreateNewBody( &options, &bodyGeometry[i], capture.bodies[i].convexHull != 0 );
+	}
+
+	std::vector<ReplayQueryGeometry>		carGeometry(numberOfCars * PHYSICS_CAPTURE_CAR_PARTS);
+	std::vector<ReplayQueryPath>			carPaths(numberOfCars);
+	std::vector<PHYSICS_INTERFACE::ICar*>	cars(numberOfCars, nullptr);
+
+	for (int i=0; i<numberOfCars; ++i)
+	{
+		const PhysicsCaptureCar &car = capture.cars[i];
+
+		PHYSICS_INTERFACE::CarOptions options;
+		memcpy(&options, car.options.data(), sizeof(PHYSICS_INTERFACE::CarOptions) );
+
+		const PHYSICS_INTERFACE::IQueryGeometry *parts[PHYSICS_CAPTURE_CAR_PARTS];
+		for (int j=0; j<PHYSICS_CAPTURE_CAR_PARTS; ++j)
+		{
+			ReplayQueryGeometry &geometry = carGeometry[i * PHYSICS_CAPTURE_CAR_PARTS + j];
+			geometry.Prep( &car.parts[j] );
+			parts[j] = &geometry;
+		}
+
+		carPaths[i].Prep( (car.hasPath) ? &car.path : nullptr );
+		cars[i] = world->CreateNewCar( &options, parts, &carPaths[i] );
+	}
+
+	ReplayQueryGeometry level;
+	if (capture.hasLevel)
+	{
+		level.Prep( &capture.level );
+		world->LoadLevel( &level );
+	}
+
+	if (capture.world.hasMaterial)
+	{
+		const double *m = capture.world.material;
+		world->SetDefaultMaterialParams(m[0], m[1], m[2], m[3], m[4]);
+	}
+
+	world->Open();
+
+	double gravity[3] = { capture.world.gravity[0], capture.world.gravity[1], capture.world.gravity[2] };
+	world->SetGravity( gravity );
+
+	stats.setupMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+
+	// 2 - frames
+
+	const int numberOfFrames = capture.GetNumberOfFrames();
+
+	std::vector<double> times;
+	times.reserve(numberOfFrames);
+
+	auto nextEvent = capture.events.begin();
+
+	// the same whole steps as the solver made
+	PhysicsFixedClock fixedClock;
+	fixedClock.SetStep(1.0 / capture.world.fps);
+
+	for (int frame=0; frame<numberOfFrames; ++frame)
+	{
+		for ( ; nextEvent != capture.events.end() && nextEvent->frame <= frame; ++nextEvent)
+		{
+			world->WaitForUpdateToFinish();
+
+			PHYSICS_INTERFACE::CarOptions options;
+			memcpy(&options, nextEvent->options.data(), sizeof(PHYSICS_INTERFACE::CarOptions) );
+
+			if (cars[nextEvent->car])
+				cars[nextEvent->car]->SetOptions( &options );
+		}
+
+		const int flags = capture.GetFrameFlags(frame);
+		const auto stepTime = clock::now();
+
+		for (int i=0; i<numberOfCars; ++i)
+		{
+			const double *inputs = capture.GetCarInputs(frame, i);
+			if (cars[i])
+				cars[i]->SetPlayerControl( inputs[0], inputs[1], inputs[2], inputs[3], inputs[4], inputs[5], inputs[6] );
+		}
+
+		if (flags & ePhysicsCaptureFrameReset)
+		{
+			world->Reset();
+			fixedClock.Reset();
+		}
+
+		if (flags & (ePhysicsCaptureFrameFetch | ePhysicsCaptureFrameHold) )
+		{
+			const int numberOfSteps = fixedClock.Advance( capture.GetFrameTime(frame), (flags & ePhysicsCaptureFrameFetch) != 0 );
+
+			for (int i=0; i<numberOfSteps; ++i)
+			{
+				world->FetchDataPacket( fixedClock.GetStepEvalTime(i) );
+				world->WaitForUpdateToFinish();
+			}
+
+			stats.numberOfSteps += std::max(0, numberOfSteps);
+		}
+
+		world->WaitForUpdateToFinish();
+
+		if (flags & ePhysicsCaptureFrameOutputs)
+			CaptureWorldOutputs( cars.data(), numberOfCars, bodies.data(), numberOfBodies, world.get(), result.GetFrameOutputs(frame) );
+
+		times.push_back( std::chrono::duration<double, std::milli>(clock::now() - stepTime).count() );
+	}
+
+	// 3 - free
+
+	for (auto iter=cars.begin(); iter!=cars.end(); ++iter)
+		delete *iter;
+	for (auto iter=bodies.begin(); iter!=bodies.end(); ++iter)
+		delete *iter;
+
+	world->Close();
+	world->Clear();
+
+	// timing
+
+	stats.numberOfFrames = numberOfFrames;
+
+	if (numberOfFrames > 0)
+	{
+		if (stepTimes)
+			*stepTimes = times;
+
+		for (auto iter=times.begin(); iter!=times.end(); ++iter)
+			stats.totalMs += *iter;
+
+		std::sort(times.begin(), times.end() );
+		stats.minStepMs = times.front();
+		stats.maxStepMs = times.back();
+		stats.medianStepMs = times[numberOfFrames / 2];
+		stats.p95StepMs = times[std::min(numberOfFrames - 1, (int) (0.95 * numberOfFrames) )];
+	}
+
+	return true;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_replay.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Common_Physics\physics_common.h"
+#include "moPhysics_capture.h"
+
+/*
+	Physics replay
+
+	capture side - snapshot of a query geometry made through the physics interface.
+	replay side - query geometry and path implementations on top of the captured data, and a driver
+	 that builds a physics world from a capture, feeds the recorded inputs frame by frame and collects
+	 the outputs the same way as the solver does, with a timing of every step.
+
+	No SDK dependency, the replay is linked with the physics library only.
+*/
+
+//! all the queries for a local and a global space, the D variants are taken after the matching query
+//! level geometry has no transform, only vertices and polygons are taken when transforms is false
+void CaptureQueryGeometry(const PHYSICS_INTERFACE::IQueryGeometry *pGeometry, PhysicsCaptureGeometry &capture, const bool transforms=true);
+
+//! knots are the positions of the closest knot search, curve derivative is sampled uniformly
+void CaptureQueryPath(const PHYSICS_INTERFACE::IQueryPath *pPath, const std::vector<double> &knots, const double knotStep,
+	const int numberOfSamples, PhysicsCapturePath &capture);
+
+//! outputs of the cars and bodies in the order of the capture
+void CaptureWorldOutputs(PHYSICS_INTERFACE::ICar **cars, const int numberOfCars, PHYSICS_INTERFACE::IBody **bodies, const int numberOfBodies,
+	PHYSICS_INTERFACE::IWorld *pWorld, double *outputs);
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+
+class ReplayQueryGeometry : public PHYSICS_INTERFACE::IQueryGeometry
+{
+public:
+	//! a constructor
+	ReplayQueryGeometry();
+
+	void Prep(const PhysicsCaptureGeometry *pCapture);
+
+	virtual void GetBoundingBox(float *min_vector, float *max_vector) const override;
+	virtual void GetBoundingBoxD(double *min_vector, double *max_vector) const override;
+
+	virtual void PrepMatrix(bool global) const;
+
+	virtual const double	*GetMatrix(bool global) const override;
+	virtual void			GetMatrixTR(bool global, double *values) const override;
+	virtual void			GetMatrixTR_f(bool global, float *values) const override;
+
+	virtual void			GetVisualAlignMatrix(float *values) const;
+	virtual void			GetVisualAlignMatrixD(double *values) const override;
+
+	virtual const double	*GetPosition(bool global) const override;
+	virtual void			GetPositionD(double *values) const override;
+	virtual void			GetPositionF(float *values) const override;
+
+	virtual const double	*GetRotation(bool global) const override;
+	virtual void			GetRotationD(double *values) const override;
+	virtual void			GetRotationF(float *values) const override;
+
+	virtual const double	*GetQuaternion(bool global) const override;
+	virtual void			GetQuaternionD(double *values) const override;
+	virtual void			GetQuaternionF(float *values) const override;
+
+	virtual const double	*GetScale(bool global) const override;
+	virtual void			GetScaleD(double *values) const override;
+	virtual void			GetScaleF(float *values) const override;
+
+	virtual const int		GetVertexCount() const;
+	virtual const float		*GetVertexPosition(const int index) const;
+
+	virtual const int		GetPolyCount() const;
+	virtual const Poly		*GetPoly(const int index) const;
+
+private:
+
+	const PhysicsCaptureGeometry	*mCapture;
+	std::vector<Poly>				mPolys;
+
+	// space of the last query, the D and F variants return it
+	mutable int						mPositionSpace;
+	mutable int						mRotationSpace;
+	mutable int						mQuaternionSpace;
+	mutable int						mScaleSpace;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+
+class ReplayQueryPath : public PHYSICS_INTERFACE::IQueryPath
+{
+public:
+
+	//! a constructor
+	ReplayQueryPath();
+
+	//! nullptr is a car without a steering path
+	void Prep(const PhysicsCapturePath *pCapture);
+
+	virtual void	GetCurrentMatrix(float *values) const override;
+	virtual void	GetCurrentMatrixD(double *values) const override;
+	virtual void	CurveDerivative (double *result, double u, int index = 1) const;
+	virtual double	FindClosestKnot (double *closestPointOnCurve, const double *point, double dist_thres, int subdivitionSteps = 2) const;
+
+private:
+
+	const PhysicsCapturePath	*mCapture;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+
+struct PhysicsReplayStats
+{
+	int			numberOfFrames;
+	int			numberOfSteps;		// fixed physics steps
+
+	double		setupMs;			// world, level, bodies and cars
+	double		totalMs;			// all the frames
+	double		minStepMs;
+	double		maxStepMs;
+	double		medianStepMs;
+	double		p95StepMs;
+};
+
+//! a new physics world from the capture, outputs of the replay are written into result frames
+bool PhysicsReplayRun(const PhysicsCapture &capture, PhysicsCapture &result, PhysicsReplayStats &stats, std::vector<double> *stepTimes=nullptr);
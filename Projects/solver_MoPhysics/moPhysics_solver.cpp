@@ -14,6 +14,7 @@
 #include "moPhysics_solver.h"
 #include "library_NewtonPhysics\newton_PUBLIC.h"
 #include "queryFBGeometry.h"
+#include "moPhysics_replay.h"
 
 #include "moPhysics_CarProperties.h"
 #include "moPhysics_ChainProperties.h"
@@ -70,6 +71,45 @@ void MOPhysicsSolver::ActionSaveState( HIObject pObject, bool value )
 	}
 }
 
+void MOPhysicsSolver::ActionEvaluationBenchmark( HIObject pObject, bool value )
+{
+	if (value)
+		PhysicsEvaluationBenchmark(64, 120);
+}
+
+void MOPhysicsSolver::ActionCollisionCookTest( HIObject pObject, bool value )
+{
+	if (value)
+	{
+		const char *tempPath = getenv("TEMP");
+		std::string folder( (tempPath) ? tempPath : "." );
+		folder = folder + "\\MoPhysicsCookTest";
+
+		CollisionCookSelfTest(folder.c_str() );
+	}
+}
+
+void MOPhysicsSolver::ActionCaptureTest( HIObject pObject, bool value )
+{
+	if (value)
+	{
+		const char *tempPath = getenv("TEMP");
+		PhysicsCaptureSelfTest( (tempPath) ? tempPath : "." );
+	}
+}
+
+void MOPhysicsSolver::ActionClockTest( HIObject pObject, bool value )
+{
+	if (value)
+		PhysicsClockSelfTest();
+}
+
+void MOPhysicsSolver::ActionTransformBatchBenchmark( HIObject pObject, bool value )
+{
+	if (value)
+		PhysicsTransformBatchBenchmark(16384, 120);
+}
+
 void MOPhysicsSolver::ActionSerialize( HIObject pObject, bool value )
 {     
     MOPhysicsSolver* lDevice = FBCast<MOPhysicsSolver>(pObject);
@@ -122,6 +162,19 @@ void MOPhysicsSolver::SetRecording( HIObject pObject, bool value )
 	}
 }
 
+void MOPhysicsSolver::SetCaptureRecord( HIObject pObject, bool value )
+{     
+    MOPhysicsSolver* lDevice = FBCast<MOPhysicsSolver>(pObject);
+    
+	if (lDevice) {
+		lDevice->CaptureRecord.SetPropertyValue(value);
+
+		// a capture is started with the solver activation
+		if (value == false && lDevice->mCaptureActive)
+			lDevice->CaptureEnd();
+	}
+}
+
 void MOPhysicsSolver::SetWorldScale( HIObject pObject, double value )
 {     
     MOPhysicsSolver* lDevice = FBCast<MOPhysicsSolver>(pObject);
@@ -193,6 +246,14 @@ bool MOPhysicsSolver::FBCreate()
 	FBPropertyPublish(this, ResetToStart, "Reset To Start", nullptr, ActionResetToStart );
 	FBPropertyPublish(this, SetStartState, "Set Start State", nullptr, ActionSaveState );
 	FBPropertyPublish(this, Serialize, "Serialize", nullptr, ActionSerialize );
+	FBPropertyPublish(this, EvaluationBenchmark, "Evaluation Benchmark", nullptr, ActionEvaluationBenchmark );
+	FBPropertyPublish(this, CollisionCookTest, "Collision Cook Test", nullptr, ActionCollisionCookTest );
+	FBPropertyPublish(this, CaptureTest, "Capture Test", nullptr, ActionCaptureTest );
+	FBPropertyPublish(this, ClockTest, "Clock Test", nullptr, ActionClockTest );
+	FBPropertyPublish(this, TransformBatchBenchmark, "Transform Batch Benchmark", nullptr, ActionTransformBatchBenchmark );
+
+	FBPropertyPublish(this, CaptureRecord, "Capture Record", nullptr, SetCaptureRecord);
+	FBPropertyPublish(this, CaptureFile, "Capture File", nullptr, nullptr);
 
 	FBPropertyPublish(this, PhysicsEngine, "Physics Engine", nullptr, nullptr);
 
@@ -232,6 +293,9 @@ bool MOPhysicsSolver::FBCreate()
 	LiveState = false;
 	RecordState = false;
 
+	CaptureRecord = false;
+	CaptureFile = "";
+
 	Gravity = FBVector3d(0.0, -9.8, 0.0);
 	AutoScale = true;
 	WorldScale = 10.0;
@@ -252,6 +316,12 @@ bool MOPhysicsSolver::FBCreate()
 	mLastPhysTimeSecs = 0.0;
 
 	mLastTorque = 0.0;
+	mWriteData = false;
+	mEvaluationSlotsDirty = true;
+
+	mCaptureActive = false;
+	mCaptureFlags = 0;
+	mCaptureTime = 0.0;
 
 	return true;
 }
@@ -270,6 +340,12 @@ void MOPhysicsSolver::ActiveChanged()
 		mWorldScaling = 0.01 * WorldScale;
 		mHardware.reset( CreateNewNewtonWorld(mWorldScaling, PhysicsThreads, PhysicsSamples, (float) PhysicsFPS) );
 
+		mClock.SetStep( 1.0 / PhysicsFPS );
+		mClock.Reset();
+
+		if (CaptureRecord)
+			CaptureBegin();
+
 		EnterOnline();
 
 		mHardware->Open();
@@ -297,6 +373,9 @@ void MOPhysicsSolver::ActiveChanged()
 #else
 		//FBEvaluateManager::TheOne().OnEvaluationPipelineEvent.Remove(this, (FBCallback)&MOPhysicsSolver::OnPerFrameEvaluationPipelineCallback);
 #endif
+		if (mCaptureActive)
+			CaptureEnd();
+
 		// goes offline - free physics world
 		LeaveOnline();
 		
@@ -500,6 +579,8 @@ bool MOPhysicsSolver::UpdateInput(FBEvaluateInfo* pEvaluateInfo)
 			if (iter->gear)
 				readSuccess &= iter->gear->ReadData( &gear, pEvaluateInfo );
 
+			mEvaluationCache.CountInputReads(7);
+
 			if (readSuccess)
 			{
 				
@@ -507,14 +588,22 @@ bool MOPhysicsSolver::UpdateInput(FBEvaluateInfo* pEvaluateInfo)
 				{
 					mLastTorque = torque + 1.0;
 					iter->car->SetPlayerControl( 0.01*mLastTorque, 0.01*clutch, 0.01*steering, 0.01*steeringBlend, 0.01*brake, 0.01*handbrake, gear );
-					
+					iter->lastInputs[0] = 0.01*mLastTorque;
 				}
 				else
 				{
 					iter->car->SetPlayerControl( 0.01*torque, 0.01*clutch, 0.01*steering, 0.01*steeringBlend, 0.01*brake, 0.01*handbrake, gear );
 					mLastTorque = torque;
+					iter->lastInputs[0] = 0.01*torque;
 				}
 
+				iter->lastInputs[1] = 0.01*clutch;
+				iter->lastInputs[2] = 0.01*steering;
+				iter->lastInputs[3] = 0.01*steeringBlend;
+				iter->lastInputs[4] = 0.01*brake;
+				iter->lastInputs[5] = 0.01*handbrake;
+				iter->lastInputs[6] = gear;
+
 				
 			}
 			else
@@ -543,130 +632,196 @@ bool MOPhysicsSolver::UpdatePhysics(FBEvaluateInfo* pEvaluateInfo)
 
 	bool isRecording = mPlayerControl.IsRecording;
 
+	mCaptureFlags = 0;
+	mCaptureTime = evalTimeSecs;
+
 	if (isRecording && isRecording != mLastIsRecording)
 	{
 		mHardware->Reset();
+		mClock.Reset();
+		mCaptureFlags |= ePhysicsCaptureFrameReset;
 	}
 	else
 	if (isStop && isStop != mLastIsStop )
 	{
 		// Reset ?!
 		mHardware->Reset();
+		mClock.Reset();
+		mCaptureFlags |= ePhysicsCaptureFrameReset;
 	}
 
-	if (mHardware.get() != nullptr)
+	mLastIsRecording = isRecording;
+	mLastIsStop = isStop;
+	mLastTimeLocal = localMode;
+
+	// TODO: we are including a RESET time here
+	if (evalTimeSecs <= 0.0 || mHardware.get() == nullptr)
 	{
-		mPhysTimeSecs = mHardware->GetCurrPhysTimeSecs();
-		mLastPhysTimeSecs = mHardware->GetLastPhysTimeSecs();
+		return false;
 	}
 
-	// TODO: we are including a RESET time here
-	if (evalTimeSecs <= 0.0)
+	// whole steps up to the evaluation time, a stopped playback only moves inside the current steps
+	const bool isStarted = mClock.IsStarted();
+	const int numberOfSteps = mClock.Advance( evalTimeSecs, isStop == false );
+
+	mCaptureFlags |= (isStop) ? ePhysicsCaptureFrameHold : ePhysicsCaptureFrameFetch;
+
+	if (false == isStarted)
+	{
+		mHardware->WaitForUpdateToFinish();
+		StoreStates(true);
+	}
+
+	if (numberOfSteps < 0)
 	{
 		return false;
 	}
 
-	if ( isStop == false && evalTimeSecs > mPhysTimeSecs )
+	for (int i=0; i<numberOfSteps; ++i)
 	{
-		if (mHardware.get() != nullptr)
-		{
-			mHardware->FetchDataPacket( evalTimeSecs );
+		mHardware->FetchDataPacket( mClock.GetStepEvalTime(i) );
+		mHardware->WaitForUpdateToFinish();
 
-			mPhysTimeSecs = mHardware->GetCurrPhysTimeSecs();
-			mLastPhysTimeSecs = mHardware->GetLastPhysTimeSecs();
-		}
+		// only two last states are interpolated
+		if (i >= numberOfSteps - 2)
+			StoreStates(false);
 	}
 
-	if (evalTimeSecs < mLastPhysTimeSecs)
+	mPhysTimeSecs = mHardware->GetCurrPhysTimeSecs();
+	mLastPhysTimeSecs = mHardware->GetLastPhysTimeSecs();
+	mAnimTimeSecs = evalTimeSecs;
+
+	return true;
+}
+
+static void StoreNodeState(bool &hasState, double *prevMatrix, double *currMatrix, const double *matrix, const bool fill)
+{
+	if (matrix == nullptr)
+		return;
+
+	if (fill || hasState == false)
+		memcpy( prevMatrix, matrix, sizeof(double) * 16 );
+	else
+		memcpy( prevMatrix, currMatrix, sizeof(double) * 16 );
+
+	memcpy( currMatrix, matrix, sizeof(double) * 16 );
+	hasState = true;
+}
+
+void MOPhysicsSolver::StoreStates(const bool fill)
+{
+	auto fnStoreState = [fill] (CarNode::Node &node, const double *matrix) {
+		StoreNodeState( node.hasState, node.prevMatrix, node.currMatrix, matrix, fill );
+	};
+
+	for (auto iter=begin(mCars); iter!=end(mCars); ++iter)
 	{
-		return false;
+		if (iter->car == nullptr)
+			continue;
+
+		fnStoreState( iter->chassis, iter->car->GetChassisMatrix() );
+
+		for (int i=0; i<4; ++i)
+			fnStoreState( iter->wheels[i], iter->car->GetWheelMatrix(i, true) );
 	}
-	if (evalTimeSecs > mPhysTimeSecs)
+
+	// only bodies with an output are kept
+	for (auto iter=begin(mBatchNodes); iter!=end(mBatchNodes); ++iter)
 	{
-		return false;
+		PhysNode *node = *iter;
+		StoreNodeState( node->hasState, node->prevMatrix, node->currMatrix, node->body->GetMatrix( GetWorldPtr() ), fill );
 	}
-	if (mPhysTimeSecs < mLastPhysTimeSecs)
+}
+
+void MOPhysicsSolver::BuildEvaluationSlots()
+{
+	mEvaluationCache.Clear();
+
+	auto fnAddNodeSlots = [this] (CarNode::Node &node) {
+		node.trSlot = (node.tr) ? mEvaluationCache.AddSlot(node.tr) : -1;
+		node.rotSlot = (node.rot) ? mEvaluationCache.AddSlot(node.rot) : -1;
+	};
+
+	for (auto iter=begin(mCars); iter!=end(mCars); ++iter)
 	{
-		return false;
+		fnAddNodeSlots(iter->chassis);
+
+		for (int i=0; i<4; ++i)
+			fnAddNodeSlots(iter->wheels[i]);
 	}
 
-	mLastIsRecording = isRecording;
-	mLastIsStop = isStop;
-	mLastTimeLocal = localMode;
-	mAnimTimeSecs = evalTimeSecs;
+	// bodies with a node go into the batch
+	mTransformBatch.Clear();
+	mBatchNodes.clear();
 
-	//
-	//
-	if (mHardware.get() != nullptr)
-		mHardware->WaitForUpdateToFinish();
+	auto fnAddBodySlots = [this] (PhysNode &node) {
+		node.trSlot = (node.tr) ? mEvaluationCache.AddSlot(node.tr) : -1;
+		node.rotSlot = (node.rot) ? mEvaluationCache.AddSlot(node.rot) : -1;
 
-	return true;
+		if (node.body != nullptr && (node.trSlot >= 0 || node.rotSlot >= 0) )
+		{
+			mTransformBatch.Add(node.rotationOrder);
+			mBatchNodes.push_back(&node);
+		}
+	};
+
+	for (auto iter=begin(mRigidBodies); iter!=end(mRigidBodies); ++iter)
+		fnAddBodySlots(*iter);
+
+	for (auto iter=begin(mChainNodes); iter!=end(mChainNodes); ++iter)
+	{
+		for (int i=0; i<MAX_NUMBER_OF_CHAIN_JOINS; ++i)
+			fnAddBodySlots(iter->nodes[i]);
+	}
+
+	mEvaluationSlotsDirty = false;
 }
 
 bool MOPhysicsSolver::UpdateAllCars(FBEvaluateInfo *pEvaluateInfo)
 {
-	// 2 - write a result to animation node
+	// 2 - convert results into the table, every notify writes only its own node
 	FBMatrix m;
 	FBTVector T;
 	FBRVector R;
 	FBSVector S;
 
-	bool isLive = (Live == true);
-	bool writedata = (Live == true || (RecordState == true && !pEvaluateInfo->IsStop() ) );
-	bool result = false;
+	mWriteData = (Live == true || (RecordState == true && !pEvaluateInfo->IsStop() ) );
 
-	for (auto iter=begin(mCars); iter!=end(mCars); ++iter)
-	{
-		// interpolated value, we are using last anim time passed
-		m.Set( iter->car->GetChassisMatrix() );
+	const double alpha = mClock.GetAlpha();
+	double matrix[16];
+
+	auto fnStoreNode = [&] (const CarNode::Node &node) {
+		
+		if (node.hasState == false)
+			return;
+
+		PhysicsInterpolateMatrix( node.prevMatrix, node.currMatrix, alpha, matrix );
 
+		m.Set( matrix );
 		FBMatrixToTRS( T, R, S, m );
 
-		if (writedata)
-		{
-			//if (pAnimationNode == iter->chassis.tr)
-			{
-				iter->chassis.tr->WriteData(T, pEvaluateInfo);
-				result = true;
-				//return true;
-			}
+		if (node.trSlot >= 0)
+			mEvaluationCache.SetSlotData(node.trSlot, T);
+		if (node.rotSlot >= 0)
+			mEvaluationCache.SetSlotData(node.rotSlot, R);
 
-			//if (pAnimationNode == iter->chassis.rot)
-			{
-				iter->chassis.rot->WriteData(R, pEvaluateInfo);
-				result = true;
-				//return true;
-			}
-		}
+		mEvaluationCache.CountConversions(1);
+	};
 
-		//
-		// write data for each wheel
-		//
-		
-		for (int i=1; i<=4; ++i)
+	for (auto iter=begin(mCars); iter!=end(mCars); ++iter)
+	{
+		if (mWriteData)
 		{
-			const double *wheelMatrix = iter->car->GetWheelMatrix(i-1, true);
-			if (wheelMatrix == nullptr)
-				continue;
-
-			m.Set( wheelMatrix );
-			FBMatrixToTRS( T, R, S, m );
+			// interpolated between two physics steps that bracket the evaluation time
+			fnStoreNode( iter->chassis );
 
-			if (writedata)
+			//
+			// data for each wheel
+			//
+		
+			for (int i=0; i<4; ++i)
 			{
-				//if (pAnimationNode == iter->wheels[i-1].tr )
-				{
-					iter->wheels[i-1].tr->WriteData(T, pEvaluateInfo);
-					result = true;
-					//return true;
-				}
-
-				//if (pAnimationNode == iter->wheels[i-1].rot )
-				{
-					iter->wheels[i-1].rot->WriteData(R, pEvaluateInfo);
-					result = true;
-					//return true;
-				}
+				fnStoreNode( iter->wheels[i] );
 			}
 		}
 		
@@ -686,44 +841,93 @@ bool MOPhysicsSolver::UpdateAllCars(FBEvaluateInfo *pEvaluateInfo)
 	return true;
 }
 
-//! Real-time evaluation engine function.
-bool MOPhysicsSolver::AnimationNodeNotify ( FBAnimationNode* pAnimationNode, FBEvaluateInfo* pEvaluateInfo, FBConstraintInfo* pConstraintInfo )
+bool MOPhysicsSolver::UpdateAllBodies(FBEvaluateInfo *pEvaluateInfo)
 {
-	if (pAnimationNode == nullptr || mHardware.get() == nullptr )
-		return false;
+	if (mWriteData == false || mBatchNodes.empty() )
+		return true;
+
+	// 1 - gather matrices into one array, interpolated between two physics steps as car outputs are
 
-	// 1 - evaluate physics
+	const int count = (int) mBatchNodes.size();
+	const double alpha = mClock.GetAlpha();
 
-	bool result = false;
+	for (int i=0; i<count; ++i)
+	{
+		const PhysNode *node = mBatchNodes[i];
 
-	UpdateInput(pEvaluateInfo);
-	result = UpdatePhysics(pEvaluateInfo);
+		if (node->hasState)
+			PhysicsInterpolateMatrix( node->prevMatrix, node->currMatrix, alpha, mTransformBatch.GetMatrix(i) );
+		else
+			memcpy( mTransformBatch.GetMatrix(i), node->body->GetMatrix( GetWorldPtr() ), sizeof(double) * 16 );
+	}
 
-	//
-	// all scene simple rigid bodies
-	/*
-	for (auto iter=begin(mRigidBodies); iter!=end(mRigidBodies); ++iter)
+	// 2 - decompose on all threads in the rotation order of every model
+
+	mTransformBatch.Decompose();
+
+	// 3 - results into the table
+
+	for (int i=0; i<count; ++i)
 	{
-		WritePhysNodeData(*iter, writedata, pEvaluateInfo);
+		const PhysNode *node = mBatchNodes[i];
+
+		if (node->trSlot >= 0)
+			mEvaluationCache.SetSlotData(node->trSlot, mTransformBatch.GetTranslation(i) );
+		if (node->rotSlot >= 0)
+			mEvaluationCache.SetSlotData(node->rotSlot, mTransformBatch.GetRotation(i) );
 	}
-	
-	//
-	// all scene dynamic chains (socket joints inbetween)
-	for (auto iter=begin(mChainNodes); iter!=end(mChainNodes); ++iter)
+
+	mEvaluationCache.CountConversions(count);
+	return true;
+}
+
+bool MOPhysicsSolver::EvaluateOnce(FBEvaluateInfo *pEvaluateInfo)
+{
+	if (mEvaluationSlotsDirty)
+		BuildEvaluationSlots();
+
+	// the engine asks about every node of the solver, only the first notify of a tick does the work
+	if (mEvaluationCache.BeginTick( pEvaluateInfo->GetEvaluationID(), pEvaluateInfo->GetSystemTime().Get() ) )
 	{
+		// 1 - evaluate physics
 
-		for (int i=0; i<MAX_NUMBER_OF_CHAIN_JOINS; ++i)
+		UpdateInput(pEvaluateInfo);
+		bool result = UpdatePhysics(pEvaluateInfo);
+
+		//
+		// all scene cars
+
+		if (result)
 		{
-			WritePhysNodeData(iter->nodes[i], writedata, pEvaluateInfo);
+			result = UpdateAllCars(pEvaluateInfo);
+			UpdateAllBodies(pEvaluateInfo);
 		}
+
+		if (mCaptureActive)
+			CaptureFrame(result);
+
+		mEvaluationCache.EndTick(result);
 	}
-	*/
-	//
-	// all scene cars
 
-	if (result)
+	return mEvaluationCache.GetTickResult();
+}
+
+//! Real-time evaluation engine function.
+bool MOPhysicsSolver::AnimationNodeNotify ( FBAnimationNode* pAnimationNode, FBEvaluateInfo* pEvaluateInfo, FBConstraintInfo* pConstraintInfo )
+{
+	if (pAnimationNode == nullptr || mHardware.get() == nullptr )
+		return false;
+
+	mEvaluationCache.CountNotify();
+
+	bool result = EvaluateOnce(pEvaluateInfo);
+
+	if (result && mWriteData)
 	{
-		result = UpdateAllCars(pEvaluateInfo);
+		const int slot = mEvaluationCache.FindSlot(pAnimationNode);
+		
+		if (slot >= 0 && mEvaluationCache.IsSlotWritten(slot) )
+			pAnimationNode->WriteData( mEvaluationCache.GetSlotData(slot), pEvaluateInfo );
 	}
 
 	if (result == false)
@@ -785,9 +989,19 @@ bool MOPhysicsSolver::LoadLevel( FBComponentList &list )
 {
 	if (mHardware.get() == nullptr) return false;
 
-	LevelGeometry	info(list);
+	// cooked level models are kept between sessions
+	FBString cacheFolder( mSystem.UserConfigPath );
+	cacheFolder = cacheFolder + "\\CollisionCache";
+
+	LevelGeometry	info(list, cacheFolder);
 	mHardware->LoadLevel( &info );
 
+	if (mCaptureActive)
+	{
+		mCapture.hasLevel = 1;
+		CaptureQueryGeometry( &info, mCapture.level, false );
+	}
+
 	DoUpdateDefaultMaterialParams();
 	mNeedRebuild = false;
 
@@ -805,6 +1019,14 @@ void MOPhysicsSolver::DoUpdateDefaultMaterialParams()
 	if (mHardware.get() != nullptr)
 	{
 		mHardware->SetDefaultMaterialParams(softness, elasticity, collidable, staticFriction, dynamicFriction);
+
+		if (mCaptureActive)
+		{
+			const double material[5] = { softness, elasticity, collidable, staticFriction, dynamicFriction };
+
+			mCapture.world.hasMaterial = 1;
+			memcpy( mCapture.world.material, material, sizeof(double) * 5 );
+		}
 	}
 }
 
@@ -832,10 +1054,22 @@ void MOPhysicsSolver::AllocateRigidBodies(const int count)
 
 	for (auto iter=mRigidBodies.begin(); iter!=mRigidBodies.end(); ++iter)
 	{
-		iter->tr = nullptr;
-		iter->rot = nullptr;
-		iter->body = nullptr;
+		ResetPhysNode(*iter);
 	}
+
+	// nodes are assigned after the allocation
+	mEvaluationSlotsDirty = true;
+}
+
+void MOPhysicsSolver::ResetPhysNode(PhysNode &node)
+{
+	node.tr = nullptr;
+	node.rot = nullptr;
+	node.body = nullptr;
+	node.trSlot = -1;
+	node.rotSlot = -1;
+	node.rotationOrder = ePhysicsRotationXYZ;
+	node.hasState = false;
 }
 
 void MOPhysicsSolver::FreePhysNode(PhysNode &pNode)
@@ -856,6 +1090,7 @@ void MOPhysicsSolver::FreePhysNode(PhysNode &pNode)
 		delete pNode.body;
 		pNode.body = nullptr;
 	}
+	pNode.hasState = false;
 }
 
 void MOPhysicsSolver::FreeRigidBodies()
@@ -864,6 +1099,8 @@ void MOPhysicsSolver::FreeRigidBodies()
 	{
 		FreePhysNode(*iter);
 	}
+
+	mEvaluationSlotsDirty = true;
 }
 
 void MOPhysicsSolver::AllocateChainNodes(const int count)
@@ -876,13 +1113,11 @@ void MOPhysicsSolver::AllocateChainNodes(const int count)
 	{
 		for (int i=0; i<MAX_NUMBER_OF_CHAIN_JOINS; ++i)
 		{
-			auto &node = iter->nodes[i];
-			
-			node.tr = nullptr;
-			node.rot = nullptr;
-			node.body = nullptr;
+			ResetPhysNode(iter->nodes[i]);
 		}
 	}
+
+	mEvaluationSlotsDirty = true;
 }
 
 void MOPhysicsSolver::FreeChainNodes()
@@ -894,6 +1129,8 @@ void MOPhysicsSolver::FreeChainNodes()
 			FreePhysNode(iter->nodes[i]);
 		}
 	}
+
+	mEvaluationSlotsDirty = true;
 }
 
 void MOPhysicsSolver::AllocateCars(const int count)
@@ -908,13 +1145,24 @@ void MOPhysicsSolver::AllocateCars(const int count)
 		iter->car = nullptr;
 		iter->chassis.rot = nullptr;
 		iter->chassis.tr = nullptr;
+		iter->chassis.trSlot = -1;
+		iter->chassis.rotSlot = -1;
+		iter->chassis.hasState = false;
 
 		for (int i=0; i<4; ++i)
 		{
 			iter->wheels[i].tr = nullptr;
 			iter->wheels[i].rot = nullptr;
+			iter->wheels[i].trSlot = -1;
+			iter->wheels[i].rotSlot = -1;
+			iter->wheels[i].hasState = false;
 		}
+
+		memset( iter->lastInputs, 0, sizeof(double) * PHYSICS_CAPTURE_CAR_INPUTS );
 	}
+
+	// nodes are assigned after the allocation
+	mEvaluationSlotsDirty = true;
 }
 
 void MOPhysicsSolver::FreeCar(std::vector<CarNode>::iterator	&iter)
@@ -940,6 +1188,8 @@ void MOPhysicsSolver::FreeCars()
 	{
 		FreeCar(iter);
 	}
+
+	mEvaluationSlotsDirty = true;
 }
 
 /*
@@ -1086,6 +1336,23 @@ void ComputeAlignMatrix( FBModel *pModel, EAxis localFront, EAxis localUp, EAxis
 	FBMatrixMult( visualAlignMatrix, matrix, matrix2 );
 }
 
+// euler order of the model rotation property, spheric and inactive rotation are XYZ
+int ModelRotationOrder(FBModel *pModel)
+{
+	if (pModel == nullptr || pModel->RotationActive == false)
+		return ePhysicsRotationXYZ;
+
+	switch( (FBModelRotationOrder) pModel->RotationOrder )
+	{
+	case kFBEulerXZY: return ePhysicsRotationXZY;
+	case kFBEulerYZX: return ePhysicsRotationYZX;
+	case kFBEulerYXZ: return ePhysicsRotationYXZ;
+	case kFBEulerZXY: return ePhysicsRotationZXY;
+	case kFBEulerZYX: return ePhysicsRotationZYX;
+	default: return ePhysicsRotationXYZ;
+	}
+}
+
 void MOPhysicsSolver::EnterOnline()
 {
 	WaitForUpdateToFinish();
@@ -1172,6 +1439,8 @@ void MOPhysicsSolver::EnterOnline()
 					numberOfNodes += 2;
 
 					rigidbody->body = CreateNewBody(&options, &rigidbody->geometry, true);
+					rigidbody->rotationOrder = ModelRotationOrder(pmodel);
+					rigidbody->hasState = false;
 
 					rigidbody->tr->Reference = (kReference) rigidbody->body;
 					rigidbody->rot->Reference = (kReference) rigidbody->body;
@@ -1293,6 +1562,9 @@ void MOPhysicsSolver::EnterOnline()
 	for (int i=0; i<mCollisions.GetCount(); ++i)
 		mCollisions.SetAt(i, pPropList->GetAt(i) );
 
+	if (mCaptureActive)
+		CaptureScene();
+
 	LoadLevel( mCollisions );
 }
 
@@ -1332,8 +1604,13 @@ bool MOPhysicsSolver::DisconnectACar(FBPhysicalProperties	*props)
 	{
 		if (iter->props == props)
 		{
+			// captured car pointers are not valid any more
+			if (mCaptureActive)
+				CaptureEnd();
+
 			FreeCar(iter);
 			mCars.erase(iter);
+			mEvaluationSlotsDirty = true;
 			return true;
 		}
 	}
@@ -1342,6 +1619,146 @@ bool MOPhysicsSolver::DisconnectACar(FBPhysicalProperties	*props)
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// capture
+
+void MOPhysicsSolver::CaptureBegin()
+{
+	mCapture.Clear();
+	mCaptureCarIndices.clear();
+	mCaptureCars.clear();
+	mCaptureBodies.clear();
+
+	PhysicsCaptureWorld &world = mCapture.world;
+	world.scaling = mWorldScaling;
+	world.threads = PhysicsThreads;
+	world.samples = PhysicsSamples;
+	world.fps = PhysicsFPS;
+	Gravity.GetData( world.gravity, sizeof(double)*3 );
+	world.hasMaterial = 0;
+
+	mCaptureActive = true;
+}
+
+void MOPhysicsSolver::CaptureScene()
+{
+	for (auto iter=begin(mRigidBodies); iter!=end(mRigidBodies); ++iter)
+	{
+		if (iter->body == nullptr)
+			continue;
+
+		// the same options as in EnterOnline
+		PHYSICS_INTERFACE::BodyOptions options;
+		memset( &options, 0, sizeof(PHYSICS_INTERFACE::BodyOptions) );
+		options.mass = 5.0;
+		options.friction = 1.0;
+
+		PhysicsCaptureBody body;
+		body.options.assign( (const char*) &options, (const char*) &options + sizeof(PHYSICS_INTERFACE::BodyOptions) );
+		body.convexHull = 1;
+		CaptureQueryGeometry( &iter->geometry, body.geometry );
+
+		mCapture.bodies.push_back(body);
+		mCaptureBodies.push_back(iter->body);
+	}
+
+	for (int i=0; i<(int) mCars.size(); ++i)
+	{
+		CarNode &node = mCars[i];
+
+		if (node.car == nullptr || node.props == nullptr)
+			continue;
+
+		PHYSICS_INTERFACE::CarOptions options;
+		memset( &options, 0, sizeof(PHYSICS_INTERFACE::CarOptions) );
+		( (MOCarPhysProperties*) node.props )->FillCarInfo(options);
+
+		mCapture.cars.push_back( PhysicsCaptureCar() );
+		PhysicsCaptureCar &car = mCapture.cars.back();
+
+		car.options.assign( (const char*) &options, (const char*) &options + sizeof(PHYSICS_INTERFACE::CarOptions) );
+
+		CaptureQueryGeometry( &node.chassis.geometry, car.parts[0] );
+		for (int j=0; j<4; ++j)
+			CaptureQueryGeometry( &node.wheels[j].geometry, car.parts[j+1] );
+
+		const std::vector<double> &knots = node.steeringCurve.GetKnots();
+		car.hasPath = (knots.size() > 0) ? 1 : 0;
+		
+		if (car.hasPath)
+			CaptureQueryPath( &node.steeringCurve, knots, node.steeringCurve.GetKnotStep(), 1024, car.path );
+
+		mCaptureCarIndices.push_back(i);
+		mCaptureCars.push_back(node.car);
+	}
+}
+
+void MOPhysicsSolver::CaptureFrame(const bool outputs)
+{
+	const int frame = mCapture.GetNumberOfFrames();
+
+	// option changes since the last frame are applied before this one
+	for (int i=0; i<(int) mCaptureCarIndices.size(); ++i)
+	{
+		const CarNode &node = mCars[mCaptureCarIndices[i]];
+
+		PHYSICS_INTERFACE::CarOptions options;
+		memset( &options, 0, sizeof(PHYSICS_INTERFACE::CarOptions) );
+		( (MOCarPhysProperties*) node.props )->FillCarInfo(options);
+
+		PhysicsCaptureEvent ev;
+		ev.frame = frame;
+		ev.car = i;
+		ev.options.assign( (const char*) &options, (const char*) &options + sizeof(PHYSICS_INTERFACE::CarOptions) );
+
+		const std::vector<char> *last = &mCapture.cars[i].options;
+		for (auto iter=mCapture.events.begin(); iter!=mCapture.events.end(); ++iter)
+		{
+			if (iter->car == i)
+				last = &iter->options;
+		}
+
+		if (ev.options != *last)
+			mCapture.events.push_back(ev);
+	}
+
+	const int flags = mCaptureFlags | ( (outputs) ? ePhysicsCaptureFrameOutputs : 0 );
+	mCapture.AddFrame(mCaptureTime, flags);
+
+	for (int i=0; i<(int) mCaptureCarIndices.size(); ++i)
+	{
+		memcpy( mCapture.GetCarInputs(frame, i), mCars[mCaptureCarIndices[i]].lastInputs, sizeof(double) * PHYSICS_CAPTURE_CAR_INPUTS );
+	}
+
+	if (outputs)
+	{
+		CaptureWorldOutputs( mCaptureCars.data(), (int) mCaptureCars.size(), mCaptureBodies.data(), (int) mCaptureBodies.size(),
+			mHardware.get(), mCapture.GetFrameOutputs(frame) );
+	}
+}
+
+void MOPhysicsSolver::CaptureEnd()
+{
+	mCaptureActive = false;
+
+	FBString filename( CaptureFile );
+	if (filename.GetLen() == 0)
+	{
+		filename = mSystem.UserConfigPath;
+		filename = filename + "\\MoPhysics.capture";
+	}
+
+	if (mCapture.Save(filename) )
+	{
+		printf( "[MoPhysics] capture of %d frames is saved - %s\n", mCapture.GetNumberOfFrames(), (const char*) filename );
+	}
+
+	mCapture.Clear();
+	mCaptureCarIndices.clear();
+	mCaptureCars.clear();
+	mCaptureBodies.clear();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // MO Physics Layout
 
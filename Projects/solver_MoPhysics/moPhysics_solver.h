@@ -19,6 +19,10 @@
 //--- Class declaration
 #include "Common_Physics\physics_common.h"
 #include "queryFBGeometry.h"
+#include "moPhysics_evaluation.h"
+#include "moPhysics_capture.h"
+#include "moPhysics_clock.h"
+#include "moPhysics_transformBatch.h"
 #include <vector>
 
 //--- Registration defines
@@ -103,11 +107,17 @@ public:
 	static void ActionResetToStart( HIObject pObject, bool value );
 	static void ActionSaveState( HIObject pObject, bool value );
 	static void ActionSerialize( HIObject pObject, bool value );
+	static void ActionEvaluationBenchmark( HIObject pObject, bool value );
+	static void ActionCollisionCookTest( HIObject pObject, bool value );
+	static void ActionCaptureTest( HIObject pObject, bool value );
+	static void ActionClockTest( HIObject pObject, bool value );
+	static void ActionTransformBatchBenchmark( HIObject pObject, bool value );
 	
 	static bool GetLiveMode( HIObject pObject );
 	static void SetLiveMode( HIObject pObject, bool value );
 	static bool GetRecording( HIObject pObject );
 	static void SetRecording( HIObject pObject, bool value );
+	static void SetCaptureRecord( HIObject pObject, bool value );
 
 	static void SetWorldScale( HIObject pObject, double value );
 
@@ -128,6 +138,14 @@ public:
 	FBPropertyAction					ResetToStart;
 	FBPropertyAction					SetStartState;
 	FBPropertyAction					Serialize;
+	FBPropertyAction					EvaluationBenchmark;	// synthetic cars, work per frame of a per notify and per tick evaluation
+	FBPropertyAction					CollisionCookTest;		// synthetic level, checks the collision cook and the cache
+	FBPropertyAction					CaptureTest;			// synthetic capture, checks the capture file and the comparison
+	FBPropertyAction					ClockTest;				// toy world, checks fixed steps are the same for any frame rate
+	FBPropertyAction					TransformBatchBenchmark;	// synthetic bodies, per body and batched matrix to TRS conversion
+
+	FBPropertyBool						CaptureRecord;		// record a capture from the solver activation, saved on deactivation
+	FBPropertyString					CaptureFile;		// empty to store MoPhysics.capture in the user config folder
 
 	FBPropertyBaseEnum<EPhysicsEngine>	PhysicsEngine;
 
@@ -204,6 +222,8 @@ protected:
 
 	double								mLastTorque;
 
+	PhysicsFixedClock					mClock;					// whole steps of 1 / PhysicsFPS, outputs are interpolated
+
 protected:
 
 	double				mWorldScaling;
@@ -216,6 +236,15 @@ protected:
 		FBAnimationNode		*rot;
 
 		PHYSICS_INTERFACE::IBody	*body;
+
+		int					trSlot;		// result table slots, -1 without a node
+		int					rotSlot;
+		int					rotationOrder;	// EPhysicsRotationOrder of the model
+
+		// two last physics states, outputs are interpolated between them
+		bool				hasState;
+		double				prevMatrix[16];
+		double				currMatrix[16];
 	};
 
 	std::vector<PhysNode>		mRigidBodies;
@@ -225,6 +254,7 @@ protected:
 	void		FreeRigidBodies();
 
 	bool		WritePhysNodeData(PhysNode &node, bool writedata, FBEvaluateInfo* pEvaluateInfo);
+	void		ResetPhysNode(PhysNode &node);
 
 	// dynamic chains - bodies connected with a ball sockets
 	//
@@ -250,6 +280,14 @@ protected:
 
 			FBAnimationNode		*tr;
 			FBAnimationNode		*rot;
+
+			int					trSlot;		// result table slots, -1 without a node
+			int					rotSlot;
+
+			// two last physics states, outputs are interpolated between them
+			bool				hasState;
+			double				prevMatrix[16];
+			double				currMatrix[16];
 		};
 
 		Node				chassis;
@@ -277,6 +315,9 @@ protected:
 
 		// pointer to phys properties
 		FBPhysicalProperties	*props;
+
+		// values passed to the car on the last input update
+		double				lastInputs[PHYSICS_CAPTURE_CAR_INPUTS];
 	};
 
 	std::vector<CarNode>		mCars;
@@ -285,9 +326,46 @@ protected:
 	void		FreeCar(std::vector<CarNode>::iterator	&iter);
 	void		FreeCars();
 
+	// results of all output nodes for the current evaluation tick
+	PhysicsEvaluationCache		mEvaluationCache;
+	bool						mEvaluationSlotsDirty;
+	bool						mWriteData;
+
+	// rigid bodies and chain joints are converted together after the step
+	PhysicsTransformBatch		mTransformBatch;
+	std::vector<PhysNode*>		mBatchNodes;
+
+	void	BuildEvaluationSlots();
+
+	//! keep a state of cars and batch bodies after a physics step, fill is for the first state after a reset
+	void	StoreStates(const bool fill);
+
 	bool	UpdateInput(FBEvaluateInfo* pEvaluateInfo);
 	bool	UpdatePhysics(FBEvaluateInfo* pEvaluateInfo);
 	bool	UpdateAllCars(FBEvaluateInfo *pEvaluateInfo);
+	bool	UpdateAllBodies(FBEvaluateInfo *pEvaluateInfo);
+
+	//! input, physics step and car outputs once per evaluation tick, returns a tick result
+	bool	EvaluateOnce(FBEvaluateInfo *pEvaluateInfo);
+
+	// capture of everything passed to the physics world, see physics_replay tool
+
+	bool						mCaptureActive;
+	PhysicsCapture				mCapture;
+
+	int							mCaptureFlags;			// reset and fetch of the current tick
+	double						mCaptureTime;
+
+	std::vector<int>						mCaptureCarIndices;		// captured cars in mCars
+	std::vector<PHYSICS_INTERFACE::ICar*>	mCaptureCars;
+	std::vector<PHYSICS_INTERFACE::IBody*>	mCaptureBodies;
+
+	void	CaptureBegin();
+	//! bodies and cars after they are created, level is taken in LoadLevel
+	void	CaptureScene();
+	void	CaptureFrame(const bool outputs);
+	//! stops recording and saves the file
+	void	CaptureEnd();
 };
 
 
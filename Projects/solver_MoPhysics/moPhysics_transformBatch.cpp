@@ -0,0 +1,389 @@
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_transformBatch.cpp
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "moPhysics_transformBatch.h"
+#include "algorithm\ParallelFor.h"
+
+#include <emmintrin.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+#define PHYSICS_BATCH_GRAIN_SIZE		512
+
+static const double RAD_TO_DEG = 57.295779513082320876798154814105;
+static const double DEG_TO_RAD = 0.017453292519943295769236907684886;
+
+// axis of the first, second and third rotation, odd permutations flip the signs
+static const int gOrderAxes[ePhysicsRotationCount][3] = {
+	{0, 1, 2}, {0, 2, 1}, {1, 2, 0}, {1, 0, 2}, {2, 0, 1}, {2, 1, 0}
+};
+static const double gOrderParity[ePhysicsRotationCount] = {
+	1.0, -1.0, 1.0, -1.0, 1.0, -1.0
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// scalar part
+
+// r is a normalized 3x3 rotation, r[3 * column + row], rotation = Rk * Rj * Ri
+static inline void RotationToEuler(const double *r, const int rotationOrder, double *rotation)
+{
+	const int i = gOrderAxes[rotationOrder][0];
+	const int j = gOrderAxes[rotationOrder][1];
+	const int k = gOrderAxes[rotationOrder][2];
+	const double parity = gOrderParity[rotationOrder];
+
+	#define R(row, col)	r[3 * (col) + (row)]
+
+	const double sinb = -parity * R(k, i);
+	double a, b, c;
+
+	if (sinb < 0.9999999 && sinb > -0.9999999)
+	{
+		b = asin(sinb);
+		a = atan2(parity * R(k, j), R(k, k));
+		c = atan2(parity * R(j, i), R(i, i));
+	}
+	else
+	{
+		// gimbal lock, the last rotation is merged into the first one
+		b = (sinb > 0.0) ? 1.5707963267948966 : -1.5707963267948966;
+		a = atan2(-parity * R(j, k), R(j, j));
+		c = 0.0;
+	}
+
+	#undef R
+
+	rotation[i] = a * RAD_TO_DEG;
+	rotation[j] = b * RAD_TO_DEG;
+	rotation[k] = c * RAD_TO_DEG;
+}
+
+void PhysicsMatrixToEuler(const double *m, const int rotationOrder, double *translation, double *rotation)
+{
+	double r[9];
+
+	for (int axis=0; axis<3; ++axis)
+	{
+		const double *v = m + 4 * axis;
+		const double len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		const double inv = 1.0 / std::max(len, 1.0e-300);
+
+		r[3 * axis] = v[0] * inv;
+		r[3 * axis + 1] = v[1] * inv;
+		r[3 * axis + 2] = v[2] * inv;
+	}
+
+	RotationToEuler(r, rotationOrder, rotation);
+
+	translation[0] = m[12];
+	translation[1] = m[13];
+	translation[2] = m[14];
+}
+
+static void AxisRotation(const int axis, const double angle, double *r)
+{
+	const double c = cos(angle);
+	const double s = sin(angle);
+
+	const int a1 = (axis + 1) % 3;
+	const int a2 = (axis + 2) % 3;
+
+	for (int i=0; i<9; ++i)
+		r[i] = 0.0;
+
+	// r[3 * column + row]
+	r[3 * axis + axis] = 1.0;
+	r[3 * a1 + a1] = c;
+	r[3 * a2 + a2] = c;
+	r[3 * a1 + a2] = s;
+	r[3 * a2 + a1] = -s;
+}
+
+static void MultRotation(const double *a, const double *b, double *result)
+{
+	for (int col=0; col<3; ++col)
+		for (int row=0; row<3; ++row)
+			result[3 * col + row] = a[row] * b[3 * col] + a[3 + row] * b[3 * col + 1] + a[6 + row] * b[3 * col + 2];
+}
+
+void PhysicsEulerToMatrix(const double *translation, const double *rotation, const int rotationOrder, double *m)
+{
+	const int i = gOrderAxes[rotationOrder][0];
+	const int j = gOrderAxes[rotationOrder][1];
+	const int k = gOrderAxes[rotationOrder][2];
+
+	double ri[9], rj[9], rk[9], temp[9], r[9];
+	AxisRotation(i, rotation[i] * DEG_TO_RAD, ri);
+	AxisRotation(j, rotation[j] * DEG_TO_RAD, rj);
+	AxisRotation(k, rotation[k] * DEG_TO_RAD, rk);
+
+	MultRotation(rj, ri, temp);
+	MultRotation(rk, temp, r);
+
+	for (int axis=0; axis<3; ++axis)
+	{
+		m[4 * axis] = r[3 * axis];
+		m[4 * axis + 1] = r[3 * axis + 1];
+		m[4 * axis + 2] = r[3 * axis + 2];
+		m[4 * axis + 3] = 0.0;
+	}
+
+	m[12] = translation[0];
+	m[13] = translation[1];
+	m[14] = translation[2];
+	m[15] = 1.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PhysicsTransformBatch
+
+PhysicsTransformBatch::PhysicsTransformBatch()
+{}
+
+void PhysicsTransformBatch::Clear()
+{
+	mMatrices.clear();
+	mOrders.clear();
+	mTranslations.clear();
+	mRotations.clear();
+}
+
+int PhysicsTransformBatch::Add(const int rotationOrder)
+{
+	const int index = GetCount();
+
+	mOrders.push_back( (rotationOrder >= 0 && rotationOrder < ePhysicsRotationCount) ? rotationOrder : ePhysicsRotationXYZ );
+	mMatrices.resize(16 * (index + 1), 0.0);
+	mTranslations.resize(3 * (index + 1), 0.0);
+	mRotations.resize(3 * (index + 1), 0.0);
+
+	double *m = GetMatrix(index);
+	m[0] = m[5] = m[10] = m[15] = 1.0;
+
+	return index;
+}
+
+void PhysicsTransformBatch::DecomposeRange(const int first, const int last)
+{
+	const __m128d tiny = _mm_set1_pd(1.0e-300);
+	const __m128d one = _mm_set1_pd(1.0);
+
+	int index = first;
+
+	// two matrices per lane, normalized axes are stored per matrix for the euler part
+	for ( ; index + 1 < last; index += 2)
+	{
+		const double *m0 = &mMatrices[16 * index];
+		const double *m1 = m0 + 16;
+
+		double r0[9], r1[9];
+
+		for (int axis=0; axis<3; ++axis)
+		{
+			const int offset = 4 * axis;
+
+			__m128d x = _mm_set_pd(m1[offset], m0[offset]);
+			__m128d y = _mm_set_pd(m1[offset + 1], m0[offset + 1]);
+			__m128d z = _mm_set_pd(m1[offset + 2], m0[offset + 2]);
+
+			__m128d len = _mm_add_pd( _mm_add_pd( _mm_mul_pd(x, x), _mm_mul_pd(y, y) ), _mm_mul_pd(z, z) );
+			len = _mm_sqrt_pd(len);
+
+			const __m128d inv = _mm_div_pd( one, _mm_max_pd(len, tiny) );
+
+			x = _mm_mul_pd(x, inv);
+			y = _mm_mul_pd(y, inv);
+			z = _mm_mul_pd(z, inv);
+
+			_mm_storel_pd(r0 + 3 * axis, x);
+			_mm_storeh_pd(r1 + 3 * axis, x);
+			_mm_storel_pd(r0 + 3 * axis + 1, y);
+			_mm_storeh_pd(r1 + 3 * axis + 1, y);
+			_mm_storel_pd(r0 + 3 * axis + 2, z);
+			_mm_storeh_pd(r1 + 3 * axis + 2, z);
+		}
+
+		RotationToEuler(r0, mOrders[index], &mRotations[3 * index]);
+		RotationToEuler(r1, mOrders[index + 1], &mRotations[3 * index + 3]);
+
+		// both translations with two moves
+		double *t = &mTranslations[3 * index];
+		_mm_storeu_pd(t, _mm_loadu_pd(m0 + 12) );
+		t[2] = m0[14];
+		_mm_storeu_pd(t + 3, _mm_loadu_pd(m1 + 12) );
+		t[5] = m1[14];
+	}
+
+	for ( ; index < last; ++index)
+	{
+		PhysicsMatrixToEuler(&mMatrices[16 * index], mOrders[index], &mTranslations[3 * index], &mRotations[3 * index]);
+	}
+}
+
+void PhysicsTransformBatch::Decompose(const int numberOfThreads)
+{
+	ParallelFor( GetCount(), PHYSICS_BATCH_GRAIN_SIZE, [this] (const int first, const int last) {
+		DecomposeRange(first, last);
+	}, numberOfThreads );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+
+// a body is a separate allocation like the physics layer ones
+struct BenchmarkBody
+{
+	double		matrix[16];
+	int			rotationOrder;
+
+	double		translation[3];
+	double		rotation[3];
+};
+
+static bool BenchmarkRoundTrip()
+{
+	bool result = true;
+
+	// regular angles and gimbal lock of every order
+	const double angles[][3] = {
+		{10.0, 20.0, 30.0}, {-170.0, 45.0, 95.0}, {33.0, -89.0, -12.0}, {0.0, 0.0, 0.0},
+		{25.0, 90.0, 0.0}, {-60.0, -90.0, 0.0}, {90.0, 90.0, 90.0}
+	};
+	const double position[3] = {1.0, -2.0, 3.0};
+
+	for (int order=0; order<ePhysicsRotationCount; ++order)
+	{
+		for (int n=0; n<(int) (sizeof(angles) / sizeof(angles[0])); ++n)
+		{
+			// the same angle for the second rotation axis of the order
+			double rotation[3];
+			const int *axes = gOrderAxes[order];
+			rotation[axes[0]] = angles[n][0];
+			rotation[axes[1]] = angles[n][1];
+			rotation[axes[2]] = angles[n][2];
+
+			double m[16], m2[16], t[3], r[3];
+			PhysicsEulerToMatrix(position, rotation, order, m);
+			PhysicsMatrixToEuler(m, order, t, r);
+			PhysicsEulerToMatrix(t, r, order, m2);
+
+			double maxDiff = 0.0;
+			for (int i=0; i<16; ++i)
+				maxDiff = std::max(maxDiff, fabs(m[i] - m2[i]) );
+
+			if (maxDiff > 1.0e-6)
+			{
+				printf( "[MoPhysics] transform batch - round trip of order %d, angles %d, difference %g\n", order, n, maxDiff );
+				result = false;
+			}
+		}
+	}
+
+	return result;
+}
+
+void PhysicsTransformBatchBenchmark(const int maxNumberOfBodies, const int numberOfFrames)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	const bool roundTrip = BenchmarkRoundTrip();
+
+	printf( "[MoPhysics] transform batch benchmark, %d frames, %d threads, time per frame\n", numberOfFrames, ParallelForThreadCount() );
+	printf( "[MoPhysics] %8s | %12s %12s %12s | %10s %12s\n", "bodies", "per body ms", "batch 1 ms", "batch N ms", "speedup", "max diff" );
+
+	unsigned int seed = 7;
+	auto fnRandom = [&seed] () {
+		seed = seed * 1664525u + 1013904223u;
+		return (double) (seed >> 8) / (double) (1u << 24);
+	};
+
+	double worstDiff = 0.0;
+
+	for (int numberOfBodies=256; numberOfBodies<=maxNumberOfBodies; numberOfBodies *= 4)
+	{
+		std::vector<std::unique_ptr<BenchmarkBody>>	bodies(numberOfBodies);
+		PhysicsTransformBatch						batch;
+
+		for (int i=0; i<numberOfBodies; ++i)
+		{
+			bodies[i].reset(new BenchmarkBody() );
+			BenchmarkBody &body = *bodies[i];
+
+			body.rotationOrder = i % ePhysicsRotationCount;
+
+			const double t[3] = { 100.0 * fnRandom(), 100.0 * fnRandom(), 100.0 * fnRandom() };
+			const double r[3] = { 360.0 * fnRandom() - 180.0, 180.0 * fnRandom() - 90.0, 360.0 * fnRandom() - 180.0 };
+			PhysicsEulerToMatrix(t, r, body.rotationOrder, body.matrix);
+
+			batch.Add(body.rotationOrder);
+		}
+
+		// 1 - previous scheme, one conversion per body
+
+		auto startTime = clock::now();
+		for (int frame=0; frame<numberOfFrames; ++frame)
+		{
+			for (auto iter=bodies.begin(); iter!=bodies.end(); ++iter)
+			{
+				BenchmarkBody &body = **iter;
+				body.matrix[12] += 0.01;
+				PhysicsMatrixToEuler(body.matrix, body.rotationOrder, body.translation, body.rotation);
+			}
+		}
+		const double oldMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count() / numberOfFrames;
+
+		// 2 - gather and decompose the batch
+
+		auto fnRunBatch = [&] (const int numberOfThreads) {
+			auto batchStart = clock::now();
+			for (int frame=0; frame<numberOfFrames; ++frame)
+			{
+				for (int i=0; i<numberOfBodies; ++i)
+				{
+					bodies[i]->matrix[12] += 0.01;
+					memcpy( batch.GetMatrix(i), bodies[i]->matrix, sizeof(double) * 16 );
+				}
+
+				batch.Decompose(numberOfThreads);
+			}
+			return std::chrono::duration<double, std::milli>(clock::now() - batchStart).count() / numberOfFrames;
+		};
+
+		const double singleMs = fnRunBatch(1);
+		const double threadsMs = fnRunBatch(0);
+
+		// 3 - the same values as the scalar reference
+
+		double maxDiff = 0.0;
+		for (int i=0; i<numberOfBodies; ++i)
+		{
+			double t[3], r[3];
+			PhysicsMatrixToEuler(batch.GetMatrix(i), bodies[i]->rotationOrder, t, r);
+
+			for (int k=0; k<3; ++k)
+			{
+				maxDiff = std::max(maxDiff, fabs(t[k] - batch.GetTranslation(i)[k]) );
+				maxDiff = std::max(maxDiff, fabs(r[k] - batch.GetRotation(i)[k]) );
+			}
+		}
+		worstDiff = std::max(worstDiff, maxDiff);
+
+		printf( "[MoPhysics] %8d | %12.3f %12.3f %12.3f | %9.2fx %12g\n", numberOfBodies, oldMs, singleMs, threadsMs,
+			(threadsMs > 0.0) ? oldMs / threadsMs : 0.0, maxDiff );
+	}
+
+	printf( "[MoPhysics] transform batch benchmark %s\n", (roundTrip && worstDiff < 1.0e-9) ? "passed" : "FAILED" );
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// file: moPhysics_transformBatch.h
+//
+//	Author Sergey Solokhin (Neill3d)
+//
+//	GitHub page - https://github.com/Neill3d/MoPlugs
+//	Licensed under BSD 3-Clause - https://github.com/Neill3d/MoPlugs/blob/master/LICENSE
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+/*
+	Batched transform write-back
+
+	matrices of all rigid bodies and chain joints are gathered into one contiguous array after the
+	 physics step, then decomposed into a translation and an euler rotation (degrees) in the rotation
+	 order of every node. Axis normalization runs two matrices per SSE2 lane, ranges of entries are
+	 spread over worker threads.
+
+	Matrices are 4x4 with axes in 0-2, 4-6, 8-10 and translation in 12-14. No SDK dependency.
+*/
+
+// the same order as FBModelRotationOrder euler values, first letter is the first rotation
+enum EPhysicsRotationOrder
+{
+	ePhysicsRotationXYZ,
+	ePhysicsRotationXZY,
+	ePhysicsRotationYZX,
+	ePhysicsRotationYXZ,
+	ePhysicsRotationZXY,
+	ePhysicsRotationZYX,
+	ePhysicsRotationCount
+};
+
+//! scalar reference of the decomposition, rotation is in degrees
+void PhysicsMatrixToEuler(const double *m, const int rotationOrder, double *translation, double *rotation);
+
+//! rotation in degrees applied in the given order, no scale
+void PhysicsEulerToMatrix(const double *translation, const double *rotation, const int rotationOrder, double *m);
+
+//////////////////////////////////////////////////////////////////
+//
+
+class PhysicsTransformBatch
+{
+public:
+
+	//! a constructor
+	PhysicsTransformBatch();
+
+	void Clear();
+
+	//! returns an entry index, matrices are written into entries every frame
+	int Add(const int rotationOrder);
+	int GetCount() const { return (int) mOrders.size(); }
+
+	double *GetMatrix(const int index) { return &mMatrices[16 * index]; }
+
+	const double *GetTranslation(const int index) const { return &mTranslations[3 * index]; }
+	const double *GetRotation(const int index) const { return &mRotations[3 * index]; }
+
+	//! all the entries, 0 threads is a hardware concurrency
+	void Decompose(const int numberOfThreads=0);
+
+	//! entries in [first; last)
+	void DecomposeRange(const int first, const int last);
+
+protected:
+
+	std::vector<double>		mMatrices;			// 16 per entry
+	std::vector<int>		mOrders;
+
+	std::vector<double>		mTranslations;		// 3 per entry
+	std::vector<double>		mRotations;			// 3 per entry, degrees
+};
+
+//! per body conversion against the batch on one and on all threads for a growing number of bodies,
+//!  checks the batch results with the scalar reference and prints time per frame into the log
+void PhysicsTransformBatchBenchmark(const int maxNumberOfBodies, const int numberOfFrames);
@@ -13,6 +13,8 @@
 
 #include "queryFBGeometry.h"
 #include <GL\glew.h>
+
+#include <chrono>
 //////////////////////////////////////////////////////////////////////////////
 // QueryFBGeometry
 
@@ -497,11 +499,11 @@ LevelGeometry::LevelGeometry()
 {
 }
 
-LevelGeometry::LevelGeometry( FBComponentList &list )
+LevelGeometry::LevelGeometry( FBComponentList &list, const char *cacheFolder )
 	: mNumberOfVertices(0)
 	, mNumberOfPolys(0)
 {
-	Prep(list);
+	Prep(list, cacheFolder);
 }
 
 //! a destructor
@@ -511,41 +513,30 @@ LevelGeometry::~LevelGeometry()
 }
 
 //
-void LevelGeometry::Prep( FBComponentList &list )
+void LevelGeometry::Prep( FBComponentList &list, const char *cacheFolder )
 {
-	int totalNumberOfVerts = 0;
-	int totalNumberOfPolys = 0;
-
+	typedef std::chrono::high_resolution_clock clock;
+	const auto startTime = clock::now();
 
-	for (int i=0; i<list.GetCount(); ++i)
-	{
-		FBModel *pModel = (FBModel*) list[i];
-		FBGeometry *pGeometry = pModel->Geometry;
-		FBMesh *pMesh = pModel->TessellatedMesh; // (FBMesh*) pGeometry;
+	CollisionCookCache cache;
+	if (cacheFolder)
+		cache.SetFolder(cacheFolder);
 
-		totalNumberOfVerts += pMesh->VertexCount();
+	CollisionCookOptions options;
 
-		for (int j=0; j<pMesh->PolygonCount(); ++j)
-			if (pMesh->PolygonVertexCount(j) <= 4) 
-			{
-				totalNumberOfPolys++;
-			}
-		
-	}
+	std::vector<CollisionMesh>	meshes(list.GetCount() );
+	std::vector<int>			polyCounts;
+	std::vector<int>			polyIndices;
 
-	Allocate(totalNumberOfVerts, totalNumberOfPolys);
-
-	totalNumberOfVerts = 0;
-	totalNumberOfPolys = 0;
-
-	auto dstVertex = mVertices.begin();
-	auto dstPoly = mPolys.begin();
+	int numberOfLoaded = 0;
 
 	for (int i=0; i<list.GetCount(); ++i)
 	{
 		FBModel *pModel = (FBModel*) list[i];
-		FBGeometry *pGeometry = pModel->Geometry;
-		FBMesh *pMesh = pModel->TessellatedMesh; // (FBMesh*) pGeometry;
+		FBMesh *pMesh = pModel->TessellatedMesh;
+
+		if (nullptr == pMesh)
+			continue;
 
 		FBMatrix tm;
 		pModel->GetMatrix(tm);
@@ -560,38 +551,90 @@ void LevelGeometry::Prep( FBComponentList &list )
 #else
 		vertices = pMesh->GetPositionsArray(count);
 #endif	
-		// apply TM to make a finish coords of the vertices
-		FBVertex *srcVertex = vertices;
-			
-		for (int j=0; j<count; ++j)
+
+		// polygons of any vertex count, they are triangulated by the cook
+		const int numberOfPolys = pMesh->PolygonCount();
+
+		polyCounts.resize(numberOfPolys);
+		polyIndices.clear();
+
+		for (int j=0; j<numberOfPolys; ++j)
 		{
-			FBVertexMatrixMult( *dstVertex, tm, *srcVertex );
-			dstVertex++;
-			srcVertex++;
+			const int polyVertCount = pMesh->PolygonVertexCount(j);
+			polyCounts[j] = polyVertCount;
+
+			for (int k=0; k<polyVertCount; ++k)
+				polyIndices.push_back( pMesh->PolygonVertexIndex(j, k) );
 		}
 
-		//
-		for (int j=0; j<pMesh->PolygonCount(); ++j)
+		CollisionSourceMesh src;
+		src.positions = (const float*) vertices;
+		src.numberOfVertices = count;
+		src.positionStride = sizeof(FBVertex) / sizeof(float);
+		src.polyVertexCounts = polyCounts.data();
+		src.numberOfPolys = numberOfPolys;
+		src.polyIndices = polyIndices.data();
+
+		for (int k=0; k<16; ++k)
+			src.matrix[k] = tm[k];
+
+		if (cache.Load( CollisionCookKey(src, options), meshes[i] ) )
+		{
+			numberOfLoaded += 1;
+		}
+		else if (CollisionCook(src, options, meshes[i]) )
 		{
-			int polyVertCount = pMesh->PolygonVertexCount(j);
+			cache.Store(meshes[i]);
+		}
+	}
 
-			if (polyVertCount <= 4)
-			{
-				mPolys[totalNumberOfPolys].count = polyVertCount;
+	int totalNumberOfVerts = 0;
+	int totalNumberOfPolys = 0;
 
-				// SHIFT indices
-				for (int k=0; k<polyVertCount; ++k)
-					mPolys[totalNumberOfPolys].indices[k] = totalNumberOfVerts + pMesh->PolygonVertexIndex(j, k);
-				mPolys[totalNumberOfPolys].matId = 0;
+	for (auto iter=meshes.begin(); iter!=meshes.end(); ++iter)
+	{
+		totalNumberOfVerts += iter->GetNumberOfVertices();
+		totalNumberOfPolys += iter->GetNumberOfTriangles();
+	}
 
-				totalNumberOfPolys++;
-			}
+	Allocate(totalNumberOfVerts, totalNumberOfPolys);
+
+	totalNumberOfVerts = 0;
+	totalNumberOfPolys = 0;
+
+	for (auto iter=meshes.begin(); iter!=meshes.end(); ++iter)
+	{
+		const float *srcVertex = iter->positions.data();
+
+		for (int j=0; j<iter->GetNumberOfVertices(); ++j, srcVertex += 3)
+		{
+			FBVertex &dstVertex = mVertices[totalNumberOfVerts + j];
+			dstVertex[0] = srcVertex[0];
+			dstVertex[1] = srcVertex[1];
+			dstVertex[2] = srcVertex[2];
+			dstVertex[3] = 1.0f;
+		}
+
+		// SHIFT indices
+		const int *srcIndex = iter->indices.data();
+
+		for (int j=0; j<iter->GetNumberOfTriangles(); ++j, srcIndex += 3)
+		{
+			Poly &poly = mPolys[totalNumberOfPolys++];
+
+			poly.count = 3;
+			for (int k=0; k<3; ++k)
+				poly.indices[k] = totalNumberOfVerts + srcIndex[k];
+			poly.matId = 0;
 		}
-		
 
 		//
-		totalNumberOfVerts += count;
+		totalNumberOfVerts += iter->GetNumberOfVertices();
 	}
+
+	const double prepMs = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+	printf( "[MoPhysics] level geometry, %d models (%d from the cache), %d triangles, %.1f ms\n",
+		list.GetCount(), numberOfLoaded, totalNumberOfPolys, prepMs );
 }
 
 const int LevelGeometry::GetVertexCount() const 
@@ -748,6 +791,8 @@ QueryFBPath3D::~QueryFBPath3D()
 void QueryFBPath3D::Prep(FBModelPath3D *pModel, const double globalScaling, const int numberOfSteps)
 {
 	mCurve = pModel;
+	mKnots.clear();
+
 #ifdef ORSDK2013
 	if (nullptr != mCurve || numberOfSteps <= 0)
 #else
@@ -772,6 +817,10 @@ void QueryFBPath3D::Prep(FBModelPath3D *pModel, const double globalScaling, cons
 		u += mStep;
 	}
 
+	mKnots.resize(3 * numberOfSteps);
+	for (int i=0; i<numberOfSteps; ++i)
+		memcpy( &mKnots[3*i], (double*) positions[i], sizeof(double) * 3 );
+
 	mTree.BuildKDTree( (int) positions.size(), positions[0] );
 }
 
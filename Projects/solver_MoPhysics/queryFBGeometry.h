@@ -18,6 +18,7 @@
 //--- SDK include
 #include <fbsdk/fbsdk.h>
 #include "algorithm\kdtree_common.h"
+#include "moPhysics_collisionCook.h"
 
 #include <vector>
 
@@ -81,9 +82,14 @@ public:
 
 	void	DrawDebug() const;
 
+	// knots of the closest knot search, xyz
+	const std::vector<double> &GetKnots() const { return mKnots; }
+	double	GetKnotStep() const { return mStep; }
+
 private:
 	double									mGlobalScaling;
 	double									mStep;
+	std::vector<double>						mKnots;
 
 	FBVector3d								mLastSearchPoint;
 	FBVector3d								mLastNearestPoint;
@@ -221,13 +227,13 @@ public:
 
 	//! a constructor
 	LevelGeometry();
-	LevelGeometry( FBComponentList &list );
+	LevelGeometry( FBComponentList &list, const char *cacheFolder=nullptr );
 
 	//! a destructor
 	virtual ~LevelGeometry();
 
-	//
-	void	Prep( FBComponentList &list );
+	//! cooked triangles of the models, unchanged models are loaded from the cache folder
+	void	Prep( FBComponentList &list, const char *cacheFolder=nullptr );
 
 	//
 
@@ -22,6 +22,8 @@
 #include "algorithm\math3d_mobu.h"
 #include "ClusterAdvance.h"
 #include "GeometryUtils.h"
+#include "IO\CmdFBX.h"
+#include "algorithm\TextureAtlas.h"
 
 #include "IO\tinyxml.h"
 
@@ -240,7 +242,7 @@ void ORTool_BlendShape::UICreatePanel()
 	FBLayout *arrowContent[4] = { &mLayoutBlendShapes, &mLayoutOperations, &mLayoutSculpt, &mLayoutInfo };
 	const char *parentNames[5] = { "", "arrowBlendShapes", "arrowOperations", "arrowSculpt", "arrowInfo" };
 	const char *arrowTitles[4] = { "BlendShapes", "Mesh Operations", "Sculpt Brush", "Info" };
-	const int arrowHeights[4] = { 270, 290, 50, 50 };
+	const int arrowHeights[4] = { 270, 325, 50, 50 };
 
 	for (int i=0; i<4; ++i)
 	{
@@ -332,18 +334,30 @@ void ORTool_BlendShape::UICreatePanel()
 										lW,	kFBAttachNone,	"",	1.0,
 										lH,	kFBAttachNone,	"",	1.0 );
 
-	mLayoutOperations.AddRegion( "ButtonCombine", "ButtonCombine",
+	mLayoutOperations.AddRegion( "ButtonCombineAtlas", "ButtonCombineAtlas",
 										0,	kFBAttachLeft,	"ButtonSnapshot",	1.0	,
 										lB,	kFBAttachBottom,"ButtonCombineDeleteSource",	1.0,
 										lW,	kFBAttachNone,	"",	1.0,
 										lH,	kFBAttachNone,	"",	1.0 );
 
-	mLayoutOperations.AddRegion( "ButtonCenterPivot", "ButtonCenterPivot",
+	mLayoutOperations.AddRegion( "ButtonCombine", "ButtonCombine",
+										0,	kFBAttachLeft,	"ButtonSnapshot",	1.0	,
+										lB,	kFBAttachBottom,"ButtonCombineAtlas",	1.0,
+										lW,	kFBAttachNone,	"",	1.0,
+										lH,	kFBAttachNone,	"",	1.0 );
+
+	mLayoutOperations.AddRegion( "ButtonAtlasSelfTest", "ButtonAtlasSelfTest",
 										0,	kFBAttachLeft,	"ButtonSnapshot",	1.0	,
 										lB,	kFBAttachBottom,"ButtonCombine",	1.0,
 										lW,	kFBAttachNone,	"",	1.0,
 										lH,	kFBAttachNone,	"",	1.0 );
 
+	mLayoutOperations.AddRegion( "ButtonCenterPivot", "ButtonCenterPivot",
+										0,	kFBAttachLeft,	"ButtonSnapshot",	1.0	,
+										lB,	kFBAttachBottom,"ButtonAtlasSelfTest",	1.0,
+										lW,	kFBAttachNone,	"",	1.0,
+										lH,	kFBAttachNone,	"",	1.0 );
+
 	mLayoutOperations.AddRegion( "ButtonOptimizeSkin", "ButtonOptimizeSkin",
 										0,	kFBAttachLeft,	"ButtonSnapshot",	1.0	,
 										lB,	kFBAttachBottom,"ButtonCenterPivot",	1.0,
@@ -410,7 +424,9 @@ void ORTool_BlendShape::UICreatePanel()
 	mLayoutOperations.SetControl( "ListDelta", mListCalcDeltaMode );
 	mLayoutOperations.SetControl( "ButtonDelta", mButtonCalcDelta );
 	mLayoutOperations.SetControl( "ButtonCombineDeleteSource", mButtonCombineDeleteSource );
+	mLayoutOperations.SetControl( "ButtonCombineAtlas", mButtonCombineAtlas );
 	mLayoutOperations.SetControl( "ButtonCombine", mButtonCombine );
+	mLayoutOperations.SetControl( "ButtonAtlasSelfTest", mButtonAtlasSelfTest );
 	mLayoutOperations.SetControl( "ButtonCenterPivot", mButtonCenterPivot );
 	mLayoutOperations.SetControl( "ButtonOptimizeSkin", mButtonOptimizeSkin );
 	mLayoutOperations.SetControl( "ButtonReComputeNormals", mButtonReComputeNormals );
@@ -512,10 +528,17 @@ void ORTool_BlendShape::UIConfigPanel()
 	mButtonCombineDeleteSource.Caption = "Delete source models";
 	mButtonCombineDeleteSource.Style = kFBCheckbox;
 	mButtonCombineDeleteSource.State = 1;
+
+	mButtonCombineAtlas.Caption = "Texture atlas";
+	mButtonCombineAtlas.Style = kFBCheckbox;
+	mButtonCombineAtlas.State = 0;
 	
 	mButtonCombine.Caption = "Combine models";
 	mButtonCombine.OnClick.Add( this, (FBCallback) &ORTool_BlendShape::EventButtonCombineClick );
 
+	mButtonAtlasSelfTest.Caption = "Atlas self test";
+	mButtonAtlasSelfTest.OnClick.Add( this, (FBCallback) &ORTool_BlendShape::EventButtonAtlasSelfTestClick );
+
 	mButtonCenterPivot.Caption = "Center Pivot";
 	mButtonCenterPivot.OnClick.Add( this, (FBCallback) &ORTool_BlendShape::EventButtonCenterPivotClick );
 
@@ -594,6 +617,9 @@ void ORTool_BlendShape::FBDestroy()
 
 	// Free user allocated memory
 	FBSystem::TheOne().Scene->OnChange.Remove( this, (FBCallback) &ORTool_BlendShape::EventConnectionStateNotify );
+
+	// snapshot worker process is not needed without the tool
+	CmdFBXWorker_Stop();
 }
 
 
@@ -1128,17 +1154,8 @@ void ORTool_BlendShape::EventButtonSnapshotClick( HISender pSender, HKEvent pEve
 			pScene->Components[i]->Selected = false;
 		}
 
-		// snapshots
-		for (int i=0; i<llist.GetCount(); ++i)
-		{
-			FBModel *pModel = llist[i];
-
-			for (int j=0; j<numberOfCopies; ++j)
-			{
-				FBModel *pNewModel = MakeSnapshot2( pModel, DoResetXForm, DoCopyShaders );
-				if (pNewModel) newList.Add(pNewModel->LongName);
-			}
-		}
+		// snapshots, all of them go to the cmdFBX worker as one batch
+		MakeSnapshots2( llist, numberOfCopies, DoResetXForm, DoCopyShaders, &newList );
 
 		// select result meshes
 
@@ -1645,7 +1662,7 @@ void ORTool_BlendShape::EventButtonCombineClick( HISender pSender, HKEvent pEven
 		pScene->Components[i]->Selected = false;
 	}
 
-	FBModel *pNewModel = CombineModels( llist );
+	FBModel *pNewModel = CombineModels( llist, mButtonCombineAtlas.State == 1 );
 
 	//
 	if ( mButtonCombineDeleteSource.State == 1 )
@@ -1660,6 +1677,13 @@ void ORTool_BlendShape::EventButtonCombineClick( HISender pSender, HKEvent pEven
 	FBMessageBox( szTitle, szMsg, "Ok" );
 }
 
+void ORTool_BlendShape::EventButtonAtlasSelfTestClick( HISender pSender, HKEvent pEvent )
+{
+	// synthetic images and a mesh, no scene data is touched, result goes into the log
+	const bool passed = TextureAtlasSelfTest();
+	FBMessageBox( "Texture Atlas", (passed) ? "Self test passed" : "Self test failed, see the log", "Ok" );
+}
+
 void ORTool_BlendShape::EventButtonOptimizeSkinClick( HISender pSender, HKEvent pEvent )
 {
 	FBModelList		llist;
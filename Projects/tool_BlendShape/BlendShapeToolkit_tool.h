@@ -53,6 +53,7 @@ private:
 	void		EventButtonSnapshotClick( HISender pSender, HKEvent pEvent );
 	void		EventButtonCalcDeltaClick( HISender pSender, HKEvent pEvent );
 	void		EventButtonCombineClick( HISender pSender, HKEvent pEvent );
+	void		EventButtonAtlasSelfTestClick( HISender pSender, HKEvent pEvent );
 	void		EventButtonCenterPivotClick( HISender pSender, HKEvent pEvent );
 	void		EventButtonOptimizeSkinClick( HISender pSender, HKEvent pEvent );
 	void		EventButtonReComputeNormalsClick( HISender pSender, HKEvent pEvent );
@@ -131,6 +132,8 @@ private:
 	FBButton			mButtonCalcDelta;	// calculate base mesh with only point difference
 	FBButton			mButtonCombine;		// combine meshes together including textures, materials and ! clusters
 	FBButton			mButtonCombineDeleteSource; // delete all source models
+	FBButton			mButtonCombineAtlas;	// pack textures into one atlas material
+	FBButton			mButtonAtlasSelfTest;	// atlas packing and uv remap on synthetic data
 	FBButton			mButtonCenterPivot;	// explore model into separete models (1 model per material)
 	FBButton			mButtonOptimizeSkin;	// remove small or empty influences
 	FBButton			mButtonReComputeNormals;	// compute smooth normals for a selected meshes
@@ -34,12 +34,12 @@
 #include "TextUtils.h"
 #include "StringUtils.h"
 
-//-- xml
-#include "IO\tinyxml.h"
+#include "IO\FaceTrackingReader.h"
 
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <chrono>
 
 //--- Registration defines
 #define	ORTOOLSAMPLE__CLASS		ORTOOLSAMPLE__CLASSNAME
@@ -310,6 +310,12 @@ void ORToolSample::UICreate()
 									0.5*lW,		kFBAttachNone,		"",						1.0,
 									lH,		kFBAttachNone,		"",						1.0 );
 
+	AddRegion ("ButtonBenchmark",		"ButtonBenchmark",
+									lS,		kFBAttachRight,		"ButtonImportOpenFace",	1.0,
+									4*lS,	kFBAttachBottom,	"ButtonImport",	1.0,
+									-lS,	kFBAttachLeft,		"ButtonPostFiltering",			1.0,
+									lH,		kFBAttachNone,		"",						1.0 );
+
 	// Assign regions
 	SetControl( "LabelCommon", mLabelCommon );
 	SetControl( "LabelNumberPoints",mLabelNumberPoints	);
@@ -354,6 +360,7 @@ void ORToolSample::UICreate()
 	SetControl( "ButtonBatchImport",	mButtonBatchImport	);
 
 	SetControl( "ButtonImportOpenFace",	mButtonImportOpenFace2d	);
+	SetControl( "ButtonBenchmark",	mButtonBenchmark	);
 }
 
 
@@ -468,6 +475,7 @@ void ORToolSample::UIConfigure()
 
 	mButtonImport.Caption	= "Import";
 	mButtonImportOpenFace2d.Caption = "Import OpenFace 2D";
+	mButtonBenchmark.Caption = "Benchmark";
 	mButtonBatchImport.Caption = "Batch Import...";
 	mButtonAbout.Caption	= "About";
 	mButtonPostFiltering.Caption = "PostFilter...";
@@ -485,6 +493,7 @@ void ORToolSample::UIConfigure()
 	mButtonPostFiltering.OnClick.Add	( this,(FBCallback)&ORToolSample::EventButtonPostFilteringClick );
 
 	mButtonImportOpenFace2d.OnClick.Add	( this,(FBCallback)&ORToolSample::EventButtonImportOpenFace2DClick );
+	mButtonBenchmark.OnClick.Add	( this,(FBCallback)&ORToolSample::EventButtonBenchmarkClick );
 }
 
 
@@ -664,31 +673,12 @@ void ORToolSample::EventButtonImportClick(HIRegister pSender, HKEvent pEvent)
 	}
 	else
 	{
-		if (mButtonImportAsOptical.State > 0)
-		{
-			pRoot = new FBModelOptical( "FaceFeaturesOptical" );
-			pRoot->Show = true;
-		}
-		else
-		{
-			pRoot = new FBModelNull( "FaceFeaturesRoot" );
-			pRoot->Show = true;
-			pRoot->Visibility = true;
-		}
+		pRoot = CreateImportRoot(mButtonImportAsOptical.State > 0);
 	}
 
 	bool asOptical = mButtonImportAsOptical.State > 0;
 
-	if (mButtonLandmarks.State > 0 && mEditLandmarksPath.Text != "")
-		ImportLandmarks(pRoot, asOptical, mEditLandmarksPath.Text);
-
-	if (mButtonPointsEmptyJaw.State > 0)
-	{
-		ImportEmptyJawPoints(pRoot, asOptical);
-	}
-	else
-	if (mButtonPointsEnable.State > 0 && mEditPointsFile.Text != "")
-		ImportPoints(pRoot, asOptical, mEditPointsFile.Text);
+	ImportByOptions(pRoot, asOptical);
 
 	/*
 
@@ -705,6 +695,29 @@ void ORToolSample::EventButtonImportClick(HIRegister pSender, HKEvent pEvent)
 		*/
 }
 
+bool ORToolSample::ImportByOptions(FBModel *pRoot, const bool asOptical, const FaceTrackingData *pLandmarks)
+{
+	bool imported = false;
+
+	if (mButtonLandmarks.State > 0)
+	{
+		if (nullptr != pLandmarks)
+			imported = ImportLandmarks(pRoot, asOptical, *pLandmarks);
+		else if (mEditLandmarksPath.Text != "")
+			imported = ImportLandmarks(pRoot, asOptical, mEditLandmarksPath.Text);
+	}
+
+	if (mButtonPointsEmptyJaw.State > 0)
+	{
+		imported = ImportEmptyJawPoints(pRoot, asOptical) || imported;
+	}
+	else
+	if (mButtonPointsEnable.State > 0 && mEditPointsFile.Text != "")
+		imported = ImportPoints(pRoot, asOptical, mEditPointsFile.Text) || imported;
+
+	return imported;
+}
+
 void ORToolSample::EventButtonImportOpenFace2DClick	( HISender pSender, HKEvent pEvent )
 {
 
@@ -744,6 +757,16 @@ void ORToolSample::EventButtonImportOpenFace2DClick	( HISender pSender, HKEvent
 
 }
 
+void ORToolSample::EventButtonBenchmarkClick	( HISender pSender, HKEvent pEvent )
+{
+	if (1 == FBMessageBox( "Import Face Features Tool", "Parse synthetic 3 hours exports in every format?\n"
+		"It takes some time, results are printed into the output window", "Ok", "Cancel" ) )
+	{
+		// 68 points convention at 30 fps
+		FaceTrackingBenchmark( 3.0, 30.0, 68 );
+	}
+}
+
 void ORToolSample::EventButtonBatchImportClick(HIRegister pSender, HKEvent pEvent)
 {
 	// TODO: !!!
@@ -929,101 +952,25 @@ bool ORToolSample::ImportEmptyJawPoints(FBModel *pRoot, const bool asOptical)
 
 bool ORToolSample::ImportPoints(FBModel *pRoot, const bool asOptical, const char *filename)
 {
-	FILE *fp = fopen( filename, "r" );
-
-	if (fp == nullptr)
+	// All of the models (except CLM-Z) use a 68 point convention for tracking
+	const int numberOfPoints = (int) (double) mEditNumberPoints.Value;
+	if (numberOfPoints <= 0)
 		return false;
 
-	fseek(fp, 0, SEEK_END);
-	long len = ftell(fp);
+	FaceTrackingData	data;
 
-	if (len == 0)
+	if (false == data.Read(filename, eFaceTrackingPoints, numberOfPoints) )
 	{
-		fclose(fp);
+		printf( "[ImportPoints] %s - %s\n", filename, data.GetLastError() );
 		return false;
 	}
 
-	fseek(fp, 0, SEEK_SET);
-
-	char *data = new char[len+1];
-	memset(data, 0, sizeof(char)*(len+1));
-	size_t bytesRead = fread_s(data, sizeof(char)*len, sizeof(unsigned char), len, fp);
-	
-	fclose(fp);
-
-	FBStringList	strings;
-	strings.SetString( data, '\n' );
-
-	int count = strings.GetCount();
-
-	//
-	if (data)
-	{
-		delete [] data;
-		data = nullptr;
-	}
-	
-	// All of the models (except CLM-Z) use a 68 point convention for tracking
-	const int numberOfPoints = (int) (double) mEditNumberPoints.Value;
-	const int numberOfFrames = strings.GetCount();
-	if (numberOfPoints <= 0 || numberOfFrames <= 0)
-		return false;
-
-	double *values = new double[numberOfFrames * numberOfPoints * 3];
-
-	if (values == nullptr)
-		return false;
+	const int numberOfFrames = data.GetNumberOfRows();
 
 	const double width = (mEditWidth.Value > 1.0) ? 100.0 / mEditWidth.Value : 1.0;
 	const double height = (mEditHeight.Value > 1.0) ? 100.0 / mEditHeight.Value : 1.0;
 	const bool invertedHeight = (mButtonInvHeight.State == 1);
 
-
-	for (int i=0; i<numberOfFrames; ++i)
-	{
-		double *localValues = &values[i * numberOfPoints * 3];
-
-		const char *line = strings.GetAt(i);
-
-		// read values
-
-		int pos = 0;
-		int len = strlen(line);
-		double val = 0.0;
-
-		// skip frame index and one more value
-		GetNextValue(line, len, ' ', pos, val);
-		GetNextValue(line, len, ' ', pos, val);
-
-		// read all x values
-		for (int j=0; j<numberOfPoints; ++j)
-		{
-			val = 0.0;
-			GetNextValue(line, len, ' ', pos, val);
-			//GetNextValue(strLine, sz, val);
-
-			val = val * width;
-
-			localValues[j*3] = val;
-		}
-
-		// read all y values and set z to zero
-		for (int j=0; j<numberOfPoints; ++j)
-		{
-			val = 0.0;
-			GetNextValue(line, len, ' ', pos, val );
-			//GetNextValue(strLine, sz, val);
-
-			val = val * height;
-			
-			if (invertedHeight)
-				val = 100.0 - val;
-
-			localValues[j*3+1] = val;
-			localValues[j*3+2] = 0.0;
-		}
-	}
-
 	//
 	// write values to elements
 
@@ -1069,17 +1016,7 @@ bool ORToolSample::ImportPoints(FBModel *pRoot, const bool asOptical, const char
 			FBModelMarkerOptical *pMarker = new FBModelMarkerOptical( fn_getname(i), pOptical );
 			pMarker->Show = true;
 
-			int samples = pMarker->ImportBegin();
-			if (samples > numberOfFrames ) 
-				samples = numberOfFrames;
-
-			for (int j=0; j<samples; ++j)
-			{
-				double *localValues = &values[j * numberOfPoints * 3 + i*3];
-				pMarker->ImportKey( localValues[0], localValues[1] );
-			}
-
-			pMarker->ImportEnd();
+			ImportOpticalMarker( pMarker, data, i, width, height, invertedHeight );
 		}
 	}
 	else
@@ -1092,43 +1029,11 @@ bool ORToolSample::ImportPoints(FBModel *pRoot, const bool asOptical, const char
 				continue;
 			}
 
-			FBModelNull *pPoint = new FBModelNull( fn_getname(i) );
-			pPoint->Show = true;
-			pPoint->Visibility = true;
-			pPoint->Parent = pRoot;
-
-			FBAnimationNode *pNode = pPoint->Translation.GetAnimationNode();
-
-			if (pNode == nullptr)
-			{
-				pPoint->Translation.SetAnimated(true);
-				pNode = pPoint->Translation.GetAnimationNode();
-			}
-
-			if (pNode == nullptr)
-				continue;
-
-			
-			for (int j=0; j<numberOfFrames; ++j)
-			{
-				FBTime currTime(0,0,0, j);	
-
-				// write values
-
-				double *localValues = &values[j * numberOfPoints * 3 + i*3];
-				pNode->KeyAdd( currTime, localValues );
-			}
+			// keys go to the line index like before, CLM frame numbers start from 1
+			ImportNullPoint( fn_getname(i), pRoot, data, i, width, height, invertedHeight, false );
 		}
 	}
 
-	//
-
-	if (values)
-	{
-		delete [] values;
-		values = nullptr;
-	}
-
 	return true;
 }
 
@@ -1267,679 +1172,232 @@ bool ORToolSample::ImportPoints3d(const char *filename)
 
 bool ORToolSample::ImportShapeData(const char *filename)
 {
+	FaceTrackingData	data;
 
-	std::ifstream input(filename);
-	std::string line;
-
-	char szBuffer[128];
+	if (false == data.Read(filename, eFaceTrackingMochaShape) )
+	{
+		printf( "[ImportShapeData] %s - %s\n", filename, data.GetLastError() );
+		return false;
+	}
 
-	FBModelOptical *pOptical = nullptr;
+	// 3 landmarks per vertex - point and 2 tangents, one optical model per shape
 
-	int markersCount = 0;
-	int framesCount = 0;
-	float	*data = nullptr;
+	const int numberOfFrames = data.GetNumberOfRows();
+	const int firstFrame = data.GetFirstFrame();
 
-	bool firstTime = true;
+	FBTime	start( 0,0,0, firstFrame ); // FBPlayerControl().ZoomWindowStart 
+	FBTime	stop( 0,0,0, firstFrame+numberOfFrames );
+	FBTime	oneFrame( 0,0,0,1 ); //, 0, FBPlayerControl().GetTransportFps(), FBPlayerControl().GetTransportFpsValue() );
 
-	int firstFrame = 0;
-	int frameIndex = 0;
+	FBModelOptical *pOptical = nullptr;
 
-	try
+	for (int i=0; i<data.GetNumberOfLandmarks(); i+=3)
 	{
-		while( std::getline(input, line, '\n'))
+		if (nullptr == pOptical || i == 0 || strcmp(data.GetLandmarkGroup(i), data.GetLandmarkGroup(i-1)) != 0)
 		{
-			CEUtils::StringTokens	tokens(line.c_str());
-
-			if (tokens.GetCount() > 0)
-			{
-				tokens.GetToken(0, szBuffer, 128);
+			// start new optical model
+			pOptical = new FBModelOptical( data.GetLandmarkGroup(i) );
+			pOptical->Show = true;
 
-				if (strstr(szBuffer, "shape_name") != nullptr)
-				{
-					// start new optical model
-					tokens.GetToken(1, szBuffer, 128);
-
-					pOptical = new FBModelOptical(szBuffer);
-					pOptical->Show = true;
-
-					/*
-					FBTime	start( 0 ); // FBPlayerControl().ZoomWindowStart 
-					FBTime	stop( FBPlayerControl().ZoomWindowStop );
-					FBTime	oneFrame( 0,0,0,1 ); //, 0, FBPlayerControl().GetTransportFps(), FBPlayerControl().GetTransportFpsValue() );
-
-					// set sampling characteristics
-					pOptical->SamplingStart = start;
-					pOptical->SamplingStop = stop;
-					pOptical->SamplingPeriod = oneFrame;
-					*/
-
-					firstTime = true;
-				}
-				else if (strstr(szBuffer, "num_vertices") != nullptr)
-				{
-					// number of markers
-					tokens.GetToken(1, szBuffer, 128);
-
-					markersCount = atoi(szBuffer);
-
-					// NOTE! 3 points per marker (2 tangents and a point)
-					
-					for (int i=0; i<markersCount*3; ++i)
-					{
-						FBModelMarkerOptical *pMarker = new FBModelMarkerOptical( "marker1", pOptical );
-						pMarker->Show = true;
-					}
-
-				}
-				else if (strstr(szBuffer, "num_key_times") != nullptr)
-				{
-					// allocate arrays for holding all frames data
+			// set sampling characteristics
+			pOptical->SamplingStart = start;
+			pOptical->SamplingStop = stop;
+			pOptical->SamplingPeriod = oneFrame;
+		}
 
-					tokens.GetToken(1, szBuffer, 128);
+		// left tangent goes first, then the point and the right tangent
+		const int order[3] = { i+1, i, i+2 };
 
-					framesCount = atoi(szBuffer);
+		for (int k=0; k<3; ++k)
+		{
+			FBModelMarkerOptical *pMarker = new FBModelMarkerOptical( data.GetLandmarkName(order[k]), pOptical );
+			pMarker->Show = true;
 
-					// 3 points per marker (2 tangents and 1 center)
-					// 2 values per point (x, y)
+			ImportOpticalMarker( pMarker, data, order[k], 1.0, 1.0, false );
+		}
+	}
 
-					data = new float[framesCount * markersCount * 3 * 2];
+	return true;
+}
 
-				}
-				else if (strstr(szBuffer, "key_time") != nullptr)
-				{
-					// enter reading frame value
-					tokens.GetToken(1, szBuffer, 128);
-
-					if (firstTime)
-					{
-				 		firstFrame = atoi(szBuffer);
-						frameIndex = 0;
-						firstTime = false;
-					}
-					else
-					{
-						frameIndex++;
-					}
-				}
-				else if (strstr(szBuffer, "vertex_data") != nullptr)
-				{
-					// process vertex data
-					int count = markersCount * 3;
-					
-					float *pvalue = &data[frameIndex * markersCount * 3 * 2];
-
-					// NOTE! skip borders
-					int indexOffset = 1;
-
-					for (int i=0; i<count; ++i)
-					{
-						int div = i % 3;
-						if ( (i > 0) && (div == 0) )
-						{
-							indexOffset += 6;
-						}
-
-						int index = i*2 + indexOffset;
-
-						// read x
-						tokens.GetToken(index, szBuffer, 128);
-						*pvalue = (float) atof(szBuffer);
-						pvalue++;
-
-						// read y
-						tokens.GetToken(index+1, szBuffer, 128);
-						*pvalue = (float) atof(szBuffer);
-						pvalue++;
-					}
+bool ORToolSample::ImportLandmarks(FBModel *pRoot, const bool asOptical, const char *filename)
+{
+	FaceTrackingData	data;
 
-				}
-			}
-		}
+	if (false == data.Read(filename, eFaceTrackingFaceware) )
+	{
+		printf( "[ImportLandmarks] %s - %s\n", filename, data.GetLastError() );
+		return false;
+	}
 
+	return ImportLandmarks(pRoot, asOptical, data);
+}
 
-		// import markers data
-		if (pOptical)
-		{
-			FBTime	start( 0,0,0, firstFrame ); // FBPlayerControl().ZoomWindowStart 
-			FBTime	stop( 0,0,0, firstFrame+framesCount );
-			FBTime	oneFrame( 0,0,0,1 ); //, 0, FBPlayerControl().GetTransportFps(), FBPlayerControl().GetTransportFpsValue() );
+bool ORToolSample::ImportLandmarks(FBModel *pRoot, const bool asOptical, const FaceTrackingData &data)
+{
+	const int numberOfFrames = data.GetNumberOfRows();
 
-			// set sampling characteristics
-			pOptical->SamplingStart = start;
-			pOptical->SamplingStop = stop;
-			pOptical->SamplingPeriod = oneFrame;
+	// UPDATE UI WIDTH and Height params
 
-			for (int i=0; i<markersCount; ++i)
-			{
-				// left tangent goes first
-				int pointIndex = i*3+1;
-				FBModelMarkerOptical *pMarker = (FBModelMarkerOptical*) pOptical->Markers[i*3];
-
-				int samples = pMarker->ImportBegin();
-				if (samples > framesCount) samples = framesCount;
-				
-				for (int j=0; j<samples; ++j)
-				{
-					float *pValue = &data[j * markersCount * 3 * 2];
+	int realWidth = (mButtonSwapSize.State > 0) ? data.GetSourceHeight() : data.GetSourceWidth();
+	int realHeight = (mButtonSwapSize.State > 0) ? data.GetSourceWidth() : data.GetSourceHeight();
 
-					pMarker->ImportKey( pValue[pointIndex*2], pValue[pointIndex*2+1] );
-				}
+	if (data.GetSourceWidth() > 1)
+		mEditWidth.Value = (double) realWidth;
+	if (data.GetSourceHeight() > 1)
+		mEditHeight.Value = (double) realHeight;
+	if (data.GetFrameRate() > 0.0)
+		FBPlayerControl::TheOne().SetTransportFps(kFBTimeModeCustom, data.GetFrameRate() );
+	FBPlayerControl::TheOne().LoopStop = FBTime(0,0,0, numberOfFrames);
+	//FBPlayerControl::TheOne().ZoomWindowStop = FBTime(0,0,0, numberOfFrames);
 
-				pMarker->ImportEnd();
+	// write data to root element
 
-				// point
-				pointIndex = i*3;
-				pMarker = (FBModelMarkerOptical*) pOptical->Markers[i*3+1];
+	FBProperty *prop;
+	
+	prop = pRoot->PropertyList.Find("SourceWidth"); 
+	if (nullptr == prop) 
+		prop = pRoot->PropertyCreate( "SourceWidth", kFBPT_int, "int", false, true );
+	if (prop) prop->SetInt( realWidth  );
 
-				samples = pMarker->ImportBegin();
-				if (samples > framesCount) samples = framesCount;
-				
-				for (int j=0; j<samples; ++j)
-				{
-					float *pValue = &data[j * markersCount * 3 * 2];
+	prop = pRoot->PropertyList.Find("SourceHeight");
+	if (nullptr == prop) 
+		prop = pRoot->PropertyCreate( "SourceHeight", kFBPT_int, "int", false, true );
+	if (prop) prop->SetInt( realHeight );
 
-					pMarker->ImportKey( pValue[pointIndex*2], pValue[pointIndex*2+1] );
-				}
 
-				pMarker->ImportEnd();
+	//
+	// markers
 
-				//
-				// right tangent goes last
-				pointIndex = i*3+2;
-				pMarker = (FBModelMarkerOptical*) pOptical->Markers[i*3+2];
+	if (numberOfFrames == 0 || data.GetNumberOfLandmarks() == 0)
+		return false;
 
-				samples = pMarker->ImportBegin();
-				if (samples > framesCount) samples = framesCount;
-				
-				for (int j=0; j<samples; ++j)
-				{
-					float *pValue = &data[j * markersCount * 3 * 2];
+	const bool invertedHeight = (mButtonInvHeight.State == 1);
 
-					pMarker->ImportKey( pValue[pointIndex*2], pValue[pointIndex*2+1] );
-				}
+	if (asOptical)
+	{
 
-				pMarker->ImportEnd();
-			}
-		}
+		FBModelOptical *pOptical = (FBModelOptical*) pRoot;
+	
+		FBTime	start( 0,0,0, 0 ); // FBPlayerControl().ZoomWindowStart 
+		FBTime	stop( 0,0,0, numberOfFrames );
+		FBTime	oneFrame( 0,0,0, 1 ); //, 0, FBPlayerControl().GetTransportFps(), FBPlayerControl().GetTransportFpsValue() );
 
-		
+		// set sampling characteristics
+		pOptical->SamplingStart = start;
+		pOptical->SamplingStop = stop;
+		pOptical->SamplingPeriod = oneFrame;
 
-		if (data)
+		//
+		for (int i = 0; i<data.GetNumberOfLandmarks(); ++i)
 		{
-			delete [] data;
-			data = nullptr;
-		}
+			FBModelMarkerOptical *pMarker = new FBModelMarkerOptical( data.GetLandmarkName(i), pOptical );
+			pMarker->Show = true;
 
+			ImportOpticalMarker( pMarker, data, i, 100.0, 100.0, invertedHeight );
+		}
 	}
-	catch(const std::exception &e)
+	else
 	{
-		printf ("error while reading file - %s\n", e.what() );
+		for (int i = 0; i<data.GetNumberOfLandmarks(); ++i)
+		{
+			ImportNullPoint( data.GetLandmarkName(i), pRoot, data, i, 100.0, 100.0, invertedHeight, true );
+		}
 	}
 
 	return true;
 }
 
-struct MetaData
+FBModel *ORToolSample::CreateImportRoot(const bool asOptical)
 {
-	FBString	filePath;
-	int			width;
-	int			height;
-	double		frameRate;
-
-};
-
-// struct for data in global landmarks list
-struct LandmarkData
-{
-	char	name[128];
-	char	label[128];
-	int		active;
+	FBModel *pRoot = nullptr;
 
-	void SetName(const char *_name)
+	if (asOptical)
 	{
-		memset(name, 0, sizeof(char) * 128);
-		strcpy(name, _name);
+		pRoot = new FBModelOptical( "FaceFeaturesOptical" );
+		pRoot->Show = true;
 	}
-
-	void SetLabel(const char *_label)
+	else
 	{
-		memset(label, 0, sizeof(char) * 128);
-		strcpy(label, _label);
+		pRoot = new FBModelNull( "FaceFeaturesRoot" );
+		pRoot->Show = true;
+		pRoot->Visibility = true;
 	}
-};
 
-// struct for data in global markup groups list
-struct MarkupGroup
+	return pRoot;
+}
+
+// pixels or texture coords into the import range, false for a missing sample
+static bool ComputeImportValues(const float u, const float v, const double scaleU, const double scaleV, const bool invertHeight, double *values)
 {
-	char name[128];
+	if (u != u || v != v)
+		return false;
 
-	void SetName(const char *_name)
-	{
-		memset(name, 0, sizeof(char) * 128);
-		strcpy(name, _name);
-	}
-};
+	values[0] = scaleU * (double) u;
+	values[1] = scaleV * (double) v;
+	values[2] = 0.0;
 
-struct FrameLandmark
-{
-	int	landmarkIndex;	// index in global markup list
-	float u;
-	float v;
+	if (invertHeight)
+		values[1] = 100.0 - values[1];
 
-	// a constructor
-	FrameLandmark()
-	{
-		landmarkIndex = -1;
-		u = 0.0f;
-		v = 0.0f;
-	}
-};
+	return true;
+}
 
-struct FrameGroup
+void ORToolSample::ImportOpticalMarker(FBModelMarkerOptical *pMarker, const FaceTrackingData &data, const int landmark,
+	const double scaleU, const double scaleV, const bool invertHeight)
 {
-	int groupIndex;	// index in global markup_groups
-	std::vector<FrameLandmark>	landmarks;
-};
+	const float *u = data.GetColumn(landmark, 0);
+	const float *v = data.GetColumn(landmark, 1);
 
-//
-struct FrameData
-{
-	int		value;
-	int		valid;
-	char	filePath[256];
+	int samples = pMarker->ImportBegin();
+	if (samples > data.GetNumberOfRows() ) 
+		samples = data.GetNumberOfRows();
 
-	std::vector<FrameLandmark>		landmarks;
+	double values[3];
 
-	void SetFilePath(const char *path)
+	for (int j=0; j<samples; ++j)
 	{
-		memset(filePath, 0, sizeof(char) * 256);
-		strcpy(filePath, path);
+		if (ComputeImportValues(u[j], v[j], scaleU, scaleV, invertHeight, values) )
+			pMarker->ImportKey( values[0], values[1] );
+		else
+			pMarker->ImportKey( 0.0, 0.0, 0.0, 1.0 );	// occluded, next samples stay on their frames
 	}
-};
 
-// TODO: read frames
-// 2 - convert frames into optical model markers
+	pMarker->ImportEnd();
+}
 
-bool ReadRootMeta(TiXmlElement *rootElem, MetaData &outData)
+void ORToolSample::ImportNullPoint(const char *name, FBModel *pRoot, const FaceTrackingData &data, const int landmark,
+	const double scaleU, const double scaleV, const bool invertHeight, const bool useFileFrames)
 {
-	TiXmlElement	*metaElem = rootElem->FirstChildElement("meta");
+	FBModelNull *pPoint = new FBModelNull( name );
+	pPoint->Show = true;
+	pPoint->Visibility = true;
+	pPoint->Parent = pRoot;
 
-	if (nullptr == metaElem)
-		return false;
+	FBAnimationNode *pNode = pPoint->Translation.GetAnimationNode();
 
-	TiXmlElement *pVideoElem = metaElem->FirstChildElement("video");
+	if (pNode == nullptr)
+	{
+		pPoint->Translation.SetAnimated(true);
+		pNode = pPoint->Translation.GetAnimationNode();
+	}
 
-	if (nullptr == pVideoElem)
-		return false;
-
-	for (TiXmlAttribute *pAttrib = pVideoElem->FirstAttribute();
-		pAttrib != nullptr;
-		pAttrib = pAttrib->Next() )
-	{
-		if (strcmp(pAttrib->Name(), "filePath") == 0)
-		{
-			outData.filePath = pAttrib->Value();
-		}
-		else if (strcmp(pAttrib->Name(), "width") == 0)
-		{
-			outData.width = pAttrib->IntValue();
-		}
-		else if (strcmp(pAttrib->Name(), "height") == 0)
-		{
-			outData.height = pAttrib->IntValue();
-		}
-		else if (strcmp(pAttrib->Name(), "frameRate") == 0)
-		{
-			outData.frameRate = pAttrib->DoubleValue();
-		}
-	}
-
-	return true;
-}
-
-bool ReadMarkupLandmarks(TiXmlElement *rootElem, std::vector<LandmarkData> &globalLandmarks, FrameData &outData)
-{
-
-	TiXmlElement *theLandmarkElem = rootElem->FirstChildElement("landmark");
-
-	while (theLandmarkElem != nullptr)
-	{
-
-		FrameLandmark	frameLandmark;
-
-		std::string		name("");
-		std::string		label("");
-
-		for (TiXmlAttribute *pAttrib = theLandmarkElem->FirstAttribute();
-			pAttrib != nullptr;
-			pAttrib = pAttrib->Next() )
-		{
-			if (strcmp(pAttrib->Name(), "name") == 0)
-			{
-				name = pAttrib->Value();
-			}
-			else if (strcmp(pAttrib->Name(), "label") == 0)
-			{
-				label = pAttrib->Value();
-			}
-		}
-
-		// read values
-
-		TiXmlElement *texCoordElem = theLandmarkElem->FirstChildElement("texCoord");
-
-		if (texCoordElem)
-		{
-			std::string s;
-
-			for (TiXmlAttribute *pAttrib = texCoordElem->FirstAttribute();
-				pAttrib != nullptr;
-				pAttrib = pAttrib->Next() )
-			{
-				s = pAttrib->Value();
-				std::replace(s.begin(), s.end(), ',', '.');
-
-				if (strcmp(pAttrib->Name(), "u") == 0)
-				{	
-					frameLandmark.u = (float) std::atof(s.c_str() );
-				}
-				else if (strcmp(pAttrib->Name(), "v") == 0)
-				{
-					frameLandmark.v = (float) std::atof(s.c_str() );
-				}
-			}
-		}
-
-		//
-		frameLandmark.landmarkIndex = -1;
-
-		if (name.size() > 0 && label.size() > 0)
-		{
-			for (size_t i=0; i<globalLandmarks.size(); ++i)
-			{
-				if (strcmp(label.c_str(), globalLandmarks[i].name) == 0)
-				{
-					frameLandmark.landmarkIndex = i;
-					break;
-				}
-			}
-
-			if (frameLandmark.landmarkIndex == -1)
-			{
-				LandmarkData	newLandmark;
-				newLandmark.active = 1;
-				newLandmark.SetName( name.c_str() );
-				newLandmark.SetLabel( label.c_str() );
-
-				globalLandmarks.push_back(newLandmark);
-				frameLandmark.landmarkIndex = (int) globalLandmarks.size() - 1;
-			}
-
-			outData.landmarks.push_back(frameLandmark);
-		}
-
-		theLandmarkElem = theLandmarkElem->NextSiblingElement();
-	}
-
-	return true;
-}
-
-bool ReadMarkupGroups(TiXmlElement *rootElem, std::vector<MarkupGroup> &globalGroups, std::vector<LandmarkData> &globalLandmarks, FrameData &outData)
-{
-	TiXmlElement *theGroupElem = rootElem->FirstChildElement("markup_group");
-
-	while(theGroupElem != nullptr)
-	{
-
-		FrameGroup	frameGroup;
-		
-
-		TiXmlAttribute *pAttrib = theGroupElem->FirstAttribute();
-		if ( strcmp(pAttrib->Name(), "name") == 0 )
-		{
-			frameGroup.groupIndex = -1;
-
-			for (size_t i=0; i<globalGroups.size(); ++i)
-				if (strstr(globalGroups[i].name, pAttrib->Name() ) != nullptr)
-				{
-					frameGroup.groupIndex = (int) i;
-					break;
-				}
-
-			if (frameGroup.groupIndex == -1)
-			{
-				MarkupGroup newGroup;
-				newGroup.SetName(pAttrib->Name() );
-				globalGroups.push_back(newGroup);
-
-				frameGroup.groupIndex = (int) globalGroups.size() - 1;
-			}
-
-			TiXmlElement *landmarksElem = theGroupElem->FirstChildElement("landmarks");
-
-			if (landmarksElem != nullptr)
-				ReadMarkupLandmarks(landmarksElem, globalLandmarks, outData);
-
-			//outData.groups.push_back(pFrameGroup);
-		}
-		
-
-		theGroupElem = theGroupElem->NextSiblingElement();
-	}
-
-	return true;
-}
-
-bool ReadFrames(TiXmlElement *rootElem, std::vector<MarkupGroup> &globalGroups, std::vector<LandmarkData> &globalLandmarks, std::vector<FrameData> &frames)
-{
-	TiXmlElement	*framesElem = rootElem->FirstChildElement("frames");
-
-	if (nullptr == framesElem)
-		return false;
-
-	TiXmlElement *theFrameElem = framesElem->FirstChildElement("frame");
-
-	while(theFrameElem != nullptr)
-	{
-		FrameData		frameData;
-
-		for (TiXmlAttribute *pAttrib = theFrameElem->FirstAttribute();
-			pAttrib != nullptr;
-			pAttrib = pAttrib->Next() )
-		{
-			if (strcmp(pAttrib->Name(), "filePath") == 0)
-			{
-				frameData.SetFilePath( pAttrib->Value() );
-			}
-			else if (strcmp(pAttrib->Name(), "value") == 0)
-			{
-				frameData.value = pAttrib->IntValue();
-			}
-			else if (strcmp(pAttrib->Name(), "valid") == 0)
-			{
-				frameData.valid = (strcmp(pAttrib->Value(), "true") == 0);
-			}
-		}
-
-		TiXmlElement *markupGroupsElem = theFrameElem->FirstChildElement("markup_groups");
-
-		if (markupGroupsElem != nullptr)
-			ReadMarkupGroups(markupGroupsElem, globalGroups, globalLandmarks, frameData);
-
-		frames.push_back(frameData);
-
-		theFrameElem = theFrameElem->NextSiblingElement();
-	}
-
-	return true;
-}
-
-bool ORToolSample::ImportLandmarks(FBModel *pRoot, const bool asOptical, const char *filename)
-{
-
-	TiXmlDocument	doc;
-	MetaData		metaData;
-
-	std::vector<MarkupGroup>	groups;
-	std::vector<LandmarkData>	landmarks;
-	std::vector<FrameData>		frames;
-
-	if (false == doc.LoadFile(filename))
-		return false;
-
-	try
-	{
-		TiXmlElement	*rootElem = doc.FirstChildElement("Analyzer_Feature_File");
-
-		if (nullptr == rootElem)
-			return false;
-
-		
-		if (false == ReadRootMeta(rootElem, metaData))
-			return false;
-
-		if (false == ReadFrames(rootElem, groups, landmarks, frames))
-			return false;
-
-	}
-	catch(const std::exception &e)
-	{
-		printf ("error while reading file - %s\n", e.what() );
-	}
-
-	// UPDATE UI WIDTH and Height params
-
-	int realWidth = (mButtonSwapSize.State > 0) ? metaData.height : metaData.width;
-	int realHeight = (mButtonSwapSize.State > 0) ? metaData.width : metaData.height;
-
-	if (metaData.width > 1)
-		mEditWidth.Value = (double) realWidth;
-	if (metaData.height > 1)
-		mEditHeight.Value = (double) realHeight;
-	FBPlayerControl::TheOne().SetTransportFps(kFBTimeModeCustom, metaData.frameRate );
-	FBPlayerControl::TheOne().LoopStop = FBTime(0,0,0, (int) frames.size());
-	//FBPlayerControl::TheOne().ZoomWindowStop = FBTime(0,0,0, (int) frames.size());
-
-	// write data to root element
-
-	FBProperty *prop;
-	
-	prop = pRoot->PropertyList.Find("SourceWidth"); 
-	if (nullptr == prop) 
-		prop = pRoot->PropertyCreate( "SourceWidth", kFBPT_int, "int", false, true );
-	if (prop) prop->SetInt( realWidth  );
-
-	prop = pRoot->PropertyList.Find("SourceHeight");
-	if (nullptr == prop) 
-		prop = pRoot->PropertyCreate( "SourceHeight", kFBPT_int, "int", false, true );
-	if (prop) prop->SetInt( realHeight );
-
-
-	//
-	// markers
-
-	if (frames.size() == 0 || landmarks.size() == 0)
-		return false;
-
-	const bool invertedHeight = (mButtonInvHeight.State == 1);
-
-	if (asOptical)
-	{
-
-		FBModelOptical *pOptical = (FBModelOptical*) pRoot;
-	
-		FBTime	start( 0,0,0, 0 ); // FBPlayerControl().ZoomWindowStart 
-		FBTime	stop( 0,0,0, (int) frames.size() );
-		FBTime	oneFrame( 0,0,0, 1 ); //, 0, FBPlayerControl().GetTransportFps(), FBPlayerControl().GetTransportFpsValue() );
-
-		// set sampling characteristics
-		pOptical->SamplingStart = start;
-		pOptical->SamplingStop = stop;
-		pOptical->SamplingPeriod = oneFrame;
-
-		//
-		for (int i = 0; i< (int)landmarks.size(); ++i)
-		{
-			FBModelMarkerOptical *pMarker = new FBModelMarkerOptical( landmarks[i].name, pOptical );
-			pMarker->Show = true;
-
-
-			int samples = pMarker->ImportBegin();
-			if (samples > (int) frames.size() ) samples = (int)frames.size();
-
-			for (auto iframe=frames.begin(); iframe!=frames.end(); ++iframe)
-			{
-
-				for (auto imark=iframe->landmarks.begin(); imark!=iframe->landmarks.end(); ++imark)
-				{
-
-					if (i == imark->landmarkIndex)
-					{
-						double v = 100.0 * (double) imark->v;
-
-						if (invertedHeight)
-							v = 100.0 - v;
-
-						pMarker->ImportKey( 100.0 * (double) imark->u, v );
-						break;
-					}
-
-				}
+	if (pNode == nullptr)
+		return;
 
-			}
+	const float *u = data.GetColumn(landmark, 0);
+	const float *v = data.GetColumn(landmark, 1);
 
-			pMarker->ImportEnd();
+	double values[3];
 
-		}
-	}
-	else
+	for (int j=0; j<data.GetNumberOfRows(); ++j)
 	{
-		double values[3] = {0.0, 0.0, 0.0};
-
-		for (int i = 0; i< (int)landmarks.size(); ++i)
-		{
-			FBModelNull *pPoint = new FBModelNull( landmarks[i].name );
-			pPoint->Show = true;
-			pPoint->Visibility = true;
-			pPoint->Parent = pRoot;
-
-			FBAnimationNode *pNode = pPoint->Translation.GetAnimationNode();
-
-			if (pNode == nullptr)
-			{
-				pPoint->Translation.SetAnimated(true);
-				pNode = pPoint->Translation.GetAnimationNode();
-			}
-
-			if (pNode == nullptr)
-				continue;
-
-			
-			for (auto iframe=frames.begin(); iframe!=frames.end(); ++iframe)
-			{
-				FBTime frameTime(0, 0, 0, iframe->value);
-				for (auto imark=iframe->landmarks.begin(); imark!=iframe->landmarks.end(); ++imark)
-				{
-
-					if (i == imark->landmarkIndex)
-					{
-						double v = 100.0 * (double) imark->v;
-
-						if (invertedHeight)
-							v = 100.0 - v;
-
-						values[0] = 100.0 * (double) imark->u;
-						values[1] = v;
+		if (false == ComputeImportValues(u[j], v[j], scaleU, scaleV, invertHeight, values) )
+			continue;
 
-						pNode->KeyAdd( frameTime,  &values[0] );
-						break;
-					}
-				}
-			}
-		}
+		FBTime currTime(0,0,0, (useFileFrames) ? data.GetRowFrame(j) : j);
+		pNode->KeyAdd( currTime, values );
 	}
-
-	return true;
 }
 
 void ORToolSample::BatchProcessing(const char *sourceFolder, const char *destinationFolder)
@@ -1955,58 +1413,86 @@ void ORToolSample::BatchProcessing(const char *sourceFolder, const char *destina
 		return;
 
 	// convert each file which is not exist in the destination folder
-	FBStringList &srcList = srcFiles.GetList();
-	FBStringList &dstList = dstFiles.GetList();
 
-	for (int i=0; i<srcList.GetCount(); ++i)
-	{
-		FBString srcPath(srcList.GetAt(i) );
+	auto fn_tovector = [] (FBStringList &list, std::vector<std::string> &files) {
+		for (int i=0; i<list.GetCount(); ++i)
+			files.push_back( list.GetAt(i) );
+	};
 
-		FBString srcName = ExtractFileName(srcPath);
-		ChangeFileExt( srcName, FBString("") );
+	std::vector<std::string>	srcList, dstList;
+	std::vector<std::string>	pending, skipped;
 
-		bool fileExist = false;
+	fn_tovector( srcFiles.GetList(), srcList );
+	fn_tovector( dstFiles.GetList(), dstList );
 
-		for (int j=0; j<dstList.GetCount(); ++j)
-		{
-			FBString dstPath(dstList.GetAt(j));
+	FaceTrackingBatchQueue::CollectPending( srcList, dstList, pending, skipped );
 
-			FBString dstName = ExtractFileName(dstPath);
-			ChangeFileExt( dstName, FBString("") );
+	std::vector<FaceTrackingReportEntry>	report;
 
-			// compare in lower case
-			if ( _stricmp(srcName, dstName) == 0 )
-			{
-				fileExist = true;
-				break;
-			}
+	for (auto iter=begin(skipped); iter!=end(skipped); ++iter)
+	{
+		FaceTrackingReportEntry	entry;
+		entry.srcPath = *iter;
+		entry.status = "skipped";
+		report.push_back(entry);
+	}
 
-		}
+	// xml files are parsed on worker threads, scene import and save stay on the main thread
 
+	typedef std::chrono::steady_clock	batch_clock;
+	const batch_clock::time_point batchStart = batch_clock::now();
 
-		// do import and processing
-		if (false == fileExist)
-		{
-			mApp.FileNew();
+	const bool asOptical = mButtonImportAsOptical.State > 0;
 
-			FBString srcPath(sourceFolder);
-			srcPath = srcPath + "\\" + srcName + ".xml";
+	FaceTrackingBatchQueue	queue;
+	queue.Start( pending, eFaceTrackingFaceware, 0 );
 
-			mEditLandmarksPath.Text = srcPath;
+	while (FaceTrackingBatchQueue::Item *pItem = queue.Next() )
+	{
+		FaceTrackingReportEntry	entry;
+		entry.srcPath = pItem->srcPath;
+		entry.parseMs = pItem->parseMs;
+		entry.numberOfRows = pItem->data.GetNumberOfRows();
+		entry.numberOfLandmarks = pItem->data.GetNumberOfLandmarks();
+
+		FBString dstPath(destinationFolder);
+		dstPath = dstPath + "\\" + FaceTrackingBatchQueue::GetBaseName(pItem->srcPath.c_str()).c_str() + ".fbx";
+		entry.dstPath = dstPath;
 
-			EventButtonImportClick(nullptr, nullptr);
+		if (false == pItem->result)
+		{
+			entry.status = "failed";
+			entry.error = pItem->data.GetLastError();
+			report.push_back(entry);
+			continue;
+		}
 
+		// do import and processing
+		const batch_clock::time_point importStart = batch_clock::now();
 
-			//
+		mApp.FileNew();
 
-			FBString dstPath(destinationFolder);
-			dstPath = dstPath + "\\" + srcName + ".fbx";
+		FBModel *pRoot = CreateImportRoot(asOptical);
+		const bool imported = ImportByOptions( pRoot, asOptical, &pItem->data );
+		const bool saved = imported && mApp.FileSave( dstPath );
 
-			mApp.FileSave( dstPath );
-		}
+		entry.importMs = std::chrono::duration<double, std::milli>(batch_clock::now() - importStart).count();
+		entry.status = (saved) ? "done" : "failed";
+		if (false == imported)
+			entry.error = "nothing to import with the current options";
+		else if (false == saved)
+			entry.error = "failed to save a file";
 
+		report.push_back(entry);
 	}
 
+	const double totalMs = std::chrono::duration<double, std::milli>(batch_clock::now() - batchStart).count();
+
+	FBString reportPath(destinationFolder);
+	reportPath = reportPath + "\\FaceTrackingBatchReport.csv";
+
+	FaceTrackingWriteReport( reportPath, report );
+	FaceTrackingPrintReport( report, totalMs );
 }
 
 
@@ -2123,180 +1609,25 @@ void ORToolSample::EventButtonPostFilteringClick	( HISender pSender, HKEvent pEv
 	}
 }
 
-double SetDoubleFractionPart(int integer, int frac)
-{
-	double frac2 = frac;
-		
-	double log10 = log10l(frac2 + 1.0);
-    double ceil = ceill(log10);
-    double pow = powl(10.0, -ceil);
-
-    double res = abs(integer);
-	res += frac2 * pow;
-
-	if (integer < 0)
-	{
-		res = -res;
-	}
-
-	return res;
-}
-
 bool ORToolSample::ImportOpenFaceLandmarks2d(FBModel *pRoot, const bool asOptical, const char *filename,
 	const double width, const double height, const bool invertHeight, bool applyRenameRule, bool importJawOnly)
 {
 	if (pRoot == nullptr || filename == nullptr)
 		return false;
 
-	FILE *fp = fopen( filename, "r" );
-
-	if (fp == nullptr)
-		return false;
-
-	fseek(fp, 0, SEEK_END);
-	long len = ftell(fp);
-
-	if (len == 0)
-	{
-		fclose(fp);
-		return false;
-	}
-
-	fseek(fp, 0, SEEK_SET);
-
-	char *data = new char[len+1];
-	memset(data, 0, sizeof(char)*(len+1));
-	size_t bytesRead = fread_s(data, sizeof(char)*len, sizeof(unsigned char), len, fp);
-	
-	fclose(fp);
+	// read from the first line - frame,success,confidence,x0,x1,x2,x3,...y0,y1,y2,...
+	//  decimal comma exports are detected by the reader
 
-	FBStringList	strings;
-	strings.SetString( data, '\n' );
+	FaceTrackingData	data;
 
-	//
-	if (data)
+	if (false == data.Read(filename, eFaceTrackingOpenFace2d) )
 	{
-		delete [] data;
-		data = nullptr;
-	}
-
-	const int numberOfLines = strings.GetCount();
-	if (numberOfLines == 0)
+		printf( "[ImportOpenFace] %s - %s\n", filename, data.GetLastError() );
 		return false;
-
-
-	// read from the first line - frame,success,confidence,x0,x1,x2,x3,...y0,y1,y2,...
-	FBStringList names;
-	names.SetString( strings[0], ',' );
-
-	int numberOfPoints = 0;
-
-	// find the latest x or y index
-	int frameNdx = -1;
-	int xNdx = -1;
-	int yNdx = -1;
-	int pos = 1;
-	int val = 0;
-	int val_integer, val_fraction;
-	double dval = 0.0;
-	
-
-	//int strpos = 0;
-	for (int i=0, count=names.GetCount(); i<count; ++i)
-	{
-		const char *str = names.GetAt(i);	
-		int len = (int)strlen(str);
-		
-		if ( strcmp( str, "frame" ) == 0 )
-			frameNdx = i;
-		else if (strstr( str, "x" ) != nullptr )
-		{
-			if (xNdx == -1)
-				xNdx = i;
-			pos = 1;
-			GetNextValue(str, len, ',', pos, val);
-
-			if (val >= numberOfPoints) 
-				numberOfPoints = val + 1;
-		}
-		else if (yNdx == -1 && strstr(str, "y") != nullptr)
-		{
-			yNdx = i;
-		}
-
-		// strpos = strpos + len + 1; // 1 is a separator char ','
 	}
 
-	// we have a wrong file format
-	if (frameNdx < 0 || xNdx < 0 || yNdx < 0 || numberOfPoints <= 0)
-		return false;
-
-	// All of the models (except CLM-Z) use a 68 point convention for tracking
-	
-	const int numberOfFrames = numberOfLines-1; // first line is an annotation
-	if (numberOfFrames <= 0)
-		return false;
-
-	// alloc mem for all values + frame index
-	double *values = new double[numberOfFrames * (numberOfPoints * 3 + 1)];
-
-	if (values == nullptr)
-		return false;
-
-
-	for (int theFrame=0; theFrame<numberOfFrames; ++theFrame)
-	{
-		double *localValues = &values[theFrame * (numberOfPoints * 3 + 1)];
-
-		// NOTE! first line is an annotation, we start from the second one
-		const char *line = strings.GetAt(theFrame + 1);
-
-		// read values
-		int len = (int)strlen(line);
-		
-		// grab the frame index
-		pos = ComputeSubLinePos(line, len, ',', frameNdx);
-		GetNextValue(line, len, ',', pos, localValues[0] );
-
-		// read all x values
-		pos = ComputeSubLinePos(line, len, ',', (xNdx+1) );		// this 1 mean that we need to skip quality fraction part
-		for (int thePoint=0; thePoint<numberOfPoints; ++thePoint)
-		{
-			dval = 0.0;
-			
-			val_integer = 0;
-			val_fraction = 0;
-
-			GetNextValue(line, len, ',', pos, val_integer);
-			GetNextValue(line, len, ',', pos, val_fraction);
-			
-			dval = SetDoubleFractionPart(val_integer, val_fraction);
-			dval = dval * width;
-
-			localValues[thePoint*3+1] = dval;
-		}
-
-		// read all y values and set z to zero
-		//pos = ComputeSubLinePos(line, len, ',', yNdx);
-		for (int thePoint=0; thePoint<numberOfPoints; ++thePoint)
-		{
-			dval = 0.0;
-			val_integer = 0;
-			val_fraction = 0;
-
-			GetNextValue(line, len, ',', pos, val_integer);
-			GetNextValue(line, len, ',', pos, val_fraction);
-
-			dval = SetDoubleFractionPart(val_integer, val_fraction);
-			dval = dval * height;
-			
-			if (invertHeight)
-				dval = 100.0 - dval;
-
-			localValues[thePoint*3+2] = dval;
-			localValues[thePoint*3+3] = 0.0;
-		}
-	}
+	const int numberOfPoints = data.GetNumberOfLandmarks();
+	const int numberOfFrames = data.GetNumberOfRows();
 
 	//
 	// write values to elements
@@ -2324,10 +1655,10 @@ bool ORToolSample::ImportOpenFaceLandmarks2d(FBModel *pRoot, const bool asOptica
 		//
 		FBModelOptical *pOptical = (FBModelOptical*) pRoot;
 	
-		int firstFrameIndex = (int) values[0];
+		int firstFrameIndex = data.GetFirstFrame();
 
 		FBTime	start( 0,0,0, firstFrameIndex ); // FBPlayerControl().ZoomWindowStart 
-		FBTime	stop( 0,0,0, numberOfFrames );
+		FBTime	stop( 0,0,0, firstFrameIndex + numberOfFrames );
 		FBTime	oneFrame( 0,0,0, 1 ); //, 0, FBPlayerControl().GetTransportFps(), FBPlayerControl().GetTransportFpsValue() );
 
 		if (pOptical->Children.GetCount() == 0)
@@ -2348,17 +1679,7 @@ bool ORToolSample::ImportOpenFaceLandmarks2d(FBModel *pRoot, const bool asOptica
 			FBModelMarkerOptical *pMarker = new FBModelMarkerOptical( fn_getname(i, applyRenameRule), pOptical );
 			pMarker->Show = true;
 
-			int samples = pMarker->ImportBegin();
-			if (samples > numberOfFrames ) 
-				samples = numberOfFrames;
-
-			for (int j=0; j<samples; ++j)
-			{
-				double *localValues = &values[j * (numberOfPoints * 3 + 1) + i*3+1];
-				pMarker->ImportKey( localValues[0], localValues[1] );
-			}
-
-			pMarker->ImportEnd();
+			ImportOpticalMarker( pMarker, data, i, width, height, invertHeight );
 		}
 	}
 	else
@@ -2371,43 +1692,10 @@ bool ORToolSample::ImportOpenFaceLandmarks2d(FBModel *pRoot, const bool asOptica
 				continue;
 			}
 
-			FBModelNull *pPoint = new FBModelNull( fn_getname(thePoint, applyRenameRule) );
-			pPoint->Show = true;
-			pPoint->Visibility = true;
-			pPoint->Parent = pRoot;
-
-			FBAnimationNode *pNode = pPoint->Translation.GetAnimationNode();
-
-			if (pNode == nullptr)
-			{
-				pPoint->Translation.SetAnimated(true);
-				pNode = pPoint->Translation.GetAnimationNode();
-			}
-
-			if (pNode == nullptr)
-				continue;
-
-			
-			for (int theFrame=0; theFrame<numberOfFrames; ++theFrame)
-			{
-				double *localValues = &values[theFrame * (numberOfPoints * 3 + 1)];
-
-				FBTime currTime(0,0,0, (int)localValues[0]);	
-
-				// write values
-				pNode->KeyAdd( currTime, &localValues[thePoint*3+1] );
-			}
+			ImportNullPoint( fn_getname(thePoint, applyRenameRule), pRoot, data, thePoint, width, height, invertHeight, true );
 		}
 	}
 
-	//
-
-	if (values)
-	{
-		delete [] values;
-		values = nullptr;
-	}
-
 	return true;
 }
 
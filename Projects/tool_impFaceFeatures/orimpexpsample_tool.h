@@ -18,6 +18,8 @@
 //--- Class declaration
 #include <fbsdk/fbsdk.h>
 
+class FaceTrackingData;
+
 //--- Registration defines
 #define	ORTOOLSAMPLE__CLASSNAME		ORToolSample
 #define ORTOOLSAMPLE__CLASSSTR		"ORToolSample"
@@ -90,6 +92,7 @@ public:
 	void	EventButtonAboutClick	( HISender pSender, HKEvent pEvent );
 	
 	void	EventButtonImportOpenFace2DClick	( HISender pSender, HKEvent pEvent );
+	void	EventButtonBenchmarkClick	( HISender pSender, HKEvent pEvent );
 
 private:
 	
@@ -144,6 +147,7 @@ private:
 	FBButton			mButtonAbout;
 
 	FBButton			mButtonImportOpenFace2d;		// import OpenFace 2d landmarks
+	FBButton			mButtonBenchmark;				// parse synthetic multi-hour exports
 private:
 	
 	FBApplication		mApp;
@@ -162,6 +166,7 @@ private:
 
 	bool ImportPoints(FBModel *pRoot, const bool asOptical, const char *filename);
 	bool ImportLandmarks(FBModel *pRoot, const bool asOptical, const char *filename);
+	bool ImportLandmarks(FBModel *pRoot, const bool asOptical, const FaceTrackingData &data);
 
 	bool ImportOpenFaceLandmarks2d(FBModel *pRoot, const bool asOptical, const char *filename, 
 		const double width, const double height, const bool invertHeight, bool applyRenameRule,
@@ -169,6 +174,18 @@ private:
 
 	bool ImportEmptyJawPoints(FBModel *pRoot, const bool asOptical);
 
+	FBModel *CreateImportRoot(const bool asOptical);
+
+	// landmarks, empty jaw points and points by the tool options, pLandmarks is a parsed landmarks file
+	//  instead of the landmarks path, returns true when anything is imported
+	bool ImportByOptions(FBModel *pRoot, const bool asOptical, const FaceTrackingData *pLandmarks=nullptr);
+
+	// parsed landmark columns into scene elements, missing samples are occluded or skipped
+	void ImportOpticalMarker(FBModelMarkerOptical *pMarker, const FaceTrackingData &data, const int landmark,
+		const double scaleU, const double scaleV, const bool invertHeight);
+	void ImportNullPoint(const char *name, FBModel *pRoot, const FaceTrackingData &data, const int landmark,
+		const double scaleU, const double scaleV, const bool invertHeight, const bool useFileFrames);
+
 	void BatchProcessing(const char *sourceFolder, const char *destinationFolder);
 };
 